@@ -0,0 +1,80 @@
+/**
+ * buffer_pool_manager_benchmark.cpp
+ */
+
+#include <cstdio>
+#include <random>
+
+#include "benchmark/benchmark.h"
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+// shared by the threads of a run, set up and torn down by thread 0; the
+// threads start and stop their loops together
+static DiskManager *disk_manager;
+static BufferPoolManager *bpm;
+
+static void SetUp(size_t pool_size, size_t num_instances, int num_pages) {
+  disk_manager = new DiskManager("benchmark.db");
+  bpm = new BufferPoolManager(pool_size, disk_manager, nullptr, num_instances);
+  page_id_t page_id;
+  for (int i = 0; i < num_pages; i++) {
+    bpm->NewPage(page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+}
+
+static void TearDown() {
+  delete bpm;
+  delete disk_manager;
+  remove("benchmark.db");
+  remove("benchmark.log");
+}
+
+// the pages all fit: every fetch is a hit. state.range(0) partitions
+static void BM_BufferPoolFetchHit(benchmark::State &state) {
+  const int num_pages = 256;
+  if (state.thread_index() == 0)
+    SetUp(1024, state.range(0), num_pages);
+  std::mt19937 random(state.thread_index());
+  std::uniform_int_distribution<page_id_t> pages(0, num_pages - 1);
+  for (auto _ : state) {
+    page_id_t page_id = pages(random);
+    benchmark::DoNotOptimize(bpm->FetchPage(page_id));
+    bpm->UnpinPage(page_id, false);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0)
+    TearDown();
+}
+BENCHMARK(BM_BufferPoolFetchHit)
+    ->Arg(1)
+    ->Arg(8)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// a sweep over 64 times as many pages as frames: every fetch is a miss and
+// evicts a page
+static void BM_BufferPoolFetchMiss(benchmark::State &state) {
+  const int num_frames = 64;
+  const int num_pages = num_frames * 64;
+  if (state.thread_index() == 0)
+    SetUp(num_frames, state.range(0), num_pages);
+  page_id_t page_id = state.thread_index();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bpm->FetchPage(page_id));
+    bpm->UnpinPage(page_id, false);
+    page_id = (page_id + state.threads()) % num_pages;
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0)
+    TearDown();
+}
+BENCHMARK(BM_BufferPoolFetchMiss)
+    ->Arg(1)
+    ->Arg(8)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+} // namespace cmudb
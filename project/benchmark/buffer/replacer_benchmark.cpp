@@ -0,0 +1,79 @@
+/**
+ * replacer_benchmark.cpp
+ */
+
+#include <memory>
+#include <random>
+
+#include "benchmark/benchmark.h"
+#include "buffer/arc_replacer.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+
+namespace cmudb {
+
+static std::unique_ptr<Replacer<int>> MakeReplacer(ReplacerType type,
+                                                   size_t num_frames) {
+  switch (type) {
+  case ReplacerType::CLOCK:
+    return std::unique_ptr<Replacer<int>>(new ClockReplacer<int>(num_frames));
+  case ReplacerType::LRU_K:
+    return std::unique_ptr<Replacer<int>>(new LRUKReplacer<int>(2));
+  case ReplacerType::ARC:
+    return std::unique_ptr<Replacer<int>>(new ARCReplacer<int>(num_frames));
+  case ReplacerType::LRU:
+  default:
+    return std::unique_ptr<Replacer<int>>(new LRUReplacer<int>);
+  }
+}
+
+// the buffer pool's use of a replacer: a frame is pinned, erased from the
+// replacer, and unpinned again, inserted; a victim once in a while
+template <ReplacerType Type>
+static void BM_ReplacerPinUnpin(benchmark::State &state) {
+  const int num_frames = static_cast<int>(state.range(0));
+  auto replacer = MakeReplacer(Type, num_frames);
+  for (int i = 0; i < num_frames; i++)
+    replacer->Insert(i);
+  std::mt19937 random(0);
+  std::uniform_int_distribution<int> frames(0, num_frames - 1);
+  int64_t n = 0;
+  for (auto _ : state) {
+    int frame = frames(random);
+    if (++n % 16 == 0 && replacer->Victim(frame)) {
+      replacer->Insert(frame);
+      continue;
+    }
+    replacer->Erase(frame);
+    replacer->Insert(frame);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_ReplacerPinUnpin, ReplacerType::LRU)->Range(64, 1 << 14);
+BENCHMARK_TEMPLATE(BM_ReplacerPinUnpin, ReplacerType::CLOCK)
+    ->Range(64, 1 << 14);
+BENCHMARK_TEMPLATE(BM_ReplacerPinUnpin, ReplacerType::LRU_K)
+    ->Range(64, 1 << 14);
+BENCHMARK_TEMPLATE(BM_ReplacerPinUnpin, ReplacerType::ARC)->Range(64, 1 << 14);
+
+// evict every frame, then put them all back
+template <ReplacerType Type>
+static void BM_ReplacerVictim(benchmark::State &state) {
+  const int num_frames = static_cast<int>(state.range(0));
+  auto replacer = MakeReplacer(Type, num_frames);
+  for (auto _ : state) {
+    for (int i = 0; i < num_frames; i++)
+      replacer->Insert(i);
+    int frame;
+    while (replacer->Victim(frame))
+      benchmark::DoNotOptimize(frame);
+  }
+  state.SetItemsProcessed(state.iterations() * num_frames);
+}
+BENCHMARK_TEMPLATE(BM_ReplacerVictim, ReplacerType::LRU)->Range(64, 1 << 14);
+BENCHMARK_TEMPLATE(BM_ReplacerVictim, ReplacerType::CLOCK)->Range(64, 1 << 14);
+BENCHMARK_TEMPLATE(BM_ReplacerVictim, ReplacerType::LRU_K)->Range(64, 1 << 14);
+BENCHMARK_TEMPLATE(BM_ReplacerVictim, ReplacerType::ARC)->Range(64, 1 << 14);
+
+} // namespace cmudb
@@ -0,0 +1,43 @@
+/**
+ * rwmutex_benchmark.cpp
+ */
+
+#include "benchmark/benchmark.h"
+#include "common/rwmutex.h"
+
+namespace cmudb {
+
+static RWMutex mutex;
+
+// readers only, they never wait for each other but share the mutex's state
+static void BM_RWMutexRead(benchmark::State &state) {
+  for (auto _ : state) {
+    mutex.RLock();
+    mutex.RUnlock();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RWMutexRead)->ThreadRange(1, 8)->UseRealTime();
+
+// one lock in state.range(0) taken for writing
+static void BM_RWMutexMixed(benchmark::State &state) {
+  const int64_t write_every = state.range(0);
+  int64_t n = 0;
+  for (auto _ : state) {
+    if (++n % write_every == 0) {
+      mutex.WLock();
+      mutex.WUnlock();
+    } else {
+      mutex.RLock();
+      mutex.RUnlock();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RWMutexMixed)
+    ->Arg(2)
+    ->Arg(16)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+} // namespace cmudb
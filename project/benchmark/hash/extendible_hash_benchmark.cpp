@@ -0,0 +1,41 @@
+/**
+ * extendible_hash_benchmark.cpp
+ */
+
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "hash/extendible_hash.h"
+
+namespace cmudb {
+
+// state.range(0) keys into an empty table, buckets of 64
+static void BM_ExtendibleHashInsert(benchmark::State &state) {
+  const int num_keys = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    ExtendibleHash<int, int> table(64);
+    for (int i = 0; i < num_keys; i++)
+      table.Insert(i, i);
+    benchmark::DoNotOptimize(table);
+  }
+  state.SetItemsProcessed(state.iterations() * num_keys);
+}
+BENCHMARK(BM_ExtendibleHashInsert)->Range(1 << 10, 1 << 18);
+
+// a random key of state.range(0), a miss every other lookup
+static void BM_ExtendibleHashFind(benchmark::State &state) {
+  const int num_keys = static_cast<int>(state.range(0));
+  ExtendibleHash<int, int> table(64);
+  for (int i = 0; i < num_keys; i++)
+    table.Insert(i, i);
+  std::mt19937 random(0);
+  std::uniform_int_distribution<int> keys(0, 2 * num_keys - 1);
+  int value;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(table.Find(keys(random), value));
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ExtendibleHashFind)->Range(1 << 10, 1 << 18);
+
+} // namespace cmudb
@@ -0,0 +1,133 @@
+/**
+ * b_plus_tree_benchmark.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "buffer/buffer_pool_manager.h"
+#include "index/b_plus_tree.h"
+#include "vtable/virtual_table.h"
+
+namespace cmudb {
+
+// a tree of the given key type over its own pool and file, big enough to
+// keep the tree in memory
+template <size_t KeySize, typename KeyComparator> class TreeFixture {
+public:
+  typedef BPlusTree<GenericKey<KeySize>, RID, KeyComparator> Tree;
+
+  TreeFixture()
+      : key_schema_(ParseCreateStatement("a bigint")),
+        disk_manager_("benchmark.db"), bpm_(4096, &disk_manager_),
+        tree_("benchmark_pk", &bpm_, KeyComparator(key_schema_)) {
+    // the header page
+    page_id_t page_id;
+    bpm_.NewPage(page_id);
+  }
+
+  ~TreeFixture() {
+    bpm_.UnpinPage(HEADER_PAGE_ID, true);
+    delete key_schema_;
+    remove("benchmark.db");
+    remove("benchmark.log");
+  }
+
+  // keys 0 to num_keys - 1 in random order
+  void Fill(int64_t num_keys) {
+    std::vector<int64_t> keys(num_keys);
+    for (int64_t i = 0; i < num_keys; i++)
+      keys[i] = i;
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+    for (auto key : keys)
+      Insert(key);
+  }
+
+  bool Insert(int64_t key) {
+    GenericKey<KeySize> index_key;
+    index_key.SetFromInteger(key);
+    return tree_.Insert(index_key, RID(0, static_cast<uint32_t>(key)));
+  }
+
+  Tree &GetTree() { return tree_; }
+
+private:
+  Schema *key_schema_;
+  DiskManager disk_manager_;
+  BufferPoolManager bpm_;
+  Tree tree_;
+};
+
+// state.range(0) keys, in random order, into an empty tree
+template <size_t KeySize, typename KeyComparator>
+static void BM_BPlusTreeInsert(benchmark::State &state) {
+  const int64_t num_keys = state.range(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+    {
+      TreeFixture<KeySize, KeyComparator> fixture;
+      state.ResumeTiming();
+      fixture.Fill(num_keys);
+      state.PauseTiming();
+    }
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * num_keys);
+}
+
+// a random key of a tree of state.range(0)
+template <size_t KeySize, typename KeyComparator>
+static void BM_BPlusTreeGetValue(benchmark::State &state) {
+  const int64_t num_keys = state.range(0);
+  TreeFixture<KeySize, KeyComparator> fixture;
+  fixture.Fill(num_keys);
+  std::mt19937 random(1);
+  std::uniform_int_distribution<int64_t> keys(0, num_keys - 1);
+  GenericKey<KeySize> index_key;
+  std::vector<RID> result;
+  for (auto _ : state) {
+    result.clear();
+    index_key.SetFromInteger(keys(random));
+    benchmark::DoNotOptimize(fixture.GetTree().GetValue(index_key, result));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// 100 keys on from a random one
+template <size_t KeySize, typename KeyComparator>
+static void BM_BPlusTreeRange(benchmark::State &state) {
+  const int64_t num_keys = state.range(0);
+  const int range = 100;
+  TreeFixture<KeySize, KeyComparator> fixture;
+  fixture.Fill(num_keys);
+  std::mt19937 random(1);
+  std::uniform_int_distribution<int64_t> keys(0, num_keys - range);
+  GenericKey<KeySize> index_key;
+  for (auto _ : state) {
+    index_key.SetFromInteger(keys(random));
+    auto iterator = fixture.GetTree().Begin(index_key);
+    for (int i = 0; i < range && !iterator.isEnd(); i++, ++iterator)
+      benchmark::DoNotOptimize((*iterator).second);
+  }
+  state.SetItemsProcessed(state.iterations() * range);
+}
+
+// integer keys compared as their schema says, as 8 bytes and as bytes, and
+// wider keys that fill fewer to a page
+#define TREE_BENCHMARKS(KEY_SIZE, COMPARATOR)                                  \
+  BENCHMARK_TEMPLATE(BM_BPlusTreeInsert, KEY_SIZE, COMPARATOR)                 \
+      ->Range(1 << 10, 1 << 16);                                               \
+  BENCHMARK_TEMPLATE(BM_BPlusTreeGetValue, KEY_SIZE, COMPARATOR)               \
+      ->Range(1 << 10, 1 << 16);                                               \
+  BENCHMARK_TEMPLATE(BM_BPlusTreeRange, KEY_SIZE, COMPARATOR)                  \
+      ->Range(1 << 10, 1 << 16)
+
+TREE_BENCHMARKS(8, GenericComparator<8>);
+TREE_BENCHMARKS(8, IntegerComparator<8>);
+TREE_BENCHMARKS(16, BytesComparator<16>);
+TREE_BENCHMARKS(64, GenericComparator<64>);
+
+} // namespace cmudb
@@ -0,0 +1,51 @@
+/**
+ * log_manager_benchmark.cpp
+ */
+
+#include <cstdio>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "logging/log_manager.h"
+
+namespace cmudb {
+
+// shared by the threads of a run, set up and torn down by thread 0
+static DiskManager *disk_manager;
+static LogManager *log_manager;
+
+// the database and every file of its log
+static void RemoveFiles() {
+  remove("benchmark.db");
+  remove("benchmark.log");
+  for (int i = 1; remove(("benchmark.log." + std::to_string(i)).c_str()) == 0;
+       i++) {
+  }
+}
+
+// records of 28 bytes appended by every thread, the flush thread writing
+// them out behind
+static void BM_LogManagerAppend(benchmark::State &state) {
+  if (state.thread_index() == 0) {
+    RemoveFiles();
+    disk_manager = new DiskManager("benchmark.db");
+    log_manager = new LogManager(disk_manager);
+    log_manager->RunFlushThread();
+  }
+  txn_id_t txn_id = state.thread_index();
+  for (auto _ : state) {
+    LogRecord log_record(txn_id, INVALID_LSN, LogRecordType::NEWPAGE, txn_id);
+    benchmark::DoNotOptimize(log_manager->AppendLogRecord(log_record));
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * 28);
+  if (state.thread_index() == 0) {
+    log_manager->StopFlushThread();
+    delete log_manager;
+    delete disk_manager;
+    RemoveFiles();
+  }
+}
+BENCHMARK(BM_LogManagerAppend)->ThreadRange(1, 8)->UseRealTime();
+
+} // namespace cmudb
@@ -0,0 +1,66 @@
+/**
+ * tuple_benchmark.cpp
+ */
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "table/tuple.h"
+#include "vtable/virtual_table.h"
+
+namespace cmudb {
+
+static Schema *TupleSchema() {
+  static Schema *schema = ParseCreateStatement(
+      "a int, b bigint, c varchar(32), d smallint, e double, f varchar(8)");
+  return schema;
+}
+
+static std::vector<Value> TupleValues(int i) {
+  return {Value(TypeId::INTEGER, i),
+          Value(TypeId::BIGINT, static_cast<int64_t>(i) * 3),
+          Value(TypeId::VARCHAR, "a string of some length"),
+          Value(TypeId::SMALLINT, static_cast<int16_t>(i % 100)),
+          Value(TypeId::DECIMAL, i * 0.5), Value(TypeId::VARCHAR, "short")};
+}
+
+// values into a new tuple
+static void BM_TupleConstruct(benchmark::State &state) {
+  Schema *schema = TupleSchema();
+  std::vector<Value> values = TupleValues(7);
+  for (auto _ : state) {
+    Tuple tuple(values, schema);
+    benchmark::DoNotOptimize(tuple.GetData());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TupleConstruct);
+
+// a tuple out to storage and back, as a page does
+static void BM_TupleSerialize(benchmark::State &state) {
+  Tuple tuple(TupleValues(7), TupleSchema());
+  std::vector<char> storage(tuple.GetLength() + sizeof(int32_t));
+  Tuple copy;
+  for (auto _ : state) {
+    tuple.SerializeTo(storage.data());
+    copy.DeserializeFrom(storage.data());
+    benchmark::DoNotOptimize(copy.GetData());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * tuple.GetLength());
+}
+BENCHMARK(BM_TupleSerialize);
+
+// every column of a tuple as a value
+static void BM_TupleGetValues(benchmark::State &state) {
+  Schema *schema = TupleSchema();
+  Tuple tuple(TupleValues(7), schema);
+  for (auto _ : state) {
+    for (int i = 0; i < schema->GetColumnCount(); i++)
+      benchmark::DoNotOptimize(tuple.GetValue(schema, i));
+  }
+  state.SetItemsProcessed(state.iterations() * schema->GetColumnCount());
+}
+BENCHMARK(BM_TupleGetValues);
+
+} // namespace cmudb
@@ -0,0 +1,1075 @@
+/**
+ * workload_driver.cpp
+ *
+ * End to end workloads against the storage engine: YCSB A to F over a table
+ * of records of ten fields, or a small TPC-C-like mix of new orders,
+ * payments, order status and stock level transactions. Keys are drawn from
+ * a Zipfian distribution. The driver runs for a while with some threads and
+ * reports throughput and the p50, p99 and p999 latencies of every kind of
+ * operation.
+ *
+ * The engine backend uses the tables of the storage engine directly, the
+ * sqlite one runs every operation as a SQL statement on a virtual table, a
+ * connection per thread. The module does not hand a refused lock back to
+ * sqlite, so there the transactions run one at a time. Usage:
+ *
+ *   workload_driver [--workload=a|b|c|d|e|f|tpcc] [--backend=engine|sqlite]
+ *                   [--threads=4] [--seconds=10] [--records=100000]
+ *                   [--warehouses=1] [--pool-size=4096] [--theta=0.99]
+ *                   [--durability=none|async|sync] [--extension=libvtable]
+ *
+ * The database files are created in the working directory, and removed.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/exception.h"
+#include "page/header_page.h"
+#include "sqlite/sqlite3.h"
+#include "vtable/virtual_table.h"
+
+namespace cmudb {
+
+/*****************************************************************************
+ * Options
+ *****************************************************************************/
+enum class Durability { NONE, ASYNC, SYNC };
+
+struct Options {
+  std::string workload = "a";
+  std::string backend = "engine";
+  int threads = 4;
+  int seconds = 10;
+  int64_t records = 100000;
+  int warehouses = 1;
+  size_t pool_size = 4096;
+  double theta = 0.99;
+  // none: no log; async: commits do not wait for their log records; sync:
+  // they do, sharing flushes. The sqlite backend always logs synchronously
+  Durability durability = Durability::SYNC;
+  std::string extension = "libvtable";
+};
+
+static bool ParseOptions(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    std::string::size_type n = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || n == std::string::npos)
+      return false;
+    std::string name = arg.substr(2, n - 2);
+    std::string value = arg.substr(n + 1);
+    if (name == "workload") {
+      options.workload = value;
+    } else if (name == "backend") {
+      options.backend = value;
+    } else if (name == "threads") {
+      options.threads = std::max(1, std::atoi(value.c_str()));
+    } else if (name == "seconds") {
+      options.seconds = std::max(1, std::atoi(value.c_str()));
+    } else if (name == "records") {
+      options.records = std::max(1LL, std::atoll(value.c_str()));
+    } else if (name == "warehouses") {
+      options.warehouses = std::max(1, std::atoi(value.c_str()));
+    } else if (name == "pool-size") {
+      options.pool_size = std::max(16LL, std::atoll(value.c_str()));
+    } else if (name == "theta") {
+      options.theta = std::atof(value.c_str());
+      if (options.theta <= 0 || options.theta >= 1)
+        return false;
+    } else if (name == "durability") {
+      if (value == "none")
+        options.durability = Durability::NONE;
+      else if (value == "async")
+        options.durability = Durability::ASYNC;
+      else if (value == "sync")
+        options.durability = Durability::SYNC;
+      else
+        return false;
+    } else if (name == "extension") {
+      options.extension = value;
+    } else {
+      return false;
+    }
+  }
+  if (options.workload != "tpcc" &&
+      (options.workload.size() != 1 || options.workload[0] < 'a' ||
+       options.workload[0] > 'f'))
+    return false;
+  if (options.backend != "engine" && options.backend != "sqlite")
+    return false;
+  return options.backend == "engine" || options.durability == Durability::SYNC;
+}
+
+/*****************************************************************************
+ * Key distributions
+ *****************************************************************************/
+// ranks 0 to n - 1, rank 0 the most frequent, as YCSB's ZipfianGenerator
+// (Gray et al., Quickly Generating Billion-Record Synthetic Databases)
+class ZipfianGenerator {
+public:
+  ZipfianGenerator(uint64_t n, double theta)
+      : n_(n), theta_(theta), alpha_(1 / (1 - theta)), zetan_(Zeta(n, theta)),
+        eta_((1 - std::pow(2.0 / n, 1 - theta)) /
+             (1 - Zeta(2, theta) / zetan_)) {}
+
+  uint64_t Next(std::mt19937_64 &random) const {
+    double u = std::uniform_real_distribution<double>(0, 1)(random);
+    double uz = u * zetan_;
+    if (uz < 1)
+      return 0;
+    if (uz < 1 + std::pow(0.5, theta_))
+      return 1;
+    uint64_t rank = static_cast<uint64_t>(
+        n_ * std::pow(eta_ * u - eta_ + 1, alpha_));
+    return std::min(rank, n_ - 1);
+  }
+
+  // the rank spread over 0 to n - 1, so the hot keys are not neighbours
+  uint64_t NextScrambled(std::mt19937_64 &random) const {
+    return Fnv(Next(random)) % n_;
+  }
+
+private:
+  static double Zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++)
+      sum += 1 / std::pow(static_cast<double>(i), theta);
+    return sum;
+  }
+
+  static uint64_t Fnv(uint64_t value) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < 8; i++) {
+      hash ^= value & 0xff;
+      hash *= 0x100000001b3ULL;
+      value >>= 8;
+    }
+    return hash;
+  }
+
+  uint64_t n_;
+  double theta_;
+  double alpha_;
+  double zetan_;
+  double eta_;
+};
+
+/*****************************************************************************
+ * Backends
+ *****************************************************************************/
+// a table of the workload: its first column is a bigint key, indexed
+struct TableDefinition {
+  std::string name;
+  std::string columns; // as for CREATE VIRTUAL TABLE
+};
+
+typedef std::vector<Value> Row;
+
+// thrown when a lock conflict aborted the transaction, it is to be run
+// again. Not an Exception, those are logged as they are made
+struct TransactionAborted {};
+
+// the operations of a thread, in transactions one at a time. An operation
+// throws TransactionAborted if its transaction has to be aborted
+class Backend {
+public:
+  virtual ~Backend() {}
+  virtual void Begin() = 0;
+  virtual void Commit() = 0;
+  virtual void Abort() = 0;
+  // the row of key of table, false if there is none
+  virtual bool Read(int table, int64_t key, Row &row) = 0;
+  // the row of its key, read by this transaction, becomes row
+  virtual void Update(int table, const Row &row) = 0;
+  virtual void Insert(int table, const Row &row) = 0;
+  // up to limit rows of keys low to high, in key order
+  virtual void Scan(int table, int64_t low, int64_t high, size_t limit,
+                    std::vector<Row> &rows) = 0;
+};
+
+// the tables of the workload and a backend for each thread
+class Database {
+public:
+  virtual ~Database() {}
+  // count rows, row i from row_of, into table; before any backend runs
+  virtual void Load(int table, int64_t count,
+                    const std::function<Row(int64_t)> &row_of) = 0;
+  // once loaded, ready to run
+  virtual void Start() {}
+  virtual std::unique_ptr<Backend> NewBackend() = 0;
+};
+
+static void RemoveFiles(const std::string &name) {
+  remove((name + ".db").c_str());
+  remove((name + ".log").c_str());
+  for (int i = 1; remove((name + ".log." + std::to_string(i)).c_str()) == 0;
+       i++) {
+  }
+}
+
+class EngineDatabase : public Database {
+  friend class EngineBackend;
+
+public:
+  EngineDatabase(const std::vector<TableDefinition> &tables,
+                 const Options &options)
+      : durability_(options.durability) {
+    RemoveFiles("workload");
+    storage_engine_ = new StorageEngine("workload.db", options.pool_size);
+    page_id_t header_page_id;
+    HeaderPage *header_page = static_cast<HeaderPage *>(
+        storage_engine_->buffer_pool_manager_->NewPage(header_page_id));
+    header_page->Init();
+    storage_engine_->buffer_pool_manager_->UnpinPage(header_page_id, true);
+    for (auto &definition : tables) {
+      Schema *schema = ParseCreateStatement(definition.columns);
+      std::string index = definition.name + "_pk " + schema->GetColumn(0).GetName();
+      IndexMetadata *metadata =
+          ParseIndexStatement(index, definition.name, schema);
+      std::vector<Index *> indexes = {ConstructIndex(
+          metadata, storage_engine_->index_buffer_pool_manager_,
+          INVALID_PAGE_ID, storage_engine_->log_manager_,
+          storage_engine_->root_catalog_)};
+      tables_.push_back(new VirtualTable(
+          schema, storage_engine_->buffer_pool_manager_,
+          storage_engine_->lock_manager_, storage_engine_->log_manager_,
+          indexes, definition.name));
+    }
+  }
+
+  ~EngineDatabase() {
+    for (auto table : tables_)
+      delete table;
+    delete storage_engine_;
+    storage_engine_ = nullptr;
+    RemoveFiles("workload");
+  }
+
+  // appended in batches, the index built at the end, see VirtualTable::Import
+  void Load(int table, int64_t count,
+            const std::function<Row(int64_t)> &row_of) override {
+    VirtualTable *virtual_table = tables_[table];
+    Schema *schema = virtual_table->GetSchema();
+    int64_t next = 0;
+    Transaction *txn = storage_engine_->transaction_manager_->Begin();
+    size_t loaded = 0;
+    virtual_table->Import(
+        [&](std::vector<Tuple> &tuples) {
+          for (; next < count && tuples.size() < IMPORT_BATCH_SIZE; next++)
+            tuples.push_back(Tuple(row_of(next), schema));
+          return !tuples.empty();
+        },
+        txn, loaded);
+    storage_engine_->transaction_manager_->Commit(txn);
+    storage_engine_->transaction_manager_->Release(txn);
+  }
+
+  // the log runs from here on, what was loaded is not in it
+  void Start() override {
+    if (durability_ == Durability::NONE)
+      return;
+    storage_engine_->log_manager_->RunFlushThread();
+    storage_engine_->transaction_manager_->SetAsyncCommit(
+        durability_ == Durability::ASYNC);
+  }
+
+  std::unique_ptr<Backend> NewBackend() override;
+
+private:
+  Durability durability_;
+  std::vector<VirtualTable *> tables_;
+};
+
+class EngineBackend : public Backend {
+public:
+  explicit EngineBackend(EngineDatabase *database)
+      : database_(database),
+        transaction_manager_(storage_engine_->transaction_manager_) {}
+
+  void Begin() override { txn_ = transaction_manager_->Begin(); }
+
+  void Commit() override {
+    bool committed = transaction_manager_->Commit(txn_);
+    transaction_manager_->Release(txn_);
+    txn_ = nullptr;
+    if (!committed)
+      throw TransactionAborted();
+  }
+
+  void Abort() override {
+    transaction_manager_->Abort(txn_);
+    transaction_manager_->Release(txn_);
+    txn_ = nullptr;
+  }
+
+  bool Read(int table, int64_t key, Row &row) override {
+    VirtualTable *virtual_table = database_->tables_[table];
+    std::vector<RID> rids;
+    virtual_table->GetIndex(0)->ScanKey(Key(virtual_table, key), rids, txn_);
+    Tuple tuple;
+    if (rids.empty() || !ReadTuple(virtual_table, rids[0], tuple))
+      return false;
+    Schema *schema = virtual_table->GetSchema();
+    row.clear();
+    for (int i = 0; i < schema->GetColumnCount(); i++)
+      row.push_back(tuple.GetValue(schema, i));
+    return true;
+  }
+
+  // in place, the key and so the index entry stay. A row of the same size
+  // always fits, a failure is a lock conflict
+  void Update(int table, const Row &row) override {
+    VirtualTable *virtual_table = database_->tables_[table];
+    std::vector<RID> rids;
+    virtual_table->GetIndex(0)->ScanKey(
+        Key(virtual_table, row[0].GetAs<int64_t>()), rids, txn_);
+    if (rids.empty())
+      return;
+    Tuple tuple(row, virtual_table->GetSchema());
+    if (!virtual_table->UpdateTuple(tuple, rids[0], txn_))
+      throw TransactionAborted();
+  }
+
+  // the index entry is not undone by an abort: the workloads insert last,
+  // when no lock conflict can follow
+  void Insert(int table, const Row &row) override {
+    VirtualTable *virtual_table = database_->tables_[table];
+    Tuple tuple(row, virtual_table->GetSchema());
+    RID rid;
+    if (!virtual_table->InsertTuple(tuple, rid, txn_))
+      throw TransactionAborted();
+    virtual_table->InsertEntries(tuple, rid, txn_);
+  }
+
+  // a batch of limit entries from the index, see Index::StartRange
+  void Scan(int table, int64_t low, int64_t high, size_t limit,
+            std::vector<Row> &rows) override {
+    VirtualTable *virtual_table = database_->tables_[table];
+    Index *index = virtual_table->GetIndex(0);
+    IndexScanPosition position;
+    index->StartRange(Key(virtual_table, low), Key(virtual_table, high),
+                      position);
+    std::vector<RID> rids;
+    index->ScanOrdered(false, limit, position, rids, txn_);
+    Schema *schema = virtual_table->GetSchema();
+    rows.clear();
+    for (auto &rid : rids) {
+      Tuple tuple;
+      if (!ReadTuple(virtual_table, rid, tuple))
+        continue;
+      Row row;
+      for (int i = 0; i < schema->GetColumnCount(); i++)
+        row.push_back(tuple.GetValue(schema, i));
+      rows.push_back(std::move(row));
+    }
+  }
+
+private:
+  static Tuple Key(VirtualTable *table, int64_t key) {
+    return Tuple({Value(TypeId::BIGINT, key)},
+                 table->GetIndex(0)->GetKeySchema());
+  }
+
+  // false if there is no row at rid, throws if the lock was refused
+  bool ReadTuple(VirtualTable *table, const RID &rid, Tuple &tuple) {
+    if (table->ReadTuple(rid, tuple, txn_))
+      return true;
+    if (txn_->GetState() == TransactionState::ABORTED)
+      throw TransactionAborted();
+    return false;
+  }
+
+  EngineDatabase *database_;
+  TransactionManager *transaction_manager_;
+  Transaction *txn_ = nullptr;
+};
+
+std::unique_ptr<Backend> EngineDatabase::NewBackend() {
+  return std::unique_ptr<Backend>(new EngineBackend(this));
+}
+
+// a connection to the sqlite database, with the virtual table module loaded
+static sqlite3 *OpenConnection(const Options &options) {
+  sqlite3 *db;
+  char *error = nullptr;
+  if (sqlite3_open("workload_sqlite.db", &db) != SQLITE_OK ||
+      sqlite3_enable_load_extension(db, 1) != SQLITE_OK ||
+      sqlite3_load_extension(db, options.extension.c_str(), nullptr,
+                             &error) != SQLITE_OK) {
+    std::string message = error != nullptr ? error : sqlite3_errmsg(db);
+    sqlite3_free(error);
+    sqlite3_close(db);
+    throw Exception(EXCEPTION_TYPE_CONNECTION,
+                    "cannot load " + options.extension + ": " + message);
+  }
+  sqlite3_busy_timeout(db, 10000);
+  return db;
+}
+
+static void Execute(sqlite3 *db, const std::string &sql) {
+  if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    throw Exception(EXCEPTION_TYPE_CONNECTION,
+                    sql + ": " + sqlite3_errmsg(db));
+}
+
+class SqliteBackend : public Backend {
+public:
+  SqliteBackend(const std::vector<TableDefinition> &tables,
+                const Options &options)
+      : db_(OpenConnection(options)) {
+    for (auto &definition : tables) {
+      Schema *schema = ParseCreateStatement(definition.columns);
+      std::string key = schema->GetColumn(0).GetName();
+      std::string values = "?1", assignments;
+      for (int i = 1; i < schema->GetColumnCount(); i++) {
+        std::string parameter = "?" + std::to_string(i + 1);
+        values += ", " + parameter;
+        assignments += (i > 1 ? ", " : "") + schema->GetColumn(i).GetName() +
+                       " = " + parameter;
+      }
+      Statements statements;
+      statements.schema = schema;
+      statements.read = Prepare("SELECT * FROM " + definition.name +
+                                " WHERE " + key + " = ?1");
+      statements.update = Prepare("UPDATE " + definition.name + " SET " +
+                                  assignments + " WHERE " + key + " = ?1");
+      statements.insert =
+          Prepare("INSERT INTO " + definition.name + " VALUES (" + values + ")");
+      statements.scan = Prepare("SELECT * FROM " + definition.name +
+                                " WHERE " + key + " BETWEEN ?1 AND ?2 ORDER BY " +
+                                key + " LIMIT ?3");
+      statements_.push_back(statements);
+    }
+    begin_ = Prepare("BEGIN");
+    commit_ = Prepare("COMMIT");
+    rollback_ = Prepare("ROLLBACK");
+  }
+
+  ~SqliteBackend() {
+    for (auto &statements : statements_) {
+      delete statements.schema;
+      sqlite3_finalize(statements.read);
+      sqlite3_finalize(statements.update);
+      sqlite3_finalize(statements.insert);
+      sqlite3_finalize(statements.scan);
+    }
+    sqlite3_finalize(begin_);
+    sqlite3_finalize(commit_);
+    sqlite3_finalize(rollback_);
+    sqlite3_close(db_);
+  }
+
+  void Begin() override {
+    serial_ = std::unique_lock<std::mutex>(serial_latch_);
+    Step(begin_);
+  }
+  void Commit() override {
+    Step(commit_);
+    serial_.unlock();
+  }
+  void Abort() override {
+    sqlite3_step(rollback_);
+    sqlite3_reset(rollback_);
+    if (serial_.owns_lock())
+      serial_.unlock();
+  }
+
+  bool Read(int table, int64_t key, Row &row) override {
+    auto &statements = statements_[table];
+    sqlite3_bind_int64(statements.read, 1, key);
+    bool found = sqlite3_step(statements.read) == SQLITE_ROW;
+    if (found)
+      ReadRow(statements.read, statements.schema, row);
+    Reset(statements.read);
+    return found;
+  }
+
+  void Update(int table, const Row &row) override {
+    auto &statements = statements_[table];
+    Bind(statements.update, row);
+    Step(statements.update);
+  }
+
+  void Insert(int table, const Row &row) override {
+    auto &statements = statements_[table];
+    Bind(statements.insert, row);
+    Step(statements.insert);
+  }
+
+  void Scan(int table, int64_t low, int64_t high, size_t limit,
+            std::vector<Row> &rows) override {
+    auto &statements = statements_[table];
+    sqlite3_bind_int64(statements.scan, 1, low);
+    sqlite3_bind_int64(statements.scan, 2, high);
+    sqlite3_bind_int64(statements.scan, 3, limit);
+    rows.clear();
+    while (sqlite3_step(statements.scan) == SQLITE_ROW) {
+      rows.emplace_back();
+      ReadRow(statements.scan, statements.schema, rows.back());
+    }
+    Reset(statements.scan);
+  }
+
+  sqlite3 *GetConnection() { return db_; }
+
+private:
+  struct Statements {
+    Schema *schema;
+    sqlite3_stmt *read;
+    sqlite3_stmt *update;
+    sqlite3_stmt *insert;
+    sqlite3_stmt *scan;
+  };
+
+  sqlite3_stmt *Prepare(const std::string &sql) {
+    sqlite3_stmt *statement;
+    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &statement, nullptr) !=
+        SQLITE_OK)
+      throw Exception(EXCEPTION_TYPE_CONNECTION,
+                      sql + ": " + sqlite3_errmsg(db_));
+    return statement;
+  }
+
+  static void Bind(sqlite3_stmt *statement, const Row &row) {
+    for (size_t i = 0; i < row.size(); i++) {
+      int parameter = static_cast<int>(i + 1);
+      if (row[i].GetTypeId() == TypeId::VARCHAR)
+        sqlite3_bind_text(statement, parameter, row[i].GetData(), -1,
+                          SQLITE_TRANSIENT);
+      else if (row[i].GetTypeId() == TypeId::DECIMAL)
+        sqlite3_bind_double(statement, parameter, row[i].GetAs<double>());
+      else
+        sqlite3_bind_int64(statement, parameter,
+                           row[i].CastAs(TypeId::BIGINT).GetAs<int64_t>());
+    }
+  }
+
+  static void ReadRow(sqlite3_stmt *statement, Schema *schema, Row &row) {
+    row.clear();
+    for (int i = 0; i < schema->GetColumnCount(); i++) {
+      TypeId type = schema->GetType(i);
+      if (type == TypeId::VARCHAR)
+        row.push_back(Value(TypeId::VARCHAR,
+                            std::string(reinterpret_cast<const char *>(
+                                sqlite3_column_text(statement, i)))));
+      else if (type == TypeId::DECIMAL)
+        row.push_back(
+            Value(TypeId::DECIMAL, sqlite3_column_double(statement, i)));
+      else
+        row.push_back(Value(TypeId::BIGINT, static_cast<int64_t>(
+                                                sqlite3_column_int64(statement,
+                                                                     i)))
+                          .CastAs(type));
+    }
+  }
+
+  // any error aborts the transaction
+  void Step(sqlite3_stmt *statement) {
+    int rc = sqlite3_step(statement);
+    sqlite3_reset(statement);
+    if (rc != SQLITE_DONE && rc != SQLITE_ROW)
+      throw TransactionAborted();
+  }
+
+  void Reset(sqlite3_stmt *statement) {
+    if (sqlite3_reset(statement) != SQLITE_OK)
+      throw TransactionAborted();
+  }
+
+  sqlite3 *db_;
+  std::vector<Statements> statements_;
+  sqlite3_stmt *begin_;
+  sqlite3_stmt *commit_;
+  sqlite3_stmt *rollback_;
+  // held by the transaction running. Not the database lock of sqlite:
+  // sqlite lets it go before the module commits
+  static std::mutex serial_latch_;
+  std::unique_lock<std::mutex> serial_;
+};
+
+std::mutex SqliteBackend::serial_latch_;
+
+class SqliteDatabase : public Database {
+public:
+  SqliteDatabase(const std::vector<TableDefinition> &tables,
+                 const Options &options)
+      : tables_(tables), options_(options) {
+    RemoveFiles("workload_sqlite");
+    RemoveFiles("vtable");
+    setenv("VTABLE_BUFFER_POOL_SIZE",
+           std::to_string(options.pool_size).c_str(), 1);
+    // the module is loaded as long as a connection is open
+    sqlite3 *db = OpenConnection(options);
+    for (auto &definition : tables) {
+      Schema *schema = ParseCreateStatement(definition.columns);
+      Execute(db, "CREATE VIRTUAL TABLE " + definition.name +
+                      " USING vtable('" + definition.columns + "', '" +
+                      definition.name + "_pk " +
+                      schema->GetColumn(0).GetName() + "')");
+      delete schema;
+    }
+    loader_.reset(new SqliteBackend(tables, options));
+    sqlite3_close(db);
+  }
+
+  ~SqliteDatabase() {
+    loader_.reset();
+    RemoveFiles("workload_sqlite");
+    RemoveFiles("vtable");
+  }
+
+  void Load(int table, int64_t count,
+            const std::function<Row(int64_t)> &row_of) override {
+    for (int64_t i = 0; i < count; i += IMPORT_BATCH_SIZE) {
+      loader_->Begin();
+      for (int64_t j = i; j < std::min<int64_t>(count, i + IMPORT_BATCH_SIZE);
+           j++)
+        loader_->Insert(table, row_of(j));
+      loader_->Commit();
+    }
+  }
+
+  std::unique_ptr<Backend> NewBackend() override {
+    return std::unique_ptr<Backend>(new SqliteBackend(tables_, options_));
+  }
+
+private:
+  std::vector<TableDefinition> tables_;
+  Options options_;
+  // keeps the module loaded until the end
+  std::unique_ptr<SqliteBackend> loader_;
+};
+
+/*****************************************************************************
+ * Workloads
+ *****************************************************************************/
+class Workload {
+public:
+  virtual ~Workload() {}
+  virtual std::vector<TableDefinition> GetTables() = 0;
+  virtual void Load(Database &database) = 0;
+  // names of the kinds of operation, a transaction each
+  virtual std::vector<std::string> GetOperations() = 0;
+  virtual int NextOperation(std::mt19937_64 &random) = 0;
+  // runs in a transaction begun by the caller
+  virtual void Run(int operation, Backend &backend,
+                   std::mt19937_64 &random) = 0;
+};
+
+// the operations of YCSB with a row of a key and ten fields of 100 bytes
+class YcsbWorkload : public Workload {
+public:
+  enum Operation { READ, UPDATE, INSERT, SCAN, READ_MODIFY_WRITE };
+
+  YcsbWorkload(char workload, int64_t records, double theta)
+      : records_(records), next_key_(records), keys_(records, theta) {
+    // percentages by operation
+    switch (workload) {
+    case 'a':
+      mix_ = {50, 50, 0, 0, 0};
+      break;
+    case 'b':
+      mix_ = {95, 5, 0, 0, 0};
+      break;
+    case 'c':
+      mix_ = {100, 0, 0, 0, 0};
+      break;
+    case 'd':
+      // the latest records are the hot ones
+      mix_ = {95, 0, 5, 0, 0};
+      latest_ = true;
+      break;
+    case 'e':
+      mix_ = {0, 0, 5, 95, 0};
+      break;
+    case 'f':
+      mix_ = {50, 0, 0, 0, 50};
+      break;
+    }
+  }
+
+  std::vector<TableDefinition> GetTables() override {
+    std::string columns = "ycsb_key bigint";
+    for (int i = 0; i < FIELDS; i++)
+      columns += ", field" + std::to_string(i) + " varchar(" +
+                 std::to_string(FIELD_LENGTH) + ")";
+    return {{"usertable", columns}};
+  }
+
+  void Load(Database &database) override {
+    database.Load(0, records_, [this](int64_t key) { return NewRow(key); });
+  }
+
+  std::vector<std::string> GetOperations() override {
+    return {"read", "update", "insert", "scan", "read-modify-write"};
+  }
+
+  int NextOperation(std::mt19937_64 &random) override {
+    int percent = std::uniform_int_distribution<int>(0, 99)(random);
+    for (int operation = 0;; operation++) {
+      percent -= mix_[operation];
+      if (percent < 0)
+        return operation;
+    }
+  }
+
+  void Run(int operation, Backend &backend,
+           std::mt19937_64 &random) override {
+    Row row;
+    switch (operation) {
+    case READ:
+      backend.Read(0, NextKey(random), row);
+      break;
+    case UPDATE:
+    case READ_MODIFY_WRITE:
+      // the engine writes whole rows, an update reads the row first too
+      if (backend.Read(0, NextKey(random), row)) {
+        int field = std::uniform_int_distribution<int>(1, FIELDS)(random);
+        row[field] = Field(static_cast<int64_t>(random()));
+        backend.Update(0, row);
+      }
+      break;
+    case INSERT:
+      backend.Insert(0, NewRow(next_key_++));
+      break;
+    case SCAN: {
+      std::vector<Row> rows;
+      size_t length = std::uniform_int_distribution<size_t>(1, 100)(random);
+      backend.Scan(0, NextKey(random), PELOTON_INT64_MAX, length, rows);
+      break;
+    }
+    }
+  }
+
+private:
+  static const int FIELDS = 10;
+  static const int FIELD_LENGTH = 100;
+
+  static Value Field(int64_t seed) {
+    return Value(TypeId::VARCHAR,
+                 std::string(FIELD_LENGTH, static_cast<char>('a' + std::abs(seed % 26))));
+  }
+
+  Row NewRow(int64_t key) {
+    Row row = {Value(TypeId::BIGINT, key)};
+    for (int i = 0; i < FIELDS; i++)
+      row.push_back(Field(key + i));
+    return row;
+  }
+
+  int64_t NextKey(std::mt19937_64 &random) {
+    if (!latest_)
+      return keys_.NextScrambled(random);
+    int64_t key = next_key_ - 1 - static_cast<int64_t>(keys_.Next(random));
+    return std::max<int64_t>(0, key);
+  }
+
+  int64_t records_;
+  std::atomic<int64_t> next_key_;
+  ZipfianGenerator keys_;
+  std::vector<int> mix_;
+  bool latest_ = false;
+};
+
+// a few TPC-C transactions over warehouses, districts, customers, stock and
+// orders, scaled down. Customers and items are drawn Zipfian
+class TpccWorkload : public Workload {
+public:
+  enum Table { WAREHOUSE, DISTRICT, CUSTOMER, STOCK, ORDERS };
+  enum Operation { NEW_ORDER, PAYMENT, ORDER_STATUS, STOCK_LEVEL };
+
+  TpccWorkload(int warehouses, double theta)
+      : warehouses_(warehouses), customers_(CUSTOMERS, theta),
+        items_(ITEMS, theta) {}
+
+  std::vector<TableDefinition> GetTables() override {
+    return {{"warehouse", "w_id bigint, w_ytd double"},
+            {"district", "d_id bigint, d_ytd double, d_next_o_id bigint"},
+            {"customer", "c_id bigint, c_balance double, c_payment_cnt int, "
+                         "c_data varchar(100)"},
+            {"stock", "s_id bigint, s_quantity int, s_ytd int, "
+                      "s_order_cnt int, s_data varchar(50)"},
+            {"orders", "o_id bigint, o_c_id bigint, o_ol_cnt int, "
+                       "o_amount double"}};
+  }
+
+  void Load(Database &database) override {
+    database.Load(WAREHOUSE, warehouses_, [](int64_t w) {
+      return Row{Value(TypeId::BIGINT, w), Value(TypeId::DECIMAL, 300000.0)};
+    });
+    database.Load(DISTRICT, warehouses_ * DISTRICTS, [](int64_t d) {
+      return Row{Value(TypeId::BIGINT, d), Value(TypeId::DECIMAL, 30000.0),
+                 Value(TypeId::BIGINT, static_cast<int64_t>(1))};
+    });
+    database.Load(CUSTOMER, warehouses_ * DISTRICTS * CUSTOMERS, [](int64_t c) {
+      return Row{Value(TypeId::BIGINT, c), Value(TypeId::DECIMAL, -10.0),
+                 Value(TypeId::INTEGER, 1),
+                 Value(TypeId::VARCHAR, std::string(100, 'c'))};
+    });
+    database.Load(STOCK, warehouses_ * ITEMS, [](int64_t s) {
+      return Row{Value(TypeId::BIGINT, s),
+                 Value(TypeId::INTEGER, static_cast<int32_t>(10 + s % 91)),
+                 Value(TypeId::INTEGER, 0), Value(TypeId::INTEGER, 0),
+                 Value(TypeId::VARCHAR, std::string(50, 's'))};
+    });
+  }
+
+  std::vector<std::string> GetOperations() override {
+    return {"new-order", "payment", "order-status", "stock-level"};
+  }
+
+  int NextOperation(std::mt19937_64 &random) override {
+    int percent = std::uniform_int_distribution<int>(0, 99)(random);
+    if (percent < 45)
+      return NEW_ORDER;
+    if (percent < 88)
+      return PAYMENT;
+    if (percent < 94)
+      return ORDER_STATUS;
+    return STOCK_LEVEL;
+  }
+
+  void Run(int operation, Backend &backend,
+           std::mt19937_64 &random) override {
+    int64_t w = std::uniform_int_distribution<int64_t>(0, warehouses_ - 1)(
+        random);
+    int64_t d = w * DISTRICTS +
+                std::uniform_int_distribution<int64_t>(0, DISTRICTS - 1)(random);
+    int64_t c = d * CUSTOMERS + customers_.NextScrambled(random);
+    Row row;
+    std::vector<Row> rows;
+    switch (operation) {
+    case NEW_ORDER: {
+      Row district;
+      if (!backend.Read(DISTRICT, d, district))
+        return;
+      int64_t o_id = district[2].GetAs<int64_t>();
+      district[2] = Value(TypeId::BIGINT, o_id + 1);
+      backend.Update(DISTRICT, district);
+      backend.Read(CUSTOMER, c, row);
+      int lines = std::uniform_int_distribution<int>(5, 15)(random);
+      double amount = 0;
+      for (int i = 0; i < lines; i++) {
+        int64_t item = items_.NextScrambled(random);
+        if (!backend.Read(STOCK, w * ITEMS + item, row))
+          continue;
+        int32_t quantity = std::uniform_int_distribution<int32_t>(1, 10)(random);
+        int32_t stock = row[1].GetAs<int32_t>() - quantity;
+        row[1] = Value(TypeId::INTEGER, stock < 10 ? stock + 91 : stock);
+        row[2] = Value(TypeId::INTEGER, row[2].GetAs<int32_t>() + quantity);
+        row[3] = Value(TypeId::INTEGER, row[3].GetAs<int32_t>() + 1);
+        backend.Update(STOCK, row);
+        amount += quantity * (1 + item % 100);
+      }
+      backend.Insert(ORDERS, {Value(TypeId::BIGINT, OrderKey(d, o_id)),
+                              Value(TypeId::BIGINT, c),
+                              Value(TypeId::INTEGER, lines),
+                              Value(TypeId::DECIMAL, amount)});
+      break;
+    }
+    case PAYMENT: {
+      double amount = std::uniform_real_distribution<double>(1, 5000)(random);
+      if (backend.Read(WAREHOUSE, w, row)) {
+        row[1] = Value(TypeId::DECIMAL, row[1].GetAs<double>() + amount);
+        backend.Update(WAREHOUSE, row);
+      }
+      if (backend.Read(DISTRICT, d, row)) {
+        row[1] = Value(TypeId::DECIMAL, row[1].GetAs<double>() + amount);
+        backend.Update(DISTRICT, row);
+      }
+      if (backend.Read(CUSTOMER, c, row)) {
+        row[1] = Value(TypeId::DECIMAL, row[1].GetAs<double>() - amount);
+        row[2] = Value(TypeId::INTEGER, row[2].GetAs<int32_t>() + 1);
+        backend.Update(CUSTOMER, row);
+      }
+      break;
+    }
+    case ORDER_STATUS: {
+      // the last orders of the district
+      backend.Read(CUSTOMER, c, row);
+      if (!backend.Read(DISTRICT, d, row))
+        return;
+      int64_t next = row[2].GetAs<int64_t>();
+      backend.Scan(ORDERS, OrderKey(d, std::max<int64_t>(1, next - 10)),
+                   OrderKey(d, next), 10, rows);
+      break;
+    }
+    case STOCK_LEVEL: {
+      // stock of 20 neighbouring items
+      backend.Read(DISTRICT, d, row);
+      int64_t item =
+          std::uniform_int_distribution<int64_t>(0, ITEMS - 20)(random);
+      backend.Scan(STOCK, w * ITEMS + item, w * ITEMS + item + 19, 20, rows);
+      break;
+    }
+    }
+  }
+
+private:
+  static const int64_t DISTRICTS = 10;
+  static const int64_t CUSTOMERS = 300; // per district
+  static const int64_t ITEMS = 10000;   // stock rows per warehouse
+
+  static int64_t OrderKey(int64_t d, int64_t o_id) { return d << 32 | o_id; }
+
+  int64_t warehouses_;
+  ZipfianGenerator customers_;
+  ZipfianGenerator items_;
+};
+
+/*****************************************************************************
+ * Driver
+ *****************************************************************************/
+// every latency is kept, the percentiles are exact
+struct OperationStats {
+  std::vector<uint64_t> latencies; // nanoseconds, retries included
+  uint64_t aborts = 0;
+};
+
+static void Work(Workload &workload, Backend &backend, int seed,
+                 std::chrono::steady_clock::time_point deadline,
+                 std::vector<OperationStats> &stats) {
+  std::mt19937_64 random(seed);
+  while (std::chrono::steady_clock::now() < deadline) {
+    int operation = workload.NextOperation(random);
+    auto start = std::chrono::steady_clock::now();
+    // the same operation again until it commits
+    std::mt19937_64 state = random;
+    for (;;) {
+      random = state;
+      try {
+        backend.Begin();
+        workload.Run(operation, backend, random);
+        backend.Commit();
+        break;
+      } catch (TransactionAborted &) {
+        backend.Abort();
+        stats[operation].aborts++;
+      }
+    }
+    stats[operation].latencies.push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+  }
+}
+
+static double Percentile(const std::vector<uint64_t> &sorted, double q) {
+  if (sorted.empty())
+    return 0;
+  size_t rank = std::min(sorted.size() - 1,
+                         static_cast<size_t>(q * sorted.size()));
+  return sorted[rank] / 1000.0;
+}
+
+static void Report(const Options &options, Workload &workload,
+                   std::vector<std::vector<OperationStats>> &stats,
+                   double seconds) {
+  std::vector<std::string> names = workload.GetOperations();
+  std::printf("workload %s, %s backend, %d threads, %zu frames, %.1f s\n",
+              options.workload.c_str(), options.backend.c_str(),
+              options.threads, options.pool_size, seconds);
+  std::printf("%-18s %10s %12s %8s %10s %10s %10s\n", "operation", "count",
+              "per second", "aborts", "p50 us", "p99 us", "p999 us");
+  std::vector<uint64_t> all;
+  uint64_t all_aborts = 0;
+  for (size_t operation = 0; operation < names.size(); operation++) {
+    std::vector<uint64_t> latencies;
+    uint64_t aborts = 0;
+    for (auto &thread : stats) {
+      latencies.insert(latencies.end(), thread[operation].latencies.begin(),
+                       thread[operation].latencies.end());
+      aborts += thread[operation].aborts;
+    }
+    if (latencies.empty())
+      continue;
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("%-18s %10zu %12.0f %8llu %10.1f %10.1f %10.1f\n",
+                names[operation].c_str(), latencies.size(),
+                latencies.size() / seconds,
+                static_cast<unsigned long long>(aborts),
+                Percentile(latencies, 0.5), Percentile(latencies, 0.99),
+                Percentile(latencies, 0.999));
+    all.insert(all.end(), latencies.begin(), latencies.end());
+    all_aborts += aborts;
+  }
+  std::sort(all.begin(), all.end());
+  std::printf("%-18s %10zu %12.0f %8llu %10.1f %10.1f %10.1f\n", "all",
+              all.size(), all.size() / seconds,
+              static_cast<unsigned long long>(all_aborts),
+              Percentile(all, 0.5), Percentile(all, 0.99),
+              Percentile(all, 0.999));
+}
+
+static int Main(const Options &options) {
+  std::unique_ptr<Workload> workload;
+  if (options.workload == "tpcc")
+    workload.reset(new TpccWorkload(options.warehouses, options.theta));
+  else
+    workload.reset(new YcsbWorkload(options.workload[0], options.records,
+                                    options.theta));
+
+  std::unique_ptr<Database> database;
+  if (options.backend == "engine")
+    database.reset(new EngineDatabase(workload->GetTables(), options));
+  else
+    database.reset(new SqliteDatabase(workload->GetTables(), options));
+  workload->Load(*database);
+  database->Start();
+
+  std::vector<std::unique_ptr<Backend>> backends;
+  for (int i = 0; i < options.threads; i++)
+    backends.push_back(database->NewBackend());
+  std::vector<std::vector<OperationStats>> stats(
+      options.threads,
+      std::vector<OperationStats>(workload->GetOperations().size()));
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + std::chrono::seconds(options.seconds);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.threads; i++) {
+    threads.emplace_back([&, i] {
+      Work(*workload, *backends[i], i + 1, deadline, stats[i]);
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  Report(options, *workload, stats, seconds);
+  return 0;
+}
+
+} // namespace cmudb
+
+int main(int argc, char **argv) {
+  cmudb::Options options;
+  if (!cmudb::ParseOptions(argc, argv, options)) {
+    std::cerr << "usage: " << argv[0]
+              << " [--workload=a|b|c|d|e|f|tpcc] [--backend=engine|sqlite]"
+                 " [--threads=N] [--seconds=N] [--records=N]"
+                 " [--warehouses=N] [--pool-size=N] [--theta=X]"
+                 " [--durability=none|async|sync] [--extension=PATH]\n"
+                 "the sqlite backend only runs with --durability=sync\n";
+    return 2;
+  }
+  try {
+    return cmudb::Main(options);
+  } catch (cmudb::Exception &) {
+    // logged already
+    return 1;
+  }
+}
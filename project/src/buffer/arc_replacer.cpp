@@ -0,0 +1,183 @@
+/**
+ * ARC implementation
+ */
+#include <algorithm>
+#include <cassert>
+
+#include "buffer/arc_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+ARCReplacer<T>::ARCReplacer(size_t capacity)
+    : capacity_(capacity), target_(0), size_(0), ghost_hits_(0),
+      ghost_misses_(0) {
+  assert(capacity_ > 0);
+}
+
+template <typename T> ARCReplacer<T>::~ARCReplacer() {}
+
+/*
+ * Pages are remembered by the id they held when evicted
+ */
+template <> page_id_t ARCReplacer<Page *>::Key(Page *const &value) {
+  return value->GetPageId();
+}
+
+// test only
+template <> page_id_t ARCReplacer<int>::Key(const int &value) {
+  return value;
+}
+
+/*
+ * Record one access of value and make it evictable.
+ * A resident value seen again moves to the front of T2. A value that is not
+ * resident (or whose frame now holds another page) enters T2 on a ghost hit,
+ * adapting the target size of T1, otherwise it enters T1
+ */
+template <typename T> void ARCReplacer<T>::Insert(const T &value) {
+  page_id_t key = Key(value);
+  auto iter = resident_.find(value);
+  if (iter != resident_.end()) {
+    std::list<Entry> &list = iter->second.first == ListId::T1 ? t1_ : t2_;
+    Entry entry = *iter->second.second;
+    list.erase(iter->second.second);
+    resident_.erase(iter);
+    if (entry.evictable_) {
+      --size_;
+    }
+    if (entry.key_ == key) {
+      t2_.push_front(Entry{value, key, true});
+      resident_[value] = std::make_pair(ListId::T2, t2_.begin());
+      ++size_;
+      return;
+    }
+    // the frame was reused for another page, start over below
+  }
+
+  ListId target_list = ListId::T1;
+  if (ForgetGhost(ListId::B1, key)) {
+    // b1_ already lost key, so its size before the hit is b1_.size() + 1
+    size_t delta = std::max<size_t>(1, b2_.size() / (b1_.size() + 1));
+    target_ = std::min(capacity_, target_ + delta);
+    target_list = ListId::T2;
+    ++ghost_hits_;
+  } else if (ForgetGhost(ListId::B2, key)) {
+    size_t delta = std::max<size_t>(1, b1_.size() / (b2_.size() + 1));
+    target_ = target_ > delta ? target_ - delta : 0;
+    target_list = ListId::T2;
+    ++ghost_hits_;
+  } else {
+    ++ghost_misses_;
+  }
+
+  std::list<Entry> &list = target_list == ListId::T1 ? t1_ : t2_;
+  list.push_front(Entry{value, key, true});
+  resident_[value] = std::make_pair(target_list, list.begin());
+  ++size_;
+}
+
+/* Evict from T1 while it is larger than its target, otherwise from T2,
+ * falling back to the other list if the preferred one is all pinned.
+ * Return false if nothing is evictable
+ */
+template <typename T> bool ARCReplacer<T>::Victim(T &value) {
+  if (size_ == 0) {
+    return false;
+  }
+  if (t1_.size() > target_ || t2_.empty()) {
+    return EvictFrom(ListId::T1, value) || EvictFrom(ListId::T2, value);
+  }
+  return EvictFrom(ListId::T2, value) || EvictFrom(ListId::T1, value);
+}
+
+/*
+ * Remove value from the evictable set. If removal is successful, return true,
+ * otherwise return false
+ */
+template <typename T> bool ARCReplacer<T>::Erase(const T &value) {
+  auto iter = resident_.find(value);
+  if (iter == resident_.end() || !iter->second.second->evictable_) {
+    return false;
+  }
+  iter->second.second->evictable_ = false;
+  --size_;
+  return true;
+}
+
+template <typename T> size_t ARCReplacer<T>::Size() { return size_; }
+
+/*
+ * Least recently used end of the list Victim prefers, then of the other one
+ */
+template <typename T>
+void ARCReplacer<T>::PeekVictims(size_t n, std::vector<T> &values) {
+  bool t1_first = t1_.size() > target_ || t2_.empty();
+  for (auto list : {t1_first ? &t1_ : &t2_, t1_first ? &t2_ : &t1_}) {
+    for (auto iter = list->rbegin(); iter != list->rend() && n > 0; ++iter) {
+      if (iter->evictable_) {
+        values.push_back(iter->value_);
+        --n;
+      }
+    }
+  }
+}
+
+template <typename T> bool ARCReplacer<T>::EvictFrom(ListId from, T &value) {
+  std::list<Entry> &list = from == ListId::T1 ? t1_ : t2_;
+  for (auto iter = list.rbegin(); iter != list.rend(); ++iter) {
+    if (!iter->evictable_) {
+      continue;
+    }
+    value = iter->value_;
+    RememberGhost(from == ListId::T1 ? ListId::B1 : ListId::B2, iter->key_);
+    resident_.erase(value);
+    list.erase(std::next(iter).base());
+    --size_;
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Put key at the front of a ghost list, dropping the oldest ghost once the
+ * list outgrows the capacity
+ */
+template <typename T>
+void ARCReplacer<T>::RememberGhost(ListId ghost, page_id_t key) {
+  if (key == INVALID_PAGE_ID) {
+    return;
+  }
+  // a page id is remembered at most once
+  if (!ForgetGhost(ListId::B1, key)) {
+    ForgetGhost(ListId::B2, key);
+  }
+  std::list<page_id_t> &list = ghost == ListId::B1 ? b1_ : b2_;
+  list.push_front(key);
+  ghost_[key] = std::make_pair(ghost, list.begin());
+  if (list.size() > capacity_) {
+    ghost_.erase(list.back());
+    list.pop_back();
+  }
+}
+
+/*
+ * Remove key from a ghost list. Return false if that list does not hold key
+ */
+template <typename T>
+bool ARCReplacer<T>::ForgetGhost(ListId ghost, page_id_t key) {
+  auto iter = ghost_.find(key);
+  if (iter == ghost_.end() || iter->second.first != ghost) {
+    return false;
+  }
+  (ghost == ListId::B1 ? b1_ : b2_).erase(iter->second.second);
+  ghost_.erase(iter);
+  return true;
+}
+
+template class ARCReplacer<Page *>;
+// test only
+template class ARCReplacer<int>;
+
+} // namespace cmudb
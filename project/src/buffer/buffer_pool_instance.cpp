@@ -0,0 +1,636 @@
+#include <cassert>
+#include <cstdint>
+#include <new>
+
+#include "buffer/buffer_pool_instance.h"
+#include "common/exception.h"
+#include "common/memory_tracker.h"
+#include "common/metrics.h"
+
+namespace cmudb
+{
+
+/*
+ * BufferPoolInstance Constructor
+ * When log_manager is nullptr, logging is disabled (for test purpose)
+ */
+BufferPoolInstance::BufferPoolInstance(size_t pool_size,
+                                       DiskManager *disk_manager,
+                                       LogManager *log_manager,
+                                       ReplacerType replacer_type,
+                                       FrameAllocation frame_allocation,
+                                       CompressedPageCache *compressed_cache,
+                                       int numa_node)
+    : pool_size_(pool_size), numa_node_(numa_node),
+      disk_manager_(disk_manager),
+      log_manager_(log_manager), compressed_cache_(compressed_cache)
+{
+  // a consecutive memory space for this instance
+  page_size_ = disk_manager_->GetPageSize();
+  if (!MemoryTracker::Instance().Reserve(MemoryConsumer::BUFFER_POOL,
+                                         FrameBytes())) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_MEMORY,
+                    "buffer pool over the memory budget");
+  }
+  metadata_ = new FrameRegion(pool_size_ * sizeof(Page),
+                              FrameAllocation::ALIGNED, numa_node_);
+  pages_ = reinterpret_cast<Page *>(metadata_->GetData());
+  assert(reinterpret_cast<uintptr_t>(pages_) % alignof(Page) == 0);
+  frames_ = new FrameRegion(pool_size_ * page_size_, frame_allocation,
+                            numa_node_);
+  page_table_ =
+      new LinearProbeHashTable<page_id_t, Page *>(pool_size_, INVALID_PAGE_ID);
+  switch (replacer_type)
+  {
+  case ReplacerType::CLOCK:
+    replacer_ = new ClockReplacer<Page *>(pool_size_);
+    break;
+  case ReplacerType::LRU_K:
+    replacer_ = new LRUKReplacer<Page *>(LRU_K_HISTORY);
+    break;
+  case ReplacerType::ARC:
+    replacer_ = new ARCReplacer<Page *>(pool_size_);
+    break;
+  case ReplacerType::LRU:
+  default:
+    replacer_ = new LRUReplacer<Page *>;
+    break;
+  }
+  free_list_ = new std::list<Page *>;
+
+  // put all the pages into free list
+  for (size_t i = 0; i < pool_size_; ++i)
+  {
+    new (&pages_[i]) Page();
+    pages_[i].frame_id_ = i;
+    pages_[i].data_ = frames_->GetData() + i * page_size_;
+    pages_[i].page_size_ = page_size_;
+    pages_[i].pin_count_ = Page::CLAIMED_PIN_COUNT;
+    free_list_->push_back(&pages_[i]);
+  }
+}
+
+/*
+ * BufferPoolInstance Deconstructor
+ */
+BufferPoolInstance::~BufferPoolInstance()
+{
+  for (size_t i = 0; i < pool_size_; ++i)
+  {
+    pages_[i].~Page();
+  }
+  delete metadata_;
+  delete frames_;
+  delete page_table_;
+  delete replacer_;
+  delete free_list_;
+  MemoryTracker::Instance().Release(MemoryConsumer::BUFFER_POOL, FrameBytes());
+}
+
+/*
+ * Pick a frame for a new resident page: always the free list first, then the
+ * replacer. A dirty victim is written back and its old mapping is removed
+ * from the page table. Returns nullptr if every frame is pinned.
+ * The frame is returned claimed. Pages pinned by the lock-free fast path
+ * stay in the replacer, so a victim whose claim fails is simply skipped.
+ */
+Page *BufferPoolInstance::GetVictimPage(std::unique_lock<std::mutex> &lock)
+{
+  Page* page = nullptr;
+  if (!free_list_->empty()) {
+    page = free_list_->front();
+    free_list_->pop_front();
+    return page;
+  }
+
+  BufferPoolCounters::Add(counters_.free_list_empty_);
+  while (true) {
+    // replacer is empty(), all page in the buffer pool is pinned.
+    if (!replacer_->Victim(page)) {
+      BufferPoolCounters::Add(counters_.no_free_frame_);
+      return nullptr;
+    }
+    if (page->is_flushing_) {
+      // the latch is dropped while waiting, the victim may have been pinned
+      // again or deleted meanwhile
+      page_id_t page_id = page->page_id_;
+      WaitForFlush(lock, page);
+      if (page->page_id_ != page_id) {
+        continue;
+      }
+    }
+    if (ClaimPage(page)) {
+      break;
+    }
+  }
+  // an unpin while waiting for the flush may have put it back
+  replacer_->Erase(page);
+  BufferPoolCounters::Add(counters_.evictions_);
+  if (page->is_dirty_) {
+    BufferPoolCounters::Add(counters_.dirty_write_backs_);
+    WaitForLog(page->page_id_, page->GetData());
+    disk_manager_->WritePage(page->page_id_, page->GetData());
+  }
+  // the OS caches mapped pages already
+  if (compressed_cache_ != nullptr &&
+      disk_manager_->GetMappedPage(page->page_id_) == nullptr) {
+    compressed_cache_->Put(page->page_id_, page->GetData(), page_size_);
+  }
+  page_table_->Remove(page->page_id_);
+  return page;
+}
+
+/*
+ * Uncontended acquisitions cost one try_lock and no clock reads
+ */
+std::unique_lock<std::mutex> BufferPoolInstance::AcquireLatch()
+{
+  std::unique_lock<std::mutex> lock(latch_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    auto start = std::chrono::steady_clock::now();
+    lock.lock();
+    auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    BufferPoolCounters::Add(counters_.latch_waits_);
+    BufferPoolCounters::Add(counters_.latch_wait_ns_, waited.count());
+  }
+  return lock;
+}
+
+/*
+ * Pin a page found by a lock-free page table probe. The frame may have been
+ * reassigned since the probe, which only shows once the pin is held; such a
+ * pin is given back. Claimed frames are left to the slow path. The replacer
+ * is not touched, the page leaves it lazily when it is picked as victim.
+ */
+bool BufferPoolInstance::TryPinResident(Page *page, page_id_t page_id)
+{
+  int pins = page->pin_count_.load();
+  while (pins >= 0) {
+    if (page->pin_count_.compare_exchange_weak(pins, pins + 1)) {
+      if (page->page_id_ == page_id) {
+        return true;
+      }
+      std::unique_lock<std::mutex> lock = AcquireLatch();
+      UnpinLocked(page);
+      return false;
+    }
+  }
+  return false;
+}
+
+void BufferPoolInstance::UnpinLocked(Page *page)
+{
+  // only ever reaches zero under the latch, see UnpinPage
+  if (page->pin_count_.fetch_sub(1) == 1) {
+    replacer_->Insert(page);
+  }
+}
+
+/**
+ * 0. fast path: a resident page is pinned without the latch.
+ * 1. search hash table.
+ *  1.1 if exist, pin the page and return immediately
+ *  1.2 if no exist, find a replacement entry from either free list or lru
+ *      replacer. (NOTE: always find from free list first)
+ * 2. If the entry chosen for replacement is dirty, write it back to disk.
+ * 3. Delete the entry for the old page from the hash table and insert an
+ * entry for the new page.
+ * 4. Update page metadata, read page content from disk file and return page
+ * pointer
+ */
+Page *BufferPoolInstance::FetchPage(page_id_t page_id)
+{
+  TRACE_POINT(buffer, fetch_page, page_id);
+  Page* page = nullptr;
+  if (page_table_->Find(page_id, page) && TryPinResident(page, page_id)) {
+    BufferPoolCounters::Add(counters_.hits_);
+    return page;
+  }
+
+  std::unique_lock<std::mutex> lock = AcquireLatch();
+  if (page_table_->Find(page_id, page)) {
+    if (page->is_loading_) {
+      // a prefetch owns the frame, the mapping cannot change until it's done
+      WaitForLoad(lock, page);
+    }
+    // unless the prefetch gave the frame up, the page failed its checksum
+    if (page->page_id_ == page_id) {
+      // Pin the page, a pinned page must never be chosen as victim
+      if (page->pin_count_ == 0) {
+        replacer_->Erase(page);
+      }
+      SetPagePin(page);
+      BufferPoolCounters::Add(counters_.hits_);
+      return page;
+    }
+  }
+
+  BufferPoolCounters::Add(counters_.misses_);
+  TRACE_POINT(buffer, fetch_miss, page_id);
+  page = GetVictimPage(lock);
+  if (page == nullptr) {
+    return nullptr;
+  }
+
+  page_table_->Insert(page_id, page);
+  if (!LoadPage(page_id, page)) {
+    // a corrupted page is not cached, the frame goes back to the free list
+    page_table_->Remove(page_id);
+    ResetPageMetadata(page);
+    free_list_->push_back(page);
+    return nullptr;
+  }
+  InitPageMetadata(page_id, page);
+  return page;
+}
+
+/*
+ * Implementation of unpin page
+ * if pin_count>0, decrement it and if it becomes zero, put it back to
+ * replacer if pin_count<=0 before this call, return false. is_dirty: set the
+ * dirty flag of this page
+ * Dropping any pin but the last needs no latch. The dirty flag is set before
+ * the pin is released so an eviction can never miss it.
+ * With the LSN of a change older than the recLSN, the recLSN is lowered to
+ * it under the latch, for a flush in progress too: its copy may lack the
+ * change.
+ */
+bool BufferPoolInstance::UnpinPage(page_id_t page_id, bool is_dirty,
+                                   lsn_t lsn)
+{
+  TRACE_POINT(buffer, unpin_page, page_id, is_dirty);
+  Page* page = nullptr;
+  if (!page_table_->Find(page_id, page)) {
+    return false;
+  }
+  int pins = lsn == INVALID_LSN ? page->pin_count_.load() : 0;
+  while (pins > 1) {
+    if (page->page_id_ != page_id) {
+      break;
+    }
+    // never clear a dirty flag set by another pinner
+    if (is_dirty) {
+      SetPageDirty(page);
+    }
+    if (page->pin_count_.compare_exchange_weak(pins, pins - 1)) {
+      return true;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock = AcquireLatch();
+  if (!page_table_->Find(page_id, page)) {
+    return false;
+  }
+  if (page->pin_count_ > 0) {
+    if (is_dirty) {
+      SetPageDirty(page);
+    }
+    if (lsn != INVALID_LSN) {
+      page->rec_lsn_ = std::min(page->rec_lsn_, lsn);
+      page->flush_rec_lsn_ = std::min(page->flush_rec_lsn_, lsn);
+    }
+    UnpinLocked(page);
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Used to flush a particular page of the buffer pool to disk. Should call the
+ * write_page method of the disk manager
+ * if page is not found in page table, return false
+ * NOTE: make sure page_id != INVALID_PAGE_ID
+ */
+bool BufferPoolInstance::FlushPage(page_id_t page_id) {
+  std::unique_lock<std::mutex> lock = AcquireLatch();
+  Page* page = nullptr;
+  if (page_table_->Find(page_id, page)) {
+    // an older copy must not land after this write
+    WaitForLoad(lock, page);
+    WaitForFlush(lock, page);
+    if (page->page_id_ != page_id) {
+      return false;
+    }
+    WaitForLog(page_id, page->GetData());
+    lsn_t rec_lsn = CleanRecLSN(page, page->GetData());
+    disk_manager_->WritePage(page_id, page->GetData());
+    page->is_dirty_ = false;
+    page->rec_lsn_ = rec_lsn;
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Loading pages are waited for, pages the cleaner is writing are skipped: it
+ * already has a copy at least as recent as it was when it started. One
+ * dirtied since then waits for the next flush, which the result tells
+ */
+bool BufferPoolInstance::CopyDirtyPages(std::vector<Page *> &pages,
+                                        std::vector<page_id_t> &page_ids,
+                                        std::vector<char> &copies)
+{
+  std::unique_lock<std::mutex> lock = AcquireLatch();
+  bool complete = true;
+  for (size_t i = 0; i < pool_size_; ++i) {
+    Page *page = &pages_[i];
+    WaitForLoad(lock, page);
+    if (page->page_id_ == INVALID_PAGE_ID || !page->is_dirty_) {
+      continue;
+    }
+    if (page->is_flushing_) {
+      complete = false;
+      continue;
+    }
+    page->is_dirty_ = false;
+    page->is_flushing_ = true;
+    copies.insert(copies.end(), page->GetData(), page->GetData() + page_size_);
+    page->flush_rec_lsn_ =
+        CleanRecLSN(page, &copies[copies.size() - page_size_]);
+    pages.push_back(page);
+    page_ids.push_back(page->page_id_);
+  }
+  return complete;
+}
+
+void BufferPoolInstance::EndFlush(const std::vector<Page *> &pages)
+{
+  if (pages.empty()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock = AcquireLatch();
+  for (auto page : pages) {
+    page->is_flushing_ = false;
+    page->rec_lsn_ = page->flush_rec_lsn_;
+  }
+  io_cv_.notify_all();
+}
+
+void BufferPoolInstance::GetDirtyPages(
+    std::vector<std::pair<page_id_t, lsn_t>> &pages)
+{
+  std::unique_lock<std::mutex> lock = AcquireLatch();
+  for (size_t i = 0; i < pool_size_; ++i) {
+    Page *page = &pages_[i];
+    page_id_t page_id = page->page_id_;
+    if (page_id == INVALID_PAGE_ID ||
+        (!page->is_dirty_ && !page->is_flushing_ && page->pin_count_ <= 0)) {
+      continue;
+    }
+    pages.emplace_back(page_id, page->rec_lsn_);
+  }
+}
+
+/**
+ * Remove page from this instance. First, if page is found within page
+ * table, remove this entry out of page table, reset page metadata and add the
+ * frame back to free list. If the page is found within page table, but
+ * pin_count != 0, return false. Deallocating the page on disk is the caller's
+ * (BufferPoolManager) job.
+ */
+bool BufferPoolInstance::DeletePage(page_id_t page_id) {
+  std::unique_lock<std::mutex> lock = AcquireLatch();
+  Page* page = nullptr;
+  if (compressed_cache_ != nullptr) {
+    compressed_cache_->Erase(page_id);
+  }
+  if (page_table_->Find(page_id, page)) {
+    WaitForLoad(lock, page);
+    WaitForFlush(lock, page);
+    // the latch was dropped while waiting
+    if (!page_table_->Find(page_id, page)) {
+      return true;
+    }
+    if (!ClaimPage(page)) {
+      return false;
+    }
+    replacer_->Erase(page);
+    page_table_->Remove(page_id);
+    ResetPageMetadata(page);
+    free_list_->push_back(page);
+  }
+  return true;
+}
+
+/**
+ * Bring a freshly allocated page into this instance.
+ * Choose a victim page either from free list or lru replacer(NOTE: always
+ * choose from free list first), update new page's metadata, zero out memory
+ * and add corresponding entry into page table. return nullptr if all the
+ * pages in this instance are pinned
+ */
+Page *BufferPoolInstance::NewPage(page_id_t page_id) {
+  std::unique_lock<std::mutex> lock = AcquireLatch();
+  Page* page = nullptr;
+  // a prefetch hinted before the page was deleted may have read the freed
+  // page in again, that image must go before the id is mapped anew. Only a
+  // reader as stale as the hint can have it pinned
+  if (page_table_->Find(page_id, page)) {
+    WaitForLoad(lock, page);
+    if (page_table_->Find(page_id, page)) {
+      if (!ClaimPage(page)) {
+        return nullptr;
+      }
+      replacer_->Erase(page);
+      page_table_->Remove(page_id);
+      ResetPageMetadata(page);
+      free_list_->push_back(page);
+    }
+  }
+  page = GetVictimPage(lock);
+  // all the page in pool are pinned
+  if (page == nullptr) {
+    return nullptr;
+  }
+
+  // a recycled page id must not bring back an old image
+  if (compressed_cache_ != nullptr) {
+    compressed_cache_->Erase(page_id);
+  }
+  page->data_ = GetFrame(page);
+  page->ResetMemory();
+  InitPageMetadata(page_id, page);
+  page_table_->Insert(page_id, page);
+  return page;
+}
+
+/**
+ * Prefetch: like a fetch miss, but the frame stays unpinned and the disk
+ * read is done without the latch. The frame stays claimed and out of the
+ * replacer while it is loading, so it can neither be pinned nor chosen as
+ * victim; it enters the replacer once the content is in place
+ */
+bool BufferPoolInstance::PrefetchPage(page_id_t page_id,
+                                      DiskScheduler *scheduler,
+                                      DiskCallback on_done)
+{
+  std::unique_lock<std::mutex> lock = AcquireLatch();
+  Page* page = nullptr;
+  if (page_table_->Find(page_id, page)) {
+    return false;
+  }
+  page = GetVictimPage(lock);
+  if (page == nullptr) {
+    return false;
+  }
+  page_table_->Insert(page_id, page);
+  page->page_id_ = page_id;
+  page->is_dirty_ = false;
+  page->rec_lsn_ = NextLSN();
+  page->is_loading_ = true;
+  lock.unlock();
+
+  // the asynchronous path reads into the frame, mapped pages need no read
+  if (scheduler != nullptr && disk_manager_->GetMappedPage(page_id) == nullptr &&
+      (compressed_cache_ == nullptr ||
+       !compressed_cache_->Get(page_id, GetFrame(page), page_size_))) {
+    page->data_ = GetFrame(page);
+    scheduler->Schedule(
+        DiskRequest{false, page_id, page->GetData(),
+                    [this, page, page_id, on_done] {
+                      FinishPrefetch(page, disk_manager_->VerifyPage(
+                                               page_id, page->GetData()));
+                      if (on_done)
+                        on_done();
+                    }});
+    return true;
+  }
+  bool loaded = true;
+  if (scheduler == nullptr || disk_manager_->GetMappedPage(page_id) != nullptr) {
+    loaded = LoadPage(page_id, page);
+  } else {
+    // served by the compressed tier
+    page->data_ = GetFrame(page);
+  }
+  FinishPrefetch(page, loaded);
+  if (on_done) {
+    on_done();
+  }
+  return true;
+}
+
+void BufferPoolInstance::FinishPrefetch(Page *page, bool loaded)
+{
+  std::unique_lock<std::mutex> lock = AcquireLatch();
+  page->is_loading_ = false;
+  if (loaded) {
+    BufferPoolCounters::Add(counters_.prefetches_);
+    page->pin_count_ = 0;
+    replacer_->Insert(page);
+  } else {
+    page_table_->Remove(page->page_id_);
+    ResetPageMetadata(page);
+    free_list_->push_back(page);
+  }
+  io_cv_.notify_all();
+}
+
+void BufferPoolInstance::GetResidentPages(std::vector<page_id_t> &page_ids)
+{
+  std::unique_lock<std::mutex> lock = AcquireLatch();
+  for (size_t i = 0; i < pool_size_; ++i) {
+    if (pages_[i].page_id_ != INVALID_PAGE_ID && pages_[i].pin_count_ > 0) {
+      page_ids.push_back(pages_[i].page_id_);
+    }
+  }
+  std::vector<Page *> unpinned;
+  replacer_->PeekVictims(replacer_->Size(), unpinned);
+  for (auto iter = unpinned.rbegin(); iter != unpinned.rend(); ++iter) {
+    // pinned by the fast path, already listed
+    if ((*iter)->pin_count_ != 0) {
+      continue;
+    }
+    page_ids.push_back((*iter)->page_id_);
+  }
+}
+
+/**
+ * Page cleaner pass over this instance.
+ * Dirty unpinned pages are picked from the cold end of the replacer, copied
+ * and marked clean under the latch, then written back with the latch
+ * released so foreground fetches are never stalled by these writes. A page
+ * dirtied again meanwhile is simply dirty again; a victim or flush of a page
+ * still being written waits for the write to finish.
+ * Fast path pins do not take the latch, a page pinned while it was copied is
+ * left dirty. Its pin cannot drop back to zero without the latch, so an
+ * unchanged zero pin count after the copy means nobody touched it.
+ */
+size_t BufferPoolInstance::CleanColdPages(size_t low_watermark,
+                                          size_t high_watermark,
+                                          DiskScheduler *scheduler)
+{
+  std::vector<Page *> candidates;
+  std::vector<Page *> pages;
+  std::vector<page_id_t> page_ids;
+  std::vector<char> copies;
+  {
+    std::unique_lock<std::mutex> lock = AcquireLatch();
+    replacer_->PeekVictims(replacer_->Size(), candidates);
+    size_t clean = free_list_->size();
+    for (auto page : candidates) {
+      if (page->pin_count_ == 0 && !page->is_dirty_) {
+        ++clean;
+      }
+    }
+    if (clean >= low_watermark) {
+      return 0;
+    }
+
+    for (auto page : candidates) {
+      if (clean >= high_watermark) {
+        break;
+      }
+      if (page->pin_count_ != 0 || !page->is_dirty_ || page->is_flushing_) {
+        continue;
+      }
+      page->is_dirty_ = false;
+      copies.insert(copies.end(), page->GetData(), page->GetData() + page_size_);
+      if (page->pin_count_ != 0) {
+        page->is_dirty_ = true;
+        copies.resize(pages.size() * page_size_);
+        continue;
+      }
+      page->is_flushing_ = true;
+      page->flush_rec_lsn_ =
+        CleanRecLSN(page, &copies[copies.size() - page_size_]);
+      pages.push_back(page);
+      page_ids.push_back(page->page_id_);
+      ++clean;
+    }
+  }
+
+  for (size_t i = 0; i < pages.size(); ++i) {
+    WaitForLog(page_ids[i], &copies[i * page_size_]);
+  }
+  if (scheduler != nullptr && !pages.empty()) {
+    // all writes of this pass in flight at once, wait for the last one
+    std::mutex done_latch;
+    std::condition_variable done_cv;
+    size_t remaining = pages.size();
+    std::vector<DiskRequest> requests;
+    for (size_t i = 0; i < pages.size(); ++i) {
+      requests.push_back(DiskRequest{
+          true, page_ids[i], &copies[i * page_size_],
+          [&done_latch, &done_cv, &remaining] {
+            std::lock_guard<std::mutex> guard(done_latch);
+            if (--remaining == 0)
+              done_cv.notify_one();
+          }});
+    }
+    scheduler->Schedule(requests);
+    std::unique_lock<std::mutex> done_lock(done_latch);
+    done_cv.wait(done_lock, [&remaining] { return remaining == 0; });
+  } else {
+    std::vector<const char *> data;
+    for (size_t i = 0; i < pages.size(); ++i) {
+      data.push_back(&copies[i * page_size_]);
+    }
+    disk_manager_->WritePages(page_ids.data(), data.data(), pages.size());
+  }
+  BufferPoolCounters::Add(counters_.cleaner_writes_, pages.size());
+
+  EndFlush(pages);
+  return pages.size();
+}
+} // namespace cmudb
@@ -1,4 +1,11 @@
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+
 #include "buffer/buffer_pool_manager.h"
+#include "common/memory_tracker.h"
+#include "common/numa.h"
+#include "page/header_page.h"
 
 namespace cmudb
 {
@@ -6,181 +13,502 @@ namespace cmudb
 /*
  * BufferPoolManager Constructor
  * When log_manager is nullptr, logging is disabled (for test purpose)
- * WARNING: Do Not Edit This Function
+ * pool_size frames are split over num_instances partitions, the first
+ * (pool_size % num_instances) partitions get one extra frame
  */
 BufferPoolManager::BufferPoolManager(size_t pool_size,
                                      DiskManager *disk_manager,
-                                     LogManager *log_manager)
+                                     LogManager *log_manager,
+                                     size_t num_instances,
+                                     ReplacerType replacer_type,
+                                     FrameAllocation frame_allocation,
+                                     size_t compressed_cache_bytes,
+                                     bool numa_aware)
     : pool_size_(pool_size), disk_manager_(disk_manager),
-      log_manager_(log_manager)
+      log_manager_(log_manager), compressed_cache_(nullptr),
+      prefetch_thread_(nullptr),
+      prefetch_running_(false), prefetch_inflight_(0),
+      numa_nodes_(numa_aware ? Numa::NodeCount() : 0),
+      prefetch_depth_(pool_size),
+      disk_scheduler_(nullptr),
+      free_space_map_recorded_(disk_manager->GetFreeSpaceMapPageId() !=
+                               INVALID_PAGE_ID),
+      cleaner_running_(false), scheduler_(nullptr)
 {
-  // a consecutive memory space for buffer pool
-  pages_ = new Page[pool_size_];
-  page_table_ = new ExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
-  replacer_ = new LRUReplacer<Page *>;
-  free_list_ = new std::list<Page *>;
-
-  // put all the pages into free list
-  for (size_t i = 0; i < pool_size_; ++i)
-  {
-    free_list_->push_back(&pages_[i]);
+  assert(num_instances > 0 && num_instances <= pool_size);
+  if (compressed_cache_bytes > 0) {
+    compressed_cache_ = new CompressedPageCache(compressed_cache_bytes);
+  }
+  try {
+    for (size_t i = 0; i < num_instances; ++i)
+    {
+      size_t instance_size =
+          pool_size / num_instances + (i < pool_size % num_instances ? 1 : 0);
+      int numa_node = numa_aware ? static_cast<int>(i) % numa_nodes_ : -1;
+      instances_.push_back(
+          new BufferPoolInstance(instance_size, disk_manager, log_manager,
+                                 replacer_type, frame_allocation,
+                                 compressed_cache_, numa_node));
+    }
+  } catch (...) {
+    // over the memory budget, give back the partitions made so far
+    for (auto instance : instances_) {
+      delete instance;
+    }
+    delete compressed_cache_;
+    throw;
   }
+  // read less ahead while memory is tight, halving per shrink
+  elastic_ = MemoryTracker::Instance().RegisterElastic(
+      ElasticPriority::PREFETCH,
+      [this](size_t) -> size_t {
+        prefetch_depth_.store(prefetch_depth_.load() / 2);
+        return 0;
+      },
+      [this] { prefetch_depth_.store(pool_size_); });
 }
 
 /*
  * BufferPoolManager Deconstructor
- * WARNING: Do Not Edit This Function
  */
 BufferPoolManager::~BufferPoolManager()
 {
-  delete[] pages_;
-  delete page_table_;
-  delete replacer_;
-  delete free_list_;
+  MemoryTracker::Instance().UnregisterElastic(elastic_);
+  StopPageCleaner();
+  if (prefetch_thread_ != nullptr) {
+    {
+      std::lock_guard<std::mutex> guard(prefetch_latch_);
+      prefetch_running_ = false;
+    }
+    prefetch_cv_.notify_one();
+    prefetch_thread_->join();
+    delete prefetch_thread_;
+  }
+  // drains reads and writes still in flight into the frames
+  delete disk_scheduler_;
+  for (auto instance : instances_)
+  {
+    delete instance;
+  }
+  delete compressed_cache_;
 }
 
-/**
- * 1. search hash table.
- *  1.1 if exist, pin the page and return immediately
- *  1.2 if no exist, find a replacement entry from either free list or lru
- *      replacer. (NOTE: always find from free list first)
- * 2. If the entry chosen for replacement is dirty, write it back to disk.
- * 3. Delete the entry for the old page from the hash table and insert an
- * entry for the new page.
- * 4. Update page metadata, read page content from disk file and return page
- * pointer
+/*
+ * Fetch the requested page from its partition, see
+ * BufferPoolInstance::FetchPage
  */
 Page *BufferPoolManager::FetchPage(page_id_t page_id)
 {
-  std::lock_guard<std::mutex> gurad(latch_);
-  Page* page = nullptr;
-  bool exist = page_table_->Find(page_id, page);
-
-  if (exist == true) {
-    // Pin the page
-    SetPagePin(page);
-    return page;
-  } 
-
-  if (free_list_->empty()) {
-    bool success = replacer_->Victim(page);
-    // replacer is empty(), all page in the buffer pool is pinned.
-    if (success == false) {
-      return nullptr;
-    }
-    if (page->is_dirty_) {
-      disk_manager_->WritePage(page->page_id_, page->GetData());
-      replacer_->Erase(page);
-    }
-  } else {
-    page = free_list_->back();
-    free_list_->pop_back();
-  }
-
-  page_table_->Insert(page_id, page);
-  disk_manager_->ReadPage(page_id, page->GetData());
-  InitPageMetadata(page_id, page);
-  return page;
+  return GetInstance(page_id)->FetchPage(page_id);
 }
 
 /*
- * Implementation of unpin page
- * if pin_count>0, decrement it and if it becomes zero, put it back to
- * replacer if pin_count<=0 before this call, return false. is_dirty: set the
- * dirty flag of this page
+ * Unpin the page in its partition, see BufferPoolInstance::UnpinPage
  */
-bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty)
+bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty,
+                                  lsn_t lsn)
 {
-  std::lock_guard<std::mutex> guard(latch_);
-  Page* page = nullptr;
-  page_table_->Find(page_id, page);
-
-  if (page->pin_count_ > 0) {
-    SetPageUnpin(page);
-    if (page->pin_count_ == 0) {
-      replacer_->Insert(page);
-    }
-    page->is_dirty_ = is_dirty;
-    return true;
-  } 
-  return false;
+  return GetInstance(page_id)->UnpinPage(page_id, is_dirty, lsn);
 }
 
 /*
- * Used to flush a particular page of the buffer pool to disk. Should call the
- * write_page method of the disk manager
+ * Flush a particular page of the buffer pool to disk
  * if page is not found in page table, return false
  * NOTE: make sure page_id != INVALID_PAGE_ID
  */
-bool BufferPoolManager::FlushPage(page_id_t page_id) { 
-  std::lock_guard<std::mutex> guard(latch_);
-  Page* page = nullptr;
-  bool exist = page_table_->Find(page_id, page);
-  if (exist == true) {
-    disk_manager_->WritePage(page_id, page->GetData());
-    page->is_dirty_ = false;
-    return true;
+bool BufferPoolManager::FlushPage(page_id_t page_id) {
+  return GetInstance(page_id)->FlushPage(page_id);
+}
+
+/*
+ * Partition by partition the dirty pages are copied, then written together
+ * so that runs spanning partitions (page_id % N) still coalesce. Pages
+ * deleted before the copies were taken are no longer referenced in them,
+ * they are freed once the copies are on disk
+ */
+size_t BufferPoolManager::FlushAllPages() {
+  std::vector<page_id_t> deleted;
+  {
+    std::lock_guard<std::mutex> guard(deleted_latch_);
+    deleted.swap(deleted_pages_);
+  }
+  std::vector<std::vector<Page *>> pages(instances_.size());
+  std::vector<page_id_t> page_ids;
+  std::vector<char> copies;
+  bool complete = true;
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    complete = instances_[i]->CopyDirtyPages(pages[i], page_ids, copies) &&
+               complete;
+  }
+  size_t page_size = GetPageSize();
+  std::vector<const char *> data;
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    data.push_back(&copies[i * page_size]);
+    // write-ahead rule, as for single pages
+    if (ENABLE_LOGGING && log_manager_ != nullptr) {
+      log_manager_->WaitForPage(page_ids[i], data.back());
+    }
+  }
+  disk_manager_->WritePages(page_ids.data(), data.data(), page_ids.size());
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    instances_[i]->EndFlush(pages[i]);
+  }
+  // a page written by someone else meanwhile may be older than the delete
+  if (!complete) {
+    std::lock_guard<std::mutex> guard(deleted_latch_);
+    deleted_pages_.insert(deleted_pages_.end(), deleted.begin(),
+                          deleted.end());
+    return page_ids.size();
+  }
+  for (page_id_t page_id : deleted) {
+    disk_manager_->DeallocatePage(page_id);
+  }
+  if (!deleted.empty() && !free_space_map_recorded_) {
+    RecordFreeSpaceMap();
+  }
+  return page_ids.size();
+}
+
+void BufferPoolManager::GetDirtyPages(
+    std::vector<std::pair<page_id_t, lsn_t>> &pages) {
+  for (auto instance : instances_) {
+    instance->GetDirtyPages(pages);
   }
-  return false;
 }
 
 /**
- * User should call this method for deleting a page. This routine will call
- * disk manager to deallocate the page. First, if page is found within page
- * table, buffer pool manager should be reponsible for removing this entry out
- * of page table, reseting page metadata and adding back to free list. Second,
- * call disk manager's DeallocatePage() method to delete from disk file. If
- * the page is found within page table, but pin_count != 0, return false
+ * User should call this method for deleting a page. The page is removed from
+ * its partition, disk manager's DeallocatePage() is called for it by the next
+ * FlushAllPages(). If the page is still pinned, return false
  */
 bool BufferPoolManager::DeletePage(page_id_t page_id) {
-  std::lock_guard<std::mutex> guard(latch_);
-  Page* page = nullptr;
-  bool exist = page_table_->Find(page_id, page);
-  if (exist == true) {
-    if (page->pin_count_ != 0) {
-      return false;
-    }
-    page_table_->Remove(page_id);
-    ResetPageMetadata(page);
-    free_list_->push_back(page);
-    disk_manager_->DeallocatePage(page_id);
+  if (!GetInstance(page_id)->DeletePage(page_id)) {
+    return false;
+  }
+  bool flush;
+  {
+    std::lock_guard<std::mutex> guard(deleted_latch_);
+    deleted_pages_.push_back(page_id);
+    flush = deleted_pages_.size() >= pool_size_;
   }
-  return false; 
-   
+  if (flush) {
+    FlushAllPages();
+  }
+  return true;
+}
+
+/*
+ * The first deallocation creates the free-space bitmap, the header page must
+ * point to it for the free pages to be found after a restart. Given up if
+ * page 0 is not an initialised header page, as in tests using it for data
+ */
+void BufferPoolManager::RecordFreeSpaceMap() {
+  page_id_t map_page_id = disk_manager_->GetFreeSpaceMapPageId();
+  if (map_page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  HeaderPage *header_page =
+      static_cast<HeaderPage *>(FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    return;
+  }
+  bool recorded = false;
+  if (header_page->GetRecordedPageSize() == GetPageSize()) {
+    recorded = header_page->InsertRecord(FREE_SPACE_MAP_RECORD, map_page_id) ||
+               header_page->UpdateRecord(FREE_SPACE_MAP_RECORD, map_page_id);
+  }
+  UnpinPage(HEADER_PAGE_ID, recorded);
+  free_space_map_recorded_ = true;
 }
 
 /**
  * User should call this method if needs to create a new page. This routine
- * will call disk manager to allocate a page.
- * Buffer pool manager should be responsible to choose a victim page either
- * from free list or lru replacer(NOTE: always choose from free list first), 
- * update new page's metadata, zero out memory and add corresponding entry
- * into page table. return nullptr if all the pages in pool are pinned
- */
-Page *BufferPoolManager::NewPage(page_id_t &page_id) {
-  Page* page = nullptr;
-  if (free_list_->empty()) {
-    bool success = replacer_->Victim(page);
-    // all the page in pool are pinned
-    if (success == false) {
-      return nullptr;
+ * will call disk manager to allocate a page and place it in the partition
+ * owning the new page id. return nullptr if all the pages in that partition
+ * are pinned, the allocated page id is handed back to the disk manager
+ */
+Page *BufferPoolManager::NewPage(page_id_t &page_id, page_id_t near_page_id) {
+  page_id_t new_page_id;
+  if (numa_nodes_ > 1 && near_page_id == INVALID_PAGE_ID) {
+    // a free page a partition on the caller's node caches
+    int node = Numa::CurrentNode();
+    new_page_id = disk_manager_->AllocatePage(
+        INVALID_PAGE_ID, [this, node](page_id_t candidate) {
+          return GetInstance(candidate)->GetNumaNode() == node;
+        });
+  } else {
+    new_page_id = disk_manager_->AllocatePage(near_page_id);
+  }
+  // read-only database
+  if (new_page_id == INVALID_PAGE_ID) {
+    return nullptr;
+  }
+  Page *page = GetInstance(new_page_id)->NewPage(new_page_id);
+  if (page == nullptr) {
+    disk_manager_->DeallocatePage(new_page_id);
+    return nullptr;
+  }
+  page_id = new_page_id;
+  return page;
+}
+
+/*
+ * Queue a prefetch hint. At most pool_size_ hints are pending, more would
+ * only evict pages read ahead earlier, fewer while memory is tight. A frame being read in cannot be handed
+ * out, so at most a quarter of the pool is read ahead at once; hints wait for
+ * the reads before them then
+ */
+void BufferPoolManager::Prefetch(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(prefetch_latch_);
+  if (prefetch_queue_.size() >= prefetch_depth_.load()) {
+    return;
+  }
+  if (prefetch_thread_ == nullptr) {
+    prefetch_running_ = true;
+    prefetch_thread_ = new std::thread([this] {
+      std::unique_lock<std::mutex> lock(prefetch_latch_);
+      while (true) {
+        prefetch_cv_.wait(lock, [this] {
+          return !prefetch_running_ ||
+                 (!prefetch_queue_.empty() &&
+                  prefetch_inflight_ < std::max<size_t>(1, pool_size_ / 4));
+        });
+        if (!prefetch_running_) {
+          return;
+        }
+        page_id_t next_page_id = prefetch_queue_.front();
+        prefetch_queue_.pop_front();
+        ++prefetch_inflight_;
+        lock.unlock();
+        if (!GetInstance(next_page_id)->PrefetchPage(
+                next_page_id, GetDiskScheduler(),
+                [this] { FinishPrefetchHint(); })) {
+          FinishPrefetchHint();
+        }
+        lock.lock();
+      }
+    });
+  }
+  prefetch_queue_.push_back(page_id);
+  prefetch_cv_.notify_all();
+}
+
+/*
+ * Block until every queued hint has been served
+ */
+void BufferPoolManager::WaitForPrefetch() {
+  std::unique_lock<std::mutex> lock(prefetch_latch_);
+  prefetch_cv_.wait(lock, [this] {
+    return !prefetch_running_ ||
+           (prefetch_queue_.empty() && prefetch_inflight_ == 0);
+  });
+}
+
+void BufferPoolManager::FinishPrefetchHint() {
+  std::lock_guard<std::mutex> guard(prefetch_latch_);
+  // wakes the prefetch thread too, when it waits for a read to finish
+  --prefetch_inflight_;
+  prefetch_cv_.notify_all();
+}
+
+DiskScheduler *BufferPoolManager::GetDiskScheduler() {
+  std::lock_guard<std::mutex> guard(disk_scheduler_latch_);
+  if (disk_scheduler_ == nullptr) {
+    disk_scheduler_ = new DiskScheduler(disk_manager_);
+  }
+  return disk_scheduler_;
+}
+
+/*
+ * Write the resident page ids, hottest first, to file: a count followed by
+ * the ids, all as raw page_id_t. Partitions are interleaved so the hottest
+ * pages of every partition come first
+ */
+bool BufferPoolManager::DumpWorkingSet(const std::string &file_name) {
+  std::vector<std::vector<page_id_t>> resident(instances_.size());
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    instances_[i]->GetResidentPages(resident[i]);
+  }
+  std::vector<page_id_t> page_ids;
+  for (size_t rank = 0; page_ids.size() < pool_size_; ++rank) {
+    bool any = false;
+    for (auto &pages : resident) {
+      if (rank < pages.size()) {
+        page_ids.push_back(pages[rank]);
+        any = true;
+      }
     }
-    // page in replacer is dirty, flush to disk
-    if (page->is_dirty_) {
-      disk_manager_->WritePage(page->page_id_, page->GetData());
+    if (!any) {
+      break;
     }
-  } else {
-    page = free_list_->back();
-    free_list_->pop_back();
   }
 
-  // remove from page_table_
-  page_table_->Remove(page->page_id_);
+  std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    return false;
+  }
+  int32_t count = static_cast<int32_t>(page_ids.size());
+  out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  out.write(reinterpret_cast<const char *>(page_ids.data()),
+            page_ids.size() * sizeof(page_id_t));
+  return out.good();
+}
+
+/*
+ * Read back a file written by DumpWorkingSet and prefetch the hottest pages
+ * that fit. They go in coldest first, as the replacer had them, so the
+ * hottest are the last to be evicted again; in batches no deeper than the
+ * prefetch queue so no hint is dropped. Returns once every page is read,
+ * before the caller admits any traffic
+ */
+bool BufferPoolManager::LoadWorkingSet(const std::string &file_name) {
+  std::ifstream in(file_name, std::ios::binary);
+  if (!in.is_open()) {
+    return false;
+  }
+  int32_t count = 0;
+  in.read(reinterpret_cast<char *>(&count), sizeof(count));
+  if (!in.good() || count < 0) {
+    return false;
+  }
+  std::vector<page_id_t> page_ids(
+      std::min(static_cast<size_t>(count), pool_size_));
+  in.read(reinterpret_cast<char *>(page_ids.data()),
+          page_ids.size() * sizeof(page_id_t));
+  if (!in.good()) {
+    return false;
+  }
+
+  std::reverse(page_ids.begin(), page_ids.end());
+  size_t batch = std::max<size_t>(1, prefetch_depth_.load());
+  for (size_t begin = 0; begin < page_ids.size(); begin += batch) {
+    size_t end = std::min(begin + batch, page_ids.size());
+    for (size_t i = begin; i < end; ++i) {
+      Prefetch(page_ids[i]);
+    }
+    WaitForPrefetch();
+  }
+  return true;
+}
+
+void BufferPoolManager::PrefetchRange(page_id_t first_page_id,
+                                      size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    Prefetch(first_page_id + static_cast<page_id_t>(i));
+  }
+}
+
+/*
+ * Start the background page cleaner. Every round visits each partition once,
+ * see BufferPoolInstance::CleanColdPages
+ */
+void BufferPoolManager::RunPageCleaner(double low_watermark,
+                                       double high_watermark,
+                                       TaskScheduler *scheduler) {
+  assert(0 <= low_watermark && low_watermark <= high_watermark &&
+         high_watermark <= 1);
+  if (cleaner_running_) {
+    return;
+  }
+  cleaner_running_ = true;
+  DiskScheduler *disk_scheduler = GetDiskScheduler();
+  if (scheduler != nullptr) {
+    // partitions are cleaned side by side by whichever workers are free
+    scheduler_ = scheduler;
+    for (auto instance : instances_) {
+      size_t size = instance->GetPoolSize();
+      size_t low = static_cast<size_t>(low_watermark * size);
+      size_t high = static_cast<size_t>(high_watermark * size);
+      cleaner_tasks_.push_back(scheduler->SchedulePeriodic(
+          [instance, low, high, disk_scheduler] {
+            instance->CleanColdPages(low, high, disk_scheduler);
+          },
+          PAGE_CLEANER_TIMEOUT));
+    }
+    return;
+  }
+  // node -1 cleans every partition
+  int nodes = numa_nodes_ > 1 ? numa_nodes_ : 1;
+  for (int i = 0; i < nodes; ++i) {
+    int node = numa_nodes_ > 1 ? i : -1;
+    cleaner_threads_.push_back(new std::thread([this, low_watermark,
+                                                high_watermark,
+                                                disk_scheduler, node] {
+      Numa::PinThread(node);
+      while (cleaner_running_) {
+        for (auto instance : instances_) {
+          if (node != -1 && instance->GetNumaNode() != node) {
+            continue;
+          }
+          size_t size = instance->GetPoolSize();
+          instance->CleanColdPages(static_cast<size_t>(low_watermark * size),
+                                   static_cast<size_t>(high_watermark * size),
+                                   disk_scheduler);
+        }
+        std::unique_lock<std::mutex> lock(cleaner_latch_);
+        cleaner_cv_.wait_for(lock, PAGE_CLEANER_TIMEOUT,
+                             [this] { return !cleaner_running_; });
+      }
+    }));
+  }
+}
 
-  page_id = disk_manager_->AllocatePage();
-  InitPageMetadata(page_id, page);
-  page->ResetMemory();
-  page_table_->Insert(page_id, page);
-  return page; 
+/*
+ * Stop and join the page cleaner, dirty pages left are written on eviction
+ */
+void BufferPoolManager::StopPageCleaner() {
+  if (scheduler_ != nullptr) {
+    for (auto task : cleaner_tasks_) {
+      scheduler_->Cancel(task);
+    }
+    cleaner_tasks_.clear();
+    scheduler_ = nullptr;
+    cleaner_running_ = false;
+    return;
+  }
+  if (cleaner_threads_.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(cleaner_latch_);
+    cleaner_running_ = false;
+  }
+  cleaner_cv_.notify_all();
+  for (auto thread : cleaner_threads_) {
+    thread->join();
+    delete thread;
+  }
+  cleaner_threads_.clear();
+}
+
+/*
+ * Partitions are read one after the other, the sum is not an atomic cut
+ * across partitions but every counter in it is exact
+ */
+BufferPoolStats BufferPoolManager::GetStats() const {
+  BufferPoolStats stats;
+  for (auto instance : instances_) {
+    stats += instance->GetStats();
+  }
+  return stats;
+}
+
+CompressedCacheStats BufferPoolManager::GetCompressedCacheStats() const {
+  if (compressed_cache_ == nullptr) {
+    return CompressedCacheStats();
+  }
+  return compressed_cache_->GetStats();
+}
+
+void BufferPoolManager::ResetStats() {
+  for (auto instance : instances_) {
+    instance->ResetStats();
+  }
+  if (compressed_cache_ != nullptr) {
+    compressed_cache_->ResetStats();
+  }
 }
 } // namespace cmudb
@@ -0,0 +1,50 @@
+#include "buffer/buffer_pool_set.h"
+
+namespace cmudb
+{
+
+BufferPoolSet::BufferPoolSet(DiskManager *disk_manager,
+                             LogManager *log_manager)
+    : disk_manager_(disk_manager), log_manager_(log_manager) {}
+
+/*
+ * Later pools forward header page accesses to the first one, so they go
+ * first
+ */
+BufferPoolSet::~BufferPoolSet()
+{
+  for (auto iter = pools_.rbegin(); iter != pools_.rend(); ++iter)
+  {
+    delete iter->second;
+  }
+}
+
+BufferPoolManager *BufferPoolSet::AddPool(const std::string &name,
+                                          size_t pool_size,
+                                          ReplacerType replacer_type,
+                                          size_t num_instances,
+                                          bool numa_aware)
+{
+  if (GetPool(name) != nullptr) {
+    return nullptr;
+  }
+  BufferPoolManager *pool = new BufferPoolManager(
+      pool_size, disk_manager_, log_manager_, num_instances, replacer_type,
+      FrameAllocation::ALIGNED, 0, numa_aware);
+  if (!pools_.empty()) {
+    pool->SetHeaderPagePool(pools_.front().second);
+  }
+  pools_.emplace_back(name, pool);
+  return pool;
+}
+
+BufferPoolManager *BufferPoolSet::GetPool(const std::string &name) const
+{
+  for (auto &pool : pools_) {
+    if (pool.first == name) {
+      return pool.second;
+    }
+  }
+  return nullptr;
+}
+} // namespace cmudb
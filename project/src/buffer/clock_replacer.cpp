@@ -0,0 +1,108 @@
+/**
+ * CLOCK implementation
+ */
+#include <cassert>
+
+#include "buffer/clock_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+ClockReplacer<T>::ClockReplacer(size_t num_frames)
+    : frames_(num_frames), evictable_(num_frames, 0),
+      reference_(num_frames, 0), hand_(0), size_(0) {}
+
+template <typename T> ClockReplacer<T>::~ClockReplacer() {}
+
+/*
+ * Pages are identified by the frame they occupy
+ */
+template <> size_t ClockReplacer<Page *>::FrameId(Page *const &value) {
+  return value->GetFrameId();
+}
+
+// test only
+template <> size_t ClockReplacer<int>::FrameId(const int &value) {
+  return static_cast<size_t>(value);
+}
+
+/*
+ * Mark value as evictable and give it a second chance
+ */
+template <typename T> void ClockReplacer<T>::Insert(const T &value) {
+  size_t id = FrameId(value);
+  assert(id < frames_.size());
+  if (!evictable_[id]) {
+    frames_[id] = value;
+    evictable_[id] = 1;
+    ++size_;
+  }
+  reference_[id] = 1;
+}
+
+/* Sweep the clock hand, clearing reference bits, until an evictable frame
+ * with a cleared bit is found. Return false if nothing is evictable
+ */
+template <typename T> bool ClockReplacer<T>::Victim(T &value) {
+  if (size_ == 0) {
+    return false;
+  }
+
+  // at most two full rounds: the first one may only clear reference bits
+  while (true) {
+    size_t id = hand_;
+    hand_ = (hand_ + 1) % frames_.size();
+    if (!evictable_[id]) {
+      continue;
+    }
+    if (reference_[id]) {
+      reference_[id] = 0;
+      continue;
+    }
+    evictable_[id] = 0;
+    --size_;
+    value = frames_[id];
+    return true;
+  }
+}
+
+/*
+ * Remove value from CLOCK. If removal is successful, return true, otherwise
+ * return false
+ */
+template <typename T> bool ClockReplacer<T>::Erase(const T &value) {
+  size_t id = FrameId(value);
+  if (id >= frames_.size() || !evictable_[id]) {
+    return false;
+  }
+  evictable_[id] = 0;
+  reference_[id] = 0;
+  --size_;
+  return true;
+}
+
+template <typename T> size_t ClockReplacer<T>::Size() { return size_; }
+
+/*
+ * Frames ahead of the hand whose reference bit is cleared go first, then the
+ * ones that still have their second chance
+ */
+template <typename T>
+void ClockReplacer<T>::PeekVictims(size_t n, std::vector<T> &values) {
+  for (int referenced = 0; referenced < 2; ++referenced) {
+    for (size_t i = 0; i < frames_.size() && n > 0; ++i) {
+      size_t id = (hand_ + i) % frames_.size();
+      if (evictable_[id] && reference_[id] == referenced) {
+        values.push_back(frames_[id]);
+        --n;
+      }
+    }
+  }
+}
+
+template class ClockReplacer<Page *>;
+// test only
+template class ClockReplacer<int>;
+
+} // namespace cmudb
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include "buffer/compressed_page_cache.h"
+#include "common/memory_tracker.h"
+
+namespace cmudb {
+
+namespace {
+// shortest back reference worth encoding
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 65535;
+const int HASH_BITS = 12;
+
+inline uint32_t Load32(const char *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// lengths that do not fit a nibble continue in 255-valued bytes
+inline void PutLength(std::vector<char> &out, size_t length) {
+  while (length >= 255) {
+    out.push_back(static_cast<char>(255));
+    length -= 255;
+  }
+  out.push_back(static_cast<char>(length));
+}
+
+inline bool GetLength(const unsigned char *src, size_t length, size_t &pos,
+                      size_t &value) {
+  unsigned char byte;
+  do {
+    if (pos >= length) {
+      return false;
+    }
+    byte = src[pos++];
+    value += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// a literal run, then a back reference unless match_length is 0
+void PutSequence(std::vector<char> &out, const char *literals,
+                 size_t literal_length, size_t match_length, size_t offset) {
+  size_t match_code = match_length == 0 ? 0 : match_length - MIN_MATCH;
+  unsigned char token = static_cast<unsigned char>(
+      (std::min<size_t>(literal_length, 15) << 4) |
+      std::min<size_t>(match_code, 15));
+  out.push_back(static_cast<char>(token));
+  if (literal_length >= 15) {
+    PutLength(out, literal_length - 15);
+  }
+  out.insert(out.end(), literals, literals + literal_length);
+  if (match_length == 0) {
+    return;
+  }
+  out.push_back(static_cast<char>(offset & 0xff));
+  out.push_back(static_cast<char>(offset >> 8));
+  if (match_code >= 15) {
+    PutLength(out, match_code - 15);
+  }
+}
+} // namespace
+
+CompressedPageCache::CompressedPageCache(size_t capacity_bytes)
+    : capacity_(capacity_bytes), memory_(0) {
+  elastic_ = MemoryTracker::Instance().RegisterElastic(
+      ElasticPriority::COMPRESSED_CACHE,
+      [this](size_t bytes) { return Shrink(bytes); });
+}
+
+CompressedPageCache::~CompressedPageCache() {
+  MemoryTracker::Instance().UnregisterElastic(elastic_);
+  MemoryTracker::Instance().Release(MemoryConsumer::COMPRESSED_CACHE,
+                                    memory_);
+}
+
+/*
+ * Greedy LZ77: a hash of the next 4 bytes finds the last position they
+ * occurred at, matches are extended as far as they go. The last sequence
+ * carries literals only
+ */
+bool CompressedPageCache::Compress(const char *src, size_t size,
+                                   std::vector<char> &out) {
+  size_t start = out.size();
+  int table[1 << HASH_BITS];
+  std::fill(table, table + (1 << HASH_BITS), -1);
+  size_t anchor = 0;
+  size_t pos = 0;
+  while (pos + MIN_MATCH <= size) {
+    uint32_t sequence = Load32(src + pos);
+    uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+    int candidate = table[hash];
+    table[hash] = static_cast<int>(pos);
+    if (candidate < 0 || pos - candidate > MAX_OFFSET ||
+        Load32(src + candidate) != sequence) {
+      ++pos;
+      continue;
+    }
+    size_t match_length = MIN_MATCH;
+    while (pos + match_length < size &&
+           src[candidate + match_length] == src[pos + match_length]) {
+      ++match_length;
+    }
+    PutSequence(out, src + anchor, pos - anchor, match_length,
+                pos - candidate);
+    pos += match_length;
+    anchor = pos;
+    if (out.size() - start >= size) {
+      out.resize(start);
+      return false;
+    }
+  }
+  PutSequence(out, src + anchor, size - anchor, 0, 0);
+  if (out.size() - start >= size) {
+    out.resize(start);
+    return false;
+  }
+  return true;
+}
+
+bool CompressedPageCache::Decompress(const char *src, size_t length, char *dst,
+                                     size_t size) {
+  const unsigned char *in = reinterpret_cast<const unsigned char *>(src);
+  size_t pos = 0;
+  size_t written = 0;
+  while (pos < length) {
+    unsigned char token = in[pos++];
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !GetLength(in, length, pos, literal_length)) {
+      return false;
+    }
+    if (pos + literal_length > length || written + literal_length > size) {
+      return false;
+    }
+    memcpy(dst + written, src + pos, literal_length);
+    pos += literal_length;
+    written += literal_length;
+    if (pos == length) {
+      break;
+    }
+
+    if (pos + 2 > length) {
+      return false;
+    }
+    size_t offset = in[pos] | (static_cast<size_t>(in[pos + 1]) << 8);
+    pos += 2;
+    size_t match_length = token & 15;
+    if (match_length == 15 && !GetLength(in, length, pos, match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > written || written + match_length > size) {
+      return false;
+    }
+    // byte by byte, a reference may overlap the bytes it produces
+    for (size_t i = 0; i < match_length; ++i, ++written) {
+      dst[written] = dst[written - offset];
+    }
+  }
+  return written == size;
+}
+
+/*
+ * Compression runs before latch_ is taken, only the list update is serial
+ */
+bool CompressedPageCache::Put(page_id_t page_id, const char *data,
+                              size_t page_size) {
+  std::vector<char> compressed;
+  bool shrunk = Compress(data, page_size, compressed);
+
+  std::lock_guard<std::mutex> guard(latch_);
+  auto iter = index_.find(page_id);
+  if (iter != index_.end()) {
+    RemoveEntry(iter->second);
+  }
+  // the tier only grows into memory the budget has spare
+  if (!shrunk || compressed.size() > capacity_ ||
+      !MemoryTracker::Instance().TryGrow(MemoryConsumer::COMPRESSED_CACHE,
+                                         compressed.size())) {
+    ++stats_.rejections;
+    return false;
+  }
+  memory_ += compressed.size();
+  entries_.push_front(Entry{page_id, std::move(compressed)});
+  index_[page_id] = entries_.begin();
+  ++stats_.insertions;
+  while (memory_ > capacity_) {
+    RemoveEntry(std::prev(entries_.end()));
+    ++stats_.evictions;
+  }
+  return true;
+}
+
+bool CompressedPageCache::Get(page_id_t page_id, char *data,
+                              size_t page_size) {
+  std::vector<char> compressed;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    auto iter = index_.find(page_id);
+    if (iter == index_.end()) {
+      ++stats_.misses;
+      return false;
+    }
+    auto entry = iter->second;
+    compressed = std::move(entry->data_);
+    memory_ -= compressed.size();
+    index_.erase(iter);
+    entries_.erase(entry);
+    ++stats_.hits;
+    MemoryTracker::Instance().Release(MemoryConsumer::COMPRESSED_CACHE,
+                                      compressed.size());
+  }
+  return Decompress(compressed.data(), compressed.size(), data, page_size);
+}
+
+void CompressedPageCache::Erase(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto iter = index_.find(page_id);
+  if (iter != index_.end()) {
+    RemoveEntry(iter->second);
+  }
+}
+
+CompressedCacheStats CompressedPageCache::GetStats() {
+  std::lock_guard<std::mutex> guard(latch_);
+  CompressedCacheStats stats = stats_;
+  stats.entries = entries_.size();
+  stats.memory_bytes = memory_;
+  stats.capacity_bytes = capacity_;
+  return stats;
+}
+
+void CompressedPageCache::ResetStats() {
+  std::lock_guard<std::mutex> guard(latch_);
+  stats_ = CompressedCacheStats();
+}
+
+void CompressedPageCache::RemoveEntry(std::list<Entry>::iterator iter) {
+  memory_ -= iter->data_.size();
+  MemoryTracker::Instance().Release(MemoryConsumer::COMPRESSED_CACHE,
+                                    iter->data_.size());
+  index_.erase(iter->page_id_);
+  entries_.erase(iter);
+}
+
+size_t CompressedPageCache::Shrink(size_t bytes) {
+  std::lock_guard<std::mutex> guard(latch_);
+  size_t freed = 0;
+  while (freed < bytes && !entries_.empty()) {
+    auto oldest = std::prev(entries_.end());
+    freed += oldest->data_.size();
+    RemoveEntry(oldest);
+    ++stats_.evictions;
+  }
+  return freed;
+}
+} // namespace cmudb
@@ -0,0 +1,72 @@
+/**
+ * frame_region.cpp
+ */
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "buffer/frame_region.h"
+#include "common/logger.h"
+#include "common/numa.h"
+
+namespace cmudb {
+
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+FrameRegion::FrameRegion(size_t size, FrameAllocation allocation,
+                         int numa_node)
+    : data_(nullptr), mapped_size_(0), allocation_(allocation) {
+  if (allocation_ == FrameAllocation::HUGE_PAGE) {
+    size_t mapped_size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE *
+                         HUGE_PAGE_SIZE;
+    // reserved huge pages first, then transparent huge pages
+    void *data = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data == MAP_FAILED) {
+      data = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (data != MAP_FAILED) {
+        madvise(data, mapped_size, MADV_HUGEPAGE);
+      }
+    }
+    if (data != MAP_FAILED) {
+      // anonymous mappings are zero-filled
+      Numa::BindMemory(data, mapped_size, numa_node);
+      data_ = static_cast<char *>(data);
+      mapped_size_ = mapped_size;
+      return;
+    }
+    LOG_DEBUG("huge page mapping failed, using aligned frames");
+    allocation_ = FrameAllocation::ALIGNED;
+  }
+
+  if (allocation_ == FrameAllocation::ALIGNED) {
+    void *data = nullptr;
+    size_t alignment = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (posix_memalign(&data, alignment, size) == 0) {
+      data_ = static_cast<char *>(data);
+      // the memset faults the pages in, on the node
+      Numa::BindMemory(data_, size, numa_node);
+      memset(data_, 0, size);
+      return;
+    }
+    LOG_DEBUG("aligned allocation failed, using heap frames");
+    allocation_ = FrameAllocation::HEAP;
+  }
+
+  data_ = new char[size]();
+}
+
+FrameRegion::~FrameRegion() {
+  if (mapped_size_ != 0) {
+    munmap(data_, mapped_size_);
+  } else if (allocation_ == FrameAllocation::ALIGNED) {
+    free(data_);
+  } else {
+    delete[] data_;
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,83 @@
+/**
+ * LRU-K implementation
+ */
+#include <cassert>
+
+#include "buffer/lru_k_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+LRUKReplacer<T>::LRUKReplacer(size_t k)
+    : k_(k), current_timestamp_(0) {
+  assert(k_ > 0);
+}
+
+template <typename T> LRUKReplacer<T>::~LRUKReplacer() {}
+
+/*
+ * Record one access of value and make it evictable
+ */
+template <typename T> void LRUKReplacer<T>::Insert(const T &value) {
+  History &history = history_[value];
+  if (history.evictable_) {
+    evictable_.erase(RankOf(history));
+  }
+  history.accesses_.push_back(current_timestamp_++);
+  if (history.accesses_.size() > k_) {
+    history.accesses_.pop_front();
+  }
+  history.evictable_ = true;
+  evictable_.emplace(RankOf(history), value);
+}
+
+/* Evict the value with the largest backward K-distance. Values with fewer
+ * than K accesses are preferred, ties broken by their oldest access. Return
+ * false if nothing is evictable
+ */
+template <typename T> bool LRUKReplacer<T>::Victim(T &value) {
+  if (evictable_.empty()) {
+    return false;
+  }
+  auto victim = evictable_.begin();
+  value = victim->second;
+  evictable_.erase(victim);
+  history_.erase(value);
+  return true;
+}
+
+/*
+ * Remove value from the evictable set. If removal is successful, return true,
+ * otherwise return false
+ */
+template <typename T> bool LRUKReplacer<T>::Erase(const T &value) {
+  auto iter = history_.find(value);
+  if (iter == history_.end() || !iter->second.evictable_) {
+    return false;
+  }
+  iter->second.evictable_ = false;
+  evictable_.erase(RankOf(iter->second));
+  return true;
+}
+
+template <typename T> size_t LRUKReplacer<T>::Size() {
+  return evictable_.size();
+}
+
+/*
+ * Evictable values ordered the way Victim would pick them
+ */
+template <typename T>
+void LRUKReplacer<T>::PeekVictims(size_t n, std::vector<T> &values) {
+  for (auto iter = evictable_.begin(); iter != evictable_.end() && n > 0;
+       ++iter, --n) {
+    values.push_back(iter->second);
+  }
+}
+
+template class LRUKReplacer<Page *>;
+// test only
+template class LRUKReplacer<int>;
+
+} // namespace cmudb
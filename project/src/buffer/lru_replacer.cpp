@@ -57,6 +57,17 @@ template <typename T> bool LRUReplacer<T>::Erase(const T &value) {
 
 template <typename T> size_t LRUReplacer<T>::Size() { return list_.size(); }
 
+/*
+ * Walk LRU from its cold end
+ */
+template <typename T>
+void LRUReplacer<T>::PeekVictims(size_t n, std::vector<T> &values) {
+  for (auto iter = list_.rbegin(); iter != list_.rend() && n > 0;
+       ++iter, --n) {
+    values.push_back(*iter);
+  }
+}
+
 template class LRUReplacer<Page *>;
 // test only
 template class LRUReplacer<int>;
@@ -0,0 +1,123 @@
+/**
+ * catalog.cpp
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "catalog/catalog.h"
+#include "common/exception.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+void Catalog::Load() {
+  latch_.WLock();
+  LoadLocked();
+  latch_.WUnlock();
+}
+
+/*
+ * Not loaded while page 0 is not an initialised header page yet, as for a
+ * new database before its header page is made
+ */
+void Catalog::LoadLocked() {
+  if (loaded_) {
+    return;
+  }
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    return;
+  }
+  page_id_t root_page_id = INVALID_PAGE_ID;
+  header_page->RLatch();
+  bool initialised = header_page->GetRecordedPageSize() ==
+                     buffer_pool_manager_->GetPageSize();
+  if (initialised && !header_page->GetRootId(CATALOG_RECORD, root_page_id)) {
+    root_page_id = INVALID_PAGE_ID;
+  }
+  header_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  if (!initialised) {
+    return;
+  }
+
+  tree_.reset(new VarKeyTree(CATALOG_RECORD, buffer_pool_manager_,
+                             root_page_id));
+  std::string first;
+  std::vector<RID> roots;
+  std::vector<std::string> names;
+  tree_->Scan(VarKey(first), SIZE_MAX, roots, &names);
+  for (size_t i = 0; i < names.size(); ++i) {
+    roots_[names[i]] = roots[i].GetPageId();
+  }
+  loaded_ = true;
+}
+
+page_id_t Catalog::GetRoot(const std::string &name) {
+  if (!loaded_) {
+    Load();
+  }
+  latch_.RLock();
+  auto it = roots_.find(name);
+  if (it != roots_.end()) {
+    page_id_t page_id = it->second;
+    latch_.RUnlock();
+    return page_id;
+  }
+  latch_.RUnlock();
+
+  page_id_t page_id = INVALID_PAGE_ID;
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    return INVALID_PAGE_ID;
+  }
+  header_page->RLatch();
+  if (!header_page->GetRootId(name, page_id)) {
+    page_id = INVALID_PAGE_ID;
+  }
+  header_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  return page_id;
+}
+
+void Catalog::SetRoot(const std::string &name, page_id_t page_id) {
+  latch_.WLock();
+  LoadLocked();
+  if (!loaded_) {
+    latch_.WUnlock();
+    throw Exception(EXCEPTION_TYPE_CATALOG, "no header page");
+  }
+  if (static_cast<int>(name.size()) > tree_->GetMaxKeySize()) {
+    latch_.WUnlock();
+    throw Exception(EXCEPTION_TYPE_CATALOG, "name too long: " + name);
+  }
+  VarKey key(name);
+  tree_->Remove(key);
+  tree_->Insert(key, RID(page_id, 0));
+  roots_[name] = page_id;
+  latch_.WUnlock();
+}
+
+void Catalog::Flush() {
+  latch_.RLock();
+  if (tree_ != nullptr) {
+    tree_->Flush();
+  }
+  latch_.RUnlock();
+  buffer_pool_manager_->FlushPage(HEADER_PAGE_ID);
+}
+
+size_t Catalog::GetSize() {
+  if (!loaded_) {
+    Load();
+  }
+  latch_.RLock();
+  size_t size = roots_.size();
+  latch_.RUnlock();
+  return size;
+}
+
+} // namespace cmudb
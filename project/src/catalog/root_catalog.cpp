@@ -0,0 +1,146 @@
+/**
+ * root_catalog.cpp
+ */
+
+#include <utility>
+#include <vector>
+
+#include "catalog/root_catalog.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+page_id_t RootCatalog::GetRoot(const std::string &name, uint64_t *version) {
+  std::lock_guard<std::mutex> guard(latch_);
+  IndexRoot &root = Find(name);
+  if (version != nullptr) {
+    *version = root.version_;
+  }
+  return root.page_id_;
+}
+
+/*
+ * Any LSN the record gets is at least the next one now
+ */
+void RootCatalog::PrepareSwap() {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (rec_lsn_ == INVALID_LSN) {
+    rec_lsn_ = log_manager_->GetNextLSN();
+  }
+  in_flight_++;
+}
+
+uint64_t RootCatalog::SwapRoot(const std::string &name, page_id_t page_id,
+                               lsn_t lsn) {
+  std::lock_guard<std::mutex> guard(latch_);
+  IndexRoot &root = Find(name);
+  root.page_id_ = page_id;
+  root.lsn_ = lsn;
+  root.dirty_ = true;
+  if (lsn != INVALID_LSN) {
+    in_flight_--;
+  }
+  return ++root.version_;
+}
+
+/*
+ * The roots are taken, written once their records are durable, and clean
+ * afterwards unless swapped again meanwhile. The recLSN goes only when
+ * nothing is left dirty or in flight, otherwise it stays: redoing root
+ * changes from too early on only sets the header page again
+ */
+bool RootCatalog::Flush() {
+  std::vector<std::pair<std::string, IndexRoot>> dirty;
+  lsn_t lsn = INVALID_LSN;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    for (auto &entry : roots_) {
+      if (entry.second.dirty_) {
+        dirty.push_back(entry);
+        if (entry.second.lsn_ != INVALID_LSN &&
+            (lsn == INVALID_LSN || entry.second.lsn_ > lsn)) {
+          lsn = entry.second.lsn_;
+        }
+      }
+    }
+  }
+  if (dirty.empty()) {
+    return true;
+  }
+  if (lsn != INVALID_LSN) {
+    log_manager_->WaitForDurable(lsn);
+  }
+  if (catalog_ != nullptr) {
+    for (auto &entry : dirty) {
+      catalog_->SetRoot(entry.first, entry.second.page_id_);
+    }
+    catalog_->Flush();
+  } else if (!WriteHeaderPage(dirty)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> guard(latch_);
+  bool clean = in_flight_ == 0;
+  for (auto &entry : dirty) {
+    IndexRoot &root = roots_[entry.first];
+    if (root.version_ == entry.second.version_) {
+      root.dirty_ = false;
+    }
+  }
+  for (auto &entry : roots_) {
+    clean = clean && !entry.second.dirty_;
+  }
+  if (clean) {
+    rec_lsn_ = INVALID_LSN;
+  }
+  return true;
+}
+
+bool RootCatalog::WriteHeaderPage(
+    const std::vector<std::pair<std::string, IndexRoot>> &dirty) {
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    return false;
+  }
+  header_page->WLatch();
+  for (auto &entry : dirty) {
+    if (!header_page->UpdateRecord(entry.first, entry.second.page_id_)) {
+      header_page->InsertRecord(entry.first, entry.second.page_id_);
+    }
+  }
+  header_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  buffer_pool_manager_->FlushPage(HEADER_PAGE_ID);
+  return true;
+}
+
+lsn_t RootCatalog::GetRecLSN() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return rec_lsn_;
+}
+
+RootCatalog::IndexRoot &RootCatalog::Find(const std::string &name) {
+  auto it = roots_.find(name);
+  if (it != roots_.end()) {
+    return it->second;
+  }
+  IndexRoot root{INVALID_PAGE_ID, 0, INVALID_LSN, false};
+  if (catalog_ != nullptr) {
+    root.page_id_ = catalog_->GetRoot(name);
+    return roots_.emplace(name, root).first->second;
+  }
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page != nullptr) {
+    header_page->RLatch();
+    if (!header_page->GetRootId(name, root.page_id_)) {
+      root.page_id_ = INVALID_PAGE_ID;
+    }
+    header_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  }
+  return roots_.emplace(name, root).first->second;
+}
+
+} // namespace cmudb
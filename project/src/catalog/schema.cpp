@@ -11,7 +11,8 @@
 namespace cmudb {
 
 // Construct schema from vector of Column
-Schema::Schema(const std::vector<Column> &columns) : tuple_is_inlined(true) {
+Schema::Schema(const std::vector<Column> &columns)
+    : tuple_is_inlined(true), fixed_layout(true) {
   int32_t column_offset = 0;
   for (size_t index = 0; index < columns.size(); index++) {
     Column column = columns[index];
@@ -23,6 +24,12 @@ Schema::Schema(const std::vector<Column> &columns) : tuple_is_inlined(true) {
     // set column offset
     column.column_offset = column_offset;
     column_offset += column.GetFixedLength();
+    comparators.push_back(
+        GetStoredComparator(column.GetType(), column.GetType()));
+    serializers.push_back(GetStoredSerializer(column.GetType()));
+    readers.push_back(GetStoredCaster(column.GetType(), column.GetType()));
+    if (!column.IsInlined() || readers.back() == nullptr)
+      fixed_layout = false;
 
     // add column
     this->columns.push_back(std::move(column));
@@ -4,4 +4,18 @@ namespace cmudb {
   std::atomic<bool> ENABLE_LOGGING(false);  // for virtual table
   std::chrono::duration<long long int> LOG_TIMEOUT =
    std::chrono::seconds(1);
+  std::chrono::microseconds LOG_GROUP_COMMIT_WINDOW =
+   std::chrono::microseconds(100);
+  std::chrono::milliseconds PAGE_CLEANER_TIMEOUT =
+   std::chrono::milliseconds(10);
+  std::chrono::milliseconds CHECKPOINT_TIMEOUT =
+   std::chrono::milliseconds(30000);
+  std::chrono::milliseconds DEADLOCK_DETECTION_INTERVAL =
+   std::chrono::milliseconds(50);
+  std::chrono::milliseconds VERSION_GC_INTERVAL =
+   std::chrono::milliseconds(100);
+  std::chrono::milliseconds SCHEDULER_THROTTLE_INTERVAL =
+   std::chrono::milliseconds(100);
+  std::chrono::microseconds BACKGROUND_LATENCY_TARGET =
+   std::chrono::microseconds(5000);
 }
@@ -0,0 +1,79 @@
+/**
+ * crc32c.cpp
+ */
+#include <cstring>
+
+#include "common/crc32c.h"
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace cmudb {
+
+#if defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)
+static inline uint32_t Crc32cWord(uint32_t crc, uint64_t word) {
+#if defined(__SSE4_2__)
+  return static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+#else
+  return __crc32cd(crc, word);
+#endif
+}
+
+static inline uint32_t Crc32cByte(uint32_t crc, uint8_t byte) {
+#if defined(__SSE4_2__)
+  return _mm_crc32_u8(crc, byte);
+#else
+  return __crc32cb(crc, byte);
+#endif
+}
+
+uint32_t Crc32c(const char *data, size_t length, uint32_t crc) {
+  crc = ~crc;
+  // 8 bytes per instruction, pages are word aligned so the tail is empty
+  for (; length >= sizeof(uint64_t); length -= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc = Crc32cWord(crc, word);
+    data += sizeof(word);
+  }
+  for (; length > 0; --length) {
+    crc = Crc32cByte(crc, static_cast<uint8_t>(*data++));
+  }
+  return ~crc;
+}
+
+bool Crc32cIsHardware() { return true; }
+#else
+namespace {
+// table for the reflected polynomial 0x82f63b78, built on first use
+struct Crc32cTable {
+  uint32_t entries_[256];
+  Crc32cTable() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1)));
+      }
+      entries_[i] = crc;
+    }
+  }
+};
+} // namespace
+
+uint32_t Crc32c(const char *data, size_t length, uint32_t crc) {
+  static const Crc32cTable table;
+  crc = ~crc;
+  for (; length > 0; --length) {
+    crc = table.entries_[(crc ^ static_cast<uint8_t>(*data++)) & 0xff] ^
+          (crc >> 8);
+  }
+  return ~crc;
+}
+
+bool Crc32cIsHardware() { return false; }
+#endif
+
+} // namespace cmudb
@@ -0,0 +1,241 @@
+/**
+ * memory_tracker.cpp
+ */
+#include <algorithm>
+#include <string>
+
+#include "common/memory_tracker.h"
+
+namespace cmudb {
+
+// the thread is in a shrink callback, its allocations must not shrink again
+static thread_local bool shrinking = false;
+
+thread_local MemoryTracker::Credit MemoryTracker::credit_;
+
+MemoryTracker::Credit::~Credit() {
+  MemoryTracker::Publish();
+  if (bytes_ > 0) {
+    MemoryTracker::Instance().total_.fetch_sub(bytes_);
+  }
+}
+
+MemoryTracker &MemoryTracker::Instance() {
+  // never destroyed, the credits of exiting threads go back to it
+  static MemoryTracker *tracker = new MemoryTracker();
+  return *tracker;
+}
+
+const char *MemoryTracker::NameOf(MemoryConsumer consumer) {
+  switch (consumer) {
+  case MemoryConsumer::BUFFER_POOL:
+    return "buffer_pool";
+  case MemoryConsumer::LOG_BUFFER:
+    return "log_buffer";
+  case MemoryConsumer::HASH_TABLE:
+    return "hash_table";
+  case MemoryConsumer::RECOVERY:
+    return "recovery";
+  case MemoryConsumer::LOCK_TABLE:
+    return "lock_table";
+  case MemoryConsumer::TUPLE:
+    return "tuple";
+  case MemoryConsumer::COMPRESSED_CACHE:
+    return "compressed_cache";
+  }
+  return "";
+}
+
+MemoryTracker::MemoryTracker() {
+  for (int i = 0; i < MEMORY_CONSUMERS; ++i) {
+    usage_[i] = Metrics::Instance().GetGauge(
+        std::string("memory.") + NameOf(static_cast<MemoryConsumer>(i)));
+  }
+}
+
+void MemoryTracker::SetBudget(size_t bytes) {
+  budget_.store(bytes);
+  if (bytes != 0 && total_.load() > bytes) {
+    Shrink();
+  } else {
+    GrowIfRelieved();
+  }
+}
+
+bool MemoryTracker::Reserve(MemoryConsumer consumer, size_t bytes) {
+  if (!AcquireSmall(bytes, true, false)) {
+    return false;
+  }
+  Count(consumer, static_cast<int64_t>(bytes));
+  return true;
+}
+
+void MemoryTracker::Charge(MemoryConsumer consumer, size_t bytes) {
+  AcquireSmall(bytes, true, true);
+  Count(consumer, static_cast<int64_t>(bytes));
+}
+
+bool MemoryTracker::TryGrow(MemoryConsumer consumer, size_t bytes) {
+  if (!AcquireSmall(bytes, false, false)) {
+    return false;
+  }
+  Count(consumer, static_cast<int64_t>(bytes));
+  return true;
+}
+
+void MemoryTracker::Release(MemoryConsumer consumer, size_t bytes) {
+  // a shrink must see what it freed
+  if (bytes > MEMORY_CREDIT_SIZE / 4 || shrinking) {
+    usage_[static_cast<int>(consumer)]->Add(-static_cast<int64_t>(bytes));
+    total_.fetch_sub(bytes);
+    return;
+  }
+  Count(consumer, -static_cast<int64_t>(bytes));
+  // keep a credit, give back what is over two
+  credit_.bytes_ += bytes;
+  if (credit_.bytes_ > 2 * MEMORY_CREDIT_SIZE) {
+    total_.fetch_sub(credit_.bytes_ - MEMORY_CREDIT_SIZE);
+    credit_.bytes_ = MEMORY_CREDIT_SIZE;
+    Publish();
+  }
+}
+
+bool MemoryTracker::AcquireSmall(size_t bytes, bool shrink, bool force) {
+  if (bytes > MEMORY_CREDIT_SIZE / 4) {
+    return Acquire(bytes, shrink, force);
+  }
+  if (credit_.bytes_ < bytes) {
+    Publish();
+    // a whole credit if there is room for one, else only what is asked
+    if (!Acquire(MEMORY_CREDIT_SIZE, shrink, false)) {
+      return Acquire(bytes, shrink, force);
+    }
+    credit_.bytes_ += MEMORY_CREDIT_SIZE;
+  }
+  credit_.bytes_ -= bytes;
+  return true;
+}
+
+void MemoryTracker::Count(MemoryConsumer consumer, int64_t bytes) {
+  int i = static_cast<int>(consumer);
+  if (bytes > static_cast<int64_t>(MEMORY_CREDIT_SIZE / 4)) {
+    usage_[i]->Add(bytes);
+  } else {
+    credit_.counts_[i] += bytes;
+  }
+}
+
+void MemoryTracker::Publish() {
+  MemoryTracker &tracker = Instance();
+  for (int i = 0; i < MEMORY_CONSUMERS; ++i) {
+    if (credit_.counts_[i] != 0) {
+      tracker.usage_[i]->Add(credit_.counts_[i]);
+      credit_.counts_[i] = 0;
+    }
+  }
+}
+
+bool MemoryTracker::Acquire(size_t bytes, bool shrink, bool force) {
+  size_t total = total_.fetch_add(bytes) + bytes;
+  size_t budget = budget_.load(std::memory_order_relaxed);
+  if (budget == 0 || total <= budget) {
+    if (shrunk_.load(std::memory_order_relaxed) && total <= budget / 2) {
+      GrowIfRelieved();
+    }
+    return true;
+  }
+  if (shrink && !shrinking) {
+    Shrink();
+    if (total_.load() <= budget) {
+      return true;
+    }
+  }
+  if (force) {
+    return true;
+  }
+  total_.fetch_sub(bytes);
+  refusals_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void MemoryTracker::Shrink() {
+  std::lock_guard<std::mutex> guard(elastic_latch_);
+  size_t budget = budget_.load();
+  if (budget == 0 || total_.load() <= budget) {
+    // another thread shrank them meanwhile
+    return;
+  }
+  shrinking = true;
+  for (auto &elastic : elastic_) {
+    size_t total = total_.load();
+    if (total <= budget) {
+      break;
+    }
+    elastic.shrink_(total - budget);
+  }
+  shrinking = false;
+  shrinks_.fetch_add(1, std::memory_order_relaxed);
+  shrunk_.store(true);
+}
+
+void MemoryTracker::GrowIfRelieved() {
+  if (shrinking || !shrunk_.load()) {
+    return;
+  }
+  // the caller may hold the latch of a consumer a shrink is waiting for
+  std::unique_lock<std::mutex> guard(elastic_latch_, std::try_to_lock);
+  if (!guard.owns_lock()) {
+    return;
+  }
+  size_t budget = budget_.load();
+  if (!shrunk_.load() || (budget != 0 && total_.load() > budget / 2)) {
+    return;
+  }
+  shrinking = true;
+  for (auto &elastic : elastic_) {
+    if (elastic.grow_) {
+      elastic.grow_();
+    }
+  }
+  shrinking = false;
+  shrunk_.store(false);
+}
+
+int MemoryTracker::RegisterElastic(ElasticPriority priority,
+                                   std::function<size_t(size_t)> shrink,
+                                   std::function<void()> grow) {
+  std::lock_guard<std::mutex> guard(elastic_latch_);
+  int handle = next_handle_++;
+  auto it = std::upper_bound(elastic_.begin(), elastic_.end(), priority,
+                             [](ElasticPriority p, const Elastic &e) {
+                               return p < e.priority_;
+                             });
+  elastic_.insert(it, Elastic{handle, priority, std::move(shrink),
+                              std::move(grow)});
+  return handle;
+}
+
+void MemoryTracker::UnregisterElastic(int handle) {
+  std::lock_guard<std::mutex> guard(elastic_latch_);
+  elastic_.erase(std::remove_if(elastic_.begin(), elastic_.end(),
+                                [handle](const Elastic &e) {
+                                  return e.handle_ == handle;
+                                }),
+                 elastic_.end());
+}
+
+MemoryStats MemoryTracker::GetStats() const {
+  Publish();
+  MemoryStats stats;
+  stats.budget = budget_.load();
+  stats.usage = total_.load();
+  for (int i = 0; i < MEMORY_CONSUMERS; ++i) {
+    stats.consumers[i] = static_cast<size_t>(std::max<int64_t>(
+        usage_[i]->Value(), 0));
+  }
+  stats.shrinks = shrinks_.load(std::memory_order_relaxed);
+  stats.refusals = refusals_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+} // namespace cmudb
@@ -0,0 +1,147 @@
+/**
+ * metrics.cpp
+ */
+#include <algorithm>
+
+#include "common/exception.h"
+#include "common/metrics.h"
+
+namespace cmudb {
+
+HdrHistogramSnapshot &HdrHistogramSnapshot::
+operator+=(const HdrHistogramSnapshot &other) {
+  buckets.resize(std::max(buckets.size(), other.buckets.size()));
+  for (size_t i = 0; i < other.buckets.size(); ++i) {
+    buckets[i] += other.buckets[i];
+  }
+  count += other.count;
+  sum += other.sum;
+  max = std::max(max, other.max);
+  return *this;
+}
+
+uint64_t HdrHistogramSnapshot::Percentile(double q) const {
+  uint64_t rank = static_cast<uint64_t>(q * count);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen > rank || (seen == count && seen > 0)) {
+      return std::min(max, HdrHistogram::HighestOf(static_cast<int>(i)));
+    }
+  }
+  return 0;
+}
+
+uint64_t HdrHistogram::LowestOf(int bucket) {
+  if (bucket < SUB_BUCKETS) {
+    return static_cast<uint64_t>(bucket);
+  }
+  int shift = bucket / SUB_BUCKETS - 1;
+  uint64_t sub = SUB_BUCKETS + bucket % SUB_BUCKETS;
+  return sub << shift;
+}
+
+uint64_t HdrHistogram::HighestOf(int bucket) {
+  return bucket == BUCKETS - 1 ? UINT64_MAX : LowestOf(bucket + 1) - 1;
+}
+
+HdrHistogramSnapshot HdrHistogram::Snapshot() const {
+  HdrHistogramSnapshot snapshot;
+  snapshot.buckets.resize(BUCKETS);
+  for (int i = 0; i < METRICS_SHARDS; ++i) {
+    const Shard &shard = shards_[i];
+    for (int j = 0; j < BUCKETS; ++j) {
+      snapshot.buckets[j] += shard.buckets_[j].load(std::memory_order_relaxed);
+    }
+    snapshot.count += shard.count_.load(std::memory_order_relaxed);
+    snapshot.sum += shard.sum_.load(std::memory_order_relaxed);
+    snapshot.max =
+        std::max(snapshot.max, shard.max_.load(std::memory_order_relaxed));
+  }
+  return snapshot;
+}
+
+void HdrHistogram::Reset() {
+  for (int i = 0; i < METRICS_SHARDS; ++i) {
+    Shard &shard = shards_[i];
+    for (auto &bucket : shard.buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    shard.count_.store(0, std::memory_order_relaxed);
+    shard.sum_.store(0, std::memory_order_relaxed);
+    shard.max_.store(0, std::memory_order_relaxed);
+  }
+}
+
+Metrics &Metrics::Instance() {
+  // never destroyed, trace points may fire while the process exits
+  static Metrics *metrics = new Metrics();
+  return *metrics;
+}
+
+template <typename M>
+M *Metrics::Get(const std::string &name, MetricKind kind,
+                std::map<std::string, std::unique_ptr<M>> &metrics) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto registered = kinds_.emplace(name, kind);
+  if (registered.first->second != kind) {
+    throw Exception(EXCEPTION_TYPE_MISMATCH_TYPE,
+                    "metric " + name + " is of another kind");
+  }
+  auto &metric = metrics[name];
+  if (metric == nullptr) {
+    metric.reset(new M());
+  }
+  return metric.get();
+}
+
+Counter *Metrics::GetCounter(const std::string &name) {
+  return Get(name, MetricKind::COUNTER, counters_);
+}
+
+Gauge *Metrics::GetGauge(const std::string &name) {
+  return Get(name, MetricKind::GAUGE, gauges_);
+}
+
+HdrHistogram *Metrics::GetHistogram(const std::string &name) {
+  return Get(name, MetricKind::HISTOGRAM, histograms_);
+}
+
+std::vector<MetricSnapshot>
+Metrics::Snapshot(const std::string &prefix) const {
+  std::lock_guard<std::mutex> guard(latch_);
+  std::vector<MetricSnapshot> snapshot;
+  for (auto it = kinds_.lower_bound(prefix);
+       it != kinds_.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+       ++it) {
+    MetricSnapshot metric;
+    metric.name = it->first;
+    metric.kind = it->second;
+    switch (it->second) {
+    case MetricKind::COUNTER:
+      metric.value = static_cast<int64_t>(counters_.at(it->first)->Value());
+      break;
+    case MetricKind::GAUGE:
+      metric.value = gauges_.at(it->first)->Value();
+      break;
+    case MetricKind::HISTOGRAM:
+      metric.histogram = histograms_.at(it->first)->Snapshot();
+      metric.value = static_cast<int64_t>(metric.histogram.count);
+      break;
+    }
+    snapshot.push_back(std::move(metric));
+  }
+  return snapshot;
+}
+
+void Metrics::Reset() {
+  std::lock_guard<std::mutex> guard(latch_);
+  for (auto &counter : counters_) {
+    counter.second->Reset();
+  }
+  for (auto &histogram : histograms_) {
+    histogram.second->Reset();
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,111 @@
+/**
+ * numa.cpp
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/numa.h"
+
+namespace cmudb {
+
+// from linux/mempolicy.h
+static const int NUMA_MPOL_PREFERRED = 1;
+static const unsigned NUMA_MPOL_MF_MOVE = 1 << 1;
+
+static std::string ReadLine(const std::string &path) {
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+std::vector<int> Numa::ParseList(const std::string &list) {
+  std::vector<int> numbers;
+  size_t pos = 0;
+  while (pos < list.size()) {
+    size_t end = list.find(',', pos);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    std::string range = list.substr(pos, end - pos);
+    size_t dash = range.find('-');
+    if (!range.empty() && range[0] >= '0' && range[0] <= '9') {
+      int first = std::atoi(range.c_str());
+      int last = dash == std::string::npos
+                     ? first
+                     : std::atoi(range.c_str() + dash + 1);
+      for (int i = first; i <= last; ++i) {
+        numbers.push_back(i);
+      }
+    }
+    pos = end + 1;
+  }
+  return numbers;
+}
+
+int Numa::NodeCount() {
+  static const int count = [] {
+    std::vector<int> nodes =
+        ParseList(ReadLine("/sys/devices/system/node/online"));
+    return nodes.empty() ? 1 : nodes.back() + 1;
+  }();
+  return count;
+}
+
+int Numa::CurrentNode() {
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+    return 0;
+  }
+  return static_cast<int>(node);
+}
+
+std::vector<int> Numa::CpusOf(int node) {
+  return ParseList(ReadLine("/sys/devices/system/node/node" +
+                            std::to_string(node) + "/cpulist"));
+}
+
+bool Numa::BindMemory(void *data, size_t size, int node) {
+  if (node < 0 || node >= NodeCount() || NodeCount() == 1) {
+    return false;
+  }
+  uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + page - 1) / page *
+                    page;
+  uintptr_t end = (reinterpret_cast<uintptr_t>(data) + size) / page * page;
+  if (begin >= end) {
+    return false;
+  }
+  unsigned long mask[4] = {};
+  const size_t bits = sizeof(unsigned long) * 8;
+  if (static_cast<size_t>(node) >= sizeof(mask) * 8) {
+    return false;
+  }
+  mask[node / bits] = 1ul << (node % bits);
+  return syscall(SYS_mbind, begin, end - begin, NUMA_MPOL_PREFERRED, mask,
+                 sizeof(mask) * 8, NUMA_MPOL_MF_MOVE) == 0;
+}
+
+bool Numa::PinThread(int node) {
+  if (node < 0 || node >= NodeCount() || NodeCount() == 1) {
+    return false;
+  }
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  for (int cpu : CpusOf(node)) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &cpus);
+    }
+  }
+  if (CPU_COUNT(&cpus) == 0) {
+    return false;
+  }
+  return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+} // namespace cmudb
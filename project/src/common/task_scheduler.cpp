@@ -0,0 +1,308 @@
+/**
+ * task_scheduler.cpp
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include "common/task_scheduler.h"
+
+namespace cmudb {
+
+// the scheduler and worker of the calling thread, for Submit from a task
+static thread_local TaskScheduler *current_scheduler = nullptr;
+static thread_local size_t current_worker = 0;
+
+TaskScheduler::TaskScheduler(size_t threads)
+    : running_background_(0), running_(0),
+      throttle_(std::max<size_t>(1, threads)),
+      throttle_limit_(std::max<size_t>(1, threads)), next_worker_(0),
+      stopped_(false), next_id_(0), probe_target_(0), probe_task_(-1),
+      tasks_(0), steals_(0), throttles_(0) {
+  for (auto &pending : pending_) {
+    pending = 0;
+  }
+  for (size_t i = 0; i < throttle_limit_; ++i) {
+    workers_.emplace_back(new Worker());
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->thread_ = std::thread(&TaskScheduler::RunWorker, this, i);
+  }
+}
+
+TaskScheduler::~TaskScheduler() { Stop(); }
+
+void TaskScheduler::Submit(std::function<void()> task,
+                           TaskPriority priority) {
+  Push(Task{std::move(task), nullptr}, priority);
+}
+
+task_id_t TaskScheduler::SchedulePeriodic(std::function<void()> task,
+                                          std::chrono::milliseconds interval,
+                                          TaskPriority priority) {
+  std::shared_ptr<Periodic> periodic = std::make_shared<Periodic>();
+  periodic->task_ = std::move(task);
+  periodic->interval_ = interval;
+  periodic->priority_ = priority;
+  periodic->due_ = std::chrono::steady_clock::now() + interval;
+  task_id_t id;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    id = next_id_++;
+    periodic_[id] = periodic;
+  }
+  // sleeping workers work out when the next task is due again
+  work_cv_.notify_all();
+  return id;
+}
+
+void TaskScheduler::Cancel(task_id_t id) {
+  std::unique_lock<std::mutex> lock(latch_);
+  auto it = periodic_.find(id);
+  if (it == periodic_.end()) {
+    return;
+  }
+  std::shared_ptr<Periodic> periodic = it->second;
+  periodic_.erase(it);
+  periodic->cancelled_ = true;
+  done_cv_.wait(lock, [&periodic] { return !periodic->queued_; });
+}
+
+void TaskScheduler::WaitIdle() {
+  std::unique_lock<std::mutex> lock(latch_);
+  done_cv_.wait(lock, [this] {
+    return running_ == 0 && pending_[0] == 0 && pending_[1] == 0 &&
+           pending_[2] == 0;
+  });
+}
+
+void TaskScheduler::Stop() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    stopped_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto &worker : workers_) {
+    if (worker->thread_.joinable()) {
+      worker->thread_.join();
+    }
+  }
+  std::lock_guard<std::mutex> guard(latch_);
+  periodic_.clear();
+}
+
+void TaskScheduler::SetThrottle(size_t workers) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    throttle_limit_ = std::min(std::max<size_t>(1, workers), workers_.size());
+    throttle_ = throttle_limit_;
+  }
+  work_cv_.notify_all();
+}
+
+void TaskScheduler::SetLatencyProbe(std::function<uint64_t()> probe,
+                                    uint64_t target) {
+  task_id_t old_task;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    probe_ = probe;
+    probe_target_ = target;
+    old_task = probe_task_;
+    probe_task_ = -1;
+  }
+  Cancel(old_task);
+  if (probe == nullptr) {
+    return;
+  }
+  task_id_t task = SchedulePeriodic([this] { AdjustThrottle(); },
+                                    SCHEDULER_THROTTLE_INTERVAL,
+                                    TaskPriority::HIGH);
+  std::lock_guard<std::mutex> guard(latch_);
+  probe_task_ = task;
+}
+
+TaskSchedulerStats TaskScheduler::GetStats() const {
+  TaskSchedulerStats stats;
+  stats.tasks = tasks_.load(std::memory_order_relaxed);
+  stats.steals = steals_.load(std::memory_order_relaxed);
+  stats.throttles = throttles_.load(std::memory_order_relaxed);
+  stats.threads = workers_.size();
+  stats.throttle = throttle_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+/*
+ * Queue due periodic rounds, run a task, and sleep once none may run until
+ * a task is queued, a slot of the throttle frees up or the next one is due.
+ * Once stopped the queued tasks are run before the worker exits
+ */
+void TaskScheduler::RunWorker(size_t self) {
+  current_scheduler = this;
+  current_worker = self;
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    std::chrono::steady_clock::time_point next_due = QueueDue();
+    lock.unlock();
+    Task task;
+    TaskPriority priority;
+    if (Take(self, task, priority)) {
+      bool skip = false;
+      if (task.periodic_ != nullptr) {
+        std::lock_guard<std::mutex> guard(latch_);
+        skip = task.periodic_->cancelled_ || stopped_;
+      }
+      if (!skip) {
+        task.run_();
+        tasks_.fetch_add(1, std::memory_order_relaxed);
+      }
+      lock.lock();
+      if (task.periodic_ != nullptr) {
+        task.periodic_->queued_ = false;
+        task.periodic_->due_ =
+            std::chrono::steady_clock::now() + task.periodic_->interval_;
+      }
+      if (priority != TaskPriority::HIGH) {
+        --running_background_;
+      }
+      --running_;
+      done_cv_.notify_all();
+      // a throttled task may run now
+      work_cv_.notify_one();
+      continue;
+    }
+    lock.lock();
+    if (stopped_ && pending_[0] == 0 && pending_[1] == 0 &&
+        pending_[2] == 0) {
+      return;
+    }
+    work_cv_.wait_until(lock, next_due, [this] {
+      return pending_[0] > 0 || Runnable() ||
+             (stopped_ && pending_[1] == 0 && pending_[2] == 0);
+    });
+  }
+}
+
+bool TaskScheduler::Take(size_t self, Task &task, TaskPriority &priority) {
+  for (int p = 0; p < PRIORITIES; ++p) {
+    if (pending_[p] == 0) {
+      continue;
+    }
+    bool background = p != static_cast<int>(TaskPriority::HIGH);
+    if (background) {
+      size_t running = running_background_.load();
+      do {
+        if (running >= throttle_.load()) {
+          return false;
+        }
+      } while (!running_background_.compare_exchange_weak(running,
+                                                          running + 1));
+    }
+    // the newest task of our own, else the oldest one of another worker
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      Worker &worker = *workers_[(self + i) % workers_.size()];
+      std::lock_guard<std::mutex> guard(worker.latch_);
+      std::deque<Task> &queue = worker.queues_[p];
+      if (queue.empty()) {
+        continue;
+      }
+      if (i == 0) {
+        task = std::move(queue.back());
+        queue.pop_back();
+      } else {
+        task = std::move(queue.front());
+        queue.pop_front();
+        steals_.fetch_add(1, std::memory_order_relaxed);
+      }
+      // running before no longer pending, for WaitIdle
+      ++running_;
+      --pending_[p];
+      priority = static_cast<TaskPriority>(p);
+      return true;
+    }
+    if (background) {
+      // under latch_, a worker the claim kept from the slot may be asleep
+      {
+        std::lock_guard<std::mutex> guard(latch_);
+        --running_background_;
+      }
+      work_cv_.notify_one();
+    }
+  }
+  return false;
+}
+
+void TaskScheduler::Push(Task task, TaskPriority priority) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (stopped_) {
+      return;
+    }
+    size_t target = current_scheduler == this
+                        ? current_worker
+                        : next_worker_++ % workers_.size();
+    Worker &worker = *workers_[target];
+    std::lock_guard<std::mutex> worker_guard(worker.latch_);
+    worker.queues_[static_cast<int>(priority)].push_back(std::move(task));
+    ++pending_[static_cast<int>(priority)];
+  }
+  work_cv_.notify_one();
+}
+
+std::chrono::steady_clock::time_point TaskScheduler::QueueDue() {
+  std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point next = now + std::chrono::hours(1);
+  if (stopped_) {
+    return next;
+  }
+  bool queued = false;
+  for (auto &entry : periodic_) {
+    Periodic &periodic = *entry.second;
+    if (periodic.queued_) {
+      continue;
+    }
+    if (periodic.due_ > now) {
+      next = std::min(next, periodic.due_);
+      continue;
+    }
+    periodic.queued_ = true;
+    int p = static_cast<int>(periodic.priority_);
+    Worker &worker = *workers_[next_worker_++ % workers_.size()];
+    std::lock_guard<std::mutex> guard(worker.latch_);
+    worker.queues_[p].push_back(Task{periodic.task_, entry.second});
+    ++pending_[p];
+    queued = true;
+  }
+  if (queued) {
+    work_cv_.notify_all();
+  }
+  return next;
+}
+
+bool TaskScheduler::Runnable() const {
+  return (pending_[1] > 0 || pending_[2] > 0) &&
+         running_background_ < throttle_;
+}
+
+/*
+ * Multiplicative decrease, additive increase, as TCP does with its window:
+ * background work backs off fast once it hurts and creeps back
+ */
+void TaskScheduler::AdjustThrottle() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (probe_ == nullptr) {
+      return;
+    }
+    // the probe itself, a copy would start from its first state every time
+    if (probe_() > probe_target_) {
+      throttle_ = std::max<size_t>(1, throttle_ / 2);
+      throttles_.fetch_add(1, std::memory_order_relaxed);
+    } else if (throttle_ < throttle_limit_) {
+      ++throttle_;
+    }
+  }
+  work_cv_.notify_all();
+}
+
+} // namespace cmudb
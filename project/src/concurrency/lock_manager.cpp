@@ -2,24 +2,700 @@
  * lock_manager.cpp
  */
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <unordered_set>
+
+#include "common/memory_tracker.h"
+#include "common/metrics.h"
 #include "concurrency/lock_manager.h"
 
 namespace cmudb {
 
-bool LockManager::LockShared(Transaction *txn, const RID &rid) {
-  return false;
+// a request and its list node, as the memory tracker counts them
+static const size_t LOCK_REQUEST_BYTES = 64;
+
+LockManager::LockManager(bool strict_2PL, size_t num_shards)
+    : strict_2PL_(strict_2PL), page_threshold_(LOCK_ESCALATION_PAGE),
+      table_threshold_(LOCK_ESCALATION_TABLE),
+      page_configured_(LOCK_ESCALATION_PAGE),
+      table_configured_(LOCK_ESCALATION_TABLE), shards_(num_shards),
+      detector_thread_(nullptr), detector_running_(false),
+      scheduler_(nullptr), detector_task_(-1) {
+  // fewer tuple locks per transaction while memory is tight, 0 stays off
+  elastic_ = MemoryTracker::Instance().RegisterElastic(
+      ElasticPriority::LOCK_ESCALATION,
+      [this](size_t) -> size_t {
+        if (page_configured_ != 0) {
+          page_threshold_ = std::min<size_t>(page_configured_,
+                                             LOCK_ESCALATION_PAGE_TIGHT);
+        }
+        if (table_configured_ != 0) {
+          table_threshold_ = std::min<size_t>(table_configured_,
+                                              LOCK_ESCALATION_TABLE_TIGHT);
+        }
+        return 0;
+      },
+      [this] {
+        page_threshold_ = page_configured_.load();
+        table_threshold_ = table_configured_.load();
+      });
 }
 
-bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
-  return false;
+LockManager::~LockManager() {
+  MemoryTracker::Instance().UnregisterElastic(elastic_);
+  StopDeadlockDetector();
 }
 
-bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
-  return false;
+bool LockManager::LockShared(Transaction *txn, const RID &rid,
+                             page_id_t table_id) {
+  return LockTuple(txn, rid, table_id, LockMode::SHARED);
+}
+
+bool LockManager::LockExclusive(Transaction *txn, const RID &rid,
+                                page_id_t table_id) {
+  return LockTuple(txn, rid, table_id, LockMode::EXCLUSIVE);
+}
+bool LockManager::TryLockExclusive(Transaction *txn, const RID &rid,
+                                   page_id_t table_id) {
+  return LockTuple(txn, rid, table_id, LockMode::EXCLUSIVE, false);
+}
+
+bool LockManager::LockUpdate(Transaction *txn, const RID &rid,
+                             page_id_t table_id) {
+  return LockTuple(txn, rid, table_id, LockMode::UPDATE);
+}
+
+bool LockManager::LockUpgrade(Transaction *txn, const RID &rid,
+                              page_id_t table_id) {
+  if (txn->GetSharedLockSet()->count(rid) == 0 &&
+      txn->GetUpdateLockSet()->count(rid) == 0) {
+    return false;
+  }
+  bool covered;
+  if (!LockAbove(txn, table_id, rid.GetPageId(), LockMode::EXCLUSIVE,
+                 covered)) {
+    return false;
+  }
+  return covered || Convert(txn, LockKey::Tuple(rid), LockMode::EXCLUSIVE);
 }
 
 bool LockManager::Unlock(Transaction *txn, const RID &rid) {
+  return Unlock(txn, LockKey::Tuple(rid));
+}
+
+bool LockManager::LockTable(Transaction *txn, page_id_t table_id,
+                            LockMode mode) {
+  return Acquire(txn, LockKey::Table(table_id), mode);
+}
+
+bool LockManager::LockPage(Transaction *txn, page_id_t table_id,
+                           page_id_t page_id, LockMode mode) {
+  bool covered;
+  if (!LockAbove(txn, table_id, INVALID_PAGE_ID, mode, covered)) {
+    return false;
+  }
+  return covered || Acquire(txn, LockKey::Page(page_id), mode);
+}
+
+bool LockManager::Unlock(Transaction *txn, const LockKey &key) {
+  if (strict_2PL_ && txn->GetState() != TransactionState::COMMITTED &&
+      txn->GetState() != TransactionState::ABORTED) {
+    return false;
+  }
+  if (txn->GetState() == TransactionState::GROWING) {
+    txn->SetState(TransactionState::SHRINKING);
+  }
+  return Release(txn, key);
+}
+
+bool LockManager::LockTuple(Transaction *txn, const RID &rid,
+                            page_id_t table_id, LockMode mode, bool wait) {
+  bool covered;
+  if (!LockAbove(txn, table_id, rid.GetPageId(), mode, covered, wait)) {
+    return false;
+  }
+  if (covered) {
+    return true;
+  }
+  LockMode held;
+  bool counted = HeldMode(txn, LockKey::Tuple(rid), held);
+  if (!Acquire(txn, LockKey::Tuple(rid), mode, wait)) {
+    return false;
+  }
+  if (counted || table_id == INVALID_PAGE_ID) {
+    return true;
+  }
+  auto counts = txn->GetTupleLockCounts();
+  (*txn->GetPageTables())[rid.GetPageId()] = table_id;
+  size_t on_page = ++(*counts)[LockKey::Page(rid.GetPageId())];
+  ++(*counts)[LockKey::Table(table_id)];
+  size_t page_threshold = page_threshold_;
+  if (page_threshold != 0 && on_page > page_threshold) {
+    Escalate(txn, LockKey::Page(rid.GetPageId()), table_id);
+  }
+  // what is left after the page escalated
+  size_t table_threshold = table_threshold_;
+  if (table_threshold != 0 &&
+      (*counts)[LockKey::Table(table_id)] > table_threshold) {
+    Escalate(txn, LockKey::Table(table_id), table_id);
+  }
+  return true;
+}
+
+void LockManager::Escalate(Transaction *txn, const LockKey &key,
+                           page_id_t table_id) {
+  auto page_tables = txn->GetPageTables();
+  auto below = [&](const RID &rid) {
+    if (key.level_ == LockLevel::PAGE) {
+      return rid.GetPageId() == key.id_;
+    }
+    auto it = page_tables->find(rid.GetPageId());
+    return it != page_tables->end() && it->second == table_id;
+  };
+  std::vector<RID> rids;
+  bool exclusive = false;
+  for (auto &rid : *txn->GetExclusiveLockSet()) {
+    if (below(rid)) {
+      rids.push_back(rid);
+      exclusive = true;
+    }
+  }
+  // going to be exclusive
+  for (auto &rid : *txn->GetUpdateLockSet()) {
+    if (below(rid)) {
+      rids.push_back(rid);
+      exclusive = true;
+    }
+  }
+  for (auto &rid : *txn->GetSharedLockSet()) {
+    if (below(rid)) {
+      rids.push_back(rid);
+    }
+  }
+  LockMode held;
+  if (!HeldMode(txn, key, held)) {
+    return;
+  }
+  // an exclusive lock further below, e.g. on a page of the table
+  if (Covers(held, LockMode::INTENTION_EXCLUSIVE)) {
+    exclusive = true;
+  }
+  LockMode mode = exclusive ? LockMode::EXCLUSIVE : LockMode::SHARED;
+  if (!Covers(held, mode) && !Convert(txn, key, Combine(held, mode), false)) {
+    return;
+  }
+  for (auto &rid : rids) {
+    Release(txn, LockKey::Tuple(rid));
+  }
+  if (key.level_ == LockLevel::TABLE) {
+    // the page locks below are not needed either
+    std::vector<page_id_t> pages;
+    for (auto &entry : *page_tables) {
+      if (entry.second == table_id) {
+        pages.push_back(entry.first);
+      }
+    }
+    for (page_id_t page_id : pages) {
+      Release(txn, LockKey::Page(page_id));
+      txn->GetTupleLockCounts()->erase(LockKey::Page(page_id));
+      page_tables->erase(page_id);
+    }
+  }
+}
+
+bool LockManager::Release(Transaction *txn, const LockKey &key) {
+  if (key.level_ == LockLevel::TUPLE) {
+    RID rid(key.id_);
+    if (txn->GetSharedLockSet()->erase(rid) +
+            txn->GetExclusiveLockSet()->erase(rid) +
+            txn->GetUpdateLockSet()->erase(rid) !=
+        0) {
+      auto counts = txn->GetTupleLockCounts();
+      auto page_it = counts->find(LockKey::Page(rid.GetPageId()));
+      if (page_it != counts->end() && page_it->second > 0) {
+        page_it->second--;
+      }
+      auto table_it = txn->GetPageTables()->find(rid.GetPageId());
+      if (table_it != txn->GetPageTables()->end()) {
+        auto count_it = counts->find(LockKey::Table(table_it->second));
+        if (count_it != counts->end() && count_it->second > 0) {
+          count_it->second--;
+        }
+      }
+    }
+  } else {
+    txn->GetCoarseLockSet()->erase(key);
+  }
+
+  Shard &shard = ShardOf(key);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto queue_it = shard.queues_.find(key);
+  if (queue_it == shard.queues_.end()) {
+    return false;
+  }
+  LockQueue &queue = queue_it->second;
+  for (auto it = queue.requests_.begin(); it != queue.requests_.end(); ++it) {
+    if (it->txn_ == txn) {
+      queue.requests_.erase(it);
+      MemoryTracker::Instance().Release(MemoryConsumer::LOCK_TABLE,
+                                        LOCK_REQUEST_BYTES);
+      if (queue.requests_.empty()) {
+        shard.queues_.erase(queue_it);
+      } else {
+        queue.cv_.notify_all();
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LockManager::HeldMode(Transaction *txn, const LockKey &key,
+                           LockMode &mode) {
+  if (key.level_ == LockLevel::TUPLE) {
+    RID rid(key.id_);
+    if (txn->GetExclusiveLockSet()->count(rid) != 0) {
+      mode = LockMode::EXCLUSIVE;
+      return true;
+    }
+    if (txn->GetUpdateLockSet()->count(rid) != 0) {
+      mode = LockMode::UPDATE;
+      return true;
+    }
+    if (txn->GetSharedLockSet()->count(rid) != 0) {
+      mode = LockMode::SHARED;
+      return true;
+    }
+    return false;
+  }
+  auto it = txn->GetCoarseLockSet()->find(key);
+  if (it == txn->GetCoarseLockSet()->end()) {
+    return false;
+  }
+  mode = it->second;
+  return true;
+}
+
+bool LockManager::LockAbove(Transaction *txn, page_id_t table_id,
+                            page_id_t page_id, LockMode mode, bool &covered,
+                            bool wait) {
+  covered = false;
+  if (table_id == INVALID_PAGE_ID) {
+    return true;
+  }
+  LockMode held;
+  for (const LockKey &key : {LockKey::Table(table_id), LockKey::Page(page_id)}) {
+    if (key.level_ == LockLevel::PAGE && page_id == INVALID_PAGE_ID) {
+      break;
+    }
+    if (HeldMode(txn, key, held) && CoversChildren(held, mode)) {
+      covered = true;
+      return true;
+    }
+    if (!Acquire(txn, key, IntentionFor(mode), wait)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LockManager::Acquire(Transaction *txn, const LockKey &key,
+                          LockMode mode, bool wait) {
+  LockMode held;
+  if (!HeldMode(txn, key, held)) {
+    return Lock(txn, key, mode, wait);
+  }
+  return Covers(held, mode) || Convert(txn, key, Combine(held, mode), wait);
+}
+
+bool LockManager::Lock(Transaction *txn, const LockKey &key, LockMode mode,
+                       bool wait) {
+  if (!CanLock(txn)) {
+    return false;
+  }
+  // before the latch, making room may take a while. No memory left at all
+  // aborts the transaction, its locks are freed with it
+  if (!MemoryTracker::Instance().Reserve(MemoryConsumer::LOCK_TABLE,
+                                         LOCK_REQUEST_BYTES)) {
+    txn->SetState(TransactionState::ABORTED);
+    memory_aborts_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  Shard &shard = ShardOf(key);
+  std::unique_lock<std::mutex> guard(shard.latch_);
+  shard.stats_.Request(mode);
+  LockQueue &queue = shard.queues_[key];
+  // wait-die: wait only if every conflicting request is younger
+  for (auto &other : queue.requests_) {
+    if (!wait && !Compatible(other.mode_, mode)) {
+      MemoryTracker::Instance().Release(MemoryConsumer::LOCK_TABLE,
+                                        LOCK_REQUEST_BYTES);
+      return false;
+    }
+    if (!Compatible(other.mode_, mode) &&
+        other.txn_->GetTransactionId() < txn->GetTransactionId() &&
+        !detector_running_) {
+      MemoryTracker::Instance().Release(MemoryConsumer::LOCK_TABLE,
+                                        LOCK_REQUEST_BYTES);
+      return Die(txn, shard, key, wait_die_aborts_);
+    }
+  }
+  auto request = queue.requests_.emplace(queue.requests_.end(), txn, mode);
+  return Wait(txn, shard, key, request, guard);
+}
+
+bool LockManager::Convert(Transaction *txn, const LockKey &key,
+                          LockMode mode, bool wait) {
+  if (!CanLock(txn)) {
+    return false;
+  }
+  Shard &shard = ShardOf(key);
+  std::unique_lock<std::mutex> guard(shard.latch_);
+  auto queue_it = shard.queues_.find(key);
+  if (queue_it == shard.queues_.end()) {
+    return false;
+  }
+  shard.stats_.Request(mode);
+  LockQueue &queue = queue_it->second;
+  auto held = queue.requests_.end();
+  for (auto it = queue.requests_.begin(); it != queue.requests_.end(); ++it) {
+    if (it->txn_ == txn) {
+      held = it;
+      break;
+    }
+  }
+  if (held == queue.requests_.end() || !held->granted_) {
+    return false;
+  }
+  // in place if nothing conflicts
+  bool conflict = false;
+  for (auto &other : queue.requests_) {
+    if (other.txn_ != txn && !Compatible(other.mode_, mode)) {
+      conflict = true;
+      break;
+    }
+  }
+  if (!conflict) {
+    held->mode_ = mode;
+    shard.stats_.grants_++;
+    RecordLock(txn, key, mode);
+    return true;
+  }
+  if (!wait) {
+    return false;
+  }
+  // two conversions may wait for each other's granted lock. The other one
+  // cannot hold U too, an update lock goes first
+  if (queue.converter_ != nullptr) {
+    if (held->mode_ != LockMode::UPDATE) {
+      return Die(txn, shard, key, conversion_aborts_);
+    }
+    queue.converter_->SetState(TransactionState::ABORTED);
+    wounded_aborts_.fetch_add(1, std::memory_order_relaxed);
+    queue.converter_ = nullptr;
+    queue.cv_.notify_all();
+  }
+  bool wait_die = !detector_running_;
+  auto position = queue.requests_.begin();
+  for (; position != queue.requests_.end() && position->granted_; ++position) {
+    if (position->txn_ != txn && !Compatible(position->mode_, mode) &&
+        position->txn_->GetTransactionId() < txn->GetTransactionId() &&
+        wait_die) {
+      return Die(txn, shard, key, wait_die_aborts_);
+    }
+  }
+  // the converted request goes in front of the waiting ones, those younger
+  // than txn and conflicting would have died had it been there when they came
+  queue.requests_.erase(held);
+  if (key.level_ == LockLevel::TUPLE) {
+    txn->GetSharedLockSet()->erase(RID(key.id_));
+    txn->GetUpdateLockSet()->erase(RID(key.id_));
+  }
+  bool wounded = false;
+  for (auto it = position; it != queue.requests_.end() && wait_die; ++it) {
+    if (!Compatible(it->mode_, mode) &&
+        it->txn_->GetTransactionId() > txn->GetTransactionId()) {
+      it->txn_->SetState(TransactionState::ABORTED);
+      wounded_aborts_.fetch_add(1, std::memory_order_relaxed);
+      wounded = true;
+    }
+  }
+  if (wounded) {
+    queue.cv_.notify_all();
+  }
+  auto request = queue.requests_.emplace(position, txn, mode);
+  queue.converter_ = txn;
+  bool granted = Wait(txn, shard, key, request, guard);
+  // the queue is gone if the conversion died as the last request
+  queue_it = shard.queues_.find(key);
+  if (queue_it != shard.queues_.end() &&
+      queue_it->second.converter_ == txn) {
+    queue_it->second.converter_ = nullptr;
+  }
+  return granted;
+}
+
+bool LockManager::CanLock(Transaction *txn) {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  // 2PL: no locks after the first unlock
+  if (txn->GetState() != TransactionState::GROWING) {
+    txn->SetState(TransactionState::ABORTED);
+    shrinking_aborts_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+bool LockManager::Die(Transaction *txn, Shard &shard, const LockKey &key,
+                      std::atomic<uint64_t> &cause) {
+  txn->SetState(TransactionState::ABORTED);
+  cause.fetch_add(1, std::memory_order_relaxed);
+  shard.stats_.aborts_++;
+  shard.stats_.Conflict(key);
+  auto queue_it = shard.queues_.find(key);
+  if (queue_it != shard.queues_.end() && queue_it->second.requests_.empty()) {
+    shard.queues_.erase(queue_it);
+  }
   return false;
 }
 
+bool LockManager::Wait(Transaction *txn, Shard &shard, const LockKey &key,
+                       std::list<LockRequest>::iterator request,
+                       std::unique_lock<std::mutex> &guard) {
+  LockQueue &queue = shard.queues_[key];
+  auto ready = [&] {
+    if (txn->GetState() == TransactionState::ABORTED) {
+      return true;
+    }
+    for (auto it = queue.requests_.begin(); it != request; ++it) {
+      if (!Compatible(it->mode_, request->mode_)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  if (!ready()) {
+    shard.stats_.waits_++;
+    shard.stats_.Conflict(key);
+    auto start = std::chrono::steady_clock::now();
+    TRACE_GAUGE(lock, waiting, 1);
+    queue.cv_.wait(guard, ready);
+    TRACE_GAUGE(lock, waiting, -1);
+    uint64_t wait_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+    shard.stats_.wait_ns_.Record(wait_ns);
+    TRACE_VALUE(lock, wait_ns, wait_ns, txn->GetTransactionId());
+  }
+
+  if (txn->GetState() == TransactionState::ABORTED) {
+    shard.stats_.aborts_++;
+    queue.requests_.erase(request);
+    MemoryTracker::Instance().Release(MemoryConsumer::LOCK_TABLE,
+                                      LOCK_REQUEST_BYTES);
+    if (queue.requests_.empty()) {
+      shard.queues_.erase(key);
+    } else {
+      queue.cv_.notify_all();
+    }
+    return false;
+  }
+  request->granted_ = true;
+  shard.stats_.grants_++;
+  RecordLock(txn, key, request->mode_);
+  return true;
+}
+
+void LockManager::RecordLock(Transaction *txn, const LockKey &key,
+                             LockMode mode) {
+  TRACE_POINT(lock, acquire, txn->GetTransactionId(), key.id_,
+              static_cast<int>(mode));
+  if (key.level_ != LockLevel::TUPLE) {
+    (*txn->GetCoarseLockSet())[key] = mode;
+    return;
+  }
+  RID rid(key.id_);
+  txn->GetSharedLockSet()->erase(rid);
+  txn->GetUpdateLockSet()->erase(rid);
+  if (mode == LockMode::SHARED) {
+    txn->GetSharedLockSet()->insert(rid);
+  } else if (mode == LockMode::UPDATE) {
+    txn->GetUpdateLockSet()->insert(rid);
+  } else {
+    txn->GetExclusiveLockSet()->insert(rid);
+  }
+}
+
+void LockManager::RunDeadlockDetector(TaskScheduler *scheduler) {
+  if (detector_running_) {
+    return;
+  }
+  detector_running_ = true;
+  if (scheduler != nullptr) {
+    // waiters are stuck until it runs, ahead of other background work
+    scheduler_ = scheduler;
+    detector_task_ = scheduler->SchedulePeriodic(
+        [this] { DetectDeadlocks(); }, DEADLOCK_DETECTION_INTERVAL,
+        TaskPriority::HIGH);
+    return;
+  }
+  detector_thread_ = new std::thread([this] {
+    while (detector_running_) {
+      DetectDeadlocks();
+      std::unique_lock<std::mutex> lock(detector_latch_);
+      detector_cv_.wait_for(lock, DEADLOCK_DETECTION_INTERVAL,
+                            [this] { return !detector_running_; });
+    }
+  });
+}
+
+void LockManager::StopDeadlockDetector() {
+  if (scheduler_ != nullptr) {
+    scheduler_->Cancel(detector_task_);
+    scheduler_ = nullptr;
+    detector_running_ = false;
+    return;
+  }
+  if (detector_thread_ == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(detector_latch_);
+    detector_running_ = false;
+  }
+  detector_cv_.notify_one();
+  detector_thread_->join();
+  delete detector_thread_;
+  detector_thread_ = nullptr;
+}
+
+size_t LockManager::DetectDeadlocks() {
+  // all shards at once, in order, so the graph is a consistent one
+  std::vector<std::unique_lock<std::mutex>> guards;
+  guards.reserve(shards_.size());
+  for (auto &shard : shards_) {
+    guards.emplace_back(shard.latch_);
+  }
+  // a waiter waits for every conflicting request in front of it
+  std::map<txn_id_t, std::set<txn_id_t>> waits_for;
+  std::unordered_map<txn_id_t, std::pair<Transaction *, LockQueue *>> waiters;
+  for (auto &shard : shards_) {
+    for (auto &entry : shard.queues_) {
+      LockQueue &queue = entry.second;
+      for (auto it = queue.requests_.begin(); it != queue.requests_.end();
+           ++it) {
+        if (it->granted_ ||
+            it->txn_->GetState() == TransactionState::ABORTED) {
+          continue;
+        }
+        txn_id_t waiter = it->txn_->GetTransactionId();
+        waiters[waiter] = std::make_pair(it->txn_, &queue);
+        for (auto ahead = queue.requests_.begin(); ahead != it; ++ahead) {
+          if (!Compatible(ahead->mode_, it->mode_)) {
+            waits_for[waiter].insert(ahead->txn_->GetTransactionId());
+          }
+        }
+      }
+    }
+  }
+
+  size_t victims = 0;
+  txn_id_t victim;
+  while ((victim = FindVictim(waits_for)) != INVALID_TXN_ID) {
+    auto &waiter = waiters[victim];
+    waiter.first->SetState(TransactionState::ABORTED);
+    waiter.second->cv_.notify_all();
+    deadlock_aborts_.fetch_add(1, std::memory_order_relaxed);
+    victims++;
+    // its granted locks go once it is rolled back
+    waits_for.erase(victim);
+    for (auto &edges : waits_for) {
+      edges.second.erase(victim);
+    }
+  }
+  return victims;
+}
+
+txn_id_t LockManager::FindVictim(
+    const std::map<txn_id_t, std::set<txn_id_t>> &waits_for) {
+  // depth first from the oldest, a transaction seen on the path closes a
+  // cycle
+  std::vector<txn_id_t> path;
+  std::unordered_set<txn_id_t> on_path;
+  std::unordered_set<txn_id_t> done;
+  txn_id_t victim = INVALID_TXN_ID;
+  std::function<bool(txn_id_t)> visit = [&](txn_id_t txn) {
+    path.push_back(txn);
+    on_path.insert(txn);
+    auto edges = waits_for.find(txn);
+    if (edges != waits_for.end()) {
+      for (txn_id_t next : edges->second) {
+        if (on_path.count(next) != 0) {
+          for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            victim = std::max(victim, *it);
+            if (*it == next) {
+              break;
+            }
+          }
+          return true;
+        }
+        if (done.count(next) == 0 && visit(next)) {
+          return true;
+        }
+      }
+    }
+    path.pop_back();
+    on_path.erase(txn);
+    done.insert(txn);
+    return false;
+  };
+  for (auto &edges : waits_for) {
+    if (done.count(edges.first) == 0 && visit(edges.first)) {
+      return victim;
+    }
+  }
+  return INVALID_TXN_ID;
+}
+
+LockAbortStats LockManager::GetAbortStats() const {
+  LockAbortStats stats;
+  stats.wait_die = wait_die_aborts_.load(std::memory_order_relaxed);
+  stats.wounded = wounded_aborts_.load(std::memory_order_relaxed);
+  stats.conversion = conversion_aborts_.load(std::memory_order_relaxed);
+  stats.shrinking = shrinking_aborts_.load(std::memory_order_relaxed);
+  stats.deadlock = deadlock_aborts_.load(std::memory_order_relaxed);
+  stats.memory = memory_aborts_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+LockStats LockManager::GetStats(size_t top_n) {
+  LockStats stats;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.latch_);
+    stats.shards.push_back(shard.stats_.Snapshot());
+    stats.total += stats.shards.back();
+    shard.stats_.HotKeys(stats.hot_keys);
+  }
+  std::sort(stats.hot_keys.begin(), stats.hot_keys.end(),
+            [](const LockHotKey &a, const LockHotKey &b) {
+              return a.conflicts_ > b.conflicts_;
+            });
+  if (stats.hot_keys.size() > top_n) {
+    stats.hot_keys.erase(stats.hot_keys.begin() + top_n,
+                         stats.hot_keys.end());
+  }
+  return stats;
+}
+
+void LockManager::ResetStats() {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.latch_);
+    shard.stats_.Reset();
+  }
+}
+
 } // namespace cmudb
@@ -5,54 +5,116 @@
 #include "concurrency/transaction_manager.h"
 #include "table/table_heap.h"
 
+#include <algorithm>
 #include <cassert>
 namespace cmudb {
 
+TransactionManager::~TransactionManager() {
+  StopVersionGC();
+  for (auto txn : free_txns_) {
+    delete txn;
+  }
+}
+
 Transaction *TransactionManager::Begin() {
-  Transaction *txn = new Transaction(next_txn_id_++);
+  Transaction *txn = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(pool_latch_);
+    if (!free_txns_.empty()) {
+      txn = free_txns_.back();
+      free_txns_.pop_back();
+    }
+  }
+  if (txn != nullptr) {
+    txn->Reset(next_txn_id_++);
+  } else {
+    txn = new Transaction(next_txn_id_++);
+  }
+  txn->SetAsyncCommit(async_commit_);
+  txn->SetOptimistic(optimistic_);
+  {
+    std::lock_guard<std::mutex> guard(snapshot_latch_);
+    txn->SetReadTs(last_commit_ts_);
+    snapshots_[txn->GetTransactionId()] = last_commit_ts_;
+  }
 
   if (ENABLE_LOGGING) {
-    // TODO: write log and update transaction's prev_lsn here
+    {
+      std::lock_guard<std::mutex> guard(active_latch_);
+      active_txns_[txn->GetTransactionId()] =
+          std::make_pair(txn, log_manager_->GetNextLSN());
+    }
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::BEGIN);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(log_record));
   }
 
   return txn;
 }
 
-void TransactionManager::Commit(Transaction *txn) {
+bool TransactionManager::Commit(Transaction *txn) {
+  std::unique_lock<std::mutex> validation(validation_latch_, std::defer_lock);
+  if (txn->IsOptimistic()) {
+    validation.lock();
+    if (!Validate(txn) || !ApplyWrites(txn)) {
+      validation.unlock();
+      Abort(txn);
+      return false;
+    }
+  }
   txn->SetState(TransactionState::COMMITTED);
-  // truly delete before commit
+  txn->GetReadSet()->clear();
   auto write_set = txn->GetWriteSet();
+  // publish the versions before the deletes free their slots, a reused slot
+  // then never sits on a version not yet committed
+  std::vector<RID> rids;
+  for (auto &item : *write_set)
+    rids.push_back(item.rid_);
+  EndSnapshot(txn, rids, true);
+  if (validation.owns_lock()) {
+    validation.unlock();
+  }
+  // truly delete before commit
   while (!write_set->empty()) {
     auto &item = write_set->back();
     auto table = item.table_;
     if (item.wtype_ == WType::DELETE) {
       // this also release the lock when holding the page latch
       table->ApplyDelete(item.rid_, txn);
+    } else if (item.wtype_ == WType::UPDATE) {
+      table->ApplyUpdate(item.rid_, item.tuple_, txn);
     }
     write_set->pop_back();
   }
   write_set->clear();
 
   if (ENABLE_LOGGING) {
-    // TODO: write log and update transaction's prev_lsn here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::COMMIT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(log_record));
+    // group commit, this shares one flush with all concurrent committers
+    if (!txn->IsAsyncCommit()) {
+      log_manager_->WaitForDurable(txn->GetPrevLSN());
+    }
   }
+  EndTransaction(txn);
 
-  // release all the lock
-  std::unordered_set<RID> lock_set;
-  for (auto item : *txn->GetSharedLockSet())
-    lock_set.emplace(item);
-  for (auto item : *txn->GetExclusiveLockSet())
-    lock_set.emplace(item);
-  // release all the lock
-  for (auto locked_rid : lock_set) {
-    lock_manager_->Unlock(txn, locked_rid);
-  }
+  ReleaseLocks(txn);
+  return true;
 }
 
 void TransactionManager::Abort(Transaction *txn) {
   txn->SetState(TransactionState::ABORTED);
+  txn->GetReadSet()->clear();
   // rollback before releasing lock
   auto write_set = txn->GetWriteSet();
+  if (txn->IsOptimistic()) {
+    // nothing was applied
+    write_set->clear();
+  }
+  std::vector<RID> rids;
+  for (auto &item : *write_set)
+    rids.push_back(item.rid_);
   while (!write_set->empty()) {
     auto &item = write_set->back();
     auto table = item.table_;
@@ -69,20 +131,191 @@ void TransactionManager::Abort(Transaction *txn) {
     write_set->pop_back();
   }
   write_set->clear();
+  // the tuples are back to their versions before txn
+  EndSnapshot(txn, rids, false);
 
   if (ENABLE_LOGGING) {
-    // TODO: write log and update transaction's prev_lsn here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(log_record));
+  }
+  EndTransaction(txn);
+
+  ReleaseLocks(txn);
+}
+
+void TransactionManager::Release(Transaction *txn) {
+  {
+    std::lock_guard<std::mutex> guard(pool_latch_);
+    if (free_txns_.size() < TXN_POOL_SIZE) {
+      free_txns_.push_back(txn);
+      return;
+    }
   }
+  delete txn;
+}
 
+void TransactionManager::WaitForDurable(lsn_t lsn) {
+  if (log_manager_ != nullptr && lsn != INVALID_LSN) {
+    log_manager_->WaitForDurable(lsn);
+  }
+}
+
+lsn_t TransactionManager::GetActiveTransactions(
+    std::vector<std::pair<txn_id_t, lsn_t>> &txns) {
+  std::lock_guard<std::mutex> guard(active_latch_);
+  lsn_t min_lsn = INVALID_LSN;
+  for (auto &entry : active_txns_) {
+    txns.emplace_back(entry.first, entry.second.first->GetPrevLSN());
+    if (min_lsn == INVALID_LSN || entry.second.second < min_lsn) {
+      min_lsn = entry.second.second;
+    }
+  }
+  return min_lsn;
+}
+
+bool TransactionManager::Validate(Transaction *txn) {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  for (auto &item : *txn->GetReadSet()) {
+    if (!tuple_versions_.Validate(item.rid_, txn, item.version_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TransactionManager::ApplyWrites(Transaction *txn) {
+  std::deque<WriteRecord> buffered;
+  buffered.swap(*txn->GetWriteSet());
+  // from now on the write set is the undo set, a failed write is rolled back
+  // with the ones before it
+  txn->SetOptimistic(false);
+  for (auto &item : buffered) {
+    RID rid = item.rid_;
+    bool applied;
+    if (item.wtype_ == WType::INSERT) {
+      applied = item.table_->InsertTuple(item.tuple_, rid, txn);
+    } else if (item.wtype_ == WType::DELETE) {
+      applied = item.table_->MarkDelete(rid, txn);
+    } else {
+      applied = item.table_->UpdateTuple(item.tuple_, rid, txn);
+    }
+    if (!applied || txn->GetState() == TransactionState::ABORTED) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TransactionManager::ReleaseLocks(Transaction *txn) {
   // release all the lock
-  std::unordered_set<RID> lock_set;
+  RIDSet lock_set;
   for (auto item : *txn->GetSharedLockSet())
     lock_set.emplace(item);
   for (auto item : *txn->GetExclusiveLockSet())
     lock_set.emplace(item);
+  for (auto item : *txn->GetUpdateLockSet())
+    lock_set.emplace(item);
   // release all the lock
   for (auto locked_rid : lock_set) {
     lock_manager_->Unlock(txn, locked_rid);
   }
+  // then the page and table locks above them, pages first
+  std::vector<LockKey> coarse_locks;
+  for (auto &item : *txn->GetCoarseLockSet())
+    coarse_locks.push_back(item.first);
+  std::sort(coarse_locks.begin(), coarse_locks.end(),
+            [](const LockKey &a, const LockKey &b) {
+              return a.level_ > b.level_;
+            });
+  for (auto &key : coarse_locks) {
+    lock_manager_->Unlock(txn, key);
+  }
+}
+
+void TransactionManager::EndSnapshot(Transaction *txn,
+                                     const std::vector<RID> &rids,
+                                     bool commit) {
+  std::lock_guard<std::mutex> guard(snapshot_latch_);
+  snapshots_.erase(txn->GetTransactionId());
+  if (rids.empty()) {
+    return;
+  }
+  timestamp_t commit_ts = last_commit_ts_ + 1;
+  for (auto &rid : rids) {
+    if (commit) {
+      version_store_.Commit(rid, txn->GetTransactionId(), commit_ts);
+      tuple_versions_.Commit(rid, txn->GetTransactionId(), commit_ts);
+    } else {
+      version_store_.Abort(rid, txn->GetTransactionId());
+      tuple_versions_.Abort(rid, txn->GetTransactionId());
+    }
+  }
+  if (commit) {
+    last_commit_ts_ = commit_ts;
+  }
+}
+
+timestamp_t TransactionManager::GetOldestSnapshot() {
+  std::lock_guard<std::mutex> guard(snapshot_latch_);
+  timestamp_t oldest = last_commit_ts_;
+  for (auto &entry : snapshots_) {
+    oldest = std::min(oldest, entry.second);
+  }
+  return oldest;
+}
+
+void TransactionManager::RunVersionGC(TaskScheduler *scheduler) {
+  if (gc_running_) {
+    return;
+  }
+  gc_running_ = true;
+  auto collect = [this] {
+    timestamp_t watermark = GetOldestSnapshot();
+    version_store_.Collect(watermark);
+    tuple_versions_.Collect(watermark);
+  };
+  if (scheduler != nullptr) {
+    // old versions cost memory and scan time only, it can wait
+    scheduler_ = scheduler;
+    gc_task_ = scheduler->SchedulePeriodic(collect, VERSION_GC_INTERVAL,
+                                           TaskPriority::LOW);
+    return;
+  }
+  gc_thread_ = new std::thread([this, collect] {
+    while (gc_running_) {
+      collect();
+      std::unique_lock<std::mutex> lock(gc_latch_);
+      gc_cv_.wait_for(lock, VERSION_GC_INTERVAL,
+                      [this] { return !gc_running_; });
+    }
+  });
+}
+
+void TransactionManager::StopVersionGC() {
+  if (scheduler_ != nullptr) {
+    scheduler_->Cancel(gc_task_);
+    scheduler_ = nullptr;
+    gc_running_ = false;
+    return;
+  }
+  if (gc_thread_ == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(gc_latch_);
+    gc_running_ = false;
+  }
+  gc_cv_.notify_one();
+  gc_thread_->join();
+  delete gc_thread_;
+  gc_thread_ = nullptr;
+}
+
+void TransactionManager::EndTransaction(Transaction *txn) {
+  std::lock_guard<std::mutex> guard(active_latch_);
+  active_txns_.erase(txn->GetTransactionId());
 }
 } // namespace cmudb
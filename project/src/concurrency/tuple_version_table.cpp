@@ -0,0 +1,102 @@
+/**
+ * tuple_version_table.cpp
+ */
+
+#include "concurrency/tuple_version_table.h"
+
+namespace cmudb {
+
+bool TupleVersionTable::CanWrite(const RID &rid, Transaction *txn) {
+  Shard &shard = ShardOf(rid);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto it = shard.entries_.find(rid);
+  return it == shard.entries_.end() || it->second.writer_ == INVALID_TXN_ID ||
+         it->second.writer_ == txn->GetTransactionId();
+}
+
+void TupleVersionTable::Record(const RID &rid, Transaction *txn) {
+  Shard &shard = ShardOf(rid);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto it = shard.entries_.emplace(rid, Entry{0, INVALID_TXN_ID}).first;
+  it->second.writer_ = txn->GetTransactionId();
+}
+
+bool TupleVersionTable::Read(const RID &rid, Transaction *txn,
+                             timestamp_t &version) {
+  Shard &shard = ShardOf(rid);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto it = shard.entries_.find(rid);
+  if (it == shard.entries_.end()) {
+    version = 0;
+    return true;
+  }
+  version = it->second.version_;
+  return it->second.writer_ == INVALID_TXN_ID ||
+         it->second.writer_ == txn->GetTransactionId();
+}
+
+bool TupleVersionTable::Validate(const RID &rid, Transaction *txn,
+                                 timestamp_t version) {
+  Shard &shard = ShardOf(rid);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto it = shard.entries_.find(rid);
+  // versions only grow, an entry collected since the read is older than it
+  return it == shard.entries_.end() ||
+         ((it->second.writer_ == INVALID_TXN_ID ||
+           it->second.writer_ == txn->GetTransactionId()) &&
+          it->second.version_ <= version);
+}
+
+void TupleVersionTable::Commit(const RID &rid, txn_id_t txn_id,
+                               timestamp_t commit_ts) {
+  Shard &shard = ShardOf(rid);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto it = shard.entries_.find(rid);
+  if (it != shard.entries_.end() && it->second.writer_ == txn_id) {
+    it->second.version_ = commit_ts;
+    it->second.writer_ = INVALID_TXN_ID;
+  }
+}
+
+void TupleVersionTable::Abort(const RID &rid, txn_id_t txn_id) {
+  Shard &shard = ShardOf(rid);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto it = shard.entries_.find(rid);
+  if (it == shard.entries_.end() || it->second.writer_ != txn_id) {
+    return;
+  }
+  // the tuple is back to its last committed version
+  if (it->second.version_ == 0) {
+    shard.entries_.erase(it);
+  } else {
+    it->second.writer_ = INVALID_TXN_ID;
+  }
+}
+
+size_t TupleVersionTable::Collect(timestamp_t watermark) {
+  size_t dropped = 0;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.latch_);
+    for (auto it = shard.entries_.begin(); it != shard.entries_.end();) {
+      if (it->second.writer_ == INVALID_TXN_ID &&
+          it->second.version_ <= watermark) {
+        it = shard.entries_.erase(it);
+        ++dropped;
+      } else {
+        ++it;
+      }
+    }
+  }
+  return dropped;
+}
+
+size_t TupleVersionTable::GetEntryCount() {
+  size_t count = 0;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.latch_);
+    count += shard.entries_.size();
+  }
+  return count;
+}
+
+} // namespace cmudb
@@ -0,0 +1,144 @@
+/**
+ * version_store.cpp
+ */
+
+#include "concurrency/version_store.h"
+
+namespace cmudb {
+
+bool VersionStore::CanWrite(const RID &rid, Transaction *txn) {
+  Shard &shard = ShardOf(rid);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto it = shard.chains_.find(rid);
+  if (it == shard.chains_.end() || it->second.empty()) {
+    return true;
+  }
+  // first updater wins
+  const UndoEntry &newest = it->second.front();
+  return newest.writer_ == txn->GetTransactionId() ||
+         (newest.commit_ts_ != INVALID_TIMESTAMP &&
+          newest.commit_ts_ <= txn->GetReadTs());
+}
+
+void VersionStore::Record(const RID &rid, Transaction *txn,
+                          const Tuple *image) {
+  Shard &shard = ShardOf(rid);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto &chain = shard.chains_[rid];
+  if (!chain.empty() && chain.front().writer_ == txn->GetTransactionId() &&
+      chain.front().commit_ts_ == INVALID_TIMESTAMP) {
+    return;
+  }
+  chain.emplace_front();
+  UndoEntry &entry = chain.front();
+  entry.writer_ = txn->GetTransactionId();
+  entry.commit_ts_ = INVALID_TIMESTAMP;
+  entry.existed_ = image != nullptr;
+  if (image != nullptr) {
+    entry.before_ = *image;
+  }
+}
+
+VersionRead VersionStore::Read(const RID &rid, Transaction *txn,
+                               Tuple &tuple) {
+  Shard &shard = ShardOf(rid);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto it = shard.chains_.find(rid);
+  if (it == shard.chains_.end()) {
+    return VersionRead::LATEST;
+  }
+  auto &chain = it->second;
+  // the image before the oldest entry if none is seen
+  size_t seen = chain.size();
+  for (size_t i = 0; i < chain.size(); ++i) {
+    if (chain[i].writer_ == txn->GetTransactionId() ||
+        (chain[i].commit_ts_ != INVALID_TIMESTAMP &&
+         chain[i].commit_ts_ <= txn->GetReadTs())) {
+      seen = i;
+      break;
+    }
+  }
+  if (seen == 0) {
+    return VersionRead::LATEST;
+  }
+  const UndoEntry &after = chain[seen - 1];
+  if (!after.existed_) {
+    return VersionRead::NONE;
+  }
+  tuple = after.before_;
+  return VersionRead::OLDER;
+}
+
+void VersionStore::Commit(const RID &rid, txn_id_t txn_id,
+                          timestamp_t commit_ts) {
+  Shard &shard = ShardOf(rid);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto it = shard.chains_.find(rid);
+  if (it == shard.chains_.end()) {
+    return;
+  }
+  for (auto &entry : it->second) {
+    if (entry.writer_ == txn_id && entry.commit_ts_ == INVALID_TIMESTAMP) {
+      entry.commit_ts_ = commit_ts;
+      return;
+    }
+  }
+}
+
+void VersionStore::Abort(const RID &rid, txn_id_t txn_id) {
+  Shard &shard = ShardOf(rid);
+  std::lock_guard<std::mutex> guard(shard.latch_);
+  auto it = shard.chains_.find(rid);
+  if (it == shard.chains_.end()) {
+    return;
+  }
+  auto &chain = it->second;
+  for (auto entry = chain.begin(); entry != chain.end(); ++entry) {
+    if (entry->writer_ == txn_id && entry->commit_ts_ == INVALID_TIMESTAMP) {
+      chain.erase(entry);
+      break;
+    }
+  }
+  if (chain.empty()) {
+    shard.chains_.erase(it);
+  }
+}
+
+size_t VersionStore::Collect(timestamp_t watermark) {
+  size_t dropped = 0;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.latch_);
+    for (auto it = shard.chains_.begin(); it != shard.chains_.end();) {
+      auto &chain = it->second;
+      // every snapshot sees the state after the newest entry committed at
+      // or before watermark, that entry and the older ones are not needed
+      for (size_t i = 0; i < chain.size(); ++i) {
+        if (chain[i].commit_ts_ != INVALID_TIMESTAMP &&
+            chain[i].commit_ts_ <= watermark) {
+          dropped += chain.size() - i;
+          chain.erase(chain.begin() + i, chain.end());
+          break;
+        }
+      }
+      if (chain.empty()) {
+        it = shard.chains_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  return dropped;
+}
+
+size_t VersionStore::GetVersionCount() {
+  size_t count = 0;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.latch_);
+    for (auto &chain : shard.chains_) {
+      count += chain.second.size();
+    }
+  }
+  return count;
+}
+
+} // namespace cmudb
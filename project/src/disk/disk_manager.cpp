@@ -1,116 +1,467 @@
 /**
  * disk_manager.cpp
  */
+#include <algorithm>
 #include <assert.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
 #include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
 #include <iostream>
+#include <memory>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <thread>
+#include <unistd.h>
 
+#include "common/crc32c.h"
 #include "common/logger.h"
 #include "disk/disk_manager.h"
+#include "page/header_page.h"
 
 namespace cmudb {
 
-static char *buffer_used = nullptr;
-
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), flush_log_(false),
-      flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, size_t page_size,
+                         bool direct_io, bool read_only)
+    : DiskManager(std::vector<std::string>(1, db_file), page_size,
+                  STRIPE_UNIT_PAGES, direct_io, read_only) {}
+
+/**
+ * Constructor: open/create the files of a striped tablespace & log file
+ * @input db_files: database file names, the first one holds the header page
+ */
+DiskManager::DiskManager(const std::vector<std::string> &db_files,
+                         size_t page_size, size_t stripe_pages, bool direct_io,
+                         bool read_only)
+    : db_fds_(db_files.size(), -1), file_name_(db_files.front()),
+      stripe_pages_(stripe_pages),
+      db_file_size_(0), direct_io_(false), read_only_(read_only),
+      page_size_(page_size), next_page_id_(0), free_count_(0),
+      preallocated_pages_(0), preallocate_(true), checksums_(false),
+      pages_stamped_(0), stamp_ns_(0), pages_verified_(0), verify_ns_(0),
+      checksum_failures_(0), num_flushes_(0), flush_log_(false), flush_log_f_(nullptr),
+      buffer_used_(nullptr) {
+  log_size_ = 0;
+  log_preallocator_ = nullptr;
+  log_preallocating_ = false;
+  log_preallocate_file_ = 0;
+  assert(IsValidPageSize(page_size_));
+  assert(stripe_pages_ > 0);
   std::string::size_type n = file_name_.find(".");
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  OpenLog();
+
+  // create the files if they do not exist
+  std::vector<size_t> file_sizes(db_files.size(), 0);
+  for (size_t file = 0; file < db_files.size(); ++file) {
+    const char *name = db_files[file].c_str();
+    db_fds_[file] = read_only_ ? open(name, O_RDONLY)
+                               : open(name, O_RDWR | O_CREAT, 0644);
+    if (db_fds_[file] < 0) {
+      LOG_DEBUG("can't open db file");
+      return;
+    }
+    struct stat stat_buf;
+    if (fstat(db_fds_[file], &stat_buf) == 0) {
+      file_sizes[file] = static_cast<size_t>(stat_buf.st_size);
+    }
+  }
+
+  // the header page starts with the page size of the database, see
+  // header_page.h
+  int32_t recorded_page_size = 0;
+  if (file_sizes[0] >= sizeof(recorded_page_size) &&
+      pread(db_fds_[0], &recorded_page_size, sizeof(recorded_page_size), 0) ==
+          static_cast<ssize_t>(sizeof(recorded_page_size)) &&
+      IsValidPageSize(recorded_page_size)) {
+    page_size_ = recorded_page_size;
+  }
+  // pages of existing files are taken, up to the highest one in any file
+  for (size_t file = 0; file < db_fds_.size(); ++file) {
+    size_t pages = file_sizes[file] / page_size_;
+    if (pages > 0) {
+      next_page_id_ = std::max<page_id_t>(next_page_id_,
+                                          GlobalPageId(file, pages - 1) + 1);
+    }
+    size_t partial = file_sizes[file] % page_size_;
+    if (partial > 0) {
+      GrowFileSize(static_cast<size_t>(GlobalPageId(file, pages)) *
+                       page_size_ + partial);
+    }
+  }
+  GrowFileSize(static_cast<size_t>(next_page_id_) * page_size_);
+
+  // the pages as of now, a file that is replicated on grows past the
+  // mapping and the remaining pages are read with pread
+  if (read_only_) {
+    for (size_t file = 0; file < db_fds_.size(); ++file) {
+      char *mapping = nullptr;
+      size_t mapping_size = file_sizes[file] / page_size_ * page_size_;
+      if (mapping_size > 0) {
+        void *mapped = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED,
+                            db_fds_[file], 0);
+        if (mapped == MAP_FAILED) {
+          LOG_DEBUG("can't map db file, reading it instead");
+          mapping_size = 0;
+        } else {
+          mapping = static_cast<char *>(mapped);
+        }
+      }
+      mappings_.push_back(mapping);
+      mapping_sizes_.push_back(mapping_size);
+    }
+    return;
+  }
+  preallocated_pages_ = next_page_id_;
+  if (file_sizes[0] >= page_size_) {
+    std::vector<char> header(page_size_);
+    if (pread(db_fds_[0], header.data(), page_size_, 0) ==
+        static_cast<ssize_t>(page_size_)) {
+      std::lock_guard<std::mutex> guard(fsm_latch_);
+      LoadFreeSpaceMap(header.data());
+    }
+  }
 
-  log_io_.open(log_name_,
-               std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app |
-                                std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app |
-                                std::ios::out);
-  }
-
-  db_io_.open(db_file,
-              std::ios::binary | std::ios::in | std::ios::out | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+  // only now, the header read above is not aligned. File systems without
+  // O_DIRECT support (e.g. tmpfs) refuse the flag, stay buffered then. It
+  // is all files or none, bouncing is decided for the tablespace
+  if (direct_io) {
+    size_t set = 0;
+    for (; set < db_fds_.size(); ++set) {
+      int flags = fcntl(db_fds_[set], F_GETFL);
+      if (flags < 0 || fcntl(db_fds_[set], F_SETFL, flags | O_DIRECT) != 0)
+        break;
+    }
+    direct_io_ = set == db_fds_.size();
+    if (!direct_io_) {
+      LOG_DEBUG("O_DIRECT not supported, using buffered I/O");
+      while (set-- > 0) {
+        int flags = fcntl(db_fds_[set], F_GETFL);
+        fcntl(db_fds_[set], F_SETFL, flags & ~O_DIRECT);
+      }
+    }
   }
 }
 
 DiskManager::~DiskManager() {
-  db_io_.close();
-  log_io_.close();
+  for (size_t file = 0; file < mappings_.size(); ++file) {
+    if (mappings_[file] != nullptr)
+      munmap(mappings_[file], mapping_sizes_[file]);
+  }
+  for (int fd : db_fds_) {
+    if (fd >= 0)
+      close(fd);
+  }
+  if (log_preallocator_ != nullptr) {
+    {
+      std::lock_guard<std::mutex> guard(log_latch_);
+      log_preallocating_ = false;
+    }
+    log_cv_.notify_one();
+    log_preallocator_->join();
+    delete log_preallocator_;
+  }
+  for (auto &file : log_fds_) {
+    close(file.second);
+  }
 }
 
 /**
  * Write the contents of the specified page into disk file
+ * Safe to call concurrently, for different pages. The checksum is stamped
+ * into a copy, page_data may be changed by others while it is written
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = page_id * PAGE_SIZE;
-  // set write cursor to offset
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
+  if (read_only_) {
+    LOG_DEBUG("write to a read-only database");
+    return;
+  }
+  if (checksums_) {
+    void *stamped = nullptr;
+    if (posix_memalign(&stamped, DIRECT_IO_ALIGNMENT, page_size_) != 0) {
+      LOG_DEBUG("I/O error while writing");
+      return;
+    }
+    memcpy(stamped, page_data, page_size_);
+    StampPage(static_cast<char *>(stamped));
+    WriteRaw(page_id, static_cast<const char *>(stamped));
+    free(stamped);
+    return;
+  }
+  WriteRaw(page_id, page_data);
+}
+
+/**
+ * Private helper function to write a page as it is
+ */
+void DiskManager::WriteRaw(page_id_t page_id, const char *page_data) {
+  if (read_only_) {
+    LOG_DEBUG("write to a read-only database");
+    return;
+  }
+  if (NeedsBounce(page_data)) {
+    void *aligned = nullptr;
+    if (posix_memalign(&aligned, DIRECT_IO_ALIGNMENT, page_size_) != 0) {
+      LOG_DEBUG("I/O error while writing");
+      return;
+    }
+    memcpy(aligned, page_data, page_size_);
+    WriteRaw(page_id, static_cast<const char *>(aligned));
+    free(aligned);
+    return;
+  }
+  PageLocation location = Locate(page_id);
+  size_t written = 0;
+  while (written < page_size_) {
+    ssize_t rc = pwrite(db_fds_[location.file_], page_data + written,
+                        page_size_ - written, location.offset_ + written);
+    if (rc < 0 && errno == EINTR)
+      continue;
+    // check for I/O error
+    if (rc <= 0) {
+      LOG_DEBUG("I/O error while writing");
+      return;
+    }
+    written += rc;
+  }
+  // no user-space buffer to flush, the page is in the OS page cache
+  GrowFileSize((static_cast<size_t>(page_id) + 1) * page_size_);
+}
+
+/**
+ * Write a set of pages, coalescing adjacent page ids into one vectored write
+ * each, so a flush of many neighbouring pages becomes few large sequential
+ * writes. A run ends at a stripe unit boundary, the next page is in another
+ * file. Direct I/O with a misaligned buffer goes page by page
+ */
+void DiskManager::WritePages(const page_id_t *page_ids,
+                             const char *const *page_data, size_t count) {
+  if (read_only_) {
+    LOG_DEBUG("write to a read-only database");
     return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  // stamp copies, as WritePage does, the batch is written from them
+  std::unique_ptr<char, decltype(&free)> staging(nullptr, &free);
+  std::vector<const char *> stamped;
+  if (checksums_ && count > 0) {
+    void *buffer = nullptr;
+    if (posix_memalign(&buffer, DIRECT_IO_ALIGNMENT, count * page_size_) != 0) {
+      LOG_DEBUG("I/O error while writing");
+      return;
+    }
+    staging.reset(static_cast<char *>(buffer));
+    for (size_t i = 0; i < count; ++i) {
+      char *copy = staging.get() + i * page_size_;
+      memcpy(copy, page_data[i], page_size_);
+      StampPage(copy);
+      stamped.push_back(copy);
+    }
+    page_data = stamped.data();
+  }
+  std::vector<size_t> order(count);
+  for (size_t i = 0; i < count; ++i) {
+    order[i] = i;
+    if (NeedsBounce(page_data[i])) {
+      for (size_t j = 0; j < count; ++j)
+        WriteRaw(page_ids[j], page_data[j]);
+      return;
+    }
+  }
+  std::sort(order.begin(), order.end(), [page_ids](size_t a, size_t b) {
+    return page_ids[a] < page_ids[b];
+  });
+
+  size_t max_run = static_cast<size_t>(std::max(1L, sysconf(_SC_IOV_MAX)));
+  std::vector<struct iovec> iov;
+  for (size_t begin = 0; begin < count;) {
+    // pages [begin, end) of order are consecutive on disk
+    size_t end = begin + 1;
+    while (end < count && end - begin < max_run &&
+           page_ids[order[end]] == page_ids[order[end - 1]] + 1 &&
+           page_ids[order[end]] % stripe_pages_ != 0) {
+      ++end;
+    }
+    iov.clear();
+    for (size_t i = begin; i < end; ++i) {
+      iov.push_back({const_cast<char *>(page_data[order[i]]), page_size_});
+    }
+    PageLocation location = Locate(page_ids[order[begin]]);
+    size_t length = (end - begin) * page_size_;
+    size_t written = 0;
+    struct iovec *next = iov.data();
+    int remaining = static_cast<int>(iov.size());
+    while (written < length) {
+      ssize_t rc = pwritev(db_fds_[location.file_], next, remaining,
+                           location.offset_ + written);
+      if (rc < 0 && errno == EINTR)
+        continue;
+      // check for I/O error
+      if (rc <= 0) {
+        LOG_DEBUG("I/O error while writing");
+        return;
+      }
+      written += rc;
+      // skip what a short write did take
+      size_t done = rc;
+      while (remaining > 0 && done >= next->iov_len) {
+        done -= next->iov_len;
+        ++next;
+        --remaining;
+      }
+      if (remaining > 0) {
+        next->iov_base = static_cast<char *>(next->iov_base) + done;
+        next->iov_len -= done;
+      }
+    }
+    GrowFileSize((static_cast<size_t>(page_ids[order[end - 1]]) + 1) *
+                 page_size_);
+    begin = end;
+  }
 }
 
 /**
  * Read the contents of the specified page into the given memory area
+ * Safe to call concurrently
+ */
+bool DiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  ReadRaw(page_id, page_data);
+  return VerifyPage(page_id, page_data);
+}
+
+/**
+ * Private helper function to read a page as it is
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id * PAGE_SIZE;
+void DiskManager::ReadRaw(page_id_t page_id, char *page_data) {
+  const char *mapped = GetMappedPage(page_id);
+  if (mapped != nullptr) {
+    memcpy(page_data, mapped, page_size_);
+    return;
+  }
+  if (NeedsBounce(page_data)) {
+    void *aligned = nullptr;
+    if (posix_memalign(&aligned, DIRECT_IO_ALIGNMENT, page_size_) != 0) {
+      LOG_DEBUG("I/O error while reading");
+      return;
+    }
+    memcpy(aligned, page_data, page_size_);
+    ReadRaw(page_id, static_cast<char *>(aligned));
+    memcpy(page_data, aligned, page_size_);
+    free(aligned);
+    return;
+  }
   // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
+  if (static_cast<size_t>(page_id) * page_size_ > db_file_size_.load()) {
     LOG_DEBUG("I/O error while reading");
     // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
-    }
+    return;
+  }
+  PageLocation location = Locate(page_id);
+  size_t read_count = 0;
+  while (read_count < page_size_) {
+    ssize_t rc = pread(db_fds_[location.file_], page_data + read_count,
+                       page_size_ - read_count, location.offset_ + read_count);
+    if (rc < 0 && errno == EINTR)
+      continue;
+    if (rc <= 0)
+      break;
+    read_count += rc;
+  }
+  // if file ends before reading a whole page
+  if (read_count < page_size_) {
+    LOG_DEBUG("Read less than a page");
+    // std::cerr << "Read less than a page" << std::endl;
+    memset(page_data + read_count, 0, page_size_ - read_count);
+  }
+}
+
+/**
+ * The checksum covers the whole page image with the checksum field as zero.
+ * 0 is kept for pages never stamped, a computed 0 is stored as 1
+ */
+uint32_t DiskManager::PageChecksum(const char *page_data) const {
+  static const char zero[sizeof(uint32_t)] = {0};
+  uint32_t crc = Crc32c(page_data, PAGE_CHECKSUM_OFFSET);
+  crc = Crc32c(zero, sizeof(zero), crc);
+  crc = Crc32c(page_data + PAGE_CHECKSUM_OFFSET + sizeof(uint32_t),
+               page_size_ - PAGE_CHECKSUM_OFFSET - sizeof(uint32_t), crc);
+  return crc == 0 ? 1 : crc;
+}
+
+void DiskManager::StampPage(char *page_data) {
+  if (!checksums_ || read_only_)
+    return;
+  auto start = std::chrono::steady_clock::now();
+  uint32_t checksum = PageChecksum(page_data);
+  memcpy(page_data + PAGE_CHECKSUM_OFFSET, &checksum, sizeof(checksum));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  pages_stamped_.fetch_add(1, std::memory_order_relaxed);
+  stamp_ns_.fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+      std::memory_order_relaxed);
+}
+
+bool DiskManager::VerifyPage(page_id_t page_id, const char *page_data) {
+  uint32_t stored;
+  memcpy(&stored, page_data + PAGE_CHECKSUM_OFFSET, sizeof(stored));
+  if (!checksums_ || stored == 0)
+    return true;
+  auto start = std::chrono::steady_clock::now();
+  bool match = PageChecksum(page_data) == stored;
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  pages_verified_.fetch_add(1, std::memory_order_relaxed);
+  verify_ns_.fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+      std::memory_order_relaxed);
+  if (!match) {
+    checksum_failures_.fetch_add(1, std::memory_order_relaxed);
+    LOG_DEBUG("checksum mismatch on page %d", page_id);
   }
+  return match;
+}
+
+ChecksumStats DiskManager::GetChecksumStats() const {
+  ChecksumStats stats;
+  stats.pages_stamped = pages_stamped_.load(std::memory_order_relaxed);
+  stats.stamp_ns = stamp_ns_.load(std::memory_order_relaxed);
+  stats.pages_verified = pages_verified_.load(std::memory_order_relaxed);
+  stats.verify_ns = verify_ns_.load(std::memory_order_relaxed);
+  stats.failures = checksum_failures_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+LogWriteStats DiskManager::GetLogWriteStats() const {
+  LogWriteStats stats;
+  stats.writes = log_writes_.load(std::memory_order_relaxed);
+  stats.bytes = log_bytes_.load(std::memory_order_relaxed);
+  stats.errors = log_write_errors_.load(std::memory_order_relaxed);
+  stats.write_ns = log_write_ns_.Snapshot();
+  return stats;
 }
 
 /**
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
+ * A write that does not fit into the current log file goes on in the next
+ * @return: false on an I/O error, the log then ends where it did before
  */
-void DiskManager::WriteLog(char *log_data, int size) {
-  // enforce swap log buffer
-  assert(log_data != buffer_used);
-  buffer_used = log_data;
+bool DiskManager::WriteLog(char *log_data, int size) {
+  // enforce swap log buffer, consecutive flushes write different segments
+  assert(log_data != buffer_used_);
+  buffer_used_ = log_data;
 
   if (size == 0) // no effect on num_flushes_ if log buffer is empty
-    return;
+    return true;
 
   flush_log_ = true;
 
@@ -121,53 +472,487 @@ void DiskManager::WriteLog(char *log_data, int size) {
 
   num_flushes_ += 1;
   // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
+  std::lock_guard<std::mutex> guard(log_latch_);
+  auto start = std::chrono::steady_clock::now();
+  size_t start_size = log_size_;
+  std::vector<int> fds;
+  int written = 0;
+  while (written < size) {
+    size_t file = log_size_ / LOG_FILE_SIZE;
+    size_t offset = log_size_ % LOG_FILE_SIZE;
+    size_t count =
+        std::min<size_t>(size - written, LOG_FILE_SIZE - offset);
+    int fd = GetLogFile(file);
+    ssize_t result =
+        fd < 0 ? -1 : pwrite(fd, log_data + written, count, offset);
+    // check for I/O error
+    if (result <= 0) {
+      LOG_DEBUG("I/O error while writing log");
+      log_write_errors_.fetch_add(1, std::memory_order_relaxed);
+      log_size_ = start_size;
+      buffer_used_ = nullptr; // the same buffer is written again
+      flush_log_ = false;
+      return false;
+    }
+    if (fds.empty() || fds.back() != fd) {
+      fds.push_back(fd);
+    }
+    written += result;
+    log_size_ += result;
+  }
+  // the records are durable only once every file written to is synced
+  for (int fd : fds) {
+    if (fdatasync(fd) != 0) {
+      LOG_DEBUG("I/O error while syncing log");
+      log_write_errors_.fetch_add(1, std::memory_order_relaxed);
+      log_size_ = start_size;
+      buffer_used_ = nullptr;
+      flush_log_ = false;
+      return false;
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  log_writes_.fetch_add(1, std::memory_order_relaxed);
+  log_bytes_.fetch_add(written, std::memory_order_relaxed);
+  log_write_ns_.Record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  // the next file is ready before the log gets there
+  if (log_size_ % LOG_FILE_SIZE >= LOG_FILE_SIZE / 2) {
+    PreallocateLogFile(log_size_ / LOG_FILE_SIZE + 1);
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
+  return true;
 }
 
 /**
  * Read the contents of the log into the given memory area
  * Always read from the beginning and perform sequence read
  * @return: false means already reach the end
+ * Reads may span log files, what lies past the end of the log or in a
+ * truncated file is returned as zeros
  */
-bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
+bool DiskManager::ReadLog(char *log_data, int size, log_offset_t offset) {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  if (offset < 0 || static_cast<size_t>(offset) >= log_size_) {
     // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+  size_t pos = offset;
+  int read_count = 0;
+  while (read_count < size && pos < log_size_) {
+    auto it = log_fds_.find(pos / LOG_FILE_SIZE);
+    if (it == log_fds_.end()) {
+      break;
+    }
+    size_t count = std::min<size_t>(
+        {static_cast<size_t>(size - read_count),
+         LOG_FILE_SIZE - pos % LOG_FILE_SIZE, log_size_ - pos});
+    ssize_t result =
+        pread(it->second, log_data + read_count, count, pos % LOG_FILE_SIZE);
+    if (result <= 0) {
+      break;
+    }
+    read_count += result;
+    pos += result;
+  }
   // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
+  memset(log_data + read_count, 0, size - read_count);
+  return read_count > 0;
+}
+
+log_offset_t DiskManager::GetLogSize() {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  return static_cast<log_offset_t>(log_size_);
+}
+
+log_offset_t DiskManager::GetLogStart() {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  if (log_fds_.empty()) {
+    return static_cast<log_offset_t>(log_size_);
   }
+  return static_cast<log_offset_t>(log_fds_.begin()->first * LOG_FILE_SIZE);
+}
 
-  return true;
+/*
+ * The first file is emptied rather than deleted, it marks the log as one
+ * that exists, see OpenLog. The file holding the last byte of the log
+ * stays, so there is always one to find the end of the log from
+ */
+size_t DiskManager::TruncateLog(log_offset_t offset) {
+  if (read_only_ || offset <= 0)
+    return 0;
+  std::lock_guard<std::mutex> guard(log_latch_);
+  if (log_size_ == 0)
+    return 0;
+  size_t end = std::min<size_t>(offset, log_size_ - 1) / LOG_FILE_SIZE;
+  size_t removed = 0;
+  for (auto it = log_fds_.begin(); it != log_fds_.end() && it->first < end;) {
+    if (it->first == 0) {
+      if (ftruncate(it->second, 0) != 0) {
+        LOG_DEBUG("can't empty the first log file");
+      }
+    } else {
+      unlink(LogFileName(it->first).c_str());
+    }
+    close(it->second);
+    it = log_fds_.erase(it);
+    ++removed;
+  }
+  return removed;
+}
+
+/**
+ * Private helper functions of the log files
+ * Without the first file there is no log, other files are left over from a
+ * deleted one and are removed. Otherwise the log ends in the last file that
+ * is not empty, files past it are preallocated. An empty first file before
+ * it is what truncation left
+ */
+void DiskManager::OpenLog() {
+  std::string::size_type slash = log_name_.rfind('/');
+  std::string dir_name =
+      slash == std::string::npos ? "." : log_name_.substr(0, slash);
+  std::string base_name =
+      slash == std::string::npos ? log_name_ : log_name_.substr(slash + 1);
+  struct stat stat_buf;
+  bool exists = stat(log_name_.c_str(), &stat_buf) == 0;
+  DIR *dir = opendir(dir_name.c_str());
+  if (dir != nullptr) {
+    while (struct dirent *entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      size_t file = 0;
+      if (name != base_name) {
+        std::string number = name.substr(std::min(name.size(),
+                                                  base_name.size() + 1));
+        if (name.compare(0, base_name.size() + 1, base_name + ".") != 0 ||
+            number.empty() ||
+            number.find_first_not_of("0123456789") != std::string::npos)
+          continue;
+        file = std::strtoul(number.c_str(), nullptr, 10);
+      }
+      if (!exists) {
+        if (!read_only_)
+          unlink(LogFileName(file).c_str());
+        continue;
+      }
+      int fd = open(LogFileName(file).c_str(), read_only_ ? O_RDONLY : O_RDWR);
+      if (fd >= 0)
+        log_fds_[file] = fd;
+    }
+    closedir(dir);
+  }
+  for (auto &file : log_fds_) {
+    if (fstat(file.second, &stat_buf) == 0 && stat_buf.st_size > 0) {
+      log_size_ = file.first * LOG_FILE_SIZE + stat_buf.st_size;
+    }
+  }
+  auto first = log_fds_.find(0);
+  if (first != log_fds_.end() && log_size_ > LOG_FILE_SIZE &&
+      fstat(first->second, &stat_buf) == 0 && stat_buf.st_size == 0) {
+    close(first->second);
+    log_fds_.erase(first);
+  }
+  if (!read_only_) {
+    std::lock_guard<std::mutex> guard(log_latch_);
+    GetLogFile(log_size_ / LOG_FILE_SIZE);
+  }
+}
+
+std::string DiskManager::LogFileName(size_t file) const {
+  if (file == 0)
+    return log_name_;
+  return log_name_ + "." + std::to_string(file);
+}
+
+int DiskManager::OpenLogFile(size_t file) {
+  int fd = open(LogFileName(file).c_str(), O_RDWR | O_CREAT, 0644);
+  // the size is left alone, it tells where the log ends
+  if (fd >= 0 && fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, LOG_FILE_SIZE) != 0) {
+    LOG_DEBUG("fallocate not supported, log file grows on write");
+  }
+  return fd;
+}
+
+int DiskManager::GetLogFile(size_t file) {
+  auto it = log_fds_.find(file);
+  if (it != log_fds_.end())
+    return it->second;
+  int fd = OpenLogFile(file);
+  if (fd >= 0)
+    log_fds_[file] = fd;
+  return fd;
+}
+
+void DiskManager::PreallocateLogFile(size_t file) {
+  if (log_fds_.count(file) != 0 || log_preallocate_file_ == file)
+    return;
+  log_preallocate_file_ = file;
+  if (log_preallocator_ == nullptr) {
+    log_preallocating_ = true;
+    log_preallocator_ =
+        new std::thread(&DiskManager::PreallocateLogThread, this);
+  }
+  log_cv_.notify_one();
+}
+
+void DiskManager::PreallocateLogThread() {
+  std::unique_lock<std::mutex> lock(log_latch_);
+  while (true) {
+    log_cv_.wait(lock, [this] {
+      return !log_preallocating_ || log_preallocate_file_ != 0;
+    });
+    if (!log_preallocating_)
+      return;
+    size_t file = log_preallocate_file_;
+    if (log_fds_.count(file) != 0) {
+      log_preallocate_file_ = 0;
+      continue;
+    }
+    lock.unlock();
+    int fd = OpenLogFile(file);
+    lock.lock();
+    log_preallocate_file_ = 0;
+    // the writer got there first
+    if (fd >= 0 && !log_fds_.emplace(file, fd).second)
+      close(fd);
+  }
 }
 
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * The lowest free page is reused, the lowest one prefer accepts if any, the
+ * file only grows if there is none.
+ * The bitmap page is written before the page is handed out, a crash can
+ * leak a free page but never hand out one in use
+ */
+page_id_t DiskManager::AllocatePage(
+    page_id_t near_page_id, const std::function<bool(page_id_t)> &prefer) {
+  if (read_only_)
+    return INVALID_PAGE_ID;
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  if (near_page_id != INVALID_PAGE_ID) {
+    size_t end = std::min(static_cast<size_t>(near_page_id) + EXTENT_SIZE + 1,
+                          free_bits_.size() * 8);
+    for (size_t page_id = near_page_id + 1; free_count_ > 0 && page_id < end;
+         ++page_id) {
+      if (IsFree(page_id))
+        return TakeFreePage(page_id);
+    }
+    // the chain ends near the end of the file, keep it there
+    if (near_page_id + EXTENT_SIZE >= next_page_id_)
+      return AppendPage();
+  }
+  if (free_count_ > 0 && prefer != nullptr) {
+    for (size_t byte = 0; byte < free_bits_.size(); ++byte) {
+      for (unsigned bits = free_bits_[byte]; bits != 0; bits &= bits - 1) {
+        size_t page_id = byte * 8 + __builtin_ctz(bits);
+        if (prefer(static_cast<page_id_t>(page_id)))
+          return TakeFreePage(page_id);
+      }
+    }
+  }
+  if (free_count_ > 0) {
+    for (size_t byte = 0; byte < free_bits_.size(); ++byte) {
+      if (free_bits_[byte] != 0)
+        return TakeFreePage(byte * 8 + __builtin_ctz(free_bits_[byte]));
+    }
+  }
+  return AppendPage();
+}
+
+/**
+ * Private helper function to hand a free page out
+ */
+page_id_t DiskManager::TakeFreePage(size_t page_id) {
+  free_bits_[page_id / 8] &= ~(1u << (page_id % 8));
+  --free_count_;
+  WriteMapPage(page_id / PagesPerMapPage());
+  return static_cast<page_id_t>(page_id);
+}
+
+/**
+ * Private helper function to grow the file by a page. Space is reserved a
+ * whole extent at a time, without changing the file length: only pages
+ * really written count as part of the file
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+page_id_t DiskManager::AppendPage() {
+  page_id_t page_id = next_page_id_++;
+  if (preallocate_ && page_id >= preallocated_pages_) {
+    page_id_t extent_end = (page_id / EXTENT_SIZE + 1) * EXTENT_SIZE;
+    if (Preallocate(page_id, extent_end)) {
+      preallocated_pages_ = extent_end;
+    } else {
+      LOG_DEBUG("fallocate not supported, growing page by page");
+      preallocate_ = false;
+    }
+  }
+  return page_id;
+}
+
+/**
+ * Private helper function to reserve the space of pages [begin, end), one
+ * fallocate per piece of a stripe unit
+ */
+bool DiskManager::Preallocate(page_id_t begin, page_id_t end) {
+  while (begin < end) {
+    page_id_t unit_end = std::min<page_id_t>(
+        end, (begin / stripe_pages_ + 1) * stripe_pages_);
+    PageLocation location = Locate(begin);
+    if (fallocate(db_fds_[location.file_], FALLOC_FL_KEEP_SIZE,
+                  static_cast<off_t>(location.offset_),
+                  static_cast<off_t>(unit_end - begin) * page_size_) != 0)
+      return false;
+    begin = unit_end;
+  }
+  return true;
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
+ * Bitmap pages are added to the end of the file as the page ids grow
+ */
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  if (read_only_ || page_id <= HEADER_PAGE_ID || page_id >= next_page_id_)
+    return;
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  if (std::find(fsm_pages_.begin(), fsm_pages_.end(), page_id) !=
+      fsm_pages_.end())
+    return;
+  size_t index = static_cast<size_t>(page_id) / PagesPerMapPage();
+  while (fsm_pages_.size() <= index) {
+    fsm_pages_.push_back(AppendPage());
+    free_bits_.resize(fsm_pages_.size() * PagesPerMapPage() / 8, 0);
+    WriteMapPage(fsm_pages_.size() - 1);
+    // link it from its predecessor
+    if (fsm_pages_.size() > 1)
+      WriteMapPage(fsm_pages_.size() - 2);
+  }
+  if (IsFree(page_id))
+    return;
+  free_bits_[page_id / 8] |= 1u << (page_id % 8);
+  ++free_count_;
+  WriteMapPage(index);
+}
+
+/**
+ * Pages allocated before a crash and never written lie past the end of the
+ * file, which the next page counts from after a restart. Appending up to
+ * page_id keeps them from being handed out again
+ */
+void DiskManager::ClaimPage(page_id_t page_id) {
+  if (read_only_ || page_id <= HEADER_PAGE_ID)
+    return;
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  while (next_page_id_ <= page_id)
+    AppendPage();
+}
+
+page_id_t DiskManager::GetFreeSpaceMapPageId() {
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  return fsm_pages_.empty() ? INVALID_PAGE_ID : fsm_pages_[0];
+}
+
+size_t DiskManager::GetFreePageCount() {
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  return free_count_;
+}
+
+/**
+ * Truncate the file after the last page that is neither free nor a bitmap
+ * page. Truncated page ids drop out of the bitmap, they come back as new
+ * pages at the end of the file
+ */
+size_t DiskManager::ShrinkFile() {
+  if (read_only_)
+    return 0;
+  std::lock_guard<std::mutex> guard(fsm_latch_);
+  page_id_t page_count = next_page_id_;
+  std::vector<bool> touched(fsm_pages_.size(), false);
+  while (page_count > HEADER_PAGE_ID + 1 &&
+         static_cast<size_t>(page_count - 1) < free_bits_.size() * 8 &&
+         IsFree(page_count - 1)) {
+    --page_count;
+    free_bits_[page_count / 8] &= ~(1u << (page_count % 8));
+    --free_count_;
+    touched[page_count / PagesPerMapPage()] = true;
+  }
+  size_t trimmed = next_page_id_ - page_count;
+  if (trimmed == 0)
+    return 0;
+  for (size_t i = 0; i < touched.size(); ++i) {
+    if (touched[i])
+      WriteMapPage(i);
+  }
+  next_page_id_ = page_count;
+  preallocated_pages_ = page_count;
+  for (size_t file = 0; file < db_fds_.size(); ++file) {
+    off_t length = LocalPageCount(file, page_count) * page_size_;
+    if (ftruncate(db_fds_[file], length) != 0) {
+      LOG_DEBUG("can't truncate db file");
+    }
+  }
+  size_t file_size = static_cast<size_t>(page_count) * page_size_;
+  if (db_file_size_ > file_size)
+    db_file_size_ = file_size;
+  return trimmed;
+}
+
+/**
+ * Private helper function to count the pages of file below page_count:
+ * the whole stripe units of the file, plus the tail of a last partial unit
+ */
+size_t DiskManager::LocalPageCount(size_t file, size_t page_count) const {
+  size_t files = db_fds_.size();
+  size_t units = page_count / stripe_pages_;
+  size_t pages = (units / files + (file < units % files ? 1 : 0)) *
+                 stripe_pages_;
+  if (units % files == file)
+    pages += page_count % stripe_pages_;
+  return pages;
+}
+
+/**
+ * Private helper function to find the bitmap from the raw header page, it
+ * is read before any buffer pool caches it
+ */
+void DiskManager::LoadFreeSpaceMap(const char *header_page) {
+  page_id_t map_page_id = INVALID_PAGE_ID;
+  if (!HeaderPage::GetRootId(header_page, page_size_, FREE_SPACE_MAP_RECORD,
+                             map_page_id))
+    return;
+  std::vector<char> page(page_size_);
+  while (map_page_id > HEADER_PAGE_ID && map_page_id < next_page_id_ &&
+         fsm_pages_.size() < static_cast<size_t>(next_page_id_)) {
+    PageLocation location = Locate(map_page_id);
+    if (pread(db_fds_[location.file_], page.data(), page_size_,
+              location.offset_) !=
+            static_cast<ssize_t>(page_size_) ||
+        !VerifyPage(map_page_id, page.data()))
+      break;
+    fsm_pages_.push_back(map_page_id);
+    free_bits_.insert(free_bits_.end(), page.begin() + MAP_BITS_OFFSET,
+                      page.end());
+    memcpy(&map_page_id, page.data(), sizeof(map_page_id));
+  }
+  for (size_t page_id = 0; page_id < free_bits_.size() * 8; ++page_id) {
+    if (IsFree(page_id)) {
+      ++free_count_;
+    }
+  }
+}
+
+/**
+ * Private helper function to persist bitmap page index of the chain
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-  return;
+void DiskManager::WriteMapPage(size_t index) {
+  std::vector<char> page(page_size_);
+  page_id_t next_page_id = index + 1 < fsm_pages_.size()
+                               ? fsm_pages_[index + 1]
+                               : INVALID_PAGE_ID;
+  memcpy(page.data(), &next_page_id, sizeof(next_page_id));
+  size_t bytes = PagesPerMapPage() / 8;
+  memcpy(page.data() + MAP_BITS_OFFSET, &free_bits_[index * bytes], bytes);
+  WritePage(fsm_pages_[index], page.data());
 }
 
 /**
@@ -181,12 +966,13 @@ int DiskManager::GetNumFlushes() const { return num_flushes_; }
 bool DiskManager::GetFlushState() const { return flush_log_; }
 
 /**
- * Private helper function to get disk file size
+ * Private helper function to track the db file length, it only grows
  */
-int DiskManager::GetFileSize(const std::string &file_name) {
-  struct stat stat_buf;
-  int rc = stat(file_name.c_str(), &stat_buf);
-  return rc == 0 ? stat_buf.st_size : -1;
+void DiskManager::GrowFileSize(size_t end) {
+  size_t file_size = db_file_size_.load();
+  while (file_size < end &&
+         !db_file_size_.compare_exchange_weak(file_size, end)) {
+  }
 }
 
 } // namespace cmudb
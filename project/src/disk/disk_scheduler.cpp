@@ -0,0 +1,394 @@
+/**
+ * disk_scheduler.cpp
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "disk/disk_scheduler.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define CMUDB_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace cmudb {
+
+#ifdef CMUDB_HAVE_IO_URING
+/*
+ * The rings of one io_uring, mapped from the kernel. The submission queue is
+ * only written under submit_latch_, the completion queue only read by the
+ * reaper thread, so each side has a single producer and a single consumer
+ */
+struct IoUring {
+  int fd_ = -1;
+  unsigned entries_ = 0;
+  void *sq_ring_ = MAP_FAILED;
+  size_t sq_ring_size_ = 0;
+  void *cq_ring_ = MAP_FAILED;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe *sqes_ = static_cast<io_uring_sqe *>(MAP_FAILED);
+  size_t sqes_size_ = 0;
+  unsigned *sq_tail_, *sq_mask_, *sq_array_;
+  unsigned *cq_head_, *cq_tail_, *cq_mask_;
+  io_uring_cqe *cqes_;
+  size_t in_ring_ = 0; // submitted, not reaped, guarded by the scheduler latch
+  std::mutex submit_latch_;
+
+  ~IoUring() {
+    if (sqes_ != MAP_FAILED)
+      munmap(sqes_, sqes_size_);
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_)
+      munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_ != MAP_FAILED)
+      munmap(sq_ring_, sq_ring_size_);
+    if (fd_ >= 0)
+      close(fd_);
+  }
+
+  // false if the kernel refuses, the caller falls back to threads
+  bool Setup(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0) {
+      return false;
+    }
+    entries_ = params.sq_entries;
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    cq_ring_ = single_mmap
+                   ? sq_ring_
+                   : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(
+        mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+      return false;
+    }
+    char *sq = static_cast<char *>(sq_ring_);
+    char *cq = static_cast<char *>(cq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  // queue one sqe, submit_latch_ held and a free slot reserved
+  void Push(uint8_t opcode, int fd, char *data, unsigned length,
+            size_t offset, DiskRequest *request) {
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & *sq_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = length;
+    sqe->off = offset;
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  }
+
+  // hand count queued sqes to the kernel, submit_latch_ held
+  void Submit(unsigned count) {
+    while (count > 0) {
+      long rc = syscall(__NR_io_uring_enter, fd_, count, 0, 0, nullptr, 0);
+      if (rc < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+          std::this_thread::yield();
+          continue;
+        }
+        LOG_DEBUG("io_uring_enter failed: %s", strerror(errno));
+        return;
+      }
+      count -= static_cast<unsigned>(rc);
+    }
+  }
+};
+#else
+struct IoUring {
+  size_t in_ring_;
+};
+#endif
+
+/*
+ * Constructor: try io_uring first, start the worker threads if it is not
+ * usable
+ */
+DiskScheduler::DiskScheduler(DiskManager *disk_manager, size_t queue_depth,
+                             size_t num_workers, bool use_io_uring)
+    : disk_manager_(disk_manager), ring_(nullptr), shutdown_(false),
+      outstanding_(0) {
+#ifdef CMUDB_HAVE_IO_URING
+  if (use_io_uring) {
+    ring_ = new IoUring;
+    if (ring_->Setup(static_cast<unsigned>(queue_depth))) {
+      threads_.emplace_back([this] { RunReaper(); });
+      return;
+    }
+    LOG_DEBUG("io_uring not available, using worker threads");
+    delete ring_;
+    ring_ = nullptr;
+  }
+#endif
+  (void)queue_depth;
+  (void)use_io_uring;
+  for (size_t i = 0; i < std::max<size_t>(num_workers, 1); ++i) {
+    threads_.emplace_back([this] { RunWorker(); });
+  }
+}
+
+/*
+ * Destructor: drain, then stop the reaper with a no-op (or the workers)
+ */
+DiskScheduler::~DiskScheduler() {
+  Drain();
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    shutdown_ = true;
+  }
+  work_cv_.notify_all();
+#ifdef CMUDB_HAVE_IO_URING
+  if (ring_ != nullptr) {
+    std::lock_guard<std::mutex> guard(ring_->submit_latch_);
+    ring_->Push(IORING_OP_NOP, -1, nullptr, 0, 0, nullptr);
+    ring_->Submit(1);
+  }
+#endif
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+  delete ring_;
+}
+
+void DiskScheduler::Schedule(DiskRequest request) {
+  std::vector<DiskRequest> requests;
+  requests.push_back(std::move(request));
+  Schedule(requests);
+}
+
+/*
+ * Reads past the end of the file complete right away with the buffer
+ * untouched, like DiskManager::ReadPage. Writes grow the cached file length
+ * before they are submitted, so a later read of the page is not cut short
+ */
+void DiskScheduler::Schedule(std::vector<DiskRequest> &requests) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    outstanding_ += requests.size();
+  }
+  size_t page_size = disk_manager_->GetPageSize();
+  std::vector<DiskRequest> pending;
+  for (auto &request : requests) {
+    size_t offset = static_cast<size_t>(request.page_id_) * page_size;
+    if (request.is_write_) {
+      disk_manager_->StampPage(request.data_);
+      disk_manager_->GrowFileSize(offset + page_size);
+    } else if (offset > disk_manager_->db_file_size_.load()) {
+      Complete(request);
+      continue;
+    }
+    pending.push_back(std::move(request));
+  }
+  requests.clear();
+  if (pending.empty()) {
+    return;
+  }
+
+  if (ring_ != nullptr) {
+    SubmitToRing(pending);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    for (auto &request : pending) {
+      queue_.push_back(std::move(request));
+    }
+  }
+  work_cv_.notify_all();
+}
+
+std::future<void> DiskScheduler::ReadPageAsync(page_id_t page_id,
+                                               char *page_data) {
+  auto promise = std::make_shared<std::promise<void>>();
+  std::future<void> future = promise->get_future();
+  DiskManager *disk_manager = disk_manager_;
+  Schedule(DiskRequest{false, page_id, page_data,
+                       [promise, disk_manager, page_id, page_data] {
+                         if (disk_manager->VerifyPage(page_id, page_data)) {
+                           promise->set_value();
+                         } else {
+                           promise->set_exception(std::make_exception_ptr(
+                               Exception(EXCEPTION_TYPE_IO,
+                                         "page checksum mismatch")));
+                         }
+                       }});
+  return future;
+}
+
+std::future<void> DiskScheduler::WritePageAsync(page_id_t page_id,
+                                                const char *page_data) {
+  auto promise = std::make_shared<std::promise<void>>();
+  std::future<void> future = promise->get_future();
+  // the checksum is stamped into a copy, page_data is the caller's
+  auto copy = std::make_shared<std::vector<char>>(
+      page_data, page_data + disk_manager_->GetPageSize());
+  Schedule(DiskRequest{true, page_id, copy->data(),
+                       [promise, copy] { promise->set_value(); }});
+  return future;
+}
+
+void DiskScheduler::Drain() {
+  std::unique_lock<std::mutex> lock(latch_);
+  done_cv_.wait(lock, [this] { return outstanding_ == 0; });
+}
+
+void DiskScheduler::Complete(DiskRequest &request) {
+  if (request.callback_) {
+    request.callback_();
+  }
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    --outstanding_;
+  }
+  done_cv_.notify_all();
+}
+
+void DiskScheduler::RunWorker() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    work_cv_.wait(lock, [this] { return shutdown_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+    DiskRequest request = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    if (request.is_write_) {
+      disk_manager_->WriteRaw(request.page_id_, request.data_);
+    } else {
+      disk_manager_->ReadRaw(request.page_id_, request.data_);
+    }
+    Complete(request);
+    lock.lock();
+  }
+}
+
+#ifdef CMUDB_HAVE_IO_URING
+/*
+ * Requests whose buffer direct I/O cannot use are done synchronously, the
+ * rest fill the ring as far as it has room, one io_uring_enter per fill
+ */
+void DiskScheduler::SubmitToRing(std::vector<DiskRequest> &requests) {
+  size_t page_size = disk_manager_->GetPageSize();
+  std::unique_lock<std::mutex> submit(ring_->submit_latch_);
+  size_t next = 0;
+  while (next < requests.size()) {
+    size_t batch;
+    {
+      std::unique_lock<std::mutex> lock(latch_);
+      done_cv_.wait(lock, [this] { return ring_->in_ring_ < ring_->entries_; });
+      batch = std::min(requests.size() - next,
+                       ring_->entries_ - ring_->in_ring_);
+      ring_->in_ring_ += batch;
+    }
+    unsigned queued = 0;
+    for (size_t end = next + batch; next < end; ++next) {
+      DiskRequest &request = requests[next];
+      if (disk_manager_->NeedsBounce(request.data_)) {
+        if (request.is_write_) {
+          disk_manager_->WriteRaw(request.page_id_, request.data_);
+        } else {
+          disk_manager_->ReadRaw(request.page_id_, request.data_);
+        }
+        {
+          std::lock_guard<std::mutex> guard(latch_);
+          --ring_->in_ring_;
+        }
+        Complete(request);
+        continue;
+      }
+      PageLocation location = disk_manager_->Locate(request.page_id_);
+      ring_->Push(request.is_write_ ? IORING_OP_WRITE : IORING_OP_READ,
+                  disk_manager_->db_fds_[location.file_], request.data_,
+                  static_cast<unsigned>(page_size), location.offset_,
+                  new DiskRequest(std::move(request)));
+      ++queued;
+    }
+    ring_->Submit(queued);
+  }
+}
+
+/*
+ * Completion loop. A failed or short transfer is redone synchronously by
+ * the DiskManager, which also zero fills a read that hits the end of file
+ */
+void DiskScheduler::RunReaper() {
+  int page_size = static_cast<int>(disk_manager_->GetPageSize());
+  while (true) {
+    unsigned head = *ring_->cq_head_;
+    if (head == __atomic_load_n(ring_->cq_tail_, __ATOMIC_ACQUIRE)) {
+      syscall(__NR_io_uring_enter, ring_->fd_, 0, 1, IORING_ENTER_GETEVENTS,
+              nullptr, 0);
+      continue;
+    }
+    io_uring_cqe *cqe = &ring_->cqes_[head & *ring_->cq_mask_];
+    DiskRequest *request = reinterpret_cast<DiskRequest *>(cqe->user_data);
+    int result = cqe->res;
+    __atomic_store_n(ring_->cq_head_, head + 1, __ATOMIC_RELEASE);
+    if (request == nullptr) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> guard(latch_);
+      --ring_->in_ring_;
+    }
+    done_cv_.notify_all();
+    if (result != page_size) {
+      if (request->is_write_) {
+        disk_manager_->WriteRaw(request->page_id_, request->data_);
+      } else {
+        disk_manager_->ReadRaw(request->page_id_, request->data_);
+      }
+    }
+    Complete(*request);
+    delete request;
+  }
+}
+#else
+void DiskScheduler::SubmitToRing(std::vector<DiskRequest> &) {}
+void DiskScheduler::RunReaper() {}
+#endif
+
+} // namespace cmudb
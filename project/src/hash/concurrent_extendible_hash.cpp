@@ -0,0 +1,188 @@
+#include <list>
+
+#include "hash/concurrent_extendible_hash.h"
+#include "page/page.h"
+
+namespace cmudb
+{
+
+/*
+ * constructor
+ * array_size: fixed array size for each bucket
+ */
+template <typename K, typename V, typename Hash>
+ConcurrentExtendibleHash<K, V, Hash>::ConcurrentExtendibleHash(size_t size)
+    : bucket_size_(size), global_depth_(0),
+      directory_(new std::atomic<Node *>[2]) {
+  for (int i = 0; i < 2; i++) {
+    nodes_.emplace_back(
+        new Node(std::make_unique<Bucket<K, V, Hash>>(i, 0, bucket_size_)));
+    directory_[i] = nodes_.back().get();
+  }
+}
+
+template <typename K, typename V, typename Hash>
+size_t ConcurrentExtendibleHash<K, V, Hash>::HashKey(const K &key)
+{
+  return Hash()(key);
+}
+
+template <typename K, typename V, typename Hash>
+int ConcurrentExtendibleHash<K, V, Hash>::GetGlobalDepth()
+{
+  directory_latch_.RLock();
+  int global_depth = global_depth_;
+  directory_latch_.RUnlock();
+  return global_depth;
+}
+
+template <typename K, typename V, typename Hash>
+int ConcurrentExtendibleHash<K, V, Hash>::GetLocalDepth(int bucket_id)
+{
+  directory_latch_.RLock();
+  Node *node = directory_[bucket_id].load();
+  node->latch_.RLock();
+  int local_depth = node->bucket_->GetLocalDepth();
+  node->latch_.RUnlock();
+  directory_latch_.RUnlock();
+  return local_depth;
+}
+
+template <typename K, typename V, typename Hash>
+int ConcurrentExtendibleHash<K, V, Hash>::GetNumBuckets()
+{
+  directory_latch_.RLock();
+  int num_buckets = 1 << (global_depth_ + 1);
+  directory_latch_.RUnlock();
+  return num_buckets;
+}
+
+/*
+ * Retry until the latched node still owns hash, a split of the node between
+ * reading its slot and latching it sends the reader to the new slot value
+ */
+template <typename K, typename V, typename Hash>
+typename ConcurrentExtendibleHash<K, V, Hash>::Node *
+ConcurrentExtendibleHash<K, V, Hash>::LatchNode(size_t hash, bool exclusive)
+{
+  while (true) {
+    Node *node = GetNode(hash);
+    if (exclusive) {
+      node->latch_.WLock();
+    } else {
+      node->latch_.RLock();
+    }
+    if (Covers(node, hash)) {
+      return node;
+    }
+    if (exclusive) {
+      node->latch_.WUnlock();
+    } else {
+      node->latch_.RUnlock();
+    }
+  }
+}
+
+template <typename K, typename V, typename Hash>
+bool ConcurrentExtendibleHash<K, V, Hash>::Find(const K &key, V &value)
+{
+  directory_latch_.RLock();
+  Node *node = LatchNode(HashKey(key), false);
+  bool found = node->bucket_->Get(key, value);
+  node->latch_.RUnlock();
+  directory_latch_.RUnlock();
+  return found;
+}
+
+template <typename K, typename V, typename Hash>
+bool ConcurrentExtendibleHash<K, V, Hash>::Remove(const K &key)
+{
+  directory_latch_.RLock();
+  Node *node = LatchNode(HashKey(key), true);
+  bool removed = node->bucket_->Remove(key);
+  node->latch_.WUnlock();
+  directory_latch_.RUnlock();
+  return removed;
+}
+
+/*
+ * Like ExtendibleHash::Insert, the bucket splits once it is full. Racing
+ * inserts can take a bucket past full before one of them splits it, so the
+ * bucket of key splits until it has room. Only a split that needs a deeper
+ * directory gives up the latches and comes back with the directory latch
+ * exclusive
+ */
+template <typename K, typename V, typename Hash>
+void ConcurrentExtendibleHash<K, V, Hash>::Insert(const K &key, const V &value)
+{
+  size_t hash = HashKey(key);
+  directory_latch_.RLock();
+  Node *node = LatchNode(hash, true);
+  node->bucket_->Put(key, value);
+  bool expand = false;
+  while (Overflows(node)) {
+    if (node->bucket_->GetLocalDepth() == global_depth_) {
+      expand = true;
+      break;
+    }
+    SplitNode(node);
+    if (!Covers(node, hash)) {
+      node->latch_.WUnlock();
+      node = LatchNode(hash, true);
+    }
+  }
+  node->latch_.WUnlock();
+  directory_latch_.RUnlock();
+  if (!expand) {
+    return;
+  }
+
+  directory_latch_.WLock();
+  // others may have split or drained the bucket in between
+  node = GetNode(hash);
+  while (Overflows(node)) {
+    if (node->bucket_->GetLocalDepth() == global_depth_) {
+      Expand();
+    }
+    SplitNode(node);
+    node = GetNode(hash);
+  }
+  directory_latch_.WUnlock();
+}
+
+template <typename K, typename V, typename Hash>
+void ConcurrentExtendibleHash<K, V, Hash>::SplitNode(Node *node)
+{
+  // fully built before any slot points to it
+  std::unique_ptr<Node> new_node(new Node(node->bucket_->Split()));
+  int local_depth = new_node->bucket_->GetLocalDepth();
+  int new_id = new_node->bucket_->GetId();
+
+  // every slot whose low local_depth + 1 bits equal new_id moves over
+  int num_slots = 1 << (global_depth_ + 1);
+  for (int i = new_id; i < num_slots; i += 1 << (local_depth + 1)) {
+    directory_[i] = new_node.get();
+  }
+  std::lock_guard<std::mutex> guard(nodes_latch_);
+  nodes_.push_back(std::move(new_node));
+}
+
+template <typename K, typename V, typename Hash>
+void ConcurrentExtendibleHash<K, V, Hash>::Expand()
+{
+  int num_slots = 1 << (global_depth_ + 1);
+  std::unique_ptr<std::atomic<Node *>[]> directory(
+      new std::atomic<Node *>[2 * num_slots]);
+  for (int i = 0; i < 2 * num_slots; i++) {
+    directory[i] = directory_[i % num_slots].load();
+  }
+  directory_ = std::move(directory);
+  ++global_depth_;
+}
+
+template class ConcurrentExtendibleHash<page_id_t, Page *>;
+// test purpose
+template class ConcurrentExtendibleHash<int, std::string>;
+template class ConcurrentExtendibleHash<int, int>;
+template class ConcurrentExtendibleHash<int, std::string, StdHasher<int>>;
+} // namespace cmudb
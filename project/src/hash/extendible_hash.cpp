@@ -10,29 +10,32 @@ namespace cmudb
  * constructor
  * array_size: fixed array size for each bucket
  */
-template <typename K, typename V>
-ExtendibleHash<K, V>::ExtendibleHash(size_t size) : bucket_size_(size), global_depth_(0){
+template <typename K, typename V, typename Hash>
+ExtendibleHash<K, V, Hash>::ExtendibleHash(size_t size, double merge_threshold)
+    : bucket_size_(size),
+      merge_limit_(static_cast<size_t>(merge_threshold * size)),
+      global_depth_(0) {
   buckets_.resize(1<<(global_depth_+1));
   for (size_t i = 0; i < buckets_.size(); i++) {
-    buckets_[i] = std::make_shared<Bucket<K, V>>(i, 0, bucket_size_);
+    buckets_[i] = std::make_shared<Bucket<K, V, Hash>>(i, 0, bucket_size_);
   }
 }
 
 /*
  * helper function to calculate the hashing address of input key
  */
-template <typename K, typename V>
-size_t ExtendibleHash<K, V>::HashKey(const K &key)
+template <typename K, typename V, typename Hash>
+size_t ExtendibleHash<K, V, Hash>::HashKey(const K &key)
 {
-  return Hasher<K>()(key);
+  return Hash()(key);
 }
 
 /*
  * helper function to return global depth of hash table
  * NOTE: you must implement this function in order to pass test
  */
-template <typename K, typename V>
-int ExtendibleHash<K, V>::GetGlobalDepth() const
+template <typename K, typename V, typename Hash>
+int ExtendibleHash<K, V, Hash>::GetGlobalDepth() const
 {
   return global_depth_;
 }
@@ -41,8 +44,8 @@ int ExtendibleHash<K, V>::GetGlobalDepth() const
  * helper function to return local depth of one specific bucket
  * NOTE: you must implement this function in order to pass test
  */
-template <typename K, typename V>
-int ExtendibleHash<K, V>::GetLocalDepth(int bucket_id) const
+template <typename K, typename V, typename Hash>
+int ExtendibleHash<K, V, Hash>::GetLocalDepth(int bucket_id) const
 {
   return buckets_[bucket_id]->GetLocalDepth();
 }
@@ -50,33 +53,116 @@ int ExtendibleHash<K, V>::GetLocalDepth(int bucket_id) const
 /*
  * helper function to return current number of bucket in hash table
  */
-template <typename K, typename V>
-int ExtendibleHash<K, V>::GetNumBuckets() const
+template <typename K, typename V, typename Hash>
+int ExtendibleHash<K, V, Hash>::GetNumBuckets() const
 {
   return static_cast<int>(buckets_.size());
 }
 
+/*
+ * A bucket's id is the first directory slot pointing to it
+ */
+template <typename K, typename V, typename Hash>
+void ExtendibleHash<K, V, Hash>::GetDepthHistogram(
+    std::vector<size_t> &histogram)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  histogram.assign(global_depth_ + 1, 0);
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    if (buckets_[i]->GetId() == static_cast<int>(i)) {
+      ++histogram[buckets_[i]->GetLocalDepth()];
+    }
+  }
+}
+
+template <typename K, typename V, typename Hash>
+void ExtendibleHash<K, V, Hash>::GetOccupancyHistogram(
+    std::vector<size_t> &histogram)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  histogram.assign(bucket_size_ + 1, 0);
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    if (buckets_[i]->GetId() == static_cast<int>(i)) {
+      size_t size = buckets_[i]->GetSize();
+      if (size >= histogram.size()) {
+        histogram.resize(size + 1, 0);
+      }
+      ++histogram[size];
+    }
+  }
+}
+
 /*
  * lookup function to find value associate with input key
  */
-template <typename K, typename V>
-bool ExtendibleHash<K, V>::Find(const K &key, V &value)
+template <typename K, typename V, typename Hash>
+bool ExtendibleHash<K, V, Hash>::Find(const K &key, V &value)
 {
   std::lock_guard<std::mutex> guard(mutex_);
-  size_t id = GETBIT(Hasher<K>()(key), global_depth_);
+  size_t id = GETBIT(Hash()(key), global_depth_);
   return buckets_[id]->Get(key, value);
 }
 
 /*
  * delete <key,value> entry in hash table
- * Shrink & Combination is not required for this project
+ * the bucket merges with its buddy and the directory shrinks once they
+ * have emptied enough, see Shrink
  */
-template <typename K, typename V>
-bool ExtendibleHash<K, V>::Remove(const K &key)
+template <typename K, typename V, typename Hash>
+bool ExtendibleHash<K, V, Hash>::Remove(const K &key)
 {
   std::lock_guard<std::mutex> guard(mutex_);
-  int id = GETBIT(Hasher<K>()(key), global_depth_);
-  return buckets_[id]->Remove(key);
+  int id = GETBIT(Hash()(key), global_depth_);
+  if (!buckets_[id]->Remove(key)) {
+    return false;
+  }
+  Shrink(id);
+  return true;
+}
+
+/*
+ * A bucket of local depth l covers the slots matching its low l + 1 bits,
+ * its buddy differs in bit l only. Only buddies of equal depth merge, into
+ * the one with bit l clear, which keeps its id. Buckets of depth 0 are the
+ * two halves of the smallest directory and never merge
+ */
+template <typename K, typename V, typename Hash>
+void ExtendibleHash<K, V, Hash>::Shrink(int id)
+{
+  while (true) {
+    BucketPtr<K, V, Hash> bucket = buckets_[id];
+    int local_depth = bucket->GetLocalDepth();
+    if (local_depth == 0) {
+      break;
+    }
+    BucketPtr<K, V, Hash> buddy = buckets_[id ^ (1 << local_depth)];
+    if (buddy->GetLocalDepth() != local_depth ||
+        bucket->GetSize() + buddy->GetSize() > merge_limit_) {
+      break;
+    }
+    if (!ISZERO(bucket->GetId(), local_depth)) {
+      std::swap(bucket, buddy);
+    }
+    bucket->Merge(*buddy);
+    for (size_t i = buddy->GetId(); i < buckets_.size();
+         i += 1 << (local_depth + 1)) {
+      buckets_[i] = bucket;
+    }
+    id = bucket->GetId();
+  }
+
+  // the upper half of the directory mirrors the lower half once every
+  // bucket is shallower than the directory
+  while (global_depth_ > 0) {
+    size_t half = buckets_.size() / 2;
+    for (size_t i = 0; i < half; i++) {
+      if (buckets_[i]->GetLocalDepth() >= global_depth_) {
+        return;
+      }
+    }
+    buckets_.resize(half);
+    --global_depth_;
+  }
 }
 
 /*
@@ -84,17 +170,17 @@ bool ExtendibleHash<K, V>::Remove(const K &key)
  * Split & Redistribute bucket when there is overflow and if necessary increase
  * global depth
  */
-template <typename K, typename V>
-void ExtendibleHash<K, V>::Insert(const K &key, const V &value)
+template <typename K, typename V, typename Hash>
+void ExtendibleHash<K, V, Hash>::Insert(const K &key, const V &value)
 {
   std::lock_guard<std::mutex> guard(mutex_);
 
   // get the key of k
-  int id = GETBIT(Hasher<K>()(key), global_depth_);
+  int id = GETBIT(Hash()(key), global_depth_);
 
   auto &bucket = buckets_[id];
   if (bucket.get() == nullptr) {
-    buckets_[id] = std::make_shared<Bucket<K, V>>(id, 0, bucket_size_);
+    buckets_[id] = std::make_shared<Bucket<K, V, Hash>>(id, 0, bucket_size_);
     buckets_[id]->Put(key, value);
   }
   else {
@@ -108,8 +194,12 @@ void ExtendibleHash<K, V>::Insert(const K &key, const V &value)
         ++global_depth_;
         expand(new_id, std::move(new_bucket));
       } else if (bucket->GetLocalDepth() <= global_depth_) {
-        // DEBUG
-        buckets_[new_id] = std::move(new_bucket);
+        // every slot matching the low local depth + 1 bits of new_id
+        BucketPtr<K, V, Hash> split = std::move(new_bucket);
+        for (size_t i = new_id; i < buckets_.size();
+             i += 1 << (split->GetLocalDepth() + 1)) {
+          buckets_[i] = split;
+        }
       } else {
         // TODO: ERROR
         assert(1 == 0);
@@ -124,4 +214,7 @@ template class ExtendibleHash<Page *, std::list<Page *>::iterator>;
 template class ExtendibleHash<int, std::string>;
 template class ExtendibleHash<int, std::list<int>::iterator>;
 template class ExtendibleHash<int, int>;
+template class ExtendibleHash<int, std::string, StdHasher<int>>;
+template class ExtendibleHash<int, int, StdHasher<int>>;
+template class ExtendibleHash<std::string, int>;
 } // namespace cmudb
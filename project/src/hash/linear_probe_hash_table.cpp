@@ -0,0 +1,131 @@
+#include <cassert>
+
+#include "hash/linear_probe_hash_table.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename K, typename V>
+LinearProbeHashTable<K, V>::LinearProbeHashTable(size_t max_entries,
+                                                 K empty_key)
+    : capacity_(2), shift_(1), empty_key_(empty_key), size_(0), version_(0) {
+  while (capacity_ < 2 * max_entries) {
+    capacity_ <<= 1;
+    ++shift_;
+  }
+  mask_ = capacity_ - 1;
+  slots_ = new Slot[capacity_];
+  for (size_t i = 0; i < capacity_; ++i) {
+    slots_[i].key_.store(empty_key_, std::memory_order_relaxed);
+    slots_[i].value_.store(V(), std::memory_order_relaxed);
+  }
+}
+
+template <typename K, typename V>
+LinearProbeHashTable<K, V>::~LinearProbeHashTable() {
+  delete[] slots_;
+}
+
+/*
+ * lookup function to find value associate with input key.
+ * Probe until the key or an empty slot; if a Remove shifted slots meanwhile
+ * the probe may have skipped the key, so start over
+ */
+template <typename K, typename V>
+bool LinearProbeHashTable<K, V>::Find(const K &key, V &value) {
+  while (true) {
+    uint64_t version = version_.load(std::memory_order_acquire);
+    if (version & 1) {
+      continue;
+    }
+    bool found = false;
+    for (size_t i = HashKey(key);; i = (i + 1) & mask_) {
+      K slot_key = slots_[i].key_.load(std::memory_order_acquire);
+      if (slot_key == key) {
+        value = slots_[i].value_.load(std::memory_order_relaxed);
+        found = true;
+        break;
+      }
+      if (slot_key == empty_key_) {
+        break;
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (version_.load(std::memory_order_relaxed) == version) {
+      return found;
+    }
+  }
+}
+
+/*
+ * delete <key,value> entry in hash table.
+ * No tombstones: entries behind the hole whose home slot lies at or before
+ * it are shifted back, so misses still stop at the first empty slot
+ */
+template <typename K, typename V>
+bool LinearProbeHashTable<K, V>::Remove(const K &key) {
+  std::lock_guard<std::mutex> guard(writer_latch_);
+  size_t hole = HashKey(key);
+  while (true) {
+    K slot_key = slots_[hole].key_.load(std::memory_order_relaxed);
+    if (slot_key == key) {
+      break;
+    }
+    if (slot_key == empty_key_) {
+      return false;
+    }
+    hole = (hole + 1) & mask_;
+  }
+
+  uint64_t version = version_.load(std::memory_order_relaxed);
+  version_.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = (hole + 1) & mask_;; i = (i + 1) & mask_) {
+    K slot_key = slots_[i].key_.load(std::memory_order_relaxed);
+    if (slot_key == empty_key_) {
+      break;
+    }
+    // distance from home slot, can the entry move back into the hole?
+    size_t home = HashKey(slot_key);
+    if (((i - home) & mask_) >= ((i - hole) & mask_)) {
+      slots_[hole].value_.store(slots_[i].value_.load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+      slots_[hole].key_.store(slot_key, std::memory_order_relaxed);
+      hole = i;
+    }
+  }
+  slots_[hole].key_.store(empty_key_, std::memory_order_relaxed);
+  --size_;
+  version_.store(version + 2, std::memory_order_release);
+  return true;
+}
+
+/*
+ * insert <key,value> entry in hash table
+ * An existing key gets its value replaced. The value is published before the
+ * key so a concurrent Find never sees a key with a stale value
+ */
+template <typename K, typename V>
+void LinearProbeHashTable<K, V>::Insert(const K &key, const V &value) {
+  assert(key != empty_key_);
+  std::lock_guard<std::mutex> guard(writer_latch_);
+  for (size_t i = HashKey(key);; i = (i + 1) & mask_) {
+    K slot_key = slots_[i].key_.load(std::memory_order_relaxed);
+    if (slot_key == key) {
+      slots_[i].value_.store(value, std::memory_order_release);
+      return;
+    }
+    if (slot_key == empty_key_) {
+      assert(size_ < capacity_ - 1);
+      slots_[i].value_.store(value, std::memory_order_relaxed);
+      slots_[i].key_.store(key, std::memory_order_release);
+      ++size_;
+      return;
+    }
+  }
+}
+
+template class LinearProbeHashTable<page_id_t, Page *>;
+// test purpose
+template class LinearProbeHashTable<int, int>;
+} // namespace cmudb
@@ -0,0 +1,88 @@
+/**
+ * arc_replacer.h
+ *
+ * Functionality: Adaptive Replacement Cache. Resident values live in T1
+ * (seen once since they became resident) or T2 (seen at least twice). Every
+ * eviction leaves the page id behind in a ghost list, B1 or B2, so a page
+ * that comes back soon after eviction is recognised and goes straight to T2.
+ * A ghost hit in B1 grows the target size p of T1 (recency is paying off), a
+ * ghost hit in B2 shrinks it (frequency is paying off), which lets the policy
+ * follow workloads that swing between scans and hot-set lookups.
+ */
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace cmudb {
+
+template <typename T> class ARCReplacer : public Replacer<T> {
+public:
+  // capacity: number of frames, also the length bound of each ghost list
+  explicit ARCReplacer(size_t capacity);
+
+  ~ARCReplacer();
+
+  // record an access and mark value evictable
+  void Insert(const T &value);
+
+  // victim's page id is remembered in a ghost list
+  bool Victim(T &value);
+
+  // value is pinned again, it stays resident in its list
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void PeekVictims(size_t n, std::vector<T> &values);
+
+  // re-inserted values whose page id was found in B1 / B2
+  inline size_t GetGhostHits() const { return ghost_hits_; }
+  // re-inserted values that were not remembered at all
+  inline size_t GetGhostMisses() const { return ghost_misses_; }
+  // current target size of T1
+  inline size_t GetTarget() const { return target_; }
+
+private:
+  enum class ListId { T1, T2, B1, B2 };
+
+  struct Entry {
+    T value_;
+    page_id_t key_;
+    bool evictable_;
+  };
+
+  // page id currently held by value, specialized per value type
+  static page_id_t Key(const T &value);
+
+  // evict the least recently used evictable entry of list into ghost
+  bool EvictFrom(ListId from, T &value);
+
+  // put key at the front of ghost list B1 or B2
+  void RememberGhost(ListId ghost, page_id_t key);
+
+  // drop key from ghost list B1 or B2, false if that list does not hold it
+  bool ForgetGhost(ListId ghost, page_id_t key);
+
+  size_t capacity_;
+  size_t target_;
+  size_t size_;
+  size_t ghost_hits_;
+  size_t ghost_misses_;
+  // most recently used at the front
+  std::list<Entry> t1_;
+  std::list<Entry> t2_;
+  std::list<page_id_t> b1_;
+  std::list<page_id_t> b2_;
+  std::unordered_map<T, std::pair<ListId, typename std::list<Entry>::iterator>>
+      resident_;
+  std::unordered_map<page_id_t,
+                     std::pair<ListId, typename std::list<page_id_t>::iterator>>
+      ghost_;
+};
+
+} // namespace cmudb
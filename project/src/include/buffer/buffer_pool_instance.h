@@ -0,0 +1,237 @@
+/*
+ * buffer_pool_instance.h
+ *
+ * Functionality: One independent partition of the buffer pool. Each instance
+ * owns its own frames, page table, replacer and free list, all protected by
+ * its own latch, so threads touching pages of different instances never
+ * contend with each other. BufferPoolManager routes every page id to exactly
+ * one instance.
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "buffer/arc_replacer.h"
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/compressed_page_cache.h"
+#include "buffer/frame_region.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "disk/disk_manager.h"
+#include "disk/disk_scheduler.h"
+#include "hash/extendible_hash.h"
+#include "hash/linear_probe_hash_table.h"
+#include "logging/log_manager.h"
+#include "page/page.h"
+
+namespace cmudb {
+class BufferPoolInstance {
+public:
+  BufferPoolInstance(size_t pool_size, DiskManager *disk_manager,
+                     LogManager *log_manager = nullptr,
+                     ReplacerType replacer_type = ReplacerType::LRU,
+                     FrameAllocation frame_allocation =
+                         FrameAllocation::ALIGNED,
+                     CompressedPageCache *compressed_cache = nullptr,
+                     int numa_node = -1);
+
+  ~BufferPoolInstance();
+
+  Page *FetchPage(page_id_t page_id);
+
+  bool UnpinPage(page_id_t page_id, bool is_dirty,
+                 lsn_t lsn = INVALID_LSN);
+
+  bool FlushPage(page_id_t page_id);
+
+  // first half of a batch flush: copy every dirty page, pinned or not, mark
+  // it clean and block other writes of it. The copies are appended to
+  // copies, page_size bytes each. EndFlush must follow once they are written.
+  // False if a dirty page was left out, another flush of it under way
+  bool CopyDirtyPages(std::vector<Page *> &pages,
+                      std::vector<page_id_t> &page_ids,
+                      std::vector<char> &copies);
+  void EndFlush(const std::vector<Page *> &pages);
+
+  // append (page id, recLSN) of every page whose changes may not all be on
+  // disk: dirty pages, pages being written back and pinned pages, which
+  // may be changed right now and marked dirty later. For fuzzy checkpoints
+  void GetDirtyPages(std::vector<std::pair<page_id_t, lsn_t>> &pages);
+
+  // page_id must already be allocated by the disk manager
+  Page *NewPage(page_id_t page_id);
+
+  bool DeletePage(page_id_t page_id);
+
+  // read page into a frame without pinning it. The disk read happens with
+  // the latch released, fetches of the page wait for it. Returns false if
+  // the page is already resident or every frame is pinned, otherwise
+  // on_done runs once the page is in. With a scheduler the read is only
+  // submitted and this returns before it is done
+  bool PrefetchPage(page_id_t page_id, DiskScheduler *scheduler = nullptr,
+                    DiskCallback on_done = nullptr);
+
+  // append the ids of resident pages, hottest first: pinned pages, then
+  // unpinned ones from the replacer's warm end to its cold end
+  void GetResidentPages(std::vector<page_id_t> &page_ids);
+
+  inline size_t GetPoolSize() const { return pool_size_; }
+  // node the frames are placed on, -1 if not placed
+  inline int GetNumaNode() const { return numa_node_; }
+
+  inline FrameAllocation GetFrameAllocation() const {
+    return frames_->GetAllocation();
+  }
+
+  // called by the page cleaner: once fewer than low_watermark frames are
+  // free or clean and evictable, write back dirty pages from the replacer's
+  // cold end until high_watermark frames are. Returns the pages written.
+  // With a scheduler the writes are submitted as one batch
+  size_t CleanColdPages(size_t low_watermark, size_t high_watermark,
+                        DiskScheduler *scheduler = nullptr);
+
+  inline BufferPoolStats GetStats() const { return counters_.Snapshot(); }
+  inline void ResetStats() { counters_.Reset(); }
+
+private:
+  // find a frame from free list first, then from replacer
+  // lock latch_, accounting for the time spent waiting on it
+  std::unique_lock<std::mutex> AcquireLatch();
+
+  // must be called with latch_ held by lock
+  // victims are handed to the compressed tier, if any, once clean
+  Page *GetVictimPage(std::unique_lock<std::mutex> &lock);
+
+  // block until the page cleaner is done writing page back
+  void WaitForFlush(std::unique_lock<std::mutex> &lock, Page *page) {
+    io_cv_.wait(lock, [page] { return !page->is_flushing_; });
+  }
+
+  // block until a prefetch is done reading page in
+  void WaitForLoad(std::unique_lock<std::mutex> &lock, Page *page) {
+    io_cv_.wait(lock, [page] { return !page->is_loading_; });
+  }
+
+  // page must be claimed, the page id is published before the pin so a
+  // lock-free pinner that wins the race sees the new id and backs off
+  void InitPageMetadata(page_id_t pid, Page* page) {
+    page->page_id_ = pid;
+    page->is_dirty_ = false;
+    page->rec_lsn_ = NextLSN();
+    page->pin_count_.store(1, std::memory_order_release);
+  }
+
+  // free frames stay claimed, stale page table lookups cannot pin them
+  void ResetPageMetadata(Page* page) {
+    page->page_id_ = INVALID_PAGE_ID;
+    page->is_dirty_ = false;
+    page->pin_count_ = Page::CLAIMED_PIN_COUNT;
+  }
+
+  // write-ahead rule, the log up to the page's LSN is on disk before the
+  // page image is written back
+  void WaitForLog(page_id_t page_id, const char *page_data) {
+    if (ENABLE_LOGGING && log_manager_ != nullptr) {
+      log_manager_->WaitForPage(page_id, page_data);
+    }
+  }
+
+  // the LSN the next change of any page gets at the earliest
+  lsn_t NextLSN() {
+    return log_manager_ == nullptr ? 0 : log_manager_->GetNextLSN();
+  }
+
+  // recLSN of page once page_data, a copy of it, is on disk: changes after
+  // its own LSN may still be in the making, later ones get LSNs from
+  // NextLSN on. None of them is below the recLSN it has now
+  lsn_t CleanRecLSN(Page *page, const char *page_data) {
+    lsn_t lsn;
+    memcpy(&lsn, page_data + 4, sizeof(lsn));
+    // no LSN, the header page has none either, see LogManager::WaitForPage
+    if (lsn < 0 || page->page_id_ == HEADER_PAGE_ID) {
+      return page->rec_lsn_;
+    }
+    return std::max(page->rec_lsn_, std::min(lsn + 1, NextLSN()));
+  }
+
+  // pages of a read-only database are never written back
+  void SetPageDirty(Page* page) {
+    if (!disk_manager_->IsReadOnly()) {
+      page->is_dirty_ = true;
+    }
+  }
+
+  void SetPagePin(Page* page) {
+    ++(page->pin_count_);
+  }
+
+  // bring page_id into page. A mapped read-only database needs no copy, the
+  // page points into the mapping. Otherwise page gets its own frame back
+  // and reads page_id from the compressed tier, or from disk if it is not
+  // there. False if the page failed its checksum
+  bool LoadPage(page_id_t page_id, Page *page) {
+    const char *mapped = disk_manager_->GetMappedPage(page_id);
+    if (mapped != nullptr) {
+      page->data_ = const_cast<char *>(mapped);
+      return disk_manager_->VerifyPage(page_id, mapped);
+    }
+    page->data_ = GetFrame(page);
+    if (compressed_cache_ == nullptr ||
+        !compressed_cache_->Get(page_id, page->data_, page_size_)) {
+      return disk_manager_->ReadPage(page_id, page->data_);
+    }
+    return true;
+  }
+
+  inline char *GetFrame(Page *page) {
+    return frames_->GetData() + page->frame_id_ * page_size_;
+  }
+
+  // a prefetched page is in, make it evictable and wake up its fetchers.
+  // A page that failed its checksum is dropped again instead
+  void FinishPrefetch(Page *page, bool loaded = true);
+
+  // take an unpinned frame away from lock-free pinners, latch_ held
+  bool ClaimPage(Page* page) {
+    int expected = 0;
+    return page->pin_count_.compare_exchange_strong(expected,
+                                                    Page::CLAIMED_PIN_COUNT);
+  }
+
+  // pin a resident page without latch_, false if the slow path must do it
+  bool TryPinResident(Page *page, page_id_t page_id);
+
+  // drop one pin, re-enter the replacer at zero, latch_ held
+  void UnpinLocked(Page *page);
+
+  // bytes of the frames and their metadata, for the memory tracker
+  inline size_t FrameBytes() const {
+    return pool_size_ * (page_size_ + sizeof(Page));
+  }
+
+private:
+  size_t pool_size_; // number of pages in this instance
+  size_t page_size_; // size of every page, fixed by the disk manager
+  int numa_node_;
+  FrameRegion *metadata_; // backs pages_
+  Page *pages_;           // array of pages
+  FrameRegion *frames_;   // page contents, pool_size_ * page_size_ bytes
+  DiskManager *disk_manager_;
+  LogManager *log_manager_;
+  CompressedPageCache *compressed_cache_; // shared tier below, may be null
+  HashTable<page_id_t, Page *> *page_table_; // to keep track of pages
+  Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
+  std::list<Page *> *free_list_; // to find a free page for replacement
+  std::mutex latch_;             // to protect shared data structure
+  std::condition_variable io_cv_; // signalled when background I/O ends
+  BufferPoolCounters counters_;
+};
+} // namespace cmudb
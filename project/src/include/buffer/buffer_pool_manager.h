@@ -4,69 +4,193 @@
  * Functionality: The simplified Buffer Manager interface allows a client to
  * new/delete pages on disk, to read a disk page into the buffer pool and pin
  * it, also to unpin a page in the buffer pool.
+ *
+ * The pool can be split into several independent BufferPoolInstance
+ * partitions. A page id is always served by partition (page_id % N), so each
+ * partition only latches its own frames and unrelated fetches run in
+ * parallel. With one partition the behaviour is the classic single pool.
  */
 
 #pragma once
-#include <list>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
-#include "buffer/lru_replacer.h"
+#include "buffer/buffer_pool_instance.h"
+#include "common/task_scheduler.h"
 #include "disk/disk_manager.h"
-#include "hash/extendible_hash.h"
 #include "logging/log_manager.h"
 #include "page/page.h"
 
 namespace cmudb {
 class BufferPoolManager {
 public:
+  // pool_size frames in total, spread evenly over num_instances partitions,
+  // every partition evicts with the given replacement policy and allocates
+  // its frames as frame_allocation says. With compressed_cache_bytes > 0
+  // evicted pages drop into a compressed tier of that many bytes, shared by
+  // all partitions. numa_aware places partition i on NUMA node i % nodes,
+  // prefers pages of a partition local to the caller for NewPage and runs
+  // a page cleaner per node, pinned to it
   BufferPoolManager(size_t pool_size, DiskManager *disk_manager,
-                          LogManager *log_manager = nullptr);
+                          LogManager *log_manager = nullptr,
+                          size_t num_instances = 1,
+                          ReplacerType replacer_type = ReplacerType::LRU,
+                          FrameAllocation frame_allocation =
+                              FrameAllocation::ALIGNED,
+                          size_t compressed_cache_bytes = 0,
+                          bool numa_aware = false);
 
   ~BufferPoolManager();
 
   Page *FetchPage(page_id_t page_id);
 
-  bool UnpinPage(page_id_t page_id, bool is_dirty);
+  // lsn: of a change made while pinned that was logged before the page was
+  // fetched, so it may be below the recLSN the page got then
+  bool UnpinPage(page_id_t page_id, bool is_dirty, lsn_t lsn = INVALID_LSN);
 
   bool FlushPage(page_id_t page_id);
 
-  Page *NewPage(page_id_t &page_id);
+  // write back every dirty page of every partition. Pages are sorted by id
+  // across partitions and neighbours go out in one vectored write. The pages
+  // deleted before are freed on disk then. Returns the number of pages
+  // written
+  size_t FlushAllPages();
+
+  // (page id, recLSN) of the pages of every partition whose changes may not
+  // all be on disk, see BufferPoolInstance::GetDirtyPages
+  void GetDirtyPages(std::vector<std::pair<page_id_t, lsn_t>> &pages);
+
+  // near_page_id: allocation hint, see DiskManager::AllocatePage
+  Page *NewPage(page_id_t &page_id, page_id_t near_page_id = INVALID_PAGE_ID);
 
+  // the page is freed on disk by the next FlushAllPages, once the pages
+  // that referenced it are written: a crash in between leaks it rather than
+  // handing it out while a page on disk still points to it. As many pages
+  // as the pool holds waiting flush it themselves
   bool DeletePage(page_id_t page_id);
 
-private:
-  void InitPageMetadata(page_id_t pid, Page* page) {
-    page->page_id_ = pid;
-    page->is_dirty_ = false;
-    page->pin_count_ = 1;
-  }
+  // hint that page_id will be fetched soon: a background thread reserves an
+  // unpinned frame and submits the read to the disk scheduler, so several
+  // hints are read in parallel. Hints are dropped when the queue is full
+  void Prefetch(page_id_t page_id);
+
+  // Prefetch count consecutive pages starting at first_page_id
+  void PrefetchRange(page_id_t first_page_id, size_t count);
+
+  // block until all pending prefetch hints are served
+  void WaitForPrefetch();
+
+  // save the resident page ids on shutdown / warm the pool up from them on
+  // startup. Return false if the file cannot be written or read
+  bool DumpWorkingSet(const std::string &file_name);
+  bool LoadWorkingSet(const std::string &file_name);
+
+  inline size_t GetPoolSize() const { return pool_size_; }
+
+  inline size_t GetPageSize() const { return disk_manager_->GetPageSize(); }
 
-  void ResetPageMetadata(Page* page) {
-    page->page_id_ = INVALID_PAGE_ID;
-    page->is_dirty_ = false;
-    page->pin_count_ = 0;
+  inline size_t GetNumInstances() const { return instances_.size(); }
+
+  // nodes the partitions are spread over, 0 unless NUMA-aware
+  inline int GetNumaNodes() const { return numa_nodes_; }
+  // node of the frames of a partition, -1 if not placed
+  inline int GetNumaNode(size_t instance) const {
+    return instances_[instance]->GetNumaNode();
   }
 
-  void SetPageDirty(Page* page) {
-    page->is_dirty_ = true;
+  // allocation mode in use, HUGE_PAGE may have fallen back to ALIGNED
+  inline FrameAllocation GetFrameAllocation() const {
+    return instances_[0]->GetFrameAllocation();
   }
 
-  void SetPageUnpin(Page* page) {
-    --(page->pin_count_);
+  // spawn a page cleaner thread that wakes up every PAGE_CLEANER_TIMEOUT and
+  // keeps between low_watermark and high_watermark (shares of each
+  // partition) of the frames free or clean, so evictions don't write. A
+  // NUMA-aware pool spawns one per node, each cleans the partitions there.
+  // With a scheduler every partition is a periodic task of it instead
+  void RunPageCleaner(double low_watermark = CLEANER_LOW_WATERMARK,
+                      double high_watermark = CLEANER_HIGH_WATERMARK,
+                      TaskScheduler *scheduler = nullptr);
+  void StopPageCleaner();
+
+  // FetchPage calls served from memory / read from disk, over all partitions
+  inline size_t GetHitCount() const { return GetStats().hits; }
+  inline size_t GetMissCount() const { return GetStats().misses; }
+
+  // counters summed over all partitions / of one partition
+  BufferPoolStats GetStats() const;
+  inline BufferPoolStats GetStats(size_t instance) const {
+    return instances_[instance]->GetStats();
   }
+  // compressed tier counters and memory use, all zero without a tier
+  CompressedCacheStats GetCompressedCacheStats() const;
 
-  void SetPagePin(Page* page) {
-    ++(page->pin_count_);
+  // zero the counters of every partition and of the compressed tier
+  void ResetStats();
+
+  // serve HEADER_PAGE_ID from header_pool instead of this pool, so several
+  // pools over one database file never cache diverging header copies
+  inline void SetHeaderPagePool(BufferPoolManager *header_pool) {
+    header_pool_ = header_pool;
   }
 
 private:
+  // asynchronous I/O for prefetches and the page cleaner, created on first
+  // use. Misses stay synchronous reads, the fetching thread waits anyway
+  DiskScheduler *GetDiskScheduler();
+
+  // point the header page at the free-space bitmap once there is one
+  void RecordFreeSpaceMap();
+
+  // one prefetch read is done
+  void FinishPrefetchHint();
+
+  // partition responsible for page_id
+  inline BufferPoolInstance *GetInstance(page_id_t page_id) {
+    if (page_id == HEADER_PAGE_ID && header_pool_ != nullptr) {
+      return header_pool_->GetInstance(page_id);
+    }
+    return instances_[static_cast<size_t>(page_id) % instances_.size()];
+  }
+
   size_t pool_size_; // number of pages in buffer pool
-  Page *pages_;      // array of pages
   DiskManager *disk_manager_;
   LogManager *log_manager_;
-  HashTable<page_id_t, Page *> *page_table_; // to keep track of pages
-  Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
-  std::list<Page *> *free_list_; // to find a free page for replacement
-  std::mutex latch_;             // to protect shared data structure
+  std::vector<BufferPoolInstance *> instances_;
+  CompressedPageCache *compressed_cache_; // nullptr if disabled
+  BufferPoolManager *header_pool_ = nullptr; // owner of the header page
+  // prefetch thread, started by the first hint
+  std::thread *prefetch_thread_;
+  bool prefetch_running_;
+  // hints taken off the queue whose page is not in yet
+  size_t prefetch_inflight_;
+  // NUMA nodes partitions are spread over, 0 unless numa_aware
+  int numa_nodes_;
+  // most hints pending, pool_size_ unless memory is tight
+  std::atomic<size_t> prefetch_depth_;
+  int elastic_; // handle with the memory tracker
+  std::deque<page_id_t> prefetch_queue_;
+  std::mutex prefetch_latch_;
+  std::condition_variable prefetch_cv_;
+  DiskScheduler *disk_scheduler_;
+  std::mutex disk_scheduler_latch_;
+  // the header page points to the free-space bitmap, or cannot
+  std::atomic<bool> free_space_map_recorded_;
+  // deleted pages not freed on disk yet, see DeletePage
+  std::vector<page_id_t> deleted_pages_;
+  std::mutex deleted_latch_;
+  // page cleaner
+  std::vector<std::thread *> cleaner_threads_;
+  std::atomic<bool> cleaner_running_;
+  // instead of the threads
+  TaskScheduler *scheduler_;
+  std::vector<task_id_t> cleaner_tasks_;
+  std::mutex cleaner_latch_;
+  std::condition_variable cleaner_cv_;
 };
 } // namespace cmudb
@@ -0,0 +1,54 @@
+/*
+ * buffer_pool_set.h
+ *
+ * Functionality: A set of named buffer pools sharing one database file.
+ * Each pool has its own size and replacement policy, so one workload class
+ * (e.g. B+ tree pages) can be kept resident while another (e.g. table heap
+ * pages) churns through its own frames. Access structures bind to a pool
+ * when they are constructed and only ever touch their own pages through it.
+ *
+ * The header page is the one page every structure updates; it is always
+ * served by the first pool added, whichever pool it is requested from.
+ */
+
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+class BufferPoolSet {
+public:
+  BufferPoolSet(DiskManager *disk_manager, LogManager *log_manager = nullptr);
+
+  ~BufferPoolSet();
+
+  // create pool name, return nullptr if the name is already taken. See
+  // BufferPoolManager for numa_aware
+  BufferPoolManager *AddPool(const std::string &name, size_t pool_size,
+                             ReplacerType replacer_type = ReplacerType::LRU,
+                             size_t num_instances = 1,
+                             bool numa_aware = false);
+
+  // return nullptr if there is no such pool
+  BufferPoolManager *GetPool(const std::string &name) const;
+
+  inline size_t GetPoolCount() const { return pools_.size(); }
+
+  // pools in the order they were added
+  inline const std::string &GetPoolName(size_t i) const {
+    return pools_[i].first;
+  }
+  inline BufferPoolManager *GetPool(size_t i) const {
+    return pools_[i].second;
+  }
+
+private:
+  DiskManager *disk_manager_;
+  LogManager *log_manager_;
+  // a handful of pools at most, a vector keeps the creation order
+  std::vector<std::pair<std::string, BufferPoolManager *>> pools_;
+};
+} // namespace cmudb
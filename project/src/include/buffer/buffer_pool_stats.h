@@ -0,0 +1,97 @@
+/**
+ * buffer_pool_stats.h
+ *
+ * Functionality: Counters of one buffer pool partition. Every partition owns
+ * its own counter block, padded on both sides, so the counters are sharded
+ * the same way the latches are and bumping them never bounces a line between
+ * partitions. Updates are relaxed atomic adds; a snapshot is a plain struct
+ * that can be summed over partitions and scraped.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+// point-in-time copy of the counters
+struct BufferPoolStats {
+  uint64_t hits = 0;              // FetchPage served from memory
+  uint64_t misses = 0;            // FetchPage read from the tier or disk
+  uint64_t evictions = 0;         // resident pages chosen as victim
+  uint64_t dirty_write_backs = 0; // victims written back on the fetch path
+  uint64_t cleaner_writes = 0;    // pages written back by the page cleaner
+  uint64_t prefetches = 0;        // pages read in by Prefetch
+  uint64_t free_list_empty = 0;   // frame needed but the free list was empty
+  uint64_t no_free_frame = 0;     // frame needed but every frame was pinned
+  uint64_t latch_waits = 0;       // latch_ was found held by another thread
+  uint64_t latch_wait_ns = 0;     // time spent waiting for latch_
+
+  BufferPoolStats &operator+=(const BufferPoolStats &other) {
+    hits += other.hits;
+    misses += other.misses;
+    evictions += other.evictions;
+    dirty_write_backs += other.dirty_write_backs;
+    cleaner_writes += other.cleaner_writes;
+    prefetches += other.prefetches;
+    free_list_empty += other.free_list_empty;
+    no_free_frame += other.no_free_frame;
+    latch_waits += other.latch_waits;
+    latch_wait_ns += other.latch_wait_ns;
+    return *this;
+  }
+
+  // share of fetches served from memory
+  double HitRatio() const {
+    return hits + misses == 0 ? 0 : static_cast<double>(hits) / (hits + misses);
+  }
+};
+
+class BufferPoolCounters {
+public:
+  static inline void Add(std::atomic<uint64_t> &counter, uint64_t value = 1) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  BufferPoolStats Snapshot() const {
+    BufferPoolStats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.evictions = evictions_.load(std::memory_order_relaxed);
+    stats.dirty_write_backs = dirty_write_backs_.load(std::memory_order_relaxed);
+    stats.cleaner_writes = cleaner_writes_.load(std::memory_order_relaxed);
+    stats.prefetches = prefetches_.load(std::memory_order_relaxed);
+    stats.free_list_empty = free_list_empty_.load(std::memory_order_relaxed);
+    stats.no_free_frame = no_free_frame_.load(std::memory_order_relaxed);
+    stats.latch_waits = latch_waits_.load(std::memory_order_relaxed);
+    stats.latch_wait_ns = latch_wait_ns_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  void Reset() {
+    for (auto counter : {&hits_, &misses_, &evictions_, &dirty_write_backs_,
+                         &cleaner_writes_, &prefetches_, &free_list_empty_,
+                         &no_free_frame_, &latch_waits_, &latch_wait_ns_}) {
+      counter->store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // padding instead of alignas, C++14 new cannot over-align its owner
+  char front_padding_[CACHELINE_SIZE];
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> dirty_write_backs_{0};
+  std::atomic<uint64_t> cleaner_writes_{0};
+  std::atomic<uint64_t> prefetches_{0};
+  std::atomic<uint64_t> free_list_empty_{0};
+  std::atomic<uint64_t> no_free_frame_{0};
+  std::atomic<uint64_t> latch_waits_{0};
+  std::atomic<uint64_t> latch_wait_ns_{0};
+  char back_padding_[CACHELINE_SIZE];
+};
+
+} // namespace cmudb
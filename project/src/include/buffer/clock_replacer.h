@@ -0,0 +1,49 @@
+/**
+ * clock_replacer.h
+ *
+ * Functionality: CLOCK (second-chance) approximation of LRU. Every frame owns
+ * one slot in a fixed array holding its reference bit, so unpinning a page is
+ * a single bit-set and never allocates. A clock hand sweeps the array looking
+ * for an evictable frame whose reference bit is already cleared, giving every
+ * recently used frame one more round before eviction.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class ClockReplacer : public Replacer<T> {
+public:
+  // num_frames: number of frames (slots) the replacer may ever track
+  explicit ClockReplacer(size_t num_frames);
+
+  ~ClockReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void PeekVictims(size_t n, std::vector<T> &values);
+
+private:
+  // map a value to its fixed slot, specialized per value type
+  static size_t FrameId(const T &value);
+
+  std::vector<T> frames_;
+  // frame is unpinned and can be chosen as victim
+  std::vector<char> evictable_;
+  // frame was touched since the hand last passed it
+  std::vector<char> reference_;
+  size_t hand_;
+  size_t size_;
+};
+
+} // namespace cmudb
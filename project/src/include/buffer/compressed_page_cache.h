@@ -0,0 +1,90 @@
+/**
+ * compressed_page_cache.h
+ *
+ * Functionality: Optional second tier beneath the buffer pool. Clean pages
+ * evicted from the pool are compressed and kept in memory, a fetch miss
+ * looks here before going to disk. The tier is exclusive: a page found here
+ * is removed and lives in the pool again until it is evicted once more.
+ * Entries are dropped least recently inserted first once the compressed
+ * bytes exceed the capacity, or when the memory tracker needs room.
+ *
+ * Pages are compressed with a small LZ77 coder in the LZ4 block style
+ * (token byte, literal run, 16 bit back reference) that needs no external
+ * library. Pages that do not shrink are not cached.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+// point-in-time copy of the tier counters
+struct CompressedCacheStats {
+  uint64_t hits = 0;       // misses of the pool served by this tier
+  uint64_t misses = 0;     // misses of the pool that went on to disk
+  uint64_t insertions = 0; // evicted pages stored
+  uint64_t rejections = 0; // evicted pages that did not compress
+  uint64_t evictions = 0;  // entries dropped to stay within capacity
+  size_t entries = 0;      // pages currently cached
+  size_t memory_bytes = 0; // compressed bytes currently cached
+  size_t capacity_bytes = 0;
+
+  // share of lookups served by this tier
+  double HitRatio() const {
+    return hits + misses == 0 ? 0 : static_cast<double>(hits) / (hits + misses);
+  }
+};
+
+class CompressedPageCache {
+public:
+  explicit CompressedPageCache(size_t capacity_bytes);
+  ~CompressedPageCache();
+
+  // compress and remember a clean page, false if it was not stored
+  bool Put(page_id_t page_id, const char *data, size_t page_size);
+
+  // restore page_id into data and drop it from the tier, false if absent
+  bool Get(page_id_t page_id, char *data, size_t page_size);
+
+  // forget page_id, its image on disk changed or was deallocated
+  void Erase(page_id_t page_id);
+
+  CompressedCacheStats GetStats();
+  // zero the counters, the cached pages stay
+  void ResetStats();
+
+  // append the compressed form of src to out, false (and out unchanged) if
+  // it would not be smaller than size bytes
+  static bool Compress(const char *src, size_t size, std::vector<char> &out);
+
+  // decode exactly size bytes into dst, false on corrupt input
+  static bool Decompress(const char *src, size_t length, char *dst,
+                         size_t size);
+
+private:
+  struct Entry {
+    page_id_t page_id_;
+    std::vector<char> data_;
+  };
+
+  // erase *iter, latch_ held
+  void RemoveEntry(std::list<Entry>::iterator iter);
+  // drop the oldest entries until bytes are freed, for the memory tracker
+  size_t Shrink(size_t bytes);
+
+  size_t capacity_;
+  size_t memory_;
+  std::list<Entry> entries_; // newest first
+  std::unordered_map<page_id_t, std::list<Entry>::iterator> index_;
+  std::mutex latch_;
+  CompressedCacheStats stats_; // entries/memory_bytes filled in on read
+  int elastic_;                // handle with the memory tracker
+};
+} // namespace cmudb
@@ -0,0 +1,43 @@
+/**
+ * frame_region.h
+ *
+ * Functionality: One contiguous memory region holding the page contents of a
+ * buffer pool partition. Frame data is kept apart from the Page metadata so
+ * latches and pin counts never share a cache line with page bytes, and every
+ * frame starts on an OS page boundary as direct I/O requires. HUGE_PAGE
+ * backs the region with 2 MiB pages when the kernel allows it, which cuts TLB
+ * misses for large pools, and silently falls back to ALIGNED otherwise.
+ * Given a NUMA node, the region is placed on it before it is first touched,
+ * except for HEAP frames.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace cmudb {
+
+// how frame memory of a buffer pool is obtained
+enum class FrameAllocation { HEAP = 0, ALIGNED, HUGE_PAGE };
+
+class FrameRegion {
+public:
+  // zero-filled region of at least size bytes, on numa_node if not -1
+  FrameRegion(size_t size, FrameAllocation allocation, int numa_node = -1);
+
+  ~FrameRegion();
+
+  FrameRegion(const FrameRegion &) = delete;
+  FrameRegion &operator=(const FrameRegion &) = delete;
+
+  inline char *GetData() { return data_; }
+  // mode actually in use after any fallback
+  inline FrameAllocation GetAllocation() const { return allocation_; }
+
+private:
+  char *data_;
+  size_t mapped_size_; // non-zero if data_ comes from mmap
+  FrameAllocation allocation_;
+};
+
+} // namespace cmudb
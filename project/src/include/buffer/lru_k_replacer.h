@@ -0,0 +1,65 @@
+/**
+ * lru_k_replacer.h
+ *
+ * Functionality: LRU-K replacement. The replacer remembers the timestamps of
+ * the last K accesses (unpins) of every value and evicts the evictable value
+ * whose K-th most recent access lies furthest in the past, i.e. the one with
+ * the largest backward K-distance. Values seen fewer than K times have an
+ * infinite distance and go first, oldest access first, so pages touched once
+ * by a sequential scan cannot push out a hot working set.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class LRUKReplacer : public Replacer<T> {
+public:
+  explicit LRUKReplacer(size_t k = 2);
+
+  ~LRUKReplacer();
+
+  // record an access and mark value evictable
+  void Insert(const T &value);
+
+  // history of the victim is dropped, its frame will hold another page
+  bool Victim(T &value);
+
+  // value is pinned again, its history is kept
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void PeekVictims(size_t n, std::vector<T> &values);
+
+private:
+  // (has K accesses, K-th most recent or oldest access), the evictable
+  // value with the least goes first; timestamps are unique
+  typedef std::pair<bool, uint64_t> Rank;
+
+  struct History {
+    // most recent access at the back, at most k_ entries
+    std::deque<uint64_t> accesses_;
+    bool evictable_ = false;
+  };
+
+  inline Rank RankOf(const History &history) const {
+    return Rank(history.accesses_.size() >= k_, history.accesses_.front());
+  }
+
+  size_t k_;
+  uint64_t current_timestamp_;
+  std::unordered_map<T, History> history_;
+  // the evictable values in the order Victim takes them
+  std::map<Rank, T> evictable_;
+};
+
+} // namespace cmudb
@@ -31,6 +31,8 @@ public:
 
   size_t Size();
 
+  void PeekVictims(size_t n, std::vector<T> &values);
+
 private:
   // add your member variables here
   using Iterator = typename std::list<T>::iterator;
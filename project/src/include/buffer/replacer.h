@@ -6,9 +6,13 @@
 #pragma once
 
 #include <cstdlib>
+#include <vector>
 
 namespace cmudb {
 
+// replacement policies a buffer pool can be built with
+enum class ReplacerType { LRU = 0, CLOCK, LRU_K, ARC };
+
 template <typename T> class Replacer {
 public:
   Replacer() {}
@@ -17,6 +21,9 @@ public:
   virtual bool Victim(T &value) = 0;
   virtual bool Erase(const T &value) = 0;
   virtual size_t Size() = 0;
+  // append up to n evictable values to values, next victim first, without
+  // removing them
+  virtual void PeekVictims(size_t n, std::vector<T> &values) = 0;
 };
 
 } // namespace cmudb
@@ -0,0 +1,66 @@
+/**
+ * catalog.h
+ *
+ * Root page ids of the tables and indexes by name, for any number of them:
+ * the header page holds a few dozen records at most, and every lookup
+ * there scans and latches page 0. The catalog keeps them in a VarKeyTree
+ * over the buffer pool instead, whose own root is the CATALOG_RECORD of the
+ * header page, and all of them in memory, read once as it is loaded.
+ * Lookups take a shared latch and touch no page.
+ *
+ * A name the catalog does not have is looked up in the header page, where
+ * files written before it and indexes recording their roots themselves
+ * keep them. The tree is not logged: changes reach disk with Flush, at a
+ * checkpoint or at shutdown, and recovery sets roots again from the log,
+ * see RootCatalog.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/rwmutex.h"
+#include "index/var_key_tree.h"
+
+namespace cmudb {
+
+// header page record of the root of the catalog tree
+#define CATALOG_RECORD "__catalog"
+
+class Catalog {
+public:
+  // the header page and the tree are in buffer_pool_manager
+  explicit Catalog(BufferPoolManager *buffer_pool_manager)
+      : buffer_pool_manager_(buffer_pool_manager), loaded_(false) {}
+
+  // read the catalog tree into memory, once the header page is there. Done
+  // by the first lookup otherwise
+  void Load();
+
+  // the root of name, INVALID_PAGE_ID if there is none
+  page_id_t GetRoot(const std::string &name);
+  // name has root page_id from now on. Throws for a name longer than the
+  // tree takes, see VarKeyTree::GetMaxKeySize
+  void SetRoot(const std::string &name, page_id_t page_id);
+  // write the tree and the header page pointing at it to disk
+  void Flush();
+
+  // names in the catalog
+  size_t GetSize();
+
+private:
+  // Load, with latch_ held for writing
+  void LoadLocked();
+
+  BufferPoolManager *buffer_pool_manager_;
+  RWMutex latch_;
+  std::atomic<bool> loaded_;
+  std::unique_ptr<VarKeyTree> tree_;
+  std::unordered_map<std::string, page_id_t> roots_;
+};
+
+} // namespace cmudb
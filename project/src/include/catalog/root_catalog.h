@@ -0,0 +1,91 @@
+/**
+ * root_catalog.h
+ *
+ * Root page ids of the indexes, kept in memory. A root swap only changes the
+ * catalog; the header page gets the roots later, when the catalog is
+ * flushed, at a checkpoint or at shutdown. Each swap bumps the version of
+ * the index's root.
+ *
+ * With logging the swap is in the log first, in the BTREESTRUCTURE record of
+ * the change, and recovery sets the header page from it. Until a flush the
+ * catalog stands for a dirty header page: PrepareSwap, before the record is
+ * appended, gives it a recLSN the same way pinning a page does, and a
+ * checkpoint puts the header page in its dirty page table with it, see
+ * GetRecLSN. A flush writes only roots whose records are durable.
+ *
+ * With a Catalog the roots are read from and flushed to it rather than the
+ * header page.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/catalog.h"
+#include "logging/log_manager.h"
+
+namespace cmudb {
+
+class RootCatalog {
+public:
+  // the header page is in buffer_pool_manager, log_manager and catalog may
+  // be nullptr
+  RootCatalog(BufferPoolManager *buffer_pool_manager,
+              LogManager *log_manager = nullptr, Catalog *catalog = nullptr)
+      : buffer_pool_manager_(buffer_pool_manager), log_manager_(log_manager),
+        catalog_(catalog), rec_lsn_(INVALID_LSN), in_flight_(0) {}
+
+  // the root of index name, read from the header page the first time, or
+  // from the catalog.
+  // INVALID_PAGE_ID for an index without one. Its version goes to version,
+  // if given: 0 until the first swap
+  page_id_t GetRoot(const std::string &name, uint64_t *version = nullptr);
+
+  // with logging, before the record of a swap is appended
+  void PrepareSwap();
+  // name has root page_id from now on, lsn is the record of the swap if
+  // logged. Returns the new version
+  uint64_t SwapRoot(const std::string &name, page_id_t page_id,
+                    lsn_t lsn = INVALID_LSN);
+
+  // write the roots swapped since the last flush into the header page and
+  // the header page to disk, or into the catalog and the catalog to disk.
+  // False if the header page cannot be fetched
+  bool Flush();
+
+  // the lowest LSN of a swap that may not be in the header page on disk,
+  // INVALID_LSN if there is none
+  lsn_t GetRecLSN();
+
+private:
+  struct IndexRoot {
+    page_id_t page_id_;
+    uint64_t version_;
+    lsn_t lsn_;  // of the last swap, INVALID_LSN if not logged
+    bool dirty_; // swapped since the last flush
+  };
+
+  // the entry of name, loaded from the header page if new. Called with
+  // latch_ held
+  IndexRoot &Find(const std::string &name);
+  // write dirty roots into the header page and it to disk
+  bool WriteHeaderPage(
+      const std::vector<std::pair<std::string, IndexRoot>> &dirty);
+
+  BufferPoolManager *buffer_pool_manager_;
+  LogManager *log_manager_;
+  Catalog *catalog_;
+  std::mutex latch_;
+  std::unordered_map<std::string, IndexRoot> roots_;
+  lsn_t rec_lsn_;
+  // swaps between PrepareSwap and SwapRoot
+  int in_flight_;
+};
+
+} // namespace cmudb
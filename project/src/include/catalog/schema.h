@@ -9,6 +9,7 @@
 
 #include "catalog/column.h"
 #include "type/type.h"
+#include "type/type_dispatch.h"
 
 namespace cmudb {
 
@@ -67,6 +68,21 @@ public:
     return columns[column_id].IsInlined();
   }
 
+  // the code of the type of the column, bound when the schema is built
+  // rather than reached per value through its Type, see type_dispatch.h;
+  // nullptr for a type without
+  inline StoredComparator GetComparator(const int column_id) const {
+    return comparators[column_id];
+  }
+  inline StoredSerializer GetSerializer(const int column_id) const {
+    return serializers[column_id];
+  }
+  // the stored value of the column as a Value of its type, for the
+  // fixed-size types
+  inline StoredCaster GetReader(const int column_id) const {
+    return readers[column_id];
+  }
+
   inline const Column GetColumn(const int column_id) const {
     return columns[column_id];
   }
@@ -101,6 +117,10 @@ public:
   // Returns a flag indicating whether all columns are inlined
   inline bool IsInlined() const { return tuple_is_inlined; }
 
+  // all columns inlined and of fixed-size types, each with a reader: a
+  // tuple of the schema is GetLength() bytes, every column at its offset
+  inline bool IsFixedLayout() const { return fixed_layout; }
+
   // Get a string representation for debugging
   std::string ToString() const;
 
@@ -117,6 +137,13 @@ private:
   // keeps track of unlined columns, using logical position(start with 0)
   std::vector<int> uninlined_columns;
 
+  // by column, a column against one of its type
+  std::vector<StoredComparator> comparators;
+  std::vector<StoredSerializer> serializers;
+  std::vector<StoredCaster> readers;
+
+  bool fixed_layout;
+
   // keeps track of indexed columns in original table
   // std::vector<int> indexed_columns_;
 };
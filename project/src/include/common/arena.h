@@ -0,0 +1,98 @@
+/**
+ * arena.h
+ *
+ * Bump allocator for what a scan or a statement builds per row: tuples,
+ * varchar values and keys are carved out of blocks of ARENA_BLOCK_SIZE and
+ * nothing is freed on its own. Reset drops them all at once but keeps the
+ * blocks, so an arena reset once per row or batch stops allocating
+ * after warming up. Requests over a quarter of a block get one of their own.
+ * Not thread-safe.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class Arena {
+public:
+  explicit Arena(size_t block_size = ARENA_BLOCK_SIZE)
+      : block_size_(block_size), current_(0), ptr_(nullptr), remaining_(0) {}
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // size bytes, aligned for any scalar type, valid until the next Reset
+  inline char *Allocate(size_t size) {
+    size_t padding = (ALIGNMENT - reinterpret_cast<size_t>(ptr_) % ALIGNMENT) %
+                     ALIGNMENT;
+    if (size + padding > remaining_) {
+      return AllocateSlow(size);
+    }
+    char *result = ptr_ + padding;
+    ptr_ += size + padding;
+    remaining_ -= size + padding;
+    return result;
+  }
+
+  // a copy of size bytes at data
+  inline char *Copy(const char *data, size_t size) {
+    char *result = Allocate(size);
+    memcpy(result, data, size);
+    return result;
+  }
+
+  // everything allocated is gone, the blocks but the large ones are kept
+  inline void Reset() {
+    large_blocks_.clear();
+    if (blocks_.empty()) {
+      return;
+    }
+    current_ = 0;
+    ptr_ = blocks_[0].get();
+    remaining_ = block_size_;
+  }
+
+  // blocks held, the large ones included
+  inline size_t GetBlockCount() const {
+    return blocks_.size() + large_blocks_.size();
+  }
+
+private:
+  static const size_t ALIGNMENT = alignof(std::max_align_t);
+
+  char *AllocateSlow(size_t size) {
+    if (size > block_size_ / 4) {
+      // would waste too much of a block, on its own
+      large_blocks_.emplace_back(new char[size]);
+      return large_blocks_.back().get();
+    }
+    if (!blocks_.empty() && current_ + 1 < blocks_.size()) {
+      // a block of before the last reset
+      current_++;
+    } else {
+      blocks_.emplace_back(new char[block_size_]);
+      current_ = blocks_.size() - 1;
+    }
+    char *result = blocks_[current_].get();
+    ptr_ = result + size;
+    remaining_ = block_size_ - size;
+    return result;
+  }
+
+  size_t block_size_;
+  // the block allocated from
+  size_t current_;
+  char *ptr_;
+  size_t remaining_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  std::vector<std::unique_ptr<char[]>> large_blocks_;
+};
+
+} // namespace cmudb
@@ -14,20 +14,100 @@ namespace cmudb {
 
 extern std::chrono::duration<long long int> LOG_TIMEOUT;
 
+// how long the log flush thread lets committers gather for one flush
+extern std::chrono::microseconds LOG_GROUP_COMMIT_WINDOW;
+
 extern std::atomic<bool> ENABLE_LOGGING;
 
+extern std::chrono::milliseconds PAGE_CLEANER_TIMEOUT;
+
+// how often the checkpoint thread takes a fuzzy checkpoint
+extern std::chrono::milliseconds CHECKPOINT_TIMEOUT;
+
+// how often the deadlock detector looks for cycles among lock waiters
+extern std::chrono::milliseconds DEADLOCK_DETECTION_INTERVAL;
+
+// how often old tuple versions no snapshot can see are dropped
+extern std::chrono::milliseconds VERSION_GC_INTERVAL;
+
+// how often the background task scheduler adjusts its throttle
+extern std::chrono::milliseconds SCHEDULER_THROTTLE_INTERVAL;
+
+// commit latency above which the storage engine throttles background work
+extern std::chrono::microseconds BACKGROUND_LATENCY_TARGET;
+
 #define INVALID_PAGE_ID -1 // representing an invalid page id
 #define INVALID_TXN_ID -1  // representing an invalid txn id
 #define INVALID_LSN -1     // representing an invalid lsn
+#define INVALID_TIMESTAMP -1 // representing a version not yet committed
 #define HEADER_PAGE_ID 0   // the header page id
-#define PAGE_SIZE 512     // size of a data page in byte
-#define LOG_BUFFER_SIZE                                                            \
-  ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE) // size of a log buffer in byte
+#define PAGE_SIZE 4096    // default size of a data page in byte
+#define MIN_PAGE_SIZE 512     // smallest page size a database may use
+#define MAX_PAGE_SIZE 16384   // largest page size a database may use
+// size of a log buffer in byte, room for the pages of a whole buffer pool
+// whatever size a database picks for them
+#define LOG_BUFFER_SIZE ((BUFFER_POOL_SIZE + 1) * MAX_PAGE_SIZE)
+#define LOG_BUFFER_SEGMENTS 4          // log buffers in the append ring
+#define LOG_FILE_SIZE (16 * LOG_BUFFER_SIZE) // size of a log file in byte
+#define LOG_READ_AHEAD_SIZE (4 * LOG_BUFFER_SIZE) // log read at once
+#define CACHELINE_SIZE 64              // size of a cpu cache line in byte
+#define LATCH_SPIN_COUNT 100           // tries of a latch before parking
+#define KEY_SEARCH_SCAN 16             // keys a page search scans, not halves
+#define BULK_LOAD_FILL_FACTOR 0.9      // share of a page a bulk load fills
+#define MERGE_FILL_FACTOR 0.5          // B+ tree pages below this share merge
+#define INDEX_READ_AHEAD 8             // leaves an index scan prefetches ahead
+#define ORDERED_SCAN_BATCH 16          // entries an ordered scan reads first
+#define ORDERED_SCAN_MAX_BATCH 4096    // entries it reads at once, doubling
+#define BTREE_STATS_SAMPLES 64         // root to leaf paths B+ tree stats read
+#define BTREE_STATS_BUCKETS 16         // buckets of a B+ tree key histogram
+#define BACKGROUND_THREADS 2           // workers of the background scheduler
+#define INDEX_BUILD_THREADS 4          // scan and sort workers of an index build
+#define INDEX_BUILD_RUN_SIZE 65536     // entries a build worker sorts in memory
+#define SCAN_MORSEL_PAGES 8            // pages a parallel scan worker claims
+#define SCAN_BATCH_SIZE 64             // tuples a batch scan reads at most
+#define IMPORT_BATCH_SIZE 1024         // rows a bulk import appends at once
+#define STATS_SAMPLE_SIZE 1024         // tuples table stats are worked out of
+#define STATS_HISTOGRAM_BUCKETS 16     // buckets of a column histogram
+#define STATS_REBUILD_SHARE 0.2        // share of rows changed, stats redone
+#define ARENA_BLOCK_SIZE 8192          // bytes of a block of a row arena
+#define TUPLE_INLINE_SHARE 0.25        // share of a page a tuple fills unspilled
+#define OVERFLOW_PREFIX_SIZE 16        // bytes of a spilled varchar kept inline
+#define PAX_PAYLOAD_SHARE 0.5          // share of a PAX page kept for varchars
+#define BEPSILON_PIVOT_SHARE 0.1       // share of a B-epsilon node for pivots
+#define BLOOM_BITS_PER_KEY 10          // bits an index bloom filter has per key
+#define BLOOM_REBUILD_SHARE 0.5        // share of its keys a filter loses, rebuilt
 #define BUCKET_SIZE 50                 // size of extendible hash bucket
 #define BUFFER_POOL_SIZE 10            // size of buffer pool
+#define LRU_K_HISTORY 2                // history length of LRU-K replacer
+#define CLEANER_LOW_WATERMARK 0.2      // start cleaning below this clean share
+#define CLEANER_HIGH_WATERMARK 0.4     // stop cleaning at this clean share
+#define EXTENT_SIZE 64                 // pages the db file grows by at once
+#define STRIPE_UNIT_PAGES 64           // consecutive pages per stripe file
+#define PAGE_CHECKSUM_OFFSET 8         // bytes 8-11 of every page: CRC32C
+#define DIRECT_IO_ALIGNMENT 512        // buffer alignment O_DIRECT needs
+#define DISK_IO_QUEUE_DEPTH 64         // page I/Os in flight per scheduler
+#define DISK_IO_WORKERS 4              // threads of the fallback scheduler
+#define LOCK_TABLE_SHARDS 16           // partitions of the lock table
+#define LOCK_ESCALATION_PAGE 64        // tuple locks of a txn on a page at most
+#define LOCK_ESCALATION_TABLE 1024     // tuple locks of a txn on a table at most
+#define LOCK_HOT_KEYS_TRACKED 32       // contended keys tracked per lock shard
+#define LOCK_HOT_KEYS 10               // contended keys a lock stats snapshot has
+#define TXN_INLINE_SET_SIZE 16         // lock set entries a txn keeps inline
+#define TXN_POOL_SIZE 64               // finished txns kept for reuse at most
+#define MEMORY_CREDIT_SIZE 65536       // bytes a thread reserves at once
+#define LOCK_ESCALATION_PAGE_TIGHT 8   // LOCK_ESCALATION_PAGE short of memory
+#define LOCK_ESCALATION_TABLE_TIGHT 128 // LOCK_ESCALATION_TABLE short of memory
 
 typedef int32_t page_id_t; // page id type
 typedef int32_t txn_id_t;  // transaction id type
 typedef int32_t lsn_t;     // log sequence number type
+typedef int64_t log_offset_t; // byte offset into the log
+typedef int64_t timestamp_t; // commit timestamp type
+
+// page sizes are powers of two between MIN_PAGE_SIZE and MAX_PAGE_SIZE
+inline bool IsValidPageSize(size_t page_size) {
+  return page_size >= MIN_PAGE_SIZE && page_size <= MAX_PAGE_SIZE &&
+         (page_size & (page_size - 1)) == 0;
+}
 
 } // namespace cmudb
\ No newline at end of file
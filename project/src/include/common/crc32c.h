@@ -0,0 +1,22 @@
+/**
+ * crc32c.h
+ *
+ * CRC32C (Castagnoli polynomial), the checksum of page images. Computed with
+ * the SSE4.2 crc32 instruction or the ARMv8 CRC extension when the build
+ * target has it, and with a lookup table otherwise
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cmudb {
+
+// crc continues a checksum over earlier data, 0 starts a new one
+uint32_t Crc32c(const char *data, size_t length, uint32_t crc = 0);
+
+// true if Crc32c runs on CRC instructions instead of the table
+bool Crc32cIsHardware();
+
+} // namespace cmudb
@@ -41,6 +41,8 @@ enum ExceptionType {
   EXCEPTION_TYPE_STAT = 20,             // stat related
   EXCEPTION_TYPE_CONNECTION = 21,       // connection related
   EXCEPTION_TYPE_SYNTAX = 22,           // syntax related
+  EXCEPTION_TYPE_IO = 23,               // disk I/O, corrupted pages
+  EXCEPTION_TYPE_OUT_OF_MEMORY = 24,    // over the memory budget
 };
 
 class Exception : public std::runtime_error {
@@ -107,6 +109,10 @@ public:
       return "Connection";
     case EXCEPTION_TYPE_SYNTAX:
       return "Syntax";
+    case EXCEPTION_TYPE_IO:
+      return "I/O";
+    case EXCEPTION_TYPE_OUT_OF_MEMORY:
+      return "Out of Memory";
     default:
       return "Unknown";
     }
@@ -0,0 +1,91 @@
+/**
+ * histogram.h
+ *
+ * Power of two histogram of latencies or sizes: bucket i counts the values
+ * in [2^i, 2^(i+1)), bucket 0 takes 0 as well, the last bucket everything
+ * above. Recording is relaxed atomic adds; a snapshot is a plain struct
+ * that can be merged and scraped.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace cmudb {
+
+// point-in-time copy of a histogram
+struct HistogramSnapshot {
+  static const int BUCKETS = 40;
+
+  uint64_t buckets[BUCKETS] = {};
+  uint64_t count = 0; // values recorded
+  uint64_t sum = 0;   // their sum
+
+  HistogramSnapshot &operator+=(const HistogramSnapshot &other) {
+    for (int i = 0; i < BUCKETS; ++i) {
+      buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    return *this;
+  }
+
+  double Mean() const {
+    return count == 0 ? 0 : static_cast<double>(sum) / count;
+  }
+
+  // upper bound of the bucket holding quantile q, e.g. 0.99, 0 if empty
+  uint64_t Percentile(double q) const {
+    uint64_t rank = static_cast<uint64_t>(q * count);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+      seen += buckets[i];
+      if (seen > rank || (seen == count && seen > 0)) {
+        return (static_cast<uint64_t>(1) << (i + 1)) - 1;
+      }
+    }
+    return 0;
+  }
+};
+
+class Histogram {
+public:
+  static inline int BucketOf(uint64_t value) {
+    int bucket = 63 - __builtin_clzll(value | 1);
+    return bucket < HistogramSnapshot::BUCKETS
+               ? bucket
+               : HistogramSnapshot::BUCKETS - 1;
+  }
+
+  inline void Record(uint64_t value) {
+    buckets_[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  HistogramSnapshot Snapshot() const {
+    HistogramSnapshot snapshot;
+    for (int i = 0; i < HistogramSnapshot::BUCKETS; ++i) {
+      snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    return snapshot;
+  }
+
+  void Reset() {
+    for (auto &bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint64_t> buckets_[HistogramSnapshot::BUCKETS] = {};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+};
+
+} // namespace cmudb
@@ -0,0 +1,146 @@
+/**
+ * memory_tracker.h
+ *
+ * Process-wide account of the memory of the engine, by consumer, against an
+ * optional budget. Consumers report what they allocate and free; the usage
+ * of each is a gauge "memory.<consumer>" of the metrics registry too.
+ *
+ * When an allocation would go over the budget, the elastic consumers are
+ * shrunk first, lowest priority first: the compressed page tier drops
+ * pages, prefetching reads less ahead, transactions escalate their locks
+ * sooner. They grow back once the usage is under half the budget. Only
+ * when that is not enough is an allocation refused, and what can fail
+ * fails: the lock request aborts its transaction, the buffer pool or log
+ * buffers cannot be created. Rows being worked on are counted but never
+ * refused.
+ *
+ * Small amounts go through a credit of the thread, MEMORY_CREDIT_SIZE bytes
+ * taken from the budget at once, so the rows and lock requests of hot paths
+ * touch nothing shared: the budget is checked and the gauges of the
+ * consumers are updated once per credit taken or given back. The usage
+ * counts those credits, it may be over the sum of the consumers by a credit
+ * or two per thread; the consumers lag by as much, except for the thread
+ * reading them.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+#include "common/metrics.h"
+
+namespace cmudb {
+
+enum class MemoryConsumer {
+  BUFFER_POOL,      // frames of the buffer pools
+  LOG_BUFFER,       // segments of the log append ring
+  HASH_TABLE,       // buckets of the page tables
+  RECOVERY,         // log read buffer of recovery
+  LOCK_TABLE,       // requests in the lock table
+  TUPLE,            // rows copied out of their pages
+  COMPRESSED_CACHE, // pages of the compressed tier, elastic
+};
+static const int MEMORY_CONSUMERS = 7;
+
+// the elastic consumers, in the order they are shrunk
+enum class ElasticPriority { COMPRESSED_CACHE, PREFETCH, LOCK_ESCALATION };
+
+// point-in-time copy of the account
+struct MemoryStats {
+  size_t budget = 0; // 0 for none
+  size_t usage = 0;
+  size_t consumers[MEMORY_CONSUMERS] = {};
+  uint64_t shrinks = 0;  // times the elastic consumers were shrunk
+  uint64_t refusals = 0; // allocations refused
+
+  inline size_t GetUsage(MemoryConsumer consumer) const {
+    return consumers[static_cast<int>(consumer)];
+  }
+};
+
+class MemoryTracker {
+public:
+  // the tracker of the process
+  static MemoryTracker &Instance();
+  // name of consumer, as in its gauge
+  static const char *NameOf(MemoryConsumer consumer);
+
+  // 0 lifts the budget. The usage may stay over a budget lowered under it
+  void SetBudget(size_t bytes);
+  inline size_t GetBudget() const {
+    return budget_.load(std::memory_order_relaxed);
+  }
+
+  // count bytes for consumer if the budget has room for them, shrinking the
+  // elastic consumers if need be; false and nothing counted if not
+  bool Reserve(MemoryConsumer consumer, size_t bytes);
+  // the same for an allocation that cannot fail: counted over the budget
+  void Charge(MemoryConsumer consumer, size_t bytes);
+  // for an elastic consumer to grow: false if the budget has no room,
+  // nothing else is shrunk for it
+  bool TryGrow(MemoryConsumer consumer, size_t bytes);
+  void Release(MemoryConsumer consumer, size_t bytes);
+
+  // shrink(bytes) frees up to bytes and returns how many it freed, 0 if it
+  // only uses less from now on; grow() undoes it, may be empty. Returns
+  // the handle to unregister with, before the consumer is gone
+  int RegisterElastic(ElasticPriority priority,
+                      std::function<size_t(size_t)> shrink,
+                      std::function<void()> grow = nullptr);
+  void UnregisterElastic(int handle);
+
+  // the counts of the calling thread are in, those of others may lag
+  MemoryStats GetStats() const;
+
+private:
+  MemoryTracker();
+
+  // bytes of the budget for the credit of the thread or an allocation
+  bool AcquireSmall(size_t bytes, bool shrink, bool force);
+  // bytes more in total_; shrink first if over the budget, refused then
+  // unless forced
+  bool Acquire(size_t bytes, bool shrink, bool force);
+  // bytes for the gauge of consumer, small ones kept with the credit
+  void Count(MemoryConsumer consumer, int64_t bytes);
+  // the counts kept with the credit of the thread into the gauges
+  static void Publish();
+  // shrink the elastic consumers until the usage is within the budget
+  void Shrink();
+  // let them grow again if the usage is under half the budget
+  void GrowIfRelieved();
+
+  // bytes of the budget taken by a thread and not used yet, and what the
+  // thread counted for each consumer since it last updated the gauges
+  struct Credit {
+    size_t bytes_ = 0;
+    int64_t counts_[MEMORY_CONSUMERS] = {};
+    ~Credit();
+  };
+  static thread_local Credit credit_;
+
+  struct Elastic {
+    int handle_;
+    ElasticPriority priority_;
+    std::function<size_t(size_t)> shrink_;
+    std::function<void()> grow_;
+  };
+
+  std::atomic<size_t> budget_{0};
+  std::atomic<size_t> total_{0};
+  Gauge *usage_[MEMORY_CONSUMERS];
+  std::atomic<uint64_t> shrinks_{0};
+  std::atomic<uint64_t> refusals_{0};
+  // elastic consumers, by priority; held while they shrink or grow
+  std::mutex elastic_latch_;
+  std::vector<Elastic> elastic_;
+  int next_handle_ = 0;
+  std::atomic<bool> shrunk_{false};
+};
+
+} // namespace cmudb
@@ -0,0 +1,238 @@
+/**
+ * metrics.h
+ *
+ * Process-wide registry of named metrics, cheap enough for hot paths:
+ * counters sharded by thread, so concurrent adds do not share a cache line,
+ * gauges, and HDR-style histograms. A metric is looked up by name once and
+ * the pointer kept, it lives as long as the process; Snapshot copies them
+ * all, sorted by name, see also the vtable_metrics table of the module.
+ *
+ * Trace points count an event under "<category>.<name>", TRACE_VALUE also
+ * records a value into the histogram of that name. They compile to nothing
+ * without TRACE_POINTS; with USDT_PROBES and <sys/sdt.h> they fire the
+ * probe vtable:<category>_<name> with their arguments as well, for perf or
+ * bpftrace.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(USDT_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define METRICS_HAVE_USDT
+#endif
+#endif
+
+namespace cmudb {
+
+// shards of a counter or histogram, each thread adds to one of them
+static const int METRICS_SHARDS = 16;
+
+// the shard of the calling thread, threads take them round robin
+inline int MetricsShard() {
+  static std::atomic<int> next{0};
+  thread_local int shard =
+      next.fetch_add(1, std::memory_order_relaxed) % METRICS_SHARDS;
+  return shard;
+}
+
+class Counter {
+public:
+  inline void Add(uint64_t value = 1) {
+    shards_[MetricsShard()].value_.fetch_add(value,
+                                             std::memory_order_relaxed);
+  }
+
+  uint64_t Value() const {
+    uint64_t value = 0;
+    for (auto &shard : shards_) {
+      value += shard.value_.load(std::memory_order_relaxed);
+    }
+    return value;
+  }
+
+  void Reset() {
+    for (auto &shard : shards_) {
+      shard.value_.store(0, std::memory_order_relaxed);
+    }
+  }
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value_{0};
+  };
+  Shard shards_[METRICS_SHARDS];
+};
+
+// a level rather than a count, set or moved by anyone
+class Gauge {
+public:
+  inline void Set(int64_t value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+  inline void Add(int64_t value) {
+    value_.fetch_add(value, std::memory_order_relaxed);
+  }
+  int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+  void Reset() { Set(0); }
+
+private:
+  std::atomic<int64_t> value_{0};
+};
+
+// point-in-time copy of an HdrHistogram
+struct HdrHistogramSnapshot {
+  std::vector<uint64_t> buckets;
+  uint64_t count = 0;
+  uint64_t sum = 0;
+  uint64_t max = 0;
+
+  HdrHistogramSnapshot &operator+=(const HdrHistogramSnapshot &other);
+
+  double Mean() const {
+    return count == 0 ? 0 : static_cast<double>(sum) / count;
+  }
+  // the highest value of the bucket holding quantile q, e.g. 0.99, within
+  // 1/16 of the value recorded, no more than max; 0 if empty
+  uint64_t Percentile(double q) const;
+};
+
+/*
+ * Values up to 2^64 in log-linear buckets: every power of two is cut into
+ * 16, so a bucket is within 1/16 of its values, and those below 16 have one
+ * each. Recording is relaxed adds into the shard of the thread
+ */
+class HdrHistogram {
+public:
+  static const int SUB_BUCKET_BITS = 4;
+  static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static const int BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  static inline int BucketOf(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+      return static_cast<int>(value);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS +
+           static_cast<int>((value >> shift) & (SUB_BUCKETS - 1));
+  }
+  // the lowest and highest values of bucket
+  static uint64_t LowestOf(int bucket);
+  static uint64_t HighestOf(int bucket);
+
+  inline void Record(uint64_t value) {
+    Shard &shard = shards_[MetricsShard()];
+    shard.buckets_[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.count_.fetch_add(1, std::memory_order_relaxed);
+    shard.sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = shard.max_.load(std::memory_order_relaxed);
+    while (value > max && !shard.max_.compare_exchange_weak(
+                              max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  HdrHistogramSnapshot Snapshot() const;
+  void Reset();
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> buckets_[BUCKETS] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+  };
+  // large, allocated only when the histogram is
+  std::unique_ptr<Shard[]> shards_{new Shard[METRICS_SHARDS]};
+};
+
+enum class MetricKind { COUNTER, GAUGE, HISTOGRAM };
+
+struct MetricSnapshot {
+  std::string name;
+  MetricKind kind;
+  // of a counter or a gauge, the count of a histogram
+  int64_t value = 0;
+  HdrHistogramSnapshot histogram;
+};
+
+class Metrics {
+public:
+  // the registry of the process
+  static Metrics &Instance();
+
+  // the metric of name, created the first time. A name has a single kind,
+  // asking for another one throws
+  Counter *GetCounter(const std::string &name);
+  Gauge *GetGauge(const std::string &name);
+  HdrHistogram *GetHistogram(const std::string &name);
+
+  // every metric whose name starts with prefix, sorted by name
+  std::vector<MetricSnapshot> Snapshot(const std::string &prefix = "") const;
+  // counts and histograms back to zero, gauges kept
+  void Reset();
+
+private:
+  template <typename M>
+  M *Get(const std::string &name, MetricKind kind,
+         std::map<std::string, std::unique_ptr<M>> &metrics);
+
+  mutable std::mutex latch_;
+  std::map<std::string, MetricKind> kinds_;
+  std::map<std::string, std::unique_ptr<Counter>> counters_;
+  std::map<std::string, std::unique_ptr<Gauge>> gauges_;
+  std::map<std::string, std::unique_ptr<HdrHistogram>> histograms_;
+};
+
+#ifdef METRICS_HAVE_USDT
+#define TRACE_PROBE(category, name, ...)                                      \
+  STAP_PROBEV(vtable, category##_##name, ##__VA_ARGS__)
+#else
+#define TRACE_PROBE(category, name, ...)                                      \
+  do {                                                                        \
+  } while (0)
+#endif
+
+#ifdef TRACE_POINTS
+// the metric, looked up once per trace point
+#define TRACE_METRIC(getter, category, name)                                  \
+  ([]() {                                                                     \
+    static auto metric = Metrics::Instance().getter(#category "." #name);     \
+    return metric;                                                            \
+  }())
+
+#define TRACE_POINT(category, name, ...)                                      \
+  do {                                                                        \
+    TRACE_METRIC(GetCounter, category, name)->Add();                          \
+    TRACE_PROBE(category, name, ##__VA_ARGS__);                               \
+  } while (0)
+
+#define TRACE_VALUE(category, name, value, ...)                               \
+  do {                                                                        \
+    TRACE_METRIC(GetHistogram, category, name)->Record(value);                \
+    TRACE_PROBE(category, name, value, ##__VA_ARGS__);                        \
+  } while (0)
+
+#define TRACE_GAUGE(category, name, delta)                                    \
+  TRACE_METRIC(GetGauge, category, name)->Add(delta)
+#else
+#define TRACE_POINT(category, name, ...)                                      \
+  do {                                                                        \
+  } while (0)
+#define TRACE_VALUE(category, name, value, ...)                               \
+  do {                                                                        \
+  } while (0)
+#define TRACE_GAUGE(category, name, delta)                                    \
+  do {                                                                        \
+  } while (0)
+#endif
+
+} // namespace cmudb
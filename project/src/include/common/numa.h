@@ -0,0 +1,40 @@
+/**
+ * numa.h
+ *
+ * The NUMA nodes of the host, read from /sys/devices/system/node, and
+ * placement of memory and threads on them through the mbind and
+ * sched_setaffinity system calls, so libnuma is not needed. On hosts with
+ * one node, or without the sysfs tree, everything is node 0 and placement
+ * does nothing.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace cmudb {
+
+class Numa {
+public:
+  // nodes of the host, 1 at least
+  static int NodeCount();
+  // the node of the cpu the calling thread runs on
+  static int CurrentNode();
+  // cpus of node, empty if unknown
+  static std::vector<int> CpusOf(int node);
+
+  // prefer node for the pages of [data, data + size) not faulted in yet,
+  // those already in are moved. The range is narrowed to whole pages.
+  // False if the host has a single node or the kernel refused
+  static bool BindMemory(void *data, size_t size, int node);
+  // let the calling thread run on the cpus of node only, false if the host
+  // has a single node or the kernel refused
+  static bool PinThread(int node);
+
+  // the numbers of a sysfs list such as "0-3,8,10-11"
+  static std::vector<int> ParseList(const std::string &list);
+};
+
+} // namespace cmudb
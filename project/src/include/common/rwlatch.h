@@ -0,0 +1,111 @@
+/**
+ * rwlatch.h
+ *
+ * Reader-writer latch in one atomic word: the top bit is set by the writer
+ * holding or waiting for the latch, the rest count the readers. Taking and
+ * releasing it uncontended is a single atomic operation, no mutex. A thread
+ * that cannot take it spins for LATCH_SPIN_COUNT tries, then parks on a
+ * condition variable; releases only touch the mutex when someone is parked.
+ * Like RWMutex, a writer waiting keeps new readers out.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "common/config.h"
+
+namespace cmudb {
+class RWLatch {
+  static const uint32_t WRITER = 1u << 31;
+  static const uint32_t READERS = WRITER - 1;
+
+public:
+  RWLatch() : state_(0), parked_(0) {}
+
+  // a releasing thread may still be waking the parked ones
+  ~RWLatch() { std::lock_guard<std::mutex> guard(mutex_); }
+
+  RWLatch(const RWLatch &) = delete;
+  RWLatch &operator=(const RWLatch &) = delete;
+
+  void WLock() {
+    // enter, then wait for the readers to drain
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while (true) {
+      if ((state & WRITER) == 0 &&
+          state_.compare_exchange_weak(state, state | WRITER)) {
+        break;
+      }
+      state = Await([this] { return (state_.load() & WRITER) == 0; });
+    }
+    if ((state & READERS) != 0) {
+      Await([this] { return (state_.load() & READERS) == 0; });
+    }
+  }
+
+  void WUnlock() {
+    state_.fetch_and(~WRITER);
+    Wake();
+  }
+
+  void RLock() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while ((state & WRITER) != 0 ||
+           !state_.compare_exchange_weak(state, state + 1)) {
+      if ((state & WRITER) != 0) {
+        state = Await([this] { return (state_.load() & WRITER) == 0; });
+      }
+    }
+  }
+
+  // take it for read if no writer holds or waits for it, without waiting
+  bool TryRLock() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while ((state & WRITER) == 0) {
+      if (state_.compare_exchange_weak(state, state + 1)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void RUnlock() {
+    // the last reader lets a waiting writer in
+    if (state_.fetch_sub(1) == (WRITER | 1)) {
+      Wake();
+    }
+  }
+
+private:
+  // spin, then park, until ready holds. Returns the state then
+  template <typename Ready> uint32_t Await(Ready ready) {
+    for (int i = 0; i < LATCH_SPIN_COUNT; ++i) {
+      if (ready()) {
+        return state_.load(std::memory_order_relaxed);
+      }
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    // counted before ready is checked, so a release after the check sees it
+    parked_.fetch_add(1);
+    cond_.wait(lock, ready);
+    parked_.fetch_sub(1);
+    return state_.load(std::memory_order_relaxed);
+  }
+
+  inline void Wake() {
+    if (parked_.load() != 0) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      cond_.notify_all();
+    }
+  }
+
+  std::atomic<uint32_t> state_;
+  std::atomic<uint32_t> parked_; // threads waiting on cond_
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};
+} // namespace cmudb
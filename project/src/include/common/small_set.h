@@ -0,0 +1,138 @@
+/**
+ * small_set.h
+ *
+ * Set with inline storage for its first N elements, searched linearly; only
+ * a set growing past N moves to a hash set. Clearing it keeps both, so a
+ * reused set of a few elements never allocates. Erasing or inserting
+ * invalidates its iterators.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <unordered_set>
+#include <utility>
+
+namespace cmudb {
+
+template <typename T, size_t N, typename Hash = std::hash<T>> class SmallSet {
+  typedef std::unordered_set<T, Hash> LargeSet;
+
+public:
+  class const_iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T *pointer;
+    typedef const T &reference;
+
+    const_iterator(const T *ptr, typename LargeSet::const_iterator it)
+        : ptr_(ptr), it_(it) {}
+    inline const T &operator*() const { return ptr_ != nullptr ? *ptr_ : *it_; }
+    inline const T *operator->() const { return &**this; }
+    inline const_iterator &operator++() {
+      if (ptr_ != nullptr) {
+        ++ptr_;
+      } else {
+        ++it_;
+      }
+      return *this;
+    }
+    inline bool operator==(const const_iterator &other) const {
+      return ptr_ == other.ptr_ && it_ == other.it_;
+    }
+    inline bool operator!=(const const_iterator &other) const {
+      return !(*this == other);
+    }
+
+  private:
+    const T *ptr_; // into the inline elements, nullptr once large
+    typename LargeSet::const_iterator it_;
+  };
+  typedef const_iterator iterator;
+
+  SmallSet() : size_(0), large_(false) {}
+
+  inline const_iterator begin() const {
+    return large_ ? const_iterator(nullptr, large_set_.begin())
+                  : const_iterator(inline_, large_set_.end());
+  }
+  inline const_iterator end() const {
+    return large_ ? const_iterator(nullptr, large_set_.end())
+                  : const_iterator(inline_ + size_, large_set_.end());
+  }
+
+  inline size_t size() const { return large_ ? large_set_.size() : size_; }
+  inline bool empty() const { return size() == 0; }
+
+  const_iterator find(const T &value) const {
+    if (large_) {
+      return const_iterator(nullptr, large_set_.find(value));
+    }
+    for (size_t i = 0; i < size_; ++i) {
+      if (inline_[i] == value) {
+        return const_iterator(inline_ + i, large_set_.end());
+      }
+    }
+    return end();
+  }
+  inline size_t count(const T &value) const {
+    return find(value) != end() ? 1 : 0;
+  }
+
+  std::pair<const_iterator, bool> insert(const T &value) {
+    if (!large_) {
+      auto it = find(value);
+      if (it != end()) {
+        return std::make_pair(it, false);
+      }
+      if (size_ < N) {
+        inline_[size_] = value;
+        return std::make_pair(const_iterator(inline_ + size_++,
+                                             large_set_.end()),
+                              true);
+      }
+      // spill
+      large_set_.insert(inline_, inline_ + size_);
+      size_ = 0;
+      large_ = true;
+    }
+    auto result = large_set_.insert(value);
+    return std::make_pair(const_iterator(nullptr, result.first),
+                          result.second);
+  }
+  inline std::pair<const_iterator, bool> emplace(const T &value) {
+    return insert(value);
+  }
+
+  size_t erase(const T &value) {
+    if (large_) {
+      return large_set_.erase(value);
+    }
+    for (size_t i = 0; i < size_; ++i) {
+      if (inline_[i] == value) {
+        inline_[i] = inline_[--size_];
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  // back to inline storage, the hash set keeps its buckets
+  inline void clear() {
+    size_ = 0;
+    large_set_.clear();
+    large_ = false;
+  }
+
+private:
+  T inline_[N];
+  size_t size_; // inline elements
+  bool large_;  // whether the elements are in large_set_ instead
+  LargeSet large_set_;
+};
+
+} // namespace cmudb
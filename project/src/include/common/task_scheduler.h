@@ -0,0 +1,139 @@
+/**
+ * task_scheduler.h
+ *
+ * A pool of background threads the maintenance work of the engine shares
+ * instead of a thread each: checkpoints, the page cleaner, the deadlock
+ * detector, version GC. Tasks run once or every interval, by priority.
+ *
+ * Every worker has a deque per priority; a task submitted from a worker
+ * goes to its own, others go round robin. A worker takes its newest task of
+ * the highest priority, else steals the oldest one of that priority from
+ * another worker, before going down a priority. A periodic task is queued
+ * when it is due and again an interval after its round ended, so rounds
+ * never overlap.
+ *
+ * HIGH tasks always run. NORMAL and LOW ones run on a limited number of
+ * workers at once, the throttle: all of them unless set, and with a latency
+ * probe it halves while the foreground latency is over its target and grows
+ * back by one worker a round while it is not.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+enum class TaskPriority { HIGH = 0, NORMAL, LOW };
+
+typedef int64_t task_id_t;
+
+struct TaskSchedulerStats {
+  uint64_t tasks = 0;     // task runs, periodic rounds included
+  uint64_t steals = 0;    // of them, taken off another worker's deque
+  uint64_t throttles = 0; // probe rounds that halved the throttle
+  size_t threads = 0;
+  size_t throttle = 0;    // workers NORMAL and LOW tasks may use now
+};
+
+class TaskScheduler {
+public:
+  explicit TaskScheduler(size_t threads = BACKGROUND_THREADS);
+  ~TaskScheduler();
+
+  // run task once, soon
+  void Submit(std::function<void()> task,
+              TaskPriority priority = TaskPriority::NORMAL);
+  // run task every interval, the first time interval from now
+  task_id_t SchedulePeriodic(std::function<void()> task,
+                             std::chrono::milliseconds interval,
+                             TaskPriority priority = TaskPriority::NORMAL);
+  // no more rounds of a periodic task, returns once a round running has
+  // ended. Not from the task itself
+  void Cancel(task_id_t id);
+  // returns once no task is queued or running, periodic ones not due aside
+  void WaitIdle();
+  // run the tasks queued, drop the periodic ones and join the workers.
+  // Tasks submitted later are dropped
+  void Stop();
+
+  // most workers running NORMAL and LOW tasks at once, 1 at least
+  void SetThrottle(size_t workers);
+  // every SCHEDULER_THROTTLE_INTERVAL, the throttle halves if probe, the
+  // foreground latency since its last call, is over target, and grows by
+  // one up to the SetThrottle limit if not. nullptr stops that. probe is
+  // called under the scheduler's latch and must not schedule tasks
+  void SetLatencyProbe(std::function<uint64_t()> probe, uint64_t target);
+
+  TaskSchedulerStats GetStats() const;
+
+private:
+  struct Periodic {
+    std::function<void()> task_;
+    std::chrono::milliseconds interval_;
+    TaskPriority priority_;
+    std::chrono::steady_clock::time_point due_;
+    bool queued_ = false; // in a deque or running
+    bool cancelled_ = false;
+  };
+
+  struct Task {
+    std::function<void()> run_;
+    std::shared_ptr<Periodic> periodic_; // nullptr for a one-shot task
+  };
+
+  static const int PRIORITIES = 3;
+
+  struct Worker {
+    std::mutex latch_;
+    std::deque<Task> queues_[PRIORITIES];
+    std::thread thread_;
+  };
+
+  void RunWorker(size_t self);
+  // a task for worker self, false if none may run now
+  bool Take(size_t self, Task &task, TaskPriority &priority);
+  void Push(Task task, TaskPriority priority);
+  // queue the periodic tasks due, returns when the next one is due. Under
+  // latch_
+  std::chrono::steady_clock::time_point QueueDue();
+  // a NORMAL or LOW task may start
+  bool Runnable() const;
+  void AdjustThrottle();
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  // queued tasks by priority, running NORMAL and LOW ones
+  std::atomic<size_t> pending_[PRIORITIES];
+  std::atomic<size_t> running_background_;
+  std::atomic<size_t> running_;
+  std::atomic<size_t> throttle_;
+  size_t throttle_limit_;
+  std::atomic<size_t> next_worker_;
+  bool stopped_;
+  // periodic_, stopped_, the probe and sleeping workers
+  std::mutex latch_;
+  std::condition_variable work_cv_; // a task was queued or may run now
+  std::condition_variable done_cv_; // a task ended
+  std::map<task_id_t, std::shared_ptr<Periodic>> periodic_;
+  task_id_t next_id_;
+  std::function<uint64_t()> probe_;
+  uint64_t probe_target_;
+  task_id_t probe_task_;
+  std::atomic<uint64_t> tasks_;
+  std::atomic<uint64_t> steals_;
+  std::atomic<uint64_t> throttles_;
+};
+
+} // namespace cmudb
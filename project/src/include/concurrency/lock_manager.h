@@ -2,25 +2,74 @@
  * lock_manager.h
  *
  * Tuple level lock manager, use wait-die to prevent deadlocks
+ *
+ * The lock table is split into shards by the hash of the locked key. Each
+ * shard has its own latch and maps a key to its queue of requests, granted
+ * ones first, so locking keys of different shards never contends. A request
+ * is granted once it is compatible with every request in front of it. A
+ * transaction waits only for older (smaller id) transactions, a younger one
+ * dies.
+ *
+ * Tables and pages may be locked as well, see lock_mode.h: a scan takes one
+ * S lock on its table instead of one per tuple. Tuple locks given their
+ * table take the intention locks on the table and the page first, and none
+ * of their own if a lock above covers them already.
+ *
+ * Lock escalation: once a transaction holds more tuple locks below one page
+ * or table than its threshold, the lock on the page or table is converted
+ * to S, or X if one of them is exclusive, and the tuple locks are released.
+ * Escalation is skipped while another transaction's lock conflicts.
+ *
+ * An update (U) lock is taken by a transaction reading what it is going to
+ * write. Only one transaction holds U on a key, readers may share it, so
+ * the conversion to X waits for the readers only. A conversion with no
+ * conflicting request is done in place, without requeueing. A U holder's
+ * conversion wounds the conversion of another transaction waiting on it.
+ *
+ * Instead of wait-die, a deadlock detector thread may be run: transactions
+ * then wait for any other, and every DEADLOCK_DETECTION_INTERVAL the
+ * detector builds the waits-for graph and aborts the youngest transaction
+ * of each cycle. Aborts are counted by cause, see LockAbortStats, and
+ * requests, waits and their keys by shard, see LockStats.
  */
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "common/rid.h"
+#include "common/task_scheduler.h"
+#include "concurrency/lock_mode.h"
+#include "concurrency/lock_stats.h"
 #include "concurrency/transaction.h"
 
 namespace cmudb {
 
+// point-in-time copy of the abort counters, by cause
+struct LockAbortStats {
+  uint64_t wait_die = 0;   // requests that died for an older conflicting one
+  uint64_t wounded = 0;    // waiters younger than a conversion put before them
+  uint64_t conversion = 0; // conversions of a key another one waits on
+  uint64_t shrinking = 0;  // lock requests after an unlock, under 2PL
+  uint64_t deadlock = 0;   // victims of the deadlock detector
+  uint64_t memory = 0;     // requests refused by the memory budget
+};
+
 class LockManager {
 
 public:
-  LockManager(bool strict_2PL) : strict_2PL_(strict_2PL){};
+  // escalates sooner while memory is tight, see memory_tracker.h
+  LockManager(bool strict_2PL, size_t num_shards = LOCK_TABLE_SHARDS);
+  ~LockManager();
 
   /*** below are APIs need to implement ***/
   // lock:
@@ -28,17 +77,157 @@ public:
   // it should be blocked on waiting and should return true when granted
   // note the behavior of trying to lock locked rids by same txn is undefined
   // it is transaction's job to keep track of its current locks
-  bool LockShared(Transaction *txn, const RID &rid);
-  bool LockExclusive(Transaction *txn, const RID &rid);
-  bool LockUpgrade(Transaction *txn, const RID &rid);
+  // table_id is the table of rid, INVALID_PAGE_ID locks the tuple alone
+  bool LockShared(Transaction *txn, const RID &rid,
+                  page_id_t table_id = INVALID_PAGE_ID);
+  bool LockExclusive(Transaction *txn, const RID &rid,
+                     page_id_t table_id = INVALID_PAGE_ID);
+  // the exclusive lock of rid and the intention locks above it only if they
+  // are granted at once, for callers holding a latch: false without waiting,
+  // txn left running, if another transaction's request is in the way
+  bool TryLockExclusive(Transaction *txn, const RID &rid,
+                        page_id_t table_id = INVALID_PAGE_ID);
+  // read rid with the intent to write it, see lock_mode.h. Blocks other U
+  // and X requests, not S ones
+  bool LockUpdate(Transaction *txn, const RID &rid,
+                  page_id_t table_id = INVALID_PAGE_ID);
+  // txn must hold the shared or update lock. Only one upgrade of a rid may
+  // wait, a second one aborts unless it upgrades an update lock
+  bool LockUpgrade(Transaction *txn, const RID &rid,
+                   page_id_t table_id = INVALID_PAGE_ID);
 
   // unlock:
   // release the lock hold by the txn
+  // under strict 2PL only once the txn has committed or aborted
   bool Unlock(Transaction *txn, const RID &rid);
   /*** END OF APIs ***/
 
+  // table and page locks in any mode, a page lock takes the intention lock
+  // on its table first. A lock held already is converted to cover mode too
+  bool LockTable(Transaction *txn, page_id_t table_id, LockMode mode);
+  bool LockPage(Transaction *txn, page_id_t table_id, page_id_t page_id,
+                LockMode mode);
+  // release a lock of any level
+  bool Unlock(Transaction *txn, const LockKey &key);
+
+  // tuple locks a transaction may hold below one page or table before they
+  // are escalated, 0 never escalates
+  inline void SetEscalationThresholds(size_t page_threshold,
+                                      size_t table_threshold) {
+    page_configured_ = page_threshold;
+    table_configured_ = table_threshold;
+    page_threshold_ = page_threshold;
+    table_threshold_ = table_threshold;
+  }
+
+  // spawn the deadlock detector, wait-die is off while it runs. Switch only
+  // while no transaction waits for a lock
+  void RunDeadlockDetector(TaskScheduler *scheduler = nullptr);
+  void StopDeadlockDetector();
+  // one pass of the detector: abort a victim of every cycle of waiters,
+  // returns how many were aborted
+  size_t DetectDeadlocks();
+
+  LockAbortStats GetAbortStats() const;
+  // per shard counters, their sum, and the top_n keys requests waited or
+  // died on most
+  LockStats GetStats(size_t top_n = LOCK_HOT_KEYS);
+  void ResetStats();
+
 private:
+  struct LockRequest {
+    LockRequest(Transaction *txn, LockMode mode)
+        : txn_(txn), mode_(mode), granted_(false) {}
+    Transaction *txn_;
+    LockMode mode_;
+    bool granted_;
+  };
+
+  struct LockQueue {
+    std::list<LockRequest> requests_;
+    // waiters of this key, notified when a request leaves the queue
+    std::condition_variable cv_;
+    // the transaction of the conversion waiting, its request follows the
+    // granted ones
+    Transaction *converter_ = nullptr;
+  };
+
+  // padded, so neighbouring shards never share the line of a latch
+  struct Shard {
+    std::mutex latch_;
+    std::unordered_map<LockKey, LockQueue> queues_;
+    LockShardCounters stats_;
+    char padding_[CACHELINE_SIZE];
+  };
+
+  inline Shard &ShardOf(const LockKey &key) {
+    return shards_[std::hash<LockKey>()(key) % shards_.size()];
+  }
+  // lock rid below the intention locks of its table, counting it there.
+  // Unless wait, false without aborting if another request conflicts
+  bool LockTuple(Transaction *txn, const RID &rid, page_id_t table_id,
+                 LockMode mode, bool wait = true);
+  // escalate to key, the page or table of table_id, if possible
+  void Escalate(Transaction *txn, const LockKey &key, page_id_t table_id);
+  // drop the lock of txn on key, from the queue and from txn
+  bool Release(Transaction *txn, const LockKey &key);
+  // the mode txn holds key in, false if it holds no lock on it
+  static bool HeldMode(Transaction *txn, const LockKey &key, LockMode &mode);
+  // take the intention locks on the table and the page a lock in mode below
+  // them needs. covered is set if those already grant the lock
+  bool LockAbove(Transaction *txn, page_id_t table_id, page_id_t page_id,
+                 LockMode mode, bool &covered, bool wait = true);
+  // lock key in mode, converting a lock txn holds on it already
+  bool Acquire(Transaction *txn, const LockKey &key, LockMode mode,
+               bool wait = true);
+  // queue a request of txn for key in mode and wait for it. Unless wait,
+  // false without aborting if another request conflicts
+  bool Lock(Transaction *txn, const LockKey &key, LockMode mode,
+            bool wait = true);
+  // turn the granted lock of txn on key into one in mode. Unless wait,
+  // false without aborting if another request conflicts
+  bool Convert(Transaction *txn, const LockKey &key, LockMode mode,
+               bool wait = true);
+  // record the lock of txn on key in mode in txn, in place of an older one
+  static void RecordLock(Transaction *txn, const LockKey &key, LockMode mode);
+  // false and abort txn if it may not take locks any more
+  bool CanLock(Transaction *txn);
+  // abort txn for cause, drop its queue if empty, return false
+  bool Die(Transaction *txn, Shard &shard, const LockKey &key,
+           std::atomic<uint64_t> &cause);
+  // the youngest transaction on a cycle of waits_for, INVALID_TXN_ID if
+  // there is none
+  static txn_id_t
+  FindVictim(const std::map<txn_id_t, std::set<txn_id_t>> &waits_for);
+  // block until request is compatible with all in front of it or its txn is
+  // aborted, then record the lock in the txn
+  bool Wait(Transaction *txn, Shard &shard, const LockKey &key,
+            std::list<LockRequest>::iterator request,
+            std::unique_lock<std::mutex> &guard);
+
   bool strict_2PL_;
+  std::atomic<size_t> page_threshold_;
+  std::atomic<size_t> table_threshold_;
+  // the thresholds set, restored once memory is no longer tight
+  std::atomic<size_t> page_configured_;
+  std::atomic<size_t> table_configured_;
+  int elastic_; // handle with the memory tracker
+  std::vector<Shard> shards_;
+  // deadlock detector
+  std::thread *detector_thread_;
+  std::atomic<bool> detector_running_;
+  std::mutex detector_latch_;
+  std::condition_variable detector_cv_;
+  // instead of the thread
+  TaskScheduler *scheduler_;
+  task_id_t detector_task_;
+  // aborts by cause
+  std::atomic<uint64_t> wait_die_aborts_{0};
+  std::atomic<uint64_t> wounded_aborts_{0};
+  std::atomic<uint64_t> conversion_aborts_{0};
+  std::atomic<uint64_t> shrinking_aborts_{0};
+  std::atomic<uint64_t> deadlock_aborts_{0};
+  std::atomic<uint64_t> memory_aborts_{0};
 };
 
 } // namespace cmudb
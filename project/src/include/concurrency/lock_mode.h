@@ -0,0 +1,141 @@
+/**
+ * lock_mode.h
+ *
+ * Lock modes and what a lock is taken on, for multi-granularity locking:
+ * tables and pages take intention modes as well, telling which locks are
+ * held below them. A table is named by the first page of its heap.
+ *
+ * An update (U) lock is a read lock of a transaction that is going to write:
+ * it is compatible with S but not with another U, so its conversion to X
+ * never races another one for the same key.
+ *
+ *          IS  IX  S   SIX X   U
+ *     IS   y   y   y   y   n   y
+ *     IX   y   y   n   n   n   n
+ *     S    y   n   y   n   n   y
+ *     SIX  y   n   n   n   n   n
+ *     X    n   n   n   n   n   n
+ *     U    y   n   y   n   n   n
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "common/rid.h"
+
+namespace cmudb {
+
+enum class LockMode {
+  INTENTION_SHARED = 0,
+  INTENTION_EXCLUSIVE,
+  SHARED,
+  SHARED_INTENTION_EXCLUSIVE,
+  EXCLUSIVE,
+  UPDATE
+};
+
+enum class LockLevel { TABLE = 0, PAGE, TUPLE };
+
+// whether a and b may be granted to two transactions at once
+inline bool Compatible(LockMode a, LockMode b) {
+  static const bool matrix[6][6] = {
+      {true, true, true, true, false, true},
+      {true, true, false, false, false, false},
+      {true, false, true, false, false, true},
+      {true, false, false, false, false, false},
+      {false, false, false, false, false, false},
+      {true, false, true, false, false, false}};
+  return matrix[static_cast<int>(a)][static_cast<int>(b)];
+}
+
+// whether holding held grants everything mode would
+inline bool Covers(LockMode held, LockMode mode) {
+  switch (mode) {
+  case LockMode::INTENTION_SHARED:
+    return true;
+  case LockMode::INTENTION_EXCLUSIVE:
+    return held == LockMode::INTENTION_EXCLUSIVE ||
+           held == LockMode::SHARED_INTENTION_EXCLUSIVE ||
+           held == LockMode::EXCLUSIVE;
+  case LockMode::SHARED:
+    return held == LockMode::SHARED || held == LockMode::UPDATE ||
+           held == LockMode::SHARED_INTENTION_EXCLUSIVE ||
+           held == LockMode::EXCLUSIVE;
+  case LockMode::UPDATE:
+    return held == LockMode::UPDATE ||
+           held == LockMode::SHARED_INTENTION_EXCLUSIVE ||
+           held == LockMode::EXCLUSIVE;
+  case LockMode::SHARED_INTENTION_EXCLUSIVE:
+    return held == LockMode::SHARED_INTENTION_EXCLUSIVE ||
+           held == LockMode::EXCLUSIVE;
+  default:
+    return held == LockMode::EXCLUSIVE;
+  }
+}
+
+// the weakest mode covering both a and b
+inline LockMode Combine(LockMode a, LockMode b) {
+  if (Covers(a, b)) {
+    return a;
+  }
+  if (Covers(b, a)) {
+    return b;
+  }
+  // IX and S or U, or SIX and one of them
+  if (a != LockMode::EXCLUSIVE && b != LockMode::EXCLUSIVE) {
+    return LockMode::SHARED_INTENTION_EXCLUSIVE;
+  }
+  return LockMode::EXCLUSIVE;
+}
+
+// the mode a lock on a parent must have so mode may be taken below it, IX
+// for U, which is going to be converted to X
+inline LockMode IntentionFor(LockMode mode) {
+  return mode == LockMode::INTENTION_SHARED || mode == LockMode::SHARED
+             ? LockMode::INTENTION_SHARED
+             : LockMode::INTENTION_EXCLUSIVE;
+}
+
+// whether held on a parent makes a lock in mode below it unnecessary
+inline bool CoversChildren(LockMode held, LockMode mode) {
+  if (held == LockMode::EXCLUSIVE) {
+    return true;
+  }
+  return (held == LockMode::SHARED || held == LockMode::UPDATE ||
+          held == LockMode::SHARED_INTENTION_EXCLUSIVE) &&
+         (mode == LockMode::INTENTION_SHARED || mode == LockMode::SHARED);
+}
+
+// a table, page or tuple
+struct LockKey {
+  LockKey(LockLevel level, int64_t id) : level_(level), id_(id) {}
+
+  static inline LockKey Table(page_id_t table_id) {
+    return LockKey(LockLevel::TABLE, table_id);
+  }
+  static inline LockKey Page(page_id_t page_id) {
+    return LockKey(LockLevel::PAGE, page_id);
+  }
+  static inline LockKey Tuple(const RID &rid) {
+    return LockKey(LockLevel::TUPLE, rid.Get());
+  }
+
+  bool operator==(const LockKey &other) const {
+    return level_ == other.level_ && id_ == other.id_;
+  }
+
+  LockLevel level_;
+  int64_t id_;
+};
+
+} // namespace cmudb
+
+namespace std {
+template <> struct hash<cmudb::LockKey> {
+  size_t operator()(const cmudb::LockKey &obj) const {
+    return hash<int64_t>()(obj.id_) * 3 + static_cast<size_t>(obj.level_);
+  }
+};
+} // namespace std
@@ -0,0 +1,132 @@
+/**
+ * lock_stats.h
+ *
+ * Counters of the lock manager, per shard of the lock table, to tell hot
+ * rows apart from buffer pool or log bottlenecks. They are bumped under the
+ * latch of their shard, so plain integers do. Each shard also tracks the
+ * keys its requests waited or died on most, with the space saving
+ * algorithm: at most LOCK_HOT_KEYS_TRACKED keys, a new one replaces the
+ * least contended and inherits its count, so counts are upper bounds. Times
+ * are in nanoseconds.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+#include "common/histogram.h"
+#include "concurrency/lock_mode.h"
+
+namespace cmudb {
+
+static const int NUM_LOCK_MODES = 6;
+
+// point-in-time copy of the counters of one shard, or of all
+struct LockShardStats {
+  uint64_t requests[NUM_LOCK_MODES] = {}; // by mode, conversions by the new
+  uint64_t grants = 0;                    // requests granted
+  uint64_t waits = 0;                     // requests not granted at once
+  HistogramSnapshot wait_ns;              // how long those waited
+  uint64_t aborts = 0; // requests that died and waiters wounded or chosen
+                       // as deadlock victims
+
+  inline uint64_t Requests() const {
+    uint64_t total = 0;
+    for (auto count : requests) {
+      total += count;
+    }
+    return total;
+  }
+
+  LockShardStats &operator+=(const LockShardStats &other) {
+    for (int i = 0; i < NUM_LOCK_MODES; ++i) {
+      requests[i] += other.requests[i];
+    }
+    grants += other.grants;
+    waits += other.waits;
+    wait_ns += other.wait_ns;
+    aborts += other.aborts;
+    return *this;
+  }
+};
+
+// a key and how many of its requests waited or died
+struct LockHotKey {
+  LockKey key_;
+  uint64_t conflicts_;
+};
+
+struct LockStats {
+  std::vector<LockShardStats> shards;
+  LockShardStats total;
+  std::vector<LockHotKey> hot_keys; // most contended first
+};
+
+class LockShardCounters {
+public:
+  inline void Request(LockMode mode) {
+    requests_[static_cast<int>(mode)]++;
+  }
+
+  // a request on key waited or died
+  void Conflict(const LockKey &key) {
+    auto it = hot_keys_.find(key);
+    if (it != hot_keys_.end()) {
+      it->second++;
+      return;
+    }
+    uint64_t count = 0;
+    if (hot_keys_.size() >= LOCK_HOT_KEYS_TRACKED) {
+      auto least = hot_keys_.begin();
+      for (auto other = hot_keys_.begin(); other != hot_keys_.end(); ++other) {
+        if (other->second < least->second) {
+          least = other;
+        }
+      }
+      count = least->second;
+      hot_keys_.erase(least);
+    }
+    hot_keys_.emplace(key, count + 1);
+  }
+
+  LockShardStats Snapshot() const {
+    LockShardStats stats;
+    for (int i = 0; i < NUM_LOCK_MODES; ++i) {
+      stats.requests[i] = requests_[i];
+    }
+    stats.grants = grants_;
+    stats.waits = waits_;
+    stats.wait_ns = wait_ns_.Snapshot();
+    stats.aborts = aborts_;
+    return stats;
+  }
+
+  void HotKeys(std::vector<LockHotKey> &keys) const {
+    for (auto &entry : hot_keys_) {
+      keys.push_back(LockHotKey{entry.first, entry.second});
+    }
+  }
+
+  void Reset() {
+    for (auto &count : requests_) {
+      count = 0;
+    }
+    grants_ = waits_ = aborts_ = 0;
+    wait_ns_.Reset();
+    hot_keys_.clear();
+  }
+
+  uint64_t requests_[NUM_LOCK_MODES] = {};
+  uint64_t grants_ = 0;
+  uint64_t waits_ = 0;
+  Histogram wait_ns_;
+  uint64_t aborts_ = 0;
+
+private:
+  std::unordered_map<LockKey, uint64_t> hot_keys_;
+};
+
+} // namespace cmudb
@@ -8,10 +8,12 @@
 #include <deque>
 #include <memory>
 #include <thread>
-#include <unordered_set>
+#include <unordered_map>
 
 #include "common/config.h"
 #include "common/logger.h"
+#include "common/small_set.h"
+#include "concurrency/lock_mode.h"
 #include "page/page.h"
 #include "table/tuple.h"
 
@@ -36,32 +38,78 @@ class TableHeap;
 class WriteRecord {
 public:
   WriteRecord(RID rid, WType wtype, const Tuple &tuple, TableHeap *table)
-      : rid_(rid), wtype_(wtype), tuple_(tuple), table_(table) {}
+      : rid_(rid), wtype_(wtype), tuple_(tuple), table_(table) {
+    // it may outlive what the tuple refers to
+    tuple_.Detach();
+  }
 
   RID rid_;
   WType wtype_;
-  // tuple is only for update operation
+  // tuple is only for update operation: the old tuple. Writes buffered by an
+  // optimistic transaction keep the new one, for inserts and updates
   Tuple tuple_;
   // which table
   TableHeap *table_;
 };
 
+// read set record of an optimistic transaction, see TupleVersionTable
+class ReadRecord {
+public:
+  ReadRecord(RID rid, timestamp_t version) : rid_(rid), version_(version) {}
+
+  RID rid_;
+  // version of the tuple when read
+  timestamp_t version_;
+};
+
+// lock sets of a transaction, most hold a few entries
+typedef SmallSet<RID, TXN_INLINE_SET_SIZE> RIDSet;
+typedef SmallSet<page_id_t, TXN_INLINE_SET_SIZE> PageIdSet;
+
 class Transaction {
 public:
   Transaction(Transaction const &) = delete;
   Transaction(txn_id_t txn_id)
       : state_(TransactionState::GROWING),
         thread_id_(std::this_thread::get_id()),
-        txn_id_(txn_id), prev_lsn_(INVALID_LSN), shared_lock_set_{new std::unordered_set<RID>},
-        exclusive_lock_set_{new std::unordered_set<RID>} {
+        txn_id_(txn_id), prev_lsn_(INVALID_LSN), async_commit_(false),
+        read_ts_(0), optimistic_(false),
+        shared_lock_set_{new RIDSet},
+        exclusive_lock_set_{new RIDSet}, update_lock_set_{new RIDSet},
+        coarse_lock_set_{new std::unordered_map<LockKey, LockMode>},
+        tuple_lock_counts_{new std::unordered_map<LockKey, size_t>},
+        page_tables_{new std::unordered_map<page_id_t, page_id_t>} {
     // initialize sets
     write_set_.reset(new std::deque<WriteRecord>);
+    read_set_.reset(new std::deque<ReadRecord>);
     page_set_.reset(new std::deque<Page *>);
-    deleted_page_set_.reset(new std::unordered_set<page_id_t>);
+    deleted_page_set_.reset(new PageIdSet);
   }
 
   ~Transaction() {}
 
+  // start over as transaction txn_id, on this thread. The containers are
+  // cleared, they keep their storage, see TransactionManager::Release
+  void Reset(txn_id_t txn_id) {
+    state_ = TransactionState::GROWING;
+    thread_id_ = std::this_thread::get_id();
+    txn_id_ = txn_id;
+    prev_lsn_ = INVALID_LSN;
+    async_commit_ = false;
+    read_ts_ = 0;
+    optimistic_ = false;
+    write_set_->clear();
+    read_set_->clear();
+    page_set_->clear();
+    deleted_page_set_->clear();
+    shared_lock_set_->clear();
+    exclusive_lock_set_->clear();
+    update_lock_set_->clear();
+    coarse_lock_set_->clear();
+    tuple_lock_counts_->clear();
+    page_tables_->clear();
+  }
+
   //===--------------------------------------------------------------------===//
   // Mutators and Accessors
   //===--------------------------------------------------------------------===//
@@ -73,11 +121,15 @@ public:
     return write_set_;
   }
 
+  inline std::shared_ptr<std::deque<ReadRecord>> GetReadSet() {
+    return read_set_;
+  }
+
   inline std::shared_ptr<std::deque<Page *>> GetPageSet() { return page_set_; }
 
   inline void AddIntoPageSet(Page *page) { page_set_->push_back(page); }
 
-  inline std::shared_ptr<std::unordered_set<page_id_t>> GetDeletedPageSet() {
+  inline std::shared_ptr<PageIdSet> GetDeletedPageSet() {
     return deleted_page_set_;
   }
 
@@ -85,14 +137,33 @@ public:
     deleted_page_set_->insert(page_id);
   }
 
-  inline std::shared_ptr<std::unordered_set<RID>> GetSharedLockSet() {
+  inline std::shared_ptr<RIDSet> GetSharedLockSet() {
     return shared_lock_set_;
   }
 
-  inline std::shared_ptr<std::unordered_set<RID>> GetExclusiveLockSet() {
+  inline std::shared_ptr<RIDSet> GetExclusiveLockSet() {
     return exclusive_lock_set_;
   }
 
+  inline std::shared_ptr<RIDSet> GetUpdateLockSet() {
+    return update_lock_set_;
+  }
+
+  inline std::shared_ptr<std::unordered_map<LockKey, LockMode>>
+  GetCoarseLockSet() {
+    return coarse_lock_set_;
+  }
+
+  inline std::shared_ptr<std::unordered_map<LockKey, size_t>>
+  GetTupleLockCounts() {
+    return tuple_lock_counts_;
+  }
+
+  inline std::shared_ptr<std::unordered_map<page_id_t, page_id_t>>
+  GetPageTables() {
+    return page_tables_;
+  }
+
   inline TransactionState GetState() { return state_; }
 
   inline void SetState(TransactionState state) { state_ = state; }
@@ -101,6 +172,24 @@ public:
 
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  // commit without waiting for the COMMIT record to be durable
+  inline bool IsAsyncCommit() { return async_commit_; }
+
+  inline void SetAsyncCommit(bool async_commit) {
+    async_commit_ = async_commit;
+  }
+
+  // snapshot: the commits up to this timestamp are seen, see VersionStore
+  inline timestamp_t GetReadTs() { return read_ts_; }
+
+  inline void SetReadTs(timestamp_t read_ts) { read_ts_ = read_ts; }
+
+  // optimistic: reads take no locks and writes are buffered until commit,
+  // see TransactionManager::SetOptimistic
+  inline bool IsOptimistic() { return optimistic_; }
+
+  inline void SetOptimistic(bool optimistic) { optimistic_ = optimistic; }
+
 private:
   TransactionState state_;
   // thread id, single-threaded transactions
@@ -111,17 +200,32 @@ private:
   std::shared_ptr<std::deque<WriteRecord>> write_set_;
   // prev lsn
   lsn_t prev_lsn_;
+  // a crash may lose the commit, see TransactionManager::SetAsyncCommit
+  bool async_commit_;
+  // timestamp of its snapshot
+  timestamp_t read_ts_;
+  bool optimistic_;
+  // tuples read by an optimistic transaction, validated at commit
+  std::shared_ptr<std::deque<ReadRecord>> read_set_;
 
   // Below are used by concurrent index
   // this deque contains page pointer that was latche during index operation
   std::shared_ptr<std::deque<Page *>> page_set_;
   // this set contains page_id that was deleted during index operation
-  std::shared_ptr<std::unordered_set<page_id_t>> deleted_page_set_;
+  std::shared_ptr<PageIdSet> deleted_page_set_;
 
   // Below are used by lock manager
   // this set contains rid of shared-locked tuples by this transaction
-  std::shared_ptr<std::unordered_set<RID>> shared_lock_set_;
+  std::shared_ptr<RIDSet> shared_lock_set_;
   // this set contains rid of exclusive-locked tuples by this transaction
-  std::shared_ptr<std::unordered_set<RID>> exclusive_lock_set_;
+  std::shared_ptr<RIDSet> exclusive_lock_set_;
+  // this set contains rid of update-locked tuples by this transaction
+  std::shared_ptr<RIDSet> update_lock_set_;
+  // this map contains the table and page locks of this transaction
+  std::shared_ptr<std::unordered_map<LockKey, LockMode>> coarse_lock_set_;
+  // for lock escalation: tuple locks held below each table and page, and
+  // the table of each page they were taken on
+  std::shared_ptr<std::unordered_map<LockKey, size_t>> tuple_lock_counts_;
+  std::shared_ptr<std::unordered_map<page_id_t, page_id_t>> page_tables_;
 };
 } // namespace cmudb
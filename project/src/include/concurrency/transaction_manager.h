@@ -5,10 +5,19 @@
 
 #pragma once
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
+#include "common/task_scheduler.h"
 #include "concurrency/lock_manager.h"
+#include "concurrency/tuple_version_table.h"
+#include "concurrency/version_store.h"
 #include "logging/log_manager.h"
 
 namespace cmudb {
@@ -16,16 +25,105 @@ class TransactionManager {
 public:
   TransactionManager(LockManager *lock_manager,
                            LogManager *log_manager = nullptr)
-      : next_txn_id_(0), lock_manager_(lock_manager),
-        log_manager_(log_manager) {}
+      : next_txn_id_(0), async_commit_(false), optimistic_(false),
+        lock_manager_(lock_manager),
+        log_manager_(log_manager), last_commit_ts_(0), gc_thread_(nullptr),
+        gc_running_(false), scheduler_(nullptr), gc_task_(-1) {
+    free_txns_.reserve(TXN_POOL_SIZE);
+  }
+  ~TransactionManager();
+  // the transaction reads the snapshot of the commits so far, see
+  // VersionStore. A transaction handed back by Release is reused
   Transaction *Begin();
-  void Commit(Transaction *txn);
+  // returns once the COMMIT record is durable, or for an async commit once
+  // it is appended to the log buffer. False if an optimistic transaction
+  // failed validation, it is aborted then
+  bool Commit(Transaction *txn);
   void Abort(Transaction *txn);
+  // hand back txn once it committed or aborted and nobody uses it any more,
+  // instead of deleting it. Up to TXN_POOL_SIZE are kept for Begin
+  void Release(Transaction *txn);
+
+  // whether transactions begun from now on commit asynchronously, each one
+  // may still change it. A crash loses the async commits of the last
+  // LOG_TIMEOUT at most, the log stays consistent
+  inline void SetAsyncCommit(bool async_commit) {
+    async_commit_ = async_commit;
+  }
+  inline bool IsAsyncCommit() { return async_commit_; }
+
+  // whether transactions begun from now on are optimistic (OCC): their reads
+  // take no locks and record the versions read, their writes are buffered.
+  // Commit validates the reads against the commits since, then applies the
+  // writes; validation and writes of optimistic commits are serial. For
+  // short read-mostly transactions, the tables need SetTupleVersions.
+  // Inserts are not validated, a scan may miss a phantom
+  inline void SetOptimistic(bool optimistic) { optimistic_ = optimistic; }
+  inline bool IsOptimistic() { return optimistic_; }
+
+  // durability barrier: returns once the log is durable up to lsn, e.g. the
+  // LSN of an async commit, i.e. txn->GetPrevLSN() after Commit
+  void WaitForDurable(lsn_t lsn);
+
+  // active transaction table, for fuzzy checkpoints: (txn id, last LSN) of
+  // every transaction begun and not yet committed or aborted. Returns the
+  // lowest LSN any of them may have logged, INVALID_LSN if there is none
+  lsn_t GetActiveTransactions(std::vector<std::pair<txn_id_t, lsn_t>> &txns);
+
+  // versions of the table heaps in MVCC mode, see TableHeap::SetVersionStore
+  inline VersionStore *GetVersionStore() { return &version_store_; }
+  // versions of the tuples for OCC, see TableHeap::SetTupleVersions
+  inline TupleVersionTable *GetTupleVersions() { return &tuple_versions_; }
+  // the oldest snapshot of an active transaction, or what a new one gets
+  timestamp_t GetOldestSnapshot();
+  // spawn a thread that drops every VERSION_GC_INTERVAL the versions no
+  // snapshot can see or validate against any more
+  void RunVersionGC(TaskScheduler *scheduler = nullptr);
+  void StopVersionGC();
 
 private:
+  // OCC: whether the reads of txn are still valid, then apply its buffered
+  // writes like a locking transaction would. False if txn must abort
+  bool Validate(Transaction *txn);
+  bool ApplyWrites(Transaction *txn);
+  // release the tuple locks of txn, then its page and table locks
+  void ReleaseLocks(Transaction *txn);
+  // end the snapshot of txn, its versions of rids commit or are dropped
+  void EndSnapshot(Transaction *txn, const std::vector<RID> &rids,
+                   bool commit);
+  // drop txn from the active transaction table
+  void EndTransaction(Transaction *txn);
+
   std::atomic<txn_id_t> next_txn_id_;
+  std::atomic<bool> async_commit_;
+  std::atomic<bool> optimistic_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
+  // txn id -> (transaction, LSN its BEGIN record got at the earliest). A
+  // transaction is in before its BEGIN record is appended
+  std::unordered_map<txn_id_t, std::pair<Transaction *, lsn_t>> active_txns_;
+  std::mutex active_latch_;
+  // MVCC: commits get increasing timestamps under snapshot_latch_, a
+  // snapshot is taken under it too so it sees whole commits only
+  VersionStore version_store_;
+  TupleVersionTable tuple_versions_;
+  // held by an optimistic commit from validation until its versions are
+  // published
+  std::mutex validation_latch_;
+  timestamp_t last_commit_ts_;
+  // txn id -> read timestamp of every active transaction
+  std::unordered_map<txn_id_t, timestamp_t> snapshots_;
+  std::mutex snapshot_latch_;
+  std::thread *gc_thread_;
+  std::atomic<bool> gc_running_;
+  std::mutex gc_latch_;
+  std::condition_variable gc_cv_;
+  // instead of the thread
+  TaskScheduler *scheduler_;
+  task_id_t gc_task_;
+  // transactions handed back, reused with their containers
+  std::vector<Transaction *> free_txns_;
+  std::mutex pool_latch_;
 };
 
 } // namespace cmudb
@@ -0,0 +1,75 @@
+/**
+ * tuple_version_table.h
+ *
+ * Commit versions of tuples, for validating optimistic transactions (OCC).
+ * The version of a tuple is the commit timestamp of its last write; a write
+ * not yet committed marks the tuple with its writer until it commits or
+ * aborts. An optimistic read records the version it saw; at commit the read
+ * is still valid if no write committed since and none is pending.
+ *
+ * Versions change under the page latch of their tuple, like the page does,
+ * so a read under the page latch sees a matching tuple and version. Tuples
+ * without an entry have version 0. Sharded by RID like the lock table.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+
+namespace cmudb {
+
+class TupleVersionTable {
+public:
+  explicit TupleVersionTable(size_t num_shards = LOCK_TABLE_SHARDS)
+      : shards_(num_shards) {}
+
+  // before txn writes rid: false if another transaction's write is pending
+  bool CanWrite(const RID &rid, Transaction *txn);
+  // after txn wrote rid, it stays pending until Commit or Abort
+  void Record(const RID &rid, Transaction *txn);
+
+  // the version of rid txn reads, false if another transaction's write is
+  // pending, the read would be dirty
+  bool Read(const RID &rid, Transaction *txn, timestamp_t &version);
+  // whether the version txn read of rid is still the last one
+  bool Validate(const RID &rid, Transaction *txn, timestamp_t version);
+
+  // the pending write of txn to rid commits at commit_ts, or is dropped once
+  // the tuple is rolled back
+  void Commit(const RID &rid, txn_id_t txn_id, timestamp_t commit_ts);
+  void Abort(const RID &rid, txn_id_t txn_id);
+
+  // drop the versions of watermark or older, no transaction begun before
+  // them is active any more. Returns how many
+  size_t Collect(timestamp_t watermark);
+
+  // entries kept
+  size_t GetEntryCount();
+
+private:
+  struct Entry {
+    timestamp_t version_;
+    txn_id_t writer_; // INVALID_TXN_ID if no write is pending
+  };
+
+  // padded, so neighbouring shards never share the line of a latch
+  struct Shard {
+    std::mutex latch_;
+    std::unordered_map<RID, Entry> entries_;
+    char padding_[CACHELINE_SIZE];
+  };
+
+  inline Shard &ShardOf(const RID &rid) {
+    return shards_[std::hash<RID>()(rid) % shards_.size()];
+  }
+
+  std::vector<Shard> shards_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,85 @@
+/**
+ * version_store.h
+ *
+ * Prior versions of tuples, for snapshot reads of table heaps (MVCC). The
+ * page holds the newest version of a tuple; every write before it keeps an
+ * undo entry here: its writer, its commit timestamp once committed, and the
+ * image of the tuple before it. Entries are kept newest first.
+ *
+ * A snapshot sees the state after the newest entry its transaction wrote or
+ * that committed at or before its read timestamp, the page if that is the
+ * newest entry, the image of the entry after it otherwise. Tuples without
+ * entries are seen as on the page.
+ *
+ * Entries are added and read under the page latch of their tuple, so they
+ * always match the page. Sharded by RID like the lock table.
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+#include "table/tuple.h"
+
+namespace cmudb {
+
+// what a snapshot sees of a tuple
+enum class VersionRead { LATEST, OLDER, NONE };
+
+class VersionStore {
+public:
+  explicit VersionStore(size_t num_shards = LOCK_TABLE_SHARDS)
+      : shards_(num_shards) {}
+
+  // before txn updates or deletes rid: false if another transaction wrote it
+  // and has not committed, or committed after the snapshot of txn
+  bool CanWrite(const RID &rid, Transaction *txn);
+  // after txn wrote rid, image is the tuple before, nullptr for an insert.
+  // Only the first write of a transaction keeps an entry
+  void Record(const RID &rid, Transaction *txn, const Tuple *image);
+
+  // which version of rid the snapshot of txn sees, an older one is copied
+  // into tuple
+  VersionRead Read(const RID &rid, Transaction *txn, Tuple &tuple);
+
+  // the entry txn wrote for rid commits at commit_ts, or is dropped once the
+  // tuple is rolled back
+  void Commit(const RID &rid, txn_id_t txn_id, timestamp_t commit_ts);
+  void Abort(const RID &rid, txn_id_t txn_id);
+
+  // drop the entries no snapshot at or after watermark needs, returns how
+  // many
+  size_t Collect(timestamp_t watermark);
+
+  // entries kept
+  size_t GetVersionCount();
+
+private:
+  struct UndoEntry {
+    txn_id_t writer_;
+    timestamp_t commit_ts_; // INVALID_TIMESTAMP until committed
+    bool existed_;          // false for an insert
+    Tuple before_;
+  };
+
+  // padded, so neighbouring shards never share the line of a latch
+  struct Shard {
+    std::mutex latch_;
+    std::unordered_map<RID, std::deque<UndoEntry>> chains_;
+    char padding_[CACHELINE_SIZE];
+  };
+
+  inline Shard &ShardOf(const RID &rid) {
+    return shards_[std::hash<RID>()(rid) % shards_.size()];
+  }
+
+  std::vector<Shard> shards_;
+};
+
+} // namespace cmudb
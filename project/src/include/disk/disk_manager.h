@@ -5,31 +5,199 @@
  * database. It also performs read and write of pages to and from disk, and
  * provides a logical file layer within the context of a database management
  * system.
+ *
+ * Deallocated pages are tracked in a free-space bitmap, kept in pages of its
+ * own that are chained from the first one, and AllocatePage hands the
+ * lowest free page out again before it grows the file. The first bitmap
+ * page is referenced from the header page under FREE_SPACE_MAP_RECORD.
+ * The file itself grows by EXTENT_SIZE pages at a time, the space is
+ * reserved with fallocate so appending pages does not update file system
+ * metadata for each of them.
+ *
+ * A database may also be a tablespace of several files, e.g. one per NVMe
+ * device, striped in units of stripe_pages pages: page ids
+ * [0, stripe_pages) are in the first file, the next stripe_pages in the
+ * second one and so on round robin, so sequential scans and flushes spread
+ * over all devices. The header page and the log are in (and named after)
+ * the first file.
+ * Bitmap page format (size in byte):
+ *  -----------------------------------------------------------
+ * | NextBitmapPageId (4) | Unused (4) | Checksum (4) |
+ *  -----------------------------------------------------------
+ * | one bit per page, 1 = free ...                            |
+ *  -----------------------------------------------------------
+ *
+ * With page checksums on, every page written gets the CRC32C of its image
+ * (the checksum field taken as zero) at PAGE_CHECKSUM_OFFSET, which every
+ * page format reserves, and ReadPage verifies it. A checksum of 0 means the
+ * page was never stamped, e.g. it was written with checksums off or is a
+ * hole in the file, and is not verified.
+ *
+ * The log is one byte stream split over files of LOG_FILE_SIZE bytes, the
+ * first one named <db>.log and file n <db>.log.<n>. Log offsets run on
+ * across files. Once the log is half way through a file, a background
+ * thread creates the next one and reserves its space with fallocate, so a
+ * flush does not allocate. The file size stays the bytes written, the end
+ * of the log is found from it on reopen. TruncateLog deletes the files
+ * entirely below an offset, e.g. the redo point of a checkpoint, except
+ * that the first file is only emptied: without it, the other files are
+ * taken for leftovers of a deleted log.
  */
 
 #pragma once
 #include <atomic>
-#include <fstream>
+#include <condition_variable>
+#include <functional>
 #include <future>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "common/config.h"
+#include "common/histogram.h"
 
 namespace cmudb {
 
+// header page record of the first free-space bitmap page
+#define FREE_SPACE_MAP_RECORD "__free_space_map"
+
+// cost of page checksums, point-in-time copy of the counters
+struct ChecksumStats {
+  uint64_t pages_stamped = 0;  // pages written with a checksum
+  uint64_t stamp_ns = 0;       // time spent computing them
+  uint64_t pages_verified = 0; // pages read whose checksum was checked
+  uint64_t verify_ns = 0;      // time spent checking them
+  uint64_t failures = 0;       // pages read that did not match
+};
+
+// cost of log writes, point-in-time copy of the counters. The latency is
+// that of the writes and the sync after them
+struct LogWriteStats {
+  uint64_t writes = 0;        // WriteLog calls with data
+  uint64_t bytes = 0;         // bytes they wrote
+  uint64_t errors = 0;        // calls cut short by an I/O error
+  HistogramSnapshot write_ns; // each call, latch wait excluded
+};
+
+// where a page lives in a multi-file tablespace
+struct PageLocation {
+  size_t file_;   // index into the tablespace files
+  size_t offset_; // byte offset within that file
+};
+
 class DiskManager {
 public:
-  DiskManager(const std::string &db_file);
+  // page_size is used for a new database file, an existing one keeps the
+  // page size recorded in its header page
+  // direct_io: bypass the OS page cache (O_DIRECT) where the file system
+  // supports it, see IsDirectIO
+  // read_only: open an existing file without writing to it, for replicas.
+  // The file is memory-mapped and the buffer pool serves pages straight from
+  // the mapping, writes and allocations are refused
+  DiskManager(const std::string &db_file, size_t page_size = PAGE_SIZE,
+              bool direct_io = false, bool read_only = false);
+  // a tablespace striped over db_files, which must be given in the same
+  // order and with the same stripe_pages every time it is opened
+  DiskManager(const std::vector<std::string> &db_files,
+              size_t page_size = PAGE_SIZE,
+              size_t stripe_pages = STRIPE_UNIT_PAGES, bool direct_io = false,
+              bool read_only = false);
   ~DiskManager();
 
   void WritePage(page_id_t page_id, const char *page_data);
-  void ReadPage(page_id_t page_id, char *page_data);
+  // false if the page does not match its checksum. The page is read anyway
+  bool ReadPage(page_id_t page_id, char *page_data);
+
+  // write count pages, page_data[i] holding page page_ids[i]. Pages are
+  // sorted by id and every run of consecutive ids within one file is one
+  // pwritev
+  void WritePages(const page_id_t *page_ids, const char *const *page_data,
+                  size_t count);
 
-  void WriteLog(char *log_data, int size);
-  bool ReadLog(char *log_data, int size, int offset);
+  // false on an I/O error: nothing of log_data is to be taken as durable
+  bool WriteLog(char *log_data, int size);
+  bool ReadLog(char *log_data, int size, log_offset_t offset);
+  // bytes written to the log since it was created, the offset the next
+  // WriteLog writes at
+  log_offset_t GetLogSize();
+  // delete the log files entirely below offset, never the one the log ends
+  // in. Returns the files deleted or, for the first one, emptied
+  size_t TruncateLog(log_offset_t offset);
+  // the first log offset still in a file
+  log_offset_t GetLogStart();
 
-  page_id_t AllocatePage();
+  // near_page_id: the page the caller will read just before the new one,
+  // e.g. the previous page of a heap or leaf chain. A free page within an
+  // extent after it is preferred, so chains stay physically sequential.
+  // Without one, a free page prefer accepts goes before other free pages,
+  // e.g. one a buffer pool partition local to the caller caches
+  page_id_t AllocatePage(page_id_t near_page_id = INVALID_PAGE_ID,
+                         const std::function<bool(page_id_t)> &prefer =
+                             nullptr);
+  // the free bit is on disk at once, no page on disk may point to page_id
+  // any more. See BufferPoolManager::DeletePage
   void DeallocatePage(page_id_t page_id);
+  // page_id is in use, as recovery finds in the log, see LogRecovery
+  void ClaimPage(page_id_t page_id);
+
+  // first bitmap page, INVALID_PAGE_ID until a page was deallocated. The
+  // owner of the header page records it there, see
+  // BufferPoolManager::DeletePage
+  page_id_t GetFreeSpaceMapPageId();
+  // pages deallocated and not handed out again
+  size_t GetFreePageCount();
+  // pages in the file, free ones and bitmap pages included
+  inline page_id_t GetPageCount() const { return next_page_id_; }
+
+  // cut free pages off the end of the file. Allocation prefers low page ids,
+  // so over time the free pages collect at the end. Safe while the database
+  // is in use, free pages are not referenced. Returns the pages cut off
+  size_t ShrinkFile();
+
+  inline size_t GetPageSize() const { return page_size_; }
+
+  // true if page I/O really goes around the page cache. Buffers that are not
+  // DIRECT_IO_ALIGNMENT aligned are then bounced through an aligned copy
+  inline bool IsDirectIO() const { return direct_io_; }
+
+  inline bool IsReadOnly() const { return read_only_; }
+
+  // stamp written pages with a CRC32C and verify it on read, off by default.
+  // Pages written while it is off keep the checksum they were read with,
+  // so turn it on before pages are written, not in between
+  inline void SetPageChecksums(bool enabled) { checksums_ = enabled; }
+  inline bool UsesPageChecksums() const { return checksums_; }
+
+  // true if page_data matches its checksum, or checksums are off or the page
+  // was never stamped. For pages that did not come through ReadPage, e.g.
+  // from a DiskScheduler or the mapping
+  bool VerifyPage(page_id_t page_id, const char *page_data);
+
+  ChecksumStats GetChecksumStats() const;
+  LogWriteStats GetLogWriteStats() const;
+
+  inline size_t GetFileCount() const { return db_fds_.size(); }
+
+  inline PageLocation Locate(page_id_t page_id) const {
+    size_t unit = static_cast<size_t>(page_id) / stripe_pages_;
+    size_t local = unit / db_fds_.size() * stripe_pages_ +
+                   static_cast<size_t>(page_id) % stripe_pages_;
+    return {unit % db_fds_.size(), local * page_size_};
+  }
+
+  // page_id in the mapping of a read-only database, nullptr if the file is
+  // not mapped or the page lies past the mapping
+  inline const char *GetMappedPage(page_id_t page_id) const {
+    if (mappings_.empty() || page_id < 0)
+      return nullptr;
+    PageLocation location = Locate(page_id);
+    if (mappings_[location.file_] == nullptr ||
+        location.offset_ >= mapping_sizes_[location.file_])
+      return nullptr;
+    return mappings_[location.file_] + location.offset_;
+  }
 
   int GetNumFlushes() const;
   bool GetFlushState() const;
@@ -37,17 +205,109 @@ public:
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
 private:
-  int GetFileSize(const std::string &name);
-  // stream to write log file
-  std::fstream log_io_;
+  // DiskScheduler submits page I/O on db_fds_ itself
+  friend class DiskScheduler;
+
+  // the page id at offset local_page (in pages) of file
+  inline page_id_t GlobalPageId(size_t file, size_t local_page) const {
+    return static_cast<page_id_t>(
+        (local_page / stripe_pages_ * db_fds_.size() + file) * stripe_pages_ +
+        local_page % stripe_pages_);
+  }
+  // pages of file among the page ids [0, page_count)
+  size_t LocalPageCount(size_t file, size_t page_count) const;
+  // reserve space for the pages [begin, end), false if it is not supported
+  bool Preallocate(page_id_t begin, page_id_t end);
+
+  // the I/O of WritePage and ReadPage, without checksums
+  void WriteRaw(page_id_t page_id, const char *page_data);
+  void ReadRaw(page_id_t page_id, char *page_data);
+  // set the checksum field of page_data, if checksums are on
+  void StampPage(char *page_data);
+  uint32_t PageChecksum(const char *page_data) const;
+
+  // find the log files there are and where the log ends
+  void OpenLog();
+  // name of log file n
+  std::string LogFileName(size_t file) const;
+  // open log file n, created and its space reserved if it does not exist
+  int OpenLogFile(size_t file);
+  // fd of log file n, opened here unless it was preallocated. log_latch_
+  // held
+  int GetLogFile(size_t file);
+  // have the preallocation thread create log file n. log_latch_ held
+  void PreallocateLogFile(size_t file);
+  void PreallocateLogThread();
+  // raise db_file_size_ to at least end
+  void GrowFileSize(size_t end);
+  // take page_id out of the bitmap, fsm_latch_ held
+  page_id_t TakeFreePage(size_t page_id);
+  // a new page at the end of the file, preallocating the next extent
+  page_id_t AppendPage();
+  // free-space bitmap helpers, fsm_latch_ held
+  void LoadFreeSpaceMap(const char *header_page);
+  void WriteMapPage(size_t index);
+  // the bits follow the next pointer and the checksum
+  static const size_t MAP_BITS_OFFSET = PAGE_CHECKSUM_OFFSET + 4;
+  inline size_t PagesPerMapPage() const {
+    return (page_size_ - MAP_BITS_OFFSET) * 8;
+  }
+  inline bool IsFree(size_t page_id) const {
+    return (free_bits_[page_id / 8] >> (page_id % 8)) & 1;
+  }
+  // with direct I/O, page_data must be bounced through an aligned buffer
+  inline bool NeedsBounce(const char *page_data) const {
+    return direct_io_ &&
+           reinterpret_cast<uintptr_t>(page_data) % DIRECT_IO_ALIGNMENT != 0;
+  }
+  // log files by number, and the bytes in all of them together counted from
+  // the start of the first file ever
+  std::mutex log_latch_;
+  std::map<size_t, int> log_fds_;
+  size_t log_size_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  // log file preallocation thread, started on first use
+  std::thread *log_preallocator_;
+  bool log_preallocating_;
+  size_t log_preallocate_file_; // next file requested, 0 for none
+  std::condition_variable log_cv_;
+  // db files, accessed with pread/pwrite only: there is no shared cursor, so
+  // page reads and writes from different threads proceed in parallel
+  std::vector<int> db_fds_;
   std::string file_name_;
+  size_t stripe_pages_;
+  // logical length of the tablespace, i.e. up to the end of the highest page
+  // written, grown by WritePage instead of stat'ed per read
+  std::atomic<size_t> db_file_size_;
+  bool direct_io_;
+  bool read_only_;
+  // whole pages of each read-only file, PROT_READ, empty if not read-only
+  std::vector<char *> mappings_;
+  std::vector<size_t> mapping_sizes_;
+  size_t page_size_;
   std::atomic<page_id_t> next_page_id_;
+  // free-space bitmap, its pages in chain order and their bits in memory
+  std::mutex fsm_latch_;
+  std::vector<page_id_t> fsm_pages_;
+  std::vector<uint8_t> free_bits_;
+  size_t free_count_;
+  // pages of space reserved up to, false once fallocate is refused
+  page_id_t preallocated_pages_;
+  bool preallocate_;
+  std::atomic<bool> checksums_;
+  std::atomic<uint64_t> pages_stamped_;
+  std::atomic<uint64_t> stamp_ns_;
+  std::atomic<uint64_t> pages_verified_;
+  std::atomic<uint64_t> verify_ns_;
+  std::atomic<uint64_t> checksum_failures_;
+  std::atomic<uint64_t> log_writes_{0};
+  std::atomic<uint64_t> log_bytes_{0};
+  std::atomic<uint64_t> log_write_errors_{0};
+  Histogram log_write_ns_;
   int num_flushes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
+  char *buffer_used_; // log buffer of the last flush
 };
 
 } // namespace cmudb
\ No newline at end of file
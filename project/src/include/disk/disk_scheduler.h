@@ -0,0 +1,95 @@
+/**
+ * disk_scheduler.h
+ *
+ * Functionality: Asynchronous page I/O on top of a DiskManager. Requests are
+ * submitted without waiting and complete through a callback (or a future),
+ * so a caller can keep many page reads and writes in flight at once.
+ *
+ * On Linux the requests go to an io_uring: a batch of requests is one
+ * submission system call, and one thread reaps completions. Where io_uring
+ * is not available (old kernel, seccomp, non-Linux build) a pool of worker
+ * threads runs the synchronous DiskManager calls instead.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "disk/disk_manager.h"
+
+namespace cmudb {
+
+// called once the request is done, on a scheduler thread or, for requests
+// that need no I/O, on the submitting thread. Must not block on the
+// scheduler
+typedef std::function<void()> DiskCallback;
+
+// with page checksums on, a write stamps the checksum into data_ itself and
+// a read is not verified, the callback can check it with
+// DiskManager::VerifyPage
+struct DiskRequest {
+  bool is_write_;
+  page_id_t page_id_;
+  // page_size bytes, must stay valid until the callback runs
+  char *data_;
+  DiskCallback callback_;
+};
+
+struct IoUring;
+
+class DiskScheduler {
+public:
+  // queue_depth: requests in flight in the io_uring
+  // num_workers: threads of the fallback, if io_uring cannot be used
+  DiskScheduler(DiskManager *disk_manager,
+                size_t queue_depth = DISK_IO_QUEUE_DEPTH,
+                size_t num_workers = DISK_IO_WORKERS, bool use_io_uring = true);
+
+  // waits for every submitted request
+  ~DiskScheduler();
+
+  void Schedule(DiskRequest request);
+
+  // submit a whole batch at once, requests are moved out of requests
+  void Schedule(std::vector<DiskRequest> &requests);
+
+  // the future throws an EXCEPTION_TYPE_IO Exception if the page read does
+  // not match its checksum
+  std::future<void> ReadPageAsync(page_id_t page_id, char *page_data);
+  // writes a copy of page_data, it may be reused once this returns
+  std::future<void> WritePageAsync(page_id_t page_id, const char *page_data);
+
+  // block until every request submitted so far has completed
+  void Drain();
+
+  inline bool UsesIoUring() const { return ring_ != nullptr; }
+
+private:
+  // run the callback and retire the request
+  void Complete(DiskRequest &request);
+
+  // fallback worker loop
+  void RunWorker();
+
+  // io_uring: submit requests in as few system calls as the ring depth
+  // allows, and the completion loop
+  void SubmitToRing(std::vector<DiskRequest> &requests);
+  void RunReaper();
+
+  DiskManager *disk_manager_;
+  IoUring *ring_; // nullptr when the fallback is in use
+  std::vector<std::thread> threads_; // workers, or the io_uring reaper
+  std::deque<DiskRequest> queue_;    // fallback requests not yet started
+  bool shutdown_;
+  size_t outstanding_; // submitted but not completed
+  std::mutex latch_;
+  std::condition_variable work_cv_; // queue_ not empty, or shutdown_
+  std::condition_variable done_cv_; // a request completed
+};
+
+} // namespace cmudb
@@ -0,0 +1,93 @@
+/*
+ * concurrent_extendible_hash.h : extendible hashing with per-bucket latches
+ *
+ * Functionality: Same table as ExtendibleHash, but operations on different
+ * buckets run in parallel. Every operation holds the directory latch shared
+ * and latches only its target bucket, exclusively for Insert/Remove and
+ * shared for Find. The directory latch is taken exclusively only to double
+ * the directory.
+ *
+ * A split rewrites the directory slots of the splitting bucket while holding
+ * that bucket's latch, slots are atomic pointers so a concurrent reader
+ * sees either bucket. A reader that latched a bucket re-checks that the
+ * bucket still covers its hash and starts over if a split moved the key.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common/rwmutex.h"
+#include "hash/extendible_hash.h"
+
+namespace cmudb {
+
+template <typename K, typename V, typename Hash = Hasher<K>>
+class ConcurrentExtendibleHash : public HashTable<K, V> {
+public:
+  // size: number of entries a bucket holds before it splits
+  ConcurrentExtendibleHash(size_t size);
+  // helper function to generate hash addressing
+  size_t HashKey(const K &key);
+  // helper function to get global & local depth
+  int GetGlobalDepth();
+  int GetLocalDepth(int bucket_id);
+  int GetNumBuckets();
+  // lookup and modifier
+  bool Find(const K &key, V &value) override;
+  bool Remove(const K &key) override;
+  void Insert(const K &key, const V &value) override;
+
+private:
+  struct Node {
+    explicit Node(std::unique_ptr<Bucket<K, V, Hash>> bucket)
+        : bucket_(std::move(bucket)) {}
+    RWMutex latch_;
+    std::unique_ptr<Bucket<K, V, Hash>> bucket_;
+  };
+
+  // bucket responsible for hash now, directory latch held
+  inline Node *GetNode(size_t hash) {
+    return directory_[GETBIT(hash, global_depth_)].load();
+  }
+
+  // false if a split moved hash out of node since its slot was read
+  inline bool Covers(Node *node, size_t hash) {
+    return static_cast<int>(GETBIT(hash, node->bucket_->GetLocalDepth())) ==
+           node->bucket_->GetId();
+  }
+
+  // node holds size entries or more and may still split. Keys sharing the
+  // low MAX_DEPTH + 1 bits of their hashes are left in one bucket
+  inline bool Overflows(Node *node) {
+    return node->bucket_->GetSize() >= bucket_size_ &&
+           node->bucket_->GetLocalDepth() < MAX_DEPTH;
+  }
+
+  // find the node for hash and latch it, directory latch held shared
+  Node *LatchNode(size_t hash, bool exclusive);
+
+  // split node, which must be shallower than the directory; the directory
+  // latch is held shared and node's exclusively, or the directory latch
+  // exclusively
+  void SplitNode(Node *node);
+
+  // double the directory, directory latch held exclusively
+  void Expand();
+
+  // deepest directory, 1 << (MAX_DEPTH + 1) slots
+  static constexpr int MAX_DEPTH = 20;
+
+  size_t bucket_size_;
+  int global_depth_;
+  RWMutex directory_latch_;
+  // 1 << (global_depth_ + 1) slots
+  std::unique_ptr<std::atomic<Node *>[]> directory_;
+  // owns every bucket, buckets are never freed before the table is
+  std::mutex nodes_latch_;
+  std::vector<std::unique_ptr<Node>> nodes_;
+};
+} // namespace cmudb
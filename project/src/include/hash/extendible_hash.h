@@ -9,13 +9,19 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 #include <vector>
 #include <string>
 #include <memory>
-#include <map>
 #include <mutex>
+#include <utility>
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "common/memory_tracker.h"
+#include "hash/hash_function.h"
 #include "hash/hash_table.h"
 
 namespace cmudb {
@@ -27,46 +33,62 @@ namespace cmudb {
 // get specify bit is zero
 #define ISZERO(x, y) (!(x & (1 << (y))))
 
-template <typename K>
-struct Hasher {
-  size_t operator()(const K& k) { return std::hash<K>()(k); }
-};
+// one byte of the hash kept next to every key, so a probe compares a whole
+// run of fingerprints at once and only touches keys that may match
+inline uint8_t Fingerprint(size_t hash) {
+  return static_cast<uint8_t>((hash * 0x9E3779B97F4A7C15ULL) >> 56);
+}
 
-template <typename K, typename V>
+/*
+ * Bucket: keys, values and fingerprints in three parallel arrays, reserved
+ * to the bucket size up front so neither inserts nor splits allocate per
+ * entry. Entries are unordered, removal moves the last entry into the hole
+ */
+template <typename K, typename V, typename Hash = Hasher<K>>
 class Bucket {
 public:
   explicit Bucket(int id, int depth, size_t size) : id_(id), local_depth_(depth), size_(size){
+    keys_.reserve(size_);
+    values_.reserve(size_);
+    fingerprints_.reserve(size_);
+    MemoryTracker::Instance().Charge(MemoryConsumer::HASH_TABLE, Footprint());
+  }
+  ~Bucket() {
+    MemoryTracker::Instance().Release(MemoryConsumer::HASH_TABLE, Footprint());
   }
+  Bucket(const Bucket &) = delete;
+  Bucket &operator=(const Bucket &) = delete;
 
+  // insert unless k is present already, return false when the bucket just
+  // became full. A bucket a split could not divide keeps growing past size_
   bool Put(const K& k, const V& v) {
-    data_.insert(std::make_pair(k, v));  
+    uint8_t fingerprint = Fingerprint(Hash()(k));
+    if (IndexOf(k, fingerprint) == NOT_FOUND) {
+      Append(k, v, fingerprint);
+    }
 
     // overflow, return false;
-    if (data_.size() == size_) {
-      return false;
-    }  
-
-    return true;
+    return keys_.size() != size_;
   }
 
   bool Get(const K& k, V& v) {
-    auto iter = data_.find(k);
+    size_t i = IndexOf(k, Fingerprint(Hash()(k)));
 
     // not exists
-    if (iter == data_.end()) {
+    if (i == NOT_FOUND) {
       return false;
     }
 
-    v = iter->second;
+    v = values_[i];
     return true;
   }
 
   bool Remove(const K& k) {
-    auto iter = data_.find(k);
-    if (iter == data_.end()) {
+    size_t i = IndexOf(k, Fingerprint(Hash()(k)));
+    if (i == NOT_FOUND) {
       return false;
     }
-    data_.erase(iter);
+    RemoveAt(i);
     return true;
   }
 
@@ -85,53 +107,143 @@ public:
     local_depth_++;
     auto new_bucket = std::make_unique<Bucket>(SETBIT(id_, local_depth_), local_depth_, size_);
 
-    for (typename std::map<K, V>::iterator iter = data_.begin(); iter != data_.end();) {
-        if (!ISZERO(Hasher<K>()(iter->first), local_depth_)) {
-            new_bucket->Put(iter->first, iter->second);
-            data_.erase(iter++);
-        } else {
-          iter++;
-        } 
+    // compact the entries that stay in place while moving the others out
+    size_t kept = 0;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      if (!ISZERO(Hash()(keys_[i]), local_depth_)) {
+        new_bucket->Append(std::move(keys_[i]), std::move(values_[i]),
+                           fingerprints_[i]);
+      } else {
+        if (kept != i) {
+          keys_[kept] = std::move(keys_[i]);
+          values_[kept] = std::move(values_[i]);
+          fingerprints_[kept] = fingerprints_[i];
+        }
+        ++kept;
+      }
     }
+    keys_.resize(kept);
+    values_.resize(kept);
+    fingerprints_.resize(kept);
     return new_bucket;
   }
 
+  /*
+   * take over all entries of the buddy split off this bucket, the inverse
+   * of Split()
+   */
+  void Merge(Bucket &buddy) {
+    for (size_t i = 0; i < buddy.keys_.size(); ++i) {
+      Append(std::move(buddy.keys_[i]), std::move(buddy.values_[i]),
+             buddy.fingerprints_[i]);
+    }
+    buddy.keys_.clear();
+    buddy.values_.clear();
+    buddy.fingerprints_.clear();
+    local_depth_--;
+  }
+
   int GetId() const {
     return id_;
   }
 
-  std::map<K, V> GetData() const {
-    return data_;
-  }
+  // entries in no particular order
+  size_t GetSize() const { return keys_.size(); }
+  const K &KeyAt(size_t i) const { return keys_[i]; }
+  const V &ValueAt(size_t i) const { return values_[i]; }
+
 private:
+  static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+  template <typename KK, typename VV>
+  void Append(KK &&k, VV &&v, uint8_t fingerprint) {
+    keys_.push_back(std::forward<KK>(k));
+    values_.push_back(std::forward<VV>(v));
+    fingerprints_.push_back(fingerprint);
+  }
+
+  void RemoveAt(size_t i) {
+    if (i + 1 != keys_.size()) {
+      keys_[i] = std::move(keys_.back());
+      values_[i] = std::move(values_.back());
+      fingerprints_[i] = fingerprints_.back();
+    }
+    keys_.pop_back();
+    values_.pop_back();
+    fingerprints_.pop_back();
+  }
+
+  // bytes reserved up front, what the memory tracker is told
+  size_t Footprint() const {
+    return sizeof(Bucket) + size_ * (sizeof(K) + sizeof(V) + 1);
+  }
+
+  // position of k, NOT_FOUND if absent
+  size_t IndexOf(const K &k, uint8_t fingerprint) const {
+    size_t n = fingerprints_.size();
+    size_t i = 0;
+#ifdef __SSE2__
+    // 16 fingerprints per compare, keys are read only for matching bytes
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(fingerprint));
+    for (; i + 16 <= n; i += 16) {
+      __m128i chunk = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(fingerprints_.data() + i));
+      unsigned mask = static_cast<unsigned>(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+      while (mask != 0) {
+        size_t j = i + __builtin_ctz(mask);
+        if (keys_[j] == k) {
+          return j;
+        }
+        mask &= mask - 1;
+      }
+    }
+#endif
+    for (; i < n; ++i) {
+      if (fingerprints_[i] == fingerprint && keys_[i] == k) {
+        return i;
+      }
+    }
+    return NOT_FOUND;
+  }
+
   // index in directoru
   int id_;
   int local_depth_;
   // bucket size
   size_t size_;
-  std::map<K, V> data_;
+  std::vector<K> keys_;
+  std::vector<V> values_;
+  std::vector<uint8_t> fingerprints_;
 };
-template <typename K, typename V>
-using BucketPtr = std::shared_ptr<Bucket<K, V>>;
+template <typename K, typename V, typename Hash = Hasher<K>>
+using BucketPtr = std::shared_ptr<Bucket<K, V, Hash>>;
 
-template <typename K, typename V>
+template <typename K, typename V, typename Hash = Hasher<K>>
 class ExtendibleHash : public HashTable<K, V> {
 public:
   // constructor
-  ExtendibleHash(size_t size);
+  // merge_threshold: buddy buckets merge once they hold no more than this
+  // share of one bucket together. Below 1 so that a merge cannot be undone
+  // by the very next insert
+  ExtendibleHash(size_t size, double merge_threshold = 0.5);
   // helper function to generate hash addressing
   size_t HashKey(const K &key);
   // helper function to get global & local depth
   int GetGlobalDepth() const;
   int GetLocalDepth(int bucket_id) const;
   int GetNumBuckets() const;
+  // skew: histogram[d] buckets have local depth d / histogram[n] buckets
+  // hold n entries. Buckets are counted once, not once per directory slot
+  void GetDepthHistogram(std::vector<size_t> &histogram);
+  void GetOccupancyHistogram(std::vector<size_t> &histogram);
   // lookup and modifier
   bool Find(const K &key, V &value) override;
   bool Remove(const K &key) override;
   void Insert(const K &key, const V &value) override;
 
 private:
-  void expand(int id, std::unique_ptr<Bucket<K, V>> bucket) {
+  void expand(int id, std::unique_ptr<Bucket<K, V, Hash>> bucket) {
     // global_depth_ init value is 0
     buckets_.resize(1 << (global_depth_+1));
     buckets_[id] = std::move(bucket);    
@@ -142,11 +254,16 @@ private:
     }
   }
 
+  // merge the bucket in slot id with its buddy while they are small enough,
+  // then halve the directory while no bucket needs its top bit
+  void Shrink(int id);
+
 private:
   // add your own member variables here
   int bucket_size_;
+  size_t merge_limit_;
   int global_depth_;
   std::mutex mutex_;
-  std::vector<BucketPtr<K, V>> buckets_;
+  std::vector<BucketPtr<K, V, Hash>> buckets_;
 };
 } // namespace cmudb
@@ -0,0 +1,72 @@
+/**
+ * hash_function.h
+ *
+ * Hash policies for the in-memory hash tables. Extendible hashing takes its
+ * directory bits from the low end of the hash, so a policy must mix every
+ * input bit into them: std::hash of an integer is the identity, and
+ * sequential page ids would fill the directory one low bit at a time.
+ *
+ * Hasher is the default policy, StdHasher keeps plain std::hash.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+namespace cmudb {
+
+// murmur3 64 bit finalizer, every input bit affects every output bit
+inline uint64_t MixHash(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// word at a time, no byte loop except for the tail. Each word is mixed on
+// its own, then folded into the running hash, one word after the other
+inline uint64_t StringHash(const char *data, size_t length) {
+  uint64_t hash = 0x9E3779B97F4A7C15ULL ^ length;
+  size_t i = 0;
+  for (; i + 8 <= length; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ MixHash(word)) * 0x9E3779B97F4A7C15ULL;
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, data + i, length - i);
+  return MixHash(hash ^ tail);
+}
+
+// mix whatever std::hash gives
+template <typename K, typename Enable = void> struct Hasher {
+  size_t operator()(const K &k) const {
+    return static_cast<size_t>(MixHash(std::hash<K>()(k)));
+  }
+};
+
+template <typename K>
+struct Hasher<K, typename std::enable_if<std::is_integral<K>::value>::type> {
+  size_t operator()(const K &k) const {
+    return static_cast<size_t>(MixHash(static_cast<uint64_t>(k)));
+  }
+};
+
+template <> struct Hasher<std::string> {
+  size_t operator()(const std::string &k) const {
+    return static_cast<size_t>(StringHash(k.data(), k.size()));
+  }
+};
+
+// plain std::hash, for callers relying on its exact values
+template <typename K> struct StdHasher {
+  size_t operator()(const K &k) const { return std::hash<K>()(k); }
+};
+
+} // namespace cmudb
@@ -0,0 +1,68 @@
+/*
+ * linear_probe_hash_table.h : fixed-capacity open-addressing hash table
+ *
+ * Functionality: Page table of a buffer pool. The number of resident pages
+ * never exceeds the number of frames, so the table is sized once and never
+ * grows. Keys and values live in one flat array of atomic slots probed
+ * linearly, so a hit usually costs a single probe.
+ *
+ * Find takes no lock: it validates its probe against a version counter that
+ * Remove bumps around its backward shift, and retries if they overlapped.
+ * Insert and Remove are serialised by a writer latch. Keys and values must be
+ * trivially copyable and fit a lock-free std::atomic; one key value is
+ * reserved to mark empty slots.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "hash/hash_table.h"
+
+namespace cmudb {
+
+template <typename K, typename V>
+class LinearProbeHashTable : public HashTable<K, V> {
+public:
+  // max_entries: most keys ever stored at once
+  // empty_key: a key value that is never inserted
+  LinearProbeHashTable(size_t max_entries, K empty_key);
+
+  ~LinearProbeHashTable();
+
+  // lookup and modifier
+  bool Find(const K &key, V &value) override;
+  bool Remove(const K &key) override;
+  void Insert(const K &key, const V &value) override;
+
+  inline size_t GetCapacity() const { return capacity_; }
+  inline size_t GetSize() const { return size_; }
+
+private:
+  struct Slot {
+    std::atomic<K> key_;
+    std::atomic<V> value_;
+  };
+
+  // home slot of key
+  inline size_t HashKey(const K &key) const {
+    // fibonacci hashing spreads runs of consecutive page ids
+    return static_cast<size_t>(
+        (static_cast<uint64_t>(key) * 11400714819323198485ull) >>
+        (64 - shift_));
+  }
+
+  size_t capacity_; // power of two, at least twice max_entries
+  size_t mask_;
+  int shift_;
+  K empty_key_;
+  Slot *slots_;
+  size_t size_;
+  // odd while Remove moves slots
+  std::atomic<uint64_t> version_;
+  std::mutex writer_latch_;
+};
+
+} // namespace cmudb
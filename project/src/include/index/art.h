@@ -0,0 +1,153 @@
+/**
+ * art.h
+ *
+ * In-memory adaptive radix tree over variable-length keys, see var_key.h:
+ * a node branches on one byte of the key and is a Node4, Node16, Node48 or
+ * Node256 after the children it has room for, grown into the next kind
+ * when full. A node keeps the bytes all keys under it share, up to
+ * MAX_PREFIX of them; a longer shared part is a chain of one-child nodes.
+ * A leaf holds the whole key and its value, and is compared whole.
+ *
+ * Keys must be prefix-free, one is never the start of another, as
+ * normalized keys of one schema are; a key that is throws. The root is a
+ * Node256 and never replaced.
+ *
+ * Concurrency is by optimistic lock coupling: a node has a version, readers
+ * do not lock and restart if a version they read changes under them,
+ * writers lock only the nodes they change. Nodes replaced or leaves taken
+ * out are freed once no operation that started before could still read
+ * them, see Retire. Removes only take the leaf out, nodes do not shrink.
+ * The tree is not logged nor kept on disk.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "common/rid.h"
+#include "index/var_key.h"
+
+namespace cmudb {
+
+class AdaptiveRadixTree {
+public:
+  AdaptiveRadixTree();
+  ~AdaptiveRadixTree();
+
+  AdaptiveRadixTree(const AdaptiveRadixTree &) = delete;
+  AdaptiveRadixTree &operator=(const AdaptiveRadixTree &) = delete;
+
+  // Insert a key-value pair, false if key is there already
+  bool Insert(const VarKey &key, const RID &value);
+
+  // Remove a key and its value, false if it is not there
+  bool Remove(const VarKey &key);
+
+  // return the value associated with a given key
+  bool GetValue(const VarKey &key, std::vector<RID> &result);
+
+  // keys in the tree, and inner nodes of each kind, for tests
+  size_t GetSize() const { return size_.load(); }
+  size_t GetNodeCount(int children);
+
+private:
+  static constexpr int MAX_PREFIX = 8;
+
+  enum class NodeType : uint8_t { NODE4 = 0, NODE16, NODE48, NODE256 };
+
+  // version_: bit 1 locked, bit 0 obsolete, the rest counts writes
+  struct Node {
+    std::atomic<uint64_t> version_;
+    NodeType type_;
+    uint8_t prefix_size_;
+    uint16_t count_;
+    uint8_t prefix_[MAX_PREFIX];
+  };
+  struct Node4 : Node {
+    uint8_t keys_[4];
+    Node *children_[4];
+  };
+  struct Node16 : Node {
+    uint8_t keys_[16];
+    Node *children_[16];
+  };
+  // index_ of a byte is its slot in children_ plus one, 0 if none
+  struct Node48 : Node {
+    uint8_t index_[256];
+    Node *children_[48];
+  };
+  struct Node256 : Node {
+    Node *children_[256];
+  };
+  // pointed at by children with the lowest bit set
+  struct Leaf {
+    RID value_;
+    int size_;
+    char key_[0];
+  };
+
+  // entered by every operation: nodes it could read are not freed until it
+  // exits
+  class EpochGuard {
+  public:
+    explicit EpochGuard(AdaptiveRadixTree *tree);
+    ~EpochGuard();
+
+  private:
+    AdaptiveRadixTree *tree_;
+    uint64_t epoch_;
+  };
+
+  // optimistic lock coupling. ReadLock is false if node is obsolete, the
+  // others if its version is no longer version
+  static bool ReadLock(Node *node, uint64_t &version);
+  static bool Check(Node *node, uint64_t version);
+  static bool Upgrade(Node *node, uint64_t version);
+  static void WriteUnlock(Node *node);
+  static void WriteUnlockObsolete(Node *node);
+
+  static bool IsLeaf(const Node *node);
+  static Leaf *AsLeaf(const Node *node);
+  Node *NewLeaf(const VarKey &key, const RID &value);
+  static bool LeafMatches(const Leaf *leaf, const VarKey &key);
+
+  template <typename NodeKind> static NodeKind *NewNode();
+  // bytes of the prefix of node that key has from depth on
+  static int PrefixMatch(const Node *node, const VarKey &key, int depth);
+  static bool IsFull(const Node *node);
+  // the child of node for byte; nullptr if none
+  static Node **ChildSlot(Node *node, uint8_t byte);
+  static Node *FindChild(Node *node, uint8_t byte);
+  // node is locked and has room, byte has no child
+  static void AddChild(Node *node, uint8_t byte, Node *child);
+  static void RemoveChild(Node *node, uint8_t byte);
+  // a copy of node, full, with room for more children
+  static Node *Grow(Node *node);
+  // inner nodes over leaf and new_leaf, which share common bytes from depth
+  // on: a chain of one-child nodes as long as needed
+  Node *NewBranch(const VarKey &key, int depth, int common, Node *leaf,
+                  Node *new_leaf);
+
+  // free node once no operation could read it
+  void Retire(Node *node);
+  void Reclaim();
+  static void Free(Node *node);
+  static void FreeTree(Node *node);
+  static size_t CountNodes(Node *node, NodeType type);
+
+  Node256 *root_;
+  std::atomic<size_t> size_;
+
+  // operations in each of the two latest epochs, by parity
+  std::atomic<uint64_t> epoch_;
+  std::atomic<uint64_t> active_[2];
+  // nodes retired in this epoch, and in the one before, they are freed at
+  // the second epoch change after
+  std::mutex garbage_mutex_;
+  std::vector<Node *> garbage_;
+  std::vector<Node *> pending_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,43 @@
+/**
+ * art_index.h
+ *
+ * Index over AdaptiveRadixTree: keys are normalized whole, see
+ * NormalizedKey, and the tree is in memory only, so it starts empty and is
+ * filled from the table when the table is opened again.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "index/art.h"
+#include "index/index.h"
+
+namespace cmudb {
+
+class ArtIndex : public Index {
+
+public:
+  explicit ArtIndex(IndexMetadata *metadata);
+
+  ~ArtIndex() {}
+
+  void InsertEntry(const Tuple &key, RID rid,
+                   Transaction *transaction = nullptr) override;
+
+  void DeleteEntry(const Tuple &key, RID rid,
+                   Transaction *transaction = nullptr) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> &result,
+               Transaction *transaction = nullptr) override;
+
+protected:
+  // the normalized bytes of key
+  std::string EncodeKey(const Tuple &key);
+
+  // container
+  AdaptiveRadixTree container_;
+};
+
+} // namespace cmudb
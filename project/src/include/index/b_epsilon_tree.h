@@ -0,0 +1,129 @@
+/**
+ * b_epsilon_tree.h
+ *
+ * Write-optimized B-epsilon tree: internal pages keep only a share of the
+ * page for pivots, BEPSILON_PIVOT_SHARE, and the rest as a buffer of pending
+ * inserts and deletes, messages, sorted by key. A write only puts a message
+ * into the buffer of the root. A full buffer is flushed: the messages for
+ * the child that has the most of them move down in one batch, into its
+ * buffer or applied to the leaf, so a leaf is written once for many keys
+ * rather than once per key.
+ *
+ * A key has at most one message per buffer, the newest; those above are
+ * newer than those below and than the leaves, so a lookup takes the first
+ * message for its key on the way down, and the leaf only if there is none.
+ * For the same reason an insert cannot tell whether its key is there yet,
+ * it replaces the value of the key.
+ *
+ * Pages are BPlusTreeLeafPage and BPlusTreeInternalPage, the buffer follows
+ * the pivots of an internal page; parent page ids are not kept. A page is
+ * split before a flush into it could overflow it. Removes do not merge, a
+ * leaf emptied stays. The whole tree is read or write latched for an
+ * operation. The tree is not logged.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/rwmutex.h"
+#include "concurrency/transaction.h"
+#include "page/b_plus_tree_internal_page.h"
+#include "page/b_plus_tree_leaf_page.h"
+
+namespace cmudb {
+
+#define BEPSILONTREE_TYPE BEpsilonTree<KeyType, ValueType, KeyComparator>
+
+INDEX_TEMPLATE_ARGUMENTS
+class BEpsilonTree {
+public:
+  explicit BEpsilonTree(const std::string &name,
+                        BufferPoolManager *buffer_pool_manager,
+                        const KeyComparator &comparator,
+                        page_id_t root_page_id = INVALID_PAGE_ID);
+
+  // Returns true if this tree has never had a key
+  bool IsEmpty() const;
+
+  // Insert a key-value pair, replacing the value of key if it is there
+  void Insert(const KeyType &key, const ValueType &value,
+              Transaction *transaction = nullptr);
+
+  // Remove a key and its value
+  void Remove(const KeyType &key, Transaction *transaction = nullptr);
+
+  // return the value associated with a given key
+  bool GetValue(const KeyType &key, std::vector<ValueType> &result,
+                Transaction *transaction = nullptr);
+
+  // levels from the root down to the leaves, and messages in the buffers,
+  // for tests
+  int GetHeight();
+  size_t GetBufferedCount();
+
+private:
+  typedef BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>
+      InternalPage;
+  typedef BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> LeafPage;
+
+  enum class MessageType : int32_t { INSERT = 0, DELETE };
+
+  struct Message {
+    KeyType key_;
+    ValueType value_;
+    MessageType type_;
+  };
+
+  // after the pivots of every internal page
+  struct Buffer {
+    int size_;
+    Message messages_[0];
+  };
+
+  Buffer *BufferOf(Page *page);
+  // the first message of buffer at or above key
+  int MessageIndex(const Buffer *buffer, const KeyType &key);
+  // put message into buffer, over the one for its key if any. The buffer
+  // has room
+  void PutMessage(Buffer *buffer, const Message &message);
+  // the messages for the child at index of node, [first, last)
+  void ChildMessages(InternalPage *node, const Buffer *buffer, int index,
+                     int &first, int &last);
+
+  // apply message to the leaf at the root or to the root buffer, splitting
+  // and flushing the root as needed
+  void Write(const Message &message);
+  void ApplyToLeaf(LeafPage *leaf, const Message &message);
+
+  // flush a batch of the buffer of page to a child. The page has room for
+  // one more pivot, needed if the child splits
+  void Flush(Page *page);
+
+  // move the upper half of page to a new page, page_id; returns the key
+  // that separates them
+  KeyType SplitLeaf(Page *page, page_id_t &page_id);
+  KeyType SplitInternal(Page *page, page_id_t &page_id);
+  // put a new root above the root, split at separator with right_id the
+  // upper half
+  void SplitRoot(const KeyType &separator, page_id_t right_id);
+
+  Page *FetchPage(page_id_t page_id);
+  Page *NewPage(page_id_t &page_id);
+
+  size_t CountMessages(page_id_t page_id);
+
+  void UpdateRootPageId(bool insert_record);
+
+  // member variable
+  std::string index_name_;
+  page_id_t root_page_id_;
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+  // page size the pivots of an internal page see, the buffer excluded
+  size_t pivot_size_;
+  int max_messages_;
+  RWMutex latch_;
+};
+
+} // namespace cmudb
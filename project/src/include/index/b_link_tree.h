@@ -0,0 +1,108 @@
+/**
+ * b_link_tree.h
+ *
+ * B-link tree (Lehman and Yao): a B+ tree in which every page also has a high
+ * key, above all the keys it holds, and a link to its right sibling. A split
+ * moves the upper half of a page into a new right sibling and links it in
+ * before the parent hears of it, so a descent that lands on a page split
+ * behind its back follows the right link while its key is at or above the
+ * high key. Descents therefore latch one page at a time, and readers never
+ * wait for a split above them. An insert latches the page it posts a
+ * separator into before it lets go of the child that split, always upwards
+ * or to the right, so latches cannot deadlock.
+ *
+ * Pages are BPlusTreeLeafPage and BPlusTreeInternalPage with a trailer at
+ * the end of the page holding the high key, right link and level; parent page
+ * ids are not kept. Removes do not merge, a page emptied stays linked. The
+ * tree is not logged.
+ */
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "concurrency/transaction.h"
+#include "page/b_plus_tree_internal_page.h"
+#include "page/b_plus_tree_leaf_page.h"
+
+namespace cmudb {
+
+#define BLINKTREE_TYPE BLinkTree<KeyType, ValueType, KeyComparator>
+
+INDEX_TEMPLATE_ARGUMENTS
+class BLinkTree {
+public:
+  explicit BLinkTree(const std::string &name,
+                     BufferPoolManager *buffer_pool_manager,
+                     const KeyComparator &comparator,
+                     page_id_t root_page_id = INVALID_PAGE_ID);
+
+  // Returns true if this tree has never had a key
+  bool IsEmpty() const;
+
+  // Insert a key-value pair, false if key is there already
+  bool Insert(const KeyType &key, const ValueType &value,
+              Transaction *transaction = nullptr);
+
+  // Remove a key and its value
+  void Remove(const KeyType &key, Transaction *transaction = nullptr);
+
+  // return the value associated with a given key
+  bool GetValue(const KeyType &key, std::vector<ValueType> &result,
+                Transaction *transaction = nullptr);
+
+  // levels from the root down to the leaves, for tests
+  int GetHeight();
+
+private:
+  typedef BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>
+      InternalPage;
+  typedef BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> LeafPage;
+
+  // at the end of every page
+  struct Trailer {
+    page_id_t right_page_id_; // INVALID_PAGE_ID for the rightmost page
+    int level_;               // 0 for leaves
+    bool bounded_;            // false for the rightmost page: no high key
+    KeyType high_key_;
+  };
+
+  Trailer *TrailerOf(Page *page);
+
+  // a fresh page at level, pinned and write latched. Right of split if
+  // given: next to it on disk, with its high key and right link
+  Page *NewNode(int level, Page *split);
+
+  // whether key is beyond page, at or above its high key
+  bool IsBeyond(Page *page, const KeyType &key);
+
+  // the page at level covering key, pinned and latched: for write if
+  // exclusive. Pages above it are appended to path, if given
+  Page *Descend(const KeyType &key, int level, bool exclusive,
+                std::vector<page_id_t> *path = nullptr);
+
+  // follow right links from latched page while key is beyond it
+  Page *MoveRight(Page *page, const KeyType &key, bool exclusive);
+
+  // link right_id, the page split off page at level from key on, into the
+  // level above; page is write latched and released here
+  void InsertIntoParent(Page *page, const KeyType &key, page_id_t right_id,
+                        int level, std::vector<page_id_t> &path);
+
+  void Release(Page *page, bool exclusive, bool dirty);
+
+  void UpdateRootPageId(bool insert_record);
+
+  // member variable
+  std::string index_name_;
+  std::atomic<page_id_t> root_page_id_;
+  // held to start the tree and to put a new root above a split one
+  std::mutex root_latch_;
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+  // page size the leaf and internal pages see, the trailer excluded
+  size_t node_size_;
+};
+
+} // namespace cmudb
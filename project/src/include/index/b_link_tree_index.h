@@ -0,0 +1,43 @@
+/**
+ * b_link_tree_index.h
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "index/b_link_tree.h"
+#include "index/index.h"
+
+namespace cmudb {
+
+#define BLINKTREE_INDEX_TYPE BLinkTreeIndex<KeyType, ValueType, KeyComparator>
+
+INDEX_TEMPLATE_ARGUMENTS
+class BLinkTreeIndex : public Index {
+
+public:
+  BLinkTreeIndex(IndexMetadata *metadata,
+                 BufferPoolManager *buffer_pool_manager,
+                 page_id_t root_page_id = INVALID_PAGE_ID);
+
+  ~BLinkTreeIndex() {}
+
+  void InsertEntry(const Tuple &key, RID rid,
+                   Transaction *transaction = nullptr) override;
+
+  void DeleteEntry(const Tuple &key, RID rid,
+                   Transaction *transaction = nullptr) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> &result,
+               Transaction *transaction = nullptr) override;
+
+protected:
+  // comparator for key
+  KeyComparator comparator_;
+  // container
+  BLinkTree<KeyType, ValueType, KeyComparator> container_;
+};
+
+} // namespace cmudb
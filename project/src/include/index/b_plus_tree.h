@@ -3,24 +3,71 @@
  *
  * Implementation of simple b+ tree data structure where internal pages direct
  * the search and leaf pages contain actual data.
- * (1) We only support unique key
+ * (1) Keys are unique, unless the tree is not: then a key with more than one
+ *     value keeps them in a posting list, a chain of pages reached through
+ *     its leaf entry and covered by the leaf's latch, see
+ *     BPlusTreePostingPage
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ * (5) With a log manager, every change is logged: an entry put into or taken
+ *     out of a leaf is a BTREEINSERT or BTREEDELETE record, each split, merge,
+ *     redistribution and root change one BTREESTRUCTURE record, see
+ *     BPlusTreeLog
+ * (6) Operations latch pages top down. Readers and writers first descend with
+ *     read latches, writers latching only the leaf for write. A writer whose
+ *     leaf may split or merge starts over with write latches the whole way,
+ *     letting go of the pages above a node that cannot split or merge; the
+ *     pages it still holds are in the transaction's page set. root_latch_
+ *     guards root_page_id_, in the page set it shows as nullptr
+ * (7) An empty tree can be bulk loaded from sorted input, one level after
+ *     the other up from the leaves, at once: pages are filled left to right
+ *     and written as they are done
+ * (8) Batches of inserts and lookups are sorted, then go through the tree in
+ *     one pass: a lookup keeps the pages from the root down read latched and
+ *     goes back up only as far as the next key needs, an insert keeps its
+ *     leaf for the keys that follow while they fit
+ * (9) With a RootCatalog a root change is swapped into the catalog, which
+ *     writes it to the header page when it is flushed, see RootCatalog
+ * (10) A page is merged with or refilled from a sibling once it drops below
+ *      the merge fill factor of the tree, half full unless lowered. A lower
+ *      one leaves pages that shrink and grow around half full alone, instead
+ *      of merging them only to split them again
+ * (11) With key compression the bytes the keys of a page range share are
+ *      kept once per page, see key_prefix.h, and a leaf split posts the
+ *      shortest separator between the two halves rather than the first key
+ *      of the right one. A page takes a longer prefix when a split narrows
+ *      its range, and the one it shares with its sibling when a merge or
+ *      redistribution widens it; one that would not fit is left as it is
  */
 #pragma once
 
+#include <functional>
 #include <queue>
+#include <utility>
 #include <vector>
 
+#include "catalog/root_catalog.h"
+#include "common/rwlatch.h"
 #include "concurrency/transaction.h"
+#include "index/b_plus_tree_log.h"
+#include "index/index.h"
 #include "index/index_iterator.h"
+#include "logging/log_manager.h"
 #include "page/b_plus_tree_internal_page.h"
 #include "page/b_plus_tree_leaf_page.h"
+#include "page/b_plus_tree_posting_page.h"
 
 namespace cmudb {
 
 #define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, KeyComparator>
+
+// stats of a B+ tree and an equi-depth histogram of its keys: the lowest key
+// of each bucket, and about how many keys there are from it to the next one
+template <typename KeyType> struct BPlusTreeStats : public IndexStats {
+  std::vector<std::pair<KeyType, size_t>> histogram;
+};
+
 // Main class providing the API for the Interactive B+ Tree.
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
@@ -28,25 +75,84 @@ public:
   explicit BPlusTree(const std::string &name,
                            BufferPoolManager *buffer_pool_manager,
                            const KeyComparator &comparator,
-                           page_id_t root_page_id = INVALID_PAGE_ID);
+                           page_id_t root_page_id = INVALID_PAGE_ID,
+                           LogManager *log_manager = nullptr,
+                           bool unique = true,
+                           RootCatalog *root_catalog = nullptr);
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
 
-  // Insert a key-value pair into this B+ tree.
+  // Insert a key-value pair into this B+ tree. False if the key is there
+  // already, or in a non-unique tree the pair
   bool Insert(const KeyType &key, const ValueType &value,
               Transaction *transaction = nullptr);
 
   // Remove a key and its value from this B+ tree.
   void Remove(const KeyType &key, Transaction *transaction = nullptr);
+  // Remove value from those of key; key goes with its last value
+  void Remove(const KeyType &key, const ValueType &value,
+              Transaction *transaction = nullptr);
 
-  // return the value associated with a given key
+  // return the values associated with a given key, in a non-unique tree in
+  // record id order
   bool GetValue(const KeyType &key, std::vector<ValueType> &result,
                 Transaction *transaction = nullptr);
 
-  // index iterator
-  INDEXITERATOR_TYPE Begin();
-  INDEXITERATOR_TYPE Begin(const KeyType &key);
+  // Insert key-value pairs, in any order. Returns how many were inserted,
+  // pairs whose key is there already are not
+  size_t InsertBatch(std::vector<MappingType> items,
+                     Transaction *transaction = nullptr);
+
+  // append the values of those of keys that are there to result, in key
+  // order. Returns how many were found
+  size_t GetValues(std::vector<KeyType> keys, std::vector<ValueType> &result,
+                   Transaction *transaction = nullptr);
+
+  // Build this empty B+ tree from items in strictly ascending key order,
+  // pages filled to fill_factor. False, and nothing loaded, if the tree is
+  // not empty or items are out of order
+  bool BulkLoad(const std::vector<MappingType> &items,
+                double fill_factor = BULK_LOAD_FILL_FACTOR,
+                Transaction *transaction = nullptr);
+  // the same from next, which puts count items into its argument one after
+  // the other, already in strictly ascending key order. Throws if it runs
+  // out before
+  bool BulkLoad(size_t count, const std::function<bool(MappingType &)> &next,
+                double fill_factor = BULK_LOAD_FILL_FACTOR,
+                Transaction *transaction = nullptr);
+
+  // index iterator, from the first key / the first key not below key on.
+  // read_ahead leaves past the one the iterator is on are prefetched, 0 for
+  // none, at most a sixteenth of the buffer pool
+  INDEXITERATOR_TYPE Begin(int read_ahead = INDEX_READ_AHEAD);
+  INDEXITERATOR_TYPE Begin(const KeyType &key,
+                           int read_ahead = INDEX_READ_AHEAD);
+  // the same going down, from the last key / the last key not above key on
+  INDEXITERATOR_TYPE RBegin(int read_ahead = INDEX_READ_AHEAD);
+  INDEXITERATOR_TYPE RBegin(const KeyType &key,
+                            int read_ahead = INDEX_READ_AHEAD);
+
+  // up to limit values past position into result, in key order, down if
+  // reverse, see Index::ScanOrdered
+  void ScanOrdered(bool reverse, size_t limit, IndexScanPosition &position,
+                   std::vector<ValueType> &result);
+
+  // pages with fewer entries than fill_factor of their maximum are merged,
+  // from 0 (only empty ones) up to 0.5. Set before the tree is used
+  void SetMergeFillFactor(double fill_factor);
+
+  // compress the keys of the pages, only if the comparator compares them as
+  // their bytes. Set before the tree is used
+  void SetKeyCompression(bool compress);
+
+  // estimated from the pages on sample_leaves root to leaf paths spread
+  // evenly over the tree, exact if it has no more leaves than that. The
+  // histogram has at most histogram_buckets buckets, none for 0. Writers
+  // wait for the pages under a path while it is read
+  BPlusTreeStats<KeyType>
+  GetStats(size_t sample_leaves = BTREE_STATS_SAMPLES,
+           size_t histogram_buckets = BTREE_STATS_BUCKETS);
 
   // Print this B+ tree to stdout using a simple command-line
   std::string ToString(bool verbose = false);
@@ -58,42 +164,157 @@ public:
   // read data from file and remove one by one
   void RemoveFromFile(const std::string &file_name,
                       Transaction *transaction = nullptr);
-  // expose for test purpose
+  // expose for test purpose, the leaf is returned pinned but not latched
   B_PLUS_TREE_LEAF_PAGE_TYPE *FindLeafPage(const KeyType &key,
                                            bool leftMost = false);
 
 private:
-  void StartNewTree(const KeyType &key, const ValueType &value);
+  // descends again when the next leaf is write latched
+  friend class INDEXITERATOR_TYPE;
+
+  typedef BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>
+      InternalPage;
+
+  enum class Operation { READ, INSERT, REMOVE };
+
+  // where the key range of a page ends, the rightmost pages have no end
+  struct KeyBound {
+    bool bounded_;
+    KeyType key_;
+  };
+
+  // the pages GetStats has read so far, each for weight_ pages of its level
+  struct StatsWalk {
+    std::vector<double> pages_; // estimated pages of each level, root first
+    double fill_;               // sum of the fill factors of those pages
+    double keys_;
+    // lowest key of the leaves read, in key order, and the keys they stand
+    // for
+    std::vector<std::pair<KeyType, double>> leaves_;
+  };
+
+  // a level of a bulk load: entries_ spread evenly over pages_ pages, the
+  // one being filled is page_ and the page_index_th
+  struct LoadLevel {
+    int entries_;
+    int pages_;
+    int page_index_;
+    int filled_;
+    Page *page_;
+  };
+
+  // the page of the leaf for key, pinned. A read gets it read latched, a
+  // write write latched and in the page set of transaction, with the pages
+  // above it that the write may change. nullptr if the tree is empty, a
+  // pessimistic write keeps root_latch_ then. The end of the leaf's key range
+  // goes to bound, if given
+  Page *FindLeafPage(const KeyType &key, bool leftMost, Operation op,
+                     Transaction *transaction = nullptr,
+                     bool pessimistic = false, KeyBound *bound = nullptr);
+
+  // the leaf whose key range has the keys right below key, the rightmost
+  // leaf if key is nullptr, read latched like FindLeafPage. Where its range
+  // starts goes to low. nullptr if the tree is empty
+  Page *FindLeafBefore(const KeyType *key, KeyBound *low);
+
+  // whether op on a child cannot split or merge node
+  bool IsSafe(BPlusTreePage *node, Operation op);
+
+  // add page, read latched and pinned, to walk, as weight pages of level,
+  // and the paths of a budget of leaves under it. Unlatches and unpins it
+  void SampleStats(Page *page, size_t level, double weight, size_t budget,
+                   StatsWalk &walk);
+
+  // the fewest entries node keeps without a merge, if it is not the root
+  int GetMergeSize(BPlusTreePage *node) const;
+
+  // unlatch and unpin the page set, then delete the deleted page set
+  void ReleasePages(Transaction *transaction, bool dirty);
+
+  // the page of level to add an entry from key on to, pinned. Once the one
+  // being filled has its share it is written, and the next one is added to
+  // the level above
+  Page *LoadPage(std::vector<LoadLevel> &levels, size_t level,
+                 const KeyType &key);
+
+  void StartNewTree(const KeyType &key, const ValueType &value,
+                    Transaction *transaction = nullptr);
 
   bool InsertIntoLeaf(const KeyType &key, const ValueType &value,
-                      Transaction *transaction = nullptr);
+                      B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                      Transaction *transaction);
+
+  // remove key, or with value given only value of those of key
+  void RemoveValue(const KeyType &key, const ValueType *value,
+                   Transaction *transaction);
+
+  bool RemoveFromLeaf(const KeyType &key, const ValueType *value,
+                      B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                      Transaction *transaction);
+
+  // posting lists of the key at slot of leaf, which is write latched: add or
+  // remove value, or drop the whole list into the deleted page set
+  bool InsertIntoPosting(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int slot,
+                         const ValueType &value, Transaction *transaction);
+  bool RemoveFromPosting(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int slot,
+                         const ValueType &value, Transaction *transaction);
+  void DropPosting(const ValueType &stored, Transaction *transaction);
+
+  // append the values that stored, a value in a leaf, stands for
+  void CollectValues(const ValueType &stored, std::vector<ValueType> &result);
+
+  // the posting page page_id, pinned
+  BPlusTreePostingPage *FetchPosting(page_id_t page_id);
 
   void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key,
-                        BPlusTreePage *new_node,
+                        BPlusTreePage *new_node, BPlusTreeLog &log,
                         Transaction *transaction = nullptr);
 
-  template <typename N> N *Split(N *node);
+  // with key compression, give node the longest prefix its range in parent
+  // allows
+  void CompressKeys(BPlusTreePage *node, InternalPage *parent);
+  template <typename N>
+  void CompressKeys(N *node, const KeyType &key, int prefix_size);
+
+  template <typename N> N *Split(N *node, BPlusTreeLog &log);
+
+  template <typename N>
+  bool CoalesceOrRedistribute(N *node, BPlusTreeLog &log,
+                              Transaction *transaction = nullptr);
 
   template <typename N>
-  bool CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr);
+  bool Coalesce(N *&neighbor_node, N *&node, InternalPage *&parent, int index,
+                BPlusTreeLog &log, Transaction *transaction = nullptr);
 
   template <typename N>
-  bool Coalesce(
-      N *&neighbor_node, N *&node,
-      BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *&parent,
-      int index, Transaction *transaction = nullptr);
+  void Redistribute(N *neighbor_node, N *node, int index, BPlusTreeLog &log);
+
+  bool AdjustRoot(BPlusTreePage *node, BPlusTreeLog &log);
 
-  template <typename N> void Redistribute(N *neighbor_node, N *node, int index);
+  void UpdateRootPageId(BPlusTreeLog &log, int insert_record = false);
 
-  bool AdjustRoot(BPlusTreePage *node);
+  // the children of node in [begin, end) have node as parent, leaves have
+  // no children
+  void Reparent(B_PLUS_TREE_LEAF_PAGE_TYPE *, int, int, BPlusTreeLog &) {}
+  void Reparent(InternalPage *node, int begin, int end, BPlusTreeLog &log);
+  void SetParent(page_id_t child_id, page_id_t parent_id, BPlusTreeLog &log);
 
-  void UpdateRootPageId(int insert_record = false);
+  // log the entry at slot of leaf, after it is inserted or before it is
+  // removed
+  void LogEntry(LogRecordType type, B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                int slot, Transaction *transaction);
 
   // member variable
   std::string index_name_;
   page_id_t root_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
+  LogManager *log_manager_;
+  bool unique_;
+  RootCatalog *root_catalog_;
+  double merge_fill_factor_;
+  bool key_compression_;
+  RWLatch root_latch_;
 };
 
 } // namespace cmudb
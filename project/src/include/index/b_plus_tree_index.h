@@ -5,10 +5,13 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "index/b_plus_tree.h"
+#include "index/bloom_filter.h"
+#include "index/external_sort.h"
 #include "index/index.h"
 
 namespace cmudb {
@@ -21,24 +24,57 @@ class BPlusTreeIndex : public Index {
 public:
   BPlusTreeIndex(IndexMetadata *metadata,
                  BufferPoolManager *buffer_pool_manager,
-                 page_id_t root_page_id = INVALID_PAGE_ID);
+                 page_id_t root_page_id = INVALID_PAGE_ID,
+                 LogManager *log_manager = nullptr,
+                 RootCatalog *root_catalog = nullptr);
 
   ~BPlusTreeIndex() {}
 
   void InsertEntry(const Tuple &key, RID rid,
                    Transaction *transaction = nullptr) override;
 
-  void DeleteEntry(const Tuple &key,
+  void InsertEntries(const std::vector<Tuple> &keys,
+                     const std::vector<RID> &rids,
+                     Transaction *transaction = nullptr) override;
+
+  void DeleteEntry(const Tuple &key, RID rid,
                    Transaction *transaction = nullptr) override;
 
   void ScanKey(const Tuple &key, std::vector<RID> &result,
                Transaction *transaction = nullptr) override;
 
+  void ScanRange(const Tuple &low, const Tuple &high, std::vector<RID> &result,
+                 Transaction *transaction = nullptr) override;
+
+  void ScanOrdered(bool reverse, size_t limit, IndexScanPosition &position,
+                   std::vector<RID> &result,
+                   Transaction * = nullptr) override {
+    container_.ScanOrdered(reverse, limit, position, result);
+  }
+
+  void StartRange(const Tuple &low, const Tuple &high,
+                  IndexScanPosition &position) override;
+
+  // the entries are sorted by threads workers as they scan, spilled to
+  // pages of the buffer pool past INDEX_BUILD_RUN_SIZE each, and merged into
+  // a bulk load, or inserted in sorted batches if keys are not unique
+  void Build(TableHeap *table_heap,
+             const std::function<Tuple(const Tuple &)> &key_of,
+             int threads = INDEX_BUILD_THREADS) override;
+
+  IndexStats GetStats() override {
+    return container_.GetStats(BTREE_STATS_SAMPLES, 0);
+  }
+
 protected:
+  // for the runs of a build
+  BufferPoolManager *buffer_pool_manager_;
   // comparator for key
   KeyComparator comparator_;
   // container
   BPlusTree<KeyType, ValueType, KeyComparator> container_;
+  // of the keys of container_, if the index has one
+  std::unique_ptr<BloomFilter> filter_;
 };
 
 } // namespace cmudb
@@ -0,0 +1,76 @@
+/**
+ * b_plus_tree_log.h
+ * Write ahead logging of one B+ tree structure modification.
+ *
+ * A split, merge, redistribution or root change goes over several pages.
+ * Each page is tracked before it changes, and once the whole modification is
+ * done the bytes that changed on every page go into one BTREESTRUCTURE
+ * record, so recovery redoes all of it or none. Pages stay pinned from
+ * Track to Finish; without logging all of this does nothing.
+ *
+ * Children that get a new parent are too many to keep pinned. Their parent
+ * page id is set by Finish, after the record is appended, so none of them
+ * reaches disk ahead of the log. Finish write latches each child the
+ * operation does not hold already, and never moves its LSN back. The same goes for a new root in the header
+ * page, which has no LSN: Finish waits for the record to be durable before
+ * it updates the header page. With a RootCatalog the root is swapped there
+ * instead, and the header page gets it at the next flush of the catalog.
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/root_catalog.h"
+#include "concurrency/transaction.h"
+#include "logging/log_manager.h"
+
+namespace cmudb {
+
+class BPlusTreeLog {
+public:
+  BPlusTreeLog(BufferPoolManager *buffer_pool_manager,
+               LogManager *log_manager, Transaction *transaction);
+  // unpins what is still tracked, without logging
+  ~BPlusTreeLog();
+
+  // keep the image of page_id before it changes. A fresh page, just taken
+  // from NewPage, is logged as written on a zeroed page
+  void Track(page_id_t page_id, bool fresh = false);
+  // page_id is deleted, its changes do not matter
+  void Forget(page_id_t page_id);
+  // set the parent page id of child_id on Finish
+  void SetParent(page_id_t child_id, page_id_t parent_id);
+  // the index's root is root_page_id from Finish on, in root_catalog if
+  // given
+  void SetRoot(const std::string &index_name, page_id_t root_page_id,
+               RootCatalog *root_catalog = nullptr);
+
+  // append the record and stamp its LSN on the pages
+  void Finish();
+
+  inline bool IsEnabled() const { return enabled_; }
+
+private:
+  // page is write latched by this operation, in the transaction's page set
+  bool IsLatched(Page *page);
+
+  struct TrackedPage {
+    Page *page_;
+    bool fresh_;
+    std::vector<char> image_;
+  };
+
+  BufferPoolManager *buffer_pool_manager_;
+  LogManager *log_manager_;
+  Transaction *transaction_;
+  bool enabled_;
+  std::vector<TrackedPage> pages_;
+  std::vector<std::pair<page_id_t, page_id_t>> parents_;
+  std::string index_name_;
+  page_id_t root_page_id_;
+  RootCatalog *root_catalog_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,104 @@
+/**
+ * bloom_filter.h
+ *
+ * Blocked Bloom filter of the keys of an index, on pages of its own: a key
+ * sets BLOOM_PROBES bits of one 64 byte block, so a lookup reads one cache
+ * line of one page. A key the filter does not have is not in the index, and
+ * its lookup stops there.
+ *
+ * Bits are never cleared, a removed key stays in the filter until it is
+ * rebuilt from the keys of the index: once BLOOM_REBUILD_SHARE of its keys
+ * were removed, once it has twice the keys it was sized for, and when it was
+ * not closed cleanly, as inserts recovered from the log never reached it.
+ * The filter is not logged. Its meta page id is in the header page, under
+ * the index name followed by "_bloom".
+ *
+ * Meta page format (size in byte, 32 bytes of header):
+ * ----------------------------------------------------------------------------
+ * | unused (4) | LSN (4) | Checksum (4) | Clean (4) | KeyCount (4) |
+ * ----------------------------------------------------------------------------
+ * | RemovedCount (4) | BlockCount (4) | PageCount (4) | PageId(1) | ... |
+ * ----------------------------------------------------------------------------
+ * Bit pages have the 16 bytes of header before their blocks unused, but LSN
+ * and Checksum.
+ */
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/rwmutex.h"
+
+namespace cmudb {
+
+class BloomFilter {
+public:
+  // puts a key into the filter being rebuilt
+  typedef std::function<void(const char *, size_t)> KeySink;
+
+  // the filter of index index_name, read from its pages if it has them. A
+  // new one for an index that has keys already, not_empty, needs a rebuild
+  BloomFilter(const std::string &index_name,
+              BufferPoolManager *buffer_pool_manager, bool not_empty);
+  // write the filter back, closed cleanly
+  ~BloomFilter();
+
+  BloomFilter(const BloomFilter &) = delete;
+  BloomFilter &operator=(const BloomFilter &) = delete;
+
+  // a key inserted into the index
+  void Add(const char *key, size_t size);
+  // a key removed from the index
+  void Remove();
+  // false if key is surely not in the index
+  bool MayContain(const char *key, size_t size);
+
+  bool NeedsRebuild() const;
+  // if it needs one, build the filter again, sized for the keys it has:
+  // scan puts every key of the index into the sink. Adds and lookups wait
+  // for it
+  void RebuildIfNeeded(const std::function<void(const KeySink &)> &scan);
+
+  // keys added since the last rebuild, and blocks of the filter, for tests
+  size_t GetKeyCount() const { return key_count_.load(); }
+  size_t GetBlockCount() const { return block_count_.load(); }
+
+private:
+  static const int BLOCK_SIZE = 64;
+  static const int BLOOM_PROBES = 7;
+  static const int META_HEADER_SIZE = 32;
+  static const int BIT_PAGE_HEADER_SIZE = 16;
+
+  Page *FetchPage(page_id_t page_id);
+  Page *NewPage(page_id_t &page_id);
+
+  // the block of key: its page, pinned, and its words in it; mask of the bits
+  // key sets in each word
+  Page *FindBlock(const char *key, size_t size, uint64_t *&words,
+                  uint64_t masks[]);
+  void SetBits(const char *key, size_t size);
+
+  // pages for block_count blocks, all cleared
+  void Resize(size_t block_count);
+  // the meta page from the members, flushed
+  void WriteMeta(bool clean);
+
+  std::string index_name_;
+  BufferPoolManager *buffer_pool_manager_;
+  page_id_t meta_page_id_;
+  std::vector<page_id_t> page_ids_;
+  std::atomic<size_t> block_count_;
+  size_t blocks_per_page_;
+  size_t max_pages_;
+  std::atomic<size_t> key_count_;
+  std::atomic<size_t> removed_count_;
+  // built from other than the keys of the index
+  std::atomic<bool> stale_;
+  // shared for adds and lookups, their bits are set atomically
+  RWMutex latch_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,72 @@
+/**
+ * covering_index.h
+ *
+ * B+ tree index with included columns: the entries keep, after the key
+ * columns, the values of other columns of the table, so a lookup needing no
+ * others is answered without a fetch from the table heap, see ScanCovering.
+ * A key is the tuple of key and included columns as serialized, compared by
+ * its key columns one Value at a time, as it is not normalized.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "index/b_plus_tree.h"
+#include "index/index.h"
+
+namespace cmudb {
+
+template <size_t KeySize> class CoveringIndex : public Index {
+
+public:
+  CoveringIndex(IndexMetadata *metadata,
+                BufferPoolManager *buffer_pool_manager,
+                page_id_t root_page_id = INVALID_PAGE_ID,
+                LogManager *log_manager = nullptr,
+                RootCatalog *root_catalog = nullptr);
+
+  ~CoveringIndex() {}
+
+  // key is a tuple of the covering schema, see IndexMetadata. Throws if it
+  // does not fit into KeySize bytes
+  void InsertEntry(const Tuple &key, RID rid,
+                   Transaction *transaction = nullptr) override;
+
+  void DeleteEntry(const Tuple &key, RID rid,
+                   Transaction *transaction = nullptr) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> &result,
+               Transaction *transaction = nullptr) override;
+
+  void ScanRange(const Tuple &low, const Tuple &high, std::vector<RID> &result,
+                 Transaction *transaction = nullptr) override;
+
+  void ScanOrdered(bool reverse, size_t limit, IndexScanPosition &position,
+                   std::vector<RID> &result,
+                   Transaction * = nullptr) override {
+    container_.ScanOrdered(reverse, limit, position, result);
+  }
+
+  void StartRange(const Tuple &low, const Tuple &high,
+                  IndexScanPosition &position) override;
+
+  void ScanCovering(const Tuple &key, std::vector<RID> &result,
+                    std::vector<Tuple> &rows,
+                    Transaction *transaction = nullptr) override;
+
+  IndexStats GetStats() override {
+    return container_.GetStats(BTREE_STATS_SAMPLES, 0);
+  }
+
+protected:
+  // the index key of tuple, throws if it does not fit
+  GenericKey<KeySize> MakeKey(const Tuple &tuple);
+
+  // comparator for key, of the key columns only
+  GenericComparator<KeySize> comparator_;
+  // container
+  BPlusTree<GenericKey<KeySize>, RID, GenericComparator<KeySize>> container_;
+};
+
+} // namespace cmudb
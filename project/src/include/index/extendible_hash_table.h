@@ -0,0 +1,84 @@
+/**
+ * extendible_hash_table.h
+ *
+ * Disk-resident extendible hash table: the same scheme as the in-memory
+ * ExtendibleHash (hash/extendible_hash.h), with the directory stored in one
+ * page and every bucket in a page of its own. A point lookup fetches the
+ * directory page and one bucket page.
+ * (1) We only support unique key
+ * (2) Buckets split when full and merge with their buddy once empty, the
+ * directory doubles and halves accordingly
+ * (3) No range scans, keys are placed by hash
+ */
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "concurrency/transaction.h"
+#include "page/hash_table_bucket_page.h"
+#include "page/hash_table_directory_page.h"
+
+namespace cmudb {
+
+#define EXTENDIBLE_HASH_TABLE_TYPE                                             \
+  ExtendibleHashTable<KeyType, ValueType, KeyComparator>
+
+// Main class providing the API for the disk-resident hash table
+INDEX_TEMPLATE_ARGUMENTS
+class ExtendibleHashTable {
+public:
+  // directory_page_id: directory of an existing table, INVALID_PAGE_ID
+  // creates one on the first insert
+  explicit ExtendibleHashTable(const std::string &name,
+                               BufferPoolManager *buffer_pool_manager,
+                               const KeyComparator &comparator,
+                               page_id_t directory_page_id = INVALID_PAGE_ID);
+
+  // Returns true if nothing was ever inserted
+  bool IsEmpty() const;
+
+  // Insert a key-value pair, false if the key exists or no split can make
+  // room for it
+  bool Insert(const KeyType &key, const ValueType &value,
+              Transaction *transaction = nullptr);
+
+  // Remove a key and its value
+  void Remove(const KeyType &key, Transaction *transaction = nullptr);
+
+  // return the value associated with a given key
+  bool GetValue(const KeyType &key, std::vector<ValueType> &result,
+                Transaction *transaction = nullptr);
+
+  inline page_id_t GetDirectoryPageId() const { return directory_page_id_; }
+
+  // for test purpose
+  uint32_t GetGlobalDepth();
+
+private:
+  size_t HashKey(const KeyType &key) const;
+
+  // make the directory and its first bucket, record it in the header page
+  void StartNewTable();
+
+  // split the bucket of slot, directory page latched exclusively. Returns
+  // false if the directory is as deep as its page allows
+  bool SplitBucket(HashTableDirectoryPage *directory, size_t slot,
+                   HASH_TABLE_BUCKET_PAGE_TYPE *bucket);
+
+  // fold the emptied bucket of slot into its buddy and shrink the directory
+  void MergeBucket(HashTableDirectoryPage *directory, size_t slot);
+
+  int BucketSize(page_id_t bucket_page_id);
+
+  // member variable
+  std::string index_name_;
+  page_id_t directory_page_id_;
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+  // serialises creating the directory
+  std::mutex start_latch_;
+};
+
+} // namespace cmudb
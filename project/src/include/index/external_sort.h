@@ -0,0 +1,91 @@
+/**
+ * external_sort.h
+ *
+ * Sort of more (key, value) pairs than fit in memory, for index builds.
+ * Workers add pairs at once, each to a buffer of its own; a full one is
+ * sorted by its worker and written out as a run, pages of pairs through the
+ * buffer pool that are evicted as any others. The buffers left at the end
+ * are sorted in parallel and kept in memory, then all runs are merged into
+ * one sequence, read a page of each run at a time.
+ *
+ * Run page format (size in byte, 16 bytes of header):
+ * ----------------------------------------------------------------------------
+ * | unused (4) | LSN (4) | Checksum (4) | Count (4) | Pair(1) | ... |
+ * ----------------------------------------------------------------------------
+ */
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "page/b_plus_tree_page.h"
+
+namespace cmudb {
+
+#define EXTERNALSORT_TYPE ExternalSort<KeyType, ValueType, KeyComparator>
+
+INDEX_TEMPLATE_ARGUMENTS
+class ExternalSort {
+public:
+  // for workers adding at once, each keeping at most run_size pairs in
+  // memory. If unique, of pairs with equal keys only the first is in the
+  // result
+  ExternalSort(BufferPoolManager *buffer_pool_manager,
+               const KeyComparator &comparator, int workers, size_t run_size,
+               bool unique);
+  // deletes the pages of the runs
+  ~ExternalSort();
+
+  ExternalSort(const ExternalSort &) = delete;
+  ExternalSort &operator=(const ExternalSort &) = delete;
+
+  void Add(int worker, const KeyType &key, const ValueType &value);
+
+  // sort what the workers have left, no adds after it
+  void Finish();
+
+  // the next pair of the result in key order, false after the last
+  bool Next(MappingType &item);
+  // from the first pair of the result again
+  void Rewind();
+
+  // runs written out, for tests
+  size_t GetSpilledRunCount();
+
+private:
+  static const int PAGE_HEADER_SIZE = 16;
+
+  // a run being merged: the pairs of its page being read, or all of them if
+  // it was not written out
+  struct Run {
+    std::vector<page_id_t> page_ids_;
+    std::vector<MappingType> items_;
+    size_t page_;
+    size_t slot_;
+  };
+
+  void Sort(std::vector<MappingType> &items);
+  // sort items and write them out as a run, leaves items empty
+  void Spill(std::vector<MappingType> &items);
+  // the pairs of the page_th page of run, a written out one, into its items
+  void ReadPage(Run &run, size_t page);
+  // whether run a is behind run b in the merge, by their current pairs
+  bool After(size_t a, size_t b);
+
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+  size_t run_size_;
+  bool unique_;
+  size_t items_per_page_;
+  std::vector<std::vector<MappingType>> buffers_;
+  std::vector<Run> runs_;
+  // runs_ while workers spill
+  std::mutex latch_;
+  // runs with pairs left, in heap order of After
+  std::vector<size_t> heap_;
+  bool has_last_;
+  KeyType last_;
+};
+
+} // namespace cmudb
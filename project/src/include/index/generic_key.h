@@ -6,27 +6,60 @@
  * This key type uses an fixed length array to hold data for indexing
  * purposes, the actual size of which is specified and instantiated
  * with a template argument.
+ *
+ * Keys whose schema fits are normalized, see NormalizedKey, and compared with
+ * memcmp; the others are kept as their tuple and compared column by column
+ * with the comparators their schema bound to the column types.
  */
 #pragma once
 
 #include <cstring>
+#include <type_traits>
 
+#include "index/normalized_key.h"
 #include "table/tuple.h"
 #include "type/value.h"
 
 namespace cmudb {
 template <size_t KeySize> class GenericKey {
 public:
-  inline void SetFromKey(const Tuple &tuple) {
+  // tuple is a key of key_schema
+  inline void SetFromKey(const Tuple &tuple, Schema *key_schema) {
+    if (NormalizedKey::Fits(key_schema, KeySize)) {
+      NormalizedKey::Encode(tuple, key_schema, data, KeySize);
+      return;
+    }
     // intialize to 0
     memset(data, 0, KeySize);
     memcpy(data, tuple.GetData(), tuple.GetLength());
   }
 
+  // the serialized tuple, never normalized: its first columns are compared
+  // by a GenericComparator that is not normalized, later ones are carried
+  // along. False if it does not fit
+  inline bool SetFromTuple(const Tuple &tuple) {
+    if (static_cast<size_t>(tuple.GetLength()) > KeySize) {
+      return false;
+    }
+    memset(data, 0, KeySize);
+    memcpy(data, tuple.GetData(), tuple.GetLength());
+    return true;
+  }
+
   // NOTE: for test purpose only
+  // normalized, as a key of a single bigint column
   inline void SetFromInteger(int64_t key) {
     memset(data, 0, KeySize);
-    memcpy(data, &key, sizeof(int64_t));
+    NormalizedKey::EncodeInteger(key, data);
+  }
+
+  // where the column is stored, past the offset of an uninlined one
+  inline const char *Locate(Schema *schema, int column_id) const {
+    if (schema->IsInlined(column_id))
+      return data + schema->GetOffset(column_id);
+    int32_t offset;
+    memcpy(&offset, data + schema->GetOffset(column_id), sizeof(offset));
+    return data + offset;
   }
 
   inline Value ToValue(Schema *schema, int column_id) const {
@@ -44,13 +77,13 @@ public:
   }
 
   // NOTE: for test purpose only
-  // interpret the first 8 bytes as int64_t from data vector
+  // interpret the first 8 bytes as a normalized bigint
   inline int64_t ToString() const {
-    return *reinterpret_cast<int64_t *>(const_cast<char *>(data));
+    return NormalizedKey::DecodeInteger(data);
   }
 
   // NOTE: for test purpose only
-  // interpret the first 8 bytes as int64_t from data vector
+  // interpret the first 8 bytes as a normalized bigint
   friend std::ostream &operator<<(std::ostream &os, const GenericKey &key) {
     os << key.ToString();
     return os;
@@ -67,9 +100,20 @@ template <size_t KeySize> class GenericComparator {
 public:
   inline int operator()(const GenericKey<KeySize> &lhs,
                         const GenericKey<KeySize> &rhs) const {
+    if (normalized_) {
+      return memcmp(lhs.data, rhs.data, KeySize);
+    }
     int column_count = key_schema_->GetColumnCount();
 
     for (int i = 0; i < column_count; i++) {
+      StoredComparator comparator = key_schema_->GetComparator(i);
+      if (comparator != nullptr) {
+        int cmp = comparator(lhs.Locate(key_schema_, i),
+                             rhs.Locate(key_schema_, i));
+        if (cmp != 0)
+          return cmp;
+        continue;
+      }
       Value lhs_value = (lhs.ToValue(key_schema_, i));
       Value rhs_value = (rhs.ToValue(key_schema_, i));
 
@@ -83,15 +127,77 @@ public:
     return 0;
   }
 
+  // whether keys are normalized, see GenericKey::SetFromKey
+  inline bool IsNormalized() const { return normalized_; }
+
   GenericComparator(const GenericComparator &other) {
     this->key_schema_ = other.key_schema_;
+    this->normalized_ = other.normalized_;
   }
 
   // constructor
-  GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
+  GenericComparator(Schema *key_schema)
+      : key_schema_(key_schema),
+        normalized_(NormalizedKey::Fits(key_schema, KeySize)) {}
+
+  // keys set from their serialized tuples whatever their schema, see
+  // GenericKey::SetFromTuple, if not normalized
+  GenericComparator(Schema *key_schema, bool normalized)
+      : key_schema_(key_schema), normalized_(normalized) {}
 
 private:
   Schema *key_schema_;
+  // keys are normalized, see GenericKey::SetFromKey
+  bool normalized_;
+};
+
+/**
+ * Comparators picked for a key schema when the index is created, for keys
+ * known to be normalized: a compare is a memcmp, or for keys of 4 or 8 bytes,
+ * like a single INTEGER or BIGINT column, one integer compare
+ */
+template <size_t KeySize> class BytesComparator {
+public:
+  inline int operator()(const GenericKey<KeySize> &lhs,
+                        const GenericKey<KeySize> &rhs) const {
+    return memcmp(lhs.data, rhs.data, KeySize);
+  }
+
+  inline bool IsNormalized() const { return true; }
+
+  // the keys of key_schema have to be normalized into KeySize bytes
+  BytesComparator(Schema *) {}
+};
+
+template <size_t KeySize> class IntegerComparator {
+  static_assert(KeySize == 4 || KeySize == 8, "integer keys are 4 or 8 bytes");
+
+public:
+  typedef typename std::conditional<KeySize == 4, uint32_t, uint64_t>::type
+      Bits;
+
+  inline int operator()(const GenericKey<KeySize> &lhs,
+                        const GenericKey<KeySize> &rhs) const {
+    Bits lhs_bits = BitsOf(lhs);
+    Bits rhs_bits = BitsOf(rhs);
+    return (lhs_bits > rhs_bits) - (lhs_bits < rhs_bits);
+  }
+
+  // a normalized key as an unsigned integer, ordered as the key
+  static inline Bits BitsOf(const GenericKey<KeySize> &key) {
+    Bits bits;
+    memcpy(&bits, key.data, sizeof(bits));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    bits = KeySize == 4 ? __builtin_bswap32(static_cast<uint32_t>(bits))
+                        : __builtin_bswap64(bits);
+#endif
+    return bits;
+  }
+
+  inline bool IsNormalized() const { return true; }
+
+  // the keys of key_schema have to be normalized into KeySize bytes
+  IntegerComparator(Schema *) {}
 };
 
 } // namespace cmudb
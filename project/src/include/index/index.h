@@ -4,11 +4,15 @@
 
 #pragma once
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "catalog/schema.h"
+#include "common/exception.h"
+#include "table/table_heap.h"
 #include "table/tuple.h"
 #include "type/value.h"
 
@@ -23,22 +27,57 @@ namespace cmudb {
  * mapping relation and does the conversion between tuple key and index key
  */
 class Transaction;
+
+// structure behind an index, B+ tree unless asked otherwise
+enum class IndexType {
+  BPLUS_TREE = 0,
+  HASH,
+  BLINK_TREE,
+  VARKEY_TREE,
+  BEPSILON_TREE,
+  ART
+};
+
 class IndexMetadata {
   IndexMetadata() = delete;
 
 public:
   IndexMetadata(std::string index_name, std::string table_name,
-                const Schema *tuple_schema, const std::vector<int> &key_attrs)
-      : name_(index_name), table_name_(table_name), key_attrs_(key_attrs) {
+                const Schema *tuple_schema, const std::vector<int> &key_attrs,
+                IndexType index_type = IndexType::BPLUS_TREE,
+                bool unique = true, bool bloom_filter = false,
+                const std::vector<int> &include_attrs = std::vector<int>())
+      : name_(index_name), table_name_(table_name), key_attrs_(key_attrs),
+        include_attrs_(include_attrs), index_type_(index_type),
+        unique_(unique), bloom_filter_(bloom_filter) {
     key_schema_ = Schema::CopySchema(tuple_schema, key_attrs_);
+    if (!include_attrs_.empty()) {
+      std::vector<int> covered = key_attrs_;
+      covered.insert(covered.end(), include_attrs_.begin(),
+                     include_attrs_.end());
+      covering_schema_ = Schema::CopySchema(tuple_schema, covered);
+    }
   }
 
-  ~IndexMetadata() { delete key_schema_; };
+  ~IndexMetadata() {
+    delete key_schema_;
+    delete covering_schema_;
+  };
 
   inline const std::string &GetName() const { return name_; }
 
   inline const std::string &GetTableName() { return table_name_; }
 
+  inline IndexType GetIndexType() const { return index_type_; }
+
+  // a non-unique index keeps every record id of a key, only B+ tree indexes
+  // can be non-unique
+  inline bool IsUnique() const { return unique_; }
+
+  // lookups of absent keys stop at a Bloom filter, only B+ tree indexes can
+  // have one
+  inline bool HasBloomFilter() const { return bloom_filter_; }
+
   // Returns a schema object pointer that represents the indexed key
   inline Schema *GetKeySchema() const { return key_schema_; }
 
@@ -51,13 +90,51 @@ public:
   //  columns
   inline const std::vector<int> &GetKeyAttrs() const { return key_attrs_; }
 
+  // base table columns kept in the entries besides the key, for index-only
+  // scans; only B+ tree indexes have them
+  inline const std::vector<int> &GetIncludeAttrs() const {
+    return include_attrs_;
+  }
+
+  // the key columns then the included ones, nullptr without included columns
+  inline Schema *GetCoveringSchema() const { return covering_schema_; }
+
+  // position of base table column in the covering schema, -1 if not in it
+  inline int GetCoveringColumn(int column) const {
+    if (covering_schema_ == nullptr)
+      return -1;
+    auto it = std::find(key_attrs_.begin(), key_attrs_.end(), column);
+    if (it != key_attrs_.end())
+      return static_cast<int>(it - key_attrs_.begin());
+    it = std::find(include_attrs_.begin(), include_attrs_.end(), column);
+    if (it != include_attrs_.end())
+      return static_cast<int>(key_attrs_.size() +
+                              (it - include_attrs_.begin()));
+    return -1;
+  }
+
   // Get a string representation for debugging
   const std::string ToString() const {
     std::stringstream os;
 
     os << "IndexMetadata["
        << "Name = " << name_ << ", "
-       << "Type = B+Tree, "
+       << "Type = "
+       << (index_type_ == IndexType::HASH
+               ? "Hash"
+               : index_type_ == IndexType::BLINK_TREE
+                     ? "B-link tree"
+                     : index_type_ == IndexType::VARKEY_TREE
+                           ? "Varkey tree"
+                           : index_type_ == IndexType::BEPSILON_TREE
+                                 ? "B-epsilon tree"
+                                 : index_type_ == IndexType::ART
+                                       ? "Adaptive radix tree"
+                                       : "B+Tree")
+       << ", "
+       << "Unique = " << (unique_ ? "true" : "false") << ", "
+       << "Bloom filter = " << (bloom_filter_ ? "true" : "false") << ", "
+       << "Included columns = " << include_attrs_.size() << ", "
        << "Table name = " << table_name_ << "] :: ";
     os << key_schema_->ToString();
 
@@ -69,14 +146,39 @@ private:
   std::string table_name_;
   // The mapping relation between key schema and tuple schema
   const std::vector<int> key_attrs_;
+  const std::vector<int> include_attrs_;
+  IndexType index_type_;
+  bool unique_;
+  bool bloom_filter_;
   // schema of the indexed key
   Schema *key_schema_;
+  // of the key and included columns
+  Schema *covering_schema_ = nullptr;
 };
 
 /////////////////////////////////////////////////////////////////////
 // Index class definition
 /////////////////////////////////////////////////////////////////////
 
+// shape of an index, for cost estimates, none known if height is 0
+struct IndexStats {
+  int height = 0;            // levels, 1 for a root that is a leaf
+  size_t leaf_pages = 0;     // pages the keys are in
+  size_t internal_pages = 0; // pages above them
+  double fill_factor = 0;    // average share of its entries a page holds
+  size_t key_count = 0;      // keys, each once whatever values it has
+};
+
+// how far an ordered scan got, see Index::ScanOrdered; a new one is at the
+// start
+struct IndexScanPosition {
+  std::string key;      // the last key passed, as the index keeps it
+  size_t passed = 0;    // values of it passed, non-unique keys have several
+  bool started = false; // whether key is set
+  bool done = false;    // whether the last entry was passed
+  std::string end;      // the last key to pass, the last entry if empty
+};
+
 /**
  * class Index - Base class for derived indices of different types
  *
@@ -126,13 +228,68 @@ public:
   virtual void InsertEntry(const Tuple &key, RID rid,
                            Transaction *transaction = nullptr) = 0;
 
-  // delete the index entry linked to given tuple
-  virtual void DeleteEntry(const Tuple &key,
+  // the entries of keys[i] and rids[i] at once. Here one at a time; a B+
+  // tree sorts them and bulk loads them if it is empty
+  virtual void InsertEntries(const std::vector<Tuple> &keys,
+                             const std::vector<RID> &rids,
+                             Transaction *transaction = nullptr) {
+    for (size_t i = 0; i < keys.size(); i++)
+      InsertEntry(keys[i], rids[i], transaction);
+  }
+
+  // delete the index entry linked to given tuple, rid is the tuple's: a
+  // non-unique index may have others under key
+  virtual void DeleteEntry(const Tuple &key, RID rid,
                            Transaction *transaction = nullptr) = 0;
 
   virtual void ScanKey(const Tuple &key, std::vector<RID> &result,
                        Transaction *transaction = nullptr) = 0;
 
+  // the record ids of the keys from low to high, both included, into result
+  // in key order; only B+ tree indexes keep their keys in order
+  virtual void ScanRange(const Tuple &, const Tuple &, std::vector<RID> &,
+                         Transaction * = nullptr) {
+    throw NotImplementedException("index keys are not ordered");
+  }
+
+  // the record ids of up to limit entries past position into result, in key
+  // order, or down from the highest key if reverse; position moves past
+  // them. No latch is held in between, a scan goes on from the key it
+  // stopped at; only B+ tree indexes keep their keys in order
+  virtual void ScanOrdered(bool, size_t, IndexScanPosition &,
+                           std::vector<RID> &, Transaction * = nullptr) {
+    throw NotImplementedException("index keys are not ordered");
+  }
+
+  // position at low, for ScanOrdered to go up to high, both included, a
+  // batch at a time as ScanRange does at once
+  virtual void StartRange(const Tuple &, const Tuple &, IndexScanPosition &) {
+    throw NotImplementedException("index keys are not ordered");
+  }
+
+  // for an index with included columns, see IndexMetadata: the record ids of
+  // key into result, and into rows their key and included columns, tuples of
+  // the covering schema
+  virtual void ScanCovering(const Tuple &, std::vector<RID> &,
+                            std::vector<Tuple> &, Transaction * = nullptr) {
+    throw NotImplementedException("index has no included columns");
+  }
+
+  // fill this empty index from the tuples of table_heap, whose keys key_of
+  // gives, as TableHeap::ParallelScan reads them with threads workers. Here
+  // one at a time, not every index takes concurrent inserts; a B+ tree sorts
+  // the entries and loads them at once
+  virtual void Build(TableHeap *table_heap,
+                     const std::function<Tuple(const Tuple &)> &key_of,
+                     int = INDEX_BUILD_THREADS) {
+    table_heap->ParallelScan(1, [&](int, const Tuple &tuple) {
+      InsertEntry(key_of(tuple), tuple.GetRid());
+    });
+  }
+
+  // estimated from the index as it is, or none if it cannot tell
+  virtual IndexStats GetStats() { return IndexStats(); }
+
 private:
   //===--------------------------------------------------------------------===//
   //  Data members
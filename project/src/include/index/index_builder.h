@@ -0,0 +1,56 @@
+/**
+ * index_builder.h
+ *
+ * Online build of an index over a table that has tuples already: the table
+ * is scanned in parallel and the index filled from what the scan read, see
+ * Index::Build. Writes to the index meanwhile go through the builder, which
+ * keeps them aside and applies them in order once the index is filled. The
+ * scan may or may not have seen the tuples they are about, so each either
+ * comes after what the scan found or changes nothing: an insert of an entry
+ * the index has already, or a delete of one it does not have
+ */
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "index/index.h"
+
+namespace cmudb {
+
+class IndexBuilder {
+public:
+  IndexBuilder(Index *index, TableHeap *table_heap);
+
+  // fill the index, empty, from the tuples of the table, key_of their keys.
+  // Writes through the builder from then on go straight to the index
+  void Build(const std::function<Tuple(const Tuple &)> &key_of,
+             int threads = INDEX_BUILD_THREADS);
+
+  // writes to the index, kept aside while it is built
+  void InsertEntry(const Tuple &key, RID rid,
+                   Transaction *transaction = nullptr);
+  void DeleteEntry(const Tuple &key, RID rid,
+                   Transaction *transaction = nullptr);
+
+  // writes kept aside and applied once the index was filled, for tests
+  size_t GetAppliedCount() const { return applied_count_; }
+
+private:
+  struct Write {
+    bool insert_;
+    Tuple key_;
+    RID rid_;
+  };
+
+  Index *index_;
+  TableHeap *table_heap_;
+  // building_ and writes_
+  std::mutex latch_;
+  bool building_;
+  std::vector<Write> writes_;
+  size_t applied_count_;
+};
+
+} // namespace cmudb
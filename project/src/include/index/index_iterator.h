@@ -1,8 +1,31 @@
 /**
  * index_iterator.h
  * For range scan of b+ tree
+ *
+ * The iterator keeps the leaf it is on pinned and read latched, and walks the
+ * leaf chain: the next leaf is latched before the current one is let go of,
+ * so it cannot be split or merged away in between. A remove latches a leaf
+ * and then its left sibling, the other way round, so the next leaf is only
+ * tried; if a writer holds it the iterator lets go and descends again to the
+ * key it stopped after.
+ *
+ * A reverse iterator goes down the keys, through the previous page ids. Those
+ * are hints, see BPlusTreeLeafPage: the previous leaf is tried and taken if
+ * it links to this one, otherwise the iterator lets go and descends to the
+ * leaf with the keys below the first one of this leaf.
+ *
+ * In a non-unique tree a key with a posting list is a pair for each of its
+ * values, read from the list at once while the leaf is latched.
+ *
+ * Read-ahead: while a leaf is consumed, up to read_ahead following leaves are
+ * hinted to the buffer pool. Their ids come from the parent of the leaf,
+ * leaves only know their neighbours.
  */
 #pragma once
+
+#include <deque>
+#include <vector>
+
 #include "page/b_plus_tree_leaf_page.h"
 
 namespace cmudb {
@@ -10,11 +33,21 @@ namespace cmudb {
 #define INDEXITERATOR_TYPE                                                     \
   IndexIterator<KeyType, ValueType, KeyComparator>
 
+INDEX_TEMPLATE_ARGUMENTS class BPlusTree;
+
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
 public:
-  // you may define your own constructor based on your member variables
+  // an iterator at the end
   IndexIterator();
+  // at the slot-th pair of the leaf on page, pinned and read latched. Moves
+  // on to the next leaf if slot is past the last pair, or for a reverse
+  // iterator to the previous one if slot is before the first
+  IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree,
+                Page *page, int slot, int read_ahead, bool reverse = false);
+  IndexIterator(IndexIterator &&other);
+  IndexIterator(const IndexIterator &) = delete;
+  IndexIterator &operator=(const IndexIterator &) = delete;
   ~IndexIterator();
 
   bool isEnd();
@@ -24,7 +57,40 @@ public:
   IndexIterator &operator++();
 
 private:
-  // add your own private member variables here
+  typedef BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> LeafPage;
+
+  // on to the first pair of the leaves after this one, the end if none
+  void NextLeaf();
+
+  // on to the last pair of the leaves before this one, the end if none
+  void PrevLeaf();
+
+  // the neighbour leaf of page_id on page, if the page turns out to be it
+  // and can be read latched right away
+  bool TakeLeaf(Page *page, page_id_t page_id);
+
+  // whether the key the iterator is on has a posting list, its values are
+  // read into values_ if not yet
+  bool LoadValues();
+
+  // hint the leaves after this one to the buffer pool
+  void ReadAhead();
+
+  // unlatch and unpin the leaf, if any
+  void Release();
+
+  BPlusTree<KeyType, ValueType, KeyComparator> *tree_ = nullptr;
+  Page *page_ = nullptr; // nullptr at the end
+  LeafPage *leaf_ = nullptr;
+  int slot_ = 0;
+  int read_ahead_ = 0;
+  bool reverse_ = false;
+  // leaves hinted and not reached yet, in scan order
+  std::deque<page_id_t> ahead_;
+  // the posting list of the key, and how many of its values are passed
+  std::vector<ValueType> values_;
+  size_t value_ = 0;
+  MappingType item_;
 };
 
 } // namespace cmudb
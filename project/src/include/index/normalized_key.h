@@ -0,0 +1,42 @@
+/**
+ * normalized_key.h
+ *
+ * Memcmp-comparable encoding of index keys: the bytes of two encoded keys
+ * compare like the keys do, so comparing them needs no schema and no Value.
+ * Columns are encoded one after the other, the rest of the key is zeroed:
+ * - integers and booleans big-endian, the sign bit flipped
+ * - timestamps big-endian
+ * - decimals big-endian, the sign bit flipped if positive and all bits if
+ *   negative
+ * - varchars a byte 0 if null and 1 if not, then their bytes with each 0
+ *   escaped as 0 0xFF, then 0 0
+ * Nulls of the other types are the smallest value of their type, as in a
+ * tuple, so they sort first. A key is cut at the key size.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "catalog/schema.h"
+#include "table/tuple.h"
+
+namespace cmudb {
+class NormalizedKey {
+public:
+  // whether keys of key_schema are encoded into size bytes: all of their
+  // columns but the varchars have to fit
+  static bool Fits(Schema *key_schema, size_t size);
+
+  // encode tuple, a key of key_schema, into size bytes at data
+  static void Encode(const Tuple &tuple, Schema *key_schema, char *data,
+                     size_t size);
+
+  // bytes the encoding of tuple takes whole, varchars escaped and closed
+  static size_t EncodedSize(const Tuple &tuple, Schema *key_schema);
+
+  // the 8 bytes of a bigint
+  static void EncodeInteger(int64_t key, char *data);
+  static int64_t DecodeInteger(const char *data);
+};
+} // namespace cmudb
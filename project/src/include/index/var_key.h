@@ -0,0 +1,54 @@
+/**
+ * var_key.h
+ *
+ * Variable-length index keys: the normalized encoding of a key, see
+ * NormalizedKey, taken whole instead of cut or padded to a GenericKey size.
+ * A VarKey only points at the bytes, those of a page or of a caller.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace cmudb {
+
+struct VarKey {
+  VarKey() = default;
+  VarKey(const char *data, int size) : data_(data), size_(size) {}
+  explicit VarKey(const std::string &bytes)
+      : data_(bytes.data()), size_(static_cast<int>(bytes.size())) {}
+
+  inline std::string ToString() const { return std::string(data_, size_); }
+
+  const char *data_ = nullptr;
+  int size_ = 0;
+};
+
+/**
+ * Compares the serialized bytes: memcmp over the shorter key, which sorts
+ * first if the longer one starts with it. The empty key is below all others
+ */
+class VarKeyComparator {
+public:
+  inline int operator()(const VarKey &lhs, const VarKey &rhs) const {
+    int result = memcmp(lhs.data_, rhs.data_, std::min(lhs.size_, rhs.size_));
+    if (result != 0) {
+      return result;
+    }
+    return lhs.size_ < rhs.size_ ? -1 : lhs.size_ > rhs.size_ ? 1 : 0;
+  }
+
+  // the shortest key above low and not above high, low < high: high up to
+  // the first byte it differs from low in
+  static inline std::string Separator(const VarKey &low, const VarKey &high) {
+    int common = 0;
+    while (common < low.size_ && common < high.size_ &&
+           low.data_[common] == high.data_[common]) {
+      common++;
+    }
+    return std::string(high.data_, std::min(common + 1, high.size_));
+  }
+};
+
+} // namespace cmudb
@@ -0,0 +1,91 @@
+/**
+ * var_key_tree.h
+ *
+ * B+ tree of variable-length keys, see var_key.h, on slotted pages, see
+ * SlottedTreePage. A key takes its own bytes instead of a GenericKey slot,
+ * so a page of short strings holds several times the keys. Pages split at
+ * half their bytes rather than half their entries, and a leaf split pushes
+ * up the shortest separator between its halves.
+ *
+ * Parent page ids are not kept, a descent remembers the path instead. The
+ * whole tree is read or write latched for an operation, its pages are not.
+ * Removes do not merge, a leaf emptied stays linked. The tree is not logged.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/rwmutex.h"
+#include "concurrency/transaction.h"
+#include "page/slotted_tree_page.h"
+
+namespace cmudb {
+
+class VarKeyTree {
+public:
+  explicit VarKeyTree(const std::string &name,
+                      BufferPoolManager *buffer_pool_manager,
+                      page_id_t root_page_id = INVALID_PAGE_ID);
+
+  // Returns true if this tree has never had a key
+  bool IsEmpty() const;
+
+  // Insert a key-value pair, false if key is there already. Throws for a
+  // key above GetMaxKeySize
+  bool Insert(const VarKey &key, const RID &value,
+              Transaction *transaction = nullptr);
+
+  // Remove a key and its value
+  void Remove(const VarKey &key, Transaction *transaction = nullptr);
+
+  // return the value associated with a given key
+  bool GetValue(const VarKey &key, std::vector<RID> &result,
+                Transaction *transaction = nullptr);
+
+  // the values of the keys from key on, in key order, at most limit. The
+  // keys go to keys as well, if given
+  void Scan(const VarKey &key, size_t limit, std::vector<RID> &result,
+            std::vector<std::string> *keys = nullptr);
+
+  // write every page of the tree back to disk
+  void Flush();
+
+  // bytes of the longest key, four fit into a page
+  int GetMaxKeySize() const { return max_key_size_; }
+
+  // levels from the root down to the leaves, and pages of the tree, for
+  // tests
+  int GetHeight();
+  int GetPageCount();
+
+private:
+  typedef SlottedTreePage<RID> LeafPage;
+  typedef SlottedTreePage<page_id_t> InternalPage;
+
+  Page *FetchPage(page_id_t page_id);
+  Page *NewPage(page_id_t &page_id);
+
+  // the leaf covering key, pinned; the pages above it are appended to path
+  Page *FindLeaf(const VarKey &key, std::vector<page_id_t> *path = nullptr);
+
+  // post separator and right_id, split off left_id from separator on, to the
+  // last page of path, splitting up the path as far as needed
+  void InsertIntoParent(std::vector<page_id_t> &path, page_id_t left_id,
+                        const std::string &separator, page_id_t right_id);
+
+  int CountPages(page_id_t page_id);
+  void FlushPages(page_id_t page_id);
+
+  void UpdateRootPageId(bool insert_record);
+
+  // member variable
+  std::string index_name_;
+  page_id_t root_page_id_;
+  BufferPoolManager *buffer_pool_manager_;
+  VarKeyComparator comparator_;
+  int max_key_size_;
+  RWMutex latch_;
+};
+
+} // namespace cmudb
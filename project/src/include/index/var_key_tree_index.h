@@ -0,0 +1,44 @@
+/**
+ * var_key_tree_index.h
+ *
+ * Index over VarKeyTree: keys are normalized whole, see NormalizedKey, so
+ * varchars are neither cut nor padded to a key size.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "index/index.h"
+#include "index/var_key_tree.h"
+
+namespace cmudb {
+
+class VarKeyTreeIndex : public Index {
+
+public:
+  VarKeyTreeIndex(IndexMetadata *metadata,
+                  BufferPoolManager *buffer_pool_manager,
+                  page_id_t root_page_id = INVALID_PAGE_ID);
+
+  ~VarKeyTreeIndex() {}
+
+  void InsertEntry(const Tuple &key, RID rid,
+                   Transaction *transaction = nullptr) override;
+
+  void DeleteEntry(const Tuple &key, RID rid,
+                   Transaction *transaction = nullptr) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> &result,
+               Transaction *transaction = nullptr) override;
+
+protected:
+  // the normalized bytes of key
+  std::string EncodeKey(const Tuple &key);
+
+  // container
+  VarKeyTree container_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,89 @@
+/**
+ * checkpoint_manager.h
+ * Fuzzy checkpoints, so recovery does not read the whole log.
+ *
+ * A checkpoint appends a BEGINCHECKPOINT record, takes the active
+ * transaction table and the dirty page table with the recLSN of every page,
+ * appends both in an ENDCHECKPOINT record and waits for it to be durable.
+ * Writers go on meanwhile, the tables are not a consistent cut but every
+ * change below the LSN of the BEGINCHECKPOINT record is covered by them.
+ * Then the header page is pointed at the checkpoint: redo starts at the
+ * lowest recLSN, or earlier at the first record of an active transaction,
+ * which undo needs to read.
+ *
+ * With a RootCatalog the checkpoint flushes it after the BEGINCHECKPOINT
+ * record, and the header page is in the dirty page table with the recLSN of
+ * the catalog if root swaps are left that the flush did not write.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/root_catalog.h"
+#include "common/task_scheduler.h"
+#include "concurrency/transaction_manager.h"
+#include "logging/log_manager.h"
+
+namespace cmudb {
+
+// header page records of the last checkpoint: the LSN of its
+// BEGINCHECKPOINT record, the log offset to look for it from, and the log
+// offset redo starts at. Offsets are wide records, see
+// HeaderPage::SetWideRecord
+#define CHECKPOINT_LSN_RECORD "__checkpoint_lsn"
+#define CHECKPOINT_OFFSET_RECORD "__checkpoint_offset"
+#define REDO_OFFSET_RECORD "__redo_offset"
+
+class CheckpointManager {
+public:
+  CheckpointManager(TransactionManager *transaction_manager,
+                    LogManager *log_manager,
+                    BufferPoolManager *buffer_pool_manager,
+                    RootCatalog *root_catalog = nullptr)
+      : transaction_manager_(transaction_manager), log_manager_(log_manager),
+        buffer_pool_manager_(buffer_pool_manager), root_catalog_(root_catalog),
+        last_checkpoint_lsn_(INVALID_LSN), running_(false),
+        checkpoint_thread_(nullptr), scheduler_(nullptr),
+        checkpoint_task_(-1) {}
+
+  ~CheckpointManager() { StopCheckpointThread(); }
+
+  // take a checkpoint, returns the LSN of its BEGINCHECKPOINT record.
+  // INVALID_LSN if logging is off or page 0 is not an initialised header
+  // page, as in tests using it for data
+  lsn_t Checkpoint();
+
+  // spawn a thread that takes a checkpoint every CHECKPOINT_TIMEOUT, or
+  // take them as a periodic task of scheduler if given
+  void RunCheckpointThread(TaskScheduler *scheduler = nullptr);
+  void StopCheckpointThread();
+
+  inline lsn_t GetLastCheckpointLSN() { return last_checkpoint_lsn_; }
+
+private:
+  // point the header page at a checkpoint and write it back
+  bool RecordCheckpoint(lsn_t checkpoint_lsn, log_offset_t checkpoint_offset,
+                        log_offset_t redo_offset);
+
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  RootCatalog *root_catalog_;
+  // one checkpoint at a time
+  std::mutex checkpoint_latch_;
+  std::atomic<lsn_t> last_checkpoint_lsn_;
+  // checkpoint thread
+  bool running_;
+  std::thread *checkpoint_thread_;
+  std::mutex thread_latch_;
+  std::condition_variable thread_cv_;
+  // instead of the thread
+  TaskScheduler *scheduler_;
+  task_id_t checkpoint_task_;
+};
+
+} // namespace cmudb
@@ -3,66 +3,203 @@
  * log manager maintain a separate thread that is awaken when the log buffer is
  * full or time out(every X second) to write log buffer's content into disk log
  * file.
+ *
+ * Commits are grouped: a committer appends its COMMIT record and sleeps until
+ * the log is durable up to it. The flush thread waits up to
+ * LOG_GROUP_COMMIT_WINDOW for more committers to join, then one write covers
+ * every waiter.
+ *
+ * Appending takes no latch. One atomic word holds the next LSN, the active
+ * segment and its fill offset, a compare-and-swap on it reserves the LSN and
+ * the space of a record at once, and appenders copy their records in
+ * parallel. The log buffer is a ring of LOG_BUFFER_SEGMENTS segments. A
+ * full segment is sealed by switching the word over to the next one, so
+ * appending goes on while sealed segments wait to be written. The flush
+ * writes sealed segments oldest first, each once every reservation made in
+ * it is complete, i.e. the completed contiguous prefix of the log. Only an
+ * appender that finds no room takes latch_, to seal the segment or, when
+ * every other segment is still waiting to be written, to wait for the flush.
+ *
+ * Optionally the flush compresses each segment and writes it as one frame
+ * tagged with its LSN range (see LogFrameHeader), trading flush thread CPU
+ * for log bandwidth. Recovery reads framed and bare records alike.
+ *
+ * Appends, flushes and commit waits are counted, see LogStats.
  */
 
 #pragma once
 #include <algorithm>
+#include <chrono>
 #include <condition_variable>
 #include <future>
+#include <map>
 #include <mutex>
+#include <thread>
+#include <vector>
 
+#include "common/exception.h"
+#include "common/memory_tracker.h"
 #include "disk/disk_manager.h"
 #include "logging/log_record.h"
+#include "logging/log_stats.h"
 
 namespace cmudb {
 
 class LogManager {
 public:
   LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN),
-        disk_manager_(disk_manager) {
-    // TODO: you may intialize your own defined memeber variables here
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-    flush_buffer_ = new char[LOG_BUFFER_SIZE];
+      : reservation_(0), persistent_lsn_(INVALID_LSN), compress_(false),
+        running_(false),
+        flushing_(false), flush_requested_(false), buffer_full_(false),
+        flush_thread_(nullptr), disk_manager_(disk_manager), head_(0),
+        log_offset_(disk_manager->GetLogSize()) {
+    if (!MemoryTracker::Instance().Reserve(
+            MemoryConsumer::LOG_BUFFER, LOG_BUFFER_SEGMENTS * LOG_BUFFER_SIZE)) {
+      throw Exception(EXCEPTION_TYPE_OUT_OF_MEMORY,
+                      "log buffers over the memory budget");
+    }
+    for (int i = 0; i < LOG_BUFFER_SEGMENTS; ++i) {
+      segments_[i].data_ = new char[LOG_BUFFER_SIZE];
+      segments_[i].completed_ = 0;
+      segments_[i].size_ = 0;
+      segments_[i].last_lsn_ = INVALID_LSN;
+    }
   }
 
   ~LogManager() {
-    delete[] log_buffer_;
-    delete[] flush_buffer_;
-    log_buffer_ = nullptr;
-    flush_buffer_ = nullptr;
+    StopFlushThread();
+    for (int i = 0; i < LOG_BUFFER_SEGMENTS; ++i) {
+      delete[] segments_[i].data_;
+      segments_[i].data_ = nullptr;
+    }
+    MemoryTracker::Instance().Release(MemoryConsumer::LOG_BUFFER,
+                                      LOG_BUFFER_SEGMENTS * LOG_BUFFER_SIZE);
   }
-  // spawn a separate thread to wake up periodically to flush
-  void RunFlushThread();
+  // spawn a separate thread to wake up periodically to flush. Given a NUMA
+  // node, the thread runs there and the log buffer is moved there
+  void RunFlushThread(int numa_node = -1);
   void StopFlushThread();
 
   // append a log record into log buffer
   lsn_t AppendLogRecord(LogRecord &log_record);
 
+  // block until every record up to and including lsn is on disk. Waiters
+  // are served together by the next flush. Without a flush thread the
+  // caller flushes itself
+  void WaitForDurable(lsn_t lsn);
+
+  // write-ahead rule, before a page image is written back: wait for the log
+  // up to the LSN of page_id, see Page::GetLSN
+  void WaitForPage(page_id_t page_id, const char *page_data);
+
+  // the LSN the next appended record gets
+  inline lsn_t GetNextLSN() const { return LsnOf(reservation_); }
+
+  // log file offset of the write holding lsn, or of one before it, for
+  // recovery to start reading at. Records not written yet start at the
+  // offset of the last write or later
+  log_offset_t GetLogOffset(lsn_t lsn);
+  // once a checkpoint lets recovery start at lsn: forget the offsets of
+  // writes entirely below it and delete the log files entirely below it
+  void TruncateLog(lsn_t lsn);
+
   // get/set helper functions
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
-  inline char *GetLogBuffer() { return log_buffer_; }
+  // compress the log at flush time, applies from the next flush on
+  inline void SetCompression(bool compress) { compress_ = compress; }
+  inline bool UsesCompression() const { return compress_; }
+  inline LogStats GetStats() const { return counters_.Snapshot(); }
+  inline void ResetStats() { counters_.Reset(); }
+  inline char *GetLogBuffer() {
+    return segments_[SegmentOf(reservation_)].data_;
+  }
 
 private:
-  // TODO: you may add your own member variables
-  // also remember to change constructor accordingly
+  // one buffer of the ring
+  struct LogSegment {
+    char *data_;
+    // bytes of reserved records already copied in
+    std::atomic<size_t> completed_;
+    // set when sealed: bytes reserved in it and the last LSN among them
+    size_t size_;
+    lsn_t last_lsn_;
+    // the frame written for it when compressing
+    std::vector<char> frame_;
+  };
 
-  // atomic counter, record the next log sequence number
-  std::atomic<lsn_t> next_lsn_;
+  // reservation_ layout: next LSN (32) | active segment (8) | offset (24)
+  static inline lsn_t LsnOf(uint64_t word) {
+    return static_cast<lsn_t>(word >> 32);
+  }
+  static inline int SegmentOf(uint64_t word) { return (word >> 24) & 0xff; }
+  static inline size_t OffsetOf(uint64_t word) { return word & 0xffffff; }
+  static inline uint64_t Reservation(lsn_t lsn, int segment, size_t offset) {
+    return static_cast<uint64_t>(lsn) << 32 |
+           static_cast<uint64_t>(segment) << 24 | offset;
+  }
+  static inline int NextSegment(int segment) {
+    return (segment + 1) % LOG_BUFFER_SEGMENTS;
+  }
+
+  static inline uint64_t
+  NanosSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  }
+
+  static void SerializeLogRecord(const LogRecord &log_record, char *pos);
+  // slow path of AppendLogRecord, the active segment has no room for size
+  void WaitForRoom(uint64_t word, size_t size);
+
+  // latch_ held. Make the next segment the active one, false if the active
+  // segment is empty or the next one still waits to be written
+  bool SealSegment();
+
+  void FlushThread();
+  // seal the active segment and write out every sealed one. latch_ is held
+  // by lock on entry and on return, but not during the writes
+  void FlushBuffer(std::unique_lock<std::mutex> &lock);
+  // write the size bytes of segment, the records first_lsn on, as a frame.
+  // Returns the bytes written, -1 on an I/O error
+  int WriteFrame(LogSegment &segment, size_t size, lsn_t first_lsn);
+
+  // next log sequence number, active segment and its reserved bytes
+  std::atomic<uint64_t> reservation_;
   // log records before & include persistent_lsn_ have been written to disk
   std::atomic<lsn_t> persistent_lsn_;
-  // log buffer related
-  char *log_buffer_;
-  char *flush_buffer_;
+  std::atomic<bool> compress_;
   // latch to protect shared member variables
   std::mutex latch_;
+  bool running_;         // the flush thread is up
+  bool flushing_;        // sealed segments are being written
+  bool flush_requested_; // a committer waits for the next flush
+  bool buffer_full_;     // a segment was sealed, or an appender waits
   // flush thread
   std::thread *flush_thread_;
   // for notifying flush thread
   std::condition_variable cv_;
+  // the active segment was sealed, or a sealed one was written
+  std::condition_variable append_cv_;
+  // persistent_lsn_ advanced, or flushing_ is over
+  std::condition_variable durable_cv_;
   // disk manager
   DiskManager *disk_manager_;
+  // log buffer related: the oldest segment not yet written. Segments from
+  // head_ up to the active one are sealed, latch_ protects head_
+  LogSegment segments_[LOG_BUFFER_SEGMENTS];
+  int head_;
+  // first LSN -> file offset of every write, and where the next one goes,
+  // protected by latch_
+  std::map<lsn_t, log_offset_t> write_offsets_;
+  log_offset_t log_offset_;
+  LogCounters counters_;
 };
 
+static_assert(LOG_BUFFER_SEGMENTS >= 2 && LOG_BUFFER_SEGMENTS <= 256,
+              "the segment index of a reservation is 8 bits");
+static_assert(LOG_BUFFER_SIZE < (1 << 24),
+              "the offset of a reservation is 24 bits");
+
 } // namespace cmudb
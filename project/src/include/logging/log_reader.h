@@ -0,0 +1,142 @@
+/**
+ * log_reader.h
+ * Streaming reader of the log, for recovery and for anything else reading
+ * the log front to back, e.g. shipping it to a replica.
+ *
+ * The log is read in chunks of chunk_size bytes into two buffers: while the
+ * records of one are decoded, the next chunk is read into the other one in
+ * the background. A record or frame cut by the end of a chunk is moved in
+ * front of the next chunk, so it is decoded in one piece. Frames are
+ * unpacked on the way, see LogFrameHeader.
+ *
+ *   LogReader reader(disk_manager, offset);
+ *   for (auto it = reader.begin(); it != reader.end(); ++it) {
+ *     LogRecord &log_record = *it;
+ *     ... it.GetPosition() is where it lies, for LogReader::Read ...
+ *   }
+ */
+
+#pragma once
+#include <future>
+#include <vector>
+
+#include "disk/disk_manager.h"
+#include "logging/log_record.h"
+
+namespace cmudb {
+
+// where a record lies: its log offset, or the log offset of its frame and
+// its offset among the frame's records (-1 if not framed)
+struct LogPosition {
+  log_offset_t offset_;
+  int frame_pos_;
+};
+
+class LogReader {
+public:
+  // chunk_size must hold the largest record or frame, MAX_ENTRY_SIZE
+  LogReader(DiskManager *disk_manager, log_offset_t offset = 0,
+            size_t chunk_size = LOG_READ_AHEAD_SIZE);
+  ~LogReader();
+
+  // the next record and where it lies, false at the end of the log, i.e.
+  // at zeros or a partial record
+  bool Next(LogRecord &log_record, LogPosition &position);
+
+  // go on reading at offset, which must be where a record or frame starts
+  void Seek(log_offset_t offset);
+
+  // the record at position, e.g. for undo. Served from the chunk at hand if
+  // it lies in it, otherwise the reader seeks there. Next goes on after the
+  // record, or after its frame
+  bool Read(LogPosition position, LogRecord &log_record);
+
+  // the record at data, at most end - data bytes long. False if it is
+  // incomplete or no record at all
+  static bool DeserializeLogRecord(const char *data, const char *end,
+                                   LogRecord &log_record);
+
+  // yields the records from the reader's position on
+  class Iterator {
+  public:
+    explicit Iterator(LogReader *reader = nullptr) : reader_(reader) {
+      ++*this;
+    }
+    inline LogRecord &operator*() { return log_record_; }
+    inline LogRecord *operator->() { return &log_record_; }
+    inline Iterator &operator++() {
+      if (reader_ != nullptr && !reader_->Next(log_record_, position_)) {
+        reader_ = nullptr;
+      }
+      return *this;
+    }
+    inline bool operator==(const Iterator &other) const {
+      return reader_ == other.reader_ &&
+             (reader_ == nullptr ||
+              (position_.offset_ == other.position_.offset_ &&
+               position_.frame_pos_ == other.position_.frame_pos_));
+    }
+    inline bool operator!=(const Iterator &other) const {
+      return !(*this == other);
+    }
+    inline LogPosition GetPosition() const { return position_; }
+
+  private:
+    LogReader *reader_; // nullptr at the end
+    LogRecord log_record_;
+    LogPosition position_{-1, -1};
+  };
+
+  inline Iterator begin() { return Iterator(this); }
+  inline Iterator end() { return Iterator(); }
+
+  // a record or a whole frame with its header takes at most this many bytes
+  static const int MAX_ENTRY_SIZE = LOG_BUFFER_SIZE + sizeof(LogFrameHeader);
+
+private:
+  // bytes of the record or frame at data, 0 if there is none, -1 if fewer
+  // than available bytes do not tell
+  static int EntrySize(const char *data, size_t available);
+  // the ENDCHECKPOINT, BTREESTRUCTURE and INSERTBATCH payloads between pos
+  // and end
+  static bool DeserializeCheckpoint(const char *pos, const char *end,
+                                    LogRecord &log_record);
+  static bool DeserializeStructure(const char *pos, const char *end,
+                                   LogRecord &log_record);
+  static bool DeserializeBatch(const char *pos, const char *end,
+                               LogRecord &log_record);
+  // unpack the frame of size bytes at data, at log offset offset
+  bool ReadFrame(const char *data, int size, log_offset_t offset);
+  // switch to the chunk read in the background, keeping what is left of the
+  // current one in front of it. False if the log has nothing more
+  bool NextChunk();
+  // read the chunk at read_offset_ into the buffer not being decoded
+  void StartRead();
+  // bytes of the buffers, for the memory tracker
+  size_t Footprint() const;
+
+  DiskManager *disk_manager_;
+  size_t chunk_size_;
+  // each is MAX_ENTRY_SIZE bytes for the rest of the previous chunk, then
+  // chunk_size_ bytes for a chunk
+  std::vector<char> buffers_[2];
+  int current_;
+  // bytes of buffers_[current_] not yet decoded, at log offset data_offset_,
+  // and the first valid byte at log offset base_offset_
+  const char *data_;
+  const char *end_;
+  const char *base_;
+  log_offset_t data_offset_;
+  log_offset_t base_offset_;
+  // the chunk in flight: its log offset and, once read, its valid bytes
+  log_offset_t read_offset_;
+  std::future<int> pending_;
+  // records of the frame at log offset frame_offset_ (-1: none), the next
+  // one at frame_pos_
+  std::vector<char> frame_buffer_;
+  log_offset_t frame_offset_;
+  int frame_pos_;
+  int frame_size_;
+};
+
+} // namespace cmudb
@@ -14,18 +14,61 @@
  *-------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
  *-------------------------------------------------------------
+ * For batch insert type log record, tuples in the slots from tuple_rid on
+ *-------------------------------------------------------------
+ * | HEADER | tuple_rid | tuple_count | tuple_size | tuple_data | ... |
+ *-------------------------------------------------------------
  * For update type log record
  *------------------------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size |
  * | new_tuple_data |
  *------------------------------------------------------------------------------
- * For new page type log record
+ * For delta encoded update type log record, only the changed byte ranges
+ *------------------------------------------------------------------------------
+ * | HEADER | tuple_rid | old_size | new_size | range_count | range_1 | ... |
+ *------------------------------------------------------------------------------
+ * where every range is
+ *------------------------------------------------------------------------------
+ * | offset | old_length | new_length | old_data | new_data |
+ *------------------------------------------------------------------------------
+ * For new page type log record, the column widths for a PAX page only
  *-------------------------------------------------------------
- * | HEADER | prev_page_id |
+ * | HEADER | prev_page_id | page_id | width_count | width | ... |
  *-------------------------------------------------------------
+ * For end checkpoint type log record, prevLSN is the LSN of its begin
+ * checkpoint record, the active transactions with their last LSN and the
+ * dirty pages with their recLSN
+ *------------------------------------------------------------------------------
+ * | HEADER | txn_count | txn_id | last_LSN | ... | page_count | page_id |
+ * | rec_LSN | ... |
+ *------------------------------------------------------------------------------
+ * For B+ tree entry insert and delete type log record, on a leaf page: the
+ * slot, the offset of the entry array in the page and the entry
+ *------------------------------------------------------------------------------
+ * | HEADER | page_id | slot | array_offset | entry_size | entry_data |
+ *------------------------------------------------------------------------------
+ * For B+ tree structure modification type log record (split, merge,
+ * redistribution, root change), the bytes it changed on every page, and the
+ * new root of the index if it changed (name_size 0 if not)
+ *------------------------------------------------------------------------------
+ * | HEADER | write_count | write_1 | ... | name_size | name | root_page_id |
+ *------------------------------------------------------------------------------
+ * where every write is, format 1 if the page is new and zeroed first
+ *------------------------------------------------------------------------------
+ * | page_id | format | offset | size | data |
+ *------------------------------------------------------------------------------
+ *
+ * With LogManager::SetCompression, every flush writes one frame in place of
+ * the bare records, see LogFrameHeader
+ *------------------------------------------------------------------------------
+ * | MAGIC | first_LSN | last_LSN | raw_size | stored_size | records |
+ *------------------------------------------------------------------------------
  */
 #pragma once
 #include <cassert>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "table/tuple.h"
@@ -44,10 +87,45 @@ enum class LogRecordType {
   ABORT,
   // when create a new page in heap table
   NEWPAGE,
+  // UPDATE that carries the changed byte ranges only
+  UPDATEDELTA,
+  // fuzzy checkpoint, see CheckpointManager
+  BEGINCHECKPOINT,
+  ENDCHECKPOINT,
+  // B+ tree pages, redo only: entry insert and delete on a leaf, and
+  // everything else a tree operation changes as one record
+  BTREEINSERT,
+  BTREEDELETE,
+  BTREESTRUCTURE,
+  // INSERT of many tuples into one page, see TableHeap::AppendBatch
+  INSERTBATCH,
+};
+
+// bytes written to one page by a B+ tree structure modification
+struct PageWrite {
+  page_id_t page_id_;
+  bool format_; // the page is new, zero it first
+  int32_t offset_;
+  std::vector<char> data_;
+};
+
+// header of a frame of log records. The records are compressed with
+// CompressedPageCache::Compress, or stored as they are if that does not
+// shrink them (stored_size_ == raw_size_)
+struct LogFrameHeader {
+  // where a bare record starts with its size, which is never negative
+  static const int32_t MAGIC = -0x4c5a4652;
+
+  int32_t magic_;
+  lsn_t first_lsn_; // LSN range of the records in the frame
+  lsn_t last_lsn_;
+  int32_t raw_size_;    // bytes of records
+  int32_t stored_size_; // bytes following the header
 };
 
 class LogRecord {
   friend class LogManager;
+  friend class LogReader;
   friend class LogRecovery;
 
 public:
@@ -79,26 +157,101 @@ public:
     size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
   }
 
-  // constructor for UPDATE type
+  // constructor for INSERTBATCH type, tuples go to the slots from first_rid
+  // on
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, const RID &first_rid,
+            std::vector<Tuple> tuples)
+      : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(prev_lsn),
+        log_record_type_(LogRecordType::INSERTBATCH), insert_rid_(first_rid),
+        batch_tuples_(std::move(tuples)) {
+    size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t);
+    for (auto &tuple : batch_tuples_) {
+      size_ += sizeof(int32_t) + tuple.GetLength();
+    }
+  }
+
+  // constructor for UPDATE/UPDATEDELTA type. An UPDATEDELTA record falls
+  // back to a full UPDATE if the delta would not be smaller
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
             const RID &update_rid, const Tuple &old_tuple,
             const Tuple &new_tuple)
       : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(prev_lsn),
-        log_record_type_(log_record_type), update_rid_(update_rid),
-        old_tuple_(old_tuple), new_tuple_(new_tuple) {
+        log_record_type_(log_record_type), update_rid_(update_rid) {
+    assert(log_record_type == LogRecordType::UPDATE ||
+           log_record_type == LogRecordType::UPDATEDELTA);
     // calculate log record size
     size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() +
             new_tuple.GetLength() + 2 * sizeof(int32_t);
+    if (log_record_type == LogRecordType::UPDATEDELTA) {
+      EncodeDelta(old_tuple, new_tuple);
+      int32_t delta_size = HEADER_SIZE + sizeof(RID) + delta_.size();
+      if (delta_size < size_) {
+        size_ = delta_size;
+        return;
+      }
+      delta_.clear();
+      log_record_type_ = LogRecordType::UPDATE;
+    }
+    old_tuple_ = old_tuple;
+    new_tuple_ = new_tuple;
   }
 
   // constructor for NEWPAGE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
-            page_id_t page_id)
+            page_id_t prev_page_id, page_id_t page_id = INVALID_PAGE_ID,
+            const std::vector<int32_t> &column_widths =
+                std::vector<int32_t>())
       : size_(HEADER_SIZE), lsn_(INVALID_LSN), txn_id_(txn_id),
         prev_lsn_(prev_lsn), log_record_type_(log_record_type),
-        prev_page_id_(page_id) {
+        prev_page_id_(prev_page_id), page_id_(page_id),
+        column_widths_(column_widths) {
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(page_id_t);
+    size_ = HEADER_SIZE + 2 * sizeof(page_id_t);
+    if (!column_widths_.empty()) {
+      size_ += sizeof(int32_t) * (1 + column_widths_.size());
+    }
+  }
+
+  // constructor for ENDCHECKPOINT type, BEGINCHECKPOINT is a transaction
+  // type record of INVALID_TXN_ID
+  LogRecord(lsn_t begin_lsn,
+            const std::vector<std::pair<txn_id_t, lsn_t>> &txns,
+            const std::vector<std::pair<page_id_t, lsn_t>> &pages)
+      : lsn_(INVALID_LSN), txn_id_(INVALID_TXN_ID), prev_lsn_(begin_lsn),
+        log_record_type_(LogRecordType::ENDCHECKPOINT),
+        checkpoint_txns_(txns), checkpoint_pages_(pages) {
+    size_ = HEADER_SIZE + 2 * sizeof(int32_t) +
+            txns.size() * (sizeof(txn_id_t) + sizeof(lsn_t)) +
+            pages.size() * (sizeof(page_id_t) + sizeof(lsn_t));
+  }
+
+  // constructor for BTREEINSERT/BTREEDELETE type, entry is the slot's
+  // content after the insert or before the delete
+  LogRecord(txn_id_t txn_id, LogRecordType log_record_type,
+            page_id_t page_id, int32_t slot, int32_t array_offset,
+            const char *entry, int32_t entry_size)
+      : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(INVALID_LSN),
+        log_record_type_(log_record_type), page_id_(page_id), slot_(slot),
+        array_offset_(array_offset), entry_(entry, entry + entry_size) {
+    assert(log_record_type == LogRecordType::BTREEINSERT ||
+           log_record_type == LogRecordType::BTREEDELETE);
+    size_ = HEADER_SIZE + sizeof(page_id_t) + 3 * sizeof(int32_t) +
+            entry_size;
+  }
+
+  // constructor for BTREESTRUCTURE type, index_name is empty unless the
+  // root changed
+  LogRecord(txn_id_t txn_id, std::vector<PageWrite> writes,
+            const std::string &index_name, page_id_t root_page_id)
+      : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(INVALID_LSN),
+        log_record_type_(LogRecordType::BTREESTRUCTURE),
+        page_writes_(std::move(writes)), index_name_(index_name),
+        root_page_id_(root_page_id) {
+    size_ = HEADER_SIZE + 2 * sizeof(int32_t) + index_name.size() +
+            sizeof(page_id_t);
+    for (auto &write : page_writes_) {
+      size_ += sizeof(page_id_t) + 3 * sizeof(int32_t) + write.data_.size();
+    }
   }
 
   ~LogRecord() {}
@@ -109,8 +262,44 @@ public:
 
   inline RID &GetInsertRID() { return insert_rid_; }
 
+  // INSERTBATCH: the tuples, in the slots from GetInsertRID() on
+  inline const std::vector<Tuple> &GetBatchTuples() const {
+    return batch_tuples_;
+  }
+
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline page_id_t GetNewPageId() { return page_id_; }
+
+  inline const std::vector<int32_t> &GetColumnWidths() const {
+    return column_widths_;
+  }
+
+  inline RID &GetUpdateRID() { return update_rid_; }
+
+  // ENDCHECKPOINT: active transaction table and dirty page table
+  inline const std::vector<std::pair<txn_id_t, lsn_t>> &
+  GetCheckpointTxns() const {
+    return checkpoint_txns_;
+  }
+  inline const std::vector<std::pair<page_id_t, lsn_t>> &
+  GetCheckpointPages() const {
+    return checkpoint_pages_;
+  }
+
+  // BTREESTRUCTURE: the pages written, and the new root if index_name is
+  // not empty
+  inline const std::vector<PageWrite> &GetPageWrites() const {
+    return page_writes_;
+  }
+  inline const std::string &GetIndexName() const { return index_name_; }
+  inline page_id_t GetRootPageId() const { return root_page_id_; }
+
+  // UPDATEDELTA: rebuild the new tuple from the old one (redo) or the old
+  // tuple from the new one (undo). False if tuple is not the image the
+  // delta was taken against
+  bool ApplyDelta(const Tuple &tuple, Tuple &result, bool redo) const;
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -156,9 +345,41 @@ private:
   Tuple old_tuple_;
   Tuple new_tuple_;
 
-  // case4: for new page opeartion
+  // case4: for new page opeartion, page_id_ is the page of a B+ tree
+  // entry record too
   page_id_t prev_page_id_ = INVALID_PAGE_ID;
+  page_id_t page_id_ = INVALID_PAGE_ID;
+  // layout of a new PAX table page, see TablePage::Init
+  std::vector<int32_t> column_widths_;
+
+  // case5: for delta encoded update opeartion, everything after the rid
+  std::vector<char> delta_;
+
+  // case6: for end checkpoint
+  std::vector<std::pair<txn_id_t, lsn_t>> checkpoint_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> checkpoint_pages_;
+
+  // case7: for B+ tree entry insert and delete
+  int32_t slot_ = 0;
+  int32_t array_offset_ = 0;
+  std::vector<char> entry_;
+
+  // case8: for B+ tree structure modification
+  std::vector<PageWrite> page_writes_;
+  std::string index_name_;
+  page_id_t root_page_id_ = INVALID_PAGE_ID;
+
+  // case9: for batch insert, the rid of the first tuple is insert_rid_
+  std::vector<Tuple> batch_tuples_;
+
   const static int HEADER_SIZE = 20;
+  // bytes a range costs besides its data. Changes closer than this share
+  // one range
+  const static int DELTA_RANGE_HEADER = 12;
+
+  void EncodeDelta(const Tuple &old_tuple, const Tuple &new_tuple);
+  void AppendRange(int32_t offset, int32_t old_length, int32_t new_length,
+                   const char *old_data, const char *new_data);
 }; // namespace cmudb
 
 } // namespace cmudb
@@ -1,50 +1,107 @@
 /**
  * recovery_manager.h
  * Read log file from disk, redo and undo
+ *
+ * With more than one worker, redo decodes the log on the calling thread and
+ * replays it on the workers, partitioned by page id. Undo rolls the loser
+ * transactions back in parallel, each one on a single worker. B+ tree
+ * records are redone like table page records and never undone: index
+ * entries are not transactional. Root swaps set the header page again, or
+ * the catalog if given, see RootCatalog.
  */
 
 #pragma once
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "catalog/catalog.h"
 #include "concurrency/lock_manager.h"
-#include "logging/log_record.h"
+#include "logging/log_reader.h"
 
 namespace cmudb {
 
 class LogRecovery {
 public:
   LogRecovery(DiskManager *disk_manager,
-                    BufferPoolManager *buffer_pool_manager)
+                    BufferPoolManager *buffer_pool_manager,
+                    size_t num_workers = 1, Catalog *catalog = nullptr)
       : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager),
-        offset_(0) {
-    // global transaction through recovery phase
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-  }
-
-  ~LogRecovery() {
-    delete[] log_buffer_;
-    log_buffer_ = nullptr;
-  }
+        catalog_(catalog), checkpoint_lsn_(INVALID_LSN),
+        num_workers_(num_workers) {}
 
   void Redo();
   void Undo();
-  bool DeserializeLogRecord(const char *data, LogRecord &log_record);
+  // checkpoint redo started from, INVALID_LSN if it read the whole log
+  inline lsn_t GetCheckpointLSN() { return checkpoint_lsn_; }
 
 private:
-  // TODO: you can add whatever member variable here
-  // Don't forget to initialize newly added variable in constructor
+  // load the last checkpoint the header page points at, returns the offset
+  // redo starts at: the checkpoint's redo point, or without one the start
+  // of the oldest log file
+  log_offset_t ReadCheckpoint();
+  // tasks a worker may have queued before the reader waits for it
+  static const size_t RECOVERY_QUEUE_DEPTH = 1024;
+
+  struct RecoveryWorker {
+    std::thread thread_;
+    std::mutex latch_;
+    std::condition_variable cv_; // tasks_ or done_ changed
+    std::deque<std::function<void()>> tasks_;
+    bool done_;
+  };
+
+  // redo bookkeeping, then redo of one record, here or on a worker
+  void RedoRecord(LogRecord &log_record, LogPosition position);
+  // the page a record changes, INVALID_PAGE_ID for transaction records and
+  // for BTREESTRUCTURE, which changes many
+  static page_id_t GetPageId(const LogRecord &log_record);
+  // whether the change at lsn may be missing on the page after the
+  // checkpoint's dirty page table
+  bool NeedsRedo(page_id_t page_id, lsn_t lsn);
+  // run task here, or on the worker of page_id
+  void Dispatch(page_id_t page_id, std::function<void()> task);
+  // redo of a B+ tree structure modification, page by page, and of the
+  // writes of it at writes that go to one page
+  void RedoStructure(LogRecord &log_record);
+  void RedoPageWrites(const LogRecord &log_record,
+                      const std::vector<size_t> &writes);
+  // redo of BTREEINSERT/BTREEDELETE on the page at data
+  void RedoEntry(const LogRecord &log_record, char *data);
+  // redo of NEWPAGE on the previous page
+  void LinkPage(page_id_t prev_page_id, page_id_t page_id);
+
+  // no workers are started for num_workers_ <= 1, everything runs inline.
+  // StopWorkers returns once every submitted task is done
+  void StartWorkers();
+  void StopWorkers();
+  void Submit(size_t worker_id, std::function<void()> task);
+  void RunWorker(RecoveryWorker *worker);
+
+  // apply log_record to its page, unless the page already has it
+  void RedoLogRecord(LogRecord &log_record);
+  // roll log_record back, the page is known to have it after redo
+  void UndoLogRecord(LogRecord &log_record);
+
   DiskManager *disk_manager_;
   BufferPoolManager *buffer_pool_manager_;
+  Catalog *catalog_;
   // maintain active transactions and its corresponds latest lsn
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
   // mapping log sequence number to log file offset, for undo purpose
-  std::unordered_map<lsn_t, int> lsn_mapping_;
-  // log buffer related
-  int offset_;
-  char *log_buffer_;
+  std::unordered_map<lsn_t, LogPosition> lsn_mapping_;
+  // dirty page table of the checkpoint at checkpoint_lsn_: page id -> recLSN
+  lsn_t checkpoint_lsn_;
+  std::unordered_map<page_id_t, lsn_t> dirty_pages_;
+  size_t num_workers_;
+  std::vector<std::unique_ptr<RecoveryWorker>> workers_;
 };
 
 } // namespace cmudb
@@ -0,0 +1,87 @@
+/**
+ * log_stats.h
+ *
+ * Functionality: Counters of the log manager, to tell log contention from a
+ * slow device. Appenders, the flusher and committers bump them with relaxed
+ * atomic adds; a snapshot is a plain struct that can be scraped. The device
+ * side, the writes themselves, is counted by DiskManager, see LogWriteStats.
+ * Times are in nanoseconds.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "common/histogram.h"
+
+namespace cmudb {
+
+// point-in-time copy of the counters
+struct LogStats {
+  uint64_t appends = 0;        // records appended
+  uint64_t bytes_appended = 0; // their bytes
+  HistogramSnapshot append_ns; // AppendLogRecord, stalls included
+  uint64_t full_stalls = 0;    // appends that waited for a full buffer
+  uint64_t full_stall_ns = 0;  // time they waited
+  uint64_t flushes = 0;        // segments written
+  uint64_t bytes_flushed = 0;  // bytes written, frames as stored
+  HistogramSnapshot flush_bytes; // bytes of each write
+  HistogramSnapshot flush_ns;    // each write, compression included
+  uint64_t durable_waits = 0;    // WaitForDurable calls that had to wait
+  HistogramSnapshot durable_wait_ns; // how long they waited
+
+  // bytes per write, how well group commit batches
+  double BytesPerFlush() const {
+    return flushes == 0 ? 0 : static_cast<double>(bytes_flushed) / flushes;
+  }
+};
+
+class LogCounters {
+public:
+  static inline void Add(std::atomic<uint64_t> &counter, uint64_t value = 1) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  LogStats Snapshot() const {
+    LogStats stats;
+    stats.appends = appends_.load(std::memory_order_relaxed);
+    stats.bytes_appended = bytes_appended_.load(std::memory_order_relaxed);
+    stats.append_ns = append_ns_.Snapshot();
+    stats.full_stalls = full_stalls_.load(std::memory_order_relaxed);
+    stats.full_stall_ns = full_stall_ns_.load(std::memory_order_relaxed);
+    stats.flushes = flushes_.load(std::memory_order_relaxed);
+    stats.bytes_flushed = bytes_flushed_.load(std::memory_order_relaxed);
+    stats.flush_bytes = flush_bytes_.Snapshot();
+    stats.flush_ns = flush_ns_.Snapshot();
+    stats.durable_waits = durable_waits_.load(std::memory_order_relaxed);
+    stats.durable_wait_ns = durable_wait_ns_.Snapshot();
+    return stats;
+  }
+
+  void Reset() {
+    for (auto counter : {&appends_, &bytes_appended_, &full_stalls_,
+                         &full_stall_ns_, &flushes_, &bytes_flushed_,
+                         &durable_waits_}) {
+      counter->store(0, std::memory_order_relaxed);
+    }
+    for (auto histogram :
+         {&append_ns_, &flush_bytes_, &flush_ns_, &durable_wait_ns_}) {
+      histogram->Reset();
+    }
+  }
+
+  std::atomic<uint64_t> appends_{0};
+  std::atomic<uint64_t> bytes_appended_{0};
+  Histogram append_ns_;
+  std::atomic<uint64_t> full_stalls_{0};
+  std::atomic<uint64_t> full_stall_ns_{0};
+  std::atomic<uint64_t> flushes_{0};
+  std::atomic<uint64_t> bytes_flushed_{0};
+  Histogram flush_bytes_;
+  Histogram flush_ns_;
+  std::atomic<uint64_t> durable_waits_{0};
+  Histogram durable_wait_ns_;
+};
+
+} // namespace cmudb
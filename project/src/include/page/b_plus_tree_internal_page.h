@@ -8,10 +8,15 @@
  * the first key always remains invalid. That is to say, any search/lookup
  * should ignore the first key.
  *
+ * Children moved between pages keep their parent page id, the tree sets it,
+ * see BPlusTree::SetParent.
+ *
  * Internal page format (keys are stored in increasing order):
  *  --------------------------------------------------------------------------
  * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
  *  --------------------------------------------------------------------------
+ * With a prefix the keys share, it comes first and each key is only what
+ * follows it, as in the leaf page, see key_prefix.h.
  */
 
 #pragma once
@@ -19,6 +24,7 @@
 #include <queue>
 
 #include "page/b_plus_tree_page.h"
+#include "page/key_prefix.h"
 
 namespace cmudb {
 
@@ -29,21 +35,36 @@ INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeInternalPage : public BPlusTreePage {
 public:
   // must call initialize method after "create" a new node
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID);
+  // page_size: size of the buffer pool pages of the database
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID,
+            size_t page_size = PAGE_SIZE);
 
   KeyType KeyAt(int index) const;
   void SetKeyAt(int index, const KeyType &key);
   int ValueIndex(const ValueType &value) const;
   ValueType ValueAt(int index) const;
 
+  // index of the child whose subtree covers key
+  int ChildIndex(const KeyType &key, const KeyComparator &comparator) const;
   ValueType Lookup(const KeyType &key, const KeyComparator &comparator) const;
   void PopulateNewRoot(const ValueType &old_value, const KeyType &new_key,
                        const ValueType &new_value);
   int InsertNodeAfter(const ValueType &old_value, const KeyType &new_key,
                       const ValueType &new_value);
+  // put the pair after the last one, pages filled in key order. The key of
+  // the first pair is not used
+  void Append(const KeyType &key, const ValueType &value);
   void Remove(int index);
   ValueType RemoveAndReturnOnlyChild();
 
+  // keep the first prefix_size bytes of key once, all the keys of the page
+  // range start with them; the max size follows
+  void SetPrefix(const KeyType &key, int prefix_size, size_t page_size);
+  // the max size of this page sharing a prefix with other, as a merge or
+  // redistribution of the two leaves it
+  int SharedMaxSize(const BPlusTreeInternalPage *other,
+                    size_t page_size) const;
+
   void MoveHalfTo(BPlusTreeInternalPage *recipient,
                   BufferPoolManager *buffer_pool_manager);
   void MoveAllTo(BPlusTreeInternalPage *recipient, int index_in_parent,
@@ -59,9 +80,25 @@ public:
                        BufferPoolManager *buffer_pool_manager);
 
 private:
-  void CopyHalfFrom(MappingType *items, int size,
+  typedef KeyPrefix<KeyType, ValueType> Prefix;
+
+  inline char *Data() { return reinterpret_cast<char *>(array); }
+  inline const char *Data() const {
+    return reinterpret_cast<const char *>(array);
+  }
+  int GetEntrySize() const;
+  const char *EntryAt(int index) const;
+  char *EntryAt(int index);
+  void SetValueAt(int index, const ValueType &value);
+  // the bytes of the prefix, the rest of key zeroed
+  KeyType PrefixKey() const;
+  int SharedPrefixSize(const BPlusTreeInternalPage *other) const;
+  // shorten the prefix to the one shared with other, before entries of
+  // other come in
+  void ShareWith(const BPlusTreeInternalPage *other, size_t page_size);
+  void CopyHalfFrom(const BPlusTreeInternalPage *source, int index, int size,
                     BufferPoolManager *buffer_pool_manager);
-  void CopyAllFrom(MappingType *items, int size,
+  void CopyAllFrom(const BPlusTreeInternalPage *source,
                    BufferPoolManager *buffer_pool_manager);
   void CopyLastFrom(const MappingType &pair,
                     BufferPoolManager *buffer_pool_manager);
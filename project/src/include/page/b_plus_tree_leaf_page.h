@@ -3,26 +3,36 @@
  *
  * Store indexed key and record id(record id = page id combined with slot id,
  * see include/common/rid.h for detailed implementation) together within leaf
- * page. Only support unique key.
+ * page. Keys are unique; a non-unique tree keeps the record ids of a key
+ * with more than one in a posting list, see b_plus_tree_posting_page.h
 
  * Leaf page format (keys are stored in order):
  *  ----------------------------------------------------------------------
  * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
  *  ----------------------------------------------------------------------
+ * With a prefix the keys share, it comes first and each key is only what
+ * follows it, see key_prefix.h:
+ *  ----------------------------------------------------------------------
+ * | HEADER | PREFIX | REST(1) + RID(1) | ... | REST(n) + RID(n)
+ *  ----------------------------------------------------------------------
  *
- *  Header format (size in byte, 24 bytes in total):
+ *  Header format (size in byte, 40 bytes in total):
  *  ---------------------------------------------------------------------
- * | PageType (4) | CurrentSize (4) | MaxSize (4) | ParentPageId (4) |
+ * | BPlusTreePage header (32) | NextPageId (4) | PrevPageId (4) |
  *  ---------------------------------------------------------------------
- *  ------------------------------
- * | PageId (4) | NextPageId (4)
- *  ------------------------------
+ *
+ * The next page ids chain the leaves in key order and change with the page
+ * latched. The previous page id is only a hint for scans going down: the
+ * page left of a split or merge sets it on the page right of it, which it
+ * does not latch and the change is not logged. Whoever follows it checks
+ * that the page it names links to this one.
  */
 #pragma once
 #include <utility>
 #include <vector>
 
 #include "page/b_plus_tree_page.h"
+#include "page/key_prefix.h"
 
 namespace cmudb {
 #define B_PLUS_TREE_LEAF_PAGE_TYPE                                             \
@@ -34,13 +44,31 @@ class BPlusTreeLeafPage : public BPlusTreePage {
 public:
   // After creating a new leaf page from buffer pool, must call initialize
   // method to set default values
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID);
+  // page_size: size of the buffer pool pages of the database
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID,
+            size_t page_size = PAGE_SIZE);
   // helper methods
   page_id_t GetNextPageId() const;
   void SetNextPageId(page_id_t next_page_id);
+  page_id_t GetPrevPageId() const;
+  void SetPrevPageId(page_id_t prev_page_id);
+  // point the previous page id of the next page at this one
+  void LinkNext(BufferPoolManager *buffer_pool_manager);
   KeyType KeyAt(int index) const;
   int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
-  const MappingType &GetItem(int index);
+  MappingType GetItem(int index) const;
+  ValueType ValueAt(int index) const;
+  void SetValueAt(int index, const ValueType &value);
+  // the bytes of the entry at index as they lie in the page, for logging
+  const char *EntryAt(int index) const;
+  int GetEntrySize() const;
+
+  // keep the first prefix_size bytes of key once, all the keys of the page
+  // range start with them; the max size follows
+  void SetPrefix(const KeyType &key, int prefix_size, size_t page_size);
+  // the max size of this page sharing a prefix with other, as a merge or
+  // redistribution of the two leaves it
+  int SharedMaxSize(const BPlusTreeLeafPage *other, size_t page_size) const;
 
   // insert and delete methods
   int Insert(const KeyType &key, const ValueType &value,
@@ -53,7 +81,7 @@ public:
   void MoveHalfTo(BPlusTreeLeafPage *recipient,
                   BufferPoolManager *buffer_pool_manager /* Unused */);
   void MoveAllTo(BPlusTreeLeafPage *recipient, int /* Unused */,
-                 BufferPoolManager * /* Unused */);
+                 BufferPoolManager *buffer_pool_manager);
   void MoveFirstToEndOf(BPlusTreeLeafPage *recipient,
                         BufferPoolManager *buffer_pool_manager);
   void MoveLastToFrontOf(BPlusTreeLeafPage *recipient, int parentIndex,
@@ -62,12 +90,29 @@ public:
   std::string ToString(bool verbose = false) const;
 
 private:
-  void CopyHalfFrom(MappingType *items, int size);
-  void CopyAllFrom(MappingType *items, int size);
+  typedef KeyPrefix<KeyType, ValueType> Prefix;
+
+  inline char *Data() { return reinterpret_cast<char *>(array); }
+  inline const char *Data() const {
+    return reinterpret_cast<const char *>(array);
+  }
+  char *EntryAt(int index);
+  void SetEntry(int index, const KeyType &key, const ValueType &value);
+  // the bytes of the prefix, the rest of key zeroed
+  KeyType PrefixKey() const;
+  // the prefix this page shares with other
+  int SharedPrefixSize(const BPlusTreeLeafPage *other) const;
+  // shorten the prefix to the one shared with other, before entries of
+  // other come in
+  void ShareWith(const BPlusTreeLeafPage *other, size_t page_size);
+  void CopyHalfFrom(const BPlusTreeLeafPage *source, int index, int size,
+                    size_t page_size);
+  void CopyAllFrom(const BPlusTreeLeafPage *source, size_t page_size);
   void CopyLastFrom(const MappingType &item);
   void CopyFirstFrom(const MappingType &item, int parentIndex,
                      BufferPoolManager *buffer_pool_manager);
   page_id_t next_page_id_;
+  page_id_t prev_page_id_;
   MappingType array[0];
 };
 } // namespace cmudb
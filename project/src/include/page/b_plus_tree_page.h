@@ -6,12 +6,14 @@
  * It actually serves as a header part for each B+ tree page and
  * contains information shared by both leaf page and internal page.
  *
- * Header format (size in byte, 20 bytes in total):
+ * Header format (size in byte, 32 bytes in total):
  * ----------------------------------------------------------------------------
- * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
+ * | PageType (4) | LSN (4) | Checksum (4) | CurrentSize (4) | MaxSize (4) |
  * ----------------------------------------------------------------------------
- * | ParentPageId (4) | PageId(4) |
+ * | ParentPageId (4) | PageId(4) | PrefixSize (4) |
  * ----------------------------------------------------------------------------
+ * Checksum is reserved for the disk manager, see PAGE_CHECKSUM_OFFSET. The
+ * prefix size is that of the keys of the page, see key_prefix.h
  */
 
 #pragma once
@@ -57,14 +59,27 @@ public:
 
   void SetLSN(lsn_t lsn = INVALID_LSN);
 
+  // bytes at the start of every key kept once for the page, 0 for none
+  int GetPrefixSize() const;
+
+protected:
+  // only with the entries laid out for it, see key_prefix.h
+  void SetPrefixSize(int prefix_size);
+
+public:
+  // where the parent page id lies in the page, for logging
+  static const int PARENT_PAGE_ID_OFFSET = 20;
+
 private:
   // member variable, attributes that both internal and leaf page share
   IndexPageType page_type_;
   lsn_t lsn_;
+  uint32_t checksum_; // stamped and verified by DiskManager only
   int size_;
   int max_size_;
   page_id_t parent_page_id_;
   page_id_t page_id_;
+  int prefix_size_;
 };
 
 } // namespace cmudb
@@ -0,0 +1,67 @@
+/**
+ * b_plus_tree_posting_page.h
+ *
+ * Posting list page of a non-unique B+ tree: the record ids of one key, in
+ * order. A key with more than one record id has, in place of its record id
+ * in the leaf, a reference to the first page of its list, see ListRid; the
+ * pages of a list chain in order of their record ids.
+ *
+ * Format (size in byte):
+ *  ---------------------------------------------------------------------
+ * | PageId (4) | LSN (4) | Checksum (4) | CurrentSize (4) | MaxSize (4) |
+ *  ---------------------------------------------------------------------
+ * | NextPageId (4) | RID(1) | RID(2) | ... | RID(n) |
+ *  ---------------------------------------------------------------------
+ */
+#pragma once
+
+#include "common/config.h"
+#include "common/rid.h"
+
+namespace cmudb {
+
+class BPlusTreePostingPage {
+public:
+  // After creating a new posting page from buffer pool, must call initialize
+  // method to set default values
+  void Init(page_id_t page_id, size_t page_size = PAGE_SIZE);
+
+  page_id_t GetPageId() const { return page_id_; }
+  int GetSize() const { return size_; }
+  int GetMaxSize() const { return max_size_; }
+  bool IsFull() const { return size_ >= max_size_; }
+  page_id_t GetNextPageId() const { return next_page_id_; }
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+  const RID &RidAt(int index) const { return array_[index]; }
+  // position of the first record id not below rid
+  int RidIndex(const RID &rid) const;
+  // false if rid is there already; the caller makes room first
+  bool Insert(const RID &rid);
+  bool Remove(const RID &rid);
+  // split support: the upper half goes to the new page after this one
+  void MoveHalfTo(BPlusTreePostingPage *recipient);
+
+  // the order of record ids in a list
+  static bool Less(const RID &lhs, const RID &rhs) {
+    return lhs.GetPageId() < rhs.GetPageId() ||
+           (lhs.GetPageId() == rhs.GetPageId() &&
+            lhs.GetSlotNum() < rhs.GetSlotNum());
+  }
+  // the leaf value standing for the list starting at page_id. Slots of real
+  // record ids are not negative
+  static RID ListRid(page_id_t page_id) { return RID(page_id, LIST_SLOT); }
+  static bool IsList(const RID &rid) { return rid.GetSlotNum() == LIST_SLOT; }
+
+private:
+  static const int LIST_SLOT = -2;
+
+  page_id_t page_id_;
+  lsn_t lsn_;
+  uint32_t checksum_; // stamped and verified by DiskManager only
+  int size_;
+  int max_size_;
+  page_id_t next_page_id_;
+  RID array_[0];
+};
+} // namespace cmudb
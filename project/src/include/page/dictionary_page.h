@@ -0,0 +1,97 @@
+/**
+ * dictionary_page.h
+ *
+ * A page of the chain a table dictionary keeps its strings on, see
+ * Dictionary. Entries are only ever appended, the code of a string is how
+ * many of its column came before it in the chain.
+ *
+ * Format (size in byte):
+ *  ------------------------------------------------------------------
+ * | PageId (4) | LSN (4) | Checksum (4) | NextPageId (4) | Used (4) |
+ *  ------------------------------------------------------------------
+ * | ColumnId (2) | Length (2) | Data (Length) | ColumnId (2) | ... |
+ *  ------------------------------------------------------------------
+ * Used counts the entry bytes. Checksum is reserved for the disk manager,
+ * see PAGE_CHECKSUM_OFFSET
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "page/page.h"
+
+namespace cmudb {
+
+class DictionaryPage : public Page {
+public:
+  inline void Init(page_id_t page_id) {
+    memcpy(GetData(), &page_id, 4);
+    SetLSN(INVALID_LSN);
+    SetNextPageId(INVALID_PAGE_ID);
+    SetUsed(0);
+  }
+
+  inline page_id_t GetNextPageId() {
+    return *reinterpret_cast<page_id_t *>(GetData() + NEXT_PAGE_ID_OFFSET);
+  }
+  inline void SetNextPageId(page_id_t next_page_id) {
+    memcpy(GetData() + NEXT_PAGE_ID_OFFSET, &next_page_id, 4);
+  }
+  inline int32_t GetUsed() {
+    return *reinterpret_cast<int32_t *>(GetData() + USED_OFFSET);
+  }
+
+  // append an entry of length bytes at data for column_id, false if the
+  // page of page_size has no room
+  inline bool Append(int column_id, const char *data, uint32_t length,
+                     size_t page_size) {
+    int32_t used = GetUsed();
+    if (ENTRIES_OFFSET + used + ENTRY_HEADER_SIZE +
+            static_cast<int32_t>(length) >
+        static_cast<int32_t>(page_size))
+      return false;
+    char *entry = GetData() + ENTRIES_OFFSET + used;
+    uint16_t fields[2] = {static_cast<uint16_t>(column_id),
+                          static_cast<uint16_t>(length)};
+    memcpy(entry, fields, ENTRY_HEADER_SIZE);
+    memcpy(entry + ENTRY_HEADER_SIZE, data, length);
+    SetUsed(used + ENTRY_HEADER_SIZE + static_cast<int32_t>(length));
+    return true;
+  }
+
+  // the entry at offset, from 0 on, and the offset of the next one; false
+  // past the last entry
+  inline bool ReadEntry(int32_t &offset, int &column_id, const char *&data,
+                        uint32_t &length) {
+    if (offset >= GetUsed())
+      return false;
+    const char *entry = GetData() + ENTRIES_OFFSET + offset;
+    uint16_t fields[2];
+    memcpy(fields, entry, ENTRY_HEADER_SIZE);
+    column_id = fields[0];
+    length = fields[1];
+    data = entry + ENTRY_HEADER_SIZE;
+    offset += ENTRY_HEADER_SIZE + static_cast<int32_t>(length);
+    return true;
+  }
+
+  // the longest string a page of page_size holds
+  static inline uint32_t Capacity(size_t page_size) {
+    return static_cast<uint32_t>(page_size) - ENTRIES_OFFSET -
+           ENTRY_HEADER_SIZE;
+  }
+
+private:
+  inline void SetUsed(int32_t used) {
+    memcpy(GetData() + USED_OFFSET, &used, 4);
+  }
+
+  static const int32_t NEXT_PAGE_ID_OFFSET = 12;
+  static const int32_t USED_OFFSET = 16;
+  static const int32_t ENTRIES_OFFSET = 20;
+  static const int32_t ENTRY_HEADER_SIZE = 4;
+};
+
+} // namespace cmudb
@@ -0,0 +1,61 @@
+/**
+ * hash_table_bucket_page.h
+ *
+ * Bucket of a disk-resident extendible hash index: an unordered array of
+ * key/value pairs, only unique keys. Which keys belong here is decided by
+ * the directory page, see hash_table_directory_page.h
+ *
+ * Format (size in byte):
+ *  ---------------------------------------------------------------------
+ * | PageId (4) | LSN (4) | Checksum (4) | CurrentSize (4) | MaxSize (4) |
+ *  ---------------------------------------------------------------------
+ * | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n) |
+ *  ---------------------------------------------------------------------
+ */
+#pragma once
+
+#include <utility>
+
+#include "page/b_plus_tree_page.h"
+
+namespace cmudb {
+#define HASH_TABLE_BUCKET_PAGE_TYPE                                            \
+  HashTableBucketPage<KeyType, ValueType, KeyComparator>
+
+INDEX_TEMPLATE_ARGUMENTS
+class HashTableBucketPage {
+public:
+  // After creating a new bucket page from buffer pool, must call initialize
+  // method to set default values
+  void Init(page_id_t page_id, size_t page_size = PAGE_SIZE);
+
+  page_id_t GetPageId() const { return page_id_; }
+  int GetSize() const { return size_; }
+  int GetMaxSize() const { return max_size_; }
+  bool IsFull() const { return size_ >= max_size_; }
+
+  bool Lookup(const KeyType &key, ValueType &value,
+              const KeyComparator &comparator) const;
+  // false if key is present already; the caller makes room first
+  bool Insert(const KeyType &key, const ValueType &value,
+              const KeyComparator &comparator);
+  bool Remove(const KeyType &key, const KeyComparator &comparator);
+
+  // split support: entries are read and kept or moved by position
+  const MappingType &GetItem(int index) const { return array_[index]; }
+  void SetItem(int index, const MappingType &item) { array_[index] = item; }
+  void Append(const MappingType &item) { array_[size_++] = item; }
+  void SetSize(int size) { size_ = size; }
+
+private:
+  // position of key, -1 if absent
+  int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
+
+  page_id_t page_id_;
+  lsn_t lsn_;
+  uint32_t checksum_; // stamped and verified by DiskManager only
+  int size_;
+  int max_size_;
+  MappingType array_[0];
+};
+} // namespace cmudb
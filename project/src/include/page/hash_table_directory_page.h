@@ -0,0 +1,67 @@
+/**
+ * hash_table_directory_page.h
+ *
+ * Directory of a disk-resident extendible hash index. Slot i holds the page
+ * id and local depth of the bucket for every key whose hash ends in the low
+ * GlobalDepth bits of i, so a lookup reads this page and one bucket page.
+ * The directory never outgrows its page: MaxDepth is the deepest directory
+ * that fits.
+ *
+ * Format (size in byte):
+ *  ---------------------------------------------------------------------
+ * | PageId (4) | LSN (4) | Checksum (4) | GlobalDepth (4) | MaxDepth (4) |
+ *  ---------------------------------------------------------------------
+ * | BucketPageId(0) (4) | ... | BucketPageId(2^MaxDepth - 1) (4) |
+ *  ---------------------------------------------------------------------
+ * | LocalDepth(0) (1) | ... | LocalDepth(2^MaxDepth - 1) (1) |
+ *  ---------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class HashTableDirectoryPage {
+public:
+  // After creating a new directory page from buffer pool, must call
+  // initialize method: one slot, pointing to bucket_page_id
+  void Init(page_id_t page_id, page_id_t bucket_page_id,
+            size_t page_size = PAGE_SIZE);
+
+  page_id_t GetPageId() const { return page_id_; }
+  uint32_t GetGlobalDepth() const { return global_depth_; }
+  uint32_t GetMaxDepth() const { return max_depth_; }
+  // number of slots in use
+  size_t Size() const { return static_cast<size_t>(1) << global_depth_; }
+
+  // slot a hash value maps to
+  size_t SlotOf(size_t hash) const { return hash & (Size() - 1); }
+
+  page_id_t GetBucketPageId(size_t slot) const;
+  void SetBucketPageId(size_t slot, page_id_t bucket_page_id);
+  uint32_t GetLocalDepth(size_t slot) const;
+  void SetLocalDepth(size_t slot, uint32_t local_depth);
+
+  // double the directory, the new upper half mirrors the lower half
+  bool CanGrow() const { return global_depth_ < max_depth_; }
+  void Grow();
+  // halve the directory once no bucket is as deep as it
+  bool CanShrink() const;
+  void Shrink();
+
+private:
+  page_id_t *BucketPageIds() const;
+  uint8_t *LocalDepths() const;
+
+  page_id_t page_id_;
+  lsn_t lsn_;
+  uint32_t checksum_; // stamped and verified by DiskManager only
+  uint32_t global_depth_;
+  uint32_t max_depth_;
+  char slots_[0];
+};
+} // namespace cmudb
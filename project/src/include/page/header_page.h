@@ -3,12 +3,16 @@
  *
  * Database use the first page (page_id = 0) as header page to store metadata, in
  * our case, we will contain information about table/index name (length less than
- * 32 bytes) and their corresponding root_id
+ * 32 bytes) and their corresponding root_id. The page size of the database is
+ * recorded first so DiskManager can read it back when the file is reopened
  *
  * Format (size in byte):
- *  -----------------------------------------------------------------
- * | RecordCount (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
- *  -----------------------------------------------------------------
+ *  ---------------------------------------------------------------------
+ * | PageSize (4) | RecordCount (4) | Checksum (4) | Entry_1 name (32) |
+ *  ---------------------------------------------------------------------
+ * | Entry_1 root_id (4) | ... |
+ *  ---------------------------
+ * Checksum is reserved for the disk manager, see PAGE_CHECKSUM_OFFSET
  */
 
 #pragma once
@@ -21,7 +25,10 @@ namespace cmudb {
 
 class HeaderPage : public Page {
 public:
-  void Init() { SetRecordCount(0); }
+  void Init() {
+    SetPageSize(GetPageSize());
+    SetRecordCount(0);
+  }
   /**
    * Record related
    */
@@ -31,7 +38,17 @@ public:
 
   // return root_id if success
   bool GetRootId(const std::string &name, page_id_t &root_id);
+  // the same on the raw data of a header page of page_size bytes, read
+  // before any buffer pool caches it
+  static bool GetRootId(const char *data, size_t page_size,
+                        const std::string &name, page_id_t &root_id);
+  // a non-negative 62-bit value such as a log offset, kept 31 bits each in
+  // the records name and name + "_hi". A missing "_hi" record reads as 0
+  bool SetWideRecord(const std::string &name, int64_t value);
+  bool GetWideRecord(const std::string &name, int64_t &value);
   int GetRecordCount();
+  // page size recorded for the whole database
+  size_t GetRecordedPageSize();
 
 private:
   /**
@@ -40,5 +57,10 @@ private:
   int FindRecord(const std::string &name);
 
   void SetRecordCount(int record_count);
+  void SetPageSize(size_t page_size);
+
+  static const int RECORD_COUNT_OFFSET = 4;
+  static const int RECORDS_OFFSET = 12;
+  static const int RECORD_SIZE = 36;
 };
 } // namespace cmudb
@@ -0,0 +1,161 @@
+/**
+ * key_prefix.h
+ *
+ * Prefix compression of the entries of a B+ tree page. The keys of a page
+ * share their first prefix size bytes, which are kept once at the start of
+ * the page's data, right after its header; each entry that follows holds the
+ * rest of its key and then its value. Without a prefix an entry is laid out
+ * as the std::pair of the two.
+ *
+ * A page takes the prefix its whole key range shares, not only the keys it
+ * has, so a key inserted always has it: the range of a child lies between
+ * two keys of its parent. Only keys that compare as their bytes, normalized
+ * ones, can be told that way, see BPlusTree::SetKeyCompression.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#include "index/generic_key.h"
+
+namespace cmudb {
+
+template <typename KeyType, typename ValueType> class KeyPrefix {
+  static_assert(sizeof(std::pair<KeyType, ValueType>) ==
+                    sizeof(KeyType) + sizeof(ValueType),
+                "entries without a prefix are pairs");
+
+public:
+  static constexpr int KEY_SIZE = static_cast<int>(sizeof(KeyType));
+
+  // bytes an entry takes after a prefix of prefix_size
+  static inline int EntrySize(int prefix_size) {
+    return KEY_SIZE - prefix_size + static_cast<int>(sizeof(ValueType));
+  }
+
+  // entries that fit in data_size bytes with a prefix of prefix_size
+  static inline int MaxSize(size_t data_size, int prefix_size) {
+    return (static_cast<int>(data_size) - prefix_size) /
+           EntrySize(prefix_size);
+  }
+
+  static inline char *EntryAt(char *data, int prefix_size, int index) {
+    return data + prefix_size + index * EntrySize(prefix_size);
+  }
+  static inline const char *EntryAt(const char *data, int prefix_size,
+                                    int index) {
+    return data + prefix_size + index * EntrySize(prefix_size);
+  }
+
+  static inline KeyType KeyAt(const char *data, int prefix_size, int index) {
+    KeyType key;
+    memcpy(key.data, data, prefix_size);
+    memcpy(key.data + prefix_size, EntryAt(data, prefix_size, index),
+           KEY_SIZE - prefix_size);
+    return key;
+  }
+
+  static inline ValueType ValueAt(const char *data, int prefix_size,
+                                  int index) {
+    ValueType value;
+    memcpy(&value, EntryAt(data, prefix_size, index) + KEY_SIZE - prefix_size,
+           sizeof(ValueType));
+    return value;
+  }
+
+  // key has the prefix of the page
+  static inline void SetKeyAt(char *data, int prefix_size, int index,
+                              const KeyType &key) {
+    assert(memcmp(key.data, data, prefix_size) == 0);
+    memcpy(EntryAt(data, prefix_size, index), key.data + prefix_size,
+           KEY_SIZE - prefix_size);
+  }
+
+  static inline void SetValueAt(char *data, int prefix_size, int index,
+                                const ValueType &value) {
+    memcpy(EntryAt(data, prefix_size, index) + KEY_SIZE - prefix_size, &value,
+           sizeof(ValueType));
+  }
+
+  // bytes at the start of lhs and rhs that are the same, at most size
+  static inline int CommonSize(const char *lhs, const char *rhs, int size) {
+    int common = 0;
+    while (common < size && lhs[common] == rhs[common]) {
+      common++;
+    }
+    return common;
+  }
+
+  // the shortest key above low and not above high, low < high: high up to
+  // the first byte it differs from low in, the rest zeroed
+  static inline KeyType Separator(const KeyType &low, const KeyType &high) {
+    int common = CommonSize(low.data, high.data, KEY_SIZE);
+    KeyType separator;
+    memset(separator.data, 0, KEY_SIZE);
+    memcpy(separator.data, high.data, std::min(common + 1, KEY_SIZE));
+    return separator;
+  }
+
+  // lay the size entries of data out again with a prefix of prefix_size. A
+  // longer one is taken from key, which all the keys start with; a shorter
+  // one is the start of the old one. The entries move down as the prefix
+  // grows and up as it shrinks
+  static void Relayout(char *data, int size, int old_prefix_size,
+                       const KeyType &key, int prefix_size) {
+    KeyType old_prefix;
+    memcpy(old_prefix.data, data, old_prefix_size);
+    int old_entry_size = EntrySize(old_prefix_size);
+    int entry_size = EntrySize(prefix_size);
+    if (prefix_size > old_prefix_size) {
+      int dropped = prefix_size - old_prefix_size;
+      for (int i = 0; i < size; i++) {
+        memmove(data + prefix_size + i * entry_size,
+                data + old_prefix_size + i * old_entry_size + dropped,
+                entry_size);
+      }
+      memcpy(data, key.data, prefix_size);
+    } else if (prefix_size < old_prefix_size) {
+      int added = old_prefix_size - prefix_size;
+      for (int i = size - 1; i >= 0; i--) {
+        char *entry = data + prefix_size + i * entry_size;
+        memmove(entry + added, data + old_prefix_size + i * old_entry_size,
+                old_entry_size);
+        memcpy(entry, old_prefix.data + prefix_size, added);
+      }
+      memcpy(data, old_prefix.data, prefix_size);
+    }
+  }
+
+  // the first index in [start, end) whose key is above key, or at or above
+  // it unless upper, comparing bytes
+  static int SearchKeys(const char *data, int prefix_size, int start, int end,
+                        const KeyType &key, bool upper) {
+    int result = memcmp(key.data, data, prefix_size);
+    if (result != 0) {
+      return result < 0 ? start : end;
+    }
+    const char *suffix = key.data + prefix_size;
+    int suffix_size = KEY_SIZE - prefix_size;
+    int entry_size = EntrySize(prefix_size);
+    const char *entries = data + prefix_size;
+    while (start < end) {
+      int middle = start + ((end - start) >> 1);
+      result = memcmp(entries + middle * entry_size, suffix, suffix_size);
+      if (result < 0 || (upper && result == 0)) {
+        start = middle + 1;
+      } else {
+        end = middle;
+      }
+    }
+    return start;
+  }
+};
+
+// std::min binds it to a reference, so it needs a definition
+template <typename KeyType, typename ValueType>
+constexpr int KeyPrefix<KeyType, ValueType>::KEY_SIZE;
+
+} // namespace cmudb
@@ -0,0 +1,120 @@
+/**
+ * key_search.h
+ *
+ * Search of the sorted pairs of a B+ tree page for a key. In general a binary
+ * search through the comparator. Normalized 8 byte keys, see NormalizedKey,
+ * and the keys of an IntegerComparator are compared as integers instead:
+ * halved down to KEY_SEARCH_SCAN keys, which are then scanned, 8 byte keys
+ * four at a time with AVX2.
+ */
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "common/config.h"
+#include "index/generic_key.h"
+
+namespace cmudb {
+
+// the first index in [start, end) whose key is above key, or at or above it
+// unless upper
+template <typename KeyType, typename ValueType, typename KeyComparator>
+inline int BinarySearchKeys(const std::pair<KeyType, ValueType> *array,
+                            int start, int end, const KeyType &key,
+                            const KeyComparator &comparator, bool upper) {
+  while (start < end) {
+    int middle = start + ((end - start) >> 1);
+    int result = comparator(array[middle].first, key);
+    if (result < 0 || (upper && result == 0)) {
+      start = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return start;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+inline int SearchKeys(const std::pair<KeyType, ValueType> *array, int start,
+                      int end, const KeyType &key,
+                      const KeyComparator &comparator, bool upper) {
+  return BinarySearchKeys(array, start, end, key, comparator, upper);
+}
+
+// SearchKeys of normalized keys, compared as integers
+template <size_t KeySize, typename ValueType>
+inline int IntegerSearchKeys(
+    const std::pair<GenericKey<KeySize>, ValueType> *array, int start,
+    int end, const GenericKey<KeySize> &key, bool upper) {
+  typedef IntegerComparator<KeySize> Comparator;
+  typename Comparator::Bits target = Comparator::BitsOf(key);
+  while (end - start > KEY_SEARCH_SCAN) {
+    int middle = start + ((end - start) >> 1);
+    auto bits = Comparator::BitsOf(array[middle].first);
+    if (bits < target || (upper && bits == target)) {
+      start = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+
+  // the keys are sorted, those before the first not below key are counted
+#if defined(__AVX2__)
+  if (KeySize == 8) {
+    const int stride = static_cast<int>(sizeof(array[0]));
+    const __m128i offsets = _mm_setr_epi32(0, stride, 2 * stride, 3 * stride);
+    // reverses the bytes of each key, and moves unsigned order to signed
+    const __m256i reverse = _mm256_setr_epi8(
+        7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3,
+        2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i targets = _mm256_set1_epi64x(
+        static_cast<int64_t>(static_cast<uint64_t>(target) ^ (1ull << 63)));
+    for (; start + 4 <= end; start += 4) {
+      __m256i keys = _mm256_i32gather_epi64(
+          reinterpret_cast<const long long *>(&array[start].first), offsets,
+          1);
+      keys = _mm256_xor_si256(_mm256_shuffle_epi8(keys, reverse), sign);
+      __m256i before =
+          upper ? _mm256_xor_si256(_mm256_cmpgt_epi64(keys, targets),
+                                   _mm256_set1_epi64x(-1))
+                : _mm256_cmpgt_epi64(targets, keys);
+      int mask = _mm256_movemask_pd(_mm256_castsi256_pd(before));
+      if (mask != 0xF) {
+        return start + __builtin_popcount(mask);
+      }
+    }
+  }
+#endif
+  for (; start < end; ++start) {
+    auto bits = Comparator::BitsOf(array[start].first);
+    if (bits > target || (!upper && bits == target)) {
+      break;
+    }
+  }
+  return start;
+}
+
+template <typename ValueType>
+inline int SearchKeys(const std::pair<GenericKey<8>, ValueType> *array,
+                      int start, int end, const GenericKey<8> &key,
+                      const GenericComparator<8> &comparator, bool upper) {
+  if (!comparator.IsNormalized()) {
+    return BinarySearchKeys(array, start, end, key, comparator, upper);
+  }
+  return IntegerSearchKeys(array, start, end, key, upper);
+}
+
+template <size_t KeySize, typename ValueType>
+inline int SearchKeys(const std::pair<GenericKey<KeySize>, ValueType> *array,
+                      int start, int end, const GenericKey<KeySize> &key,
+                      const IntegerComparator<KeySize> &, bool upper) {
+  return IntegerSearchKeys(array, start, end, key, upper);
+}
+
+} // namespace cmudb
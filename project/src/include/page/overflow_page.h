@@ -0,0 +1,55 @@
+/**
+ * overflow_page.h
+ *
+ * A page of the overflow chain a long varchar is spilled to, see
+ * OverflowChain. Written once, before the tuple pointing at it is logged.
+ *
+ * Format (size in byte):
+ *  -----------------------------------------------------------------------
+ * | PageId (4) | LSN (4) | Checksum (4) | NextPageId (4) | Size (4) | Data |
+ *  -----------------------------------------------------------------------
+ * Checksum is reserved for the disk manager, see PAGE_CHECKSUM_OFFSET
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+
+#include "page/page.h"
+
+namespace cmudb {
+
+class OverflowPage : public Page {
+public:
+  // up to Capacity bytes of data, the rest of the chain at next_page_id
+  inline void Init(page_id_t page_id, page_id_t next_page_id, const char *data,
+                   int32_t size, size_t page_size) {
+    memcpy(GetData(), &page_id, 4);
+    SetLSN(INVALID_LSN);
+    memcpy(GetData() + NEXT_PAGE_ID_OFFSET, &next_page_id, 4);
+    size = std::min(size, Capacity(page_size));
+    memcpy(GetData() + SIZE_OFFSET, &size, 4);
+    memcpy(GetData() + PAYLOAD_OFFSET, data, size);
+  }
+
+  inline page_id_t GetNextPageId() {
+    return *reinterpret_cast<page_id_t *>(GetData() + NEXT_PAGE_ID_OFFSET);
+  }
+  inline int32_t GetSize() {
+    return *reinterpret_cast<int32_t *>(GetData() + SIZE_OFFSET);
+  }
+  inline const char *GetPayload() { return GetData() + PAYLOAD_OFFSET; }
+
+  // payload bytes a page of page_size holds
+  static inline int32_t Capacity(size_t page_size) {
+    return static_cast<int32_t>(page_size) - PAYLOAD_OFFSET;
+  }
+
+private:
+  static const int32_t NEXT_PAGE_ID_OFFSET = 12;
+  static const int32_t SIZE_OFFSET = 16;
+  static const int32_t PAYLOAD_OFFSET = 20;
+};
+
+} // namespace cmudb
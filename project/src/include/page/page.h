@@ -8,44 +8,97 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
 
 #include "common/config.h"
-#include "common/rwmutex.h"
+#include "common/rwlatch.h"
 
 namespace cmudb {
 
-class Page {
-  friend class BufferPoolManager;
+// metadata of one frame, padded to whole cache lines so the latches and pin
+// counts of neighbouring frames never share one
+class alignas(CACHELINE_SIZE) Page {
+  friend class BufferPoolInstance;
 
 public:
-  Page() { ResetMemory(); }
+  static const int CLAIMED_PIN_COUNT = -1;
+
+  // frame memory is handed out by the buffer pool
+  Page() {}
   ~Page(){};
   // get actual data page content
   inline char *GetData() { return data_; }
   // get page id
   inline page_id_t GetPageId() { return page_id_; }
+  // get size of the page in byte, fixed per database
+  inline size_t GetPageSize() { return page_size_; }
   // get page pin count
   inline int GetPinCount() { return pin_count_; }
+  // get index of the frame holding this page inside its buffer pool
+  inline size_t GetFrameId() { return frame_id_; }
   // method use to latch/unlatch page content
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
-  inline void WLatch() { rwlatch_.WLock(); }
+  // the version is odd while a writer holds the latch
+  inline void WUnlatch() {
+    version_.fetch_add(1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
   inline void RUnlatch() { rwlatch_.RUnlock(); }
   inline void RLatch() { rwlatch_.RLock(); }
+  // false, not latched, if a writer holds or waits for the latch
+  inline bool TryRLatch() { return rwlatch_.TryRLock(); }
+
+  // optimistic read without touching the latch, the page must be pinned:
+  //   uint64_t version = page->BeginOptimisticRead();
+  //   ... copy what is needed out of GetData() ...
+  //   if (!page->ValidateOptimisticRead(version)) retry or fall back to RLatch
+  // anything read before a failed validation may be torn and must be dropped
+  inline uint64_t BeginOptimisticRead() {
+    uint64_t version;
+    while ((version = version_.load(std::memory_order_acquire)) & 1) {
+    }
+    return version;
+  }
+  inline bool ValidateOptimisticRead(uint64_t version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
 
   inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + 4); }
   inline void SetLSN(lsn_t lsn) { memcpy(GetData() + 4, &lsn, 4); }
 
 private:
   // method used by buffer pool manager
-  inline void ResetMemory() { memset(data_, 0, PAGE_SIZE); }
+  inline void ResetMemory() { memset(data_, 0, page_size_); }
   // members
-  char data_[PAGE_SIZE]; // actual data
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  int pin_count_ = 0;
-  bool is_dirty_ = false;
-  RWMutex rwlatch_;
+  char *data_ = nullptr; // actual data, page_size_ bytes
+  size_t page_size_ = PAGE_SIZE;
+  // atomic so resident pages can be pinned and unpinned without the buffer
+  // pool latch, a pin count of CLAIMED_PIN_COUNT marks a frame the latch
+  // holder is (re)assigning
+  std::atomic<page_id_t> page_id_{INVALID_PAGE_ID};
+  std::atomic<int> pin_count_{0};
+  std::atomic<bool> is_dirty_{false};
+  size_t frame_id_ = 0;
+  // a copy of this page is being written back by the page cleaner
+  bool is_flushing_ = false;
+  // content is being read in by a prefetch, not usable yet
+  bool is_loading_ = false;
+  // recLSN: no change of the page below it is missing on disk. Set when the
+  // page is read in and when it is written back, see GetDirtyPages
+  lsn_t rec_lsn_ = 0;
+  // rec_lsn_ once the copy of a batch flush is written
+  lsn_t flush_rec_lsn_ = 0;
+  RWLatch rwlatch_;
+  // bumped by every WLatch and WUnlatch, see BeginOptimisticRead
+  std::atomic<uint64_t> version_{0};
 };
 
 } // namespace cmudb
@@ -0,0 +1,93 @@
+/**
+ * slotted_tree_page.h
+ *
+ * Leaf or internal page of VarKeyTree with variable-length keys. The keys are
+ * kept in a heap growing down from the end of the page; an array of slots
+ * growing up after the header holds their offsets and sizes with the values,
+ * in key order. A removed key leaves a hole in the heap, counted as garbage
+ * and squeezed out when an insert needs the room.
+ *
+ * Format (size in byte, 36 bytes of header):
+ * ----------------------------------------------------------------------------
+ * | PageType (4) | LSN (4) | Checksum (4) | CurrentSize (4) | PageId (4) |
+ * ----------------------------------------------------------------------------
+ * | NextPageId (4) | PageSize (4) | HeapOffset (4) | Garbage (4) |
+ * ----------------------------------------------------------------------------
+ * | SLOT(1) | SLOT(2) | ... | SLOT(n) | free | KEY(n) ... KEY(1) |
+ * ----------------------------------------------------------------------------
+ * A slot is its key's offset (2) and size (2), then the value. Internal pages
+ * keep the empty key in slot 0 like BPlusTreeInternalPage leaves it unused,
+ * so the child at slot i has the keys from key i up to key i + 1.
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "index/var_key.h"
+#include "page/b_plus_tree_page.h"
+
+namespace cmudb {
+
+template <typename ValueType> class SlottedTreePage {
+public:
+  // After creating a new page from buffer pool, must call initialize method
+  // to set default values. page_size is below 64KB, offsets are 2 bytes
+  void Init(page_id_t page_id, IndexPageType page_type,
+            size_t page_size = PAGE_SIZE);
+
+  bool IsLeafPage() const { return page_type_ == IndexPageType::LEAF_PAGE; }
+  page_id_t GetPageId() const { return page_id_; }
+  int GetSize() const { return size_; }
+  // the next leaf, INVALID_PAGE_ID for the last one
+  page_id_t GetNextPageId() const { return next_page_id_; }
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+  VarKey KeyAt(int index) const;
+  ValueType ValueAt(int index) const;
+  void SetValueAt(int index, const ValueType &value);
+  // the first index whose key is at or above key, above it if upper
+  int KeyIndex(const VarKey &key, const VarKeyComparator &comparator,
+               bool upper) const;
+  // index of the slot with value, -1 if none
+  int ValueIndex(const ValueType &value) const;
+
+  // bytes an entry of key takes, slot included
+  static int EntrySize(const VarKey &key);
+  // bytes left for entries, holes in the heap included
+  int GetFreeSpace() const;
+  // bytes of the entries, out of those of a page empty
+  int GetUsedSpace() const;
+  int GetCapacity() const;
+
+  // false if the entry does not fit, the page is left as it is
+  bool InsertAt(int index, const VarKey &key, const ValueType &value);
+  void RemoveAt(int index);
+  // the index splitting the entries into halves of about as many bytes, in
+  // [1, size), size at least 2
+  int SplitIndex() const;
+  // move the entries from index on to the end of recipient
+  void MoveTailTo(int index, SlottedTreePage *recipient);
+
+private:
+  struct Slot {
+    uint16_t offset_;
+    uint16_t size_;
+    ValueType value_;
+  };
+
+  // lay the keys out again at the end of the page, without holes
+  void Compact();
+
+  IndexPageType page_type_;
+  lsn_t lsn_;
+  uint32_t checksum_; // stamped and verified by DiskManager only
+  int size_;
+  page_id_t page_id_;
+  page_id_t next_page_id_;
+  int page_size_;
+  int heap_offset_; // where the key heap starts
+  int garbage_;     // bytes of the holes in it
+  Slot slots_[0];
+};
+
+} // namespace cmudb
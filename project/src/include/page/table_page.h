@@ -10,17 +10,38 @@
  *
  *  Header format (size in byte):
  *  --------------------------------------------------------------------------
- * | PageId (4)| LSN (4)| PrevPageId (4)| NextPageId (4)| FreeSpacePointer(4) |
+ * | PageId (4)| LSN (4)| Checksum (4)| PrevPageId (4)| NextPageId (4)|
  *  --------------------------------------------------------------------------
- *  --------------------------------------------------------------
- * | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
- *  --------------------------------------------------------------
+ *  --------------------------------------------------------------------------
+ * | FreeSpacePointer(4) | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) |
+ *  --------------------------------------------------------------------------
+ * | ... |
+ *  -----
+ *  Checksum is reserved for the disk manager, see PAGE_CHECKSUM_OFFSET
+ *
+ *  Deletes and updates leave dead bytes between the tuples. An insert or
+ *  update that does not fit in front of the tuples but would without them
+ *  compacts the page first; slots keep their numbers, so a tuple keeps its
+ *  rid as long as it fits in its page whatever moves in it.
  *
+ *  A PAX page keeps the fixed-size part of its tuples by column instead, in
+ *  a minipage per column with room for Capacity slots, so a scan reading a
+ *  column reads only its bytes. Only the varchar payloads are where the
+ *  tuples are on a slotted page, the slot has their offset and the size of
+ *  the whole tuple. TupleCount carries PAX_FLAG, the layout is before the
+ *  slots (a negative width is the offset of a varchar):
+ *  --------------------------------------------------------------------------
+ * | ... | TupleCount (4) | Capacity (4) | FixedSize (4) | ColumnCount (4) |
+ *  --------------------------------------------------------------------------
+ *  --------------------------------------------------------------------------
+ * | Width_1 (4) | ... | Slots | Minipage_1 | ... | FREE SPACES | PAYLOADS |
+ *  --------------------------------------------------------------------------
  */
 
 #pragma once
 
 #include <cstring>
+#include <vector>
 
 #include "common/rid.h"
 #include "concurrency/lock_manager.h"
@@ -34,47 +55,109 @@ class TablePage : public Page {
 public:
   /**
    * Header related
+   * column_widths: the layout of a PAX page, see GetPaxLayout; empty for a
+   * slotted page
    */
   void Init(page_id_t page_id, size_t page_size, page_id_t prev_page_id,
-            LogManager *log_manager, Transaction *txn);
+            LogManager *log_manager, Transaction *txn,
+            const std::vector<int32_t> &column_widths =
+                std::vector<int32_t>());
   page_id_t GetPageId();
   page_id_t GetPrevPageId();
   page_id_t GetNextPageId();
   void SetPrevPageId(page_id_t prev_page_id);
   void SetNextPageId(page_id_t next_page_id);
+  // the column_widths of Init, empty for a slotted page
+  std::vector<int32_t> GetColumnWidths();
+  // column_widths of a PAX page for tuples of schema
+  static std::vector<int32_t> GetPaxLayout(Schema *schema);
+  // tuples a PAX page of page_size with column_widths holds, 0 if none fit
+  static int32_t GetPaxCapacity(const std::vector<int32_t> &column_widths,
+                                size_t page_size);
 
   /**
    * Tuple related
+   * table_id is the table of the page, its tuple locks go below the table's
+   * and the page's intention locks then, see LockManager
    */
   bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
-                   LockManager *lock_manager,
-                   LogManager *log_manager); // return rid if success
+                   LockManager *lock_manager, LogManager *log_manager,
+                   page_id_t table_id = INVALID_PAGE_ID); // return rid
+  // tuples from begin on into new slots after the last one, as many as fit,
+  // logged as one INSERTBATCH record. Their rids go to rids, returns how
+  // many went in
+  size_t AppendTuples(const std::vector<Tuple> &tuples, size_t begin,
+                      std::vector<RID> &rids, Transaction *txn,
+                      LockManager *lock_manager, LogManager *log_manager,
+                      page_id_t table_id = INVALID_PAGE_ID);
   bool MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager,
-                  LogManager *log_manager); // delete
+                  LogManager *log_manager,
+                  page_id_t table_id = INVALID_PAGE_ID); // delete
   bool UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple, const RID &rid,
                    Transaction *txn, LockManager *lock_manager,
-                   LogManager *log_manager);
+                   LogManager *log_manager,
+                   page_id_t table_id = INVALID_PAGE_ID);
 
   // commit/abort time
-  void ApplyDelete(const RID &rid, Transaction *txn,
-                   LogManager *log_manager); // when commit success
+  // the tuple removed into deleted, if given
+  void ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_manager,
+                   Tuple *deleted = nullptr); // when commit success
   void RollbackDelete(const RID &rid, Transaction *txn,
                       LogManager *log_manager); // when commit abort
 
   // return tuple (with data pointing to heap) if success
   bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
-                LockManager *lock_manager);
+                LockManager *lock_manager,
+                page_id_t table_id = INVALID_PAGE_ID);
+
+  // copy of the tuple at rid, no locks taken, false if there is none
+  bool ReadTuple(const RID &rid, Tuple &tuple);
+
+  // the locks of GetTuple without the copy, false if rid has no tuple
+  bool LockTuple(const RID &rid, Transaction *txn, LockManager *lock_manager,
+                 page_id_t table_id = INVALID_PAGE_ID);
+  // where column column_id of the tuple at rid is in the page, as
+  // Tuple::GetValue reads it; nullptr if there is no tuple. Valid while the
+  // page latch is held, compaction moves it
+  const char *GetColumnData(const RID &rid, Schema *schema, int column_id);
+  // the slots from first_slot on that have a tuple, in order, in place of
+  // slots; how many slots the page has
+  uint32_t GetTupleSlots(uint32_t first_slot, std::vector<uint32_t> &slots);
+  // the inlined column_id of the tuples in slots, count of them, one after
+  // the other into column, see ScanFilter. The slots have tuples
+  void GatherColumn(Schema *schema, int column_id, const uint32_t *slots,
+                    size_t count, char *column);
 
   /**
    * Tuple iterator
+   * all_slots: deleted and freed slots too, for snapshot scans
    */
-  bool GetFirstTupleRid(RID &first_rid);
-  bool GetNextTupleRid(const RID &cur_rid, RID &next_rid);
+  bool GetFirstTupleRid(RID &first_rid, bool all_slots = false);
+  bool GetNextTupleRid(const RID &cur_rid, RID &next_rid,
+                       bool all_slots = false);
+
+  // bytes neither slots nor tuples take, a new tuple needs its size and 8
+  // more for a slot of its own. Space freed by deletes and updates is dead
+  // until one needs it and the page is compacted
+  int32_t GetFreeSpaceSize();
+
+  // the size the tuple at rid can grow to where it is, 0 if there is none
+  int32_t GetRoomFor(const RID &rid);
 
 private:
   /**
    * helper functions
    */
+  // append log_record for txn, the page carries its LSN from now on
+  void AppendLog(LogRecord &log_record, Transaction *txn,
+                 LogManager *log_manager);
+  // bytes between the slots and the tuples, the minipages and the payloads
+  // of a PAX page
+  int32_t GetContiguousSpaceSize();
+  // bytes neither minipages nor payloads take on a PAX page
+  int32_t GetPayloadFreeSpaceSize();
+  // squeeze the dead space out from between the tuples
+  void Compact();
   int32_t GetTupleOffset(int slot_num);
   int32_t GetTupleSize(int slot_num);
   void SetTupleOffset(int slot_num, int32_t offset);
@@ -84,6 +167,28 @@ private:
   int32_t GetTupleCount(); // Note that this tuple count may be larger than # of
                            // actual tuples because some slots may be empty
   void SetTupleCount(int32_t tuple_count);
-  int32_t GetFreeSpaceSize();
+
+  /**
+   * PAX layout, a slotted page has no minipages and the whole tuple as
+   * payload
+   */
+  inline bool IsPax() {
+    return (*reinterpret_cast<int32_t *>(GetData() + 24) & PAX_FLAG) != 0;
+  }
+  int32_t GetCapacity();
+  int32_t GetFixedSize();
+  int32_t GetSlotsOffset();
+  int32_t GetMinipageOffset(int column_id);
+  // bytes of the tuple of size tuple_size that go to the payloads
+  inline int32_t GetPayloadSize(int32_t tuple_size) {
+    return tuple_size - GetFixedSize();
+  }
+  // tuple_size bytes of the tuple in slot_num, gathered from the minipages
+  // of a PAX page
+  void CopyTupleOut(int slot_num, int32_t tuple_size, char *data);
+  // tuple into slot_num, its payload at the offset of the slot
+  void CopyTupleIn(int slot_num, const Tuple &tuple);
+
+  static const int32_t PAX_FLAG = 0x40000000;
 };
 } // namespace cmudb
@@ -0,0 +1,84 @@
+/**
+ * dictionary.h
+ *
+ * Dictionary encoding of the low-cardinality varchar columns of a table:
+ * each distinct string of a column gets a code, and the tuples keep the
+ * code, an INTEGER, instead of a copy of the string. Codes are dense from 0
+ * per column and never reused; equal strings have equal codes, so equality
+ * is decided on codes alone, but their order is the order the strings came
+ * in, not theirs.
+ *
+ * The strings are kept in memory and on a chain of DictionaryPages, whose
+ * first page id is in the header page under the table name followed by
+ * "_dict". A new string is flushed to its page before its code is handed
+ * out, so no tuple on disk or in the log has a code the dictionary lost.
+ * Entries of aborted writes stay, they take a code no tuple has.
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+class Dictionary {
+public:
+  // the dictionary of column_ids of table_name, of column_count columns,
+  // loaded from its pages if it has them
+  Dictionary(const std::string &table_name,
+             BufferPoolManager *buffer_pool_manager, int column_count,
+             const std::vector<int> &column_ids);
+
+  Dictionary(const Dictionary &) = delete;
+  Dictionary &operator=(const Dictionary &) = delete;
+
+  inline bool IsEncoded(int column_id) const {
+    return column_id >= 0 && column_id < static_cast<int>(slot_of_.size()) &&
+           slot_of_[column_id] != -1;
+  }
+
+  // the code of length bytes at data in column_id, a new one if it is new
+  int32_t Encode(int column_id, const char *data, uint32_t length);
+
+  // the same without adding it, false if column_id does not have it
+  bool Lookup(int column_id, const char *data, uint32_t length,
+              int32_t &code);
+
+  // the string of code, valid as long as the dictionary; false if there is
+  // none
+  bool Decode(int column_id, int32_t code, const char *&data,
+              uint32_t &length);
+
+  // strings of column_id
+  size_t GetSize(int column_id);
+
+private:
+  struct Column {
+    // by code; a deque does not move the strings, Decode hands them out
+    std::deque<std::string> strings;
+    std::unordered_map<std::string, int32_t> codes;
+  };
+
+  // the entries of the chain from first_page_id_
+  void Load();
+  // data to the last page of the chain, or a new one behind it, flushed
+  void Persist(int column_id, const char *data, uint32_t length);
+
+  std::string name_;
+  BufferPoolManager *buffer_pool_manager_;
+  // the chain, INVALID_PAGE_ID until the first string
+  page_id_t first_page_id_ = INVALID_PAGE_ID;
+  page_id_t last_page_id_ = INVALID_PAGE_ID;
+  // where each column is in columns_, -1 if it is not encoded
+  std::vector<int> slot_of_;
+  std::vector<Column> columns_;
+  std::mutex latch_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,93 @@
+/**
+ * free_space_map.h
+ *
+ * Free space map of a table heap: how many bytes each page of its chain has
+ * free, in buckets of a 256th of a page, so an insert goes straight to a
+ * page with room instead of trying every page from the first one. A max
+ * tree over the buckets, in chain order, finds the first page with enough
+ * in O(log pages). The map is a hint: a page that has less than it says is
+ * corrected when an insert finds out.
+ *
+ * The map is kept on pages of its own and written back when it is closed.
+ * It is not logged: one not closed cleanly, or never written, is built again
+ * from a walk of the page chain when it is opened. Its meta page id is in
+ * the header page, under the table name followed by "_fsm".
+ *
+ * Meta page format (size in byte, 32 bytes of header):
+ * ----------------------------------------------------------------------------
+ * | unused (4) | LSN (4) | Checksum (4) | Clean (4) | PageCount (4) |
+ * ----------------------------------------------------------------------------
+ * | MapPageCount (4) | unused (8) | MapPageId(1) | ... |
+ * ----------------------------------------------------------------------------
+ * Map pages have 16 bytes of header, then PageId (4) and Bucket (4) of each
+ * heap page in chain order.
+ */
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+class FreeSpaceMap {
+public:
+  // the map of table_name, whose chain starts at first_page_id
+  FreeSpaceMap(const std::string &table_name,
+               BufferPoolManager *buffer_pool_manager,
+               page_id_t first_page_id);
+  // write the map back, closed cleanly
+  ~FreeSpaceMap();
+
+  FreeSpaceMap(const FreeSpaceMap &) = delete;
+  FreeSpaceMap &operator=(const FreeSpaceMap &) = delete;
+
+  // the first page in chain order with at least size bytes free, by the
+  // map; INVALID_PAGE_ID if there is none
+  page_id_t FindPage(int32_t size);
+
+  // page_id has free bytes free now. A page not in the map yet is the new
+  // last page of the chain
+  void Update(page_id_t page_id, int32_t free);
+
+  page_id_t GetLastPageId();
+
+  // pages in the map, and the free bytes it has for page_id, for tests
+  size_t GetPageCount();
+  int32_t GetFree(page_id_t page_id);
+
+private:
+  static const int META_HEADER_SIZE = 32;
+  static const int MAP_PAGE_HEADER_SIZE = 16;
+
+  // page_ids_ and the tree from a walk of the chain
+  void Rebuild(page_id_t first_page_id);
+  // set the bucket of the index_th page, growing the tree when it is full
+  void SetBucket(size_t index, uint8_t bucket);
+  // map pages for the entries, then the meta page, flushed
+  void WriteBack();
+  void WriteMeta(bool clean);
+
+  Page *FetchPage(page_id_t page_id);
+
+  std::string name_;
+  BufferPoolManager *buffer_pool_manager_;
+  page_id_t meta_page_id_;
+  std::vector<page_id_t> map_page_ids_;
+  size_t entries_per_page_;
+  size_t max_map_pages_;
+  // bucket of a page: free bytes over unit_, rounded down
+  int32_t unit_;
+  // pages in chain order, and where each is in it
+  std::vector<page_id_t> page_ids_;
+  std::unordered_map<page_id_t, size_t> index_of_;
+  // max tree, leaves from capacity_ on are the buckets of page_ids_
+  std::vector<uint8_t> tree_;
+  size_t capacity_;
+  std::mutex latch_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,43 @@
+/**
+ * morsel_cursor.h
+ *
+ * A cursor over the page chain of a table heap that workers share: each
+ * Next claims the next run of pages, a morsel, and copies out its tuples,
+ * so the workers go through the table at once and each one goes through
+ * its morsels on its own. Only claiming is serial, pages know their
+ * successor only; copying happens outside the cursor latch, a page latched
+ * while its tuples are copied. No locks are taken and no snapshot is read,
+ * as for TableHeap::ParallelScan.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "table/tuple.h"
+
+namespace cmudb {
+
+class TableHeap;
+
+class MorselCursor {
+public:
+  MorselCursor(TableHeap *table_heap, size_t morsel_pages = SCAN_MORSEL_PAGES);
+
+  // the tuples of the next morsel in place of tuples, false once the chain
+  // is done. A morsel of empty pages has none
+  bool Next(std::vector<Tuple> &tuples);
+
+  // stop handing out morsels, for a worker that failed
+  void Stop();
+
+private:
+  BufferPoolManager *buffer_pool_manager_;
+  size_t morsel_pages_;
+  std::mutex latch_;
+  page_id_t next_page_id_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,34 @@
+/**
+ * overflow_chain.h
+ *
+ * The bytes of a varchar too long to stay in its tuple, in a chain of
+ * overflow pages. The tuple keeps a prefix of it and the first page of the
+ * chain, see Tuple::Spill; the chain is only read when the column is.
+ * Chains are flushed once written, so the log record of the tuple never
+ * points at pages a crash lost.
+ */
+
+#pragma once
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+class OverflowChain {
+public:
+  // size bytes of data in a new chain, its first page in first_page_id.
+  // False if no page could be made, the pages made already are freed
+  static bool Write(BufferPoolManager *buffer_pool_manager, const char *data,
+                    int32_t size, page_id_t &first_page_id);
+
+  // size bytes of the chain at first_page_id into data, false if the chain
+  // is shorter
+  static bool Read(BufferPoolManager *buffer_pool_manager,
+                   page_id_t first_page_id, char *data, int32_t size);
+
+  // the pages of the chain at first_page_id back to the buffer pool
+  static void Free(BufferPoolManager *buffer_pool_manager,
+                   page_id_t first_page_id);
+};
+
+} // namespace cmudb
@@ -0,0 +1,62 @@
+/**
+ * scan_filter.h
+ *
+ * Predicates a sequential scan checks itself, so the tuples failing them
+ * are never copied or handed on: comparisons of fixed-size columns with
+ * constants, all of which a tuple has to satisfy. A scan reading tuples in
+ * place selects the slots of a page that do at once, with the page latched,
+ * by gathering each column into an array and running the batch kernels
+ * over it; one reading copies checks the copy. Nulls never match, as in
+ * SQL.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "catalog/schema.h"
+#include "table/tuple.h"
+#include "type/batch_kernels.h"
+
+namespace cmudb {
+
+class TablePage;
+
+// column_id op constant, constant of the type of the column
+struct ScanPredicate {
+  ScanPredicate(int column_id, BatchCmp op, const Value &constant)
+      : column_id(column_id), op(op), constant(constant) {}
+
+  int column_id;
+  BatchCmp op;
+  Value constant;
+};
+
+class ScanFilter {
+public:
+  // every tuple matches
+  ScanFilter() : schema_(nullptr) {}
+
+  // tuples of schema matching all of predicates
+  ScanFilter(Schema *schema, const std::vector<ScanPredicate> &predicates)
+      : schema_(schema), predicates_(predicates) {}
+
+  inline bool IsEmpty() const { return predicates_.empty(); }
+
+  // whether tuple, a copy, matches
+  bool Matches(const Tuple &tuple) const;
+
+  // the slots from first_slot on of page, latched, whose tuples match, in
+  // order, in place of selection; how many slots the page has
+  uint32_t Select(TablePage *page, uint32_t first_slot,
+                  std::vector<uint32_t> &selection);
+
+private:
+  Schema *schema_;
+  std::vector<ScanPredicate> predicates_;
+  // a column of the tuples still selected, and which of them match it
+  std::vector<char> column_;
+  std::vector<uint32_t> positions_;
+};
+
+} // namespace cmudb
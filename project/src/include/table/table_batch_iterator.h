@@ -0,0 +1,49 @@
+/**
+ * table_batch_iterator.h
+ *
+ * For seq scan of table heap a batch at a time: each Next fills the buffer
+ * of the caller with the next tuples of one page, read under one latch of
+ * it, so the page is fetched, latched and checked for its end once per
+ * batch instead of once per tuple. Tuples are read as TableIterator reads
+ * them, with the locks, snapshot or read set of the transaction.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "table/tuple.h"
+
+namespace cmudb {
+
+class TableHeap;
+class TablePage;
+class Transaction;
+
+class TableBatchIterator {
+public:
+  // for_update if txn is going to write what it reads
+  TableBatchIterator(TableHeap *table_heap, Transaction *txn,
+                     bool for_update = false);
+
+  // up to max_tuples of the next tuples in place of tuples, all from the
+  // same page; false once the table is done. Tuples in the buffer are
+  // reused
+  bool Next(std::vector<Tuple> &tuples, size_t max_tuples = SCAN_BATCH_SIZE);
+
+private:
+  // hint the next page of the heap to the buffer pool
+  void ReadAhead(TablePage *page);
+
+  TableHeap *table_heap_;
+  Transaction *txn_;
+  // page of the next batch, its tuples after rid_ if started_
+  page_id_t page_id_;
+  RID rid_;
+  bool started_ = false;
+  page_id_t read_ahead_page_id_ = INVALID_PAGE_ID;
+};
+
+} // namespace cmudb
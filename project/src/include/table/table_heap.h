@@ -6,16 +6,26 @@
 
 #pragma once
 
+#include <functional>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
+#include "concurrency/tuple_version_table.h"
+#include "concurrency/version_store.h"
 #include "logging/log_manager.h"
 #include "page/table_page.h"
+#include "table/free_space_map.h"
+#include "table/table_batch_iterator.h"
 #include "table/table_iterator.h"
 #include "table/tuple.h"
+#include "table/zone_map.h"
 
 namespace cmudb {
 
 class TableHeap {
   friend class TableIterator;
+  friend class MorselCursor;
+  friend class TableBatchIterator;
 
 public:
   ~TableHeap() {}
@@ -24,35 +34,165 @@ public:
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager,
             LogManager *log_manager, page_id_t first_page_id);
 
-  // create table heap
+  // create table heap, of PAX pages with column_widths, see
+  // TablePage::GetPaxLayout. Its pages keep the layout, a table heap opened
+  // reads it from them
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager,
-            LogManager *log_manager, Transaction *txn);
+            LogManager *log_manager, Transaction *txn,
+            const std::vector<int32_t> &column_widths =
+                std::vector<int32_t>());
 
-  // for insert, if tuple is too large (>~page_size), return false
+  // for insert, if tuple is too large (>~page_size), return false. The
+  // writes of an optimistic transaction are buffered in its write set until
+  // it commits, an insert only gets its rid then
   bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn);
 
+  // tuples behind the last one of the table, their rids in rids. The tail
+  // page and the pages made after it are latched and unpinned once each, with
+  // one log record per page. False, with the transaction aborted, if a tuple
+  // is too large or no page could be made; the tuples in rids went in
+  bool AppendBatch(const std::vector<Tuple> &tuples, std::vector<RID> &rids,
+                   Transaction *txn);
+
   bool MarkDelete(const RID &rid, Transaction *txn); // for delete
 
   // if the new tuple is too large to fit in the old page, return false (will
-  // delete and insert)
+  // delete and insert). With a schema, its varchars are spilled further
+  // before that, see SetSchema, so it fits and keeps its rid if it can
   bool UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn);
 
   // commit/abort time
   void ApplyDelete(const RID &rid,
                    Transaction *txn); // when commit delete or rollback insert
   void RollbackDelete(const RID &rid, Transaction *txn); // when rollback delete
+  // when commit update: frees the chains of old_tuple the tuple at rid
+  // no longer refers to. The rollback of an update frees in UpdateTuple
+  void ApplyUpdate(const RID &rid, const Tuple &old_tuple, Transaction *txn);
 
   bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn);
 
+  // whether the reads of txn copy the tuples: under MVCC and for optimistic
+  // transactions the version they see may not be the one on the page
+  inline bool ReadsCopies(Transaction *txn) const {
+    return version_store_ != nullptr || (txn != nullptr && txn->IsOptimistic());
+  }
+
+  // the lock GetTuple takes on rid, for a read of the row from elsewhere,
+  // e.g. an index. False, txn aborted, if refused
+  inline bool LockTuple(const RID &rid, Transaction *txn) {
+    return LockRow(rid, txn, false);
+  }
+
+  // the tuple at rid in view, read in place under the locks GetTuple takes;
+  // false if there is none. Only for reads that do not copy, see ReadsCopies
+  bool ViewTuple(const RID &rid, TupleView &view, Transaction *txn);
+
   bool DeleteTableHeap();
 
-  TableIterator begin(Transaction *txn);
+  // for_update if txn is going to write what it reads; only the tuples
+  // matching filter are returned, see TableIterator
+  TableIterator begin(Transaction *txn, bool for_update = false,
+                      const ScanFilter &filter = ScanFilter());
+
+  // the same, only reading the pages the zone map says may have tuples in
+  // ranges, see TableIterator; every page without a zone map
+  TableIterator begin(Transaction *txn, bool for_update,
+                      const std::vector<ScanRange> &ranges,
+                      const ScanFilter &filter = ScanFilter());
 
   TableIterator end();
 
+  // every tuple into visit, from threads workers at once, one per core for
+  // threads <= 0, each taking the next morsel of the chain in turn, see
+  // MorselCursor; visit gets the worker, from 0. Pages are only latched
+  // while their tuples are copied, no locks are taken and no snapshot is
+  // read: a tuple written meanwhile may or may not be visited, a delete not
+  // committed yet hides it. What visit throws is thrown once the workers are
+  // done. Over a NUMA-aware pool the workers are pinned to its nodes in turn
+  void ParallelScan(int threads,
+                    const std::function<void(int, const Tuple &)> &visit,
+                    size_t morsel_pages = SCAN_MORSEL_PAGES);
+
+  // tuples in the table, by a parallel scan
+  size_t CountTuples(int threads = 0);
+
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  // MVCC: writes keep the versions before them in version_store, GetTuple
+  // and scans read the snapshot of their transaction and take no locks.
+  // nullptr turns it off
+  inline void SetVersionStore(VersionStore *version_store) {
+    version_store_ = version_store;
+  }
+
+  // inserts go to a page free_space_map has room in, instead of trying the
+  // pages from the first one on; writes keep it up to date. nullptr turns
+  // it off
+  inline void SetFreeSpaceMap(FreeSpaceMap *free_space_map) {
+    free_space_map_ = free_space_map;
+  }
+
+  // tuples larger than TUPLE_INLINE_SHARE of a page keep their longest
+  // varchars in overflow chains, see Tuple::Spill, which needs the schema
+  // of the tuples. Deletes free the chains without MVCC and OCC, a chain an
+  // update replaced stays. nullptr turns it off, tuples larger than a page
+  // are rejected then
+  inline void SetSchema(Schema *schema) { schema_ = schema; }
+
+  // inserts and updates keep zone_map current, built by ZoneMap::Rebuild
+  // for this heap, so range scans skip pages; nullptr turns it off
+  inline void SetZoneMap(ZoneMap *zone_map) { zone_map_ = zone_map; }
+
+  // OCC: writes keep the tuple versions optimistic transactions validate
+  // their reads against, which take no locks. Optimistic transactions need
+  // it, nullptr turns it off
+  inline void SetTupleVersions(TupleVersionTable *tuple_versions) {
+    tuple_versions_ = tuple_versions;
+  }
+
 private:
+  // whether a write of txn keeps the version before it, rollbacks do not
+  inline bool Versioned(Transaction *txn) {
+    return version_store_ != nullptr &&
+           txn->GetState() != TransactionState::ABORTED;
+  }
+  // whether a write of txn keeps the tuple version pending until it ends
+  inline bool Tracked(Transaction *txn) {
+    return tuple_versions_ != nullptr &&
+           txn->GetState() != TransactionState::ABORTED;
+  }
+  // whether chains no tuple refers to anymore are freed: not while a
+  // snapshot or an optimistic read may still follow them
+  inline bool FreesChains() const {
+    return schema_ != nullptr && version_store_ == nullptr &&
+           tuple_versions_ == nullptr;
+  }
+  // free the overflow chains of tuple not among kept
+  void FreeChains(const Tuple &tuple, const std::vector<page_id_t> &kept);
+  // the buffered write of an optimistic txn to rid, nullptr if none
+  const WriteRecord *BufferedWrite(const RID &rid, Transaction *txn);
+  // GetTuple from page, latched already
+  bool ReadTuple(TablePage *page, const RID &rid, Tuple &tuple,
+                 Transaction *txn);
+  // the table lock a scan of txn takes, if any. False, txn aborted, if
+  // refused
+  bool LockScan(Transaction *txn, bool for_update);
+  // the lock of rid a locking txn reads or writes under, taken before the
+  // page is latched: waiting for it latched would keep its holder off the
+  // page. The page finds it held then. False, txn aborted, if refused
+  bool LockRow(const RID &rid, Transaction *txn, bool exclusive);
+  // the intention locks of an insert into page_id, taken before it is
+  // latched as LockRow's are. The page only tries the slot lock then. False,
+  // txn aborted, if refused
+  bool LockInsert(page_id_t page_id, Transaction *txn);
+  // tuple as it goes on a page, spilled into spilled if too large;
+  // nullptr, with txn aborted, if it does not fit a page anyway
+  const Tuple *Spill(const Tuple &tuple, Tuple &spilled, Transaction *txn);
+  // UpdateTuple of tuple to rid on page, latched, with as many varchars
+  // spilled as it takes to fit there; false if it does not anyway
+  bool UpdateInPlace(TablePage *page, const Tuple &tuple, Tuple &old_tuple,
+                     const RID &rid, Transaction *txn);
+
   /**
    * Members
    */
@@ -60,6 +200,11 @@ private:
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_;
+  VersionStore *version_store_;
+  TupleVersionTable *tuple_versions_;
+  FreeSpaceMap *free_space_map_;
+  Schema *schema_;
+  ZoneMap *zone_map_;
 };
 
 } // namespace cmudb
@@ -2,6 +2,21 @@
  * table_iterator.h
  *
  * For seq scan of table heap
+ *
+ * A scan that reads the tuples as the pages have them keeps a TupleView of
+ * the current one and copies it only when it is dereferenced; GetValue
+ * reads a column without the copy. Snapshot and optimistic scans may read
+ * a version the page does not have, they copy every tuple.
+ *
+ * With ranges and a zone map on the table heap, the iterator goes from a
+ * page to the next one the map says may have tuples in them, the pages in
+ * between are not read. It still returns the tuples of those pages that
+ * are out of range, ranges only skip pages.
+ *
+ * With a filter it returns only the tuples matching it. A scan reading in
+ * place selects the matching slots of a page as it reaches it, and of the
+ * slots added behind them once those are passed; a tuple of a page the
+ * scan is on is filtered as it was then.
  */
 
 #pragma once
@@ -9,17 +24,27 @@
 #include <cassert>
 
 #include "common/rid.h"
+#include "table/scan_filter.h"
 #include "table/tuple.h"
+#include "table/tuple_view.h"
+#include "table/zone_map.h"
 
 namespace cmudb {
 
 class TableHeap;
+class TablePage;
 
 class TableIterator {
   friend class Cursor;
 
 public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                const std::vector<ScanRange> &ranges =
+                    std::vector<ScanRange>(),
+                const ScanFilter &filter = ScanFilter());
+
+  TableIterator(const TableIterator &other);
+  TableIterator &operator=(const TableIterator &other);
 
   ~TableIterator() { delete tuple_; }
 
@@ -39,10 +64,79 @@ public:
 
   TableIterator operator++(int);
 
+  // column column_id of the current tuple, without copying the tuple; a
+  // varchar is copied into arena if there is one
+  Value GetValue(Schema *schema, int column_id, Arena *arena = nullptr);
+
+  // the inlined column column_id as a T, the same way, see
+  // Tuple::GetFixed; 0 if the tuple is gone
+  template <typename T> T GetFixed(Schema *schema, int column_id) {
+    if (copied_) {
+      return tuple_->GetFixed<T>(schema, column_id);
+    }
+    T value = 0;
+    view_.GetFixed(schema, column_id, value);
+    return value;
+  }
+
+  // f(data, len) on the varchar column_id of the current tuple in place,
+  // see TupleView::ReadString
+  template <typename F> bool ReadString(Schema *schema, int column_id, F f) {
+    if (copied_) {
+      const char *data;
+      uint32_t len;
+      if (!tuple_->GetStringView(schema, column_id, data, len)) {
+        return false;
+      }
+      f(data, len);
+      return true;
+    }
+    return view_.ReadString(schema, column_id, f);
+  }
+
+  inline RID GetRid() const { return tuple_->rid_; }
+
 private:
+  // the tuple at tuple_->rid_ on cur_page, latched, or copied into tuple_
+  // by GetTuple; false if the transaction does not see it
+  bool Read(TablePage *cur_page);
+  // tuple_ has the current tuple, copied from the view if it did not
+  void Copy();
+  // hint the next page of the heap to the buffer pool
+  void ReadAhead(TablePage *cur_page);
+  // the page read after cur_page, by the zone map if there are ranges
+  page_id_t NextPageId(TablePage *cur_page);
+  // the first tuple of cur_page the scan returns, latched, into rid; false
+  // if none
+  bool FirstTupleRid(TablePage *cur_page, RID &rid);
+  // the one after tuple_->rid_ on cur_page, the same way
+  bool NextTupleRid(TablePage *cur_page, RID &rid);
+  // the next slot of selection_ on cur_page, the first if first, selected
+  // anew once they are passed; false if none is left
+  bool NextSelected(TablePage *cur_page, bool first, RID &rid);
+  // whether the tuple read matches filter_, for scans that copy it; the
+  // others only read selected ones
+  bool Matches();
+  // whether tuples the transaction does not see are skipped: by snapshot
+  // scans, and by optimistic ones over their own deletes
+  bool SkipsUnseen();
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  // the current tuple, when tuple_ only has its rid
+  TupleView view_;
+  bool copied_ = true;
+  // last page handed to the buffer pool as read-ahead hint
+  page_id_t read_ahead_page_id_ = INVALID_PAGE_ID;
+  std::vector<ScanRange> ranges_;
+  ScanFilter filter_;
+  // for a filtered scan in place, the matching slots of the page it is on,
+  // of the first selection_end_ slots; selection_[selected_] is current
+  std::vector<uint32_t> selection_;
+  size_t selected_ = 0;
+  page_id_t selection_page_id_ = INVALID_PAGE_ID;
+  uint32_t selection_end_ = 0;
 };
 
 } // namespace cmudb
\ No newline at end of file
@@ -0,0 +1,89 @@
+/**
+ * table_stats.h
+ *
+ * Statistics of a table for choosing between its index and a full scan:
+ * row and page counts and, per column, the number of distinct values and
+ * an equi-depth histogram of STATS_HISTOGRAM_BUCKETS buckets. They come
+ * from a reservoir sample of STATS_SAMPLE_SIZE tuples, taken by a scan of
+ * the heap. Writes keep them roughly current: counts are kept exact,
+ * inserted tuples go on feeding the reservoir, and the per-column numbers
+ * are worked out of the sample again once STATS_REBUILD_SHARE of the rows
+ * changed. Estimates are shares of the rows, in [0, 1].
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "common/config.h"
+#include "table/tuple.h"
+
+namespace cmudb {
+
+class TableHeap;
+
+// per-column numbers, of the sample
+struct ColumnStats {
+  double distinct_count = 0; // estimated for the table, at least 1
+  // upper bounds of the buckets, each holding about as many sampled values
+  std::vector<Value> bounds;
+  size_t null_count = 0; // sampled nulls
+};
+
+class TableStats {
+public:
+  // page_size: of the pages of the table
+  TableStats(Schema *schema, size_t page_size,
+             size_t sample_size = STATS_SAMPLE_SIZE);
+
+  // start over from a scan of table_heap
+  void Gather(TableHeap *table_heap);
+
+  // writes to the table
+  void RecordInsert(const Tuple &tuple);
+  void RecordDelete();
+
+  size_t GetRowCount();
+  size_t GetPageCount();
+  ColumnStats GetColumnStats(int column_id);
+
+  // share of the rows with column_id equal to some value
+  double EstimateEquals(int column_id);
+  // the same, for value; values frequent in the sample go by their share
+  double EstimateEquals(int column_id, const Value &value);
+  // share of the rows with column_id in [low, high], either nullptr for
+  // no bound
+  double EstimateRange(int column_id, const Value *low, const Value *high);
+
+private:
+  // a tuple seen among rows_seen_, into the reservoir or not; latched
+  void Sample(const Tuple &tuple);
+  // the column stats again from the sample if too much changed; latched
+  void Refresh();
+  // share of the sampled values of column_id below value, or at most it
+  double ShareBelow(const ColumnStats &stats, const Value &value,
+                    bool inclusive);
+
+  Schema *schema_;
+  size_t page_size_;
+  size_t sample_size_;
+  std::mutex latch_;
+  std::vector<Tuple> sample_;
+  // tuples the reservoir chose from
+  size_t rows_seen_ = 0;
+  size_t row_count_ = 0;
+  size_t page_count_ = 0;
+  // bytes inserted since the pages were counted, for the pages they took
+  size_t inserted_bytes_ = 0;
+  // rows inserted or deleted since the column stats were worked out
+  size_t changed_ = 0;
+  bool stale_ = true;
+  std::vector<ColumnStats> columns_;
+  std::mt19937_64 random_;
+};
+
+} // namespace cmudb
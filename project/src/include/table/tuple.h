@@ -5,16 +5,26 @@
  *  ------------------------------------------------------------------
  * | FIXED-SIZE or VARIED-SIZED OFFSET | PAYLOAD OF VARIED-SIZED FIELD|
  *  ------------------------------------------------------------------
+ *
+ * A varchar the table heap spilled keeps its length with
+ * VARCHAR_OVERFLOW_FLAG set, the first page of its overflow chain and
+ * OVERFLOW_PREFIX_SIZE bytes of it in the payload, the rest in the chain.
  */
 
 #pragma once
 
+#include <cassert>
+#include <vector>
+
 #include "catalog/schema.h"
+#include "common/arena.h"
 #include "common/rid.h"
 #include "type/value.h"
 
 namespace cmudb {
 
+class BufferPoolManager;
+
 class Tuple {
   friend class TablePage;
 
@@ -22,16 +32,22 @@ class Tuple {
 
   friend class TableIterator;
 
+  friend class TupleView;
+
 public:
   // Default constructor (to create a dummy tuple)
   inline Tuple() : allocated_(false), rid_(RID()), size_(0), data_(nullptr) {}
 
   // constructor for table heap tuple
-  Tuple(RID rid) : allocated_(false), rid_(rid) {}
+  Tuple(RID rid) : allocated_(false), rid_(rid), size_(0), data_(nullptr) {}
 
   // constructor for creating a new tuple based on input value
   Tuple(std::vector<Value> values, Schema *schema);
 
+  // the same, its data in arena: copies of it are shallow and none of them
+  // outlives the next reset of arena
+  Tuple(const std::vector<Value> &values, Schema *schema, Arena *arena);
+
   // copy constructor, deep copy
   Tuple(const Tuple &other);
 
@@ -40,7 +56,7 @@ public:
 
   ~Tuple() {
     if (allocated_)
-      delete[] data_;
+      Free(data_);
     allocated_ = false;
     data_ = nullptr;
   }
@@ -63,6 +79,41 @@ public:
   // checks the schema to see how to return the Value.
   Value GetValue(Schema *schema, const int column_id) const;
 
+  // the same, a varchar referring to a copy in arena instead of owning one
+  Value GetValue(Schema *schema, const int column_id, Arena *arena) const;
+
+  // typed reads of a column, straight from the schema offset without a
+  // Value; the column has to be inlined and of the size read. Nulls come
+  // back as the PELOTON_*_NULL of the type
+  template <typename T>
+  inline T GetFixed(Schema *schema, const int column_id) const {
+    assert(data_);
+    assert(schema->IsInlined(column_id));
+    assert(schema->GetLength(column_id) == static_cast<int32_t>(sizeof(T)));
+    return *reinterpret_cast<const T *>(data_ + schema->GetOffset(column_id));
+  }
+  inline int8_t GetInt8(Schema *schema, const int column_id) const {
+    return GetFixed<int8_t>(schema, column_id);
+  }
+  inline int16_t GetInt16(Schema *schema, const int column_id) const {
+    return GetFixed<int16_t>(schema, column_id);
+  }
+  inline int32_t GetInt32(Schema *schema, const int column_id) const {
+    return GetFixed<int32_t>(schema, column_id);
+  }
+  inline int64_t GetInt64(Schema *schema, const int column_id) const {
+    return GetFixed<int64_t>(schema, column_id);
+  }
+  inline double GetDouble(Schema *schema, const int column_id) const {
+    return GetFixed<double>(schema, column_id);
+  }
+
+  // the varchar column_id in place: len bytes at data, the terminating
+  // null not counted; valid as long as the tuple data is. False if it is
+  // null or spilled, GetValue reads it then
+  bool GetStringView(Schema *schema, const int column_id, const char *&data,
+                     uint32_t &len) const;
+
   // Is the column value null ?
   inline bool IsNull(Schema *schema, const int column_id) const {
     Value value = GetValue(schema, column_id);
@@ -70,16 +121,58 @@ public:
   }
   inline bool IsAllocated() { return allocated_; }
 
+  // a tuple referring to data it does not own, of an arena say, copies it
+  void Detach();
+
   std::string ToString(Schema *schema) const;
 
+  // this tuple in spilled, with its longest varchars in overflow chains of
+  // buffer_pool_manager, longest first until it is max_size at most or no
+  // varchar is worth it; spilled is this then. False if a chain could not
+  // be written
+  bool Spill(Schema *schema, BufferPoolManager *buffer_pool_manager,
+             int32_t max_size, Tuple &spilled) const;
+
+  // first pages of the overflow chains of the spilled varchars
+  std::vector<page_id_t> GetOverflowPages(Schema *schema) const;
+
+  // where GetValue reads spilled varchars from, set by the table heap
+  inline void SetOverflowPool(BufferPoolManager *buffer_pool_manager) {
+    overflow_pool_ = buffer_pool_manager;
+  }
+
 private:
   // Get the starting storage address of specific column
   const char *GetDataPtr(Schema *schema, const int column_id) const;
+  // bytes of the varchar payload at data_ptr, length field included
+  static int32_t GetPayloadSize(const char *data_ptr);
+  // size of the tuple of values
+  static int32_t GetSerializedSize(const std::vector<Value> &values,
+                                   Schema *schema);
+  // values into data_, of the size above
+  void SerializeValues(const std::vector<Value> &values, Schema *schema);
+  // the value of a column at data_ptr, spilled varchars read from
+  // overflow_pool. A varchar is copied into arena if there is one
+  static Value DeserializeValue(const char *data_ptr, TypeId column_type,
+                                bool is_inlined,
+                                BufferPoolManager *overflow_pool,
+                                Arena *arena = nullptr);
+  // the varchar at data_ptr in place, see GetStringView
+  static bool ViewString(const char *data_ptr, const char *&data,
+                         uint32_t &len);
+
+  // owned data of size bytes, counted by the memory tracker; Free takes
+  // only what Allocate returned
+  static char *Allocate(int32_t size);
+  static void Free(char *data);
+
+  static const uint32_t VARCHAR_OVERFLOW_FLAG = 0x40000000;
 
   bool allocated_; // is allocated?
   RID rid_;        // if pointing to the table heap, the rid is valid
   int32_t size_;
   char *data_;
+  BufferPoolManager *overflow_pool_ = nullptr;
 };
 
 } // namespace cmudb
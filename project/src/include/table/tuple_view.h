@@ -0,0 +1,95 @@
+/**
+ * tuple_view.h
+ *
+ * The tuple at a rid, read from its page in place. A view keeps the page
+ * pinned for as long as it lives, but not latched: every read latches the
+ * page and looks the tuple up in its slot again, so it sees the tuple as
+ * the page has it then and compaction moving it is fine. Only the value
+ * read is copied, not the tuple, and a PAX page only has its column read.
+ */
+
+#pragma once
+
+#include <cassert>
+
+#include "buffer/buffer_pool_manager.h"
+#include "page/table_page.h"
+#include "table/tuple.h"
+
+namespace cmudb {
+
+class TupleView {
+public:
+  TupleView() : buffer_pool_manager_(nullptr), page_(nullptr) {}
+
+  TupleView(BufferPoolManager *buffer_pool_manager, const RID &rid)
+      : TupleView() {
+    Reset(buffer_pool_manager, rid);
+  }
+
+  // a copy pins the page once more
+  TupleView(const TupleView &other);
+  TupleView &operator=(const TupleView &other);
+
+  ~TupleView() { Release(); }
+
+  // view rid instead, the pin is kept if it is on the same page. False if
+  // its page can not be pinned
+  bool Reset(BufferPoolManager *buffer_pool_manager, const RID &rid);
+
+  // drop the pin, the view is empty then
+  void Release();
+
+  inline bool IsValid() const { return page_ != nullptr; }
+
+  inline RID GetRid() const { return rid_; }
+
+  // column_id of the tuple, a null value if it is gone. A varchar is
+  // copied into arena if there is one, see Tuple::GetValue
+  Value GetValue(Schema *schema, int column_id, Arena *arena = nullptr);
+
+  // the inlined column_id as a T, see Tuple::GetFixed; false if the tuple
+  // is gone
+  template <typename T>
+  bool GetFixed(Schema *schema, int column_id, T &value) {
+    assert(page_ != nullptr);
+    assert(schema->IsInlined(column_id));
+    assert(schema->GetLength(column_id) == static_cast<int32_t>(sizeof(T)));
+    page_->RLatch();
+    const char *data_ptr = page_->GetColumnData(rid_, schema, column_id);
+    if (data_ptr != nullptr) {
+      value = *reinterpret_cast<const T *>(data_ptr);
+    }
+    page_->RUnlatch();
+    return data_ptr != nullptr;
+  }
+
+  // f(data, len) on the varchar column_id in place, under the page latch:
+  // len bytes at data, the terminating null not counted, see
+  // Tuple::GetStringView. False if the tuple is gone or the varchar null or
+  // spilled, GetValue reads it then
+  template <typename F> bool ReadString(Schema *schema, int column_id, F f) {
+    assert(page_ != nullptr);
+    assert(!schema->IsInlined(column_id));
+    page_->RLatch();
+    const char *data_ptr = page_->GetColumnData(rid_, schema, column_id);
+    const char *data;
+    uint32_t len;
+    bool found = data_ptr != nullptr && Tuple::ViewString(data_ptr, data, len);
+    if (found) {
+      f(data, len);
+    }
+    page_->RUnlatch();
+    return found;
+  }
+
+  // a copy of the tuple, false if it is gone
+  bool Materialize(Tuple &tuple);
+
+private:
+  BufferPoolManager *buffer_pool_manager_;
+  TablePage *page_;
+  RID rid_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,100 @@
+/**
+ * zone_map.h
+ *
+ * Zone map of a table heap: the smallest and largest value each page of
+ * its chain has of some columns, so a scan with a range on one of them
+ * skips the pages that cannot have a match, without reading them. Inserts
+ * and updates widen the ranges of their page, deletes leave them as they
+ * are: a range may be wider than the page is, never narrower, which is
+ * what a snapshot scan needs of pages having had its versions.
+ *
+ * The map is kept in memory only, built from a walk of the page chain when
+ * the table is opened. It keeps the pages in chain order, a new page is
+ * added behind the last one when the table heap links it.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/schema.h"
+#include "table/tuple.h"
+
+namespace cmudb {
+
+// low <= column_id <= high, either bound left out for none; a strict
+// bound is kept as inclusive, the map only tells pages out
+struct ScanRange {
+  ScanRange(int column_id) : column_id(column_id) {}
+
+  int column_id;
+  Value low = Value(TypeId::INVALID);
+  Value high = Value(TypeId::INVALID);
+  bool has_low = false;
+  bool has_high = false;
+};
+
+class ZoneMap {
+public:
+  // the map of column_ids of the heap with schema
+  ZoneMap(Schema *schema, const std::vector<int> &column_ids);
+
+  ZoneMap(const ZoneMap &) = delete;
+  ZoneMap &operator=(const ZoneMap &) = delete;
+
+  // start over from a walk of the chain from first_page_id
+  void Rebuild(BufferPoolManager *buffer_pool_manager,
+               page_id_t first_page_id);
+
+  // page_id is linked behind the last page of the chain
+  void AddPage(page_id_t page_id);
+
+  // tuple went to page_id
+  void Record(page_id_t page_id, const Tuple &tuple);
+
+  // whether the map has column_id
+  bool IsTracked(int column_id) const;
+
+  // whether page_id may have tuples in all of ranges; a page or a column
+  // not in the map may
+  bool MayMatch(page_id_t page_id, const std::vector<ScanRange> &ranges);
+
+  // the first page after page_id in chain order that may match ranges,
+  // from the first page on for INVALID_PAGE_ID; INVALID_PAGE_ID if none
+  page_id_t NextPage(page_id_t page_id, const std::vector<ScanRange> &ranges);
+
+  // pages in the map, for tests
+  size_t GetPageCount();
+
+private:
+  // the range of the columns of a page, empty ones without a tuple yet
+  struct Zone {
+    std::vector<Value> min;
+    std::vector<Value> max;
+    bool empty = true;
+  };
+
+  // Record, latched
+  void Widen(Zone &zone, const Tuple &tuple);
+  // Rebuild of a page of inlined columns, latched
+  void Summarize(Zone &zone, const std::vector<std::vector<char>> &columns,
+                 size_t count);
+  // MayMatch, latched
+  bool Overlaps(const Zone &zone, const std::vector<ScanRange> &ranges);
+  // the zone of page_id, added behind the last page if it is new; latched
+  size_t IndexOf(page_id_t page_id);
+
+  Schema *schema_;
+  std::vector<int> column_ids_;
+  // where each column is in column_ids_, -1 if it is not
+  std::vector<int> slot_of_;
+  std::vector<page_id_t> page_ids_;
+  std::vector<Zone> zones_;
+  std::unordered_map<page_id_t, size_t> index_of_;
+  std::mutex latch_;
+};
+
+} // namespace cmudb
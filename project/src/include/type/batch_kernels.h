@@ -0,0 +1,362 @@
+/**
+ * batch_kernels.h
+ *
+ * Comparisons, arithmetic and reductions over contiguous arrays of one
+ * fixed-size type, TINYINT through BIGINT and DECIMAL, as a PAX minipage or
+ * a column gathered from the tuples of a page holds them. A Value goes
+ * through a virtual call of its Type per operation, these go through one
+ * loop per array without branches in its body, which the compiler turns
+ * into SIMD instructions.
+ *
+ * Nulls are the PELOTON_*_NULL of the type, as in a tuple: they never
+ * satisfy a comparison, make a null result and are left out of reductions,
+ * as the Value operations do. Overflows throw as theirs, once for the array.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "common/exception.h"
+#include "type/limits.h"
+#include "type/value.h"
+
+namespace cmudb {
+
+// the comparison of Select
+enum class BatchCmp { EQ, NE, LT, LE, GT, GE };
+
+class BatchKernels {
+public:
+  // the null of T
+  template <typename T> static inline T Null();
+
+  /**
+   * Selection vectors: the positions of the values that compare true with
+   * constant, in order. selection has room for count positions
+   */
+  // positions i < count of column, how many
+  template <typename T>
+  static size_t Select(const T *column, size_t count, BatchCmp op, T constant,
+                       uint32_t *selection);
+  // the positions of selection, count of them, that hold still; narrowed in
+  // place, how many are left
+  template <typename T>
+  static size_t Refine(const T *column, uint32_t *selection, size_t count,
+                       BatchCmp op, T constant);
+
+  /**
+   * Arithmetic: result[i] = left[i] op right[i], result may be left or
+   * right
+   */
+  template <typename T>
+  static void Add(const T *left, const T *right, T *result, size_t count);
+  template <typename T>
+  static void Subtract(const T *left, const T *right, T *result, size_t count);
+  template <typename T>
+  static void Multiply(const T *left, const T *right, T *result, size_t count);
+
+  /**
+   * Reductions over the values that are not null, false if there is none
+   */
+  template <typename T> static bool Min(const T *column, size_t count, T &min);
+  template <typename T> static bool Max(const T *column, size_t count, T &max);
+  // a BIGINT for the integers, a DECIMAL for DECIMAL
+  template <typename T>
+  static bool Sum(const T *column, size_t count,
+                  typename std::conditional<std::is_integral<T>::value,
+                                            int64_t, double>::type &sum);
+
+  /**
+   * The same by type_id on raw arrays of its size, for callers that have a
+   * schema rather than a type. Results are Values, null ones for none
+   */
+  // constant is cast to type_id
+  static size_t Select(TypeId type_id, const char *column, size_t count,
+                       BatchCmp op, const Value &constant,
+                       uint32_t *selection);
+  static void Add(TypeId type_id, const char *left, const char *right,
+                  char *result, size_t count);
+  static void Subtract(TypeId type_id, const char *left, const char *right,
+                       char *result, size_t count);
+  static void Multiply(TypeId type_id, const char *left, const char *right,
+                       char *result, size_t count);
+  static Value Min(TypeId type_id, const char *column, size_t count);
+  static Value Max(TypeId type_id, const char *column, size_t count);
+  static Value Sum(TypeId type_id, const char *column, size_t count);
+
+private:
+  template <typename T, typename Cmp>
+  static size_t SelectWith(const T *column, size_t count, T constant,
+                           uint32_t *selection, Cmp cmp);
+  template <typename T, typename Cmp>
+  static size_t RefineWith(const T *column, uint32_t *selection, size_t count,
+                           T constant, Cmp cmp);
+
+  /*
+   * x op y into result, whether it overflowed. Integers narrower than 64
+   * bits are computed as BIGINTs and checked to fit; BIGINTs wrap and are
+   * checked by their signs, but for products, which have no wider type.
+   * DECIMALs do not overflow
+   */
+  template <typename T> static inline bool AddChecked(T x, T y, T &result) {
+    int64_t wide = static_cast<int64_t>(x) + static_cast<int64_t>(y);
+    result = static_cast<T>(wide);
+    return !Fits<T>(wide);
+  }
+  template <typename T>
+  static inline bool SubtractChecked(T x, T y, T &result) {
+    int64_t wide = static_cast<int64_t>(x) - static_cast<int64_t>(y);
+    result = static_cast<T>(wide);
+    return !Fits<T>(wide);
+  }
+  template <typename T>
+  static inline bool MultiplyChecked(T x, T y, T &result) {
+    int64_t wide = static_cast<int64_t>(x) * static_cast<int64_t>(y);
+    result = static_cast<T>(wide);
+    return !Fits<T>(wide);
+  }
+  // an overflow has both operands of the other sign than the sum
+  static inline bool AddChecked(int64_t x, int64_t y, int64_t &result) {
+    result = static_cast<int64_t>(static_cast<uint64_t>(x) +
+                                  static_cast<uint64_t>(y));
+    return ((x ^ result) & (y ^ result)) < 0;
+  }
+  // an overflow has x of another sign than y and the difference
+  static inline bool SubtractChecked(int64_t x, int64_t y, int64_t &result) {
+    result = static_cast<int64_t>(static_cast<uint64_t>(x) -
+                                  static_cast<uint64_t>(y));
+    return ((x ^ y) & (x ^ result)) < 0;
+  }
+  static inline bool MultiplyChecked(int64_t x, int64_t y, int64_t &result) {
+    return __builtin_mul_overflow(x, y, &result);
+  }
+  static inline bool AddChecked(double x, double y, double &result) {
+    result = x + y;
+    return false;
+  }
+  static inline bool SubtractChecked(double x, double y, double &result) {
+    result = x - y;
+    return false;
+  }
+  static inline bool MultiplyChecked(double x, double y, double &result) {
+    result = x * y;
+    return false;
+  }
+  template <typename T> static inline bool Fits(int64_t value) {
+    return value >= std::numeric_limits<T>::min() &&
+           value <= std::numeric_limits<T>::max();
+  }
+  static inline void ThrowOutOfRange() {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE, "Numeric value out of range.");
+  }
+};
+
+template <> inline int8_t BatchKernels::Null<int8_t>() {
+  return PELOTON_INT8_NULL;
+}
+template <> inline int16_t BatchKernels::Null<int16_t>() {
+  return PELOTON_INT16_NULL;
+}
+template <> inline int32_t BatchKernels::Null<int32_t>() {
+  return PELOTON_INT32_NULL;
+}
+template <> inline int64_t BatchKernels::Null<int64_t>() {
+  return PELOTON_INT64_NULL;
+}
+template <> inline double BatchKernels::Null<double>() {
+  return PELOTON_DECIMAL_NULL;
+}
+
+/*
+ * Every position is written, the count only grows by the ones that hold, so
+ * the loop has no branch
+ */
+template <typename T, typename Cmp>
+size_t BatchKernels::SelectWith(const T *column, size_t count, T constant,
+                                uint32_t *selection, Cmp cmp) {
+  size_t selected = 0;
+  for (size_t i = 0; i < count; i++) {
+    selection[selected] = static_cast<uint32_t>(i);
+    selected += cmp(column[i], constant) & (column[i] != Null<T>());
+  }
+  return selected;
+}
+
+template <typename T, typename Cmp>
+size_t BatchKernels::RefineWith(const T *column, uint32_t *selection,
+                                size_t count, T constant, Cmp cmp) {
+  size_t selected = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t position = selection[i];
+    T value = column[position];
+    selection[selected] = position;
+    selected += cmp(value, constant) & (value != Null<T>());
+  }
+  return selected;
+}
+
+template <typename T>
+size_t BatchKernels::Select(const T *column, size_t count, BatchCmp op,
+                            T constant, uint32_t *selection) {
+  if (constant == Null<T>())
+    return 0;
+  switch (op) {
+  case BatchCmp::EQ:
+    return SelectWith(column, count, constant, selection,
+                      [](T a, T b) { return a == b; });
+  case BatchCmp::NE:
+    return SelectWith(column, count, constant, selection,
+                      [](T a, T b) { return a != b; });
+  case BatchCmp::LT:
+    return SelectWith(column, count, constant, selection,
+                      [](T a, T b) { return a < b; });
+  case BatchCmp::LE:
+    return SelectWith(column, count, constant, selection,
+                      [](T a, T b) { return a <= b; });
+  case BatchCmp::GT:
+    return SelectWith(column, count, constant, selection,
+                      [](T a, T b) { return a > b; });
+  case BatchCmp::GE:
+    return SelectWith(column, count, constant, selection,
+                      [](T a, T b) { return a >= b; });
+  }
+  return 0;
+}
+
+template <typename T>
+size_t BatchKernels::Refine(const T *column, uint32_t *selection,
+                            size_t count, BatchCmp op, T constant) {
+  if (constant == Null<T>())
+    return 0;
+  switch (op) {
+  case BatchCmp::EQ:
+    return RefineWith(column, selection, count, constant,
+                      [](T a, T b) { return a == b; });
+  case BatchCmp::NE:
+    return RefineWith(column, selection, count, constant,
+                      [](T a, T b) { return a != b; });
+  case BatchCmp::LT:
+    return RefineWith(column, selection, count, constant,
+                      [](T a, T b) { return a < b; });
+  case BatchCmp::LE:
+    return RefineWith(column, selection, count, constant,
+                      [](T a, T b) { return a <= b; });
+  case BatchCmp::GT:
+    return RefineWith(column, selection, count, constant,
+                      [](T a, T b) { return a > b; });
+  case BatchCmp::GE:
+    return RefineWith(column, selection, count, constant,
+                      [](T a, T b) { return a >= b; });
+  }
+  return 0;
+}
+
+template <typename T>
+void BatchKernels::Add(const T *left, const T *right, T *result,
+                       size_t count) {
+  bool overflow = false;
+  for (size_t i = 0; i < count; i++) {
+    T x = left[i], y = right[i];
+    bool null = (x == Null<T>()) | (y == Null<T>());
+    T sum;
+    overflow |= !null & AddChecked(x, y, sum);
+    result[i] = null ? Null<T>() : sum;
+  }
+  if (overflow)
+    ThrowOutOfRange();
+}
+
+template <typename T>
+void BatchKernels::Subtract(const T *left, const T *right, T *result,
+                            size_t count) {
+  bool overflow = false;
+  for (size_t i = 0; i < count; i++) {
+    T x = left[i], y = right[i];
+    bool null = (x == Null<T>()) | (y == Null<T>());
+    T diff;
+    overflow |= !null & SubtractChecked(x, y, diff);
+    result[i] = null ? Null<T>() : diff;
+  }
+  if (overflow)
+    ThrowOutOfRange();
+}
+
+template <typename T>
+void BatchKernels::Multiply(const T *left, const T *right, T *result,
+                            size_t count) {
+  bool overflow = false;
+  for (size_t i = 0; i < count; i++) {
+    T x = left[i], y = right[i];
+    bool null = (x == Null<T>()) | (y == Null<T>());
+    T prod;
+    overflow |= !null & MultiplyChecked(x, y, prod);
+    result[i] = null ? Null<T>() : prod;
+  }
+  if (overflow)
+    ThrowOutOfRange();
+}
+
+/*
+ * Nulls count as the largest value for Min, the smallest for Max, so they
+ * never win
+ */
+template <typename T>
+bool BatchKernels::Min(const T *column, size_t count, T &min) {
+  T result = std::numeric_limits<T>::max();
+  size_t valid = 0;
+  for (size_t i = 0; i < count; i++) {
+    bool null = column[i] == Null<T>();
+    T value = null ? std::numeric_limits<T>::max() : column[i];
+    result = value < result ? value : result;
+    valid += !null;
+  }
+  if (valid == 0)
+    return false;
+  min = result;
+  return true;
+}
+
+template <typename T>
+bool BatchKernels::Max(const T *column, size_t count, T &max) {
+  T result = std::numeric_limits<T>::lowest();
+  size_t valid = 0;
+  for (size_t i = 0; i < count; i++) {
+    bool null = column[i] == Null<T>();
+    T value = null ? std::numeric_limits<T>::lowest() : column[i];
+    result = value > result ? value : result;
+    valid += !null;
+  }
+  if (valid == 0)
+    return false;
+  max = result;
+  return true;
+}
+
+template <typename T>
+bool BatchKernels::Sum(
+    const T *column, size_t count,
+    typename std::conditional<std::is_integral<T>::value, int64_t,
+                              double>::type &sum) {
+  typedef typename std::conditional<std::is_integral<T>::value, int64_t,
+                                    double>::type Sum;
+  Sum result = 0;
+  size_t valid = 0;
+  bool overflow = false;
+  for (size_t i = 0; i < count; i++) {
+    bool null = column[i] == Null<T>();
+    Sum value = null ? 0 : static_cast<Sum>(column[i]);
+    overflow |= AddChecked(result, value, result);
+    valid += !null;
+  }
+  if (overflow)
+    ThrowOutOfRange();
+  if (valid == 0)
+    return false;
+  sum = result;
+  return true;
+}
+
+} // namespace cmudb
@@ -0,0 +1,121 @@
+/**
+ * type_dispatch.h
+ *
+ * A Value reaches the code of its type through a virtual call into the Type
+ * singleton, once per operation. Where the types are known ahead, as the
+ * column types of a schema, the code is bound once instead: DispatchType
+ * calls a generic lambda with the TypeId as a compile-time constant, so
+ * every type, or pair of types for DispatchTypePair, gets an instance of
+ * it, and the Get* functions hand out pointers to such instances for the
+ * schema to keep, see Schema::GetComparator.
+ *
+ * Stored values are the bytes a tuple keeps, see Value::SerializeTo.
+ */
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "common/exception.h"
+#include "type/limits.h"
+#include "type/value.h"
+
+namespace cmudb {
+
+// the C++ type a fixed-size type is stored as, its null and its range
+template <TypeId Id> struct StoredType;
+
+template <> struct StoredType<TypeId::BOOLEAN> {
+  typedef int8_t type;
+  static inline type Null() { return PELOTON_BOOLEAN_NULL; }
+  static inline type Min() { return PELOTON_BOOLEAN_MIN; }
+  static inline type Max() { return PELOTON_BOOLEAN_MAX; }
+};
+template <> struct StoredType<TypeId::TINYINT> {
+  typedef int8_t type;
+  static inline type Null() { return PELOTON_INT8_NULL; }
+  static inline type Min() { return PELOTON_INT8_MIN; }
+  static inline type Max() { return PELOTON_INT8_MAX; }
+};
+template <> struct StoredType<TypeId::SMALLINT> {
+  typedef int16_t type;
+  static inline type Null() { return PELOTON_INT16_NULL; }
+  static inline type Min() { return PELOTON_INT16_MIN; }
+  static inline type Max() { return PELOTON_INT16_MAX; }
+};
+template <> struct StoredType<TypeId::INTEGER> {
+  typedef int32_t type;
+  static inline type Null() { return PELOTON_INT32_NULL; }
+  static inline type Min() { return PELOTON_INT32_MIN; }
+  static inline type Max() { return PELOTON_INT32_MAX; }
+};
+template <> struct StoredType<TypeId::BIGINT> {
+  typedef int64_t type;
+  static inline type Null() { return PELOTON_INT64_NULL; }
+  static inline type Min() { return PELOTON_INT64_MIN; }
+  static inline type Max() { return PELOTON_INT64_MAX; }
+};
+template <> struct StoredType<TypeId::DECIMAL> {
+  typedef double type;
+  static inline type Null() { return PELOTON_DECIMAL_NULL; }
+  static inline type Min() { return PELOTON_DECIMAL_MIN; }
+  static inline type Max() { return PELOTON_DECIMAL_MAX; }
+};
+
+template <TypeId Id> using TypeConstant = std::integral_constant<TypeId, Id>;
+// the C++ type of a TypeConstant
+template <typename Constant>
+using StoredTypeOf = typename StoredType<Constant::value>::type;
+
+// f(TypeConstant<type_id>()) for the fixed-size types, BOOLEAN through
+// DECIMAL; throws for the others
+template <typename F>
+inline auto DispatchType(TypeId type_id, F f)
+    -> decltype(f(TypeConstant<TypeId::INTEGER>())) {
+  switch (type_id) {
+  case TypeId::BOOLEAN:
+    return f(TypeConstant<TypeId::BOOLEAN>());
+  case TypeId::TINYINT:
+    return f(TypeConstant<TypeId::TINYINT>());
+  case TypeId::SMALLINT:
+    return f(TypeConstant<TypeId::SMALLINT>());
+  case TypeId::INTEGER:
+    return f(TypeConstant<TypeId::INTEGER>());
+  case TypeId::BIGINT:
+    return f(TypeConstant<TypeId::BIGINT>());
+  case TypeId::DECIMAL:
+    return f(TypeConstant<TypeId::DECIMAL>());
+  default:
+    throw Exception(EXCEPTION_TYPE_MISMATCH_TYPE,
+                    "no fixed-size type to dispatch on");
+  }
+}
+
+// f(TypeConstant<left>(), TypeConstant<right>()), an instance per pair
+template <typename F>
+inline auto DispatchTypePair(TypeId left, TypeId right, F f)
+    -> decltype(f(TypeConstant<TypeId::INTEGER>(),
+                  TypeConstant<TypeId::INTEGER>())) {
+  return DispatchType(left, [&](auto l) {
+    return DispatchType(right, [&](auto r) { return f(l, r); });
+  });
+}
+
+// the stored left against the stored right, -1, 0 or 1. A null is equal to
+// anything, a compare of Values with it is neither less nor greater
+typedef int (*StoredComparator)(const char *left, const char *right);
+// value, of the type, into storage as Value::SerializeTo
+typedef void (*StoredSerializer)(const Value &value, char *storage);
+// the stored value as a Value of another type, as Value::CastAs
+typedef Value (*StoredCaster)(const char *storage);
+
+// for the fixed-size types, any pair of them, and VARCHAR against VARCHAR;
+// nullptr for the others
+StoredComparator GetStoredComparator(TypeId left, TypeId right);
+// for the fixed-size types and VARCHAR, nullptr for the others
+StoredSerializer GetStoredSerializer(TypeId type_id);
+// from and to TINYINT through DECIMAL, or a type to itself; nullptr for the
+// others
+StoredCaster GetStoredCaster(TypeId from, TypeId to);
+
+} // namespace cmudb
@@ -35,7 +35,8 @@ class Value {
   friend class VarlenType;
 
 public:
-  Value(const TypeId type) : manage_data_(false), type_id_(type) {
+  Value(const TypeId type)
+      : manage_data_(false), inlined_(false), type_id_(type) {
     size_.len = PELOTON_VALUE_NULL;
   }
   // BOOLEAN and TINYINT
@@ -51,7 +52,9 @@ public:
   Value(TypeId type, int64_t i);
   // TIMESTAMP
   Value(TypeId type, uint64_t i);
-  // VARCHAR
+  // VARCHAR. With manage_data the value keeps a copy of data, in the value
+  // itself if len is INLINE_VARCHAR_LEN at most; without, it refers to data,
+  // which has to outlive it and its copies
   Value(TypeId type, const char *data, uint32_t len, bool manage_data);
   Value(TypeId type, const std::string &data);
 
@@ -64,6 +67,7 @@ public:
     std::swap(first.value_, second.value_);
     std::swap(first.size_, second.size_);
     std::swap(first.manage_data_, second.manage_data_);
+    std::swap(first.inlined_, second.inlined_);
     std::swap(first.type_id_, second.type_id_);
   }
   // check whether value is integer
@@ -77,7 +81,8 @@ public:
   inline uint32_t GetLength() const {
     return Type::GetInstance(type_id_)->GetLength(*this);
   }
-  // Access the raw variable length data
+  // Access the raw variable length data. A varchar kept inlined has it in
+  // the value, valid as long as the value is
   inline const char *GetData() const {
     return Type::GetInstance(type_id_)->GetData(*this);
   }
@@ -163,6 +168,10 @@ public:
   // Create a copy of this value
   inline Value Copy() const { return Type::GetInstance(type_id_)->Copy(*this); }
 
+  // varchars of this length at most, the terminating null counted, are
+  // copied into the value instead of an allocation of their own
+  static const uint32_t INLINE_VARCHAR_LEN = 16;
+
 protected:
   // The actual value item
   union Val {
@@ -175,6 +184,7 @@ protected:
     uint64_t timestamp;
     char *varlen;
     const char *const_varlen;
+    char inline_varlen[INLINE_VARCHAR_LEN];
   } value_;
 
   union {
@@ -183,6 +193,8 @@ protected:
   } size_;
 
   bool manage_data_;
+  // a varchar in value_.inline_varlen
+  bool inlined_;
   // The data type
   TypeId type_id_;
 };
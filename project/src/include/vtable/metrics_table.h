@@ -0,0 +1,21 @@
+/**
+ * metrics_table.h
+ *
+ * vtable_metrics, a table-valued function over the metrics registry, see
+ * common/metrics.h: a row per metric, the histogram columns null for
+ * counters and gauges. Its argument keeps the metrics of a name prefix:
+ *
+ *   SELECT name, value FROM vtable_metrics('buffer.');
+ *   SELECT name, p50, p99, max FROM vtable_metrics WHERE kind = 'histogram';
+ */
+
+#pragma once
+
+#include "sqlite/sqlite3ext.h"
+
+namespace cmudb {
+
+// makes vtable_metrics available to db
+int RegisterMetricsTable(sqlite3 *db);
+
+} // namespace cmudb
@@ -4,30 +4,79 @@
 
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "buffer/buffer_pool_set.h"
 #include "buffer/lru_replacer.h"
+#include "common/numa.h"
+#include "common/task_scheduler.h"
+#include "catalog/catalog.h"
+#include "catalog/root_catalog.h"
 #include "catalog/schema.h"
 #include "concurrency/transaction_manager.h"
 #include "index/b_plus_tree_index.h"
+#include "index/index_builder.h"
+#include "logging/checkpoint_manager.h"
 #include "logging/log_manager.h"
 #include "sqlite/sqlite3ext.h"
+#include "table/dictionary.h"
 #include "table/table_heap.h"
+#include "table/table_stats.h"
 #include "table/tuple.h"
 #include "type/value.h"
 
 namespace cmudb {
 /* Helpers */
-Schema *ParseCreateStatement(const std::string &sql);
+// a column of type "dict varchar" is kept as the INTEGER code of its string,
+// its id goes to dictionary_columns if given, see Dictionary
+Schema *ParseCreateStatement(const std::string &sql,
+                             std::vector<int> *dictionary_columns = nullptr);
+
+// whether the last module argument, past the schema, is pax
+bool IsPaxArgument(int argc, const char *const *argv);
 
 IndexMetadata *ParseIndexStatement(std::string &sql,
                                    const std::string &table_name,
                                    Schema *schema);
 
-Tuple ConstructTuple(Schema *schema, sqlite3_value **argv);
+// the tuple of the values in argv; in arena if there is one, see Tuple. The
+// columns dictionary encodes get the codes of their strings, new ones added.
+// For a key, column i of schema is key_attrs[i] of the table, and a string
+// the dictionary does not have gets code -1, that no row has
+Tuple ConstructTuple(Schema *schema, sqlite3_value **argv,
+                     Arena *arena = nullptr, Dictionary *dictionary = nullptr,
+                     const std::vector<int> *key_attrs = nullptr);
+// the ranges of the argc constraints in argv of a zone map scan, idx_str
+// from VtabBestIndex; the strings of the columns dictionary encodes are
+// bounds as their codes
+std::vector<ScanRange> ConstructRanges(const char *idx_str, int argc,
+                                       sqlite3_value **argv,
+                                       Dictionary *dictionary = nullptr);
+// the predicates, on the columns of schema, of the same constraints the
+// cursor checks, see ScanFilter; false if no row can match them
+bool ConstructPredicates(Schema *schema, const char *idx_str, int argc,
+                         sqlite3_value **argv, Dictionary *dictionary,
+                         std::vector<ScanPredicate> &predicates);
+
+// the lowest and highest keys, of the key schema of index, the argc
+// constraints in argv of a key range scan allow, idx_str from VtabBestIndex:
+// equalities on the first key columns, then bounds on the next one. Columns
+// past those take the lowest and highest values of their types. Bounds are
+// inclusive, rounded to the type of the column and clamped to its range;
+// false if no key can be in the range
+bool ConstructKeyRange(Index *index, const char *idx_str, int argc,
+                       sqlite3_value **argv, Dictionary *dictionary,
+                       Tuple &low, Tuple &high);
 
 Index *ConstructIndex(IndexMetadata *metadata,
                       BufferPoolManager *buffer_pool_manager,
-                      page_id_t root_id = INVALID_PAGE_ID);
-Transaction *GetTransaction();
+                      page_id_t root_id = INVALID_PAGE_ID,
+                      LogManager *log_manager = nullptr,
+                      RootCatalog *root_catalog = nullptr);
 
 /* API declaration */
 int VtabCreate(sqlite3 *db, void *pAux, int argc, const char *const *argv,
@@ -59,55 +108,191 @@ int VtabCommit(sqlite3_vtab *pVTab);
 
 int VtabBegin(sqlite3_vtab *pVTab);
 
+int VtabRollback(sqlite3_vtab *pVTab);
+
 // storage engine
 class StorageEngine {
 public:
-  StorageEngine(std::string db_file_name) {
+  // page_size only applies to a new database file, see DiskManager
+  // persist_working_set: reload the pages resident at the last shutdown
+  // index_pool_size: if not 0, indexes get a pool of their own instead of
+  // sharing the buffer_pool_size frames with the table heaps
+  // numa_aware: pools get a partition per NUMA node, see BufferPoolManager
+  // background_threads: workers of the scheduler maintenance tasks share
+  StorageEngine(std::string db_file_name,
+                size_t buffer_pool_size = BUFFER_POOL_SIZE,
+                size_t page_size = PAGE_SIZE,
+                bool persist_working_set = false,
+                size_t index_pool_size = 0, bool numa_aware = false,
+                size_t background_threads = BACKGROUND_THREADS) {
     ENABLE_LOGGING = false;
 
+    scheduler_ = new TaskScheduler(background_threads);
+
     // storage related
-    disk_manager_ = new DiskManager(db_file_name);
+    disk_manager_ = new DiskManager(db_file_name, page_size);
 
     // log related
     log_manager_ = new LogManager(disk_manager_);
 
+    buffer_pools_ = new BufferPoolSet(disk_manager_, log_manager_);
+    size_t partitions = numa_aware ? Numa::NodeCount() : 1;
     buffer_pool_manager_ =
-        new BufferPoolManager(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
+        buffer_pools_->AddPool("heap", buffer_pool_size, ReplacerType::LRU,
+                               partitions, numa_aware);
+    index_buffer_pool_manager_ = buffer_pool_manager_;
+    if (index_pool_size != 0) {
+      index_buffer_pool_manager_ =
+          buffer_pools_->AddPool("index", index_pool_size, ReplacerType::LRU,
+                                 partitions, numa_aware);
+    }
+    if (persist_working_set) {
+      // the name without the extension of its last component, so a dot in
+      // a directory as in ./x.db is kept
+      working_set_file_ = db_file_name;
+      std::string::size_type dot = db_file_name.rfind('.');
+      std::string::size_type slash = db_file_name.rfind('/');
+      if (dot != std::string::npos &&
+          (slash == std::string::npos || dot > slash))
+        working_set_file_.erase(dot);
+      for (size_t i = 0; i < buffer_pools_->GetPoolCount(); ++i) {
+        buffer_pools_->GetPool(i)->LoadWorkingSet(GetWorkingSetFile(i));
+      }
+    }
 
     // txn related
     lock_manager_ = new LockManager(true); // S2PL
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
+    catalog_ = new Catalog(buffer_pool_manager_);
+    root_catalog_ =
+        new RootCatalog(buffer_pool_manager_, log_manager_, catalog_);
+    checkpoint_manager_ =
+        new CheckpointManager(transaction_manager_, log_manager_,
+                              buffer_pool_manager_, root_catalog_);
+
+    // background work backs off while commits wait on the log longer than
+    // BACKGROUND_LATENCY_TARGET on average
+    uint64_t waits = 0;
+    uint64_t wait_ns = 0;
+    scheduler_->SetLatencyProbe(
+        [this, waits, wait_ns]() mutable -> uint64_t {
+          LogStats stats = log_manager_->GetStats();
+          uint64_t count = stats.durable_wait_ns.count - waits;
+          uint64_t sum = stats.durable_wait_ns.sum - wait_ns;
+          waits = stats.durable_wait_ns.count;
+          wait_ns = stats.durable_wait_ns.sum;
+          return count == 0 ? 0 : sum / count;
+        },
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            BACKGROUND_LATENCY_TARGET)
+            .count());
   }
 
   ~StorageEngine() {
+    // no task may run once what it works on is gone
+    scheduler_->Stop();
+    delete checkpoint_manager_;
+    root_catalog_->Flush();
+    delete root_catalog_;
+    delete catalog_;
     if (ENABLE_LOGGING)
       log_manager_->StopFlushThread();
-    delete disk_manager_;
-    delete buffer_pool_manager_;
+    for (size_t i = 0; i < buffer_pools_->GetPoolCount(); ++i) {
+      BufferPoolManager *pool = buffer_pools_->GetPool(i);
+      pool->FlushAllPages();
+      if (!working_set_file_.empty())
+        pool->DumpWorkingSet(GetWorkingSetFile(i));
+    }
+    // the pools and the log write through the disk manager, it goes last
+    delete buffer_pools_;
     delete log_manager_;
     delete lock_manager_;
     delete transaction_manager_;
+    delete scheduler_;
+    delete disk_manager_;
   }
 
+  // <db>.warm for the first pool, <db>.<pool name>.warm for the others
+  std::string GetWorkingSetFile(size_t pool) const {
+    if (pool == 0)
+      return working_set_file_ + ".warm";
+    return working_set_file_ + "." + buffer_pools_->GetPoolName(pool) +
+           ".warm";
+  }
+
+  // checkpoints and other maintenance, the log flusher aside
+  TaskScheduler *scheduler_;
   DiskManager *disk_manager_;
+  BufferPoolSet *buffer_pools_;
+  // table heaps and the header page live here
   BufferPoolManager *buffer_pool_manager_;
+  // B+ tree pages, the same pool as buffer_pool_manager_ unless separated
+  BufferPoolManager *index_buffer_pool_manager_;
   LockManager *lock_manager_;
   TransactionManager *transaction_manager_;
   LogManager *log_manager_;
+  // fuzzy checkpoints of the table heaps
+  CheckpointManager *checkpoint_manager_;
+  // table roots, and B+ tree roots the root catalog writes into it at
+  // checkpoints and shutdown
+  Catalog *catalog_;
+  // B+ tree roots
+  RootCatalog *root_catalog_;
+  // database file name without extension, empty unless the working set is
+  // persisted
+  std::string working_set_file_;
+};
+
+class VirtualTable;
+
+// index entries of a row a write changed, see Connection
+struct IndexChange {
+  VirtualTable *table_;
+  Tuple tuple_; // the row, its own copy
+  RID rid_;
+  bool inserted_;
+  std::vector<bool> changed_; // by index, empty for all of them
+};
+
+// a sqlite connection that loaded the module, the client data of the
+// module: its statements run in a transaction of its own, whichever of its
+// tables they use, while other connections run theirs
+struct Connection {
+  // the transaction of the running statements, nullptr between them
+  Transaction *transaction_ = nullptr;
+  // begun by VtabBegin, a write lasts until VtabCommit or VtabRollback;
+  // else it is a read, until the last cursor open closes
+  bool writing_ = false;
+  int cursors_ = 0;
+  // of the write, for a rollback to undo as the transaction manager undoes
+  // the rows
+  std::vector<IndexChange> index_changes_;
+  // what a write statement builds per row, reset at the next row
+  Arena statement_arena_;
 };
 
-StorageEngine *storage_engine_;
-// global transaction, sqlite does not support concurrent transaction
-Transaction *global_transaction_ = nullptr;
+// shared by the connections of the process: the first one to load the
+// module creates it, the last one to close deletes it
+extern StorageEngine *storage_engine_;
+extern size_t storage_engine_users_;
+// the tables by name, shared too: a connection has a TableHandle of each
+// it uses, the last one disconnected deletes the table
+extern std::unordered_map<std::string, std::pair<VirtualTable *, size_t>>
+    tables_;
+// for storage_engine_ and tables_
+extern std::mutex storage_engine_latch_;
 
 class VirtualTable {
   friend class Cursor;
 
 public:
   VirtualTable(Schema *schema, BufferPoolManager *buffer_pool_manager,
-               LockManager *lock_manager, LogManager *log_manager, Index *index,
-               page_id_t first_page_id = INVALID_PAGE_ID)
-      : schema_(schema), index_(index) {
+               LockManager *lock_manager, LogManager *log_manager,
+               const std::vector<Index *> &indexes,
+               const std::string &table_name,
+               page_id_t first_page_id = INVALID_PAGE_ID, bool pax = false,
+               const std::vector<int> &dictionary_columns = {})
+      : schema_(schema), indexes_(indexes), builders_(indexes.size()) {
     if (first_page_id != INVALID_PAGE_ID) {
       // reopen an exist table
       table_heap_ = new TableHeap(buffer_pool_manager, lock_manager,
@@ -115,90 +300,257 @@ public:
     } else {
       // create table for the first time
       Transaction *txn = storage_engine_->transaction_manager_->Begin();
-      table_heap_ =
-          new TableHeap(buffer_pool_manager, lock_manager, log_manager, txn);
+      table_heap_ = new TableHeap(
+          buffer_pool_manager, lock_manager, log_manager, txn,
+          pax ? TablePage::GetPaxLayout(schema_) : std::vector<int32_t>());
       storage_engine_->transaction_manager_->Commit(txn);
     }
+    free_space_map_ = new FreeSpaceMap(table_name, buffer_pool_manager,
+                                       table_heap_->GetFirstPageId());
+    table_heap_->SetFreeSpaceMap(free_space_map_);
+    table_heap_->SetSchema(schema_);
+    dictionary_ = new Dictionary(table_name, buffer_pool_manager,
+                                 schema_->GetColumnCount(), dictionary_columns);
+    // the numeric columns have ranges by page
+    std::vector<int> zone_columns;
+    for (int i = 0; i < schema_->GetColumnCount(); i++) {
+      if (IsNumeric(schema_->GetType(i)))
+        zone_columns.push_back(i);
+    }
+    zone_map_ = new ZoneMap(schema_, zone_columns);
+    zone_map_->Rebuild(buffer_pool_manager, table_heap_->GetFirstPageId());
+    table_heap_->SetZoneMap(zone_map_);
+    stats_ = new TableStats(schema_, buffer_pool_manager->GetPageSize());
+    if (first_page_id != INVALID_PAGE_ID)
+      stats_->Gather(table_heap_);
   }
 
   ~VirtualTable() {
     delete schema_;
     delete table_heap_;
-    delete index_;
+    delete free_space_map_;
+    delete zone_map_;
+    delete dictionary_;
+    delete stats_;
+    for (auto index : indexes_)
+      delete index;
   }
 
   // insert into table heap
-  inline bool InsertTuple(const Tuple &tuple, RID &rid) {
-    return table_heap_->InsertTuple(tuple, rid, GetTransaction());
+  inline bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
+    if (!table_heap_->InsertTuple(tuple, rid, txn))
+      return false;
+    stats_->RecordInsert(tuple);
+    return true;
   }
 
-  // insert into index
-  inline void InsertEntry(const Tuple &tuple, const RID &rid) {
-    if (index_ == nullptr)
-      return;
-    // construct indexed key tuple
-    std::vector<Value> key_values;
+  // insert the entries of tuple, the row at rid, into the indexes, or
+  // into those changed is true for if given
+  inline void InsertEntries(const Tuple &tuple, const RID &rid,
+                            Transaction *txn,
+                            const std::vector<bool> *changed = nullptr) {
+    for (size_t i = 0; i < indexes_.size(); i++) {
+      if (changed != nullptr && !(*changed)[i])
+        continue;
+      if (builders_[i] != nullptr)
+        builders_[i]->InsertEntry(IndexKey(i, tuple), rid, txn);
+      else
+        indexes_[i]->InsertEntry(IndexKey(i, tuple), rid, txn);
+    }
+  }
+
+  // append the tuples next puts into its argument, a batch at a time until
+  // it returns false, behind the rows of the table, see
+  // TableHeap::AppendBatch. The index entries go in once all are appended,
+  // sorted, see Index::InsertEntries. False if the table heap failed, with
+  // txn aborted; what next throws goes through, no entries in. Adds the
+  // rows appended to count
+  inline bool Import(const std::function<bool(std::vector<Tuple> &)> &next,
+                     Transaction *txn, size_t &count) {
+    std::vector<std::vector<Tuple>> keys(indexes_.size());
+    std::vector<RID> rids;
+    std::vector<Tuple> tuples;
+    while (next(tuples)) {
+      std::vector<RID> batch_rids;
+      if (!table_heap_->AppendBatch(tuples, batch_rids, txn))
+        return false;
+      for (auto &tuple : tuples) {
+        stats_->RecordInsert(tuple);
+        for (size_t i = 0; i < indexes_.size(); i++)
+          keys[i].push_back(IndexKey(i, tuple));
+      }
+      rids.insert(rids.end(), batch_rids.begin(), batch_rids.end());
+      count += tuples.size();
+      tuples.clear();
+    }
+    for (size_t i = 0; i < indexes_.size(); i++)
+      indexes_[i]->InsertEntries(keys[i], rids, txn);
+    return true;
+  }
 
-    for (auto &i : index_->GetKeyAttrs())
-      key_values.push_back(tuple.GetValue(schema_, i));
-    Tuple key(key_values, index_->GetKeySchema());
-    index_->InsertEntry(key, rid, GetTransaction());
+  // fill index i, empty, from the tuples in the table, see IndexBuilder:
+  // index entries inserted and deleted meanwhile are applied after it
+  inline void BuildIndex(size_t i) {
+    IndexBuilder builder(indexes_[i], table_heap_);
+    builders_[i] = &builder;
+    try {
+      builder.Build(
+          [this, i](const Tuple &tuple) { return IndexKey(i, tuple); });
+    } catch (...) {
+      builders_[i] = nullptr;
+      throw;
+    }
+    builders_[i] = nullptr;
   }
 
   // delete from table heap
   // TODO: call makrdelete method from heaptable
-  inline bool DeleteTuple(const RID &rid) {
-    return table_heap_->MarkDelete(rid, GetTransaction());
+  inline bool DeleteTuple(const RID &rid, Transaction *txn) {
+    if (!table_heap_->MarkDelete(rid, txn))
+      return false;
+    stats_->RecordDelete();
+    return true;
   }
 
-  // delete from index
-  inline void DeleteEntry(const RID &rid) {
-    if (index_ == nullptr)
-      return;
-    Tuple deleted_tuple(rid);
-    table_heap_->GetTuple(rid, deleted_tuple, GetTransaction());
-    // construct indexed key tuple
-    std::vector<Value> key_values;
+  // the tuple at rid, read once for the entries of all the indexes; false
+  // if there is none
+  inline bool ReadTuple(const RID &rid, Tuple &tuple, Transaction *txn) {
+    tuple = Tuple(rid);
+    return table_heap_->GetTuple(rid, tuple, txn);
+  }
 
-    for (auto &i : index_->GetKeyAttrs())
-      key_values.push_back(deleted_tuple.GetValue(schema_, i));
-    Tuple key(key_values, index_->GetKeySchema());
-    index_->DeleteEntry(key, GetTransaction());
+  // delete the entries of old_tuple, the row at rid, from the indexes, or
+  // from those changed is true for if given
+  inline void DeleteEntries(const Tuple &old_tuple, const RID &rid,
+                            Transaction *txn,
+                            const std::vector<bool> *changed = nullptr) {
+    for (size_t i = 0; i < indexes_.size(); i++) {
+      if (changed != nullptr && !(*changed)[i])
+        continue;
+      // the key alone, without included columns
+      std::vector<Value> key_values;
+      for (auto &column : indexes_[i]->GetKeyAttrs())
+        key_values.push_back(old_tuple.GetValue(schema_, column));
+      Tuple key(key_values, indexes_[i]->GetKeySchema());
+      if (builders_[i] != nullptr)
+        builders_[i]->DeleteEntry(key, rid, txn);
+      else
+        indexes_[i]->DeleteEntry(key, rid, txn);
+    }
+  }
+
+  // by index, whether tuple as the new one of old_tuple changes its entry:
+  // the key or, for a covering index, an included column
+  inline std::vector<bool> ChangedEntries(const Tuple &old_tuple,
+                                          const Tuple &tuple) {
+    std::vector<bool> changed(indexes_.size());
+    for (size_t i = 0; i < indexes_.size(); i++) {
+      Tuple old_key = IndexKey(i, old_tuple);
+      Tuple new_key = IndexKey(i, tuple);
+      changed[i] = old_key.GetLength() != new_key.GetLength() ||
+                   memcmp(old_key.GetData(), new_key.GetData(),
+                          old_key.GetLength()) != 0;
+    }
+    return changed;
   }
 
   // update table heap tuple
-  inline bool UpdateTuple(const Tuple &tuple, const RID &rid) {
+  inline bool UpdateTuple(const Tuple &tuple, const RID &rid,
+                          Transaction *txn) {
     // if failed try to delete and insert
-    return table_heap_->UpdateTuple(tuple, rid, GetTransaction());
+    return table_heap_->UpdateTuple(tuple, rid, txn);
+  }
+
+  inline TableIterator begin(Transaction *txn, bool for_update) {
+    return table_heap_->begin(txn, for_update);
   }
 
-  inline TableIterator begin() { return table_heap_->begin(GetTransaction()); }
+  // the same, skipping the pages the zone map rules out for ranges, the
+  // tuples not matching filter left out
+  inline TableIterator begin(Transaction *txn, bool for_update,
+                             const std::vector<ScanRange> &ranges,
+                             const ScanFilter &filter = ScanFilter()) {
+    return table_heap_->begin(txn, for_update, ranges, filter);
+  }
 
   inline TableIterator end() { return table_heap_->end(); }
 
+  inline bool IsZoneMapped(int column_id) {
+    return zone_map_->IsTracked(column_id);
+  }
+
   inline Schema *GetSchema() { return schema_; }
 
-  inline Index *GetIndex() { return index_; }
+  inline Dictionary *GetDictionary() { return dictionary_; }
+
+  inline size_t GetIndexCount() { return indexes_.size(); }
+
+  inline Index *GetIndex(size_t i) { return indexes_[i]; }
 
   inline TableHeap *GetTableHeap() { return table_heap_; }
 
+  inline TableStats *GetStats() { return stats_; }
+
   inline page_id_t GetFirstPageId() { return table_heap_->GetFirstPageId(); }
 
 private:
-  sqlite3_vtab base_;
+  static inline bool IsNumeric(TypeId type) {
+    return type == TypeId::TINYINT || type == TypeId::SMALLINT ||
+           type == TypeId::INTEGER || type == TypeId::BIGINT ||
+           type == TypeId::DECIMAL;
+  }
+
+  // the entry of tuple in index i
+  inline Tuple IndexKey(size_t i, const Tuple &tuple) {
+    // construct indexed key tuple
+    std::vector<Value> key_values;
+
+    for (auto &column : indexes_[i]->GetKeyAttrs())
+      key_values.push_back(tuple.GetValue(schema_, column));
+    // an index with included columns keeps them after the key
+    IndexMetadata *metadata = indexes_[i]->GetMetadata();
+    for (auto &column : metadata->GetIncludeAttrs())
+      key_values.push_back(tuple.GetValue(schema_, column));
+    return Tuple(key_values, metadata->GetCoveringSchema() != nullptr
+                                 ? metadata->GetCoveringSchema()
+                                 : indexes_[i]->GetKeySchema());
+  }
+
   // virtual table schema
   Schema *schema_;
   // to read/write actual data in table
   TableHeap *table_heap_;
-  // to insert/delete index entry
-  Index *index_ = nullptr;
+  // where table_heap_ has room for inserts
+  FreeSpaceMap *free_space_map_;
+  // for the costs of scans
+  TableStats *stats_;
+  // ranges of the numeric columns by page, for range scans
+  ZoneMap *zone_map_;
+  // the strings of the dictionary encoded columns
+  Dictionary *dictionary_;
+  // to insert/delete index entries, in the order of the module arguments
+  std::vector<Index *> indexes_;
+  // by index, while it is built index writes go through the builder
+  std::vector<IndexBuilder *> builders_;
+};
+
+// a table as one connection has it, the sqlite3_vtab the Vtab functions
+// get
+struct TableHandle {
+  sqlite3_vtab base_; /* Base class - must be first */
+  VirtualTable *table_;
+  // the key of table_ in tables_
+  std::string name_;
+  Connection *connection_;
 };
 
 class Cursor {
 public:
-  Cursor(VirtualTable *virtual_table)
-      : table_iterator_(virtual_table->begin()), virtual_table_(virtual_table) {
-  }
+  Cursor(VirtualTable *virtual_table, Connection *connection, bool for_update)
+      : table_iterator_(
+            virtual_table->begin(connection->transaction_, for_update)),
+        virtual_table_(virtual_table), connection_(connection),
+        for_update_(for_update) {}
 
   inline void SetScanFlag(bool is_index_scan) {
     is_index_scan_ = is_index_scan;
@@ -208,35 +560,102 @@ public:
 
   inline VirtualTable *GetVirtualTable() { return virtual_table_; }
 
-  inline Schema *GetKeySchema() {
-    return virtual_table_->index_->GetKeySchema();
+  // the columns the statement reads, as colUsed of sqlite3_index_info: bit
+  // 63 for any from the 64th on. The rows of an index scan reading fewer
+  // than all are read in place, the columns read only, unless the reads
+  // copy tuples anyway, see TableHeap::ReadsCopies
+  inline void SetColumns(sqlite3_uint64 columns) {
+    int column_count = virtual_table_->schema_->GetColumnCount();
+    int used = 0;
+    for (int column = 0; column < column_count; column++) {
+      if (((columns >> std::min(column, 63)) & 1) != 0)
+        used++;
+    }
+    in_place_ =
+        used < column_count &&
+        !virtual_table_->table_heap_->ReadsCopies(GetTransaction());
   }
+
   // return rid at which cursor is currently pointed
   inline int64_t GetCurrentRid() {
     if (is_index_scan_)
       return results[offset_].Get();
     else
-      return (*table_iterator_).GetRid().Get();
+      return table_iterator_.GetRid().Get();
   }
 
-  // return tuple at which cursor is currently pointed
+  // return tuple at which cursor is currently pointed, the value valid
+  // until the cursor moves
   inline Value GetCurrentValue(Schema *schema, int column) {
     if (is_index_scan_) {
-      RID rid = results[offset_];
-      Tuple tuple(rid);
-      virtual_table_->table_heap_->GetTuple(rid, tuple, GetTransaction());
-      return tuple.GetValue(schema, column);
+      // an index-only scan has the column in the entry
+      IndexMetadata *metadata = index_->GetMetadata();
+      int covering_column = metadata->GetCoveringColumn(column);
+      if (!rows_.empty() && covering_column != -1)
+        return rows_[offset_].GetValue(metadata->GetCoveringSchema(),
+                                       covering_column, &arena_);
+      if (ViewRow())
+        return row_view_.GetValue(schema, column, &arena_);
+      return ReadRow().GetValue(schema, column, &arena_);
     } else {
-      return table_iterator_->GetValue(schema, column);
+      return table_iterator_.GetValue(schema, column, &arena_);
+    }
+  }
+
+  // the inlined column of the current row as a T, without a Value
+  template <typename T> T GetCurrentFixed(Schema *schema, int column) {
+    if (!is_index_scan_)
+      return table_iterator_.GetFixed<T>(schema, column);
+    IndexMetadata *metadata = index_->GetMetadata();
+    int covering_column = metadata->GetCoveringColumn(column);
+    if (!rows_.empty() && covering_column != -1)
+      return rows_[offset_].GetFixed<T>(metadata->GetCoveringSchema(),
+                                        covering_column);
+    T value = 0;
+    if (ViewRow()) {
+      row_view_.GetFixed(schema, column, value);
+      return value;
+    }
+    return ReadRow().GetFixed<T>(schema, column);
+  }
+
+  // f(data, len) on the varchar column of the current row where the row
+  // is, no Value built, see TupleView::ReadString; false if it is null or
+  // spilled, GetCurrentValue reads it then
+  template <typename F> bool ReadCurrentString(Schema *schema, int column,
+                                               F f) {
+    if (!is_index_scan_)
+      return table_iterator_.ReadString(schema, column, f);
+    IndexMetadata *metadata = index_->GetMetadata();
+    int covering_column = metadata->GetCoveringColumn(column);
+    const char *data;
+    uint32_t len;
+    if (!rows_.empty() && covering_column != -1) {
+      if (!rows_[offset_].GetStringView(metadata->GetCoveringSchema(),
+                                        covering_column, data, len))
+        return false;
+    } else if (ViewRow()) {
+      return row_view_.ReadString(schema, column, f);
+    } else if (!ReadRow().GetStringView(schema, column, data, len)) {
+      return false;
     }
+    f(data, len);
+    return true;
   }
 
+  // what the current row needs, gone when the cursor moves
+  inline Arena *GetArena() { return &arena_; }
+
   // move cursor up to next
   Cursor &operator++() {
-    if (is_index_scan_)
+    arena_.Reset();
+    if (is_index_scan_) {
       ++offset_;
-    else
+      if (ordered_ && offset_ == static_cast<int>(results.size()))
+        NextBatch();
+    } else {
       ++table_iterator_;
+    }
     return *this;
   }
   // is end of cursor(no more tuple)
@@ -247,21 +666,185 @@ public:
       return table_iterator_ == virtual_table_->end();
   }
 
-  // wrapper around poit scan methods
-  inline void ScanKey(const Tuple &key) {
-    virtual_table_->index_->ScanKey(key, results);
+  // wrapper around poit scan methods, from the first result on again
+  inline void ScanKey(Index *index, const Tuple &key) {
+    Rewind();
+    index_ = index;
+    index_->ScanKey(key, results);
+  }
+
+  // the rows of the keys from low to high, both included, in key order a
+  // batch at a time, see Index::StartRange; none if the range is empty
+  inline void ScanKeyRange(Index *index, const Tuple &low, const Tuple &high,
+                           bool empty) {
+    Rewind();
+    index_ = index;
+    if (empty)
+      return;
+    index_->StartRange(low, high, position_);
+    ordered_ = true;
+    reverse_ = false;
+    batch_ = ORDERED_SCAN_BATCH;
+    NextBatch();
+  }
+
+  // the rows of index in key order, down if reverse, read a batch at a time
+  // as the cursor moves, see Index::ScanOrdered; a LIMIT stops it early
+  inline void ScanOrdered(Index *index, bool reverse) {
+    Rewind();
+    index_ = index;
+    ordered_ = true;
+    reverse_ = reverse;
+    batch_ = ORDERED_SCAN_BATCH;
+    NextBatch();
+  }
+
+  // a sequential scan again, of all the pages: a cursor is filtered anew for
+  // each row of an outer loop
+  inline void Scan() {
+    Rewind();
+    table_iterator_ = virtual_table_->begin(GetTransaction(), for_update_);
+  }
+
+  // a sequential scan again, of the rows matching predicates only, checked
+  // on the pages, see ScanFilter; none if empty. Pages the zone map rules
+  // out for ranges are not read
+  inline void ScanFiltered(const std::vector<ScanRange> &ranges,
+                           const std::vector<ScanPredicate> &predicates,
+                           bool empty) {
+    Rewind();
+    if (empty) {
+      table_iterator_ = virtual_table_->end();
+      return;
+    }
+    std::vector<ScanRange> mapped;
+    for (auto &range : ranges) {
+      if (virtual_table_->IsZoneMapped(range.column_id))
+        mapped.push_back(range);
+    }
+    table_iterator_ = virtual_table_->begin(
+        GetTransaction(), for_update_, mapped,
+        ScanFilter(virtual_table_->schema_, predicates));
+  }
+
+  // the same, the key and included columns of the entries kept as well.
+  // They are read under the row locks a read of the heap takes: the entries
+  // are read again once the rows found are locked, until no other row turns
+  // up. The version a transaction reading copies sees is in the heap only,
+  // it reads the rows from there
+  inline void ScanCovering(Index *index, const Tuple &key) {
+    Rewind();
+    index_ = index;
+    TableHeap *table_heap = virtual_table_->table_heap_;
+    Transaction *txn = GetTransaction();
+    if (table_heap->ReadsCopies(txn)) {
+      index_->ScanKey(key, results, txn);
+      return;
+    }
+    std::vector<RID> locked;
+    while (true) {
+      results.clear();
+      rows_.clear();
+      index_->ScanCovering(key, results, rows_, txn);
+      if (results == locked)
+        return;
+      for (auto &rid : results) {
+        if (!table_heap->LockTuple(rid, txn)) {
+          results.clear();
+          rows_.clear();
+          return;
+        }
+      }
+      locked = results;
+    }
   }
 
 private:
+  // of the connection, what the statement reads and writes in
+  inline Transaction *GetTransaction() { return connection_->transaction_; }
+
+  // the tuple at results[offset_], read once for all the columns of the row
+  inline const Tuple &ReadRow() {
+    if (row_offset_ != offset_) {
+      row_ = Tuple();
+      virtual_table_->table_heap_->GetTuple(results[offset_], row_,
+                                            GetTransaction());
+      row_offset_ = offset_;
+    }
+    return row_;
+  }
+
+  // whether the tuple at results[offset_] is read in place, row_view_ on
+  // it, once for all the columns of the row. A tuple gone is read by
+  // ReadRow
+  inline bool ViewRow() {
+    if (!in_place_)
+      return false;
+    if (view_offset_ != offset_) {
+      viewed_ = virtual_table_->table_heap_->ViewTuple(
+          results[offset_], row_view_, GetTransaction());
+      view_offset_ = offset_;
+    }
+    return viewed_;
+  }
+
+  // the next rows of an ordered scan in place of the ones passed, none past
+  // the last
+  inline void NextBatch() {
+    results.clear();
+    offset_ = 0;
+    row_offset_ = -1;
+    view_offset_ = -1;
+    while (results.empty() && !position_.done) {
+      index_->ScanOrdered(reverse_, batch_, position_, results,
+                          GetTransaction());
+      batch_ = std::min<size_t>(batch_ * 2, ORDERED_SCAN_MAX_BATCH);
+    }
+  }
+
+  inline void Rewind() {
+    arena_.Reset();
+    results.clear();
+    rows_.clear();
+    offset_ = 0;
+    row_offset_ = -1;
+    view_offset_ = -1;
+    ordered_ = false;
+    position_ = IndexScanPosition();
+  }
+
   sqlite3_vtab_cursor base_; /* Base class - must be first */
-  // for index scan
+  // for index scan, of index_
+  Index *index_ = nullptr;
   std::vector<RID> results;
+  // for an ordered one, results is the batch at position_; the next one has
+  // batch_ entries at most
+  bool ordered_ = false;
+  bool reverse_ = false;
+  IndexScanPosition position_;
+  size_t batch_ = 0;
+  // for index-only scan, tuples of the covering schema of the index
+  std::vector<Tuple> rows_;
   int offset_ = 0;
+  // the tuple at results[row_offset_], for an index scan that is not
+  // index-only
+  Tuple row_;
+  int row_offset_ = -1;
+  // the tuple at results[view_offset_] in place, for an index scan of a
+  // few columns
+  bool in_place_ = false;
+  TupleView row_view_;
+  int view_offset_ = -1;
+  bool viewed_ = false;
   // for sequential scan
   TableIterator table_iterator_;
   // flag to indicate which scan method is currently used
   bool is_index_scan_ = false;
   VirtualTable *virtual_table_;
+  Connection *connection_;
+  bool for_update_;
+  // the values read of the current row
+  Arena arena_;
 }; // namespace cmudb
 
 } // namespace cmudb
\ No newline at end of file
@@ -0,0 +1,636 @@
+/**
+ * art.cpp
+ */
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "common/exception.h"
+#include "index/art.h"
+
+namespace cmudb {
+
+// retired nodes gathered before an epoch change is tried
+static const size_t RECLAIM_BATCH = 64;
+
+// std::min binds it to a reference
+constexpr int AdaptiveRadixTree::MAX_PREFIX;
+
+AdaptiveRadixTree::AdaptiveRadixTree()
+    : root_(NewNode<Node256>()), size_(0), epoch_(0) {
+  active_[0] = 0;
+  active_[1] = 0;
+}
+
+AdaptiveRadixTree::~AdaptiveRadixTree() {
+  FreeTree(root_);
+  for (Node *node : garbage_) {
+    Free(node);
+  }
+  for (Node *node : pending_) {
+    Free(node);
+  }
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+bool AdaptiveRadixTree::Insert(const VarKey &key, const RID &value) {
+  EpochGuard guard(this);
+restart:
+  Node *parent = nullptr;
+  uint64_t parent_version = 0;
+  uint8_t parent_byte = 0;
+  Node *node = root_;
+  uint64_t version;
+  if (!ReadLock(node, version)) {
+    goto restart;
+  }
+  for (int depth = 0;;) {
+    int match = PrefixMatch(node, key, depth);
+    if (match < node->prefix_size_) {
+      if (depth + match >= key.size_) {
+        if (!Check(node, version)) {
+          goto restart;
+        }
+        throw Exception(EXCEPTION_TYPE_INDEX, "key is a prefix of another");
+      }
+      // a new node above for the shared part of the prefix
+      if (!Upgrade(parent, parent_version)) {
+        goto restart;
+      }
+      if (!Upgrade(node, version)) {
+        WriteUnlock(parent);
+        goto restart;
+      }
+      Node4 *branch = NewNode<Node4>();
+      branch->prefix_size_ = match;
+      memcpy(branch->prefix_, node->prefix_, match);
+      AddChild(branch, node->prefix_[match], node);
+      AddChild(branch, key.data_[depth + match], NewLeaf(key, value));
+      node->prefix_size_ -= match + 1;
+      memmove(node->prefix_, node->prefix_ + match + 1, node->prefix_size_);
+      *ChildSlot(parent, parent_byte) = branch;
+      WriteUnlock(node);
+      WriteUnlock(parent);
+      size_++;
+      return true;
+    }
+    depth += node->prefix_size_;
+    if (depth >= key.size_) {
+      if (!Check(node, version)) {
+        goto restart;
+      }
+      throw Exception(EXCEPTION_TYPE_INDEX, "key is a prefix of another");
+    }
+    uint8_t byte = key.data_[depth];
+    Node *child = FindChild(node, byte);
+    if (!Check(node, version)) {
+      goto restart;
+    }
+
+    if (child == nullptr) {
+      if (!IsFull(node)) {
+        if (!Upgrade(node, version)) {
+          goto restart;
+        }
+        AddChild(node, byte, NewLeaf(key, value));
+        WriteUnlock(node);
+        size_++;
+        return true;
+      }
+      // the root is a Node256, never full, so node has a parent
+      if (!Upgrade(parent, parent_version)) {
+        goto restart;
+      }
+      if (!Upgrade(node, version)) {
+        WriteUnlock(parent);
+        goto restart;
+      }
+      Node *bigger = Grow(node);
+      AddChild(bigger, byte, NewLeaf(key, value));
+      *ChildSlot(parent, parent_byte) = bigger;
+      WriteUnlockObsolete(node);
+      WriteUnlock(parent);
+      Retire(node);
+      size_++;
+      return true;
+    }
+
+    if (IsLeaf(child)) {
+      // leaves do not change once in the tree, only the slot of node does
+      Leaf *leaf = AsLeaf(child);
+      if (LeafMatches(leaf, key)) {
+        return false;
+      }
+      int common = 0;
+      while (depth + 1 + common < key.size_ &&
+             depth + 1 + common < leaf->size_ &&
+             key.data_[depth + 1 + common] ==
+                 leaf->key_[depth + 1 + common]) {
+        common++;
+      }
+      if (depth + 1 + common == key.size_ ||
+          depth + 1 + common == leaf->size_) {
+        throw Exception(EXCEPTION_TYPE_INDEX, "key is a prefix of another");
+      }
+      if (!Upgrade(node, version)) {
+        goto restart;
+      }
+      *ChildSlot(node, byte) =
+          NewBranch(key, depth + 1, common, child, NewLeaf(key, value));
+      WriteUnlock(node);
+      size_++;
+      return true;
+    }
+
+    parent = node;
+    parent_version = version;
+    parent_byte = byte;
+    node = child;
+    if (!ReadLock(node, version) || !Check(parent, parent_version)) {
+      goto restart;
+    }
+    depth++;
+  }
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+bool AdaptiveRadixTree::Remove(const VarKey &key) {
+  EpochGuard guard(this);
+restart:
+  Node *parent = nullptr;
+  uint64_t parent_version = 0;
+  Node *node = root_;
+  uint64_t version;
+  if (!ReadLock(node, version)) {
+    goto restart;
+  }
+  for (int depth = 0;;) {
+    if (PrefixMatch(node, key, depth) < node->prefix_size_ ||
+        depth + node->prefix_size_ >= key.size_) {
+      if (!Check(node, version)) {
+        goto restart;
+      }
+      return false;
+    }
+    depth += node->prefix_size_;
+    uint8_t byte = key.data_[depth];
+    Node *child = FindChild(node, byte);
+    if (!Check(node, version)) {
+      goto restart;
+    }
+    if (child == nullptr) {
+      return false;
+    }
+    if (IsLeaf(child)) {
+      if (!LeafMatches(AsLeaf(child), key)) {
+        return false;
+      }
+      if (!Upgrade(node, version)) {
+        goto restart;
+      }
+      RemoveChild(node, byte);
+      WriteUnlock(node);
+      Retire(child);
+      size_--;
+      return true;
+    }
+    parent = node;
+    parent_version = version;
+    node = child;
+    if (!ReadLock(node, version) || !Check(parent, parent_version)) {
+      goto restart;
+    }
+    depth++;
+  }
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+bool AdaptiveRadixTree::GetValue(const VarKey &key, std::vector<RID> &result) {
+  EpochGuard guard(this);
+restart:
+  Node *parent = nullptr;
+  uint64_t parent_version = 0;
+  Node *node = root_;
+  uint64_t version;
+  if (!ReadLock(node, version)) {
+    goto restart;
+  }
+  for (int depth = 0;;) {
+    if (PrefixMatch(node, key, depth) < node->prefix_size_ ||
+        depth + node->prefix_size_ >= key.size_) {
+      if (!Check(node, version)) {
+        goto restart;
+      }
+      return false;
+    }
+    depth += node->prefix_size_;
+    Node *child = FindChild(node, key.data_[depth]);
+    if (!Check(node, version)) {
+      goto restart;
+    }
+    if (child == nullptr) {
+      return false;
+    }
+    if (IsLeaf(child)) {
+      Leaf *leaf = AsLeaf(child);
+      if (!LeafMatches(leaf, key)) {
+        return false;
+      }
+      result.push_back(leaf->value_);
+      return true;
+    }
+    parent = node;
+    parent_version = version;
+    node = child;
+    if (!ReadLock(node, version) || !Check(parent, parent_version)) {
+      goto restart;
+    }
+    depth++;
+  }
+}
+
+size_t AdaptiveRadixTree::GetNodeCount(int children) {
+  NodeType type = children <= 4
+                      ? NodeType::NODE4
+                      : children <= 16 ? NodeType::NODE16
+                                       : children <= 48 ? NodeType::NODE48
+                                                        : NodeType::NODE256;
+  return CountNodes(root_, type);
+}
+
+/*****************************************************************************
+ * OPTIMISTIC LOCK COUPLING
+ *****************************************************************************/
+bool AdaptiveRadixTree::ReadLock(Node *node, uint64_t &version) {
+  version = node->version_.load(std::memory_order_acquire);
+  while ((version & 2) != 0) {
+    std::this_thread::yield();
+    version = node->version_.load(std::memory_order_acquire);
+  }
+  return (version & 1) == 0;
+}
+
+// everything read of node since version was taken is what version wrote
+bool AdaptiveRadixTree::Check(Node *node, uint64_t version) {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return node->version_.load(std::memory_order_relaxed) == version;
+}
+
+bool AdaptiveRadixTree::Upgrade(Node *node, uint64_t version) {
+  return node->version_.compare_exchange_strong(version, version + 2,
+                                                std::memory_order_acquire);
+}
+
+void AdaptiveRadixTree::WriteUnlock(Node *node) {
+  node->version_.fetch_add(2, std::memory_order_release);
+}
+
+void AdaptiveRadixTree::WriteUnlockObsolete(Node *node) {
+  node->version_.fetch_add(3, std::memory_order_release);
+}
+
+/*****************************************************************************
+ * NODES
+ *****************************************************************************/
+bool AdaptiveRadixTree::IsLeaf(const Node *node) {
+  return (reinterpret_cast<uintptr_t>(node) & 1) != 0;
+}
+
+AdaptiveRadixTree::Leaf *AdaptiveRadixTree::AsLeaf(const Node *node) {
+  return reinterpret_cast<Leaf *>(reinterpret_cast<uintptr_t>(node) &
+                                 ~static_cast<uintptr_t>(1));
+}
+
+AdaptiveRadixTree::Node *AdaptiveRadixTree::NewLeaf(const VarKey &key,
+                                                    const RID &value) {
+  char *bytes = new char[sizeof(Leaf) + key.size_];
+  Leaf *leaf = new (bytes) Leaf;
+  leaf->value_ = value;
+  leaf->size_ = key.size_;
+  memcpy(leaf->key_, key.data_, key.size_);
+  return reinterpret_cast<Node *>(reinterpret_cast<uintptr_t>(leaf) | 1);
+}
+
+bool AdaptiveRadixTree::LeafMatches(const Leaf *leaf, const VarKey &key) {
+  return leaf->size_ == key.size_ &&
+         memcmp(leaf->key_, key.data_, key.size_) == 0;
+}
+
+template <typename NodeKind> NodeKind *AdaptiveRadixTree::NewNode() {
+  // value-initialized, all zero
+  NodeKind *node = new NodeKind();
+  node->type_ = std::is_same<NodeKind, Node4>::value
+                    ? NodeType::NODE4
+                    : std::is_same<NodeKind, Node16>::value
+                          ? NodeType::NODE16
+                          : std::is_same<NodeKind, Node48>::value
+                                ? NodeType::NODE48
+                                : NodeType::NODE256;
+  return node;
+}
+
+int AdaptiveRadixTree::PrefixMatch(const Node *node, const VarKey &key,
+                                   int depth) {
+  // read racing a writer, prefix_size_ may be anything until checked
+  int size = std::min<int>(node->prefix_size_, MAX_PREFIX);
+  int match = 0;
+  while (match < size && depth + match < key.size_ &&
+         node->prefix_[match] ==
+             static_cast<uint8_t>(key.data_[depth + match])) {
+    match++;
+  }
+  return match;
+}
+
+bool AdaptiveRadixTree::IsFull(const Node *node) {
+  switch (node->type_) {
+  case NodeType::NODE4:
+    return node->count_ == 4;
+  case NodeType::NODE16:
+    return node->count_ == 16;
+  case NodeType::NODE48:
+    return node->count_ == 48;
+  default:
+    return false;
+  }
+}
+
+AdaptiveRadixTree::Node **AdaptiveRadixTree::ChildSlot(Node *node,
+                                                       uint8_t byte) {
+  switch (node->type_) {
+  case NodeType::NODE4: {
+    Node4 *n = static_cast<Node4 *>(node);
+    int count = std::min<int>(n->count_, 4);
+    for (int i = 0; i < count; i++) {
+      if (n->keys_[i] == byte) {
+        return &n->children_[i];
+      }
+    }
+    return nullptr;
+  }
+  case NodeType::NODE16: {
+    Node16 *n = static_cast<Node16 *>(node);
+    int count = std::min<int>(n->count_, 16);
+#ifdef __SSE2__
+    // all 16 bytes in one compare
+    __m128i matches = _mm_cmpeq_epi8(
+        _mm_set1_epi8(static_cast<char>(byte)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(n->keys_)));
+    unsigned mask =
+        static_cast<unsigned>(_mm_movemask_epi8(matches)) & ((1u << count) - 1);
+    return mask == 0 ? nullptr : &n->children_[__builtin_ctz(mask)];
+#else
+    for (int i = 0; i < count; i++) {
+      if (n->keys_[i] == byte) {
+        return &n->children_[i];
+      }
+    }
+    return nullptr;
+#endif
+  }
+  case NodeType::NODE48: {
+    Node48 *n = static_cast<Node48 *>(node);
+    int index = n->index_[byte];
+    return index == 0 ? nullptr : &n->children_[index - 1];
+  }
+  default:
+    return &static_cast<Node256 *>(node)->children_[byte];
+  }
+}
+
+AdaptiveRadixTree::Node *AdaptiveRadixTree::FindChild(Node *node,
+                                                      uint8_t byte) {
+  Node **slot = ChildSlot(node, byte);
+  return slot == nullptr ? nullptr : *slot;
+}
+
+void AdaptiveRadixTree::AddChild(Node *node, uint8_t byte, Node *child) {
+  switch (node->type_) {
+  case NodeType::NODE4: {
+    Node4 *n = static_cast<Node4 *>(node);
+    n->keys_[n->count_] = byte;
+    n->children_[n->count_] = child;
+    break;
+  }
+  case NodeType::NODE16: {
+    Node16 *n = static_cast<Node16 *>(node);
+    n->keys_[n->count_] = byte;
+    n->children_[n->count_] = child;
+    break;
+  }
+  case NodeType::NODE48: {
+    Node48 *n = static_cast<Node48 *>(node);
+    int slot = 0;
+    while (n->children_[slot] != nullptr) {
+      slot++;
+    }
+    n->children_[slot] = child;
+    n->index_[byte] = slot + 1;
+    break;
+  }
+  default:
+    static_cast<Node256 *>(node)->children_[byte] = child;
+  }
+  node->count_++;
+}
+
+void AdaptiveRadixTree::RemoveChild(Node *node, uint8_t byte) {
+  switch (node->type_) {
+  case NodeType::NODE4: {
+    // the last child takes the place of the one removed
+    Node4 *n = static_cast<Node4 *>(node);
+    int i = static_cast<int>(ChildSlot(node, byte) - n->children_);
+    n->keys_[i] = n->keys_[n->count_ - 1];
+    n->children_[i] = n->children_[n->count_ - 1];
+    break;
+  }
+  case NodeType::NODE16: {
+    Node16 *n = static_cast<Node16 *>(node);
+    int i = static_cast<int>(ChildSlot(node, byte) - n->children_);
+    n->keys_[i] = n->keys_[n->count_ - 1];
+    n->children_[i] = n->children_[n->count_ - 1];
+    break;
+  }
+  case NodeType::NODE48: {
+    Node48 *n = static_cast<Node48 *>(node);
+    n->children_[n->index_[byte] - 1] = nullptr;
+    n->index_[byte] = 0;
+    break;
+  }
+  default:
+    static_cast<Node256 *>(node)->children_[byte] = nullptr;
+  }
+  node->count_--;
+}
+
+AdaptiveRadixTree::Node *AdaptiveRadixTree::Grow(Node *node) {
+  Node *bigger;
+  switch (node->type_) {
+  case NodeType::NODE4: {
+    Node4 *n = static_cast<Node4 *>(node);
+    Node16 *b = NewNode<Node16>();
+    memcpy(b->keys_, n->keys_, sizeof(n->keys_));
+    memcpy(b->children_, n->children_, sizeof(n->children_));
+    bigger = b;
+    break;
+  }
+  case NodeType::NODE16: {
+    Node16 *n = static_cast<Node16 *>(node);
+    Node48 *b = NewNode<Node48>();
+    for (int i = 0; i < 16; i++) {
+      b->children_[i] = n->children_[i];
+      b->index_[n->keys_[i]] = i + 1;
+    }
+    bigger = b;
+    break;
+  }
+  default: {
+    Node48 *n = static_cast<Node48 *>(node);
+    Node256 *b = NewNode<Node256>();
+    for (int byte = 0; byte < 256; byte++) {
+      if (n->index_[byte] != 0) {
+        b->children_[byte] = n->children_[n->index_[byte] - 1];
+      }
+    }
+    bigger = b;
+  }
+  }
+  bigger->prefix_size_ = node->prefix_size_;
+  memcpy(bigger->prefix_, node->prefix_, sizeof(node->prefix_));
+  bigger->count_ = node->count_;
+  return bigger;
+}
+
+AdaptiveRadixTree::Node *AdaptiveRadixTree::NewBranch(const VarKey &key,
+                                                      int depth, int common,
+                                                      Node *leaf,
+                                                      Node *new_leaf) {
+  const char *leaf_key = AsLeaf(leaf)->key_;
+  Node4 *top = nullptr;
+  Node4 *last = nullptr;
+  while (true) {
+    Node4 *node = NewNode<Node4>();
+    node->prefix_size_ = std::min(common, MAX_PREFIX);
+    memcpy(node->prefix_, key.data_ + depth, node->prefix_size_);
+    if (last == nullptr) {
+      top = node;
+    } else {
+      AddChild(last, key.data_[depth - 1], node);
+    }
+    depth += node->prefix_size_;
+    common -= node->prefix_size_;
+    if (common == 0) {
+      AddChild(node, leaf_key[depth], leaf);
+      AddChild(node, key.data_[depth], new_leaf);
+      return top;
+    }
+    // the byte of the one child is shared too
+    last = node;
+    depth++;
+    common--;
+  }
+}
+
+/*****************************************************************************
+ * RECLAMATION
+ *****************************************************************************/
+AdaptiveRadixTree::EpochGuard::EpochGuard(AdaptiveRadixTree *tree)
+    : tree_(tree) {
+  // counted in the epoch as it is after the count, else it changed in
+  // between and the count may not have been seen
+  while (true) {
+    epoch_ = tree_->epoch_.load();
+    tree_->active_[epoch_ & 1]++;
+    if (tree_->epoch_.load() == epoch_) {
+      return;
+    }
+    tree_->active_[epoch_ & 1]--;
+  }
+}
+
+AdaptiveRadixTree::EpochGuard::~EpochGuard() { tree_->active_[epoch_ & 1]--; }
+
+void AdaptiveRadixTree::Retire(Node *node) {
+  std::lock_guard<std::mutex> guard(garbage_mutex_);
+  garbage_.push_back(node);
+  if (garbage_.size() >= RECLAIM_BATCH) {
+    Reclaim();
+  }
+}
+
+// once no operation of the epoch before is left, those of the last epoch
+// change are over: what was retired before it is freed, and the epoch
+// changes again. Called under garbage_mutex_
+void AdaptiveRadixTree::Reclaim() {
+  uint64_t epoch = epoch_.load();
+  if (active_[(epoch + 1) & 1].load() != 0) {
+    return;
+  }
+  for (Node *node : pending_) {
+    Free(node);
+  }
+  pending_.clear();
+  pending_.swap(garbage_);
+  epoch_.store(epoch + 1);
+}
+
+void AdaptiveRadixTree::Free(Node *node) {
+  if (IsLeaf(node)) {
+    delete[] reinterpret_cast<char *>(AsLeaf(node));
+    return;
+  }
+  switch (node->type_) {
+  case NodeType::NODE4:
+    delete static_cast<Node4 *>(node);
+    break;
+  case NodeType::NODE16:
+    delete static_cast<Node16 *>(node);
+    break;
+  case NodeType::NODE48:
+    delete static_cast<Node48 *>(node);
+    break;
+  default:
+    delete static_cast<Node256 *>(node);
+  }
+}
+
+void AdaptiveRadixTree::FreeTree(Node *node) {
+  if (!IsLeaf(node)) {
+    for (int byte = 0; byte < 256; byte++) {
+      Node *child = FindChild(node, static_cast<uint8_t>(byte));
+      if (child != nullptr) {
+        FreeTree(child);
+      }
+    }
+  }
+  Free(node);
+}
+
+// not safe against concurrent writers
+size_t AdaptiveRadixTree::CountNodes(Node *node, NodeType type) {
+  if (IsLeaf(node)) {
+    return 0;
+  }
+  size_t count = node->type_ == type ? 1 : 0;
+  for (int byte = 0; byte < 256; byte++) {
+    Node *child = FindChild(node, static_cast<uint8_t>(byte));
+    if (child != nullptr) {
+      count += CountNodes(child, type);
+    }
+  }
+  return count;
+}
+
+} // namespace cmudb
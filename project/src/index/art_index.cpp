@@ -0,0 +1,43 @@
+/**
+ * art_index.cpp
+ */
+
+#include "index/art_index.h"
+#include "index/normalized_key.h"
+
+namespace cmudb {
+/*
+ * Constructor
+ */
+ArtIndex::ArtIndex(IndexMetadata *metadata) : Index(metadata) {}
+
+void ArtIndex::InsertEntry(const Tuple &key, RID rid, Transaction *) {
+  // construct insert index key
+  std::string index_key = EncodeKey(key);
+
+  container_.Insert(VarKey(index_key), rid);
+}
+
+void ArtIndex::DeleteEntry(const Tuple &key, RID, Transaction *) {
+  // construct delete index key
+  std::string index_key = EncodeKey(key);
+
+  container_.Remove(VarKey(index_key));
+}
+
+void ArtIndex::ScanKey(const Tuple &key, std::vector<RID> &result,
+                       Transaction *) {
+  // construct scan index key
+  std::string index_key = EncodeKey(key);
+
+  container_.GetValue(VarKey(index_key), result);
+}
+
+std::string ArtIndex::EncodeKey(const Tuple &key) {
+  size_t size = NormalizedKey::EncodedSize(key, GetKeySchema());
+  std::string bytes(size, '\0');
+  NormalizedKey::Encode(key, GetKeySchema(), &bytes[0], size);
+  return bytes;
+}
+
+} // namespace cmudb
@@ -0,0 +1,449 @@
+/**
+ * b_epsilon_tree.cpp
+ */
+#include <algorithm>
+#include <cassert>
+
+#include "common/exception.h"
+#include "index/b_epsilon_tree.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+INDEX_TEMPLATE_ARGUMENTS
+BEPSILONTREE_TYPE::BEpsilonTree(const std::string &name,
+                                BufferPoolManager *buffer_pool_manager,
+                                const KeyComparator &comparator,
+                                page_id_t root_page_id)
+    : index_name_(name), root_page_id_(root_page_id),
+      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {
+  size_t page_size = buffer_pool_manager->GetPageSize();
+  // four children at least, and the buffer aligned
+  size_t min_size =
+      sizeof(InternalPage) + 4 * sizeof(std::pair<KeyType, page_id_t>);
+  pivot_size_ = std::max(
+      static_cast<size_t>(page_size * BEPSILON_PIVOT_SHARE), min_size);
+  pivot_size_ = (pivot_size_ + 7) / 8 * 8;
+  max_messages_ = static_cast<int>(
+      (page_size - pivot_size_ - sizeof(Buffer)) / sizeof(Message));
+  assert(max_messages_ >= 1);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BEPSILONTREE_TYPE::IsEmpty() const {
+  return root_page_id_ == INVALID_PAGE_ID;
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+/*
+ * The first message for key on the way down decides, the leaf only if none
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BEPSILONTREE_TYPE::GetValue(const KeyType &key,
+                                 std::vector<ValueType> &result,
+                                 Transaction *) {
+  latch_.RLock();
+  if (IsEmpty()) {
+    latch_.RUnlock();
+    return false;
+  }
+  Page *page = FetchPage(root_page_id_);
+  bool found = false;
+  while (true) {
+    BPlusTreePage *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (node->IsLeafPage()) {
+      ValueType value;
+      found = reinterpret_cast<LeafPage *>(node)->Lookup(key, value,
+                                                         comparator_);
+      if (found) {
+        result.push_back(value);
+      }
+      break;
+    }
+    Buffer *buffer = BufferOf(page);
+    int index = MessageIndex(buffer, key);
+    if (index < buffer->size_ &&
+        comparator_(buffer->messages_[index].key_, key) == 0) {
+      const Message &message = buffer->messages_[index];
+      found = message.type_ == MessageType::INSERT;
+      if (found) {
+        result.push_back(message.value_);
+      }
+      break;
+    }
+    page_id_t child_id =
+        reinterpret_cast<InternalPage *>(node)->Lookup(key, comparator_);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = FetchPage(child_id);
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  latch_.RUnlock();
+  return found;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int BEPSILONTREE_TYPE::GetHeight() {
+  latch_.RLock();
+  int height = 0;
+  page_id_t page_id = root_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    height++;
+    Page *page = FetchPage(page_id);
+    BPlusTreePage *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    page_id = node->IsLeafPage()
+                  ? INVALID_PAGE_ID
+                  : reinterpret_cast<InternalPage *>(node)->ValueAt(0);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  }
+  latch_.RUnlock();
+  return height;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+size_t BEPSILONTREE_TYPE::GetBufferedCount() {
+  latch_.RLock();
+  size_t count = IsEmpty() ? 0 : CountMessages(root_page_id_);
+  latch_.RUnlock();
+  return count;
+}
+
+/*****************************************************************************
+ * INSERTION AND DELETION
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
+                               Transaction *) {
+  Message message;
+  message.key_ = key;
+  message.value_ = value;
+  message.type_ = MessageType::INSERT;
+  latch_.WLock();
+  Write(message);
+  latch_.WUnlock();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_TYPE::Remove(const KeyType &key, Transaction *) {
+  Message message;
+  message.key_ = key;
+  message.type_ = MessageType::DELETE;
+  latch_.WLock();
+  if (!IsEmpty()) {
+    Write(message);
+  }
+  latch_.WUnlock();
+}
+
+/*
+ * While the root is a leaf there is no buffer to put message into
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_TYPE::Write(const Message &message) {
+  if (IsEmpty()) {
+    page_id_t root_id;
+    Page *page = NewPage(root_id);
+    LeafPage *root = reinterpret_cast<LeafPage *>(page->GetData());
+    root->Init(root_id, INVALID_PAGE_ID, buffer_pool_manager_->GetPageSize());
+    root_page_id_ = root_id;
+    UpdateRootPageId(true);
+    buffer_pool_manager_->UnpinPage(root_id, true);
+  }
+  Page *page = FetchPage(root_page_id_);
+  BPlusTreePage *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  if (node->IsLeafPage()) {
+    LeafPage *leaf = reinterpret_cast<LeafPage *>(node);
+    ValueType existing;
+    if (message.type_ == MessageType::INSERT &&
+        leaf->GetSize() == leaf->GetMaxSize() &&
+        !leaf->Lookup(message.key_, existing, comparator_)) {
+      page_id_t right_id;
+      KeyType separator = SplitLeaf(page, right_id);
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+      SplitRoot(separator, right_id);
+      Write(message);
+      return;
+    }
+    ApplyToLeaf(leaf, message);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+    return;
+  }
+
+  Buffer *buffer = BufferOf(page);
+  while (buffer->size_ == max_messages_) {
+    int index = MessageIndex(buffer, message.key_);
+    if (index < buffer->size_ &&
+        comparator_(buffer->messages_[index].key_, message.key_) == 0) {
+      break;
+    }
+    if (node->GetSize() == node->GetMaxSize()) {
+      page_id_t right_id;
+      KeyType separator = SplitInternal(page, right_id);
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+      SplitRoot(separator, right_id);
+      Write(message);
+      return;
+    }
+    Flush(page);
+  }
+  PutMessage(buffer, message);
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+}
+
+/*
+ * The caller made room for an insert
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_TYPE::ApplyToLeaf(LeafPage *leaf, const Message &message) {
+  ValueType existing;
+  if (leaf->Lookup(message.key_, existing, comparator_)) {
+    leaf->RemoveAndDeleteRecord(message.key_, comparator_);
+  }
+  if (message.type_ == MessageType::INSERT) {
+    leaf->Insert(message.key_, message.value_, comparator_);
+  }
+}
+
+/*
+ * Of the messages for the child that has the most, as many as it takes move
+ * down. A leaf or a page with a full pivot section is split first if they
+ * do not fit, and the half with more of them takes them; a child buffer
+ * without room is flushed first
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_TYPE::Flush(Page *page) {
+  InternalPage *node = reinterpret_cast<InternalPage *>(page->GetData());
+  Buffer *buffer = BufferOf(page);
+  assert(node->GetSize() < node->GetMaxSize());
+  int child_index = 0;
+  int first = 0;
+  int last = 0;
+  for (int i = 0; i < node->GetSize(); i++) {
+    int child_first, child_last;
+    ChildMessages(node, buffer, i, child_first, child_last);
+    if (child_last - child_first > last - first) {
+      child_index = i;
+      first = child_first;
+      last = child_last;
+    }
+  }
+  assert(last > first);
+
+  page_id_t child_id = node->ValueAt(child_index);
+  Page *child_page = FetchPage(child_id);
+  BPlusTreePage *child =
+      reinterpret_cast<BPlusTreePage *>(child_page->GetData());
+  bool is_leaf = child->IsLeafPage();
+  bool split = is_leaf ? child->GetSize() >= 2 &&
+                             child->GetMaxSize() - child->GetSize() <
+                                 last - first
+                       : child->GetSize() == child->GetMaxSize();
+  if (split) {
+    page_id_t right_id;
+    KeyType separator = is_leaf ? SplitLeaf(child_page, right_id)
+                                : SplitInternal(child_page, right_id);
+    node->InsertNodeAfter(child_id, separator, right_id);
+    int middle = std::max(first, std::min(last, MessageIndex(buffer,
+                                                             separator)));
+    if (last - middle > middle - first) {
+      buffer_pool_manager_->UnpinPage(child_id, true);
+      child_id = right_id;
+      child_page = FetchPage(child_id);
+      child = reinterpret_cast<BPlusTreePage *>(child_page->GetData());
+      first = middle;
+    } else {
+      last = middle;
+    }
+  }
+
+  int room;
+  if (is_leaf) {
+    room = child->GetMaxSize() - child->GetSize();
+  } else {
+    if (BufferOf(child_page)->size_ == max_messages_) {
+      Flush(child_page);
+    }
+    room = max_messages_ - BufferOf(child_page)->size_;
+  }
+  int count = std::min(last - first, room);
+  assert(count > 0);
+  for (int i = first; i < first + count; i++) {
+    if (is_leaf) {
+      ApplyToLeaf(reinterpret_cast<LeafPage *>(child), buffer->messages_[i]);
+    } else {
+      PutMessage(BufferOf(child_page), buffer->messages_[i]);
+    }
+  }
+  memmove(buffer->messages_ + first, buffer->messages_ + first + count,
+          (buffer->size_ - first - count) * sizeof(Message));
+  buffer->size_ -= count;
+  buffer_pool_manager_->UnpinPage(child_id, true);
+}
+
+/*****************************************************************************
+ * SPLIT
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+KeyType BEPSILONTREE_TYPE::SplitLeaf(Page *page, page_id_t &page_id) {
+  LeafPage *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  Page *right_page = NewPage(page_id);
+  LeafPage *right = reinterpret_cast<LeafPage *>(right_page->GetData());
+  right->Init(page_id, INVALID_PAGE_ID, buffer_pool_manager_->GetPageSize());
+  leaf->MoveHalfTo(right, buffer_pool_manager_);
+  right->SetNextPageId(leaf->GetNextPageId());
+  leaf->SetNextPageId(page_id);
+  KeyType separator = right->KeyAt(0);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  return separator;
+}
+
+/*
+ * The messages from the separator on go along with the pivots
+ */
+INDEX_TEMPLATE_ARGUMENTS
+KeyType BEPSILONTREE_TYPE::SplitInternal(Page *page, page_id_t &page_id) {
+  InternalPage *node = reinterpret_cast<InternalPage *>(page->GetData());
+  Page *right_page = NewPage(page_id);
+  InternalPage *right = reinterpret_cast<InternalPage *>(right_page->GetData());
+  right->Init(page_id, INVALID_PAGE_ID, pivot_size_);
+  node->MoveHalfTo(right, buffer_pool_manager_);
+  KeyType separator = right->KeyAt(0);
+  Buffer *buffer = BufferOf(page);
+  Buffer *right_buffer = BufferOf(right_page);
+  int index = MessageIndex(buffer, separator);
+  right_buffer->size_ = buffer->size_ - index;
+  memcpy(right_buffer->messages_, buffer->messages_ + index,
+         right_buffer->size_ * sizeof(Message));
+  buffer->size_ = index;
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  return separator;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_TYPE::SplitRoot(const KeyType &separator,
+                                  page_id_t right_id) {
+  page_id_t root_id;
+  Page *page = NewPage(root_id);
+  InternalPage *root = reinterpret_cast<InternalPage *>(page->GetData());
+  root->Init(root_id, INVALID_PAGE_ID, pivot_size_);
+  root->PopulateNewRoot(root_page_id_, separator, right_id);
+  BufferOf(page)->size_ = 0;
+  root_page_id_ = root_id;
+  UpdateRootPageId(false);
+  buffer_pool_manager_->UnpinPage(root_id, true);
+}
+
+/*****************************************************************************
+ * BUFFERS
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+typename BEPSILONTREE_TYPE::Buffer *BEPSILONTREE_TYPE::BufferOf(Page *page) {
+  return reinterpret_cast<Buffer *>(page->GetData() + pivot_size_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int BEPSILONTREE_TYPE::MessageIndex(const Buffer *buffer,
+                                    const KeyType &key) {
+  int start = 0;
+  int end = buffer->size_;
+  while (start < end) {
+    int middle = start + ((end - start) >> 1);
+    if (comparator_(buffer->messages_[middle].key_, key) < 0) {
+      start = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return start;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_TYPE::PutMessage(Buffer *buffer, const Message &message) {
+  int index = MessageIndex(buffer, message.key_);
+  if (index < buffer->size_ &&
+      comparator_(buffer->messages_[index].key_, message.key_) == 0) {
+    buffer->messages_[index] = message;
+    return;
+  }
+  assert(buffer->size_ < max_messages_);
+  memmove(buffer->messages_ + index + 1, buffer->messages_ + index,
+          (buffer->size_ - index) * sizeof(Message));
+  buffer->messages_[index] = message;
+  buffer->size_++;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_TYPE::ChildMessages(InternalPage *node,
+                                      const Buffer *buffer, int index,
+                                      int &first, int &last) {
+  first = index == 0 ? 0 : MessageIndex(buffer, node->KeyAt(index));
+  last = index + 1 == node->GetSize()
+             ? buffer->size_
+             : MessageIndex(buffer, node->KeyAt(index + 1));
+}
+
+/*****************************************************************************
+ * UTILITIES
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+Page *BEPSILONTREE_TYPE::FetchPage(page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  return page;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BEPSILONTREE_TYPE::NewPage(page_id_t &page_id) {
+  Page *page = buffer_pool_manager_->NewPage(page_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  return page;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+size_t BEPSILONTREE_TYPE::CountMessages(page_id_t page_id) {
+  Page *page = FetchPage(page_id);
+  BPlusTreePage *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  size_t count = 0;
+  if (!node->IsLeafPage()) {
+    count = BufferOf(page)->size_;
+    InternalPage *internal = reinterpret_cast<InternalPage *>(node);
+    for (int i = 0; i < internal->GetSize(); i++) {
+      count += CountMessages(internal->ValueAt(i));
+    }
+  }
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return count;
+}
+
+/*
+ * Record the root page id in the header page, under the tree latch
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_TYPE::UpdateRootPageId(bool insert_record) {
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  header_page->WLatch();
+  if (insert_record && !header_page->InsertRecord(index_name_, root_page_id_))
+    header_page->UpdateRecord(index_name_, root_page_id_);
+  else if (!insert_record &&
+           !header_page->UpdateRecord(index_name_, root_page_id_))
+    header_page->InsertRecord(index_name_, root_page_id_);
+  header_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+}
+
+template class BEpsilonTree<GenericKey<4>, RID, GenericComparator<4>>;
+template class BEpsilonTree<GenericKey<8>, RID, GenericComparator<8>>;
+template class BEpsilonTree<GenericKey<16>, RID, GenericComparator<16>>;
+template class BEpsilonTree<GenericKey<32>, RID, GenericComparator<32>>;
+template class BEpsilonTree<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace cmudb
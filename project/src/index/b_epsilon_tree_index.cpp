@@ -0,0 +1,55 @@
+/**
+ * b_epsilon_tree_index.cpp
+ */
+
+#include "index/b_epsilon_tree_index.h"
+
+namespace cmudb {
+/*
+ * Constructor
+ */
+INDEX_TEMPLATE_ARGUMENTS
+BEPSILONTREE_INDEX_TYPE::BEpsilonTreeIndex(
+    IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager,
+    page_id_t root_page_id)
+    : Index(metadata), comparator_(metadata->GetKeySchema()),
+      container_(metadata->GetName(), buffer_pool_manager, comparator_,
+                 root_page_id) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid,
+                                          Transaction *transaction) {
+  // construct insert index key
+  KeyType index_key;
+  index_key.SetFromKey(key, GetKeySchema());
+
+  container_.Insert(index_key, rid, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID,
+                                          Transaction *transaction) {
+  // construct delete index key
+  KeyType index_key;
+  index_key.SetFromKey(key, GetKeySchema());
+
+  container_.Remove(index_key, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BEPSILONTREE_INDEX_TYPE::ScanKey(const Tuple &key,
+                                      std::vector<RID> &result,
+                                      Transaction *transaction) {
+  // construct scan index key
+  KeyType index_key;
+  index_key.SetFromKey(key, GetKeySchema());
+
+  container_.GetValue(index_key, result, transaction);
+}
+template class BEpsilonTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
+template class BEpsilonTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
+template class BEpsilonTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
+template class BEpsilonTreeIndex<GenericKey<32>, RID, GenericComparator<32>>;
+template class BEpsilonTreeIndex<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace cmudb
@@ -0,0 +1,341 @@
+/**
+ * b_link_tree.cpp
+ */
+#include <cassert>
+
+#include "common/exception.h"
+#include "index/b_link_tree.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+INDEX_TEMPLATE_ARGUMENTS
+BLINKTREE_TYPE::BLinkTree(const std::string &name,
+                          BufferPoolManager *buffer_pool_manager,
+                          const KeyComparator &comparator,
+                          page_id_t root_page_id)
+    : index_name_(name), root_page_id_(root_page_id),
+      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator),
+      node_size_(buffer_pool_manager->GetPageSize() - sizeof(Trailer)) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BLINKTREE_TYPE::IsEmpty() const {
+  return root_page_id_ == INVALID_PAGE_ID;
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+bool BLINKTREE_TYPE::GetValue(const KeyType &key,
+                              std::vector<ValueType> &result, Transaction *) {
+  if (IsEmpty()) {
+    return false;
+  }
+  Page *page = Descend(key, 0, false);
+  ValueType value;
+  bool found = reinterpret_cast<LeafPage *>(page->GetData())
+                   ->Lookup(key, value, comparator_);
+  Release(page, false, false);
+  if (found) {
+    result.push_back(value);
+  }
+  return found;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int BLINKTREE_TYPE::GetHeight() {
+  if (IsEmpty()) {
+    return 0;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  page->RLatch();
+  int height = TrailerOf(page)->level_ + 1;
+  Release(page, false, false);
+  return height;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+/*
+ * The leaf is split when full: its upper half goes into a new right
+ * sibling, linked in before the separator is posted to the parent
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BLINKTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
+                            Transaction *) {
+  if (IsEmpty()) {
+    std::lock_guard<std::mutex> guard(root_latch_);
+    if (IsEmpty()) {
+      Page *page = NewNode(0, nullptr);
+      LeafPage *root = reinterpret_cast<LeafPage *>(page->GetData());
+      root->Init(page->GetPageId(), INVALID_PAGE_ID, node_size_);
+      root->Insert(key, value, comparator_);
+      root_page_id_ = page->GetPageId();
+      UpdateRootPageId(true);
+      Release(page, true, true);
+      return true;
+    }
+  }
+  std::vector<page_id_t> path;
+  Page *page = Descend(key, 0, true, &path);
+  LeafPage *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  ValueType existing;
+  if (leaf->Lookup(key, existing, comparator_)) {
+    Release(page, true, false);
+    return false;
+  }
+  if (leaf->GetSize() < leaf->GetMaxSize()) {
+    leaf->Insert(key, value, comparator_);
+    Release(page, true, true);
+    return true;
+  }
+
+  Page *right_page = NewNode(0, page);
+  LeafPage *right = reinterpret_cast<LeafPage *>(right_page->GetData());
+  right->Init(right_page->GetPageId(), INVALID_PAGE_ID, node_size_);
+  leaf->MoveHalfTo(right, buffer_pool_manager_);
+  right->SetNextPageId(leaf->GetNextPageId());
+  leaf->SetNextPageId(right->GetPageId());
+  KeyType separator = right->KeyAt(0);
+  Trailer *trailer = TrailerOf(page);
+  trailer->right_page_id_ = right->GetPageId();
+  trailer->bounded_ = true;
+  trailer->high_key_ = separator;
+  if (comparator_(key, separator) < 0) {
+    leaf->Insert(key, value, comparator_);
+  } else {
+    right->Insert(key, value, comparator_);
+  }
+  // reachable through the right link of page only, which is still latched
+  page_id_t right_id = right->GetPageId();
+  Release(right_page, true, true);
+  InsertIntoParent(page, separator, right_id, 0, path);
+  return true;
+}
+
+/*
+ * The parent is the page above covering key, the last one of path unless it
+ * split since, or one the tree grew since page was reached
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BLINKTREE_TYPE::InsertIntoParent(Page *page, const KeyType &key,
+                                      page_id_t right_id, int level,
+                                      std::vector<page_id_t> &path) {
+  KeyType separator = key;
+  while (true) {
+    Page *parent_page;
+    if (path.empty()) {
+      std::unique_lock<std::mutex> guard(root_latch_);
+      if (root_page_id_ == page->GetPageId()) {
+        Page *root_page = NewNode(level + 1, nullptr);
+        InternalPage *root =
+            reinterpret_cast<InternalPage *>(root_page->GetData());
+        root->Init(root_page->GetPageId(), INVALID_PAGE_ID, node_size_);
+        root->PopulateNewRoot(page->GetPageId(), separator, right_id);
+        root_page_id_ = root_page->GetPageId();
+        UpdateRootPageId(false);
+        Release(root_page, true, true);
+        Release(page, true, true);
+        return;
+      }
+      guard.unlock();
+      parent_page = Descend(separator, level + 1, true);
+    } else {
+      parent_page = buffer_pool_manager_->FetchPage(path.back());
+      if (parent_page == nullptr) {
+        Release(page, true, true);
+        throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+      }
+      path.pop_back();
+      parent_page->WLatch();
+      parent_page = MoveRight(parent_page, separator, true);
+    }
+    page_id_t left_id = page->GetPageId();
+    Release(page, true, true);
+
+    InternalPage *parent =
+        reinterpret_cast<InternalPage *>(parent_page->GetData());
+    assert(parent->ValueIndex(left_id) != -1);
+    if (parent->GetSize() < parent->GetMaxSize()) {
+      parent->InsertNodeAfter(left_id, separator, right_id);
+      Release(parent_page, true, true);
+      return;
+    }
+    Page *sibling_page = NewNode(level + 1, parent_page);
+    InternalPage *sibling =
+        reinterpret_cast<InternalPage *>(sibling_page->GetData());
+    sibling->Init(sibling_page->GetPageId(), INVALID_PAGE_ID, node_size_);
+    parent->MoveHalfTo(sibling, buffer_pool_manager_);
+    KeyType parent_separator = sibling->KeyAt(0);
+    Trailer *trailer = TrailerOf(parent_page);
+    trailer->right_page_id_ = sibling->GetPageId();
+    trailer->bounded_ = true;
+    trailer->high_key_ = parent_separator;
+    if (sibling->ValueIndex(left_id) != -1) {
+      sibling->InsertNodeAfter(left_id, separator, right_id);
+    } else {
+      parent->InsertNodeAfter(left_id, separator, right_id);
+    }
+    right_id = sibling->GetPageId();
+    Release(sibling_page, true, true);
+    page = parent_page;
+    separator = parent_separator;
+    level++;
+  }
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+void BLINKTREE_TYPE::Remove(const KeyType &key, Transaction *) {
+  if (IsEmpty()) {
+    return;
+  }
+  Page *page = Descend(key, 0, true);
+  LeafPage *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int size = leaf->GetSize();
+  Release(page, true, leaf->RemoveAndDeleteRecord(key, comparator_) != size);
+}
+
+/*****************************************************************************
+ * UTILITIES
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+typename BLINKTREE_TYPE::Trailer *BLINKTREE_TYPE::TrailerOf(Page *page) {
+  return reinterpret_cast<Trailer *>(
+      page->GetData() + buffer_pool_manager_->GetPageSize() - sizeof(Trailer));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BLINKTREE_TYPE::NewNode(int level, Page *split) {
+  page_id_t page_id = INVALID_PAGE_ID;
+  Page *page = split == nullptr
+                   ? buffer_pool_manager_->NewPage(page_id)
+                   : buffer_pool_manager_->NewPage(page_id, split->GetPageId());
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  page->WLatch();
+  Trailer *trailer = TrailerOf(page);
+  if (split != nullptr) {
+    *trailer = *TrailerOf(split);
+  } else {
+    trailer->right_page_id_ = INVALID_PAGE_ID;
+    trailer->bounded_ = false;
+  }
+  trailer->level_ = level;
+  return page;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BLINKTREE_TYPE::IsBeyond(Page *page, const KeyType &key) {
+  Trailer *trailer = TrailerOf(page);
+  return trailer->bounded_ && comparator_(key, trailer->high_key_) >= 0;
+}
+
+/*
+ * One latch at a time: a page is let go of before its child or right
+ * sibling is latched, pages split meanwhile are made up for by MoveRight
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BLINKTREE_TYPE::Descend(const KeyType &key, int level, bool exclusive,
+                              std::vector<page_id_t> *path) {
+  Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  // the level of the root is not known before it is latched
+  page->RLatch();
+  bool write = exclusive && TrailerOf(page)->level_ == level;
+  if (write) {
+    page->RUnlatch();
+    page->WLatch();
+  }
+  while (true) {
+    page = MoveRight(page, key, write);
+    int page_level = TrailerOf(page)->level_;
+    assert(page_level >= level);
+    if (page_level == level) {
+      return page;
+    }
+    if (path != nullptr) {
+      path->push_back(page->GetPageId());
+    }
+    page_id_t child_id = reinterpret_cast<InternalPage *>(page->GetData())
+                             ->Lookup(key, comparator_);
+    Release(page, false, false);
+    page = buffer_pool_manager_->FetchPage(child_id);
+    if (page == nullptr) {
+      throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    write = exclusive && page_level - 1 == level;
+    if (write) {
+      page->WLatch();
+    } else {
+      page->RLatch();
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BLINKTREE_TYPE::MoveRight(Page *page, const KeyType &key,
+                                bool exclusive) {
+  while (IsBeyond(page, key)) {
+    page_id_t right_id = TrailerOf(page)->right_page_id_;
+    Release(page, exclusive, false);
+    page = buffer_pool_manager_->FetchPage(right_id);
+    if (page == nullptr) {
+      throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    if (exclusive) {
+      page->WLatch();
+    } else {
+      page->RLatch();
+    }
+  }
+  return page;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BLINKTREE_TYPE::Release(Page *page, bool exclusive, bool dirty) {
+  if (exclusive) {
+    page->WUnlatch();
+  } else {
+    page->RUnlatch();
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), dirty);
+}
+
+/*
+ * Record the root page id in the header page, under root_latch_
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BLINKTREE_TYPE::UpdateRootPageId(bool insert_record) {
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  header_page->WLatch();
+  if (insert_record && !header_page->InsertRecord(index_name_, root_page_id_))
+    header_page->UpdateRecord(index_name_, root_page_id_);
+  else if (!insert_record &&
+           !header_page->UpdateRecord(index_name_, root_page_id_))
+    header_page->InsertRecord(index_name_, root_page_id_);
+  header_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+}
+
+template class BLinkTree<GenericKey<4>, RID, GenericComparator<4>>;
+template class BLinkTree<GenericKey<8>, RID, GenericComparator<8>>;
+template class BLinkTree<GenericKey<16>, RID, GenericComparator<16>>;
+template class BLinkTree<GenericKey<32>, RID, GenericComparator<32>>;
+template class BLinkTree<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace cmudb
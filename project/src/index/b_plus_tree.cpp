@@ -1,11 +1,16 @@
 /**
  * b_plus_tree.cpp
  */
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/metrics.h"
 #include "common/rid.h"
 #include "index/b_plus_tree.h"
 #include "page/header_page.h"
@@ -16,9 +21,13 @@ INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(const std::string &name,
                                 BufferPoolManager *buffer_pool_manager,
                                 const KeyComparator &comparator,
-                                page_id_t root_page_id)
+                                page_id_t root_page_id,
+                                LogManager *log_manager, bool unique,
+                                RootCatalog *root_catalog)
     : index_name_(name), root_page_id_(root_page_id),
-      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {}
+      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator),
+      log_manager_(log_manager), unique_(unique), root_catalog_(root_catalog),
+      merge_fill_factor_(MERGE_FILL_FACTOR), key_compression_(false) {}
 
 /*
  * Helper function to decide whether current b+tree is empty
@@ -33,27 +42,104 @@ bool BPLUSTREE_TYPE::IsEmpty() const
  * SEARCH
  *****************************************************************************/
 /*
- * Return the only value that associated with input key
+ * Return the values that associated with input key, the whole posting list
+ * is read with the leaf still latched
  * This method is used for point query
  * @return : true means key exists
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key,
                               std::vector<ValueType> &result,
-                              Transaction *transaction)
+                              Transaction *)
 {
-  Page* root_page = buffer_pool_manager_->FetchPage(root_page_id_);
-  BPlusTreePage* btree_root_page = reinterpret_cast<BPlusTreePage*>(root_page);
-  BPluseTreeLeafPage* btree_leaf_page = FindLeafPage(key, false); 
+  Page *page = FindLeafPage(key, false, Operation::READ);
+  if (page == nullptr) {
+    return false;
+  }
+  B_PLUS_TREE_LEAF_PAGE_TYPE *leaf =
+      reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
   ValueType value;
+  bool found = leaf->Lookup(key, value, comparator_);
+  if (found) {
+    CollectValues(value, result);
+  }
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  return found;
+}
 
-  if (btree_leaf_page->Lookup(key, value, comparator_)) {
-    result.push_back(value);
-  } else {
-    return false;
+/*
+ * Lookups of sorted keys: the pages from the root down to the leaf of a key
+ * stay read latched, each with the end of its key range. The next key goes
+ * back up past the pages whose range it is beyond, then down from the lowest
+ * one left, the lowest common ancestor page of the two keys
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t BPLUSTREE_TYPE::GetValues(std::vector<KeyType> keys,
+                                 std::vector<ValueType> &result,
+                                 Transaction *)
+{
+  std::sort(keys.begin(), keys.end(),
+            [this](const KeyType &lhs, const KeyType &rhs) {
+              return comparator_(lhs, rhs) < 0;
+            });
+  root_latch_.RLock();
+  if (IsEmpty()) {
+    root_latch_.RUnlock();
+    return 0;
   }
-  buffer_pool_manager_->UnpinPage(btree_leaf_page->GetPageId(), false);
-  return true;
+  std::vector<std::pair<Page *, KeyBound>> path;
+  auto release = [this, &path] {
+    for (auto &entry : path) {
+      entry.first->RUnlatch();
+      buffer_pool_manager_->UnpinPage(entry.first->GetPageId(), false);
+    }
+    root_latch_.RUnlock();
+  };
+  Page *root = buffer_pool_manager_->FetchPage(root_page_id_);
+  if (root == nullptr) {
+    release();
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  root->RLatch();
+  path.emplace_back(root, KeyBound{false, KeyType()});
+
+  size_t found = 0;
+  for (auto &key : keys) {
+    // the root has no end
+    while (path.back().second.bounded_ &&
+           comparator_(key, path.back().second.key_) >= 0) {
+      path.back().first->RUnlatch();
+      buffer_pool_manager_->UnpinPage(path.back().first->GetPageId(), false);
+      path.pop_back();
+    }
+    BPlusTreePage *node =
+        reinterpret_cast<BPlusTreePage *>(path.back().first->GetData());
+    while (!node->IsLeafPage()) {
+      InternalPage *internal = reinterpret_cast<InternalPage *>(node);
+      int index = internal->ChildIndex(key, comparator_);
+      KeyBound bound = path.back().second;
+      if (index + 1 < internal->GetSize()) {
+        bound = KeyBound{true, internal->KeyAt(index + 1)};
+      }
+      Page *page = buffer_pool_manager_->FetchPage(internal->ValueAt(index));
+      if (page == nullptr) {
+        release();
+        throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+      }
+      page->RLatch();
+      path.emplace_back(page, bound);
+      node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    }
+    ValueType value;
+    if (reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(node)->Lookup(
+            key, value, comparator_)) {
+      CollectValues(value, result);
+      found++;
+    }
+  }
+  release();
+  return found;
 }
 
 /*****************************************************************************
@@ -63,21 +149,95 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key,
  * Insert constant key & value pair into b+ tree
  * if current tree is empty, start new tree, update root page id and insert
  * entry, otherwise insert into leaf page.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * @return: in a unique tree, if user try to insert duplicate keys return
+ * false, otherwise return true.
+ * Only the leaf is write latched, unless it is full and key is not there
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
                             Transaction *transaction)
 {
-  bool ret = true;
-  if (IsEmpty()) {
-    StartNewTree(key, value);
+  Transaction local(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local;
+  }
+  Page *page = FindLeafPage(key, false, Operation::INSERT, transaction);
+  if (page != nullptr) {
+    B_PLUS_TREE_LEAF_PAGE_TYPE *leaf =
+        reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    ValueType existing;
+    if (IsSafe(leaf, Operation::INSERT) ||
+        leaf->Lookup(key, existing, comparator_)) {
+      bool inserted = InsertIntoLeaf(key, value, leaf, transaction);
+      ReleasePages(transaction, inserted);
+      return inserted;
+    }
+    ReleasePages(transaction, false);
+  }
+  page = FindLeafPage(key, false, Operation::INSERT, transaction, true);
+  bool inserted = true;
+  if (page == nullptr) {
+    StartNewTree(key, value, transaction);
   } else {
-    ret = InsertIntoLeaf(key, value);
+    inserted = InsertIntoLeaf(
+        key, value,
+        reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData()),
+        transaction);
+  }
+  ReleasePages(transaction, inserted);
+  return inserted;
+}
+/*
+ * Inserts of sorted pairs: the leaf of a pair, reached as by Insert with the
+ * leaf alone write latched, takes the pairs after it as long as they are
+ * below the end of its key range and it has room. A pair that would split
+ * the leaf is left to Insert
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t BPLUSTREE_TYPE::InsertBatch(std::vector<MappingType> items,
+                                   Transaction *transaction)
+{
+  std::sort(items.begin(), items.end(),
+            [this](const MappingType &lhs, const MappingType &rhs) {
+              return comparator_(lhs.first, rhs.first) < 0;
+            });
+  Transaction local(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local;
+  }
+  size_t inserted = 0;
+  size_t i = 0;
+  while (i < items.size()) {
+    KeyBound bound;
+    Page *page = FindLeafPage(items[i].first, false, Operation::INSERT,
+                              transaction, false, &bound);
+    if (page == nullptr) {
+      inserted += Insert(items[i].first, items[i].second, transaction);
+      ++i;
+      continue;
+    }
+    B_PLUS_TREE_LEAF_PAGE_TYPE *leaf =
+        reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    size_t first = i;
+    size_t leaf_inserted = 0;
+    while (i < items.size() && IsSafe(leaf, Operation::INSERT) &&
+           (i == first || !bound.bounded_ ||
+            comparator_(items[i].first, bound.key_) < 0)) {
+      leaf_inserted += InsertIntoLeaf(items[i].first, items[i].second, leaf,
+                                      transaction);
+      ++i;
+    }
+    ReleasePages(transaction, leaf_inserted > 0);
+    inserted += leaf_inserted;
+    if (i == first) {
+      // the leaf is full
+      inserted += Insert(items[i].first, items[i].second, transaction);
+      ++i;
+    }
   }
-  return ret;
+  return inserted;
 }
+
 /*
  * Insert constant key & value pair into an empty tree
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
@@ -85,60 +245,74 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
  * tree's root page id and insert entry directly into leaf page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value)
+void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value,
+                                  Transaction *transaction)
 {
-  Page* page = buffer_pool_manager_->NewPage(root_page_id_);
+  page_id_t page_id = INVALID_PAGE_ID;
+  Page *page = buffer_pool_manager_->NewPage(page_id);
   if (page == nullptr) {
     throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
   }
-  BPluseTreeLeafPage* btree_leaf_page = reinterpret_cast<BPluseTreeLeafPage*>(page->GetData());
-  UpdateRootPageId(true);
-  btree_leaf_page->Init(root_page_id_);
-  btree_leaf_page->Insert(key, value, comparator_);
-  buffer_pool_manager_->UnpinPage(root_page_id_, true);
+  BPlusTreeLog log(buffer_pool_manager_, log_manager_, transaction);
+  log.Track(page_id, true);
+  B_PLUS_TREE_LEAF_PAGE_TYPE *root =
+      reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+  root->Init(page_id, INVALID_PAGE_ID, buffer_pool_manager_->GetPageSize());
+  root->Insert(key, value, comparator_);
+  root_page_id_ = page_id;
+  UpdateRootPageId(log, true);
+  log.Finish();
+  buffer_pool_manager_->UnpinPage(page_id, true);
 }
 
 /*
  * Insert constant key & value pair into leaf page
- * User needs to first find the right leaf page as insertion target, then look
- * through leaf page to see whether insert key exist or not. If exist, return
- * immdiately, otherwise insert entry. Remember to deal with split if necessary.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * The leaf is the right one for key, latched with what a split changes, see
+ * FindLeafPage. Look through leaf page to see whether insert key exist or
+ * not. If exist, return immdiately, or add value to the key's posting list,
+ * otherwise insert entry. Remember to deal with split if necessary.
+ * @return: false for a duplicate key, or in a non-unique tree pair
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
+                                    B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
                                     Transaction *transaction)
 {
-  BPluseTreeLeafPage* btree_leaf_page = FindLeafPage(key, false);                                 
-  ValueType tmp;
-
-  // insert duplicate key
-  if (btree_leaf_page->Lookup(key, tmp, comparator_)) {
-    return false;
-  } else {
-    // safe node
-    if (btree_leaf_page->GetSize() < btree_leaf_page->GetMaxSize()) {
-      btree_leaf_page->Insert(key, value, comparator_);
-    } else {
-      BPluseTreeLeafPage* btree_new_laef_page = Split(btree_leaf_page);
-
-      btree_new_laef_page->SetNextPageId(btree_leaf_page->GetNextPageId());
-      btree_leaf_page->SetNextPageId(btree_new_leaf_page->GetPageId());
-      KeyType mid_key = btree_new_laef_page->KeyAt(0);
-
-      InsertIntoParent(btree_leaf_page, mid_key, btree_new_laef_page);
+  int slot = leaf->KeyIndex(key, comparator_);
+  if (slot < leaf->GetSize() && comparator_(leaf->KeyAt(slot), key) == 0) {
+    return !unique_ && InsertIntoPosting(leaf, slot, value, transaction);
+  }
 
-      // Insert into left half
-      if (comparator_(key, mid_key) < 0) {
-        btree_leaf_page->Insert(key, value, comparator_);
-      } else { // Insert into right half
-        btree_new_leaf_page->Insert(key, value, comparator_);
-      }
-      buffer_pool_manager_->UnpinPage(btree_new_laef_page->GetPageId(), true);
+  B_PLUS_TREE_LEAF_PAGE_TYPE *target = leaf;
+  B_PLUS_TREE_LEAF_PAGE_TYPE *new_leaf = nullptr;
+  if (leaf->GetSize() >= leaf->GetMaxSize()) {
+    // split first, the entry goes into the half it belongs to, logged on its
+    // own like any other insert
+    BPlusTreeLog log(buffer_pool_manager_, log_manager_, transaction);
+    log.Track(leaf->GetPageId());
+    new_leaf = Split(leaf, log);
+    new_leaf->SetNextPageId(leaf->GetNextPageId());
+    new_leaf->SetPrevPageId(leaf->GetPageId());
+    new_leaf->LinkNext(buffer_pool_manager_);
+    leaf->SetNextPageId(new_leaf->GetPageId());
+    KeyType separator = new_leaf->KeyAt(0);
+    if (key_compression_) {
+      separator = KeyPrefix<KeyType, ValueType>::Separator(
+          leaf->KeyAt(leaf->GetSize() - 1), separator);
+    }
+    InsertIntoParent(leaf, separator, new_leaf, log, transaction);
+    log.Finish();
+    if (comparator_(key, separator) >= 0) {
+      target = new_leaf;
     }
   }
-  buffer_pool_manager_->UnpinPage(btree_laef_page->GetPageId(), true);
+  slot = target->KeyIndex(key, comparator_);
+  target->Insert(key, value, comparator_);
+  LogEntry(LogRecordType::BTREEINSERT, target, slot, transaction);
+  // only reachable through the pages latched, it needs no latch of its own
+  if (new_leaf != nullptr) {
+    buffer_pool_manager_->UnpinPage(new_leaf->GetPageId(), true);
+  }
   return true;
 }
 
@@ -150,17 +324,22 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
  * of key & value pairs from input page to newly created page
  */
 INDEX_TEMPLATE_ARGUMENTS
-template <typename N> N *BPLUSTREE_TYPE::Split(N *node)
+template <typename N> N *BPLUSTREE_TYPE::Split(N *node, BPlusTreeLog &log)
 {
   page_id_t page_id = INVALID_PAGE_ID;
-  Page* page = buffer_pool_manager_->NewPage(page_id);
+  // next to the node split, keeps the leaf chain sequential on disk
+  Page *page = buffer_pool_manager_->NewPage(page_id, node->GetPageId());
   if (page == nullptr) {
     throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
   }
-  N* new_node = reinterpret_cast<N*>(page->GetData());
-  new_node->Init(page_id, node->GetParentPageId());
+  log.Track(page_id, true);
+  TRACE_POINT(btree, split, node->GetPageId(), page_id, node->IsLeafPage());
+  N *new_node = reinterpret_cast<N *>(page->GetData());
+  new_node->Init(page_id, node->GetParentPageId(),
+                 buffer_pool_manager_->GetPageSize());
   node->MoveHalfTo(new_node, buffer_pool_manager_);
-  return new_node; 
+  Reparent(new_node, 0, new_node->GetSize(), log);
+  return new_node;
 }
 
 /*
@@ -176,40 +355,202 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node,
                                       const KeyType &key,
                                       BPlusTreePage *new_node,
+                                      BPlusTreeLog &log,
                                       Transaction *transaction)
 {
   // also means old_root_page is full
   if (old_node->IsRootPage()) {
-    // first generate new root_page
-    Page* new_root_page = buffer_pool_manager_->NewPage(root_page_id_);
-    if (new_root_page == nullptr) {
+    page_id_t root_id = INVALID_PAGE_ID;
+    Page *page = buffer_pool_manager_->NewPage(root_id);
+    if (page == nullptr) {
       throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
     }
-    BPlusTreeInternalPage* btree_root_page = reinterpret_cast<BPlusTreeInternalPage*>(new_root_page->GetData());
-    btree_root_page->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
-    old_node->SetParentPageId(root_page_id_);
-    new_node->SetParentPageId(root_page_id_);
-    UpdateRootPageId(false);
-  } else { 
-    Page* old_page = old_node->GetParentPageId();
-    BPlusTreeInternalPage* btree_old_page = reinterpret_cast<BPlusTreeInternalPage*>(old_page->GetData());
-    // parent page is not full
-    if (btree_old_page->GetSize() < btree_parent_page->GetMaxSize()) {
-      btree_old_page->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
-    } else {
-      BPlusTreeInternalPage* btree_new_page = Split(btree_old_page);
-      KeyType mid_key = btree_new_page->KeyAt(0);
-      if (comparator_(key, mid_key) < 0) {
-        btree_old_page->InsertNodeAfter(old_node.GetPageId(), key, new_old->GetPageId());
-      } else {
-        btree_new_page->InsertNodeAfter(old_node.GetPageId(), key, new_old->GetPageId());
-        new_old->SetParentPageId(btree_new_page->GetPageId());
-      }
-      InsertIntoParent(btree_old_page, key, btree_new_page);
-      buffer_pool_manager_->UnpinPage(btree_new_page->GetPageId(), true);
+    log.Track(root_id, true);
+    InternalPage *root = reinterpret_cast<InternalPage *>(page->GetData());
+    root->Init(root_id, INVALID_PAGE_ID, buffer_pool_manager_->GetPageSize());
+    root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
+    old_node->SetParentPageId(root_id);
+    new_node->SetParentPageId(root_id);
+    root_page_id_ = root_id;
+    UpdateRootPageId(log);
+    buffer_pool_manager_->UnpinPage(root_id, true);
+    return;
+  }
+
+  page_id_t parent_id = old_node->GetParentPageId();
+  Page *page = buffer_pool_manager_->FetchPage(parent_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  log.Track(parent_id);
+  InternalPage *parent = reinterpret_cast<InternalPage *>(page->GetData());
+  // parent page is not full
+  if (parent->GetSize() < parent->GetMaxSize()) {
+    parent->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
+    new_node->SetParentPageId(parent_id);
+    CompressKeys(old_node, parent);
+    CompressKeys(new_node, parent);
+    buffer_pool_manager_->UnpinPage(parent_id, true);
+    return;
+  }
+
+  // split the parent first, then the new entry goes next to old_node
+  InternalPage *new_parent = Split(parent, log);
+  InternalPage *holder = parent;
+  if (new_parent->ValueIndex(old_node->GetPageId()) != -1) {
+    holder = new_parent;
+  }
+  holder->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
+  new_node->SetParentPageId(holder->GetPageId());
+  CompressKeys(old_node, holder);
+  CompressKeys(new_node, holder);
+  InsertIntoParent(parent, new_parent->KeyAt(0), new_parent, log,
+                   transaction);
+  buffer_pool_manager_->UnpinPage(new_parent->GetPageId(), true);
+  buffer_pool_manager_->UnpinPage(parent_id, true);
+}
+
+/*
+ * Bulk load: how many pages each level gets is known up front, so pages are
+ * filled once, left to right, with no splits. Entries are spread evenly over
+ * the pages of a level, as many pages as fill_factor needs but never so many
+ * that one is below min size; a level of one page is the root. A page is added
+ * to its parent when it is started, parents first, and written when the next
+ * page of its level starts. The pages are not logged: the root is only
+ * published, and logged, once all of them are written
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::BulkLoad(const std::vector<MappingType> &items,
+                              double fill_factor, Transaction *transaction)
+{
+  for (size_t i = 1; i < items.size(); ++i) {
+    if (comparator_(items[i - 1].first, items[i].first) >= 0) {
+      return false;
     }
-    buffer_pool_manager_->UnpinPage(btree_old_page->GetPageId(), true);
   }
+  auto it = items.begin();
+  return BulkLoad(items.size(),
+                  [&it, &items](MappingType &item) {
+                    if (it == items.end()) {
+                      return false;
+                    }
+                    item = *it++;
+                    return true;
+                  },
+                  fill_factor, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::BulkLoad(size_t count,
+                              const std::function<bool(MappingType &)> &next,
+                              double fill_factor, Transaction *transaction)
+{
+  root_latch_.WLock();
+  if (!IsEmpty() || count == 0) {
+    root_latch_.WUnlock();
+    return count == 0 && IsEmpty();
+  }
+
+  // the max sizes Init gives
+  size_t page_size = buffer_pool_manager_->GetPageSize();
+  int leaf_max_size = static_cast<int>(
+      (page_size - sizeof(B_PLUS_TREE_LEAF_PAGE_TYPE)) / sizeof(MappingType));
+  int internal_max_size =
+      static_cast<int>((page_size - sizeof(InternalPage)) /
+                       sizeof(std::pair<KeyType, page_id_t>));
+  std::vector<LoadLevel> levels;
+  int entries = static_cast<int>(count);
+  while (true) {
+    int max_size = levels.empty() ? leaf_max_size : internal_max_size;
+    int min_size = max_size / 2;
+    int fill = std::max(
+        min_size, std::min(max_size, static_cast<int>(max_size * fill_factor)));
+    int pages = (entries + fill - 1) / fill;
+    if (min_size > 0) {
+      pages = std::min(pages, entries / min_size);
+    }
+    pages = std::max(pages, 1);
+    levels.push_back(LoadLevel{entries, pages, -1, 0, nullptr});
+    if (pages == 1) {
+      break;
+    }
+    entries = pages;
+  }
+
+  MappingType item;
+  for (size_t i = 0; i < count; i++) {
+    if (!next(item)) {
+      root_latch_.WUnlock();
+      throw Exception(EXCEPTION_TYPE_INDEX, "bulk load ran out of items");
+    }
+    Page *page = LoadPage(levels, 0, item.first);
+    reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData())
+        ->Insert(item.first, item.second, comparator_);
+  }
+  for (auto &level : levels) {
+    page_id_t page_id = level.page_->GetPageId();
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    buffer_pool_manager_->FlushPage(page_id);
+  }
+  root_page_id_ = levels.back().page_->GetPageId();
+  BPlusTreeLog log(buffer_pool_manager_, log_manager_, transaction);
+  UpdateRootPageId(log, true);
+  log.Finish();
+  root_latch_.WUnlock();
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::LoadPage(std::vector<LoadLevel> &levels, size_t level,
+                               const KeyType &key)
+{
+  LoadLevel &load = levels[level];
+  if (load.page_ != nullptr) {
+    int share = load.entries_ / load.pages_ +
+                (load.page_index_ < load.entries_ % load.pages_ ? 1 : 0);
+    if (load.filled_ < share) {
+      load.filled_++;
+      return load.page_;
+    }
+  }
+
+  // next to the one before, keeps each level sequential on disk
+  page_id_t page_id = INVALID_PAGE_ID;
+  Page *page = buffer_pool_manager_->NewPage(
+      page_id,
+      load.page_ == nullptr ? INVALID_PAGE_ID : load.page_->GetPageId());
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  page_id_t parent_id = INVALID_PAGE_ID;
+  if (level + 1 < levels.size()) {
+    Page *parent = LoadPage(levels, level + 1, key);
+    reinterpret_cast<InternalPage *>(parent->GetData())->Append(key, page_id);
+    parent_id = parent->GetPageId();
+  }
+  size_t page_size = buffer_pool_manager_->GetPageSize();
+  if (level == 0) {
+    reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData())
+        ->Init(page_id, parent_id, page_size);
+  } else {
+    reinterpret_cast<InternalPage *>(page->GetData())
+        ->Init(page_id, parent_id, page_size);
+  }
+  if (load.page_ != nullptr) {
+    page_id_t done_id = load.page_->GetPageId();
+    if (level == 0) {
+      reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(load.page_->GetData())
+          ->SetNextPageId(page_id);
+      reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData())
+          ->SetPrevPageId(done_id);
+    }
+    buffer_pool_manager_->UnpinPage(done_id, true);
+    buffer_pool_manager_->FlushPage(done_id);
+  }
+  load.page_ = page;
+  load.page_index_++;
+  load.filled_ = 1;
+  return page;
 }
 
 /*****************************************************************************
@@ -225,18 +566,95 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node,
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction)
 {
-  if (IsEmpty()) {
-    return;
+  RemoveValue(key, nullptr, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Remove(const KeyType &key, const ValueType &value,
+                            Transaction *transaction)
+{
+  RemoveValue(key, &value, transaction);
+}
+
+/*
+ * Only a value out of a posting list leaves the key in the leaf, the leaf
+ * does not shrink then
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RemoveValue(const KeyType &key, const ValueType *value,
+                                 Transaction *transaction)
+{
+  Transaction local(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local;
   }
-  BPlusTreeLeafPage* btree_leaf_page = FindLeafPage(key, false);
-  
-  if (btree_leaf_page == nullptr) {
+  // only the leaf is write latched, unless it may underflow
+  Page *page = FindLeafPage(key, false, Operation::REMOVE, transaction);
+  if (page == nullptr) {
     return;
   }
+  B_PLUS_TREE_LEAF_PAGE_TYPE *leaf =
+      reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+  ValueType existing;
+  if (!IsSafe(leaf, Operation::REMOVE) &&
+      leaf->Lookup(key, existing, comparator_) &&
+      (value == nullptr || unique_ ||
+       !BPlusTreePostingPage::IsList(existing))) {
+    ReleasePages(transaction, false);
+    page = FindLeafPage(key, false, Operation::REMOVE, transaction, true);
+    if (page == nullptr) {
+      ReleasePages(transaction, false);
+      return;
+    }
+    leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+  }
+  bool removed = RemoveFromLeaf(key, value, leaf, transaction);
+  ReleasePages(transaction, removed);
+}
 
-  if (btree_leaef_page->GetSize() < btree_leaf_page->GetMinSize()) {
-    CoalesceOrRedistribute(btree_leaf_page, transaction);
+/*
+ * Delete key from leaf, latched with what a merge changes, see FindLeafPage.
+ * With value given, only if that is its value, or out of its posting list.
+ * The pages emptied go into the deleted page set of transaction
+ * @return: false if key, or value, is not there
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::RemoveFromLeaf(const KeyType &key,
+                                    const ValueType *value,
+                                    B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                                    Transaction *transaction)
+{
+  page_id_t leaf_id = leaf->GetPageId();
+  int slot = leaf->KeyIndex(key, comparator_);
+  if (slot == leaf->GetSize() || comparator_(leaf->KeyAt(slot), key) != 0) {
+    return false;
   }
+  ValueType stored = leaf->ValueAt(slot);
+  if (!unique_ && BPlusTreePostingPage::IsList(stored)) {
+    if (value != nullptr) {
+      return RemoveFromPosting(leaf, slot, *value, transaction);
+    }
+    DropPosting(stored, transaction);
+  } else if (value != nullptr && !(stored == *value)) {
+    return false;
+  }
+  LogEntry(LogRecordType::BTREEDELETE, leaf, slot, transaction);
+  leaf->RemoveAndDeleteRecord(key, comparator_);
+
+  bool underflow = leaf->IsRootPage() ? leaf->GetSize() == 0
+                                      : leaf->GetSize() < GetMergeSize(leaf);
+  if (!underflow) {
+    return true;
+  }
+  BPlusTreeLog log(buffer_pool_manager_, log_manager_, transaction);
+  log.Track(leaf_id);
+  bool delete_leaf = CoalesceOrRedistribute(leaf, log, transaction);
+  if (delete_leaf) {
+    log.Forget(leaf_id);
+    transaction->AddIntoDeletedPageSet(leaf_id);
+  }
+  log.Finish();
+  return true;
 }
 
 /*
@@ -248,8 +666,66 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction)
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
-  return false;
+bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, BPlusTreeLog &log,
+                                            Transaction *transaction)
+{
+  if (node->IsRootPage()) {
+    return AdjustRoot(node, log);
+  }
+  page_id_t parent_id = node->GetParentPageId();
+  Page *page = buffer_pool_manager_->FetchPage(parent_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  log.Track(parent_id);
+  InternalPage *parent = reinterpret_cast<InternalPage *>(page->GetData());
+
+  // the left sibling, the right one for the first child. It is latched and
+  // released with the page set, no one else gets to it through parent
+  int index = parent->ValueIndex(node->GetPageId());
+  page_id_t sibling_id = parent->ValueAt(index == 0 ? 1 : index - 1);
+  page = buffer_pool_manager_->FetchPage(sibling_id);
+  if (page == nullptr) {
+    buffer_pool_manager_->UnpinPage(parent_id, false);
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  page->WLatch();
+  transaction->AddIntoPageSet(page);
+  log.Track(sibling_id);
+  N *sibling = reinterpret_cast<N *>(page->GetData());
+
+  // with key compression the two may share a shorter prefix than either
+  // has, and fit fewer entries. If node cannot take one more then, it is
+  // left underfull; it is never below one entry, or an internal page below
+  // two, as any page fits that
+  int max_size =
+      node->SharedMaxSize(sibling, buffer_pool_manager_->GetPageSize());
+  if (sibling->GetSize() + node->GetSize() > max_size) {
+    if (node->GetSize() >= max_size) {
+      buffer_pool_manager_->UnpinPage(parent_id, false);
+      return false;
+    }
+    Redistribute(sibling, node, index, log);
+    buffer_pool_manager_->UnpinPage(parent_id, true);
+    return false;
+  }
+
+  // the right page of the two is merged into the left one
+  bool delete_node = index != 0;
+  bool delete_parent;
+  if (delete_node) {
+    delete_parent = Coalesce(sibling, node, parent, index, log, transaction);
+  } else {
+    delete_parent = Coalesce(node, sibling, parent, 1, log, transaction);
+    log.Forget(sibling_id);
+    transaction->AddIntoDeletedPageSet(sibling_id);
+  }
+  if (delete_parent) {
+    log.Forget(parent_id);
+    transaction->AddIntoDeletedPageSet(parent_id);
+  }
+  buffer_pool_manager_->UnpinPage(parent_id, true);
+  return delete_node;
 }
 
 /*
@@ -266,15 +742,20 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-bool BPLUSTREE_TYPE::Coalesce(
-    N *&neighbor_node, N *&node,
-    BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *&parent,
-    int index, Transaction *transaction)
+bool BPLUSTREE_TYPE::Coalesce(N *&neighbor_node, N *&node,
+                              InternalPage *&parent, int index,
+                              BPlusTreeLog &log, Transaction *transaction)
 {
+  // node is deleted by the caller, once it is unpinned
+  int moved = neighbor_node->GetSize();
   node->MoveAllTo(neighbor_node, index, buffer_pool_manager_);
-  buffer_pool_manager_->DeletePage(node->GetPageId());
-  if (parent->GetSize() < parent->GetMinSize()) {
-    return CoalesceOrRedistribute(parent, transaction);
+  Reparent(neighbor_node, moved, neighbor_node->GetSize(), log);
+  parent->Remove(index);
+  bool underflow = parent->IsRootPage()
+                       ? parent->GetSize() == 1
+                       : parent->GetSize() < GetMergeSize(parent);
+  if (underflow) {
+    return CoalesceOrRedistribute(parent, log, transaction);
   }
   return false;
 }
@@ -290,7 +771,17 @@ bool BPLUSTREE_TYPE::Coalesce(
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
+void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index,
+                                  BPlusTreeLog &log)
+{
+  if (index == 0) {
+    neighbor_node->MoveFirstToEndOf(node, buffer_pool_manager_);
+    Reparent(node, node->GetSize() - 1, node->GetSize(), log);
+  } else {
+    neighbor_node->MoveLastToFrontOf(node, index, buffer_pool_manager_);
+    Reparent(node, 0, 1, log);
+  }
+}
 /*
  * Update root page if necessary
  * NOTE: size of root page can be less than min size and this method is only
@@ -302,27 +793,212 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
  * happend
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
-  int size = old_root_page->GetSize();
-  if (!old_root_page->IsLeafPage()) {
-    if (size == 1) {
-      BPlusTreeInternalPage* old_root_node = reinterpret_cast<BPlusTreeInternalPage*>(old_root_page);
-      root_page_id_ = old_root_node->ValueAt(0);
-      UpdateRootPageId(false);
-      Page* new_root_page = buffer_pool_manager_->FetchPage(root_page_id_);
-      BPlusTreePage* new_root_node = reinterpret_cast<BPlusTreePage*>(page->GetData());
-      new_root_node->SetParentPageId(INVALID_PAGE_ID);
-      buffer_pool_manager_->UnpinPage(new_root_node->GetPageId(), true); 
-      return true;
+bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node,
+                                BPlusTreeLog &log)
+{
+  if (!old_root_node->IsLeafPage() && old_root_node->GetSize() == 1) {
+    InternalPage *old_root = reinterpret_cast<InternalPage *>(old_root_node);
+    root_page_id_ = old_root->RemoveAndReturnOnlyChild();
+    SetParent(root_page_id_, INVALID_PAGE_ID, log);
+    UpdateRootPageId(log);
+    return true;
+  }
+  if (old_root_node->IsLeafPage() && old_root_node->GetSize() == 0) {
+    root_page_id_ = INVALID_PAGE_ID;
+    UpdateRootPageId(log);
+    return true;
+  }
+  return false;
+}
+
+/*****************************************************************************
+ * POSTING LISTS
+ *****************************************************************************/
+/*
+ * A second value of a key starts its posting list. Otherwise value goes to
+ * the first page of the list not ending below it, or the last one; a full
+ * page is split first, the upper half into a new page after it. All of it
+ * is one BTREESTRUCTURE record
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::InsertIntoPosting(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                                       int slot, const ValueType &value,
+                                       Transaction *transaction)
+{
+  ValueType stored = leaf->ValueAt(slot);
+  if (stored == value) {
+    return false;
+  }
+  size_t page_size = buffer_pool_manager_->GetPageSize();
+  BPlusTreeLog log(buffer_pool_manager_, log_manager_, transaction);
+  if (!BPlusTreePostingPage::IsList(stored)) {
+    page_id_t page_id = INVALID_PAGE_ID;
+    Page *page = buffer_pool_manager_->NewPage(page_id, leaf->GetPageId());
+    if (page == nullptr) {
+      throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
     }
-  } else {
-    if (old_root_page->GetSize() == 0) {
-      root_page_id_ = INVALID_PAGE_ID;
-      UpdateRootPageId(false);
-      return true;
+    log.Track(page_id, true);
+    log.Track(leaf->GetPageId());
+    auto posting = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+    posting->Init(page_id, page_size);
+    posting->Insert(stored);
+    posting->Insert(value);
+    leaf->SetValueAt(slot, BPlusTreePostingPage::ListRid(page_id));
+    log.Finish();
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    return true;
+  }
+
+  page_id_t page_id = stored.GetPageId();
+  BPlusTreePostingPage *posting = FetchPosting(page_id);
+  while (posting->GetNextPageId() != INVALID_PAGE_ID &&
+         BPlusTreePostingPage::Less(posting->RidAt(posting->GetSize() - 1),
+                                    value)) {
+    page_id_t next_page_id = posting->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+    posting = FetchPosting(page_id);
+  }
+  int index = posting->RidIndex(value);
+  if (index < posting->GetSize() && posting->RidAt(index) == value) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return false;
+  }
+  log.Track(page_id);
+  BPlusTreePostingPage *target = posting;
+  BPlusTreePostingPage *new_posting = nullptr;
+  if (posting->IsFull()) {
+    page_id_t new_page_id = INVALID_PAGE_ID;
+    Page *page = buffer_pool_manager_->NewPage(new_page_id, page_id);
+    if (page == nullptr) {
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    log.Track(new_page_id, true);
+    new_posting = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+    new_posting->Init(new_page_id, page_size);
+    posting->MoveHalfTo(new_posting);
+    if (!BPlusTreePostingPage::Less(value, new_posting->RidAt(0))) {
+      target = new_posting;
     }
   }
-  return false;
+  target->Insert(value);
+  log.Finish();
+  if (new_posting != nullptr) {
+    buffer_pool_manager_->UnpinPage(new_posting->GetPageId(), true);
+  }
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  return true;
+}
+
+/*
+ * A page emptied is unlinked and deleted, pages are not merged. The last
+ * value left goes back into the leaf
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::RemoveFromPosting(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                                       int slot, const ValueType &value,
+                                       Transaction *transaction)
+{
+  page_id_t head_id = leaf->ValueAt(slot).GetPageId();
+  page_id_t prev_id = INVALID_PAGE_ID;
+  page_id_t page_id = head_id;
+  BPlusTreePostingPage *posting = FetchPosting(page_id);
+  // only the first page not ending below value may have it
+  while (posting->RidIndex(value) == posting->GetSize()) {
+    page_id_t next_page_id = posting->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    if (next_page_id == INVALID_PAGE_ID) {
+      return false;
+    }
+    prev_id = page_id;
+    page_id = next_page_id;
+    posting = FetchPosting(page_id);
+  }
+  if (!(posting->RidAt(posting->RidIndex(value)) == value)) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return false;
+  }
+
+  BPlusTreeLog log(buffer_pool_manager_, log_manager_, transaction);
+  log.Track(leaf->GetPageId());
+  log.Track(page_id);
+  posting->Remove(value);
+  page_id_t next_page_id = posting->GetNextPageId();
+  bool emptied = posting->GetSize() == 0;
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  if (emptied) {
+    // a list has two values at least, one of them is on another page
+    if (prev_id == INVALID_PAGE_ID) {
+      head_id = next_page_id;
+      leaf->SetValueAt(slot, BPlusTreePostingPage::ListRid(head_id));
+    } else {
+      log.Track(prev_id);
+      BPlusTreePostingPage *prev = FetchPosting(prev_id);
+      prev->SetNextPageId(next_page_id);
+      buffer_pool_manager_->UnpinPage(prev_id, true);
+    }
+    log.Forget(page_id);
+    transaction->AddIntoDeletedPageSet(page_id);
+  }
+  BPlusTreePostingPage *head = FetchPosting(head_id);
+  if (head->GetSize() == 1 && head->GetNextPageId() == INVALID_PAGE_ID) {
+    leaf->SetValueAt(slot, head->RidAt(0));
+    log.Forget(head_id);
+    transaction->AddIntoDeletedPageSet(head_id);
+  }
+  buffer_pool_manager_->UnpinPage(head_id, false);
+  log.Finish();
+  return true;
+}
+
+/*
+ * The pages are deleted once the leaf is let go of
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DropPosting(const ValueType &stored,
+                                 Transaction *transaction)
+{
+  page_id_t page_id = stored.GetPageId();
+  while (page_id != INVALID_PAGE_ID) {
+    page_id_t next_page_id = FetchPosting(page_id)->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    transaction->AddIntoDeletedPageSet(page_id);
+    page_id = next_page_id;
+  }
+}
+
+/*
+ * The caller has the leaf of stored latched
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::CollectValues(const ValueType &stored,
+                                   std::vector<ValueType> &result)
+{
+  if (unique_ || !BPlusTreePostingPage::IsList(stored)) {
+    result.push_back(stored);
+    return;
+  }
+  page_id_t page_id = stored.GetPageId();
+  while (page_id != INVALID_PAGE_ID) {
+    BPlusTreePostingPage *posting = FetchPosting(page_id);
+    for (int i = 0; i < posting->GetSize(); i++) {
+      result.push_back(posting->RidAt(i));
+    }
+    page_id_t next_page_id = posting->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+BPlusTreePostingPage *BPLUSTREE_TYPE::FetchPosting(page_id_t page_id)
+{
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  return reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
 }
 
 /*****************************************************************************
@@ -334,7 +1010,13 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(int read_ahead) {
+  Page *page = FindLeafPage(KeyType(), true, Operation::READ);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  return INDEXITERATOR_TYPE(this, page, 0, read_ahead);
+}
 
 /*
  * Input parameter is low key, find the leaf page that contains the input key
@@ -342,8 +1024,95 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
-  return INDEXITERATOR_TYPE();
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key, int read_ahead) {
+  Page *page = FindLeafPage(key, false, Operation::READ);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  B_PLUS_TREE_LEAF_PAGE_TYPE *leaf =
+      reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+  return INDEXITERATOR_TYPE(this, page, leaf->KeyIndex(key, comparator_),
+                            read_ahead);
+}
+
+/*
+ * Reverse index iterator from the last key
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::RBegin(int read_ahead) {
+  KeyBound low;
+  Page *page = FindLeafBefore(nullptr, &low);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  B_PLUS_TREE_LEAF_PAGE_TYPE *leaf =
+      reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+  return INDEXITERATOR_TYPE(this, page, leaf->GetSize() - 1, read_ahead, true);
+}
+
+/*
+ * Reverse index iterator from the last key not above key
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::RBegin(const KeyType &key, int read_ahead) {
+  Page *page = FindLeafPage(key, false, Operation::READ);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  B_PLUS_TREE_LEAF_PAGE_TYPE *leaf =
+      reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+  int slot = leaf->KeyIndex(key, comparator_);
+  if (slot == leaf->GetSize() || comparator_(leaf->KeyAt(slot), key) != 0) {
+    slot--;
+  }
+  return INDEXITERATOR_TYPE(this, page, slot, read_ahead, true);
+}
+
+/*
+ * From the key of the last value passed on, skipping the values of that key
+ * passed already, in the order the iterator has them; done past the end key
+ * if there is one
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ScanOrdered(bool reverse, size_t limit,
+                                 IndexScanPosition &position,
+                                 std::vector<ValueType> &result) {
+  KeyType key{}, end{};
+  if (position.started) {
+    memcpy(&key, position.key.data(), sizeof(KeyType));
+  }
+  if (!position.end.empty()) {
+    memcpy(&end, position.end.data(), sizeof(KeyType));
+  }
+  auto it = position.started ? (reverse ? RBegin(key) : Begin(key))
+                             : (reverse ? RBegin() : Begin());
+  size_t skip = position.started ? position.passed : 0;
+  for (; skip > 0 && !it.isEnd() && comparator_((*it).first, key) == 0;
+       ++it) {
+    skip--;
+  }
+  bool past = false;
+  for (size_t count = 0; count < limit && !it.isEnd(); ++it, ++count) {
+    const MappingType &entry = *it;
+    if (!position.end.empty()) {
+      int cmp = comparator_(entry.first, end);
+      if (reverse ? cmp < 0 : cmp > 0) {
+        past = true;
+        break;
+      }
+    }
+    if (position.started && comparator_(entry.first, key) == 0) {
+      position.passed++;
+    } else {
+      key = entry.first;
+      position.key.assign(reinterpret_cast<const char *>(&key),
+                          sizeof(KeyType));
+      position.passed = 1;
+      position.started = true;
+    }
+    result.push_back(entry.second);
+  }
+  position.done = past || it.isEnd();
 }
 
 /*****************************************************************************
@@ -351,29 +1120,237 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
  *****************************************************************************/
 /*
  * Find leaf page containing particular key, if leftMost flag == true, find
- * the left most leaf page
+ * the left most leaf page. The leaf page is returned pinned, nullptr if the
+ * tree is empty
  */
 INDEX_TEMPLATE_ARGUMENTS
 B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
                                                          bool leftMost)
 {
+  Page *page = FindLeafPage(key, leftMost, Operation::READ);
+  if (page == nullptr) {
+    return nullptr;
+  }
+  page->RUnlatch();
+  return reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+}
+
+/*
+ * Latch crabbing: a child is latched before its parent is let go of. Read
+ * latches are enough on the way down unless pessimistic, only the leaf of a
+ * write is write latched; the parent keeps it from splitting or merging
+ * until then. A pessimistic write latches every page for write, and keeps
+ * those above the last safe one
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost,
+                                   Operation op, Transaction *transaction,
+                                   bool pessimistic, KeyBound *bound)
+{
+  if (bound != nullptr) {
+    bound->bounded_ = false;
+  }
+  if (pessimistic) {
+    root_latch_.WLock();
+    transaction->AddIntoPageSet(nullptr);
+  } else {
+    root_latch_.RLock();
+  }
+  if (IsEmpty()) {
+    if (!pessimistic) {
+      root_latch_.RUnlock();
+    }
+    return nullptr;
+  }
   page_id_t page_id = root_page_id_;
-  Page* page = buffer_pool_manager_->FetchPage(page_id);
-  BPlusTreePage* btree_page = reinterpret_cast<BPlusTreePage*>(page->GetData());
-
-  while (page != nullptr && !btree_page->IsLeafPage()) {
-    btree_page = reinterpret_cast<BPlusTreeInternalPage*>(page->GetData());
-    page_id_t old_page_id = page_id;
-    if (leftMost == true) {
-      page_id = btree_page->ValueAt(0);
+  Page *parent = nullptr; // read latched, unless pessimistic
+  while (true) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    if (page == nullptr) {
+      if (pessimistic) {
+        ReleasePages(transaction, false);
+      } else if (parent != nullptr) {
+        parent->RUnlatch();
+        buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+      } else {
+        root_latch_.RUnlock();
+      }
+      throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    BPlusTreePage *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (pessimistic) {
+      page->WLatch();
+      if (IsSafe(node, op)) {
+        ReleasePages(transaction, false);
+      }
+      transaction->AddIntoPageSet(page);
     } else {
-      page_id = btree_page->Loopup(key, comparator_);
+      page->RLatch();
+      if (node->IsLeafPage() && op != Operation::READ) {
+        page->RUnlatch();
+        page->WLatch();
+        transaction->AddIntoPageSet(page);
+      }
+      if (parent != nullptr) {
+        parent->RUnlatch();
+        buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+      } else {
+        root_latch_.RUnlock();
+      }
+      parent = page;
     }
-    buffer_pool_manager_->UnpinPage(old_page_id);
-    page = buffer_pool_manager_->FetchPage(page_id);
+    if (node->IsLeafPage()) {
+      return page;
+    }
+    InternalPage *internal = reinterpret_cast<InternalPage *>(node);
+    int index = leftMost ? 0 : internal->ChildIndex(key, comparator_);
+    if (bound != nullptr && index + 1 < internal->GetSize()) {
+      bound->bounded_ = true;
+      bound->key_ = internal->KeyAt(index + 1);
+    }
+    page_id = internal->ValueAt(index);
   }
-  BPlusTreeLeafPage* btree_leaf_page = reinterpret_cast<BPlusTreeLeafPage*>(btree_page);
-  return btree_leaf_page;
+}
+
+/*
+ * Read crabbing as in FindLeafPage. A key equal to a separator is right of
+ * it, so the keys below it are in the child before
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafBefore(const KeyType *key, KeyBound *low) {
+  low->bounded_ = false;
+  root_latch_.RLock();
+  if (IsEmpty()) {
+    root_latch_.RUnlock();
+    return nullptr;
+  }
+  page_id_t page_id = root_page_id_;
+  Page *parent = nullptr;
+  while (true) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    if (page != nullptr) {
+      page->RLatch();
+    }
+    if (parent != nullptr) {
+      parent->RUnlatch();
+      buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+    } else {
+      root_latch_.RUnlock();
+    }
+    if (page == nullptr) {
+      throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    parent = page;
+    BPlusTreePage *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (node->IsLeafPage()) {
+      return page;
+    }
+    InternalPage *internal = reinterpret_cast<InternalPage *>(node);
+    int index = internal->GetSize() - 1;
+    if (key != nullptr) {
+      index = internal->ChildIndex(*key, comparator_);
+      if (index > 0 && comparator_(internal->KeyAt(index), *key) == 0) {
+        index--;
+      }
+    }
+    if (index > 0) {
+      low->bounded_ = true;
+      low->key_ = internal->KeyAt(index);
+    }
+    page_id = internal->ValueAt(index);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation op) {
+  if (op == Operation::INSERT) {
+    return node->GetSize() < node->GetMaxSize();
+  }
+  if (node->IsRootPage()) {
+    return node->GetSize() > (node->IsLeafPage() ? 1 : 2);
+  }
+  return node->GetSize() > GetMergeSize(node);
+}
+
+/*
+ * At half the maximum this is the minimum size of the page. Below it a page
+ * refilled by one entry from a sibling still leaves the sibling at least
+ * as full. An internal page keeps two children, a leaf one entry
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::GetMergeSize(BPlusTreePage *node) const {
+  int size = static_cast<int>(node->GetMaxSize() * merge_fill_factor_);
+  return std::max(std::min(size, node->GetMinSize()),
+                  node->IsLeafPage() ? 1 : 2);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SetMergeFillFactor(double fill_factor) {
+  merge_fill_factor_ = std::max(0.0, std::min(fill_factor, 0.5));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SetKeyCompression(bool compress) {
+  key_compression_ = compress && comparator_.IsNormalized();
+}
+
+/*
+ * The keys in the range of a child lie between the two keys of parent
+ * around it and share the bytes those two share; a child at either end of
+ * parent only has the range of parent to go by, and its prefix
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::CompressKeys(BPlusTreePage *node, InternalPage *parent) {
+  if (!key_compression_) {
+    return;
+  }
+  int index = parent->ValueIndex(node->GetPageId());
+  int size = parent->GetSize();
+  KeyType key = parent->KeyAt(index > 0 ? index : 1);
+  int prefix_size = parent->GetPrefixSize();
+  if (index > 0 && index + 1 < size) {
+    KeyType next = parent->KeyAt(index + 1);
+    prefix_size = KeyPrefix<KeyType, ValueType>::CommonSize(
+        key.data, next.data, sizeof(KeyType));
+  }
+  if (node->IsLeafPage()) {
+    CompressKeys(reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(node), key,
+                 prefix_size);
+  } else {
+    CompressKeys(reinterpret_cast<InternalPage *>(node), key, prefix_size);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+template <typename N>
+void BPLUSTREE_TYPE::CompressKeys(N *node, const KeyType &key,
+                                  int prefix_size) {
+  if (prefix_size > node->GetPrefixSize()) {
+    node->SetPrefix(key, prefix_size, buffer_pool_manager_->GetPageSize());
+  }
+}
+
+/*
+ * Pages are deleted once no latch of this operation is left, no other one
+ * can get to them by then
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleasePages(Transaction *transaction, bool dirty) {
+  auto pages = transaction->GetPageSet();
+  for (Page *page : *pages) {
+    if (page == nullptr) {
+      root_latch_.WUnlock();
+      continue;
+    }
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), dirty);
+  }
+  pages->clear();
+  auto deleted = transaction->GetDeletedPageSet();
+  for (page_id_t page_id : *deleted) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  deleted->clear();
 }
 
 /*
@@ -383,26 +1360,228 @@ B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
  * @parameter: insert_record      defualt value is false. When set to true,
  * insert a record <index_name, root_page_id> into header page instead of
  * updating it.
+ * With logging the header page is updated by the log once the change is
+ * durable, see BPlusTreeLog::Finish. With a root catalog the root goes there,
+ * logged or not, and on to the header page when the catalog is flushed
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
+void BPLUSTREE_TYPE::UpdateRootPageId(BPlusTreeLog &log, int insert_record) {
+  if (log.IsEnabled()) {
+    log.SetRoot(index_name_, root_page_id_, root_catalog_);
+    return;
+  }
+  if (root_catalog_ != nullptr) {
+    root_catalog_->SwapRoot(index_name_, root_page_id_);
+    return;
+  }
   HeaderPage *header_page = static_cast<HeaderPage *>(
       buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
-  if (insert_record)
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
-  else
-    // update root_page_id in header_page
+  if (header_page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  // a tree emptied and started again still has its record
+  if (insert_record && !header_page->InsertRecord(index_name_, root_page_id_))
     header_page->UpdateRecord(index_name_, root_page_id_);
+  else if (!insert_record &&
+           !header_page->UpdateRecord(index_name_, root_page_id_))
+    header_page->InsertRecord(index_name_, root_page_id_);
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Reparent(InternalPage *node, int begin, int end,
+                              BPlusTreeLog &log) {
+  for (int i = begin; i < end; ++i) {
+    SetParent(node->ValueAt(i), node->GetPageId(), log);
+  }
+}
+
+/*
+ * With logging the child is not written before the change is logged, see
+ * BPlusTreeLog. Without, the child is not latched, only a writer holding
+ * its parent reads the parent page id
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SetParent(page_id_t child_id, page_id_t parent_id,
+                               BPlusTreeLog &log) {
+  if (log.IsEnabled()) {
+    log.SetParent(child_id, parent_id);
+    return;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(child_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  reinterpret_cast<BPlusTreePage *>(page->GetData())
+      ->SetParentPageId(parent_id);
+  buffer_pool_manager_->UnpinPage(child_id, true);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogEntry(LogRecordType type,
+                              B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int slot,
+                              Transaction *transaction) {
+  if (!ENABLE_LOGGING || log_manager_ == nullptr) {
+    return;
+  }
+  const B_PLUS_TREE_LEAF_PAGE_TYPE *page = leaf;
+  const char *entry = page->EntryAt(slot);
+  int entry_size = leaf->GetEntrySize();
+  // where the entries start on the page
+  int32_t array_offset = static_cast<int32_t>(
+      entry - reinterpret_cast<const char *>(leaf) - slot * entry_size);
+  txn_id_t txn_id = transaction == nullptr ? INVALID_TXN_ID
+                                           : transaction->GetTransactionId();
+  LogRecord log_record(txn_id, type, leaf->GetPageId(), slot, array_offset,
+                       entry, entry_size);
+  leaf->SetLSN(log_manager_->AppendLogRecord(log_record));
+}
+
+/*
+ * A walk from the root down that splits the budget of leaves among the
+ * children of a page, or when it has more children than that picks as many
+ * evenly spaced ones, each standing in for those around it: a level is
+ * estimated as the pages read of it, weighted by the fan-outs skipped above
+ * them. Pages are read latched top down, like a lookup, the path to the one
+ * being read is kept latched
+ */
+INDEX_TEMPLATE_ARGUMENTS
+BPlusTreeStats<KeyType> BPLUSTREE_TYPE::GetStats(size_t sample_leaves,
+                                                 size_t histogram_buckets) {
+  BPlusTreeStats<KeyType> stats;
+  root_latch_.RLock();
+  if (IsEmpty()) {
+    root_latch_.RUnlock();
+    return stats;
+  }
+  Page *root = buffer_pool_manager_->FetchPage(root_page_id_);
+  if (root == nullptr) {
+    root_latch_.RUnlock();
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  root->RLatch();
+  root_latch_.RUnlock();
+  StatsWalk walk;
+  walk.fill_ = 0;
+  walk.keys_ = 0;
+  SampleStats(root, 0, 1, std::max<size_t>(sample_leaves, 1), walk);
+
+  double pages = 0;
+  for (size_t level = 0; level + 1 < walk.pages_.size(); level++) {
+    pages += walk.pages_[level];
+  }
+  stats.height = static_cast<int>(walk.pages_.size());
+  stats.internal_pages = static_cast<size_t>(pages + 0.5);
+  stats.leaf_pages = static_cast<size_t>(walk.pages_.back() + 0.5);
+  stats.fill_factor = walk.fill_ / (pages + walk.pages_.back());
+  stats.key_count = static_cast<size_t>(walk.keys_ + 0.5);
+  if (histogram_buckets == 0) {
+    return stats;
+  }
+  // a leaf goes to the bucket its middle key falls in, by count
+  double share = walk.keys_ / histogram_buckets;
+  double keys = 0;
+  size_t bucket = 0;
+  std::vector<double> counts;
+  for (const auto &leaf : walk.leaves_) {
+    size_t of = std::min(
+        histogram_buckets - 1,
+        static_cast<size_t>((keys + leaf.second / 2) / share));
+    if (counts.empty() || of != bucket) {
+      stats.histogram.emplace_back(leaf.first, 0);
+      counts.push_back(0);
+      bucket = of;
+    }
+    counts.back() += leaf.second;
+    keys += leaf.second;
+  }
+  for (size_t i = 0; i < counts.size(); i++) {
+    stats.histogram[i].second = static_cast<size_t>(counts[i] + 0.5);
+  }
+  return stats;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SampleStats(Page *page, size_t level, double weight,
+                                 size_t budget, StatsWalk &walk) {
+  BPlusTreePage *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  if (walk.pages_.size() <= level) {
+    walk.pages_.push_back(0);
+  }
+  walk.pages_[level] += weight;
+  walk.fill_ += weight * node->GetSize() / node->GetMaxSize();
+  if (node->IsLeafPage()) {
+    B_PLUS_TREE_LEAF_PAGE_TYPE *leaf =
+        reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(node);
+    walk.keys_ += weight * leaf->GetSize();
+    if (leaf->GetSize() > 0) {
+      walk.leaves_.emplace_back(leaf->KeyAt(0), weight * leaf->GetSize());
+    }
+  } else {
+    InternalPage *internal = reinterpret_cast<InternalPage *>(node);
+    size_t size = static_cast<size_t>(internal->GetSize());
+    size_t picks = std::min(budget, size);
+    for (size_t i = 0; i < picks; i++) {
+      // the middle one of the children the pick stands for
+      int index = static_cast<int>((2 * i + 1) * size / (2 * picks));
+      size_t child_budget = budget / picks + (i < budget % picks ? 1 : 0);
+      Page *child = buffer_pool_manager_->FetchPage(internal->ValueAt(index));
+      try {
+        if (child == nullptr) {
+          throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+        }
+        child->RLatch();
+        SampleStats(child, level + 1, weight * size / picks, child_budget,
+                    walk);
+      } catch (...) {
+        page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+        throw;
+      }
+    }
+  }
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+}
+
 /*
  * This method is used for debug only
  * print out whole b+tree sturcture, rank by rank
  */
 INDEX_TEMPLATE_ARGUMENTS
-std::string BPLUSTREE_TYPE::ToString(bool verbose) { return "Empty tree"; }
+std::string BPLUSTREE_TYPE::ToString(bool verbose) {
+  if (IsEmpty()) {
+    return "Empty tree";
+  }
+  std::ostringstream os;
+  std::vector<page_id_t> rank{root_page_id_};
+  while (!rank.empty()) {
+    std::vector<page_id_t> next;
+    for (page_id_t page_id : rank) {
+      Page *page = buffer_pool_manager_->FetchPage(page_id);
+      if (page == nullptr) {
+        throw Exception(EXCEPTION_TYPE_INDEX,
+                        "all page are pinned while printing");
+      }
+      BPlusTreePage *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+      if (node->IsLeafPage()) {
+        os << reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(node)->ToString(
+                  verbose)
+           << "| ";
+      } else {
+        InternalPage *internal = reinterpret_cast<InternalPage *>(node);
+        os << internal->ToString(verbose) << "| ";
+        for (int i = 0; i < internal->GetSize(); ++i) {
+          next.push_back(internal->ValueAt(i));
+        }
+      }
+      buffer_pool_manager_->UnpinPage(page_id, false);
+    }
+    os << std::endl;
+    rank.swap(next);
+  }
+  return os.str();
+}
 
 /*
  * This method is used for test only
@@ -444,5 +1623,10 @@ template class BPlusTree<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTree<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTree<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTree<GenericKey<64>, RID, GenericComparator<64>>;
+template class BPlusTree<GenericKey<4>, RID, IntegerComparator<4>>;
+template class BPlusTree<GenericKey<8>, RID, IntegerComparator<8>>;
+template class BPlusTree<GenericKey<16>, RID, BytesComparator<16>>;
+template class BPlusTree<GenericKey<32>, RID, BytesComparator<32>>;
+template class BPlusTree<GenericKey<64>, RID, BytesComparator<64>>;
 
 } // namespace cmudb
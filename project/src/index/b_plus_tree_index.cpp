@@ -2,6 +2,8 @@
  * b_plus_tree_index.cpp
  */
 
+#include <algorithm>
+
 #include "index/b_plus_tree_index.h"
 
 namespace cmudb {
@@ -11,29 +13,72 @@ namespace cmudb {
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(IndexMetadata *metadata,
                                      BufferPoolManager *buffer_pool_manager,
-                                     page_id_t root_page_id)
-    : Index(metadata), comparator_(metadata->GetKeySchema()),
+                                     page_id_t root_page_id,
+                                     LogManager *log_manager,
+                                     RootCatalog *root_catalog)
+    : Index(metadata), buffer_pool_manager_(buffer_pool_manager),
+      comparator_(metadata->GetKeySchema()),
       container_(metadata->GetName(), buffer_pool_manager, comparator_,
-                 root_page_id) {}
+                 root_page_id, log_manager, metadata->IsUnique(),
+                 root_catalog) {
+  if (metadata->HasBloomFilter()) {
+    filter_.reset(new BloomFilter(metadata->GetName(), buffer_pool_manager,
+                                  !container_.IsEmpty()));
+  }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid,
                                        Transaction *transaction) {
   // construct insert index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
 
-  container_.Insert(index_key, rid, transaction);
+  if (container_.Insert(index_key, rid, transaction) && filter_ != nullptr) {
+    filter_->Add(index_key.data, sizeof(index_key.data));
+  }
 }
 
+/*
+ * Another writer may make the tree not empty first, the bulk load fails
+ * then as it does for keys not strictly ascending
+ */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key,
+void BPLUSTREE_INDEX_TYPE::InsertEntries(const std::vector<Tuple> &keys,
+                                         const std::vector<RID> &rids,
+                                         Transaction *transaction) {
+  std::vector<MappingType> items(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    items[i].first.SetFromKey(keys[i], GetKeySchema());
+    items[i].second = rids[i];
+    if (filter_ != nullptr) {
+      filter_->Add(items[i].first.data, sizeof(items[i].first.data));
+    }
+  }
+  std::stable_sort(items.begin(), items.end(),
+                   [this](const MappingType &lhs, const MappingType &rhs) {
+                     return comparator_(lhs.first, rhs.first) < 0;
+                   });
+  if (!container_.BulkLoad(items, BULK_LOAD_FILL_FACTOR, transaction)) {
+    container_.InsertBatch(std::move(items), transaction);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid,
                                        Transaction *transaction) {
   // construct delete index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
 
-  container_.Remove(index_key, transaction);
+  if (GetMetadata()->IsUnique()) {
+    container_.Remove(index_key, transaction);
+  } else {
+    container_.Remove(index_key, rid, transaction);
+  }
+  if (filter_ != nullptr) {
+    filter_->Remove();
+  }
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -41,14 +86,114 @@ void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> &result,
                                    Transaction *transaction) {
   // construct scan index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
 
+  if (filter_ != nullptr) {
+    // built again from the keys of the tree after many removes
+    filter_->RebuildIfNeeded([this](const BloomFilter::KeySink &sink) {
+      for (auto it = container_.Begin(); !it.isEnd(); ++it) {
+        sink((*it).first.data, sizeof((*it).first.data));
+      }
+    });
+    if (!filter_->MayContain(index_key.data, sizeof(index_key.data))) {
+      return;
+    }
+  }
   container_.GetValue(index_key, result, transaction);
 }
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanRange(const Tuple &low, const Tuple &high,
+                                     std::vector<RID> &result,
+                                     Transaction *) {
+  KeyType low_key, high_key;
+  low_key.SetFromKey(low, GetKeySchema());
+  high_key.SetFromKey(high, GetKeySchema());
+  for (auto it = container_.Begin(low_key);
+       !it.isEnd() && comparator_((*it).first, high_key) <= 0; ++it) {
+    result.push_back((*it).second);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::StartRange(const Tuple &low, const Tuple &high,
+                                      IndexScanPosition &position) {
+  KeyType low_key, high_key;
+  low_key.SetFromKey(low, GetKeySchema());
+  high_key.SetFromKey(high, GetKeySchema());
+  position = IndexScanPosition();
+  position.key.assign(reinterpret_cast<const char *>(&low_key),
+                      sizeof(KeyType));
+  position.started = true;
+  position.end.assign(reinterpret_cast<const char *>(&high_key),
+                      sizeof(KeyType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::Build(
+    TableHeap *table_heap, const std::function<Tuple(const Tuple &)> &key_of,
+    int threads) {
+  if (!container_.IsEmpty()) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "can't build an index with keys");
+  }
+  bool unique = GetMetadata()->IsUnique();
+  ExternalSort<KeyType, ValueType, KeyComparator> sort(
+      buffer_pool_manager_, comparator_, threads, INDEX_BUILD_RUN_SIZE,
+      unique);
+  table_heap->ParallelScan(threads, [&](int worker, const Tuple &tuple) {
+    KeyType index_key;
+    index_key.SetFromKey(key_of(tuple), GetKeySchema());
+    sort.Add(worker, index_key, tuple.GetRid());
+  });
+  sort.Finish();
+
+  MappingType item;
+  if (unique) {
+    // the loader needs to know how many first, equal keys are dropped
+    size_t count = 0;
+    while (sort.Next(item)) {
+      count++;
+    }
+    sort.Rewind();
+    container_.BulkLoad(count, [this, &sort](MappingType &next) {
+      if (!sort.Next(next)) {
+        return false;
+      }
+      if (filter_ != nullptr) {
+        filter_->Add(next.first.data, sizeof(next.first.data));
+      }
+      return true;
+    });
+    return;
+  }
+  std::vector<MappingType> batch;
+  while (true) {
+    bool more = sort.Next(item);
+    if (more) {
+      batch.push_back(item);
+      if (filter_ != nullptr) {
+        filter_->Add(item.first.data, sizeof(item.first.data));
+      }
+    }
+    if (batch.size() == INDEX_BUILD_RUN_SIZE || (!more && !batch.empty())) {
+      container_.InsertBatch(std::move(batch));
+      batch.clear();
+    }
+    if (!more) {
+      break;
+    }
+  }
+}
+
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTreeIndex<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>;
+template class BPlusTreeIndex<GenericKey<4>, RID, IntegerComparator<4>>;
+template class BPlusTreeIndex<GenericKey<8>, RID, IntegerComparator<8>>;
+template class BPlusTreeIndex<GenericKey<16>, RID, BytesComparator<16>>;
+template class BPlusTreeIndex<GenericKey<32>, RID, BytesComparator<32>>;
+template class BPlusTreeIndex<GenericKey<64>, RID, BytesComparator<64>>;
 
 } // namespace cmudb
@@ -0,0 +1,175 @@
+/**
+ * b_plus_tree_log.cpp
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "common/exception.h"
+#include "index/b_plus_tree_log.h"
+#include "page/b_plus_tree_page.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+BPlusTreeLog::BPlusTreeLog(BufferPoolManager *buffer_pool_manager,
+                           LogManager *log_manager, Transaction *transaction)
+    : buffer_pool_manager_(buffer_pool_manager), log_manager_(log_manager),
+      transaction_(transaction),
+      enabled_(ENABLE_LOGGING && log_manager != nullptr),
+      root_page_id_(INVALID_PAGE_ID), root_catalog_(nullptr) {}
+
+BPlusTreeLog::~BPlusTreeLog() {
+  for (auto &tracked : pages_) {
+    buffer_pool_manager_->UnpinPage(tracked.page_->GetPageId(), true);
+  }
+}
+
+void BPlusTreeLog::Track(page_id_t page_id, bool fresh) {
+  if (!enabled_) {
+    return;
+  }
+  for (auto &tracked : pages_) {
+    if (tracked.page_->GetPageId() == page_id) {
+      return;
+    }
+  }
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  size_t page_size = buffer_pool_manager_->GetPageSize();
+  TrackedPage tracked{page, fresh, std::vector<char>(page_size, 0)};
+  if (!fresh) {
+    memcpy(tracked.image_.data(), page->GetData(), page_size);
+  }
+  pages_.push_back(std::move(tracked));
+}
+
+void BPlusTreeLog::Forget(page_id_t page_id) {
+  for (auto it = pages_.begin(); it != pages_.end(); ++it) {
+    if (it->page_->GetPageId() == page_id) {
+      buffer_pool_manager_->UnpinPage(page_id, true);
+      pages_.erase(it);
+      return;
+    }
+  }
+}
+
+bool BPlusTreeLog::IsLatched(Page *page) {
+  if (transaction_ == nullptr) {
+    return false;
+  }
+  auto pages = transaction_->GetPageSet();
+  return std::find(pages->begin(), pages->end(), page) != pages->end();
+}
+
+void BPlusTreeLog::SetParent(page_id_t child_id, page_id_t parent_id) {
+  parents_.emplace_back(child_id, parent_id);
+}
+
+void BPlusTreeLog::SetRoot(const std::string &index_name,
+                           page_id_t root_page_id, RootCatalog *root_catalog) {
+  index_name_ = index_name;
+  root_page_id_ = root_page_id;
+  root_catalog_ = root_catalog;
+}
+
+/*
+ * A page is logged as the one range between its first and its last changed
+ * byte, tree operations change a run of slots and a few header fields
+ */
+void BPlusTreeLog::Finish() {
+  if (!enabled_) {
+    return;
+  }
+  int page_size = static_cast<int>(buffer_pool_manager_->GetPageSize());
+  std::vector<PageWrite> writes;
+  std::vector<Page *> written;
+  for (auto &tracked : pages_) {
+    const char *before = tracked.image_.data();
+    const char *after = tracked.page_->GetData();
+    int begin = 0;
+    while (begin < page_size && before[begin] == after[begin]) {
+      ++begin;
+    }
+    if (begin == page_size && !tracked.fresh_) {
+      continue;
+    }
+    int end = page_size;
+    while (end > begin && before[end - 1] == after[end - 1]) {
+      --end;
+    }
+    writes.push_back(PageWrite{tracked.page_->GetPageId(), tracked.fresh_,
+                               begin,
+                               std::vector<char>(after + begin, after + end)});
+    written.push_back(tracked.page_);
+  }
+  for (auto &parent : parents_) {
+    const char *data = reinterpret_cast<const char *>(&parent.second);
+    writes.push_back(PageWrite{parent.first, false,
+                               BPlusTreePage::PARENT_PAGE_ID_OFFSET,
+                               std::vector<char>(data, data + sizeof(parent.second))});
+  }
+  lsn_t lsn = INVALID_LSN;
+  if (!writes.empty() || !index_name_.empty()) {
+    txn_id_t txn_id = transaction_ == nullptr
+                          ? INVALID_TXN_ID
+                          : transaction_->GetTransactionId();
+    LogRecord log_record(txn_id, std::move(writes), index_name_,
+                         root_page_id_);
+    assert(log_record.GetSize() <= LOG_BUFFER_SIZE);
+    if (root_catalog_ != nullptr && !index_name_.empty()) {
+      root_catalog_->PrepareSwap();
+    }
+    lsn = log_manager_->AppendLogRecord(log_record);
+    for (auto page : written) {
+      page->SetLSN(lsn);
+    }
+  }
+  for (auto &parent : parents_) {
+    Page *page = buffer_pool_manager_->FetchPage(parent.first);
+    if (page == nullptr) {
+      throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    // another operation may be writing the child, unless this one holds it
+    bool latch = !IsLatched(page);
+    if (latch) {
+      page->WLatch();
+    }
+    reinterpret_cast<BPlusTreePage *>(page->GetData())
+        ->SetParentPageId(parent.second);
+    // it may have logged a later change of the child since the record
+    if (page->GetLSN() < lsn) {
+      page->SetLSN(lsn);
+    }
+    if (latch) {
+      page->WUnlatch();
+    }
+    // fetched after the record, the page may have a later recLSN
+    buffer_pool_manager_->UnpinPage(parent.first, true, lsn);
+  }
+  parents_.clear();
+  if (!index_name_.empty() && root_catalog_ != nullptr) {
+    root_catalog_->SwapRoot(index_name_, root_page_id_, lsn);
+    index_name_.clear();
+  } else if (!index_name_.empty()) {
+    log_manager_->WaitForDurable(lsn);
+    HeaderPage *header_page = static_cast<HeaderPage *>(
+        buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+    if (header_page == nullptr) {
+      throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    if (!header_page->UpdateRecord(index_name_, root_page_id_)) {
+      header_page->InsertRecord(index_name_, root_page_id_);
+    }
+    buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+    index_name_.clear();
+  }
+  for (auto &tracked : pages_) {
+    buffer_pool_manager_->UnpinPage(tracked.page_->GetPageId(), true);
+  }
+  pages_.clear();
+}
+
+} // namespace cmudb
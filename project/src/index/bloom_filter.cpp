@@ -0,0 +1,227 @@
+/**
+ * bloom_filter.cpp
+ */
+#include <algorithm>
+#include <cstring>
+
+#include "common/exception.h"
+#include "hash/hash_function.h"
+#include "index/bloom_filter.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+namespace {
+// meta page fields, in 4 byte words
+const int CLEAN = 3;
+const int KEY_COUNT = 4;
+const int REMOVED_COUNT = 5;
+const int BLOCK_COUNT = 6;
+const int PAGE_COUNT = 7;
+} // namespace
+
+BloomFilter::BloomFilter(const std::string &index_name,
+                         BufferPoolManager *buffer_pool_manager,
+                         bool not_empty)
+    : index_name_(index_name + "_bloom"),
+      buffer_pool_manager_(buffer_pool_manager),
+      meta_page_id_(INVALID_PAGE_ID), block_count_(0), key_count_(0),
+      removed_count_(0), stale_(false) {
+  size_t page_size = buffer_pool_manager_->GetPageSize();
+  blocks_per_page_ = (page_size - BIT_PAGE_HEADER_SIZE) / BLOCK_SIZE;
+  max_pages_ = (page_size - META_HEADER_SIZE) / sizeof(page_id_t);
+
+  HeaderPage *header_page =
+      static_cast<HeaderPage *>(FetchPage(HEADER_PAGE_ID));
+  header_page->RLatch();
+  bool found = header_page->GetRootId(index_name_, meta_page_id_);
+  header_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+
+  if (found) {
+    Page *meta = FetchPage(meta_page_id_);
+    const uint32_t *fields = reinterpret_cast<uint32_t *>(meta->GetData());
+    stale_ = fields[CLEAN] == 0;
+    key_count_ = fields[KEY_COUNT];
+    removed_count_ = fields[REMOVED_COUNT];
+    block_count_ = fields[BLOCK_COUNT];
+    const page_id_t *page_ids = reinterpret_cast<const page_id_t *>(
+        meta->GetData() + META_HEADER_SIZE);
+    page_ids_.assign(page_ids, page_ids + fields[PAGE_COUNT]);
+    buffer_pool_manager_->UnpinPage(meta_page_id_, false);
+  } else {
+    NewPage(meta_page_id_);
+    buffer_pool_manager_->UnpinPage(meta_page_id_, true);
+    // a page to start with
+    Resize(blocks_per_page_);
+    stale_ = not_empty;
+    header_page = static_cast<HeaderPage *>(FetchPage(HEADER_PAGE_ID));
+    header_page->WLatch();
+    if (!header_page->InsertRecord(index_name_, meta_page_id_))
+      header_page->UpdateRecord(index_name_, meta_page_id_);
+    header_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  }
+  // on disk as not closed until it is, adds from now on may not get there
+  WriteMeta(false);
+}
+
+BloomFilter::~BloomFilter() {
+  // the bits first, the meta page says they are there
+  for (page_id_t page_id : page_ids_) {
+    buffer_pool_manager_->FlushPage(page_id);
+  }
+  WriteMeta(true);
+}
+
+void BloomFilter::Add(const char *key, size_t size) {
+  latch_.RLock();
+  SetBits(key, size);
+  key_count_++;
+  latch_.RUnlock();
+}
+
+void BloomFilter::Remove() { removed_count_++; }
+
+bool BloomFilter::MayContain(const char *key, size_t size) {
+  latch_.RLock();
+  uint64_t *words;
+  uint64_t masks[BLOCK_SIZE / sizeof(uint64_t)];
+  Page *page = FindBlock(key, size, words, masks);
+  bool found = true;
+  for (size_t i = 0; i < BLOCK_SIZE / sizeof(uint64_t); i++) {
+    if ((__atomic_load_n(&words[i], __ATOMIC_RELAXED) & masks[i]) !=
+        masks[i]) {
+      found = false;
+      break;
+    }
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  latch_.RUnlock();
+  return found;
+}
+
+bool BloomFilter::NeedsRebuild() const {
+  size_t keys = key_count_.load();
+  size_t removed = removed_count_.load();
+  size_t blocks = block_count_.load();
+  size_t capacity = blocks * BLOCK_SIZE * 8 / BLOOM_BITS_PER_KEY;
+  return stale_ || (removed > 0 && removed >= keys * BLOOM_REBUILD_SHARE) ||
+         (keys > 2 * capacity && blocks < max_pages_ * blocks_per_page_);
+}
+
+void BloomFilter::RebuildIfNeeded(
+    const std::function<void(const KeySink &)> &scan) {
+  if (!NeedsRebuild()) {
+    return;
+  }
+  latch_.WLock();
+  // another lookup may have rebuilt it meanwhile
+  if (!NeedsRebuild()) {
+    latch_.WUnlock();
+    return;
+  }
+  size_t keys = key_count_.load();
+  keys -= std::min(removed_count_.load(), keys);
+  size_t bits = std::max<size_t>(keys, 1) * BLOOM_BITS_PER_KEY;
+  Resize((bits + BLOCK_SIZE * 8 - 1) / (BLOCK_SIZE * 8));
+  key_count_ = 0;
+  removed_count_ = 0;
+  try {
+    scan([this](const char *key, size_t size) {
+      SetBits(key, size);
+      key_count_++;
+    });
+  } catch (...) {
+    WriteMeta(false);
+    latch_.WUnlock();
+    throw;
+  }
+  stale_ = false;
+  WriteMeta(false);
+  latch_.WUnlock();
+}
+
+Page *BloomFilter::FindBlock(const char *key, size_t size, uint64_t *&words,
+                             uint64_t masks[]) {
+  uint64_t hash = StringHash(key, size);
+  size_t block = MixHash(hash) % block_count_;
+  Page *page = FetchPage(page_ids_[block / blocks_per_page_]);
+  words = reinterpret_cast<uint64_t *>(
+      page->GetData() + BIT_PAGE_HEADER_SIZE +
+      (block % blocks_per_page_) * BLOCK_SIZE);
+  // 9 bits of the hash for each probe into the 512 bits of the block
+  memset(masks, 0, BLOCK_SIZE);
+  for (int i = 0; i < BLOOM_PROBES; i++) {
+    int bit = static_cast<int>((hash >> (9 * i)) & 511);
+    masks[bit / 64] |= uint64_t(1) << (bit % 64);
+  }
+  return page;
+}
+
+void BloomFilter::SetBits(const char *key, size_t size) {
+  uint64_t *words;
+  uint64_t masks[BLOCK_SIZE / sizeof(uint64_t)];
+  Page *page = FindBlock(key, size, words, masks);
+  for (size_t i = 0; i < BLOCK_SIZE / sizeof(uint64_t); i++) {
+    if (masks[i] != 0) {
+      __atomic_fetch_or(&words[i], masks[i], __ATOMIC_RELAXED);
+    }
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+}
+
+void BloomFilter::Resize(size_t block_count) {
+  size_t pages = (block_count + blocks_per_page_ - 1) / blocks_per_page_;
+  pages = std::min(pages, max_pages_);
+  block_count_ = std::min(block_count, pages * blocks_per_page_);
+  while (page_ids_.size() > pages) {
+    buffer_pool_manager_->DeletePage(page_ids_.back());
+    page_ids_.pop_back();
+  }
+  for (page_id_t page_id : page_ids_) {
+    Page *page = FetchPage(page_id);
+    memset(page->GetData() + BIT_PAGE_HEADER_SIZE, 0,
+           blocks_per_page_ * BLOCK_SIZE);
+    buffer_pool_manager_->UnpinPage(page_id, true);
+  }
+  while (page_ids_.size() < pages) {
+    page_id_t page_id;
+    NewPage(page_id);
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    page_ids_.push_back(page_id);
+  }
+}
+
+void BloomFilter::WriteMeta(bool clean) {
+  Page *meta = FetchPage(meta_page_id_);
+  uint32_t *fields = reinterpret_cast<uint32_t *>(meta->GetData());
+  fields[CLEAN] = clean ? 1 : 0;
+  fields[KEY_COUNT] = static_cast<uint32_t>(key_count_);
+  fields[REMOVED_COUNT] = static_cast<uint32_t>(removed_count_);
+  fields[BLOCK_COUNT] = static_cast<uint32_t>(block_count_);
+  fields[PAGE_COUNT] = static_cast<uint32_t>(page_ids_.size());
+  memcpy(meta->GetData() + META_HEADER_SIZE, page_ids_.data(),
+         page_ids_.size() * sizeof(page_id_t));
+  buffer_pool_manager_->UnpinPage(meta_page_id_, true);
+  buffer_pool_manager_->FlushPage(meta_page_id_);
+}
+
+Page *BloomFilter::FetchPage(page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  return page;
+}
+
+// zeroed by the buffer pool
+Page *BloomFilter::NewPage(page_id_t &page_id) {
+  Page *page = buffer_pool_manager_->NewPage(page_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  return page;
+}
+
+} // namespace cmudb
@@ -0,0 +1,110 @@
+/**
+ * covering_index.cpp
+ */
+
+#include "index/covering_index.h"
+
+namespace cmudb {
+/*
+ * Constructor
+ */
+template <size_t KeySize>
+CoveringIndex<KeySize>::CoveringIndex(IndexMetadata *metadata,
+                                      BufferPoolManager *buffer_pool_manager,
+                                      page_id_t root_page_id,
+                                      LogManager *log_manager,
+                                      RootCatalog *root_catalog)
+    : Index(metadata), comparator_(metadata->GetKeySchema(), false),
+      container_(metadata->GetName(), buffer_pool_manager, comparator_,
+                 root_page_id, log_manager, metadata->IsUnique(),
+                 root_catalog) {}
+
+template <size_t KeySize>
+void CoveringIndex<KeySize>::InsertEntry(const Tuple &key, RID rid,
+                                         Transaction *transaction) {
+  // construct insert index key, included columns and all
+  container_.Insert(MakeKey(key), rid, transaction);
+}
+
+template <size_t KeySize>
+void CoveringIndex<KeySize>::DeleteEntry(const Tuple &key, RID rid,
+                                         Transaction *transaction) {
+  // construct delete index key
+  GenericKey<KeySize> index_key = MakeKey(key);
+
+  if (GetMetadata()->IsUnique()) {
+    container_.Remove(index_key, transaction);
+  } else {
+    container_.Remove(index_key, rid, transaction);
+  }
+}
+
+template <size_t KeySize>
+void CoveringIndex<KeySize>::ScanKey(const Tuple &key,
+                                     std::vector<RID> &result,
+                                     Transaction *transaction) {
+  // construct scan index key
+  container_.GetValue(MakeKey(key), result, transaction);
+}
+
+template <size_t KeySize>
+void CoveringIndex<KeySize>::ScanRange(const Tuple &low, const Tuple &high,
+                                       std::vector<RID> &result,
+                                       Transaction *) {
+  GenericKey<KeySize> low_key = MakeKey(low);
+  GenericKey<KeySize> high_key = MakeKey(high);
+  for (auto it = container_.Begin(low_key);
+       !it.isEnd() && comparator_((*it).first, high_key) <= 0; ++it) {
+    result.push_back((*it).second);
+  }
+}
+
+template <size_t KeySize>
+void CoveringIndex<KeySize>::StartRange(const Tuple &low, const Tuple &high,
+                                        IndexScanPosition &position) {
+  GenericKey<KeySize> low_key = MakeKey(low);
+  GenericKey<KeySize> high_key = MakeKey(high);
+  position = IndexScanPosition();
+  position.key.assign(reinterpret_cast<const char *>(&low_key),
+                      sizeof(low_key));
+  position.started = true;
+  position.end.assign(reinterpret_cast<const char *>(&high_key),
+                      sizeof(high_key));
+}
+
+template <size_t KeySize>
+void CoveringIndex<KeySize>::ScanCovering(const Tuple &key,
+                                          std::vector<RID> &result,
+                                          std::vector<Tuple> &rows,
+                                          Transaction *) {
+  GenericKey<KeySize> index_key = MakeKey(key);
+  Schema *covering_schema = GetMetadata()->GetCoveringSchema();
+  int column_count = covering_schema->GetColumnCount();
+  // the entries of key are next to each other, no leaf ahead is needed
+  for (auto it = container_.Begin(index_key, 0);
+       !it.isEnd() && comparator_((*it).first, index_key) == 0; ++it) {
+    std::vector<Value> values;
+    for (int i = 0; i < column_count; i++) {
+      values.push_back((*it).first.ToValue(covering_schema, i));
+    }
+    rows.emplace_back(values, covering_schema);
+    result.push_back((*it).second);
+  }
+}
+
+template <size_t KeySize>
+GenericKey<KeySize> CoveringIndex<KeySize>::MakeKey(const Tuple &tuple) {
+  GenericKey<KeySize> index_key;
+  if (!index_key.SetFromTuple(tuple)) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "key too long");
+  }
+  return index_key;
+}
+
+template class CoveringIndex<4>;
+template class CoveringIndex<8>;
+template class CoveringIndex<16>;
+template class CoveringIndex<32>;
+template class CoveringIndex<64>;
+
+} // namespace cmudb
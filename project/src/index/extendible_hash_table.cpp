@@ -0,0 +1,341 @@
+/**
+ * extendible_hash_table.cpp
+ */
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "hash/hash_function.h"
+#include "index/extendible_hash_table.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+/*
+ * Latching: the directory page latch is taken shared by lookups and
+ * exclusively by Insert/Remove, bucket pages are only ever accessed with it
+ * held, so they need no latch of their own
+ */
+INDEX_TEMPLATE_ARGUMENTS
+EXTENDIBLE_HASH_TABLE_TYPE::ExtendibleHashTable(
+    const std::string &name, BufferPoolManager *buffer_pool_manager,
+    const KeyComparator &comparator, page_id_t directory_page_id)
+    : index_name_(name), directory_page_id_(directory_page_id),
+      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTENDIBLE_HASH_TABLE_TYPE::IsEmpty() const {
+  return directory_page_id_ == INVALID_PAGE_ID;
+}
+
+/*
+ * keys are compared as whole GenericKeys, hash all of their bytes
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t EXTENDIBLE_HASH_TABLE_TYPE::HashKey(const KeyType &key) const {
+  return static_cast<size_t>(
+      StringHash(reinterpret_cast<const char *>(&key), sizeof(KeyType)));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+uint32_t EXTENDIBLE_HASH_TABLE_TYPE::GetGlobalDepth() {
+  if (IsEmpty()) {
+    return 0;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(directory_page_id_);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  page->RLatch();
+  uint32_t global_depth =
+      reinterpret_cast<HashTableDirectoryPage *>(page->GetData())
+          ->GetGlobalDepth();
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  return global_depth;
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+/*
+ * Return the only value that associated with input key
+ * This method is used for point query
+ * @return : true means key exists
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTENDIBLE_HASH_TABLE_TYPE::GetValue(const KeyType &key,
+                                          std::vector<ValueType> &result,
+                                          Transaction *transaction) {
+  if (IsEmpty()) {
+    return false;
+  }
+  Page *directory_page = buffer_pool_manager_->FetchPage(directory_page_id_);
+  if (directory_page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  directory_page->RLatch();
+  HashTableDirectoryPage *directory =
+      reinterpret_cast<HashTableDirectoryPage *>(directory_page->GetData());
+  page_id_t bucket_page_id =
+      directory->GetBucketPageId(directory->SlotOf(HashKey(key)));
+  Page *bucket_page = buffer_pool_manager_->FetchPage(bucket_page_id);
+  bool found = false;
+  if (bucket_page != nullptr) {
+    ValueType value;
+    found = reinterpret_cast<HASH_TABLE_BUCKET_PAGE_TYPE *>(
+                bucket_page->GetData())
+                ->Lookup(key, value, comparator_);
+    if (found) {
+      result.push_back(value);
+    }
+    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+  }
+  directory_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  if (bucket_page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  return found;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+/*
+ * Insert constant key & value pair into the table. A full bucket is split,
+ * doubling the directory if needed, until the key's bucket has room
+ * @return: since only support unique key, if user try to insert duplicate
+ * keys return false, otherwise return true.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTENDIBLE_HASH_TABLE_TYPE::Insert(const KeyType &key,
+                                        const ValueType &value,
+                                        Transaction *transaction) {
+  if (IsEmpty()) {
+    std::lock_guard<std::mutex> guard(start_latch_);
+    if (IsEmpty()) {
+      StartNewTable();
+    }
+  }
+  Page *directory_page = buffer_pool_manager_->FetchPage(directory_page_id_);
+  if (directory_page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  directory_page->WLatch();
+  HashTableDirectoryPage *directory =
+      reinterpret_cast<HashTableDirectoryPage *>(directory_page->GetData());
+  size_t hash = HashKey(key);
+  bool inserted = false;
+  bool directory_dirty = false;
+  while (true) {
+    size_t slot = directory->SlotOf(hash);
+    page_id_t bucket_page_id = directory->GetBucketPageId(slot);
+    Page *bucket_page = buffer_pool_manager_->FetchPage(bucket_page_id);
+    if (bucket_page == nullptr) {
+      break;
+    }
+    HASH_TABLE_BUCKET_PAGE_TYPE *bucket =
+        reinterpret_cast<HASH_TABLE_BUCKET_PAGE_TYPE *>(
+            bucket_page->GetData());
+    ValueType existing;
+    if (!bucket->IsFull() || bucket->Lookup(key, existing, comparator_)) {
+      inserted = bucket->Insert(key, value, comparator_);
+      buffer_pool_manager_->UnpinPage(bucket_page_id, inserted);
+      break;
+    }
+    bool split = SplitBucket(directory, slot, bucket);
+    buffer_pool_manager_->UnpinPage(bucket_page_id, split);
+    if (!split) {
+      break;
+    }
+    directory_dirty = true;
+  }
+  directory_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(directory_page_id_, directory_dirty);
+  return inserted;
+}
+
+/*
+ * Directory and first bucket, the directory page is what the header page
+ * records for this index
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void EXTENDIBLE_HASH_TABLE_TYPE::StartNewTable() {
+  page_id_t directory_page_id;
+  page_id_t bucket_page_id;
+  Page *directory_page = buffer_pool_manager_->NewPage(directory_page_id);
+  if (directory_page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  Page *bucket_page = buffer_pool_manager_->NewPage(bucket_page_id);
+  if (bucket_page == nullptr) {
+    buffer_pool_manager_->UnpinPage(directory_page_id, false);
+    buffer_pool_manager_->DeletePage(directory_page_id);
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  size_t page_size = buffer_pool_manager_->GetPageSize();
+  reinterpret_cast<HashTableDirectoryPage *>(directory_page->GetData())
+      ->Init(directory_page_id, bucket_page_id, page_size);
+  reinterpret_cast<HASH_TABLE_BUCKET_PAGE_TYPE *>(bucket_page->GetData())
+      ->Init(bucket_page_id, page_size);
+  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+  buffer_pool_manager_->UnpinPage(directory_page_id, true);
+
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  header_page->InsertRecord(index_name_, directory_page_id);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  directory_page_id_ = directory_page_id;
+}
+
+/*
+ * The bucket has local depth d: every slot pointing to it agrees on the low
+ * d bits. Slots with bit d set now point to a new bucket, and the entries
+ * whose hash has bit d set follow them
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTENDIBLE_HASH_TABLE_TYPE::SplitBucket(
+    HashTableDirectoryPage *directory, size_t slot,
+    HASH_TABLE_BUCKET_PAGE_TYPE *bucket) {
+  uint32_t local_depth = directory->GetLocalDepth(slot);
+  if (local_depth == directory->GetGlobalDepth()) {
+    if (!directory->CanGrow()) {
+      return false;
+    }
+    directory->Grow();
+  }
+  page_id_t new_page_id;
+  Page *new_page = buffer_pool_manager_->NewPage(new_page_id);
+  if (new_page == nullptr) {
+    return false;
+  }
+  HASH_TABLE_BUCKET_PAGE_TYPE *new_bucket =
+      reinterpret_cast<HASH_TABLE_BUCKET_PAGE_TYPE *>(new_page->GetData());
+  new_bucket->Init(new_page_id, buffer_pool_manager_->GetPageSize());
+
+  size_t high_bit = static_cast<size_t>(1) << local_depth;
+  for (size_t i = 0; i < directory->Size(); i++) {
+    if (directory->GetBucketPageId(i) == bucket->GetPageId()) {
+      directory->SetLocalDepth(i, local_depth + 1);
+      if (i & high_bit) {
+        directory->SetBucketPageId(i, new_page_id);
+      }
+    }
+  }
+  int kept = 0;
+  for (int i = 0; i < bucket->GetSize(); i++) {
+    const MappingType &item = bucket->GetItem(i);
+    if (HashKey(item.first) & high_bit) {
+      new_bucket->Append(item);
+    } else {
+      bucket->SetItem(kept++, item);
+    }
+  }
+  bucket->SetSize(kept);
+  buffer_pool_manager_->UnpinPage(new_page_id, true);
+  return true;
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+/*
+ * Delete key & value pair associated with input key. An emptied bucket
+ * merges with its buddy, then the directory shrinks as far as it can
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void EXTENDIBLE_HASH_TABLE_TYPE::Remove(const KeyType &key,
+                                        Transaction *transaction) {
+  if (IsEmpty()) {
+    return;
+  }
+  Page *directory_page = buffer_pool_manager_->FetchPage(directory_page_id_);
+  if (directory_page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  directory_page->WLatch();
+  HashTableDirectoryPage *directory =
+      reinterpret_cast<HashTableDirectoryPage *>(directory_page->GetData());
+  size_t slot = directory->SlotOf(HashKey(key));
+  page_id_t bucket_page_id = directory->GetBucketPageId(slot);
+  Page *bucket_page = buffer_pool_manager_->FetchPage(bucket_page_id);
+  bool merge = false;
+  if (bucket_page != nullptr) {
+    HASH_TABLE_BUCKET_PAGE_TYPE *bucket =
+        reinterpret_cast<HASH_TABLE_BUCKET_PAGE_TYPE *>(
+            bucket_page->GetData());
+    bool removed = bucket->Remove(key, comparator_);
+    merge = removed && bucket->GetSize() == 0;
+    buffer_pool_manager_->UnpinPage(bucket_page_id, removed);
+  }
+  if (merge) {
+    MergeBucket(directory, slot);
+  }
+  directory_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(directory_page_id_, merge);
+}
+
+/*
+ * Buddies differ in the top bit of their common local depth. An empty
+ * bucket is dropped and its slots go to the buddy, one level shallower.
+ * The merged bucket may in turn have an empty buddy left behind by an
+ * earlier removal, so keep going up until neither side is empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void EXTENDIBLE_HASH_TABLE_TYPE::MergeBucket(HashTableDirectoryPage *directory,
+                                             size_t slot) {
+  while (true) {
+    uint32_t local_depth = directory->GetLocalDepth(slot);
+    if (local_depth == 0) {
+      break;
+    }
+    size_t buddy = slot ^ (static_cast<size_t>(1) << (local_depth - 1));
+    if (directory->GetLocalDepth(buddy) != local_depth) {
+      break;
+    }
+    page_id_t slot_page_id = directory->GetBucketPageId(slot);
+    page_id_t buddy_page_id = directory->GetBucketPageId(buddy);
+    int slot_size = BucketSize(slot_page_id);
+    int buddy_size = BucketSize(buddy_page_id);
+    if (slot_size != 0 && buddy_size != 0) {
+      break;
+    }
+    page_id_t empty_page_id = slot_size == 0 ? slot_page_id : buddy_page_id;
+    page_id_t kept_page_id = slot_size == 0 ? buddy_page_id : slot_page_id;
+    for (size_t i = 0; i < directory->Size(); i++) {
+      page_id_t page_id = directory->GetBucketPageId(i);
+      if (page_id == empty_page_id || page_id == kept_page_id) {
+        directory->SetBucketPageId(i, kept_page_id);
+        directory->SetLocalDepth(i, local_depth - 1);
+      }
+    }
+    buffer_pool_manager_->DeletePage(empty_page_id);
+  }
+  while (directory->CanShrink()) {
+    directory->Shrink();
+  }
+}
+
+/*
+ * number of entries in a bucket, -1 if it cannot be fetched
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int EXTENDIBLE_HASH_TABLE_TYPE::BucketSize(page_id_t bucket_page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(bucket_page_id);
+  if (page == nullptr) {
+    return -1;
+  }
+  int size =
+      reinterpret_cast<HASH_TABLE_BUCKET_PAGE_TYPE *>(page->GetData())
+          ->GetSize();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+  return size;
+}
+
+template class ExtendibleHashTable<GenericKey<4>, RID, GenericComparator<4>>;
+template class ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>>;
+template class ExtendibleHashTable<GenericKey<16>, RID, GenericComparator<16>>;
+template class ExtendibleHashTable<GenericKey<32>, RID, GenericComparator<32>>;
+template class ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace cmudb
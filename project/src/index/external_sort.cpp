@@ -0,0 +1,203 @@
+/**
+ * external_sort.cpp
+ */
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "index/external_sort.h"
+
+namespace cmudb {
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNALSORT_TYPE::ExternalSort(BufferPoolManager *buffer_pool_manager,
+                                const KeyComparator &comparator, int workers,
+                                size_t run_size, bool unique)
+    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator),
+      run_size_(std::max<size_t>(run_size, 1)), unique_(unique),
+      buffers_(std::max(workers, 1)), has_last_(false) {
+  items_per_page_ = (buffer_pool_manager_->GetPageSize() - PAGE_HEADER_SIZE) /
+                    sizeof(MappingType);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNALSORT_TYPE::~ExternalSort() {
+  for (auto &run : runs_) {
+    for (page_id_t page_id : run.page_ids_) {
+      buffer_pool_manager_->DeletePage(page_id);
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNALSORT_TYPE::Add(int worker, const KeyType &key,
+                            const ValueType &value) {
+  std::vector<MappingType> &buffer = buffers_[worker];
+  buffer.emplace_back(key, value);
+  if (buffer.size() >= run_size_) {
+    Spill(buffer);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNALSORT_TYPE::Finish() {
+  std::vector<std::thread> sorters;
+  for (size_t i = 1; i < buffers_.size(); i++) {
+    if (!buffers_[i].empty()) {
+      sorters.emplace_back([this, i] { Sort(buffers_[i]); });
+    }
+  }
+  Sort(buffers_[0]);
+  for (auto &thread : sorters) {
+    thread.join();
+  }
+  for (auto &buffer : buffers_) {
+    if (!buffer.empty()) {
+      runs_.push_back(Run());
+      runs_.back().items_.swap(buffer);
+    }
+  }
+  buffers_.clear();
+  Rewind();
+}
+
+/*
+ * Equal keys come in run order, so with unique the first one added to the
+ * earliest run is kept
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNALSORT_TYPE::Next(MappingType &item) {
+  auto after = [this](size_t a, size_t b) { return After(a, b); };
+  while (!heap_.empty()) {
+    std::pop_heap(heap_.begin(), heap_.end(), after);
+    Run &run = runs_[heap_.back()];
+    item = run.items_[run.slot_++];
+    if (run.slot_ == run.items_.size() &&
+        run.page_ + 1 < run.page_ids_.size()) {
+      ReadPage(run, run.page_ + 1);
+    }
+    if (run.slot_ < run.items_.size()) {
+      std::push_heap(heap_.begin(), heap_.end(), after);
+    } else {
+      heap_.pop_back();
+    }
+    if (unique_ && has_last_ && comparator_(item.first, last_) == 0) {
+      continue;
+    }
+    has_last_ = true;
+    last_ = item.first;
+    return true;
+  }
+  return false;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNALSORT_TYPE::Rewind() {
+  heap_.clear();
+  has_last_ = false;
+  for (size_t i = 0; i < runs_.size(); i++) {
+    Run &run = runs_[i];
+    if (run.page_ids_.empty()) {
+      run.slot_ = 0;
+    } else {
+      ReadPage(run, 0);
+    }
+    heap_.push_back(i);
+  }
+  std::make_heap(heap_.begin(), heap_.end(),
+                 [this](size_t a, size_t b) { return After(a, b); });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+size_t EXTERNALSORT_TYPE::GetSpilledRunCount() {
+  std::lock_guard<std::mutex> guard(latch_);
+  size_t count = 0;
+  for (auto &run : runs_) {
+    count += run.page_ids_.empty() ? 0 : 1;
+  }
+  return count;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNALSORT_TYPE::Sort(std::vector<MappingType> &items) {
+  std::stable_sort(items.begin(), items.end(),
+                   [this](const MappingType &a, const MappingType &b) {
+                     return comparator_(a.first, b.first) < 0;
+                   });
+}
+
+/*
+ * Pages of a run are allocated next to one another, so the merge reads
+ * them sequentially
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNALSORT_TYPE::Spill(std::vector<MappingType> &items) {
+  Sort(items);
+  Run run;
+  page_id_t page_id = INVALID_PAGE_ID;
+  for (size_t i = 0; i < items.size(); i += items_per_page_) {
+    Page *page = buffer_pool_manager_->NewPage(page_id, page_id);
+    if (page == nullptr) {
+      for (page_id_t written : run.page_ids_) {
+        buffer_pool_manager_->DeletePage(written);
+      }
+      throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    uint32_t count =
+        static_cast<uint32_t>(std::min(items_per_page_, items.size() - i));
+    memcpy(page->GetData() + PAGE_HEADER_SIZE - sizeof(uint32_t), &count,
+           sizeof(uint32_t));
+    memcpy(page->GetData() + PAGE_HEADER_SIZE, &items[i],
+           count * sizeof(MappingType));
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    run.page_ids_.push_back(page_id);
+  }
+  items.clear();
+  std::lock_guard<std::mutex> guard(latch_);
+  runs_.push_back(std::move(run));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNALSORT_TYPE::ReadPage(Run &run, size_t page_index) {
+  page_id_t page_id = run.page_ids_[page_index];
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  uint32_t count;
+  memcpy(&count, page->GetData() + PAGE_HEADER_SIZE - sizeof(uint32_t),
+         sizeof(uint32_t));
+  const MappingType *items = reinterpret_cast<const MappingType *>(
+      page->GetData() + PAGE_HEADER_SIZE);
+  run.items_.assign(items, items + count);
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  run.page_ = page_index;
+  run.slot_ = 0;
+  if (page_index + 1 < run.page_ids_.size()) {
+    buffer_pool_manager_->Prefetch(run.page_ids_[page_index + 1]);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNALSORT_TYPE::After(size_t a, size_t b) {
+  const Run &run_a = runs_[a];
+  const Run &run_b = runs_[b];
+  int compared = comparator_(run_a.items_[run_a.slot_].first,
+                             run_b.items_[run_b.slot_].first);
+  return compared > 0 || (compared == 0 && a > b);
+}
+
+template class ExternalSort<GenericKey<4>, RID, GenericComparator<4>>;
+template class ExternalSort<GenericKey<8>, RID, GenericComparator<8>>;
+template class ExternalSort<GenericKey<16>, RID, GenericComparator<16>>;
+template class ExternalSort<GenericKey<32>, RID, GenericComparator<32>>;
+template class ExternalSort<GenericKey<64>, RID, GenericComparator<64>>;
+template class ExternalSort<GenericKey<4>, RID, IntegerComparator<4>>;
+template class ExternalSort<GenericKey<8>, RID, IntegerComparator<8>>;
+template class ExternalSort<GenericKey<16>, RID, BytesComparator<16>>;
+template class ExternalSort<GenericKey<32>, RID, BytesComparator<32>>;
+template class ExternalSort<GenericKey<64>, RID, BytesComparator<64>>;
+
+} // namespace cmudb
@@ -0,0 +1,62 @@
+/**
+ * hash_index.cpp
+ */
+
+#include "common/exception.h"
+#include "index/hash_index.h"
+
+namespace cmudb {
+/*
+ * Constructor
+ */
+INDEX_TEMPLATE_ARGUMENTS
+HASH_INDEX_TYPE::HashIndex(IndexMetadata *metadata,
+                           BufferPoolManager *buffer_pool_manager,
+                           page_id_t directory_page_id)
+    : Index(metadata), comparator_(metadata->GetKeySchema()),
+      container_(metadata->GetName(), buffer_pool_manager, comparator_,
+                 directory_page_id) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid,
+                                  Transaction *transaction) {
+  // construct insert index key
+  KeyType index_key;
+  index_key.SetFromKey(key, GetKeySchema());
+
+  if (!container_.Insert(index_key, rid, transaction)) {
+    // a key already there is left as the B+ tree leaves it, a key the
+    // buckets have no room for would be lost
+    std::vector<RID> existing;
+    if (!container_.GetValue(index_key, existing, transaction)) {
+      throw Exception(EXCEPTION_TYPE_INDEX, "no bucket has room for the key");
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_INDEX_TYPE::DeleteEntry(const Tuple &key, RID,
+                                  Transaction *transaction) {
+  // construct delete index key
+  KeyType index_key;
+  index_key.SetFromKey(key, GetKeySchema());
+
+  container_.Remove(index_key, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> &result,
+                              Transaction *transaction) {
+  // construct scan index key
+  KeyType index_key;
+  index_key.SetFromKey(key, GetKeySchema());
+
+  container_.GetValue(index_key, result, transaction);
+}
+template class HashIndex<GenericKey<4>, RID, GenericComparator<4>>;
+template class HashIndex<GenericKey<8>, RID, GenericComparator<8>>;
+template class HashIndex<GenericKey<16>, RID, GenericComparator<16>>;
+template class HashIndex<GenericKey<32>, RID, GenericComparator<32>>;
+template class HashIndex<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace cmudb
@@ -0,0 +1,67 @@
+/**
+ * index_builder.cpp
+ */
+#include "index/index_builder.h"
+
+namespace cmudb {
+
+IndexBuilder::IndexBuilder(Index *index, TableHeap *table_heap)
+    : index_(index), table_heap_(table_heap), building_(false),
+      applied_count_(0) {}
+
+/*
+ * The writes kept aside are applied with the latch held, so a write that
+ * comes meanwhile waits and goes to the index after them
+ */
+void IndexBuilder::Build(const std::function<Tuple(const Tuple &)> &key_of,
+                         int threads) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    building_ = true;
+  }
+  try {
+    index_->Build(table_heap_, key_of, threads);
+  } catch (...) {
+    std::lock_guard<std::mutex> guard(latch_);
+    building_ = false;
+    writes_.clear();
+    throw;
+  }
+  std::lock_guard<std::mutex> guard(latch_);
+  for (const Write &write : writes_) {
+    if (write.insert_) {
+      index_->InsertEntry(write.key_, write.rid_);
+    } else {
+      index_->DeleteEntry(write.key_, write.rid_);
+    }
+  }
+  applied_count_ += writes_.size();
+  writes_.clear();
+  building_ = false;
+}
+
+void IndexBuilder::InsertEntry(const Tuple &key, RID rid,
+                               Transaction *transaction) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (building_) {
+      writes_.push_back(Write{true, key, rid});
+      return;
+    }
+  }
+  index_->InsertEntry(key, rid, transaction);
+}
+
+void IndexBuilder::DeleteEntry(const Tuple &key, RID rid,
+                               Transaction *transaction) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (building_) {
+      writes_.push_back(Write{false, key, rid});
+      return;
+    }
+  }
+  index_->DeleteEntry(key, rid, transaction);
+}
+
+} // namespace cmudb
@@ -3,24 +3,289 @@
  */
 #include <cassert>
 
+#include "common/exception.h"
+#include "index/b_plus_tree.h"
 #include "index/index_iterator.h"
 
 namespace cmudb {
 
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator() {}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(
+    BPlusTree<KeyType, ValueType, KeyComparator> *tree, Page *page, int slot,
+    int read_ahead, bool reverse)
+    : tree_(tree), page_(page),
+      leaf_(reinterpret_cast<LeafPage *>(page->GetData())), slot_(slot),
+      read_ahead_(read_ahead), reverse_(reverse) {
+  // a window of many scans together must not evict what they read ahead
+  int pool_share =
+      static_cast<int>(tree_->buffer_pool_manager_->GetPoolSize() / 16);
+  if (read_ahead_ > pool_share) {
+    read_ahead_ = pool_share;
+  }
+  ReadAhead();
+  if (reverse_ && slot_ < 0) {
+    PrevLeaf();
+  } else if (!reverse_ && slot_ >= leaf_->GetSize()) {
+    NextLeaf();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other)
+    : tree_(other.tree_), page_(other.page_), leaf_(other.leaf_),
+      slot_(other.slot_), read_ahead_(other.read_ahead_),
+      reverse_(other.reverse_), ahead_(std::move(other.ahead_)),
+      values_(std::move(other.values_)), value_(other.value_),
+      item_(other.item_) {
+  other.page_ = nullptr;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::~IndexIterator() { Release(); }
+
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::isEnd() { return page_ == nullptr; }
+
+INDEX_TEMPLATE_ARGUMENTS
+const MappingType &INDEXITERATOR_TYPE::operator*() {
+  assert(!isEnd());
+  item_.first = leaf_->KeyAt(slot_);
+  if (!LoadValues()) {
+    item_.second = leaf_->ValueAt(slot_);
+    return item_;
+  }
+  item_.second = values_[reverse_ ? values_.size() - 1 - value_ : value_];
+  return item_;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
+  assert(!isEnd());
+  if (LoadValues() && ++value_ < values_.size()) {
+    return *this;
+  }
+  values_.clear();
+  value_ = 0;
+  if (reverse_) {
+    if (--slot_ < 0) {
+      PrevLeaf();
+    }
+  } else if (++slot_ >= leaf_->GetSize()) {
+    NextLeaf();
+  }
+  return *this;
+}
+
 /*
- * NOTE: you can change the destructor/constructor method here
- * set your own input parameters
+ * The next leaf is read latched before this one is let go of, unless a
+ * writer has it: then the iterator lets go first and descends to the key it
+ * stopped after, the leaves may have changed meanwhile
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator() {}
+void INDEXITERATOR_TYPE::NextLeaf() {
+  BufferPoolManager *buffer_pool_manager = tree_->buffer_pool_manager_;
+  while (!isEnd() && slot_ >= leaf_->GetSize()) {
+    page_id_t next_page_id = leaf_->GetNextPageId();
+    if (next_page_id == INVALID_PAGE_ID) {
+      Release();
+      return;
+    }
+    Page *next = buffer_pool_manager->FetchPage(next_page_id);
+    if (next == nullptr) {
+      Release();
+      throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    if (TakeLeaf(next, page_->GetPageId())) {
+      slot_ = 0;
+      ReadAhead();
+      continue;
+    }
+    buffer_pool_manager->UnpinPage(next_page_id, false);
+    // only an emptied root leaf has no pairs, and it goes with the tree
+    assert(leaf_->GetSize() > 0);
+    KeyType last = leaf_->KeyAt(leaf_->GetSize() - 1);
+    Release();
+    page_ = tree_->FindLeafPage(last, false,
+                                BPlusTree<KeyType, ValueType,
+                                          KeyComparator>::Operation::READ);
+    if (page_ == nullptr) {
+      return;
+    }
+    leaf_ = reinterpret_cast<LeafPage *>(page_->GetData());
+    slot_ = leaf_->KeyIndex(last, tree_->comparator_);
+    if (slot_ < leaf_->GetSize() &&
+        tree_->comparator_(leaf_->KeyAt(slot_), last) == 0) {
+      slot_++;
+    }
+    ReadAhead();
+  }
+}
+
+/*
+ * The previous leaf in the chain, if the hint is right, has only keys below
+ * those of this one. Otherwise descend to the leaf before the first key of
+ * this one; if what is left of its range has no keys, to the leaf before
+ * where the range starts, and so on
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::PrevLeaf() {
+  BufferPoolManager *buffer_pool_manager = tree_->buffer_pool_manager_;
+  // the leftmost leaf stays leftmost, merges keep the left page
+  KeyType bound = leaf_->KeyAt(0);
+  while (!isEnd() && slot_ < 0) {
+    page_id_t prev_page_id = leaf_->GetPrevPageId();
+    if (prev_page_id == INVALID_PAGE_ID) {
+      Release();
+      return;
+    }
+    Page *prev = buffer_pool_manager->FetchPage(prev_page_id);
+    if (prev == nullptr) {
+      Release();
+      throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+    }
+    if (TakeLeaf(prev, page_->GetPageId())) {
+      // -1 for a leaf emptied by a merge, its keys went further left
+      slot_ = leaf_->GetSize() - 1;
+      ReadAhead();
+      continue;
+    }
+    buffer_pool_manager->UnpinPage(prev_page_id, false);
+    Release();
+    KeyType key = bound;
+    while (true) {
+      typename BPlusTree<KeyType, ValueType, KeyComparator>::KeyBound low;
+      page_ = tree_->FindLeafBefore(&key, &low);
+      if (page_ == nullptr) {
+        return;
+      }
+      leaf_ = reinterpret_cast<LeafPage *>(page_->GetData());
+      slot_ = leaf_->KeyIndex(key, tree_->comparator_) - 1;
+      if (slot_ >= 0 || !low.bounded_) {
+        break;
+      }
+      key = low.key_;
+      Release();
+    }
+    ReadAhead();
+    if (slot_ < 0) {
+      Release();
+    }
+  }
+}
+
+/*
+ * Only a leaf linking to page_id in the scan direction is its neighbour
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::TakeLeaf(Page *page, page_id_t page_id) {
+  if (!page->TryRLatch()) {
+    return false;
+  }
+  LeafPage *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  if (!reverse_ || (leaf->IsLeafPage() &&
+                    leaf->GetPageId() == page->GetPageId() &&
+                    leaf->GetNextPageId() == page_id)) {
+    Release();
+    page_ = page;
+    leaf_ = leaf;
+    return true;
+  }
+  page->RUnlatch();
+  return false;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::LoadValues() {
+  if (!values_.empty()) {
+    return true;
+  }
+  ValueType stored = leaf_->ValueAt(slot_);
+  if (tree_->unique_ || !BPlusTreePostingPage::IsList(stored)) {
+    return false;
+  }
+  tree_->CollectValues(stored, values_);
+  return true;
+}
+
+/*
+ * Tops the hinted leaves up to read_ahead once half of them are reached,
+ * with the children following them, in scan order, in the parent of this
+ * leaf. Parent page ids are only kept right for writers, so the parent is
+ * checked to be one and skipped if a writer has it; it is only a hint.
+ * Leaves of another parent are reached through the leaf chain, one at a time
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::ReadAhead() {
+  page_id_t page_id = page_->GetPageId();
+  while (!ahead_.empty() && ahead_.front() != page_id) {
+    ahead_.pop_front();
+  }
+  if (!ahead_.empty()) {
+    ahead_.pop_front();
+  }
+  if (read_ahead_ <= 0 ||
+      2 * static_cast<int>(ahead_.size()) > read_ahead_) {
+    return;
+  }
+  typedef BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>
+      InternalPage;
+  BufferPoolManager *buffer_pool_manager = tree_->buffer_pool_manager_;
+  page_id_t last = ahead_.empty() ? page_id : ahead_.back();
+  page_id_t parent_id = leaf_->GetParentPageId();
+  Page *page = parent_id == INVALID_PAGE_ID
+                   ? nullptr
+                   : buffer_pool_manager->FetchPage(parent_id);
+  if (page != nullptr) {
+    if (page->TryRLatch()) {
+      InternalPage *parent = reinterpret_cast<InternalPage *>(page->GetData());
+      int capacity = static_cast<int>(
+          (buffer_pool_manager->GetPageSize() - sizeof(InternalPage)) /
+          sizeof(std::pair<KeyType, page_id_t>));
+      if (!parent->IsLeafPage() && parent->GetPageId() == parent_id &&
+          parent->GetSize() <= capacity) {
+        int index = parent->ValueIndex(last);
+        int step = reverse_ ? -1 : 1;
+        for (int i = index + step; index >= 0 && i >= 0 &&
+                                   i < parent->GetSize() &&
+                                   static_cast<int>(ahead_.size()) < read_ahead_;
+             i += step) {
+          ahead_.push_back(parent->ValueAt(i));
+          buffer_pool_manager->Prefetch(ahead_.back());
+        }
+      }
+      page->RUnlatch();
+    }
+    buffer_pool_manager->UnpinPage(parent_id, false);
+  }
+  page_id_t neighbour_id =
+      reverse_ ? leaf_->GetPrevPageId() : leaf_->GetNextPageId();
+  if (ahead_.empty() && neighbour_id != INVALID_PAGE_ID) {
+    ahead_.push_back(neighbour_id);
+    buffer_pool_manager->Prefetch(neighbour_id);
+  }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::~IndexIterator() {}
+void INDEXITERATOR_TYPE::Release() {
+  if (page_ != nullptr) {
+    page_->RUnlatch();
+    tree_->buffer_pool_manager_->UnpinPage(page_->GetPageId(), false);
+    page_ = nullptr;
+  }
+}
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 template class IndexIterator<GenericKey<8>, RID, GenericComparator<8>>;
 template class IndexIterator<GenericKey<16>, RID, GenericComparator<16>>;
 template class IndexIterator<GenericKey<32>, RID, GenericComparator<32>>;
 template class IndexIterator<GenericKey<64>, RID, GenericComparator<64>>;
+template class IndexIterator<GenericKey<4>, RID, IntegerComparator<4>>;
+template class IndexIterator<GenericKey<8>, RID, IntegerComparator<8>>;
+template class IndexIterator<GenericKey<16>, RID, BytesComparator<16>>;
+template class IndexIterator<GenericKey<32>, RID, BytesComparator<32>>;
+template class IndexIterator<GenericKey<64>, RID, BytesComparator<64>>;
 
 } // namespace cmudb
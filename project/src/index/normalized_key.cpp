@@ -0,0 +1,160 @@
+/**
+ * normalized_key.cpp
+ */
+
+#include <cstring>
+
+#include "index/normalized_key.h"
+
+namespace cmudb {
+
+namespace {
+// the low bytes of bits, most significant first, as many as fit into end
+char *PutBigEndian(uint64_t bits, int bytes, char *out, char *end) {
+  for (int i = bytes - 1; i >= 0 && out < end; --i) {
+    *out++ = static_cast<char>(bits >> (8 * i));
+  }
+  return out;
+}
+
+char *PutByte(char byte, char *out, char *end) {
+  if (out < end) {
+    *out++ = byte;
+  }
+  return out;
+}
+
+// bytes of the encoding of a column of type, 0 for a varchar
+size_t FixedSize(TypeId type) {
+  switch (type) {
+  case TypeId::BOOLEAN:
+  case TypeId::TINYINT:
+    return 1;
+  case TypeId::SMALLINT:
+    return 2;
+  case TypeId::INTEGER:
+    return 4;
+  case TypeId::BIGINT:
+  case TypeId::DECIMAL:
+  case TypeId::TIMESTAMP:
+    return 8;
+  default:
+    return 0;
+  }
+}
+} // namespace
+
+bool NormalizedKey::Fits(Schema *key_schema, size_t size) {
+  size_t total = 0;
+  for (int i = 0; i < key_schema->GetColumnCount(); ++i) {
+    TypeId type = key_schema->GetType(i);
+    if (type == TypeId::INVALID) {
+      return false;
+    }
+    total += FixedSize(type);
+  }
+  return total <= size;
+}
+
+void NormalizedKey::Encode(const Tuple &tuple, Schema *key_schema, char *data,
+                           size_t size) {
+  memset(data, 0, size);
+  char *out = data;
+  char *end = data + size;
+  for (int i = 0; i < key_schema->GetColumnCount() && out < end; ++i) {
+    Value value = tuple.GetValue(key_schema, i);
+    TypeId type = key_schema->GetType(i);
+    int bytes = static_cast<int>(FixedSize(type));
+    uint64_t sign = 1ull << (8 * bytes - 1);
+    switch (type) {
+    case TypeId::BOOLEAN:
+    case TypeId::TINYINT:
+      out = PutBigEndian(static_cast<uint8_t>(value.GetAs<int8_t>()) ^ sign,
+                         bytes, out, end);
+      break;
+    case TypeId::SMALLINT:
+      out = PutBigEndian(static_cast<uint16_t>(value.GetAs<int16_t>()) ^ sign,
+                         bytes, out, end);
+      break;
+    case TypeId::INTEGER:
+      out = PutBigEndian(static_cast<uint32_t>(value.GetAs<int32_t>()) ^ sign,
+                         bytes, out, end);
+      break;
+    case TypeId::BIGINT:
+      out = PutBigEndian(static_cast<uint64_t>(value.GetAs<int64_t>()) ^ sign,
+                         bytes, out, end);
+      break;
+    case TypeId::TIMESTAMP:
+      out = PutBigEndian(value.GetAs<uint64_t>(), bytes, out, end);
+      break;
+    case TypeId::DECIMAL: {
+      double decimal = value.GetAs<double>();
+      uint64_t bits;
+      memcpy(&bits, &decimal, sizeof(bits));
+      bits = (bits & sign) != 0 ? ~bits : bits ^ sign;
+      out = PutBigEndian(bits, bytes, out, end);
+      break;
+    }
+    case TypeId::VARCHAR: {
+      if (value.IsNull()) {
+        out = PutByte(0, out, end);
+        break;
+      }
+      out = PutByte(1, out, end);
+      // the length counts the terminating 0 of the string
+      const char *bytes = value.GetData();
+      uint32_t length = value.GetLength() - 1;
+      for (uint32_t j = 0; j < length && out < end; ++j) {
+        out = PutByte(bytes[j], out, end);
+        if (bytes[j] == 0) {
+          out = PutByte(static_cast<char>(0xFF), out, end);
+        }
+      }
+      out = PutByte(0, out, end);
+      out = PutByte(0, out, end);
+      break;
+    }
+    default:
+      break;
+    }
+  }
+}
+
+size_t NormalizedKey::EncodedSize(const Tuple &tuple, Schema *key_schema) {
+  size_t total = 0;
+  for (int i = 0; i < key_schema->GetColumnCount(); ++i) {
+    TypeId type = key_schema->GetType(i);
+    if (type != TypeId::VARCHAR) {
+      total += FixedSize(type);
+      continue;
+    }
+    Value value = tuple.GetValue(key_schema, i);
+    if (value.IsNull()) {
+      total += 1;
+      continue;
+    }
+    const char *bytes = value.GetData();
+    uint32_t length = value.GetLength() - 1;
+    total += 1 + length + 2;
+    for (uint32_t j = 0; j < length; ++j) {
+      if (bytes[j] == 0) {
+        total++;
+      }
+    }
+  }
+  return total;
+}
+
+void NormalizedKey::EncodeInteger(int64_t key, char *data) {
+  PutBigEndian(static_cast<uint64_t>(key) ^ (1ull << 63), 8, data, data + 8);
+}
+
+int64_t NormalizedKey::DecodeInteger(const char *data) {
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i) {
+    bits = (bits << 8) | static_cast<uint8_t>(data[i]);
+  }
+  return static_cast<int64_t>(bits ^ (1ull << 63));
+}
+
+} // namespace cmudb
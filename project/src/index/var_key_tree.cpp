@@ -0,0 +1,344 @@
+/**
+ * var_key_tree.cpp
+ */
+#include <cassert>
+
+#include "common/exception.h"
+#include "index/var_key_tree.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+VarKeyTree::VarKeyTree(const std::string &name,
+                       BufferPoolManager *buffer_pool_manager,
+                       page_id_t root_page_id)
+    : index_name_(name), root_page_id_(root_page_id),
+      buffer_pool_manager_(buffer_pool_manager) {
+  // a split leaves halves of at most half a page and an entry, each takes
+  // another entry
+  int capacity = static_cast<int>(buffer_pool_manager->GetPageSize() -
+                                  sizeof(LeafPage));
+  max_key_size_ = capacity / 4 - LeafPage::EntrySize(VarKey());
+}
+
+bool VarKeyTree::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID; }
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+bool VarKeyTree::GetValue(const VarKey &key, std::vector<RID> &result,
+                          Transaction *) {
+  latch_.RLock();
+  if (IsEmpty()) {
+    latch_.RUnlock();
+    return false;
+  }
+  Page *page = FindLeaf(key);
+  LeafPage *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->KeyIndex(key, comparator_, false);
+  bool found =
+      index < leaf->GetSize() && comparator_(leaf->KeyAt(index), key) == 0;
+  if (found) {
+    result.push_back(leaf->ValueAt(index));
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  latch_.RUnlock();
+  return found;
+}
+
+void VarKeyTree::Scan(const VarKey &key, size_t limit,
+                      std::vector<RID> &result,
+                      std::vector<std::string> *keys) {
+  latch_.RLock();
+  if (IsEmpty()) {
+    latch_.RUnlock();
+    return;
+  }
+  Page *page = FindLeaf(key);
+  LeafPage *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->KeyIndex(key, comparator_, false);
+  size_t count = 0;
+  while (count < limit) {
+    if (index == leaf->GetSize()) {
+      page_id_t next_page_id = leaf->GetNextPageId();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      if (next_page_id == INVALID_PAGE_ID) {
+        latch_.RUnlock();
+        return;
+      }
+      page = FetchPage(next_page_id);
+      leaf = reinterpret_cast<LeafPage *>(page->GetData());
+      index = 0;
+      continue;
+    }
+    if (keys != nullptr) {
+      keys->push_back(leaf->KeyAt(index).ToString());
+    }
+    result.push_back(leaf->ValueAt(index++));
+    count++;
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  latch_.RUnlock();
+}
+
+int VarKeyTree::GetHeight() {
+  latch_.RLock();
+  int height = 0;
+  page_id_t page_id = root_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    height++;
+    Page *page = FetchPage(page_id);
+    InternalPage *node = reinterpret_cast<InternalPage *>(page->GetData());
+    page_id = node->IsLeafPage() ? INVALID_PAGE_ID : node->ValueAt(0);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  }
+  latch_.RUnlock();
+  return height;
+}
+
+int VarKeyTree::GetPageCount() {
+  latch_.RLock();
+  int count = IsEmpty() ? 0 : CountPages(root_page_id_);
+  latch_.RUnlock();
+  return count;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+/*
+ * A full leaf is split at half its bytes, the separator posted to the
+ * parent is the shortest key between the halves
+ */
+bool VarKeyTree::Insert(const VarKey &key, const RID &value, Transaction *) {
+  if (key.size_ > max_key_size_) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "key too long");
+  }
+  latch_.WLock();
+  if (IsEmpty()) {
+    page_id_t root_id;
+    Page *page = NewPage(root_id);
+    LeafPage *root = reinterpret_cast<LeafPage *>(page->GetData());
+    root_page_id_ = root_id;
+    root->Init(root_page_id_, IndexPageType::LEAF_PAGE,
+               buffer_pool_manager_->GetPageSize());
+    root->InsertAt(0, key, value);
+    UpdateRootPageId(true);
+    buffer_pool_manager_->UnpinPage(root_page_id_, true);
+    latch_.WUnlock();
+    return true;
+  }
+  std::vector<page_id_t> path;
+  Page *page = FindLeaf(key, &path);
+  LeafPage *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->KeyIndex(key, comparator_, false);
+  if (index < leaf->GetSize() && comparator_(leaf->KeyAt(index), key) == 0) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    latch_.WUnlock();
+    return false;
+  }
+  if (leaf->InsertAt(index, key, value)) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+    latch_.WUnlock();
+    return true;
+  }
+
+  page_id_t right_id;
+  Page *right_page = NewPage(right_id);
+  LeafPage *right = reinterpret_cast<LeafPage *>(right_page->GetData());
+  right->Init(right_id, IndexPageType::LEAF_PAGE,
+              buffer_pool_manager_->GetPageSize());
+  int split = leaf->SplitIndex();
+  std::string separator =
+      VarKeyComparator::Separator(leaf->KeyAt(split - 1), leaf->KeyAt(split));
+  leaf->MoveTailTo(split, right);
+  right->SetNextPageId(leaf->GetNextPageId());
+  leaf->SetNextPageId(right_id);
+  bool inserted;
+  if (comparator_(key, VarKey(separator)) < 0) {
+    inserted = leaf->InsertAt(index, key, value);
+  } else {
+    inserted = right->InsertAt(index - split, key, value);
+  }
+  assert(inserted);
+  (void)inserted;
+  page_id_t left_id = leaf->GetPageId();
+  buffer_pool_manager_->UnpinPage(left_id, true);
+  buffer_pool_manager_->UnpinPage(right_id, true);
+  InsertIntoParent(path, left_id, separator, right_id);
+  latch_.WUnlock();
+  return true;
+}
+
+/*
+ * A full parent is split at half its bytes too, the key at the split moves
+ * up and its slot becomes slot 0 of the new page
+ */
+void VarKeyTree::InsertIntoParent(std::vector<page_id_t> &path,
+                                  page_id_t left_id,
+                                  const std::string &separator,
+                                  page_id_t right_id) {
+  std::string key = separator;
+  while (!path.empty()) {
+    Page *page = FetchPage(path.back());
+    path.pop_back();
+    InternalPage *parent = reinterpret_cast<InternalPage *>(page->GetData());
+    int index = parent->ValueIndex(left_id) + 1;
+    assert(index > 0);
+    if (parent->InsertAt(index, VarKey(key), right_id)) {
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+      return;
+    }
+    page_id_t sibling_id;
+    Page *sibling_page = NewPage(sibling_id);
+    InternalPage *sibling =
+        reinterpret_cast<InternalPage *>(sibling_page->GetData());
+    sibling->Init(sibling_id, IndexPageType::INTERNAL_PAGE,
+                  buffer_pool_manager_->GetPageSize());
+    int split = parent->SplitIndex();
+    std::string parent_key = parent->KeyAt(split).ToString();
+    parent->MoveTailTo(split, sibling);
+    page_id_t first_child = sibling->ValueAt(0);
+    sibling->RemoveAt(0);
+    sibling->InsertAt(0, VarKey(), first_child);
+    bool inserted;
+    if (index <= split) {
+      inserted = parent->InsertAt(index, VarKey(key), right_id);
+    } else {
+      inserted = sibling->InsertAt(index - split, VarKey(key), right_id);
+    }
+    assert(inserted);
+    (void)inserted;
+    left_id = parent->GetPageId();
+    right_id = sibling_id;
+    key = parent_key;
+    buffer_pool_manager_->UnpinPage(left_id, true);
+    buffer_pool_manager_->UnpinPage(sibling_id, true);
+  }
+
+  // the root split, a new one goes above it
+  page_id_t root_id;
+  Page *page = NewPage(root_id);
+  InternalPage *root = reinterpret_cast<InternalPage *>(page->GetData());
+  root_page_id_ = root_id;
+  root->Init(root_page_id_, IndexPageType::INTERNAL_PAGE,
+             buffer_pool_manager_->GetPageSize());
+  root->InsertAt(0, VarKey(), left_id);
+  root->InsertAt(1, VarKey(key), right_id);
+  UpdateRootPageId(false);
+  buffer_pool_manager_->UnpinPage(root_page_id_, true);
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+void VarKeyTree::Remove(const VarKey &key, Transaction *) {
+  latch_.WLock();
+  if (IsEmpty()) {
+    latch_.WUnlock();
+    return;
+  }
+  Page *page = FindLeaf(key);
+  LeafPage *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->KeyIndex(key, comparator_, false);
+  bool found =
+      index < leaf->GetSize() && comparator_(leaf->KeyAt(index), key) == 0;
+  if (found) {
+    leaf->RemoveAt(index);
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), found);
+  latch_.WUnlock();
+}
+
+/*****************************************************************************
+ * UTILITIES
+ *****************************************************************************/
+Page *VarKeyTree::FetchPage(page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  return page;
+}
+
+Page *VarKeyTree::NewPage(page_id_t &page_id) {
+  Page *page = buffer_pool_manager_->NewPage(page_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  return page;
+}
+
+/*
+ * The child at slot i has the keys from key i on, slot 0 the ones below
+ * key 1
+ */
+Page *VarKeyTree::FindLeaf(const VarKey &key, std::vector<page_id_t> *path) {
+  Page *page = FetchPage(root_page_id_);
+  InternalPage *node = reinterpret_cast<InternalPage *>(page->GetData());
+  while (!node->IsLeafPage()) {
+    if (path != nullptr) {
+      path->push_back(node->GetPageId());
+    }
+    page_id_t child_id =
+        node->ValueAt(node->KeyIndex(key, comparator_, true) - 1);
+    buffer_pool_manager_->UnpinPage(node->GetPageId(), false);
+    page = FetchPage(child_id);
+    node = reinterpret_cast<InternalPage *>(page->GetData());
+  }
+  return page;
+}
+
+void VarKeyTree::Flush() {
+  latch_.RLock();
+  if (!IsEmpty()) {
+    FlushPages(root_page_id_);
+  }
+  latch_.RUnlock();
+}
+
+void VarKeyTree::FlushPages(page_id_t page_id) {
+  Page *page = FetchPage(page_id);
+  InternalPage *node = reinterpret_cast<InternalPage *>(page->GetData());
+  if (!node->IsLeafPage()) {
+    for (int i = 0; i < node->GetSize(); i++) {
+      FlushPages(node->ValueAt(i));
+    }
+  }
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  buffer_pool_manager_->FlushPage(page_id);
+}
+
+int VarKeyTree::CountPages(page_id_t page_id) {
+  Page *page = FetchPage(page_id);
+  InternalPage *node = reinterpret_cast<InternalPage *>(page->GetData());
+  int count = 1;
+  if (!node->IsLeafPage()) {
+    for (int i = 0; i < node->GetSize(); i++) {
+      count += CountPages(node->ValueAt(i));
+    }
+  }
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return count;
+}
+
+/*
+ * Record the root page id in the header page, under the tree latch
+ */
+void VarKeyTree::UpdateRootPageId(bool insert_record) {
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "out of memory");
+  }
+  header_page->WLatch();
+  if (insert_record && !header_page->InsertRecord(index_name_, root_page_id_))
+    header_page->UpdateRecord(index_name_, root_page_id_);
+  else if (!insert_record &&
+           !header_page->UpdateRecord(index_name_, root_page_id_))
+    header_page->InsertRecord(index_name_, root_page_id_);
+  header_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+}
+
+} // namespace cmudb
@@ -0,0 +1,49 @@
+/**
+ * var_key_tree_index.cpp
+ */
+
+#include "index/normalized_key.h"
+#include "index/var_key_tree_index.h"
+
+namespace cmudb {
+/*
+ * Constructor
+ */
+VarKeyTreeIndex::VarKeyTreeIndex(IndexMetadata *metadata,
+                                 BufferPoolManager *buffer_pool_manager,
+                                 page_id_t root_page_id)
+    : Index(metadata),
+      container_(metadata->GetName(), buffer_pool_manager, root_page_id) {}
+
+void VarKeyTreeIndex::InsertEntry(const Tuple &key, RID rid,
+                                  Transaction *transaction) {
+  // construct insert index key
+  std::string index_key = EncodeKey(key);
+
+  container_.Insert(VarKey(index_key), rid, transaction);
+}
+
+void VarKeyTreeIndex::DeleteEntry(const Tuple &key, RID,
+                                  Transaction *transaction) {
+  // construct delete index key
+  std::string index_key = EncodeKey(key);
+
+  container_.Remove(VarKey(index_key), transaction);
+}
+
+void VarKeyTreeIndex::ScanKey(const Tuple &key, std::vector<RID> &result,
+                              Transaction *transaction) {
+  // construct scan index key
+  std::string index_key = EncodeKey(key);
+
+  container_.GetValue(VarKey(index_key), result, transaction);
+}
+
+std::string VarKeyTreeIndex::EncodeKey(const Tuple &key) {
+  size_t size = NormalizedKey::EncodedSize(key, GetKeySchema());
+  std::string bytes(size, '\0');
+  NormalizedKey::Encode(key, GetKeySchema(), &bytes[0], size);
+  return bytes;
+}
+
+} // namespace cmudb
@@ -0,0 +1,149 @@
+/**
+ * checkpoint_manager.cpp
+ */
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "logging/checkpoint_manager.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+/*
+ * A transaction is in the active transaction table before its BEGIN record
+ * is appended, and a page is in the dirty page table from the time it is
+ * pinned until it is clean on disk. So a transaction or a change with an
+ * LSN below the BEGINCHECKPOINT record is in the tables, they are taken
+ * after the record is appended. The same goes for root swaps in the root
+ * catalog, which stands for the header page until it is flushed
+ */
+lsn_t CheckpointManager::Checkpoint() {
+  std::lock_guard<std::mutex> guard(checkpoint_latch_);
+  if (!ENABLE_LOGGING) {
+    return INVALID_LSN;
+  }
+  LogRecord begin_record(INVALID_TXN_ID, INVALID_LSN,
+                         LogRecordType::BEGINCHECKPOINT);
+  lsn_t begin_lsn = log_manager_->AppendLogRecord(begin_record);
+  if (root_catalog_ != nullptr) {
+    root_catalog_->Flush();
+  }
+
+  std::vector<std::pair<txn_id_t, lsn_t>> txns;
+  lsn_t redo_lsn = begin_lsn;
+  lsn_t txn_lsn = transaction_manager_->GetActiveTransactions(txns);
+  if (txn_lsn != INVALID_LSN) {
+    redo_lsn = std::min(redo_lsn, txn_lsn);
+  }
+  std::vector<std::pair<page_id_t, lsn_t>> pages;
+  buffer_pool_manager_->GetDirtyPages(pages);
+  lsn_t root_lsn =
+      root_catalog_ == nullptr ? INVALID_LSN : root_catalog_->GetRecLSN();
+  if (root_lsn != INVALID_LSN) {
+    auto header = pages.begin();
+    while (header != pages.end() && header->first != HEADER_PAGE_ID) {
+      ++header;
+    }
+    if (header == pages.end()) {
+      pages.emplace_back(HEADER_PAGE_ID, root_lsn);
+    } else {
+      header->second = std::min(header->second, root_lsn);
+    }
+  }
+  for (auto &page : pages) {
+    redo_lsn = std::min(redo_lsn, page.second);
+  }
+
+  LogRecord end_record(begin_lsn, txns, pages);
+  log_manager_->WaitForDurable(log_manager_->AppendLogRecord(end_record));
+
+  if (!RecordCheckpoint(begin_lsn, log_manager_->GetLogOffset(begin_lsn),
+                        log_manager_->GetLogOffset(redo_lsn))) {
+    return INVALID_LSN;
+  }
+  // recovery reads nothing below the redo point anymore
+  log_manager_->TruncateLog(redo_lsn);
+  last_checkpoint_lsn_ = begin_lsn;
+  return begin_lsn;
+}
+
+bool CheckpointManager::RecordCheckpoint(lsn_t checkpoint_lsn,
+                                         log_offset_t checkpoint_offset,
+                                         log_offset_t redo_offset) {
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    return false;
+  }
+  if (header_page->GetRecordedPageSize() !=
+      buffer_pool_manager_->GetPageSize()) {
+    buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+    return false;
+  }
+  bool recorded = true;
+  header_page->WLatch();
+  if (!header_page->InsertRecord(CHECKPOINT_LSN_RECORD, checkpoint_lsn) &&
+      !header_page->UpdateRecord(CHECKPOINT_LSN_RECORD, checkpoint_lsn)) {
+    recorded = false;
+  }
+  if (!header_page->SetWideRecord(CHECKPOINT_OFFSET_RECORD,
+                                  checkpoint_offset) ||
+      !header_page->SetWideRecord(REDO_OFFSET_RECORD, redo_offset)) {
+    recorded = false;
+  }
+  header_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  // the checkpoint counts once the header page says so on disk
+  buffer_pool_manager_->FlushPage(HEADER_PAGE_ID);
+  return recorded;
+}
+
+void CheckpointManager::RunCheckpointThread(TaskScheduler *scheduler) {
+  std::lock_guard<std::mutex> guard(thread_latch_);
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  if (scheduler != nullptr) {
+    scheduler_ = scheduler;
+    checkpoint_task_ = scheduler->SchedulePeriodic(
+        [this] { Checkpoint(); }, CHECKPOINT_TIMEOUT);
+    return;
+  }
+  checkpoint_thread_ = new std::thread([this] {
+    std::unique_lock<std::mutex> lock(thread_latch_);
+    while (true) {
+      thread_cv_.wait_for(lock, CHECKPOINT_TIMEOUT,
+                          [this] { return !running_; });
+      if (!running_) {
+        return;
+      }
+      lock.unlock();
+      Checkpoint();
+      lock.lock();
+    }
+  });
+}
+
+void CheckpointManager::StopCheckpointThread() {
+  {
+    std::lock_guard<std::mutex> guard(thread_latch_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  if (scheduler_ != nullptr) {
+    scheduler_->Cancel(checkpoint_task_);
+    scheduler_ = nullptr;
+    return;
+  }
+  thread_cv_.notify_one();
+  checkpoint_thread_->join();
+  delete checkpoint_thread_;
+  checkpoint_thread_ = nullptr;
+}
+
+} // namespace cmudb
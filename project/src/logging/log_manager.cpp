@@ -2,6 +2,11 @@
  * log_manager.cpp
  */
 
+#include <cstring>
+
+#include "buffer/compressed_page_cache.h"
+#include "common/metrics.h"
+#include "common/numa.h"
 #include "logging/log_manager.h"
 
 namespace cmudb {
@@ -12,35 +17,405 @@ namespace cmudb {
  * manager wants to force flush (it only happens when the flushed page has a
  * larger LSN than persistent LSN)
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread(int numa_node) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  ENABLE_LOGGING = true;
+  for (int i = 0; i < LOG_BUFFER_SEGMENTS && numa_node != -1; ++i) {
+    Numa::BindMemory(segments_[i].data_, LOG_BUFFER_SIZE, numa_node);
+  }
+  flush_thread_ = new std::thread([this, numa_node] {
+    Numa::PinThread(numa_node);
+    FlushThread();
+  });
+}
+
 /*
  * Stop and join the flush thread, set ENABLE_LOGGING = false
+ * What is left in the log buffer is flushed once the thread is gone
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+    ENABLE_LOGGING = false;
+  }
+  cv_.notify_one();
+  append_cv_.notify_all();
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+  std::unique_lock<std::mutex> lock(latch_);
+  FlushBuffer(lock);
+}
+
+/*
+ * Flush on time out, on a full buffer, or when a committer waits. A
+ * committer is not served right away: the group commit window gives others
+ * the chance to append their COMMIT records and share the write
+ */
+void LogManager::FlushThread() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    cv_.wait_for(lock, LOG_TIMEOUT, [this] {
+      return !running_ || flush_requested_ || buffer_full_;
+    });
+    if (running_ && flush_requested_ && !buffer_full_ &&
+        LOG_GROUP_COMMIT_WINDOW.count() > 0) {
+      cv_.wait_for(lock, LOG_GROUP_COMMIT_WINDOW,
+                   [this] { return !running_ || buffer_full_; });
+    }
+    FlushBuffer(lock);
+    if (!running_) {
+      return;
+    }
+  }
+}
+
+void LogManager::FlushBuffer(std::unique_lock<std::mutex> &lock) {
+  // one writer at a time, segments go to disk in order
+  durable_cv_.wait(lock, [this] { return !flushing_; });
+  flush_requested_ = false;
+  buffer_full_ = false;
+  // everything appended so far, later appends wait for the next flush
+  lsn_t target = LsnOf(reservation_) - 1;
+  flushing_ = true;
+  while (persistent_lsn_ < target) {
+    if (head_ == SegmentOf(reservation_) && !SealSegment()) {
+      break;
+    }
+    LogSegment &segment = segments_[head_];
+    size_t size = segment.size_;
+    // segments are written in LSN order, this one follows the last written
+    lsn_t first_lsn = persistent_lsn_ + 1;
+    write_offsets_[first_lsn] = log_offset_;
+
+    lock.unlock();
+    // appenders that reserved before the seal may still be copying
+    while (segment.completed_.load(std::memory_order_acquire) != size) {
+      std::this_thread::yield();
+    }
+    auto start = std::chrono::steady_clock::now();
+    int written = static_cast<int>(size);
+    if (compress_) {
+      written = WriteFrame(segment, size, first_lsn);
+    } else if (!disk_manager_->WriteLog(segment.data_, written)) {
+      written = -1;
+    }
+    if (written < 0) {
+      // not durable, the segment is written again by the next flush
+      lock.lock();
+      break;
+    }
+    counters_.flush_ns_.Record(NanosSince(start));
+    counters_.flush_bytes_.Record(written);
+    LogCounters::Add(counters_.flushes_);
+    LogCounters::Add(counters_.bytes_flushed_, written);
+    segment.completed_.store(0, std::memory_order_relaxed);
+    lock.lock();
+
+    log_offset_ += written;
+    persistent_lsn_ = segment.last_lsn_;
+    head_ = NextSegment(head_);
+    append_cv_.notify_all();
+    durable_cv_.notify_all();
+  }
+  flushing_ = false;
+  durable_cv_.notify_all();
+}
+
+int LogManager::WriteFrame(LogSegment &segment, size_t size,
+                           lsn_t first_lsn) {
+  LogFrameHeader header;
+  header.magic_ = LogFrameHeader::MAGIC;
+  header.first_lsn_ = first_lsn;
+  header.last_lsn_ = segment.last_lsn_;
+  header.raw_size_ = static_cast<int32_t>(size);
+  std::vector<char> &frame = segment.frame_;
+  frame.resize(sizeof(header));
+  if (!CompressedPageCache::Compress(segment.data_, size, frame)) {
+    frame.insert(frame.end(), segment.data_, segment.data_ + size);
+  }
+  header.stored_size_ = static_cast<int32_t>(frame.size() - sizeof(header));
+  memcpy(frame.data(), &header, sizeof(header));
+  if (!disk_manager_->WriteLog(frame.data(),
+                               static_cast<int>(frame.size()))) {
+    return -1;
+  }
+  return static_cast<int>(frame.size());
+}
+
+bool LogManager::SealSegment() {
+  uint64_t word = reservation_.load();
+  int next = NextSegment(SegmentOf(word));
+  if (next == head_) {
+    return false;
+  }
+  // only the offset and LSN move under appenders, the segment stays
+  do {
+    if (OffsetOf(word) == 0) {
+      return false;
+    }
+  } while (!reservation_.compare_exchange_weak(
+      word, Reservation(LsnOf(word), next, 0)));
+  LogSegment &segment = segments_[SegmentOf(word)];
+  segment.size_ = OffsetOf(word);
+  segment.last_lsn_ = LsnOf(word) - 1;
+  append_cv_.notify_all();
+  return true;
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
  *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
+ * The LSN and the space are reserved together, so records lie in the log in
+ * LSN order. The copy runs in parallel with other appenders
  */
 lsn_t LogManager::AppendLogRecord(LogRecord &log_record) {
+  auto start = std::chrono::steady_clock::now();
+  size_t size = log_record.size_;
+  uint64_t word = reservation_.load(std::memory_order_relaxed);
+  while (true) {
+    if (OffsetOf(word) + size > LOG_BUFFER_SIZE) {
+      WaitForRoom(word, size);
+      word = reservation_.load(std::memory_order_relaxed);
+      continue;
+    }
+    // one more LSN and size more bytes, the offset never overflows
+    if (reservation_.compare_exchange_weak(
+            word, word + (static_cast<uint64_t>(1) << 32) + size)) {
+      break;
+    }
+  }
+  log_record.lsn_ = LsnOf(word);
+  LogSegment &segment = segments_[SegmentOf(word)];
+  SerializeLogRecord(log_record, segment.data_ + OffsetOf(word));
+  segment.completed_.fetch_add(size, std::memory_order_release);
+  LogCounters::Add(counters_.appends_);
+  LogCounters::Add(counters_.bytes_appended_, size);
+  counters_.append_ns_.Record(NanosSince(start));
+  TRACE_VALUE(log, append_bytes, size, log_record.lsn_);
+  return log_record.lsn_;
+}
+
+/*
+ * Seal the active segment and move on to the next one. Only when that one
+ * still waits to be written, wait for the flush thread or, without a flush
+ * thread, flush
+ */
+void LogManager::WaitForRoom(uint64_t word, size_t size) {
+  std::unique_lock<std::mutex> lock(latch_);
+  uint64_t current = reservation_.load();
+  if (SegmentOf(current) != SegmentOf(word) ||
+      OffsetOf(current) + size <= LOG_BUFFER_SIZE) {
+    return;
+  }
+  if (SealSegment()) {
+    if (running_) {
+      buffer_full_ = true;
+      cv_.notify_one();
+    }
+    return;
+  }
+  // every other segment waits to be written, the append stalls
+  auto start = std::chrono::steady_clock::now();
+  if (!running_) {
+    FlushBuffer(lock);
+  } else {
+    buffer_full_ = true;
+    cv_.notify_one();
+    int segment = SegmentOf(current);
+    append_cv_.wait(lock, [this, segment] {
+      return !running_ || SegmentOf(reservation_) != segment ||
+             NextSegment(segment) != head_;
+    });
+  }
+  LogCounters::Add(counters_.full_stalls_);
+  LogCounters::Add(counters_.full_stall_ns_, NanosSince(start));
+}
+
+/*
+ * Record layout as in log_record.h
+ */
+void LogManager::SerializeLogRecord(const LogRecord &log_record, char *pos) {
+  // First, serialize the must have fields(20 bytes in total)
+  memcpy(pos, &log_record.size_, sizeof(int32_t));
+  memcpy(pos + 4, &log_record.lsn_, sizeof(lsn_t));
+  memcpy(pos + 8, &log_record.txn_id_, sizeof(txn_id_t));
+  memcpy(pos + 12, &log_record.prev_lsn_, sizeof(lsn_t));
+  memcpy(pos + 16, &log_record.log_record_type_, sizeof(LogRecordType));
+  pos += LogRecord::HEADER_SIZE;
+
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+    memcpy(pos, &log_record.insert_rid_, sizeof(RID));
+    pos += sizeof(RID);
+    // we have provided serialize function for tuple class
+    log_record.insert_tuple_.SerializeTo(pos);
+    break;
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    memcpy(pos, &log_record.delete_rid_, sizeof(RID));
+    pos += sizeof(RID);
+    log_record.delete_tuple_.SerializeTo(pos);
+    break;
+  case LogRecordType::UPDATE:
+    memcpy(pos, &log_record.update_rid_, sizeof(RID));
+    pos += sizeof(RID);
+    log_record.old_tuple_.SerializeTo(pos);
+    pos += sizeof(int32_t) + log_record.old_tuple_.GetLength();
+    log_record.new_tuple_.SerializeTo(pos);
+    break;
+  case LogRecordType::UPDATEDELTA:
+    memcpy(pos, &log_record.update_rid_, sizeof(RID));
+    pos += sizeof(RID);
+    memcpy(pos, log_record.delta_.data(), log_record.delta_.size());
+    break;
+  case LogRecordType::INSERTBATCH: {
+    memcpy(pos, &log_record.insert_rid_, sizeof(RID));
+    pos += sizeof(RID);
+    int32_t count = static_cast<int32_t>(log_record.batch_tuples_.size());
+    memcpy(pos, &count, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    for (auto &tuple : log_record.batch_tuples_) {
+      tuple.SerializeTo(pos);
+      pos += sizeof(int32_t) + tuple.GetLength();
+    }
+    break;
+  }
+  case LogRecordType::NEWPAGE:
+    memcpy(pos, &log_record.prev_page_id_, sizeof(page_id_t));
+    memcpy(pos + sizeof(page_id_t), &log_record.page_id_, sizeof(page_id_t));
+    if (!log_record.column_widths_.empty()) {
+      pos += 2 * sizeof(page_id_t);
+      int32_t count = static_cast<int32_t>(log_record.column_widths_.size());
+      memcpy(pos, &count, sizeof(int32_t));
+      memcpy(pos + sizeof(int32_t), log_record.column_widths_.data(),
+             count * sizeof(int32_t));
+    }
+    break;
+  case LogRecordType::ENDCHECKPOINT: {
+    int32_t count = static_cast<int32_t>(log_record.checkpoint_txns_.size());
+    memcpy(pos, &count, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    for (auto &txn : log_record.checkpoint_txns_) {
+      memcpy(pos, &txn.first, sizeof(txn_id_t));
+      memcpy(pos + sizeof(txn_id_t), &txn.second, sizeof(lsn_t));
+      pos += sizeof(txn_id_t) + sizeof(lsn_t);
+    }
+    count = static_cast<int32_t>(log_record.checkpoint_pages_.size());
+    memcpy(pos, &count, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    for (auto &page : log_record.checkpoint_pages_) {
+      memcpy(pos, &page.first, sizeof(page_id_t));
+      memcpy(pos + sizeof(page_id_t), &page.second, sizeof(lsn_t));
+      pos += sizeof(page_id_t) + sizeof(lsn_t);
+    }
+    break;
+  }
+  case LogRecordType::BTREEINSERT:
+  case LogRecordType::BTREEDELETE: {
+    int32_t fields[4] = {log_record.page_id_, log_record.slot_,
+                         log_record.array_offset_,
+                         static_cast<int32_t>(log_record.entry_.size())};
+    memcpy(pos, fields, sizeof(fields));
+    memcpy(pos + sizeof(fields), log_record.entry_.data(),
+           log_record.entry_.size());
+    break;
+  }
+  case LogRecordType::BTREESTRUCTURE: {
+    int32_t count = static_cast<int32_t>(log_record.page_writes_.size());
+    memcpy(pos, &count, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    for (auto &write : log_record.page_writes_) {
+      int32_t fields[4] = {write.page_id_, write.format_ ? 1 : 0,
+                           write.offset_,
+                           static_cast<int32_t>(write.data_.size())};
+      memcpy(pos, fields, sizeof(fields));
+      memcpy(pos + sizeof(fields), write.data_.data(), write.data_.size());
+      pos += sizeof(fields) + write.data_.size();
+    }
+    int32_t name_size = static_cast<int32_t>(log_record.index_name_.size());
+    memcpy(pos, &name_size, sizeof(int32_t));
+    memcpy(pos + sizeof(int32_t), log_record.index_name_.data(), name_size);
+    memcpy(pos + sizeof(int32_t) + name_size, &log_record.root_page_id_,
+           sizeof(page_id_t));
+    break;
+  }
+  default:
+    // BEGIN/COMMIT/ABORT/BEGINCHECKPOINT are the header only
+    break;
+  }
+}
+
+/*
+ * lsn past the last record appended is capped, nothing beyond it can
+ * become durable. This is what makes commits a group: every waiter whose
+ * record is in the buffer is released by the same flush
+ */
+void LogManager::WaitForDurable(lsn_t lsn) {
+  std::unique_lock<std::mutex> lock(latch_);
+  lsn = std::min<lsn_t>(lsn, LsnOf(reservation_) - 1);
+  if (persistent_lsn_ >= lsn) {
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  while (persistent_lsn_ < lsn) {
+    if (!running_) {
+      FlushBuffer(lock);
+      continue;
+    }
+    if (!flush_requested_) {
+      flush_requested_ = true;
+      cv_.notify_one();
+    }
+    durable_cv_.wait(lock);
+  }
+  LogCounters::Add(counters_.durable_waits_);
+  counters_.durable_wait_ns_.Record(NanosSince(start));
+}
+
+log_offset_t LogManager::GetLogOffset(lsn_t lsn) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = write_offsets_.upper_bound(lsn);
+  if (it == write_offsets_.begin()) {
+    return it == write_offsets_.end() ? log_offset_ : it->second;
+  }
+  return (--it)->second;
+}
+
+void LogManager::TruncateLog(lsn_t lsn) {
+  log_offset_t offset = GetLogOffset(lsn);
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    auto it = write_offsets_.upper_bound(lsn);
+    if (it != write_offsets_.begin()) {
+      // the write holding lsn stays
+      write_offsets_.erase(write_offsets_.begin(), --it);
+    }
+  }
+  disk_manager_->TruncateLog(offset);
+}
 
-  return INVALID_LSN;
+void LogManager::WaitForPage(page_id_t page_id, const char *page_data) {
+  // the header page keeps no LSN, its record count is where it would be
+  if (page_id == HEADER_PAGE_ID) {
+    return;
+  }
+  lsn_t lsn;
+  memcpy(&lsn, page_data + 4, sizeof(lsn));
+  if (lsn != INVALID_LSN && lsn > persistent_lsn_) {
+    WaitForDurable(lsn);
+  }
 }
 
 } // namespace cmudb
@@ -0,0 +1,415 @@
+/**
+ * log_reader.cpp
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "buffer/compressed_page_cache.h"
+#include "common/memory_tracker.h"
+#include "logging/log_reader.h"
+
+namespace cmudb {
+
+LogReader::LogReader(DiskManager *disk_manager, log_offset_t offset,
+                     size_t chunk_size)
+    : disk_manager_(disk_manager), chunk_size_(chunk_size), current_(0),
+      frame_buffer_(LOG_BUFFER_SIZE), frame_offset_(-1), frame_pos_(0),
+      frame_size_(0) {
+  assert(chunk_size_ >= static_cast<size_t>(MAX_ENTRY_SIZE));
+  for (auto &buffer : buffers_) {
+    buffer.resize(MAX_ENTRY_SIZE + chunk_size_);
+  }
+  // recovery cannot wait for memory, counted even over the budget
+  MemoryTracker::Instance().Charge(MemoryConsumer::RECOVERY, Footprint());
+  Seek(offset);
+}
+
+LogReader::~LogReader() {
+  if (pending_.valid()) {
+    pending_.wait();
+  }
+  MemoryTracker::Instance().Release(MemoryConsumer::RECOVERY, Footprint());
+}
+
+size_t LogReader::Footprint() const {
+  return buffers_[0].size() + buffers_[1].size() + frame_buffer_.size();
+}
+
+void LogReader::Seek(log_offset_t offset) {
+  if (pending_.valid()) {
+    pending_.wait();
+  }
+  data_ = end_ = base_ = buffers_[current_].data() + MAX_ENTRY_SIZE;
+  data_offset_ = base_offset_ = read_offset_ = offset;
+  frame_offset_ = -1;
+  StartRead();
+}
+
+void LogReader::StartRead() {
+  char *chunk = buffers_[1 - current_].data() + MAX_ENTRY_SIZE;
+  log_offset_t offset = read_offset_;
+  pending_ = std::async(std::launch::async, [this, chunk, offset] {
+    if (!disk_manager_->ReadLog(chunk, static_cast<int>(chunk_size_),
+                                offset)) {
+      return 0;
+    }
+    // ReadLog fills up with zeros past the end of the log
+    return static_cast<int>(
+        std::min<log_offset_t>(chunk_size_,
+                               disk_manager_->GetLogSize() - offset));
+  });
+}
+
+bool LogReader::NextChunk() {
+  int count = pending_.get();
+  if (count <= 0) {
+    return false;
+  }
+  // the rest of the current chunk goes right in front of the next one
+  size_t rest = end_ - data_;
+  char *chunk = buffers_[1 - current_].data() + MAX_ENTRY_SIZE;
+  memcpy(chunk - rest, data_, rest);
+  current_ = 1 - current_;
+  data_ = base_ = chunk - rest;
+  end_ = chunk + count;
+  base_offset_ = data_offset_;
+  read_offset_ += count;
+  StartRead();
+  return true;
+}
+
+bool LogReader::Next(LogRecord &log_record, LogPosition &position) {
+  while (true) {
+    // records of the frame at hand come first
+    if (frame_offset_ >= 0) {
+      if (frame_pos_ < frame_size_ &&
+          DeserializeLogRecord(frame_buffer_.data() + frame_pos_,
+                               frame_buffer_.data() + frame_size_,
+                               log_record)) {
+        position = LogPosition{frame_offset_, frame_pos_};
+        frame_pos_ += log_record.size_;
+        return true;
+      }
+      frame_offset_ = -1;
+    }
+    size_t available = end_ - data_;
+    int size = EntrySize(data_, available);
+    if (size < 0 || static_cast<size_t>(size) > available) {
+      // the only chunk that ends in a partial entry is the last one
+      if (!NextChunk()) {
+        return false;
+      }
+      continue;
+    }
+    if (size == 0) {
+      return false;
+    }
+    const char *data = data_;
+    log_offset_t offset = data_offset_;
+    data_ += size;
+    data_offset_ += size;
+    int32_t magic;
+    memcpy(&magic, data, sizeof(magic));
+    if (magic == LogFrameHeader::MAGIC) {
+      if (!ReadFrame(data, size, offset)) {
+        return false;
+      }
+      continue;
+    }
+    if (!DeserializeLogRecord(data, data + size, log_record)) {
+      return false;
+    }
+    position = LogPosition{offset, -1};
+    return true;
+  }
+}
+
+bool LogReader::Read(LogPosition position, LogRecord &log_record) {
+  if (position.frame_pos_ < 0 || frame_offset_ != position.offset_) {
+    // from the chunk at hand if the entry is complete in it
+    const char *data = nullptr;
+    int size = -1;
+    if (position.offset_ >= base_offset_ &&
+        position.offset_ - base_offset_ < end_ - base_) {
+      data = base_ + (position.offset_ - base_offset_);
+      size = EntrySize(data, end_ - data);
+    }
+    if (size <= 0 || data + size > end_) {
+      Seek(position.offset_);
+      if (!NextChunk()) {
+        return false;
+      }
+      data = data_;
+      size = EntrySize(data, end_ - data);
+      if (size <= 0 || data + size > end_) {
+        return false;
+      }
+    }
+    data_ = data + size;
+    data_offset_ = position.offset_ + size;
+    if (position.frame_pos_ < 0) {
+      return DeserializeLogRecord(data, data + size, log_record);
+    }
+    if (!ReadFrame(data, size, position.offset_)) {
+      return false;
+    }
+  }
+  // Next goes on after the frame, not among its records
+  frame_pos_ = frame_size_;
+  return position.frame_pos_ < frame_size_ &&
+         DeserializeLogRecord(frame_buffer_.data() + position.frame_pos_,
+                              frame_buffer_.data() + frame_size_, log_record);
+}
+
+int LogReader::EntrySize(const char *data, size_t available) {
+  int32_t size;
+  if (available < sizeof(size)) {
+    return -1;
+  }
+  memcpy(&size, data, sizeof(size));
+  if (size == LogFrameHeader::MAGIC) {
+    LogFrameHeader header;
+    if (available < sizeof(header)) {
+      return -1;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.raw_size_ < 0 || header.raw_size_ > LOG_BUFFER_SIZE ||
+        header.stored_size_ < 0 || header.stored_size_ > LOG_BUFFER_SIZE) {
+      return 0;
+    }
+    return sizeof(header) + header.stored_size_;
+  }
+  if (size < LogRecord::HEADER_SIZE || size > LOG_BUFFER_SIZE) {
+    return 0;
+  }
+  return size;
+}
+
+bool LogReader::ReadFrame(const char *data, int size,
+                          log_offset_t offset) {
+  LogFrameHeader header;
+  memcpy(&header, data, sizeof(header));
+  const char *stored = data + sizeof(header);
+  if (header.stored_size_ == header.raw_size_) {
+    memcpy(frame_buffer_.data(), stored, header.raw_size_);
+  } else if (!CompressedPageCache::Decompress(stored, header.stored_size_,
+                                              frame_buffer_.data(),
+                                              header.raw_size_)) {
+    return false;
+  }
+  assert(size == static_cast<int>(sizeof(header)) + header.stored_size_);
+  frame_offset_ = offset;
+  frame_pos_ = 0;
+  frame_size_ = header.raw_size_;
+  return true;
+}
+
+/*
+ * deserialize a log record from log buffer
+ * @return: true means deserialize succeed, otherwise can't deserialize cause
+ * incomplete log record
+ */
+bool LogReader::DeserializeLogRecord(const char *data, const char *end,
+                                     LogRecord &log_record) {
+  assert(data <= end);
+  if (end - data < LogRecord::HEADER_SIZE) {
+    return false;
+  }
+  memcpy(&log_record.size_, data, sizeof(int32_t));
+  memcpy(&log_record.lsn_, data + 4, sizeof(lsn_t));
+  memcpy(&log_record.txn_id_, data + 8, sizeof(txn_id_t));
+  memcpy(&log_record.prev_lsn_, data + 12, sizeof(lsn_t));
+  memcpy(&log_record.log_record_type_, data + 16, sizeof(LogRecordType));
+  if (log_record.size_ < LogRecord::HEADER_SIZE ||
+      log_record.size_ > end - data ||
+      log_record.log_record_type_ <= LogRecordType::INVALID ||
+      log_record.log_record_type_ > LogRecordType::INSERTBATCH) {
+    return false;
+  }
+  const char *pos = data + LogRecord::HEADER_SIZE;
+  // log_record may be reused, a checkpoint read into it before must not
+  // show through a record of another type
+  log_record.checkpoint_txns_.clear();
+  log_record.checkpoint_pages_.clear();
+
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+    memcpy(&log_record.insert_rid_, pos, sizeof(RID));
+    log_record.insert_tuple_.DeserializeFrom(pos + sizeof(RID));
+    break;
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    memcpy(&log_record.delete_rid_, pos, sizeof(RID));
+    log_record.delete_tuple_.DeserializeFrom(pos + sizeof(RID));
+    break;
+  case LogRecordType::UPDATE:
+    memcpy(&log_record.update_rid_, pos, sizeof(RID));
+    pos += sizeof(RID);
+    log_record.old_tuple_.DeserializeFrom(pos);
+    pos += sizeof(int32_t) + log_record.old_tuple_.GetLength();
+    log_record.new_tuple_.DeserializeFrom(pos);
+    break;
+  case LogRecordType::UPDATEDELTA:
+    memcpy(&log_record.update_rid_, pos, sizeof(RID));
+    pos += sizeof(RID);
+    log_record.delta_.assign(pos, data + log_record.size_);
+    break;
+  case LogRecordType::NEWPAGE: {
+    memcpy(&log_record.prev_page_id_, pos, sizeof(page_id_t));
+    memcpy(&log_record.page_id_, pos + sizeof(page_id_t), sizeof(page_id_t));
+    pos += 2 * sizeof(page_id_t);
+    // the layout of a PAX page
+    log_record.column_widths_.clear();
+    const char *record_end = data + log_record.size_;
+    if (record_end - pos >= 4) {
+      int32_t count;
+      memcpy(&count, pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      if (count < 0 || count > (record_end - pos) / 4) {
+        return false;
+      }
+      log_record.column_widths_.resize(count);
+      memcpy(log_record.column_widths_.data(), pos, count * sizeof(int32_t));
+    }
+    break;
+  }
+  case LogRecordType::ENDCHECKPOINT:
+    return DeserializeCheckpoint(pos, data + log_record.size_, log_record);
+  case LogRecordType::BTREEINSERT:
+  case LogRecordType::BTREEDELETE: {
+    int32_t fields[4];
+    if (data + log_record.size_ - pos < static_cast<int>(sizeof(fields))) {
+      return false;
+    }
+    memcpy(fields, pos, sizeof(fields));
+    pos += sizeof(fields);
+    if (fields[3] < 0 || fields[3] > data + log_record.size_ - pos) {
+      return false;
+    }
+    log_record.page_id_ = fields[0];
+    log_record.slot_ = fields[1];
+    log_record.array_offset_ = fields[2];
+    log_record.entry_.assign(pos, pos + fields[3]);
+    break;
+  }
+  case LogRecordType::BTREESTRUCTURE:
+    return DeserializeStructure(pos, data + log_record.size_, log_record);
+  case LogRecordType::INSERTBATCH:
+    return DeserializeBatch(pos, data + log_record.size_, log_record);
+  default:
+    // BEGIN/COMMIT/ABORT/BEGINCHECKPOINT are the header only
+    break;
+  }
+  return true;
+}
+
+bool LogReader::DeserializeStructure(const char *pos, const char *end,
+                                     LogRecord &log_record) {
+  // the record may be reused, as by the iterator
+  log_record.page_writes_.clear();
+  int32_t count;
+  if (end - pos < static_cast<int>(sizeof(int32_t))) {
+    return false;
+  }
+  memcpy(&count, pos, sizeof(int32_t));
+  pos += sizeof(int32_t);
+  if (count < 0) {
+    return false;
+  }
+  for (int32_t i = 0; i < count; ++i) {
+    int32_t fields[4];
+    if (end - pos < static_cast<int>(sizeof(fields))) {
+      return false;
+    }
+    memcpy(fields, pos, sizeof(fields));
+    pos += sizeof(fields);
+    if (fields[3] < 0 || fields[3] > end - pos) {
+      return false;
+    }
+    PageWrite write{fields[0], fields[1] != 0, fields[2],
+                    std::vector<char>(pos, pos + fields[3])};
+    log_record.page_writes_.push_back(std::move(write));
+    pos += fields[3];
+  }
+  int32_t name_size;
+  if (end - pos < static_cast<int>(sizeof(int32_t))) {
+    return false;
+  }
+  memcpy(&name_size, pos, sizeof(int32_t));
+  pos += sizeof(int32_t);
+  if (name_size < 0 ||
+      name_size + static_cast<int>(sizeof(page_id_t)) > end - pos) {
+    return false;
+  }
+  log_record.index_name_.assign(pos, name_size);
+  memcpy(&log_record.root_page_id_, pos + name_size, sizeof(page_id_t));
+  return true;
+}
+
+bool LogReader::DeserializeBatch(const char *pos, const char *end,
+                                 LogRecord &log_record) {
+  log_record.batch_tuples_.clear();
+  int32_t count;
+  if (end - pos < static_cast<int>(sizeof(RID) + sizeof(int32_t))) {
+    return false;
+  }
+  memcpy(&log_record.insert_rid_, pos, sizeof(RID));
+  memcpy(&count, pos + sizeof(RID), sizeof(int32_t));
+  pos += sizeof(RID) + sizeof(int32_t);
+  if (count < 0) {
+    return false;
+  }
+  for (int32_t i = 0; i < count; ++i) {
+    int32_t size;
+    if (end - pos < static_cast<int>(sizeof(int32_t))) {
+      return false;
+    }
+    memcpy(&size, pos, sizeof(int32_t));
+    if (size < 0 || size > end - pos - static_cast<int>(sizeof(int32_t))) {
+      return false;
+    }
+    log_record.batch_tuples_.emplace_back();
+    log_record.batch_tuples_.back().DeserializeFrom(pos);
+    pos += sizeof(int32_t) + size;
+  }
+  return true;
+}
+
+bool LogReader::DeserializeCheckpoint(const char *pos, const char *end,
+                                      LogRecord &log_record) {
+  const int entry_size = sizeof(int32_t) + sizeof(lsn_t);
+  int32_t count;
+  if (end - pos < static_cast<int>(sizeof(int32_t))) {
+    return false;
+  }
+  memcpy(&count, pos, sizeof(int32_t));
+  pos += sizeof(int32_t);
+  if (count < 0 || count > (end - pos) / entry_size) {
+    return false;
+  }
+  for (int32_t i = 0; i < count; ++i, pos += entry_size) {
+    std::pair<txn_id_t, lsn_t> txn;
+    memcpy(&txn.first, pos, sizeof(txn_id_t));
+    memcpy(&txn.second, pos + sizeof(txn_id_t), sizeof(lsn_t));
+    log_record.checkpoint_txns_.push_back(txn);
+  }
+  if (end - pos < static_cast<int>(sizeof(int32_t))) {
+    return false;
+  }
+  memcpy(&count, pos, sizeof(int32_t));
+  pos += sizeof(int32_t);
+  if (count < 0 || count > (end - pos) / entry_size) {
+    return false;
+  }
+  for (int32_t i = 0; i < count; ++i, pos += entry_size) {
+    std::pair<page_id_t, lsn_t> page;
+    memcpy(&page.first, pos, sizeof(page_id_t));
+    memcpy(&page.second, pos + sizeof(page_id_t), sizeof(lsn_t));
+    log_record.checkpoint_pages_.push_back(page);
+  }
+  return true;
+}
+
+} // namespace cmudb
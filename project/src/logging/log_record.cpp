@@ -0,0 +1,116 @@
+/**
+ * log_record.cpp
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "logging/log_record.h"
+
+namespace cmudb {
+
+/*
+ * Tuples of equal size are compared byte by byte, every run of changes is a
+ * range of unchanged length. A tuple that grows or shrinks, e.g. through a
+ * varchar, moves everything behind the change, so it is one range between
+ * the common prefix and the common suffix. Either way only the last range
+ * may change its length, and range offsets hold in the old and the new
+ * tuple alike
+ */
+void LogRecord::EncodeDelta(const Tuple &old_tuple, const Tuple &new_tuple) {
+  int32_t old_size = old_tuple.GetLength();
+  int32_t new_size = new_tuple.GetLength();
+  const char *old_data = old_tuple.GetData();
+  const char *new_data = new_tuple.GetData();
+  delta_.assign(3 * sizeof(int32_t), 0);
+  memcpy(&delta_[0], &old_size, sizeof(int32_t));
+  memcpy(&delta_[4], &new_size, sizeof(int32_t));
+
+  if (old_size == new_size) {
+    int32_t i = 0;
+    while (i < old_size) {
+      if (old_data[i] == new_data[i]) {
+        ++i;
+        continue;
+      }
+      int32_t begin = i;
+      int32_t end = i + 1;
+      for (int32_t j = end; j < old_size && j - end < DELTA_RANGE_HEADER;
+           ++j) {
+        if (old_data[j] != new_data[j]) {
+          end = j + 1;
+        }
+      }
+      AppendRange(begin, end - begin, end - begin, old_data, new_data);
+      i = end;
+    }
+    return;
+  }
+
+  int32_t common = std::min(old_size, new_size);
+  int32_t prefix = 0;
+  while (prefix < common && old_data[prefix] == new_data[prefix]) {
+    ++prefix;
+  }
+  int32_t suffix = 0;
+  while (suffix < common - prefix &&
+         old_data[old_size - 1 - suffix] == new_data[new_size - 1 - suffix]) {
+    ++suffix;
+  }
+  AppendRange(prefix, old_size - prefix - suffix, new_size - prefix - suffix,
+              old_data, new_data);
+}
+
+void LogRecord::AppendRange(int32_t offset, int32_t old_length,
+                            int32_t new_length, const char *old_data,
+                            const char *new_data) {
+  int32_t header[3] = {offset, old_length, new_length};
+  const char *bytes = reinterpret_cast<const char *>(header);
+  delta_.insert(delta_.end(), bytes, bytes + sizeof(header));
+  delta_.insert(delta_.end(), old_data + offset, old_data + offset + old_length);
+  delta_.insert(delta_.end(), new_data + offset, new_data + offset + new_length);
+  int32_t count;
+  memcpy(&count, &delta_[8], sizeof(int32_t));
+  ++count;
+  memcpy(&delta_[8], &count, sizeof(int32_t));
+}
+
+bool LogRecord::ApplyDelta(const Tuple &tuple, Tuple &result,
+                           bool redo) const {
+  assert(log_record_type_ == LogRecordType::UPDATEDELTA);
+  int32_t sizes[3];
+  memcpy(sizes, delta_.data(), sizeof(sizes));
+  int32_t from_size = redo ? sizes[0] : sizes[1];
+  int32_t to_size = redo ? sizes[1] : sizes[0];
+  if (tuple.GetLength() != from_size) {
+    return false;
+  }
+
+  // result is built as serialized tuple, | size | data |
+  std::vector<char> storage(sizeof(int32_t) + to_size);
+  memcpy(storage.data(), &to_size, sizeof(int32_t));
+  char *out = storage.data() + sizeof(int32_t);
+  const char *from = tuple.GetData();
+  const char *range = delta_.data() + sizeof(sizes);
+  int32_t pos = 0;
+  for (int32_t i = 0; i < sizes[2]; ++i) {
+    int32_t header[3];
+    memcpy(header, range, sizeof(header));
+    int32_t from_length = redo ? header[1] : header[2];
+    int32_t to_length = redo ? header[2] : header[1];
+    const char *to_data =
+        range + sizeof(header) + (redo ? header[1] : 0);
+    // the bytes before this range are unchanged
+    memcpy(out, from + pos, header[0] - pos);
+    out += header[0] - pos;
+    memcpy(out, to_data, to_length);
+    out += to_length;
+    pos = header[0] + from_length;
+    range += sizeof(header) + header[1] + header[2];
+  }
+  memcpy(out, from + pos, from_size - pos);
+  result.DeserializeFrom(storage.data());
+  return true;
+}
+
+} // namespace cmudb
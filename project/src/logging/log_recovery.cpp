@@ -2,33 +2,534 @@
  * log_recovey.cpp
  */
 
+#include <cstring>
+#include <map>
+
+#include "logging/checkpoint_manager.h"
 #include "logging/log_recovery.h"
+#include "page/b_plus_tree_page.h"
+#include "page/header_page.h"
 #include "page/table_page.h"
 
 namespace cmudb {
-/*
- * deserialize a log record from log buffer
- * @return: true means deserialize succeed, otherwise can't deserialize cause
- * incomplete log record
- */
-bool LogRecovery::DeserializeLogRecord(const char *data,
-                                             LogRecord &log_record) {
-  return false;
-}
-
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
  *read log file from the beginning to end (you must prefetch log records into
  *log buffer to reduce unnecessary I/O operations), remember to compare page's
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
+ *
+ *With workers, this thread only reads and decodes the log. Records go to
+ *the worker their page id hashes to, so each page sees its records in log
+ *order
+ *
+ *After a checkpoint, reading starts where the header page says and records
+ *below the checkpoint are only redone on pages of its dirty page table
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  StartWorkers();
+  LogReader reader(disk_manager_, ReadCheckpoint());
+  for (auto it = reader.begin(); it != reader.end(); ++it) {
+    RedoRecord(*it, it.GetPosition());
+  }
+  StopWorkers();
+}
+
+log_offset_t LogRecovery::ReadCheckpoint() {
+  checkpoint_lsn_ = INVALID_LSN;
+  dirty_pages_.clear();
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    return disk_manager_->GetLogStart();
+  }
+  page_id_t checkpoint_lsn = INVALID_LSN;
+  log_offset_t checkpoint_offset = 0;
+  log_offset_t redo_offset = 0;
+  bool found =
+      header_page->GetRecordedPageSize() ==
+          buffer_pool_manager_->GetPageSize() &&
+      header_page->GetRootId(CHECKPOINT_LSN_RECORD, checkpoint_lsn) &&
+      header_page->GetWideRecord(CHECKPOINT_OFFSET_RECORD,
+                                 checkpoint_offset) &&
+      header_page->GetWideRecord(REDO_OFFSET_RECORD, redo_offset);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  if (!found) {
+    return disk_manager_->GetLogStart();
+  }
+
+  bool complete = false;
+  LogReader reader(disk_manager_, checkpoint_offset);
+  for (auto &log_record : reader) {
+    if (log_record.log_record_type_ != LogRecordType::ENDCHECKPOINT ||
+        log_record.prev_lsn_ != checkpoint_lsn) {
+      continue;
+    }
+    for (auto &txn : log_record.checkpoint_txns_) {
+      active_txn_[txn.first] = txn.second;
+    }
+    for (auto &page : log_record.checkpoint_pages_) {
+      dirty_pages_[page.first] = page.second;
+    }
+    complete = true;
+    break;
+  }
+  // the header page is only written once the checkpoint is durable, a
+  // missing end record means the log is not the one checkpointed
+  if (!complete) {
+    active_txn_.clear();
+    dirty_pages_.clear();
+    return disk_manager_->GetLogStart();
+  }
+  checkpoint_lsn_ = checkpoint_lsn;
+  return redo_offset;
+}
+
+void LogRecovery::RedoRecord(LogRecord &log_record, LogPosition position) {
+  if (log_record.log_record_type_ == LogRecordType::BEGINCHECKPOINT ||
+      log_record.log_record_type_ == LogRecordType::ENDCHECKPOINT) {
+    return;
+  }
+  if (log_record.log_record_type_ == LogRecordType::BTREESTRUCTURE) {
+    for (auto &write : log_record.page_writes_) {
+      disk_manager_->ClaimPage(write.page_id_);
+    }
+    RedoStructure(log_record);
+    return;
+  }
+  // B+ tree records are redo only, undo does not need them
+  if (log_record.log_record_type_ != LogRecordType::BTREEINSERT &&
+      log_record.log_record_type_ != LogRecordType::BTREEDELETE) {
+    lsn_mapping_[log_record.lsn_] = position;
+    active_txn_[log_record.txn_id_] = log_record.lsn_;
+  }
+  if (log_record.log_record_type_ == LogRecordType::COMMIT ||
+      log_record.log_record_type_ == LogRecordType::ABORT) {
+    active_txn_.erase(log_record.txn_id_);
+    return;
+  }
+  page_id_t page_id = GetPageId(log_record);
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  // a page of the log is in use, whether it made it to the file or not
+  disk_manager_->ClaimPage(page_id);
+  // the link from the previous page is not logged on its own
+  page_id_t prev_page_id = log_record.log_record_type_ == LogRecordType::NEWPAGE
+                               ? log_record.prev_page_id_
+                               : INVALID_PAGE_ID;
+  bool redo = NeedsRedo(page_id, log_record.lsn_);
+  if (workers_.empty()) {
+    if (redo) {
+      RedoLogRecord(log_record);
+    }
+    if (prev_page_id != INVALID_PAGE_ID) {
+      LinkPage(prev_page_id, page_id);
+    }
+    return;
+  }
+  // each page is redone by one worker, in log order
+  if (redo) {
+    Submit(page_id % workers_.size(),
+           [this, log_record]() mutable { RedoLogRecord(log_record); });
+  }
+  if (prev_page_id != INVALID_PAGE_ID) {
+    Submit(prev_page_id % workers_.size(),
+           [this, prev_page_id, page_id] { LinkPage(prev_page_id, page_id); });
+  }
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
+ *
+ *With workers, this thread reads the records of one loser transaction after
+ *the other and hands each transaction to a worker as a whole
+ */
+void LogRecovery::Undo() {
+  StartWorkers();
+  // records of one frame are read from the frame unpacked once
+  LogReader reader(disk_manager_, disk_manager_->GetLogStart());
+  size_t next_worker = 0;
+  for (auto &txn : active_txn_) {
+    std::vector<LogRecord> log_records;
+    lsn_t lsn = txn.second;
+    while (lsn != INVALID_LSN) {
+      auto it = lsn_mapping_.find(lsn);
+      LogRecord log_record;
+      if (it == lsn_mapping_.end() || !reader.Read(it->second, log_record)) {
+        break;
+      }
+      lsn = log_record.prev_lsn_;
+      if (workers_.empty()) {
+        UndoLogRecord(log_record);
+      } else {
+        log_records.push_back(log_record);
+      }
+    }
+    if (!workers_.empty()) {
+      Submit(next_worker++ % workers_.size(),
+             [this, log_records]() mutable {
+               for (auto &log_record : log_records) {
+                 UndoLogRecord(log_record);
+               }
+             });
+    }
+  }
+  StopWorkers();
+  active_txn_.clear();
+  lsn_mapping_.clear();
+}
+
+/*
+ * Every page is redone on its own, with the LSN check of its own. The
+ * records of a tree operation are complete or missing as a whole, so a
+ * crash does not leave a split half done
+ */
+void LogRecovery::RedoStructure(LogRecord &log_record) {
+  auto record = std::make_shared<LogRecord>(log_record);
+  std::map<page_id_t, std::vector<size_t>> pages;
+  for (size_t i = 0; i < record->page_writes_.size(); ++i) {
+    pages[record->page_writes_[i].page_id_].push_back(i);
+  }
+  for (auto &page : pages) {
+    if (!NeedsRedo(page.first, record->lsn_)) {
+      continue;
+    }
+    std::vector<size_t> writes = page.second;
+    Dispatch(page.first, [this, record, writes] {
+      RedoPageWrites(*record, writes);
+    });
+  }
+  // the header page has no LSN, the root is set again
+  if (!record->index_name_.empty() &&
+      NeedsRedo(HEADER_PAGE_ID, record->lsn_)) {
+    Dispatch(HEADER_PAGE_ID, [this, record] {
+      if (catalog_ != nullptr) {
+        catalog_->SetRoot(record->index_name_, record->root_page_id_);
+        return;
+      }
+      auto header_page = static_cast<HeaderPage *>(
+          buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+      if (header_page == nullptr) {
+        return;
+      }
+      if (!header_page->UpdateRecord(record->index_name_,
+                                     record->root_page_id_)) {
+        header_page->InsertRecord(record->index_name_, record->root_page_id_);
+      }
+      buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+    });
+  }
+}
+
+void LogRecovery::RedoPageWrites(const LogRecord &log_record,
+                                 const std::vector<size_t> &writes) {
+  page_id_t page_id = log_record.page_writes_[writes[0]].page_id_;
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    return;
+  }
+  bool format = false;
+  for (size_t i : writes) {
+    format = format || log_record.page_writes_[i].format_;
+  }
+  // a new page that was never written back may hold anything, its LSN too
+  auto node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  if (page->GetLSN() >= log_record.lsn_ &&
+      (!format || node->GetPageId() == page_id)) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return;
+  }
+  int page_size = static_cast<int>(buffer_pool_manager_->GetPageSize());
+  if (format) {
+    memset(page->GetData(), 0, page_size);
+  }
+  for (size_t i : writes) {
+    const PageWrite &write = log_record.page_writes_[i];
+    if (write.offset_ >= 0 &&
+        write.offset_ + static_cast<int>(write.data_.size()) <= page_size) {
+      memcpy(page->GetData() + write.offset_, write.data_.data(),
+             write.data_.size());
+    }
+  }
+  page->SetLSN(log_record.lsn_);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+/*
+ * Entries of a page are an array of fixed size slots, the record knows
+ * where it starts and how long a slot is
+ */
+void LogRecovery::RedoEntry(const LogRecord &log_record, char *data) {
+  auto node = reinterpret_cast<BPlusTreePage *>(data);
+  int size = node->GetSize();
+  int slot = log_record.slot_;
+  int entry_size = static_cast<int>(log_record.entry_.size());
+  int page_size = static_cast<int>(buffer_pool_manager_->GetPageSize());
+  bool insert = log_record.log_record_type_ == LogRecordType::BTREEINSERT;
+  if (slot < 0 || slot > size - (insert ? 0 : 1) ||
+      log_record.array_offset_ + (size + (insert ? 1 : 0)) * entry_size >
+          page_size) {
+    return;
+  }
+  char *pos = data + log_record.array_offset_ + slot * entry_size;
+  if (insert) {
+    memmove(pos + entry_size, pos, (size - slot) * entry_size);
+    memcpy(pos, log_record.entry_.data(), entry_size);
+    node->IncreaseSize(1);
+  } else {
+    memmove(pos, pos + entry_size, (size - slot - 1) * entry_size);
+    node->IncreaseSize(-1);
+  }
+}
+
+/*
+ * before the checkpoint, a change of a page that was clean then, or whose
+ * recLSN lies past the change, is on disk
  */
-void LogRecovery::Undo() {}
+bool LogRecovery::NeedsRedo(page_id_t page_id, lsn_t lsn) {
+  if (lsn >= checkpoint_lsn_) {
+    return true;
+  }
+  auto it = dirty_pages_.find(page_id);
+  return it != dirty_pages_.end() && lsn >= it->second;
+}
+
+void LogRecovery::Dispatch(page_id_t page_id, std::function<void()> task) {
+  if (workers_.empty()) {
+    task();
+    return;
+  }
+  Submit(page_id % workers_.size(), std::move(task));
+}
+
+page_id_t LogRecovery::GetPageId(const LogRecord &log_record) {
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+  case LogRecordType::INSERTBATCH:
+    return log_record.insert_rid_.GetPageId();
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    return log_record.delete_rid_.GetPageId();
+  case LogRecordType::UPDATE:
+  case LogRecordType::UPDATEDELTA:
+    return log_record.update_rid_.GetPageId();
+  case LogRecordType::NEWPAGE:
+  case LogRecordType::BTREEINSERT:
+  case LogRecordType::BTREEDELETE:
+    return log_record.page_id_;
+  default:
+    return INVALID_PAGE_ID;
+  }
+}
+
+void LogRecovery::RedoLogRecord(LogRecord &log_record) {
+  page_id_t page_id = GetPageId(log_record);
+  auto page =
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr) {
+    return;
+  }
+  if (log_record.log_record_type_ != LogRecordType::NEWPAGE &&
+      page->GetLSN() >= log_record.lsn_) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return;
+  }
+
+  Tuple tuple;
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+    page->InsertTuple(log_record.insert_tuple_, log_record.insert_rid_,
+                      nullptr, nullptr, nullptr);
+    break;
+  case LogRecordType::INSERTBATCH: {
+    std::vector<RID> rids;
+    page->AppendTuples(log_record.batch_tuples_, 0, rids, nullptr, nullptr,
+                       nullptr);
+    break;
+  }
+  case LogRecordType::MARKDELETE:
+    page->MarkDelete(log_record.delete_rid_, nullptr, nullptr, nullptr);
+    break;
+  case LogRecordType::APPLYDELETE:
+    page->ApplyDelete(log_record.delete_rid_, nullptr, nullptr);
+    break;
+  case LogRecordType::ROLLBACKDELETE:
+    page->RollbackDelete(log_record.delete_rid_, nullptr, nullptr);
+    break;
+  case LogRecordType::UPDATE:
+    page->UpdateTuple(log_record.new_tuple_, tuple, log_record.update_rid_,
+                      nullptr, nullptr, nullptr);
+    break;
+  case LogRecordType::UPDATEDELTA: {
+    Tuple new_tuple;
+    if (page->GetTuple(log_record.update_rid_, tuple, nullptr, nullptr) &&
+        log_record.ApplyDelta(tuple, new_tuple, true)) {
+      page->UpdateTuple(new_tuple, tuple, log_record.update_rid_, nullptr,
+                        nullptr, nullptr);
+    }
+    break;
+  }
+  case LogRecordType::NEWPAGE:
+    // a page that was never written back may hold anything, its LSN too
+    if (page->GetPageId() == page_id && page->GetLSN() >= log_record.lsn_) {
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      return;
+    }
+    page->Init(page_id, buffer_pool_manager_->GetPageSize(),
+               log_record.prev_page_id_, nullptr, nullptr,
+               log_record.column_widths_);
+    break;
+  case LogRecordType::BTREEINSERT:
+  case LogRecordType::BTREEDELETE:
+    RedoEntry(log_record, page->GetData());
+    break;
+  default:
+    break;
+  }
+  page->SetLSN(log_record.lsn_);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+void LogRecovery::LinkPage(page_id_t prev_page_id, page_id_t page_id) {
+  auto prev_page =
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(prev_page_id));
+  if (prev_page == nullptr) {
+    return;
+  }
+  bool linked = prev_page->GetNextPageId() != page_id;
+  prev_page->SetNextPageId(page_id);
+  buffer_pool_manager_->UnpinPage(prev_page_id, linked);
+}
+
+/*
+ * Losers may share pages, the page latch keeps parallel undo apart
+ */
+void LogRecovery::UndoLogRecord(LogRecord &log_record) {
+  RID rid;
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+  case LogRecordType::INSERTBATCH:
+    rid = log_record.insert_rid_;
+    break;
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    rid = log_record.delete_rid_;
+    break;
+  case LogRecordType::UPDATE:
+  case LogRecordType::UPDATEDELTA:
+    rid = log_record.update_rid_;
+    break;
+  default:
+    // BEGIN and NEWPAGE leave nothing to roll back
+    return;
+  }
+  auto page = static_cast<TablePage *>(
+      buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  if (page == nullptr) {
+    return;
+  }
+
+  page->WLatch();
+  Tuple tuple;
+  switch (log_record.log_record_type_) {
+  case LogRecordType::INSERT:
+    page->ApplyDelete(rid, nullptr, nullptr);
+    break;
+  case LogRecordType::INSERTBATCH:
+    for (int i = static_cast<int>(log_record.batch_tuples_.size()) - 1;
+         i >= 0; --i) {
+      page->ApplyDelete(RID(rid.GetPageId(), rid.GetSlotNum() + i), nullptr,
+                        nullptr);
+    }
+    break;
+  case LogRecordType::MARKDELETE:
+    page->RollbackDelete(rid, nullptr, nullptr);
+    break;
+  case LogRecordType::APPLYDELETE:
+    page->InsertTuple(log_record.delete_tuple_, rid, nullptr, nullptr,
+                      nullptr);
+    break;
+  case LogRecordType::ROLLBACKDELETE:
+    page->MarkDelete(rid, nullptr, nullptr, nullptr);
+    break;
+  case LogRecordType::UPDATE:
+    page->UpdateTuple(log_record.old_tuple_, tuple, rid, nullptr, nullptr,
+                      nullptr);
+    break;
+  case LogRecordType::UPDATEDELTA: {
+    Tuple old_tuple;
+    if (page->GetTuple(rid, tuple, nullptr, nullptr) &&
+        log_record.ApplyDelta(tuple, old_tuple, false)) {
+      page->UpdateTuple(old_tuple, tuple, rid, nullptr, nullptr, nullptr);
+    }
+    break;
+  }
+  default:
+    break;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
+}
+
+void LogRecovery::StartWorkers() {
+  if (num_workers_ <= 1 || !workers_.empty()) {
+    return;
+  }
+  for (size_t i = 0; i < num_workers_; ++i) {
+    workers_.emplace_back(new RecoveryWorker());
+    RecoveryWorker *worker = workers_.back().get();
+    worker->done_ = false;
+    worker->thread_ = std::thread(&LogRecovery::RunWorker, this, worker);
+  }
+}
+
+void LogRecovery::StopWorkers() {
+  for (auto &worker : workers_) {
+    {
+      std::lock_guard<std::mutex> guard(worker->latch_);
+      worker->done_ = true;
+    }
+    worker->cv_.notify_all();
+  }
+  for (auto &worker : workers_) {
+    worker->thread_.join();
+  }
+  workers_.clear();
+}
+
+/*
+ * The queue is bounded, a reader far ahead of a worker waits for it
+ */
+void LogRecovery::Submit(size_t worker_id, std::function<void()> task) {
+  RecoveryWorker *worker = workers_[worker_id].get();
+  std::unique_lock<std::mutex> lock(worker->latch_);
+  worker->cv_.wait(lock, [worker] {
+    return worker->tasks_.size() < RECOVERY_QUEUE_DEPTH;
+  });
+  worker->tasks_.push_back(std::move(task));
+  lock.unlock();
+  worker->cv_.notify_all();
+}
+
+void LogRecovery::RunWorker(RecoveryWorker *worker) {
+  std::unique_lock<std::mutex> lock(worker->latch_);
+  while (true) {
+    worker->cv_.wait(lock,
+                     [worker] { return worker->done_ || !worker->tasks_.empty(); });
+    if (worker->tasks_.empty()) {
+      return;
+    }
+    std::function<void()> task = std::move(worker->tasks_.front());
+    worker->tasks_.pop_front();
+    lock.unlock();
+    worker->cv_.notify_all();
+    task();
+    lock.lock();
+  }
+}
 
 } // namespace cmudb
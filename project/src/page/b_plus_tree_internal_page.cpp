@@ -6,6 +6,7 @@
 
 #include "common/exception.h"
 #include "page/b_plus_tree_internal_page.h"
+#include "page/key_search.h"
 
 namespace cmudb
 {
@@ -19,12 +20,15 @@ namespace cmudb
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id,
-                                          page_id_t parent_id)
+                                          page_id_t parent_id,
+                                          size_t page_size)
 {
-  int max_size = (PAGE_SIZE - sizeof(BPlusTreeInternalPage)) / sizeof(MappingType);
+  int max_size =
+      (page_size - sizeof(BPlusTreeInternalPage)) / sizeof(MappingType);
   SetPageType(IndexPageType::INTERNAL_PAGE);
   // first key is valid
   SetSize(0);
+  SetPrefixSize(0);
   SetMaxSize(max_size);
   SetPageId(page_id);
   SetParentPageId(parent_id);
@@ -38,70 +42,36 @@ KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const
 {
   // replace with your own code
   assert(0 <= index && index < GetSize());
-  KeyType key = array[index].first;
-  return key;
+  return Prefix::KeyAt(Data(), GetPrefixSize(), index);
 }
 
+/*
+ * key is in the key range of the page, it has the prefix
+ */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key)
 {
   assert(0 <= index && index < GetSize());
-  array[index].first = key;
+  Prefix::SetKeyAt(Data(), GetPrefixSize(), index, key);
 }
 
 /*
  * Helper method to find and return array index(or offset), so that its value
  * equals to input "value"
  */
-INDEX_TEMPLATE_ARGUMENTS
-int BinarySearch(const MappingType *array, size_t size,
-                 const KeyType &key, const KeyComparator &cmp)
-{
-  size_t start = 1, end = size - 1, middle = 0;
-
-  while (start < end)
-  {
-    middle = start + ((end - start) >> 1);
-    if (cmp(array[middle].first, key) < 0)
-    {
-      start = middle + 1;
-    }
-    else if (cmp(array[middle].first, key) > 0)
-    {
-      end = middle;
-    }
-    else
-    {
-      start = middle;
-      break;
-    }
-  }
-  return start;
-}
-
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const
 {
+  // children are ordered by key, not by page id
   int size = GetSize();
-  int start = 0, end = size - 1, middle = 0;
-
-  while (start <= end)
+  for (int i = 0; i < size; i++)
   {
-    middle = start + ((end - start) >> 1);
-    if (array[middle].second > value)
+    if (ValueAt(i) == value)
     {
-      end = middle - 1;
-    }
-    else if (array[middle].second < value)
-    {
-      start = middle + 1;
-    }
-    else
-    {
-      break;
+      return i;
     }
   }
-  return start <= end ? middle : -1;
+  return -1;
 }
 
 /*
@@ -112,12 +82,104 @@ INDEX_TEMPLATE_ARGUMENTS
 ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const
 {
   assert(0 <= index && index <= GetSize());
-  return array[index].second;
+  return Prefix::ValueAt(Data(), GetPrefixSize(), index);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index,
+                                                const ValueType &value)
+{
+  Prefix::SetValueAt(Data(), GetPrefixSize(), index, value);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetEntrySize() const
+{
+  return Prefix::EntrySize(GetPrefixSize());
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::EntryAt(int index) const
+{
+  return Prefix::EntryAt(Data(), GetPrefixSize(), index);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::EntryAt(int index)
+{
+  return Prefix::EntryAt(Data(), GetPrefixSize(), index);
+}
+
+/*****************************************************************************
+ * KEY PREFIX
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetPrefix(const KeyType &key,
+                                               int prefix_size,
+                                               size_t page_size)
+{
+  int max_size =
+      Prefix::MaxSize(page_size - sizeof(BPlusTreeInternalPage), prefix_size);
+  assert(GetSize() <= max_size);
+  Prefix::Relayout(Data(), GetSize(), GetPrefixSize(), key, prefix_size);
+  SetPrefixSize(prefix_size);
+  SetMaxSize(max_size);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::SharedMaxSize(
+    const BPlusTreeInternalPage *other, size_t page_size) const
+{
+  return Prefix::MaxSize(page_size - sizeof(BPlusTreeInternalPage),
+                         SharedPrefixSize(other));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::PrefixKey() const
+{
+  KeyType key;
+  memset(key.data, 0, sizeof(key.data));
+  memcpy(key.data, Data(), GetPrefixSize());
+  return key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::SharedPrefixSize(
+    const BPlusTreeInternalPage *other) const
+{
+  return Prefix::CommonSize(Data(), other->Data(),
+                            std::min(GetPrefixSize(), other->GetPrefixSize()));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::ShareWith(
+    const BPlusTreeInternalPage *other, size_t page_size)
+{
+  int prefix_size = SharedPrefixSize(other);
+  if (prefix_size < GetPrefixSize())
+  {
+    SetPrefix(PrefixKey(), prefix_size, page_size);
+  }
 }
 
 /*****************************************************************************
  * LOOKUP
  *****************************************************************************/
+/*
+ * The last index whose key is <= key, 0 if there is none
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::ChildIndex(
+    const KeyType &key, const KeyComparator &comparator) const
+{
+  if (GetPrefixSize() == 0)
+  {
+    return SearchKeys(array, 1, GetSize(), key, comparator, true) - 1;
+  }
+  return Prefix::SearchKeys(Data(), GetPrefixSize(), 1, GetSize(), key, true) -
+         1;
+}
+
 /*
  * Find and return the child pointer(page_id) which points to the child page
  * that contains input "key"
@@ -128,24 +190,7 @@ ValueType
 B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key,
                                        const KeyComparator &comparator) const
 {
-  ValueType value;
-  int size = GetSize();
-  int left = 1, right = size - 1;
-  if (comparator(key, array[left].first) < 0)
-  {
-    value = array[left - 1].second;
-  }
-  else if (comparator(key, array[right].first) > 0)
-  {
-    value = array[right].second;
-  }
-  else
-  {
-    int index = BinarySearch(array, size, key, comparator);
-    assert(left <= index && index <= right);
-    value = array[index - 1].second;
-  }
-  return value;
+  return ValueAt(ChildIndex(key, comparator));
 }
 
 /*****************************************************************************
@@ -164,11 +209,10 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(
 {
 
   // Init page
-  array[0].second = old_value;
-  array[1] = std::make_pair(new_key, new_value);
-
-  // Increase mount of records
-  IncreaseSize(2);
+  SetSize(2);
+  SetValueAt(0, old_value);
+  SetKeyAt(1, new_key);
+  SetValueAt(1, new_value);
 }
 /*
  * Insert new_key & new_value pair right after the pair with its value ==
@@ -187,19 +231,35 @@ int B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(
   int old_index = ValueIndex(old_value);
 
   int dest_index = old_index + 2, src_index = old_index + 1,
-      num_bytes = (size - src_index) * sizeof(MappingType);
-  memmove(array + dest_index, array + src_index, num_bytes);
-
+      num_bytes = (size - src_index) * GetEntrySize();
+  memmove(EntryAt(dest_index), EntryAt(src_index), num_bytes);
   IncreaseSize(1);
+  SetKeyAt(src_index, new_key);
+  SetValueAt(src_index, new_value);
 
   return size + 1;
 }
 
+/*
+ * Append key & value pair after the last pair, for pages built in key order
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Append(const KeyType &key,
+                                            const ValueType &value)
+{
+  int size = GetSize();
+  assert(size < GetMaxSize());
+  IncreaseSize(1);
+  SetKeyAt(size, key);
+  SetValueAt(size, value);
+}
+
 /*****************************************************************************
  * SPLIT
  *****************************************************************************/
 /*
- * Remove half of key & value pairs from this page to "recipient" page
+ * Remove half of key & value pairs from this page to "recipient" page, which
+ * takes the prefix of this one along
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(
@@ -209,34 +269,25 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(
   int size = GetSize();
   int half = (1 + size) >> 1;
 
-  recipient->CopyHalfFrom(array + size - half, half, buffer_pool_manager);
+  recipient->CopyHalfFrom(this, size - half, half, buffer_pool_manager);
 
   IncreaseSize(-1 * half);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyHalfFrom(
-    MappingType *items, int size, BufferPoolManager *buffer_pool_manager)
+    const BPlusTreeInternalPage *source, int index, int size,
+    BufferPoolManager *buffer_pool_manager)
 {
-  page_id_t page_id = this->GetPageId();
   // Start always = 0
   int start = GetSize();
   assert(start == 0);
-
-  for (int i = 0; i < size; i++)
+  if (source->GetPrefixSize() != GetPrefixSize())
   {
-    // Change parent_id of page
-    Page *page = buffer_pool_manager->FetchPage(items[i].second);
-    BPlusTreeInternalPage *btree_internal_page =
-        reinterpret_cast<BPlusTreeInternalPage *>(page->GetData());
-    btree_internal_page->SetParentPageId(page_id);
-
-    // Unpin the page and set it dirty
-    buffer_pool_manager->UnpinPage(btree_internal_page->GetPageId(), true);
-
-    array[i + start] = items[i];
+    SetPrefix(source->PrefixKey(), source->GetPrefixSize(),
+              buffer_pool_manager->GetPageSize());
   }
-
+  memcpy(EntryAt(0), source->EntryAt(index), size * GetEntrySize());
   IncreaseSize(size);
 }
 
@@ -252,7 +303,9 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index)
 {
   int size = GetSize();
-  memmove(array + index, array + index + 1, (size - index - 1) * sizeof(MappingType));
+  int entry_size = GetEntrySize();
+  char *entry = EntryAt(index);
+  memmove(entry, entry + entry_size, (size - index - 1) * entry_size);
   IncreaseSize(-1);
 }
 
@@ -263,16 +316,20 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index)
 INDEX_TEMPLATE_ARGUMENTS
 ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild()
 {
-  IncreaseSize(-1);
-  return array[1].second;
+  assert(GetSize() == 1);
+  ValueType child = ValueAt(0);
+  SetSize(0);
+  return child;
 }
 
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
 /*
- * Remove all of key & value pairs from this page to "recipient" page, then
- * update relavent key & value pair in its parent page.
+ * Remove all of key & value pairs from this page to "recipient" page. The
+ * separating key in the parent becomes the first key, the caller removes it
+ * from the parent. The recipient keeps the prefix the two share, it has to
+ * have room for all
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(
@@ -287,36 +344,35 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(
   BPlusTreeInternalPage *btree_internal_parent_page =
       reinterpret_cast<BPlusTreeInternalPage *>(page->GetData());
   SetKeyAt(0, btree_internal_parent_page->KeyAt(index_in_parent));
-  btree_internal_parent_page->Remove(index_in_parent);
 
-  buffer_pool_manager->UnpinPage(parent_page_id, true);
+  buffer_pool_manager->UnpinPage(parent_page_id, false);
 
-  recipient->CopyAllFrom(array, size, buffer_pool_manager);
+  recipient->CopyAllFrom(this, buffer_pool_manager);
   IncreaseSize(-1 * size);
 }
 
 // Thu function used for merge node
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyAllFrom(
-    MappingType *items, int size, BufferPoolManager *buffer_pool_manager)
+    const BPlusTreeInternalPage *source,
+    BufferPoolManager *buffer_pool_manager)
 {
+  ShareWith(source, buffer_pool_manager->GetPageSize());
   int current_size = GetSize();
+  int size = source->GetSize();
   int max_size = GetMaxSize();
   assert(current_size + size <= max_size);
-  page_id_t page_id = this->GetPageId();
-
+  IncreaseSize(size);
+  if (source->GetPrefixSize() == GetPrefixSize())
+  {
+    memcpy(EntryAt(current_size), source->EntryAt(0), size * GetEntrySize());
+    return;
+  }
   for (int i = 0; i < size; i++)
   {
-    // Change parent_id of page
-    Page *page = buffer_pool_manager->FetchPage(items[i].second);
-    BPlusTreeInternalPage *btree_internal_page =
-        reinterpret_cast<BPlusTreeInternalPage *>(page->GetData());
-    btree_internal_page->SetParentPageId(page_id);
-    // Unpin the page and set it dirty
-    buffer_pool_manager->UnpinPage(page->GetPageId(), true);
-    array[i + current_size] = items[i];
+    SetKeyAt(current_size + i, source->KeyAt(i));
+    SetValueAt(current_size + i, source->ValueAt(i));
   }
-  IncreaseSize(size);
 }
 
 /*****************************************************************************
@@ -342,37 +398,29 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(
 
   // Get the key of index_in_parent
   KeyType key = btree_internal_parent_page->KeyAt(index_in_parent);
-  std::pair<KeyType, ValueType> pair = std::make_pair(key, array[0].second);
+  std::pair<KeyType, ValueType> pair = std::make_pair(key, ValueAt(0));
 
   // update relavent key & value pair in its parent page
-  btree_internal_parent_page->SetKeyAt(index_in_parent, array[1].first);
+  btree_internal_parent_page->SetKeyAt(index_in_parent, KeyAt(1));
   buffer_pool_manager->UnpinPage(parent_id, true);
 
   // Remove the first key & value in array
   Remove(0);
 
+  recipient->ShareWith(this, buffer_pool_manager->GetPageSize());
   recipient->CopyLastFrom(pair, buffer_pool_manager);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(
-    const MappingType &pair, BufferPoolManager *buffer_pool_manager)
+    const MappingType &pair, BufferPoolManager * /* Unused */)
 {
   // Insert into last of thie page
   int current_size = GetSize();
-  array[current_size] = pair;
+  assert(current_size < GetMaxSize());
   IncreaseSize(1);
-
-  page_id_t child_id = pair.second;
-  page_id_t id = GetPageId();
-
-  //
-  Page *child_page = buffer_pool_manager->FetchPage(child_id);
-  BPlusTreeInternalPage *btree_internal_child_page =
-      reinterpret_cast<BPlusTreeInternalPage *>(child_page->GetData());
-  // Change pagrent_page_id of child page
-  btree_internal_child_page->SetParentPageId(id);
-  buffer_pool_manager->UnpinPage(child_id, true);
+  SetKeyAt(current_size, pair.first);
+  SetValueAt(current_size, pair.second);
 }
 
 /*
@@ -385,7 +433,10 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(
     BufferPoolManager *buffer_pool_manager)
 {
   int size = GetSize();
-  std::pair<KeyType, ValueType> last = array[size - 1];
+  std::pair<KeyType, ValueType> last =
+      std::make_pair(KeyAt(size - 1), ValueAt(size - 1));
+  IncreaseSize(-1);
+  recipient->ShareWith(this, buffer_pool_manager->GetPageSize());
   recipient->CopyFirstFrom(last, parent_index, buffer_pool_manager);
 }
 
@@ -394,34 +445,24 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(
     const MappingType &pair, int parent_index,
     BufferPoolManager *buffer_pool_manager)
 {
-  int parent_page_id = GetParentPageId();
-  int page_id = GetPageId();
+  page_id_t parent_page_id = GetParentPageId();
   Page *parent_page = buffer_pool_manager->FetchPage(parent_page_id);
   BPlusTreeInternalPage *btree_internal_parent_page =
       reinterpret_cast<BPlusTreeInternalPage *>(parent_page->GetData());
 
   int size = GetSize();
 
-  // Shoule valid the key of first index
-  // KeyType key_of_first_index = btree_internal_parent_page->KeyAt(parent_index);
-  // array[0].first = key_of_first_index;
-
-  // Insert pair into first index of the page
-  memmove(array + 1, array, size * sizeof(MappingType));
-  array[0] = pair;
+  // Insert pair into first index of the page, the separating key of the
+  // parent comes down to the old first child
+  assert(size < GetMaxSize());
+  memmove(EntryAt(1), EntryAt(0), size * GetEntrySize());
   IncreaseSize(1);
+  SetValueAt(0, pair.second);
+  SetKeyAt(1, btree_internal_parent_page->KeyAt(parent_index));
 
   // Update the key of parent_page
   btree_internal_parent_page->SetKeyAt(parent_index, pair.first);
   buffer_pool_manager->UnpinPage(parent_page_id, true);
-
-  // Update the parent_page_id of child_page
-  Page *child_page = buffer_pool_manager->FetchPage(pair.second);
-  BPlusTreeInternalPage *btree_internal_child_page =
-      reinterpret_cast<BPlusTreeInternalPage *>(child_page->GetData());
-  page_id_t child_page_id = child_page->GetPageId();
-  btree_internal_child_page->SetParentPageId(page_id);
-  buffer_pool_manager->UnpinPage(child_page_id, true);
 }
 
 /*****************************************************************************
@@ -434,7 +475,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::QueueUpChildren(
 {
   for (int i = 0; i < GetSize(); i++)
   {
-    auto *page = buffer_pool_manager->FetchPage(array[i].second);
+    auto *page = buffer_pool_manager->FetchPage(ValueAt(i));
     if (page == nullptr)
       throw Exception(EXCEPTION_TYPE_INDEX,
                       "all page are pinned while printing");
@@ -471,10 +512,10 @@ std::string B_PLUS_TREE_INTERNAL_PAGE_TYPE::ToString(bool verbose) const
     {
       os << " ";
     }
-    os << std::dec << array[entry].first.ToString();
+    os << std::dec << KeyAt(entry).ToString();
     if (verbose)
     {
-      os << "(" << array[entry].second << ")";
+      os << "(" << ValueAt(entry) << ")";
     }
     ++entry;
   }
@@ -492,4 +533,14 @@ template class BPlusTreeInternalPage<GenericKey<32>, page_id_t,
                                      GenericComparator<32>>;
 template class BPlusTreeInternalPage<GenericKey<64>, page_id_t,
                                      GenericComparator<64>>;
+template class BPlusTreeInternalPage<GenericKey<4>, page_id_t,
+                                     IntegerComparator<4>>;
+template class BPlusTreeInternalPage<GenericKey<8>, page_id_t,
+                                     IntegerComparator<8>>;
+template class BPlusTreeInternalPage<GenericKey<16>, page_id_t,
+                                     BytesComparator<16>>;
+template class BPlusTreeInternalPage<GenericKey<32>, page_id_t,
+                                     BytesComparator<32>>;
+template class BPlusTreeInternalPage<GenericKey<64>, page_id_t,
+                                     BytesComparator<64>>;
 } // namespace cmudb
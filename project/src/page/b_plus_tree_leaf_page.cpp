@@ -6,8 +6,9 @@
 
 #include "common/exception.h"
 #include "common/rid.h"
-#include "page/b_plus_tree_leaf_page.h"
 #include "page/b_plus_tree_internal_page.h"
+#include "page/b_plus_tree_leaf_page.h"
+#include "page/key_search.h"
 
 namespace cmudb {
 
@@ -21,16 +22,19 @@ namespace cmudb {
  * next page id and set max size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id)
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id,
+                                      size_t page_size)
 {
-  int max_size = (PAGE_SIZE - sizeof(BPlusTreeLeafPage)) / sizeof(MappingType);
+  int max_size = (page_size - sizeof(BPlusTreeLeafPage)) / sizeof(MappingType);
   SetPageType(IndexPageType::LEAF_PAGE);
   // first key is valid
   SetSize(0);
+  SetPrefixSize(0);
   SetMaxSize(max_size);
   SetPageId(page_id);
   SetParentPageId(parent_id);
   SetNextPageId(INVALID_PAGE_ID);
+  SetPrevPageId(INVALID_PAGE_ID);
 }
 
 /**
@@ -48,42 +52,52 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id)
   next_page_id_ = next_page_id;
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t B_PLUS_TREE_LEAF_PAGE_TYPE::GetPrevPageId() const
+{
+  return prev_page_id_;
+}
 
-/**
- * Helper method to find the first index i so that array[i].first >= key
- * NOTE: This method is only used when generating index iterator
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetPrevPageId(page_id_t prev_page_id)
+{
+  prev_page_id_ = prev_page_id;
+}
+
+/*
+ * The next page is not latched, see the file comment; it cannot go away
+ * while this page is write latched, only a merge into this one deletes it.
+ * Left alone if the page cannot be fetched, it is only a hint
  */
 INDEX_TEMPLATE_ARGUMENTS
-int BinarySearch(const MappingType *array, size_t size,
-                 const KeyType &key, const KeyComparator &cmp)
+void B_PLUS_TREE_LEAF_PAGE_TYPE::LinkNext(
+    BufferPoolManager *buffer_pool_manager)
 {
-  size_t start = 1, end = size - 1, middle = 0;
-
-  while (start < end)
-  {
-    middle = start + ((end - start) >> 1);
-    if (cmp(array[middle].first, key) < 0)
-    {
-      start = middle + 1;
-    }
-    else if (cmp(array[middle].first, key) > 0)
-    {
-      end = middle;
-    }
-    else
-    {
-      start = middle;
-      break;
-    }
+  if (next_page_id_ == INVALID_PAGE_ID) {
+    return;
+  }
+  Page *page = buffer_pool_manager->FetchPage(next_page_id_);
+  if (page == nullptr) {
+    return;
   }
-  return start;
+  reinterpret_cast<BPlusTreeLeafPage *>(page->GetData())
+      ->SetPrevPageId(GetPageId());
+  buffer_pool_manager->UnpinPage(next_page_id_, true);
 }
 
+
+/**
+ * Helper method to find the first index i so that array[i].first >= key
+ * NOTE: This method is only used when generating index iterator
+ */
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(
     const KeyType &key, const KeyComparator &comparator) const {
-  int size = GetSize();
-  return BinarySearch(array, size, key, comparator);
+  if (GetPrefixSize() == 0) {
+    return SearchKeys(array, 0, GetSize(), key, comparator, false);
+  }
+  return Prefix::SearchKeys(Data(), GetPrefixSize(), 0, GetSize(), key,
+                            false);
 }
 
 /*
@@ -94,8 +108,7 @@ INDEX_TEMPLATE_ARGUMENTS
 KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const {
   // replace with your own code
   assert(0 <= index && index < GetSize());
-  KeyType key = array[index].first;
-  return key;
+  return Prefix::KeyAt(Data(), GetPrefixSize(), index);
 }
 
 /*
@@ -103,11 +116,90 @@ KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const {
  * "index"(a.k.a array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) {
-  // replace with your own code
-  int size = GetSize();
-  assert(index < size);
-  return array[index];
+MappingType B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) const {
+  return std::make_pair(KeyAt(index), ValueAt(index));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+ValueType B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const {
+  assert(0 <= index && index < GetSize());
+  return Prefix::ValueAt(Data(), GetPrefixSize(), index);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetValueAt(int index,
+                                            const ValueType &value) {
+  assert(0 <= index && index < GetSize());
+  Prefix::SetValueAt(Data(), GetPrefixSize(), index, value);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const char *B_PLUS_TREE_LEAF_PAGE_TYPE::EntryAt(int index) const {
+  return Prefix::EntryAt(Data(), GetPrefixSize(), index);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+char *B_PLUS_TREE_LEAF_PAGE_TYPE::EntryAt(int index) {
+  return Prefix::EntryAt(Data(), GetPrefixSize(), index);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::GetEntrySize() const {
+  return Prefix::EntrySize(GetPrefixSize());
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetEntry(int index, const KeyType &key,
+                                          const ValueType &value) {
+  Prefix::SetKeyAt(Data(), GetPrefixSize(), index, key);
+  Prefix::SetValueAt(Data(), GetPrefixSize(), index, value);
+}
+
+/*****************************************************************************
+ * KEY PREFIX
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetPrefix(const KeyType &key,
+                                           int prefix_size,
+                                           size_t page_size) {
+  int max_size =
+      Prefix::MaxSize(page_size - sizeof(BPlusTreeLeafPage), prefix_size);
+  assert(GetSize() <= max_size);
+  Prefix::Relayout(Data(), GetSize(), GetPrefixSize(), key, prefix_size);
+  SetPrefixSize(prefix_size);
+  SetMaxSize(max_size);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::SharedMaxSize(const BPlusTreeLeafPage *other,
+                                              size_t page_size) const {
+  return Prefix::MaxSize(page_size - sizeof(BPlusTreeLeafPage),
+                         SharedPrefixSize(other));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::PrefixKey() const {
+  KeyType key;
+  memset(key.data, 0, sizeof(key.data));
+  memcpy(key.data, Data(), GetPrefixSize());
+  return key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::SharedPrefixSize(
+    const BPlusTreeLeafPage *other) const {
+  return Prefix::CommonSize(Data(), other->Data(),
+                            std::min(GetPrefixSize(),
+                                     other->GetPrefixSize()));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::ShareWith(const BPlusTreeLeafPage *other,
+                                           size_t page_size) {
+  int prefix_size = SharedPrefixSize(other);
+  if (prefix_size < GetPrefixSize()) {
+    SetPrefix(PrefixKey(), prefix_size, page_size);
+  }
 }
 
 /*****************************************************************************
@@ -122,19 +214,12 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key,
                                        const ValueType &value,
                                        const KeyComparator &comparator) {
   int size = GetSize();
-  int insert_index = -1;
-  std::pair<KeyType, ValueType> pair = std::make_pair(key, value);
-
-  if (size == 0 || comparator(key, array[size-1].first) > 0) {
-    insert_index = size;
-  } else if (comparator(key, array[0].first) < 0) {
-    memmove(array+1, array, size*sizeof(MappingType));
-    insert_index = 0;
-  } else {
-    insert_index = KeyIndex(key, comparator);
-    memmove(array+insert_index, array+insert_index+1, (size-insert_index)*sizeof(MappingType));
-  }
-  array[insert_index] = pair;
+  assert(size < GetMaxSize());
+  int insert_index = KeyIndex(key, comparator);
+  int entry_size = GetEntrySize();
+  char *entry = EntryAt(insert_index);
+  memmove(entry + entry_size, entry, (size - insert_index) * entry_size);
+  SetEntry(insert_index, key, value);
   IncreaseSize(1);
   return size+1;
 }
@@ -143,27 +228,34 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key,
  * SPLIT
  *****************************************************************************/
 /*
- * Remove half of key & value pairs from this page to "recipient" page
+ * Remove half of key & value pairs from this page to "recipient" page, which
+ * takes the prefix of this one along
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(
     BPlusTreeLeafPage *recipient,
-    __attribute__((unused)) BufferPoolManager *buffer_pool_manager) 
+    BufferPoolManager *buffer_pool_manager)
 {
   int size = GetSize();
   int half = (1 + size) >> 1;
 
-  recipient->CopyHalfFrom(array + size - half, half);
+  recipient->CopyHalfFrom(this, size - half, half,
+                          buffer_pool_manager->GetPageSize());
 
   IncreaseSize(-1 * half);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyHalfFrom(MappingType *items, int size)
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyHalfFrom(const BPlusTreeLeafPage *source,
+                                              int index, int size,
+                                              size_t page_size)
 {
   int start = GetSize();
   assert(start == 0);
-  memcpy(array+start, items, size*sizeof(MappingType));
+  if (source->GetPrefixSize() != GetPrefixSize()) {
+    SetPrefix(source->PrefixKey(), source->GetPrefixSize(), page_size);
+  }
+  memcpy(EntryAt(0), source->EntryAt(index), size * GetEntrySize());
   IncreaseSize(size);
 }
 
@@ -178,12 +270,11 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyHalfFrom(MappingType *items, int size)
 INDEX_TEMPLATE_ARGUMENTS
 bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType &value,
                                         const KeyComparator &comparator) const {
-  int size = GetSize();
-  int index = BinarySearch(array, size, key, comparator);
-  if (index == -1) {
+  int index = KeyIndex(key, comparator);
+  if (index == GetSize() || comparator(KeyAt(index), key) != 0) {
     return false;
-  } 
-  value = array[index].second;
+  }
+  value = ValueAt(index);
   return true;
 }
 
@@ -200,12 +291,14 @@ INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(
     const KeyType &key, const KeyComparator &comparator) {
   int size = GetSize();
-  int index = BinarySearch(array, size, key, comparator);
-  if (index != -1) {
-    memmove(array+index+1, array+index, (size-index-1)*sizeof(MappingType));
+  int index = KeyIndex(key, comparator);
+  if (index < size && comparator(KeyAt(index), key) == 0) {
+    int entry_size = GetEntrySize();
+    char *entry = EntryAt(index);
+    memmove(entry, entry + entry_size, (size - index - 1) * entry_size);
     IncreaseSize(-1);
   }
-  return size;
+  return GetSize();
 }
 
 /*****************************************************************************
@@ -213,23 +306,35 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(
  *****************************************************************************/
 /*
  * Remove all of key & value pairs from this page to "recipient" page, then
- * update next page id
+ * update next page id, and the previous page id of the page after. The
+ * recipient keeps the prefix the two share, it has to have room for all
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient,
-                                           int, BufferPoolManager *)
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(
+    BPlusTreeLeafPage *recipient, int, BufferPoolManager *buffer_pool_manager)
 {
   int size = GetSize();
-  recipient->CopyAllFrom(array, size);
+  recipient->CopyAllFrom(this, buffer_pool_manager->GetPageSize());
   recipient->SetNextPageId(GetNextPageId());
+  recipient->LinkNext(buffer_pool_manager);
   IncreaseSize(-1*size);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyAllFrom(MappingType *items, int size)
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyAllFrom(const BPlusTreeLeafPage *source,
+                                             size_t page_size)
 {
+  ShareWith(source, page_size);
   int current_size = GetSize();
-  memcpy(items, array+current_size, size*sizeof(MappingType));
+  int size = source->GetSize();
+  assert(current_size + size <= GetMaxSize());
+  if (source->GetPrefixSize() == GetPrefixSize()) {
+    memcpy(EntryAt(current_size), source->EntryAt(0), size * GetEntrySize());
+  } else {
+    for (int i = 0; i < size; i++) {
+      SetEntry(current_size + i, source->KeyAt(i), source->ValueAt(i));
+    }
+  }
   IncreaseSize(size);
 }
 
@@ -245,9 +350,10 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(
     BPlusTreeLeafPage *recipient,
     BufferPoolManager *buffer_pool_manager)
 {
-  recipient->CopyLastFrom(array[0]);
+  recipient->ShareWith(this, buffer_pool_manager->GetPageSize());
+  recipient->CopyLastFrom(GetItem(0));
   int size = GetSize();
-  memmove(array, array+1, (size-1)*sizeof(MappingType));
+  memmove(EntryAt(0), EntryAt(1), (size - 1) * GetEntrySize());
   IncreaseSize(-1);
 
   page_id_t page_id = GetPageId();
@@ -256,7 +362,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(
   BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *btree_internal_parent_page =
         reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>*>(parent_page->GetData());
   int index_in_parent = btree_internal_parent_page->ValueIndex(page_id); 
-  btree_internal_parent_page->SetKeyAt(index_in_parent, array[0].first);
+  btree_internal_parent_page->SetKeyAt(index_in_parent, KeyAt(0));
   buffer_pool_manager->UnpinPage(parent_page_id, true);
 }
 
@@ -264,7 +370,8 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item)
 {
   int size = GetSize();
-  array[size] = item;
+  assert(size < GetMaxSize());
+  SetEntry(size, item.first, item.second);
   IncreaseSize(1);
 }
 /*
@@ -277,7 +384,9 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(
     BufferPoolManager *buffer_pool_manager)
 {
   int size = GetSize();
-  recipient->CopyFirstFrom(array[size-1], parentIndex, buffer_pool_manager);
+  recipient->ShareWith(this, buffer_pool_manager->GetPageSize());
+  recipient->CopyFirstFrom(GetItem(size - 1), parentIndex,
+                           buffer_pool_manager);
   IncreaseSize(-1);
 }
 
@@ -287,15 +396,16 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(
     BufferPoolManager *buffer_pool_manager)
 {
   int size = GetSize();
-  memmove(array+1, array, size*sizeof(MappingType));
+  assert(size < GetMaxSize());
+  memmove(EntryAt(1), EntryAt(0), size * GetEntrySize());
   IncreaseSize(1);
-  array[0] = item;
+  SetEntry(0, item.first, item.second);
 
   page_id_t parent_page_id = GetParentPageId();
   Page* parent_page = buffer_pool_manager->FetchPage(parent_page_id);
   BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *btree_internal_parent_page =
         reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>*>(parent_page->GetData());
-  btree_internal_parent_page->SetKeyAt(parentIndex, array[0].first);
+  btree_internal_parent_page->SetKeyAt(parentIndex, item.first);
   buffer_pool_manager->UnpinPage(parent_page_id, true);
 }
 
@@ -322,9 +432,9 @@ std::string B_PLUS_TREE_LEAF_PAGE_TYPE::ToString(bool verbose) const {
     } else {
       stream << " ";
     }
-    stream << std::dec << array[entry].first;
+    stream << std::dec << KeyAt(entry);
     if (verbose) {
-      stream << "(" << array[entry].second << ")";
+      stream << "(" << ValueAt(entry) << ")";
     }
     ++entry;
   }
@@ -341,4 +451,14 @@ template class BPlusTreeLeafPage<GenericKey<32>, RID,
                                        GenericComparator<32>>;
 template class BPlusTreeLeafPage<GenericKey<64>, RID,
                                        GenericComparator<64>>;
+template class BPlusTreeLeafPage<GenericKey<4>, RID,
+                                       IntegerComparator<4>>;
+template class BPlusTreeLeafPage<GenericKey<8>, RID,
+                                       IntegerComparator<8>>;
+template class BPlusTreeLeafPage<GenericKey<16>, RID,
+                                       BytesComparator<16>>;
+template class BPlusTreeLeafPage<GenericKey<32>, RID,
+                                       BytesComparator<32>>;
+template class BPlusTreeLeafPage<GenericKey<64>, RID,
+                                       BytesComparator<64>>;
 } // namespace cmudb
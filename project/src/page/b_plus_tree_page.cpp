@@ -1,6 +1,8 @@
 /**
  * b_plus_tree_page.cpp
  */
+#include <cstddef>
+
 #include "page/b_plus_tree_page.h"
 
 namespace cmudb {
@@ -10,7 +12,7 @@ namespace cmudb {
  * Page type enum class is defined in b_plus_tree_page.h
  */
 bool BPlusTreePage::IsLeafPage() const { return page_type_ == IndexPageType::LEAF_PAGE; }
-bool BPlusTreePage::IsRootPage() const { return page_type_ == IndexPageType::INTERNAL_PAGE; }
+bool BPlusTreePage::IsRootPage() const { return parent_page_id_ == INVALID_PAGE_ID; }
 void BPlusTreePage::SetPageType(IndexPageType page_type) { page_type_ = page_type; }
 
 /*
@@ -37,7 +39,12 @@ int BPlusTreePage::GetMinSize() const { return max_size_ / 2; }
  * Helper methods to get/set parent page id
  */
 page_id_t BPlusTreePage::GetParentPageId() const { return parent_page_id_; }
-void BPlusTreePage::SetParentPageId(page_id_t parent_page_id) { parent_page_id_ = parent_page_id; }
+void BPlusTreePage::SetParentPageId(page_id_t parent_page_id) {
+  static_assert(offsetof(BPlusTreePage, parent_page_id_) ==
+                    PARENT_PAGE_ID_OFFSET,
+                "parent page id moved");
+  parent_page_id_ = parent_page_id;
+}
 
 /*
  * Helper methods to get/set self page id
@@ -50,4 +57,9 @@ void BPlusTreePage::SetPageId(page_id_t page_id) { page_id_ = page_id; }
  */
 void BPlusTreePage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
 
+int BPlusTreePage::GetPrefixSize() const { return prefix_size_; }
+void BPlusTreePage::SetPrefixSize(int prefix_size) {
+  prefix_size_ = prefix_size;
+}
+
 } // namespace cmudb
@@ -0,0 +1,67 @@
+/**
+ * b_plus_tree_posting_page.cpp
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "page/b_plus_tree_posting_page.h"
+
+namespace cmudb {
+
+void BPlusTreePostingPage::Init(page_id_t page_id, size_t page_size) {
+  page_id_ = page_id;
+  lsn_ = INVALID_LSN;
+  size_ = 0;
+  max_size_ = static_cast<int>((page_size - sizeof(BPlusTreePostingPage)) /
+                               sizeof(RID));
+  next_page_id_ = INVALID_PAGE_ID;
+}
+
+int BPlusTreePostingPage::RidIndex(const RID &rid) const {
+  int low = 0;
+  int high = size_;
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (Less(array_[mid], rid)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+bool BPlusTreePostingPage::Insert(const RID &rid) {
+  int index = RidIndex(rid);
+  if (index < size_ && array_[index] == rid) {
+    return false;
+  }
+  assert(!IsFull());
+  memmove(array_ + index + 1, array_ + index, (size_ - index) * sizeof(RID));
+  array_[index] = rid;
+  size_++;
+  return true;
+}
+
+bool BPlusTreePostingPage::Remove(const RID &rid) {
+  int index = RidIndex(rid);
+  if (index == size_ || !(array_[index] == rid)) {
+    return false;
+  }
+  memmove(array_ + index, array_ + index + 1,
+          (size_ - index - 1) * sizeof(RID));
+  size_--;
+  return true;
+}
+
+void BPlusTreePostingPage::MoveHalfTo(BPlusTreePostingPage *recipient) {
+  int keep = size_ / 2;
+  memcpy(recipient->array_, array_ + keep, (size_ - keep) * sizeof(RID));
+  recipient->size_ = size_ - keep;
+  size_ = keep;
+  recipient->next_page_id_ = next_page_id_;
+  next_page_id_ = recipient->page_id_;
+}
+
+} // namespace cmudb
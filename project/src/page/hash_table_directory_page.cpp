@@ -0,0 +1,89 @@
+/**
+ * hash_table_directory_page.cpp
+ */
+
+#include <cassert>
+
+#include "page/hash_table_directory_page.h"
+
+namespace cmudb {
+
+/*
+ * The slot arrays take 5 bytes per slot, MaxDepth is the most the page
+ * holds
+ */
+void HashTableDirectoryPage::Init(page_id_t page_id, page_id_t bucket_page_id,
+                                  size_t page_size) {
+  page_id_ = page_id;
+  lsn_ = INVALID_LSN;
+  global_depth_ = 0;
+  max_depth_ = 0;
+  size_t slot_bytes = page_size - sizeof(HashTableDirectoryPage);
+  while ((static_cast<size_t>(2) << max_depth_) *
+             (sizeof(page_id_t) + sizeof(uint8_t)) <=
+         slot_bytes) {
+    ++max_depth_;
+  }
+  SetBucketPageId(0, bucket_page_id);
+  SetLocalDepth(0, 0);
+}
+
+page_id_t *HashTableDirectoryPage::BucketPageIds() const {
+  return reinterpret_cast<page_id_t *>(const_cast<char *>(slots_));
+}
+
+uint8_t *HashTableDirectoryPage::LocalDepths() const {
+  return reinterpret_cast<uint8_t *>(const_cast<char *>(slots_)) +
+         (sizeof(page_id_t) << max_depth_);
+}
+
+page_id_t HashTableDirectoryPage::GetBucketPageId(size_t slot) const {
+  assert(slot < Size());
+  return BucketPageIds()[slot];
+}
+
+void HashTableDirectoryPage::SetBucketPageId(size_t slot,
+                                             page_id_t bucket_page_id) {
+  assert(slot < Size());
+  BucketPageIds()[slot] = bucket_page_id;
+}
+
+uint32_t HashTableDirectoryPage::GetLocalDepth(size_t slot) const {
+  assert(slot < Size());
+  return LocalDepths()[slot];
+}
+
+void HashTableDirectoryPage::SetLocalDepth(size_t slot, uint32_t local_depth) {
+  assert(slot < Size() && local_depth <= global_depth_);
+  LocalDepths()[slot] = static_cast<uint8_t>(local_depth);
+}
+
+void HashTableDirectoryPage::Grow() {
+  assert(CanGrow());
+  size_t size = Size();
+  page_id_t *page_ids = BucketPageIds();
+  uint8_t *local_depths = LocalDepths();
+  for (size_t i = 0; i < size; i++) {
+    page_ids[size + i] = page_ids[i];
+    local_depths[size + i] = local_depths[i];
+  }
+  ++global_depth_;
+}
+
+bool HashTableDirectoryPage::CanShrink() const {
+  if (global_depth_ == 0) {
+    return false;
+  }
+  for (size_t i = 0; i < Size(); i++) {
+    if (LocalDepths()[i] >= global_depth_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void HashTableDirectoryPage::Shrink() {
+  assert(CanShrink());
+  --global_depth_;
+}
+} // namespace cmudb
@@ -3,6 +3,7 @@
  */
 #include <cassert>
 #include <iostream>
+#include <utility>
 
 #include "page/header_page.h"
 
@@ -17,10 +18,13 @@ bool HeaderPage::InsertRecord(const std::string &name,
   assert(root_id > INVALID_PAGE_ID);
 
   int record_num = GetRecordCount();
-  int offset = 4 + record_num * 36;
+  int offset = RECORDS_OFFSET + record_num * RECORD_SIZE;
   // check for duplicate name
   if (FindRecord(name) != -1)
     return false;
+  // header page is full
+  if (offset + RECORD_SIZE > static_cast<int>(GetPageSize()))
+    return false;
   // copy record content
   memcpy(GetData() + offset, name.c_str(), (name.length() + 1));
   memcpy((GetData() + offset + 32), &root_id, 4);
@@ -37,9 +41,9 @@ bool HeaderPage::DeleteRecord(const std::string &name) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
-  memmove(GetData() + offset, GetData() + offset + 36,
-          (record_num - index - 1) * 36);
+  int offset = index * RECORD_SIZE + RECORDS_OFFSET;
+  memmove(GetData() + offset, GetData() + offset + RECORD_SIZE,
+          (record_num - index - 1) * RECORD_SIZE);
 
   SetRecordCount(record_num - 1);
   return true;
@@ -53,7 +57,7 @@ bool HeaderPage::UpdateRecord(const std::string &name,
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
+  int offset = index * RECORD_SIZE + RECORDS_OFFSET;
   // update record content, only root_id
   memcpy((GetData() + offset + 32), &root_id, 4);
 
@@ -67,27 +71,80 @@ bool HeaderPage::GetRootId(const std::string &name, page_id_t &root_id) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = (index + 1) * 36;
+  int offset = index * RECORD_SIZE + RECORDS_OFFSET + 32;
   root_id = *reinterpret_cast<page_id_t *>(GetData() + offset);
 
   return true;
 }
 
+bool HeaderPage::GetRootId(const char *data, size_t page_size,
+                           const std::string &name, page_id_t &root_id) {
+  assert(name.length() < 32);
+  int record_num;
+  memcpy(&record_num, data + RECORD_COUNT_OFFSET, sizeof(record_num));
+  for (int i = 0; i < record_num; i++) {
+    size_t offset = RECORDS_OFFSET + i * RECORD_SIZE;
+    // not a header page, or a torn one
+    if (offset + RECORD_SIZE > page_size)
+      return false;
+    if (strncmp(data + offset, name.c_str(), 32) == 0) {
+      memcpy(&root_id, data + offset + 32, sizeof(root_id));
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HeaderPage::SetWideRecord(const std::string &name, int64_t value) {
+  assert(value >= 0 && value >> 62 == 0);
+  std::pair<std::string, page_id_t> halves[] = {
+      {name, static_cast<page_id_t>(value & 0x7FFFFFFF)},
+      {name + "_hi", static_cast<page_id_t>(value >> 31)}};
+  for (auto &half : halves) {
+    if (!InsertRecord(half.first, half.second) &&
+        !UpdateRecord(half.first, half.second))
+      return false;
+  }
+  return true;
+}
+
+bool HeaderPage::GetWideRecord(const std::string &name, int64_t &value) {
+  page_id_t low, high = 0;
+  if (!GetRootId(name, low))
+    return false;
+  GetRootId(name + "_hi", high);
+  value = static_cast<int64_t>(high) << 31 | low;
+  return true;
+}
+
 /**
  * helper functions
  */
 // record count
-int HeaderPage::GetRecordCount() { return *reinterpret_cast<int *>(GetData()); }
+int HeaderPage::GetRecordCount() {
+  return *reinterpret_cast<int *>(GetData() + RECORD_COUNT_OFFSET);
+}
 
 void HeaderPage::SetRecordCount(int record_count) {
-  memcpy(GetData(), &record_count, 4);
+  memcpy(GetData() + RECORD_COUNT_OFFSET, &record_count, 4);
+}
+
+// page size
+size_t HeaderPage::GetRecordedPageSize() {
+  return *reinterpret_cast<int32_t *>(GetData());
+}
+
+void HeaderPage::SetPageSize(size_t page_size) {
+  int32_t recorded_page_size = static_cast<int32_t>(page_size);
+  memcpy(GetData(), &recorded_page_size, 4);
 }
 
 int HeaderPage::FindRecord(const std::string &name) {
   int record_num = GetRecordCount();
 
   for (int i = 0; i < record_num; i++) {
-    char *raw_name = reinterpret_cast<char *>(GetData() + (4 + i * 36));
+    char *raw_name =
+        reinterpret_cast<char *>(GetData() + (RECORDS_OFFSET + i * RECORD_SIZE));
     if (strcmp(raw_name, name.c_str()) == 0)
       return i;
   }
@@ -0,0 +1,190 @@
+/**
+ * slotted_tree_page.cpp
+ */
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include "common/rid.h"
+#include "page/slotted_tree_page.h"
+
+namespace cmudb {
+
+template <typename ValueType>
+void SlottedTreePage<ValueType>::Init(page_id_t page_id,
+                                      IndexPageType page_type,
+                                      size_t page_size) {
+  assert(page_size <= UINT16_MAX);
+  page_type_ = page_type;
+  lsn_ = INVALID_LSN;
+  size_ = 0;
+  page_id_ = page_id;
+  next_page_id_ = INVALID_PAGE_ID;
+  page_size_ = static_cast<int>(page_size);
+  heap_offset_ = page_size_;
+  garbage_ = 0;
+}
+
+template <typename ValueType>
+VarKey SlottedTreePage<ValueType>::KeyAt(int index) const {
+  assert(index >= 0 && index < size_);
+  return VarKey(reinterpret_cast<const char *>(this) + slots_[index].offset_,
+                slots_[index].size_);
+}
+
+template <typename ValueType>
+ValueType SlottedTreePage<ValueType>::ValueAt(int index) const {
+  assert(index >= 0 && index < size_);
+  return slots_[index].value_;
+}
+
+template <typename ValueType>
+void SlottedTreePage<ValueType>::SetValueAt(int index,
+                                            const ValueType &value) {
+  assert(index >= 0 && index < size_);
+  slots_[index].value_ = value;
+}
+
+template <typename ValueType>
+int SlottedTreePage<ValueType>::KeyIndex(const VarKey &key,
+                                         const VarKeyComparator &comparator,
+                                         bool upper) const {
+  int start = 0;
+  int end = size_;
+  while (start < end) {
+    int middle = start + ((end - start) >> 1);
+    int result = comparator(KeyAt(middle), key);
+    if (result < 0 || (upper && result == 0)) {
+      start = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return start;
+}
+
+template <typename ValueType>
+int SlottedTreePage<ValueType>::ValueIndex(const ValueType &value) const {
+  for (int i = 0; i < size_; i++) {
+    if (slots_[i].value_ == value) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*****************************************************************************
+ * SPACE
+ *****************************************************************************/
+template <typename ValueType>
+int SlottedTreePage<ValueType>::EntrySize(const VarKey &key) {
+  return key.size_ + static_cast<int>(sizeof(Slot));
+}
+
+template <typename ValueType>
+int SlottedTreePage<ValueType>::GetFreeSpace() const {
+  int slots_end = static_cast<int>(sizeof(SlottedTreePage) +
+                                   size_ * sizeof(Slot));
+  return heap_offset_ - slots_end + garbage_;
+}
+
+template <typename ValueType>
+int SlottedTreePage<ValueType>::GetUsedSpace() const {
+  return GetCapacity() - GetFreeSpace();
+}
+
+template <typename ValueType>
+int SlottedTreePage<ValueType>::GetCapacity() const {
+  return page_size_ - static_cast<int>(sizeof(SlottedTreePage));
+}
+
+template <typename ValueType> void SlottedTreePage<ValueType>::Compact() {
+  std::vector<char> heap(reinterpret_cast<char *>(this) + heap_offset_,
+                         reinterpret_cast<char *>(this) + page_size_);
+  int offset = page_size_;
+  for (int i = 0; i < size_; i++) {
+    offset -= slots_[i].size_;
+    memcpy(reinterpret_cast<char *>(this) + offset,
+           heap.data() + slots_[i].offset_ - heap_offset_, slots_[i].size_);
+    slots_[i].offset_ = static_cast<uint16_t>(offset);
+  }
+  heap_offset_ = offset;
+  garbage_ = 0;
+}
+
+/*****************************************************************************
+ * INSERTION AND DELETION
+ *****************************************************************************/
+template <typename ValueType>
+bool SlottedTreePage<ValueType>::InsertAt(int index, const VarKey &key,
+                                          const ValueType &value) {
+  assert(index >= 0 && index <= size_);
+  if (EntrySize(key) > GetFreeSpace()) {
+    return false;
+  }
+  int slots_end = static_cast<int>(sizeof(SlottedTreePage) +
+                                   size_ * sizeof(Slot));
+  if (heap_offset_ - slots_end < EntrySize(key)) {
+    Compact();
+  }
+  heap_offset_ -= key.size_;
+  memcpy(reinterpret_cast<char *>(this) + heap_offset_, key.data_, key.size_);
+  memmove(slots_ + index + 1, slots_ + index, (size_ - index) * sizeof(Slot));
+  slots_[index].offset_ = static_cast<uint16_t>(heap_offset_);
+  slots_[index].size_ = static_cast<uint16_t>(key.size_);
+  slots_[index].value_ = value;
+  size_++;
+  return true;
+}
+
+template <typename ValueType>
+void SlottedTreePage<ValueType>::RemoveAt(int index) {
+  assert(index >= 0 && index < size_);
+  if (slots_[index].offset_ == heap_offset_) {
+    heap_offset_ += slots_[index].size_;
+  } else {
+    garbage_ += slots_[index].size_;
+  }
+  memmove(slots_ + index, slots_ + index + 1,
+          (size_ - index - 1) * sizeof(Slot));
+  size_--;
+  if (size_ == 0) {
+    heap_offset_ = page_size_;
+    garbage_ = 0;
+  }
+}
+
+/*****************************************************************************
+ * SPLIT
+ *****************************************************************************/
+template <typename ValueType>
+int SlottedTreePage<ValueType>::SplitIndex() const {
+  assert(size_ >= 2);
+  int half = GetUsedSpace() / 2;
+  int used = 0;
+  int index = 0;
+  while (index < size_ - 1 && used < half) {
+    used += slots_[index].size_ + static_cast<int>(sizeof(Slot));
+    index++;
+  }
+  return index == 0 ? 1 : index;
+}
+
+template <typename ValueType>
+void SlottedTreePage<ValueType>::MoveTailTo(int index,
+                                            SlottedTreePage *recipient) {
+  for (int i = index; i < size_; i++) {
+    bool inserted = recipient->InsertAt(recipient->GetSize(), KeyAt(i),
+                                        slots_[i].value_);
+    assert(inserted);
+    (void)inserted;
+  }
+  while (size_ > index) {
+    RemoveAt(size_ - 1);
+  }
+}
+
+template class SlottedTreePage<RID>;
+template class SlottedTreePage<page_id_t>;
+
+} // namespace cmudb
@@ -1,8 +1,13 @@
 /**
- * header_page.cpp
+ * table_page.cpp
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+#include <vector>
 
 #include "page/table_page.h"
 
@@ -10,17 +15,41 @@ namespace cmudb {
 /**
  * Header related
  */
+/*
+ * A PAX page keeps PAX_PAYLOAD_SHARE of its space for the payloads if its
+ * tuples have varchars, the rest goes to as many slots as their minipages
+ * leave room for
+ */
 void TablePage::Init(page_id_t page_id, size_t page_size,
                      page_id_t prev_page_id, LogManager *log_manager,
-                     Transaction *txn) {
+                     Transaction *txn,
+                     const std::vector<int32_t> &column_widths) {
   memcpy(GetData(), &page_id, 4); // set page_id
   if (ENABLE_LOGGING) {
-    // TODO: add your logging logic here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::NEWPAGE, prev_page_id, page_id,
+                         column_widths);
+    AppendLog(log_record, txn, log_manager);
   }
   SetPrevPageId(prev_page_id);
   SetNextPageId(INVALID_PAGE_ID);
   SetFreeSpacePointer(page_size);
-  SetTupleCount(0);
+  int32_t tuple_count = 0;
+  if (!column_widths.empty()) {
+    int32_t fixed_size = 0;
+    for (int32_t width : column_widths) {
+      fixed_size += std::abs(width);
+    }
+    int32_t column_count = column_widths.size();
+    int32_t capacity = GetPaxCapacity(column_widths, page_size);
+    assert(capacity > 0);
+    memcpy(GetData() + 28, &capacity, 4);
+    memcpy(GetData() + 32, &fixed_size, 4);
+    memcpy(GetData() + 36, &column_count, 4);
+    memcpy(GetData() + 40, column_widths.data(), 4 * column_count);
+    tuple_count = PAX_FLAG;
+  }
+  memcpy(GetData() + 24, &tuple_count, 4);
 }
 
 page_id_t TablePage::GetPageId() {
@@ -28,71 +57,170 @@ page_id_t TablePage::GetPageId() {
 }
 
 page_id_t TablePage::GetPrevPageId() {
-  return *reinterpret_cast<page_id_t *>(GetData() + 8);
+  return *reinterpret_cast<page_id_t *>(GetData() + 12);
 }
 
 page_id_t TablePage::GetNextPageId() {
-  return *reinterpret_cast<page_id_t *>(GetData() + 12);
+  return *reinterpret_cast<page_id_t *>(GetData() + 16);
 }
 
 void TablePage::SetPrevPageId(page_id_t prev_page_id) {
-  memcpy(GetData() + 8, &prev_page_id, 4);
+  memcpy(GetData() + 12, &prev_page_id, 4);
 }
 
 void TablePage::SetNextPageId(page_id_t next_page_id) {
-  memcpy(GetData() + 12, &next_page_id, 4);
+  memcpy(GetData() + 16, &next_page_id, 4);
+}
+
+std::vector<int32_t> TablePage::GetColumnWidths() {
+  if (!IsPax()) {
+    return std::vector<int32_t>();
+  }
+  auto widths = reinterpret_cast<int32_t *>(GetData() + 40);
+  return std::vector<int32_t>(widths,
+                              widths + *reinterpret_cast<int32_t *>(
+                                           GetData() + 36));
+}
+
+std::vector<int32_t> TablePage::GetPaxLayout(Schema *schema) {
+  std::vector<int32_t> column_widths;
+  for (int i = 0; i < schema->GetColumnCount(); i++) {
+    int32_t width = schema->GetLength(i);
+    column_widths.push_back(schema->IsInlined(i) ? width : -width);
+  }
+  return column_widths;
+}
+
+int32_t TablePage::GetPaxCapacity(const std::vector<int32_t> &column_widths,
+                                  size_t page_size) {
+  int32_t fixed_size = 0;
+  bool varlen = false;
+  for (int32_t width : column_widths) {
+    fixed_size += std::abs(width);
+    varlen = varlen || width < 0;
+  }
+  int32_t column_count = column_widths.size();
+  int32_t space = static_cast<int32_t>(page_size) - 40 - 4 * column_count;
+  if (varlen) {
+    space = static_cast<int32_t>(space * (1 - PAX_PAYLOAD_SHARE));
+  }
+  return std::max(0, space / (fixed_size + 8));
 }
 
 /**
  * Tuple related
  */
 bool TablePage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
-                            LockManager *lock_manager,
-                            LogManager *log_manager) {
+                            LockManager *lock_manager, LogManager *log_manager,
+                            page_id_t table_id) {
   assert(tuple.size_ > 0);
   if (GetFreeSpaceSize() < tuple.size_) {
     return false; // not enough space
   }
 
+  int32_t payload_size = GetPayloadSize(tuple.size_);
+  if (IsPax() && GetPayloadFreeSpaceSize() < payload_size) {
+    return false;
+  }
+  // the exclusive lock before the tuple is in, without waiting under the
+  // latch: a freed slot may still be locked by the transaction that freed it,
+  // and is passed over then. The caller holds the intention locks
+  auto lock_slot = [&](int slot) {
+    rid.Set(GetPageId(), slot);
+    return !ENABLE_LOGGING ||
+           lock_manager->TryLockExclusive(txn, rid.Get(), table_id);
+  };
   // try to reuse a free slot first
   int i;
   for (i = 0; i < GetTupleCount(); ++i) {
-    rid.Set(GetPageId(), i);
-    if (GetTupleSize(i) == 0) { // empty slot
-      if (ENABLE_LOGGING) {
-        assert(txn->GetSharedLockSet()->find(rid) ==
-                   txn->GetSharedLockSet()->end() &&
-               txn->GetExclusiveLockSet()->find(rid) ==
-                   txn->GetExclusiveLockSet()->end());
-      }
+    if (GetTupleSize(i) != 0) {
+      continue;
+    }
+    if (lock_slot(i)) { // empty slot
       break;
     }
+    if (txn->GetState() == TransactionState::ABORTED) {
+      return false;
+    }
   }
 
   // no free slot left
-  if (i == GetTupleCount() && GetFreeSpaceSize() < tuple.size_ + 8) {
-    return false; // not enough space
+  if (i == GetTupleCount() &&
+      (GetFreeSpaceSize() < tuple.size_ + 8 || !lock_slot(i))) {
+    return false; // not enough space, or the lock refused
+  }
+  // the slots of a PAX page are there already
+  if (GetContiguousSpaceSize() <
+      payload_size + (i == GetTupleCount() && !IsPax() ? 8 : 0)) {
+    Compact();
   }
 
   SetFreeSpacePointer(GetFreeSpacePointer() -
-                      tuple.size_); // update free space pointer first
-  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
+                      payload_size); // update free space pointer first
   SetTupleOffset(i, GetFreeSpacePointer());
   SetTupleSize(i, tuple.size_);
+  CopyTupleIn(i, tuple);
   if (i == GetTupleCount()) {
     rid.Set(GetPageId(), i);
     SetTupleCount(GetTupleCount() + 1);
   }
   // write the log after set rid
   if (ENABLE_LOGGING) {
-    // acquire the exclusive lock
-    assert(lock_manager->LockExclusive(txn, rid.Get()));
-    // TODO: add your logging logic here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::INSERT, rid, tuple);
+    AppendLog(log_record, txn, log_manager);
   }
   // LOG_DEBUG("Tuple inserted");
   return true;
 }
 
+/*
+ * Free slots are left to InsertTuple, the tuples of a batch take the slots
+ * after the last one so a single record says where they are
+ */
+size_t TablePage::AppendTuples(const std::vector<Tuple> &tuples,
+                               size_t begin, std::vector<RID> &rids,
+                               Transaction *txn, LockManager *lock_manager,
+                               LogManager *log_manager, page_id_t table_id) {
+  size_t end = begin;
+  int32_t free_space = GetFreeSpaceSize();
+  while (end < tuples.size() && free_space >= tuples[end].size_ + 8 &&
+         (!IsPax() || GetTupleCount() < GetCapacity())) {
+    const Tuple &tuple = tuples[end];
+    assert(tuple.size_ > 0);
+    int32_t payload_size = GetPayloadSize(tuple.size_);
+    // the slots of a PAX page are there already
+    int32_t slot_size = IsPax() ? 0 : 8;
+    int slot = GetTupleCount();
+    // as in InsertTuple, a lock that is not granted at once ends the batch
+    if (ENABLE_LOGGING &&
+        !lock_manager->TryLockExclusive(txn, RID(GetPageId(), slot),
+                                        table_id)) {
+      break;
+    }
+    if (GetContiguousSpaceSize() < payload_size + slot_size) {
+      Compact();
+    }
+    free_space -= payload_size + slot_size;
+    SetFreeSpacePointer(GetFreeSpacePointer() - payload_size);
+    SetTupleOffset(slot, GetFreeSpacePointer());
+    SetTupleSize(slot, tuple.size_);
+    CopyTupleIn(slot, tuple);
+    SetTupleCount(slot + 1);
+    rids.emplace_back(GetPageId(), slot);
+    ++end;
+  }
+  if (ENABLE_LOGGING && end > begin) {
+    size_t first = rids.size() - (end - begin);
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         rids[first],
+                         std::vector<Tuple>(tuples.begin() + begin,
+                                            tuples.begin() + end));
+    AppendLog(log_record, txn, log_manager);
+  }
+  return end - begin;
+}
+
 /*
  * MarkDelete method does not truly delete a tuple from table page
  * Instead it set the tuple as 'deleted' by changing the tuple size metadata to
@@ -100,7 +228,8 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
  *
  */
 bool TablePage::MarkDelete(const RID &rid, Transaction *txn,
-                           LockManager *lock_manager, LogManager *log_manager) {
+                           LockManager *lock_manager, LogManager *log_manager,
+                           page_id_t table_id) {
   int slot_num = rid.GetSlotNum();
   if (slot_num >= GetTupleCount()) {
     if (ENABLE_LOGGING) {
@@ -121,14 +250,23 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn,
     // acquire exclusive lock
     // if has shared lock
     if (txn->GetSharedLockSet()->find(rid) != txn->GetSharedLockSet()->end()) {
-      if (!lock_manager->LockUpgrade(txn, rid))
+      if (!lock_manager->LockUpgrade(txn, rid, table_id))
         return false;
     } else if (txn->GetExclusiveLockSet()->find(rid) ==
                    txn->GetExclusiveLockSet()->end() &&
-               !lock_manager->LockExclusive(txn, rid)) { // no shared lock
+               !lock_manager->LockExclusive(txn, rid,
+                                            table_id)) { // no shared lock
       return false;
     }
-    // TODO: add your logging logic here
+    Tuple delete_tuple;
+    delete_tuple.size_ = tuple_size;
+    delete_tuple.data_ = Tuple::Allocate(delete_tuple.size_);
+    CopyTupleOut(slot_num, delete_tuple.size_, delete_tuple.data_);
+    delete_tuple.rid_ = rid;
+    delete_tuple.allocated_ = true;
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::MARKDELETE, rid, delete_tuple);
+    AppendLog(log_record, txn, log_manager);
   }
 
   // set tuple size to negative value
@@ -139,8 +277,8 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn,
 
 bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
                             const RID &rid, Transaction *txn,
-                            LockManager *lock_manager,
-                            LogManager *log_manager) {
+                            LockManager *lock_manager, LogManager *log_manager,
+                            page_id_t table_id) {
   int slot_num = rid.GetSlotNum();
   if (slot_num >= GetTupleCount()) {
     if (ENABLE_LOGGING) {
@@ -155,19 +293,19 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
     }
     return false;
   }
-  if (GetFreeSpaceSize() < new_tuple.size_ - tuple_size) {
+  // the fixed-size part of a tuple on a PAX page stays where it is
+  if ((IsPax() ? GetPayloadFreeSpaceSize() : GetFreeSpaceSize()) <
+      new_tuple.size_ - tuple_size) {
     // should delete/insert because not enough space
     return false;
   }
 
   // copy out old value
-  int32_t tuple_offset =
-      GetTupleOffset(slot_num); // the tuple offset of the old tuple
   old_tuple.size_ = tuple_size;
   if (old_tuple.allocated_)
-    delete[] old_tuple.data_;
-  old_tuple.data_ = new char[old_tuple.size_];
-  memcpy(old_tuple.data_, GetData() + tuple_offset, old_tuple.size_);
+    Tuple::Free(old_tuple.data_);
+  old_tuple.data_ = Tuple::Allocate(old_tuple.size_);
+  CopyTupleOut(slot_num, old_tuple.size_, old_tuple.data_);
   old_tuple.rid_ = rid;
   old_tuple.allocated_ = true;
 
@@ -175,34 +313,38 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
     // acquire exclusive lock
     // if has shared lock
     if (txn->GetSharedLockSet()->find(rid) != txn->GetSharedLockSet()->end()) {
-      if (!lock_manager->LockUpgrade(txn, rid))
+      if (!lock_manager->LockUpgrade(txn, rid, table_id))
         return false;
     } else if (txn->GetExclusiveLockSet()->find(rid) ==
                    txn->GetExclusiveLockSet()->end() &&
-               !lock_manager->LockExclusive(txn, rid)) { // no shared lock
+               !lock_manager->LockExclusive(txn, rid,
+                                            table_id)) { // no shared lock
       return false;
     }
-    // TODO: add your logging logic here
-  }
-
-  // update
-  int32_t free_space_pointer =
-      GetFreeSpacePointer(); // old pointer to the free space
-  assert(tuple_offset >= free_space_pointer);
-  memmove(GetData() + free_space_pointer + tuple_size - new_tuple.size_,
-          GetData() + free_space_pointer, tuple_offset - free_space_pointer);
-  SetFreeSpacePointer(free_space_pointer + tuple_size - new_tuple.size_);
-  memcpy(GetData() + tuple_offset + tuple_size - new_tuple.size_,
-         new_tuple.data_,
-         new_tuple.size_);                 // copy new tuple
-  SetTupleSize(slot_num, new_tuple.size_); // update tuple size in slot
-  for (int i = 0; i < GetTupleCount();
-       ++i) { // update tuple offsets (including the updated one)
-    int32_t tuple_offset_i = GetTupleOffset(i);
-    if (GetTupleSize(i) > 0 && tuple_offset_i < tuple_offset + tuple_size) {
-      SetTupleOffset(i, tuple_offset_i + tuple_size - new_tuple.size_);
-    }
+    // only the changed bytes are logged, see LogRecordType::UPDATEDELTA
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::UPDATEDELTA, rid, old_tuple,
+                         new_tuple);
+    AppendLog(log_record, txn, log_manager);
+  }
+
+  // update: a tuple that does not grow stays where it is, one that does
+  // goes to the free space and leaves its old bytes dead
+  if (new_tuple.size_ <= tuple_size) {
+    SetTupleSize(slot_num, new_tuple.size_);
+    CopyTupleIn(slot_num, new_tuple);
+    return true;
   }
+  int32_t payload_size = GetPayloadSize(new_tuple.size_);
+  if (GetContiguousSpaceSize() < payload_size) {
+    // the old tuple is copied out, it is squeezed out with the rest
+    SetTupleSize(slot_num, 0);
+    Compact();
+  }
+  SetFreeSpacePointer(GetFreeSpacePointer() - payload_size);
+  SetTupleOffset(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, new_tuple.size_);
+  CopyTupleIn(slot_num, new_tuple);
   return true;
 }
 
@@ -212,7 +354,7 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
  * This function is called when a transaction commits or when you undo insert
  */
 void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
-                            LogManager *log_manager) {
+                            LogManager *log_manager, Tuple *deleted) {
   int slot_num = rid.GetSlotNum();
   assert(slot_num < GetTupleCount());
   // the tuple offset of the deleted tuple
@@ -225,8 +367,8 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
   // copy out delete value, for undo purpose
   Tuple delete_tuple;
   delete_tuple.size_ = tuple_size;
-  delete_tuple.data_ = new char[delete_tuple.size_];
-  memcpy(delete_tuple.data_, GetData() + tuple_offset, delete_tuple.size_);
+  delete_tuple.data_ = Tuple::Allocate(delete_tuple.size_);
+  CopyTupleOut(slot_num, delete_tuple.size_, delete_tuple.data_);
   delete_tuple.rid_ = rid;
   delete_tuple.allocated_ = true;
 
@@ -234,22 +376,21 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
     // must already grab the exclusive lock
     assert(txn->GetExclusiveLockSet()->find(rid) !=
            txn->GetExclusiveLockSet()->end());
-    // TODO: add your logging logic here
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::APPLYDELETE, rid, delete_tuple);
+    AppendLog(log_record, txn, log_manager);
   }
 
-  int32_t free_space_pointer =
-      GetFreeSpacePointer(); // old pointer to the free space
-  assert(tuple_offset >= free_space_pointer);
-  memmove(GetData() + free_space_pointer + tuple_size,
-          GetData() + free_space_pointer, tuple_offset - free_space_pointer);
-  SetFreeSpacePointer(free_space_pointer + tuple_size);
+  // the bytes stay dead until an insert or update needs them, see Compact,
+  // unless they are next to the free space already
+  assert(tuple_offset >= GetFreeSpacePointer());
+  if (tuple_offset == GetFreeSpacePointer()) {
+    SetFreeSpacePointer(tuple_offset + GetPayloadSize(tuple_size));
+  }
   SetTupleSize(slot_num, 0);
   SetTupleOffset(slot_num, 0); // invalid offset
-  for (int i = 0; i < GetTupleCount(); ++i) {
-    int32_t tuple_offset_i = GetTupleOffset(i);
-    if (GetTupleSize(i) != 0 && tuple_offset_i < tuple_offset) {
-      SetTupleOffset(i, tuple_offset_i + tuple_size);
-    }
+  if (deleted != nullptr) {
+    *deleted = delete_tuple;
   }
 }
 
@@ -261,25 +402,49 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
  */
 void TablePage::RollbackDelete(const RID &rid, Transaction *txn,
                                LogManager *log_manager) {
+  int slot_num = rid.GetSlotNum();
+  assert(slot_num < GetTupleCount());
+  int32_t tuple_size = GetTupleSize(slot_num);
+
   if (ENABLE_LOGGING) {
     // must have already grab the exclusive lock
     assert(txn->GetExclusiveLockSet()->find(rid) !=
            txn->GetExclusiveLockSet()->end());
 
-    // TODO: add your logging logic here
+    Tuple delete_tuple;
+    delete_tuple.size_ = tuple_size < 0 ? -tuple_size : tuple_size;
+    delete_tuple.data_ = Tuple::Allocate(delete_tuple.size_);
+    CopyTupleOut(slot_num, delete_tuple.size_, delete_tuple.data_);
+    delete_tuple.rid_ = rid;
+    delete_tuple.allocated_ = true;
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(),
+                         LogRecordType::ROLLBACKDELETE, rid, delete_tuple);
+    AppendLog(log_record, txn, log_manager);
   }
 
-  int slot_num = rid.GetSlotNum();
-  assert(slot_num < GetTupleCount());
-  int32_t tuple_size = GetTupleSize(slot_num);
-
   // set tuple size to positive value
   if (tuple_size < 0)
     SetTupleSize(slot_num, -tuple_size);
 }
 
 bool TablePage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
-                         LockManager *lock_manager) {
+                         LockManager *lock_manager, page_id_t table_id) {
+  if (!LockTuple(rid, txn, lock_manager, table_id)) {
+    return false;
+  }
+  int slot_num = rid.GetSlotNum();
+  tuple.size_ = GetTupleSize(slot_num);
+  if (tuple.allocated_)
+    Tuple::Free(tuple.data_);
+  tuple.data_ = Tuple::Allocate(tuple.size_);
+  CopyTupleOut(slot_num, tuple.size_, tuple.data_);
+  tuple.rid_ = rid;
+  tuple.allocated_ = true;
+  return true;
+}
+
+bool TablePage::LockTuple(const RID &rid, Transaction *txn,
+                          LockManager *lock_manager, page_id_t table_id) {
   int slot_num = rid.GetSlotNum();
   if (slot_num >= GetTupleCount()) {
     if (ENABLE_LOGGING)
@@ -298,17 +463,78 @@ bool TablePage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
     if (txn->GetExclusiveLockSet()->find(rid) ==
             txn->GetExclusiveLockSet()->end() &&
         txn->GetSharedLockSet()->find(rid) == txn->GetSharedLockSet()->end() &&
-        !lock_manager->LockShared(txn, rid)) {
+        !lock_manager->LockShared(txn, rid, table_id)) {
       return false;
     }
   }
+  return true;
+}
 
-  int32_t tuple_offset = GetTupleOffset(slot_num);
-  tuple.size_ = tuple_size;
+const char *TablePage::GetColumnData(const RID &rid, Schema *schema,
+                                     int column_id) {
+  int slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount() || GetTupleSize(slot_num) <= 0)
+    return nullptr;
+  const char *payload = GetData() + GetTupleOffset(slot_num);
+  const char *data;
+  if (IsPax()) {
+    data = GetData() + GetMinipageOffset(column_id) +
+           slot_num * schema->GetLength(column_id);
+    payload -= GetFixedSize();
+  } else {
+    data = payload + schema->GetOffset(column_id);
+  }
+  if (schema->IsInlined(column_id)) {
+    return data;
+  }
+  // offsets of varchars are from the start of the tuple
+  return payload + *reinterpret_cast<const int32_t *>(data);
+}
+
+uint32_t TablePage::GetTupleSlots(uint32_t first_slot,
+                                  std::vector<uint32_t> &slots) {
+  uint32_t tuple_count = static_cast<uint32_t>(GetTupleCount());
+  slots.clear();
+  for (uint32_t i = first_slot; i < tuple_count; ++i) {
+    if (GetTupleSize(i) > 0) {
+      slots.push_back(i);
+    }
+  }
+  return tuple_count;
+}
+
+/*
+ * A PAX page has the column in its minipage already, one slot after the
+ * other, and the gather reads it in order
+ */
+void TablePage::GatherColumn(Schema *schema, int column_id,
+                             const uint32_t *slots, size_t count,
+                             char *column) {
+  assert(schema->IsInlined(column_id));
+  int32_t length = schema->GetLength(column_id);
+  if (IsPax()) {
+    const char *minipage = GetData() + GetMinipageOffset(column_id);
+    for (size_t i = 0; i < count; ++i) {
+      memcpy(column + i * length, minipage + slots[i] * length, length);
+    }
+    return;
+  }
+  int32_t offset = schema->GetOffset(column_id);
+  for (size_t i = 0; i < count; ++i) {
+    memcpy(column + i * length,
+           GetData() + GetTupleOffset(slots[i]) + offset, length);
+  }
+}
+
+bool TablePage::ReadTuple(const RID &rid, Tuple &tuple) {
+  int slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount() || GetTupleSize(slot_num) <= 0)
+    return false;
+  tuple.size_ = GetTupleSize(slot_num);
   if (tuple.allocated_)
-    delete[] tuple.data_;
-  tuple.data_ = new char[tuple.size_];
-  memcpy(tuple.data_, GetData() + tuple_offset, tuple.size_);
+    Tuple::Free(tuple.data_);
+  tuple.data_ = Tuple::Allocate(tuple.size_);
+  CopyTupleOut(slot_num, tuple.size_, tuple.data_);
   tuple.rid_ = rid;
   tuple.allocated_ = true;
   return true;
@@ -317,9 +543,9 @@ bool TablePage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
 /**
  * Tuple iterator
  */
-bool TablePage::GetFirstTupleRid(RID &first_rid) {
+bool TablePage::GetFirstTupleRid(RID &first_rid, bool all_slots) {
   for (int i = 0; i < GetTupleCount(); ++i) {
-    if (GetTupleSize(i) > 0) { // valid tuple
+    if (all_slots || GetTupleSize(i) > 0) { // valid tuple
       first_rid.Set(GetPageId(), i);
       return true;
     }
@@ -329,10 +555,11 @@ bool TablePage::GetFirstTupleRid(RID &first_rid) {
   return false;
 }
 
-bool TablePage::GetNextTupleRid(const RID &cur_rid, RID &next_rid) {
+bool TablePage::GetNextTupleRid(const RID &cur_rid, RID &next_rid,
+                                bool all_slots) {
   assert(cur_rid.GetPageId() == GetPageId());
   for (auto i = cur_rid.GetSlotNum() + 1; i < GetTupleCount(); ++i) {
-    if (GetTupleSize(i) > 0) { // valid tuple
+    if (all_slots || GetTupleSize(i) > 0) { // valid tuple
       next_rid.Set(GetPageId(), i);
       return true;
     }
@@ -344,43 +571,186 @@ bool TablePage::GetNextTupleRid(const RID &cur_rid, RID &next_rid) {
  * helper functions
  */
 
+void TablePage::AppendLog(LogRecord &log_record, Transaction *txn,
+                          LogManager *log_manager) {
+  lsn_t lsn = log_manager->AppendLogRecord(log_record);
+  txn->SetPrevLSN(lsn);
+  SetLSN(lsn);
+}
+
 // tuple slots
 int32_t TablePage::GetTupleOffset(int slot_num) {
-  return *reinterpret_cast<int32_t *>(GetData() + 24 + 8 * slot_num);
+  return *reinterpret_cast<int32_t *>(GetData() + GetSlotsOffset() +
+                                      8 * slot_num);
 }
 
 int32_t TablePage::GetTupleSize(int slot_num) {
-  return *reinterpret_cast<int32_t *>(GetData() + 28 + 8 * slot_num);
+  return *reinterpret_cast<int32_t *>(GetData() + GetSlotsOffset() + 4 +
+                                      8 * slot_num);
 }
 
 void TablePage::SetTupleOffset(int slot_num, int32_t offset) {
-  memcpy(GetData() + 24 + 8 * slot_num, &offset, 4);
+  memcpy(GetData() + GetSlotsOffset() + 8 * slot_num, &offset, 4);
 }
 
 void TablePage::SetTupleSize(int slot_num, int32_t offset) {
-  memcpy(GetData() + 28 + 8 * slot_num, &offset, 4);
+  memcpy(GetData() + GetSlotsOffset() + 4 + 8 * slot_num, &offset, 4);
 }
 
 // free space
 int32_t TablePage::GetFreeSpacePointer() {
-  return *reinterpret_cast<int32_t *>(GetData() + 16);
+  return *reinterpret_cast<int32_t *>(GetData() + 20);
 }
 
 void TablePage::SetFreeSpacePointer(int32_t free_space_pointer) {
-  memcpy(GetData() + 16, &free_space_pointer, 4);
+  memcpy(GetData() + 20, &free_space_pointer, 4);
 }
 
 // tuple count
 int32_t TablePage::GetTupleCount() {
-  return *reinterpret_cast<int32_t *>(GetData() + 20);
+  return *reinterpret_cast<int32_t *>(GetData() + 24) & ~PAX_FLAG;
 }
 
 void TablePage::SetTupleCount(int32_t tuple_count) {
-  memcpy(GetData() + 20, &tuple_count, 4);
+  tuple_count |= IsPax() ? PAX_FLAG : 0;
+  memcpy(GetData() + 24, &tuple_count, 4);
 }
 
-// for free space calculation
+/*
+ * A PAX page has room for a tuple if it has a slot and room for its
+ * payload, it tells as a slotted page would: the payload space, and the
+ * minipage and slot bytes the tuple takes as well
+ */
 int32_t TablePage::GetFreeSpaceSize() {
-  return GetFreeSpacePointer() - 24 - GetTupleCount() * 8;
+  if (IsPax()) {
+    bool slot = GetTupleCount() < GetCapacity();
+    for (int i = 0; !slot && i < GetTupleCount(); ++i) {
+      slot = GetTupleSize(i) == 0;
+    }
+    return slot ? GetPayloadFreeSpaceSize() + GetFixedSize() + 8 : 0;
+  }
+  int32_t used = 0;
+  for (int i = 0; i < GetTupleCount(); ++i) {
+    used += std::abs(GetTupleSize(i));
+  }
+  return static_cast<int32_t>(GetPageSize()) - 28 - GetTupleCount() * 8 -
+         used;
+}
+
+int32_t TablePage::GetRoomFor(const RID &rid) {
+  int slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount() || GetTupleSize(slot_num) <= 0) {
+    return 0;
+  }
+  // as UpdateTuple tells whether a tuple fits
+  return GetTupleSize(slot_num) +
+         (IsPax() ? GetPayloadFreeSpaceSize() : GetFreeSpaceSize());
+}
+
+int32_t TablePage::GetContiguousSpaceSize() {
+  if (IsPax()) {
+    return GetFreeSpacePointer() - GetMinipageOffset(0) -
+           GetCapacity() * GetFixedSize();
+  }
+  return GetFreeSpacePointer() - 28 - GetTupleCount() * 8;
+}
+
+int32_t TablePage::GetPayloadFreeSpaceSize() {
+  int32_t used = 0;
+  for (int i = 0; i < GetTupleCount(); ++i) {
+    if (GetTupleSize(i) != 0) {
+      used += GetPayloadSize(std::abs(GetTupleSize(i)));
+    }
+  }
+  return static_cast<int32_t>(GetPageSize()) - GetMinipageOffset(0) -
+         GetCapacity() * GetFixedSize() - used;
+}
+
+// PAX layout
+int32_t TablePage::GetCapacity() {
+  return *reinterpret_cast<int32_t *>(GetData() + 28);
+}
+
+int32_t TablePage::GetFixedSize() {
+  return IsPax() ? *reinterpret_cast<int32_t *>(GetData() + 32) : 0;
+}
+
+int32_t TablePage::GetSlotsOffset() {
+  return IsPax() ? 40 + 4 * *reinterpret_cast<int32_t *>(GetData() + 36) : 28;
+}
+
+int32_t TablePage::GetMinipageOffset(int column_id) {
+  int32_t capacity = GetCapacity();
+  int32_t offset = GetSlotsOffset() + 8 * capacity;
+  auto widths = reinterpret_cast<int32_t *>(GetData() + 40);
+  for (int i = 0; i < column_id; ++i) {
+    offset += capacity * std::abs(widths[i]);
+  }
+  return offset;
+}
+
+void TablePage::CopyTupleOut(int slot_num, int32_t tuple_size, char *data) {
+  const char *payload = GetData() + GetTupleOffset(slot_num);
+  if (!IsPax()) {
+    memcpy(data, payload, tuple_size);
+    return;
+  }
+  int32_t capacity = GetCapacity();
+  int32_t column_count = *reinterpret_cast<int32_t *>(GetData() + 36);
+  auto widths = reinterpret_cast<int32_t *>(GetData() + 40);
+  const char *minipage = GetData() + GetSlotsOffset() + 8 * capacity;
+  for (int i = 0; i < column_count; ++i) {
+    int32_t width = std::abs(widths[i]);
+    memcpy(data, minipage + slot_num * width, width);
+    data += width;
+    minipage += capacity * width;
+  }
+  memcpy(data, payload, GetPayloadSize(tuple_size));
+}
+
+void TablePage::CopyTupleIn(int slot_num, const Tuple &tuple) {
+  char *payload = GetData() + GetTupleOffset(slot_num);
+  if (!IsPax()) {
+    memcpy(payload, tuple.data_, tuple.size_);
+    return;
+  }
+  int32_t capacity = GetCapacity();
+  int32_t column_count = *reinterpret_cast<int32_t *>(GetData() + 36);
+  auto widths = reinterpret_cast<int32_t *>(GetData() + 40);
+  char *minipage = GetData() + GetSlotsOffset() + 8 * capacity;
+  const char *data = tuple.data_;
+  for (int i = 0; i < column_count; ++i) {
+    int32_t width = std::abs(widths[i]);
+    memcpy(minipage + slot_num * width, data, width);
+    data += width;
+    minipage += capacity * width;
+  }
+  memcpy(payload, data, GetPayloadSize(tuple.size_));
+}
+
+/*
+ * Tuples, deleted ones not applied yet too, are moved to the end of the page
+ * in the order they are in; slots keep their number, so rids stay valid
+ */
+void TablePage::Compact() {
+  std::vector<std::pair<int32_t, int>> tuples; // offset, slot
+  for (int i = 0; i < GetTupleCount(); ++i) {
+    if (GetTupleSize(i) != 0) {
+      tuples.emplace_back(GetTupleOffset(i), i);
+    }
+  }
+  std::sort(tuples.begin(), tuples.end(),
+            std::greater<std::pair<int32_t, int>>());
+  int32_t free_space_pointer = static_cast<int32_t>(GetPageSize());
+  for (auto &tuple : tuples) {
+    int32_t tuple_size = GetPayloadSize(std::abs(GetTupleSize(tuple.second)));
+    free_space_pointer -= tuple_size;
+    if (free_space_pointer != tuple.first) {
+      memmove(GetData() + free_space_pointer, GetData() + tuple.first,
+              tuple_size);
+      SetTupleOffset(tuple.second, free_space_pointer);
+    }
+  }
+  SetFreeSpacePointer(free_space_pointer);
 }
 } // namespace cmudb
@@ -0,0 +1,162 @@
+/**
+ * dictionary.cpp
+ */
+#include <algorithm>
+#include <cassert>
+
+#include "common/exception.h"
+#include "page/dictionary_page.h"
+#include "page/header_page.h"
+#include "table/dictionary.h"
+
+namespace cmudb {
+
+Dictionary::Dictionary(const std::string &table_name,
+                       BufferPoolManager *buffer_pool_manager,
+                       int column_count, const std::vector<int> &column_ids)
+    : name_(table_name + "_dict"), buffer_pool_manager_(buffer_pool_manager),
+      slot_of_(column_count, -1), columns_(column_ids.size()) {
+  for (size_t i = 0; i < column_ids.size(); i++) {
+    slot_of_[column_ids[i]] = static_cast<int>(i);
+  }
+  if (column_ids.empty()) {
+    return;
+  }
+  auto header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  assert(header_page != nullptr); // all pages are pinned
+  header_page->RLatch();
+  header_page->GetRootId(name_, first_page_id_);
+  header_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  Load();
+}
+
+int32_t Dictionary::Encode(int column_id, const char *data, uint32_t length) {
+  std::lock_guard<std::mutex> guard(latch_);
+  Column &column = columns_[slot_of_[column_id]];
+  std::string string(data, length);
+  auto it = column.codes.find(string);
+  if (it != column.codes.end()) {
+    return it->second;
+  }
+  if (length > std::min<uint32_t>(
+                   UINT16_MAX,
+                   DictionaryPage::Capacity(
+                       buffer_pool_manager_->GetPageSize()))) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                    "string too long for the dictionary");
+  }
+  Persist(column_id, data, length);
+  int32_t code = static_cast<int32_t>(column.strings.size());
+  column.codes.emplace(string, code);
+  column.strings.push_back(std::move(string));
+  return code;
+}
+
+bool Dictionary::Lookup(int column_id, const char *data, uint32_t length,
+                        int32_t &code) {
+  std::lock_guard<std::mutex> guard(latch_);
+  Column &column = columns_[slot_of_[column_id]];
+  auto it = column.codes.find(std::string(data, length));
+  if (it == column.codes.end()) {
+    return false;
+  }
+  code = it->second;
+  return true;
+}
+
+bool Dictionary::Decode(int column_id, int32_t code, const char *&data,
+                        uint32_t &length) {
+  std::lock_guard<std::mutex> guard(latch_);
+  Column &column = columns_[slot_of_[column_id]];
+  if (code < 0 || code >= static_cast<int32_t>(column.strings.size())) {
+    return false;
+  }
+  const std::string &string = column.strings[code];
+  data = string.data();
+  length = static_cast<uint32_t>(string.size());
+  return true;
+}
+
+size_t Dictionary::GetSize(int column_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  return columns_[slot_of_[column_id]].strings.size();
+}
+
+void Dictionary::Load() {
+  page_id_t page_id = first_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page = static_cast<DictionaryPage *>(
+        buffer_pool_manager_->FetchPage(page_id));
+    assert(page != nullptr); // all pages are pinned
+    int32_t offset = 0;
+    int column_id;
+    const char *data;
+    uint32_t length;
+    while (page->ReadEntry(offset, column_id, data, length)) {
+      if (!IsEncoded(column_id)) {
+        continue;
+      }
+      Column &column = columns_[slot_of_[column_id]];
+      column.codes.emplace(std::string(data, length),
+                           static_cast<int32_t>(column.strings.size()));
+      column.strings.emplace_back(data, length);
+    }
+    last_page_id_ = page_id;
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+/*
+ * A new page is written and flushed before the page before it, or the
+ * header page, points at it
+ */
+void Dictionary::Persist(int column_id, const char *data, uint32_t length) {
+  size_t page_size = buffer_pool_manager_->GetPageSize();
+  if (last_page_id_ != INVALID_PAGE_ID) {
+    auto page = static_cast<DictionaryPage *>(
+        buffer_pool_manager_->FetchPage(last_page_id_));
+    assert(page != nullptr); // all pages are pinned
+    bool appended = page->Append(column_id, data, length, page_size);
+    buffer_pool_manager_->UnpinPage(last_page_id_, appended);
+    if (appended) {
+      buffer_pool_manager_->FlushPage(last_page_id_);
+      return;
+    }
+  }
+  page_id_t page_id;
+  auto page = static_cast<DictionaryPage *>(
+      buffer_pool_manager_->NewPage(page_id, last_page_id_));
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_IO, "out of memory");
+  }
+  page->Init(page_id);
+  page->Append(column_id, data, length, page_size);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+  buffer_pool_manager_->FlushPage(page_id);
+  if (last_page_id_ != INVALID_PAGE_ID) {
+    auto last_page = static_cast<DictionaryPage *>(
+        buffer_pool_manager_->FetchPage(last_page_id_));
+    assert(last_page != nullptr); // all pages are pinned
+    last_page->SetNextPageId(page_id);
+    buffer_pool_manager_->UnpinPage(last_page_id_, true);
+    buffer_pool_manager_->FlushPage(last_page_id_);
+  } else {
+    auto header_page = static_cast<HeaderPage *>(
+        buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+    assert(header_page != nullptr); // all pages are pinned
+    header_page->WLatch();
+    if (!header_page->InsertRecord(name_, page_id))
+      header_page->UpdateRecord(name_, page_id);
+    header_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+    buffer_pool_manager_->FlushPage(HEADER_PAGE_ID);
+    first_page_id_ = page_id;
+  }
+  last_page_id_ = page_id;
+}
+
+} // namespace cmudb
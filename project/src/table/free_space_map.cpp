@@ -0,0 +1,236 @@
+/**
+ * free_space_map.cpp
+ */
+#include <algorithm>
+#include <cstring>
+
+#include "common/exception.h"
+#include "page/header_page.h"
+#include "page/table_page.h"
+#include "table/free_space_map.h"
+
+namespace cmudb {
+
+namespace {
+// meta page fields, in 4 byte words
+const int CLEAN = 3;
+const int PAGE_COUNT = 4;
+const int MAP_PAGE_COUNT = 5;
+} // namespace
+
+FreeSpaceMap::FreeSpaceMap(const std::string &table_name,
+                           BufferPoolManager *buffer_pool_manager,
+                           page_id_t first_page_id)
+    : name_(table_name + "_fsm"), buffer_pool_manager_(buffer_pool_manager),
+      meta_page_id_(INVALID_PAGE_ID), tree_(2, 0), capacity_(1) {
+  size_t page_size = buffer_pool_manager_->GetPageSize();
+  entries_per_page_ = (page_size - MAP_PAGE_HEADER_SIZE) / 8;
+  max_map_pages_ = (page_size - META_HEADER_SIZE) / sizeof(page_id_t);
+  unit_ = static_cast<int32_t>(page_size / 256);
+
+  HeaderPage *header_page =
+      static_cast<HeaderPage *>(FetchPage(HEADER_PAGE_ID));
+  header_page->RLatch();
+  bool found = header_page->GetRootId(name_, meta_page_id_);
+  header_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+
+  bool loaded = false;
+  if (found) {
+    Page *meta = FetchPage(meta_page_id_);
+    const uint32_t *fields = reinterpret_cast<uint32_t *>(meta->GetData());
+    const page_id_t *map_page_ids = reinterpret_cast<const page_id_t *>(
+        meta->GetData() + META_HEADER_SIZE);
+    map_page_ids_.assign(map_page_ids,
+                         map_page_ids + fields[MAP_PAGE_COUNT]);
+    size_t count = fields[PAGE_COUNT];
+    loaded = fields[CLEAN] != 0;
+    buffer_pool_manager_->UnpinPage(meta_page_id_, false);
+    for (size_t i = 0; loaded && i < map_page_ids_.size(); i++) {
+      Page *page = FetchPage(map_page_ids_[i]);
+      const uint32_t *entries = reinterpret_cast<const uint32_t *>(
+          page->GetData() + MAP_PAGE_HEADER_SIZE);
+      size_t end = std::min(count, (i + 1) * entries_per_page_);
+      for (size_t index = i * entries_per_page_; index < end; index++) {
+        size_t slot = index - i * entries_per_page_;
+        page_id_t page_id = static_cast<page_id_t>(entries[2 * slot]);
+        index_of_[page_id] = page_ids_.size();
+        page_ids_.push_back(page_id);
+        SetBucket(index, static_cast<uint8_t>(entries[2 * slot + 1]));
+      }
+      buffer_pool_manager_->UnpinPage(map_page_ids_[i], false);
+    }
+  } else {
+    Page *meta = buffer_pool_manager_->NewPage(meta_page_id_);
+    if (meta == nullptr) {
+      throw Exception(EXCEPTION_TYPE_IO, "out of memory");
+    }
+    buffer_pool_manager_->UnpinPage(meta_page_id_, true);
+    header_page = static_cast<HeaderPage *>(FetchPage(HEADER_PAGE_ID));
+    header_page->WLatch();
+    if (!header_page->InsertRecord(name_, meta_page_id_))
+      header_page->UpdateRecord(name_, meta_page_id_);
+    header_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  }
+  if (!loaded) {
+    Rebuild(first_page_id);
+  }
+  // on disk as not closed until it is, updates from now on may not get there
+  WriteMeta(false);
+}
+
+FreeSpaceMap::~FreeSpaceMap() { WriteBack(); }
+
+page_id_t FreeSpaceMap::FindPage(int32_t size) {
+  int32_t need = (size + unit_ - 1) / unit_;
+  std::lock_guard<std::mutex> guard(latch_);
+  if (need > 255 || tree_[1] < need) {
+    return INVALID_PAGE_ID;
+  }
+  // leftmost leaf with enough
+  size_t node = 1;
+  while (node < capacity_) {
+    node = tree_[2 * node] >= need ? 2 * node : 2 * node + 1;
+  }
+  return page_ids_[node - capacity_];
+}
+
+void FreeSpaceMap::Update(page_id_t page_id, int32_t free) {
+  uint8_t bucket = static_cast<uint8_t>(
+      std::min<int32_t>(std::max<int32_t>(free, 0) / unit_, 255));
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = index_of_.find(page_id);
+  size_t index;
+  if (it == index_of_.end()) {
+    index = page_ids_.size();
+    index_of_[page_id] = index;
+    page_ids_.push_back(page_id);
+  } else {
+    index = it->second;
+  }
+  SetBucket(index, bucket);
+}
+
+page_id_t FreeSpaceMap::GetLastPageId() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return page_ids_.empty() ? INVALID_PAGE_ID : page_ids_.back();
+}
+
+size_t FreeSpaceMap::GetPageCount() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return page_ids_.size();
+}
+
+int32_t FreeSpaceMap::GetFree(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto it = index_of_.find(page_id);
+  if (it == index_of_.end()) {
+    return 0;
+  }
+  return tree_[capacity_ + it->second] * unit_;
+}
+
+void FreeSpaceMap::Rebuild(page_id_t first_page_id) {
+  page_ids_.clear();
+  index_of_.clear();
+  std::fill(tree_.begin(), tree_.end(), 0);
+  page_id_t page_id = first_page_id;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page = static_cast<TablePage *>(FetchPage(page_id));
+    page->RLatch();
+    int32_t free = page->GetFreeSpaceSize();
+    page_id_t next_page_id = page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    index_of_[page_id] = page_ids_.size();
+    page_ids_.push_back(page_id);
+    SetBucket(page_ids_.size() - 1,
+              static_cast<uint8_t>(std::min<int32_t>(free / unit_, 255)));
+    page_id = next_page_id;
+  }
+}
+
+void FreeSpaceMap::SetBucket(size_t index, uint8_t bucket) {
+  if (index >= capacity_) {
+    size_t capacity = capacity_;
+    while (index >= capacity) {
+      capacity *= 2;
+    }
+    std::vector<uint8_t> tree(2 * capacity, 0);
+    std::copy(tree_.begin() + capacity_, tree_.end(),
+              tree.begin() + capacity);
+    for (size_t node = capacity - 1; node > 0; node--) {
+      tree[node] = std::max(tree[2 * node], tree[2 * node + 1]);
+    }
+    tree_.swap(tree);
+    capacity_ = capacity;
+  }
+  size_t node = capacity_ + index;
+  tree_[node] = bucket;
+  for (node /= 2; node > 0; node /= 2) {
+    tree_[node] = std::max(tree_[2 * node], tree_[2 * node + 1]);
+  }
+}
+
+/*
+ * A map longer than its meta page can point to is written as far as it
+ * goes, and marked not clean so the next open walks the chain instead
+ */
+void FreeSpaceMap::WriteBack() {
+  std::lock_guard<std::mutex> guard(latch_);
+  size_t pages = (page_ids_.size() + entries_per_page_ - 1) / entries_per_page_;
+  bool fits = pages <= max_map_pages_;
+  pages = std::min(pages, max_map_pages_);
+  while (map_page_ids_.size() > pages) {
+    buffer_pool_manager_->DeletePage(map_page_ids_.back());
+    map_page_ids_.pop_back();
+  }
+  while (map_page_ids_.size() < pages) {
+    page_id_t page_id;
+    page_id_t near_page_id =
+        map_page_ids_.empty() ? meta_page_id_ : map_page_ids_.back();
+    if (buffer_pool_manager_->NewPage(page_id, near_page_id) == nullptr) {
+      // left for the next open to build
+      return;
+    }
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    map_page_ids_.push_back(page_id);
+  }
+  for (size_t i = 0; i < map_page_ids_.size(); i++) {
+    Page *page = FetchPage(map_page_ids_[i]);
+    uint32_t *entries =
+        reinterpret_cast<uint32_t *>(page->GetData() + MAP_PAGE_HEADER_SIZE);
+    size_t end = std::min(page_ids_.size(), (i + 1) * entries_per_page_);
+    for (size_t index = i * entries_per_page_; index < end; index++) {
+      size_t slot = index - i * entries_per_page_;
+      entries[2 * slot] = static_cast<uint32_t>(page_ids_[index]);
+      entries[2 * slot + 1] = tree_[capacity_ + index];
+    }
+    buffer_pool_manager_->UnpinPage(map_page_ids_[i], true);
+    buffer_pool_manager_->FlushPage(map_page_ids_[i]);
+  }
+  WriteMeta(fits);
+}
+
+void FreeSpaceMap::WriteMeta(bool clean) {
+  Page *meta = FetchPage(meta_page_id_);
+  uint32_t *fields = reinterpret_cast<uint32_t *>(meta->GetData());
+  fields[CLEAN] = clean ? 1 : 0;
+  fields[PAGE_COUNT] = static_cast<uint32_t>(page_ids_.size());
+  fields[MAP_PAGE_COUNT] = static_cast<uint32_t>(map_page_ids_.size());
+  memcpy(meta->GetData() + META_HEADER_SIZE, map_page_ids_.data(),
+         map_page_ids_.size() * sizeof(page_id_t));
+  buffer_pool_manager_->UnpinPage(meta_page_id_, true);
+  buffer_pool_manager_->FlushPage(meta_page_id_);
+}
+
+Page *FreeSpaceMap::FetchPage(page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_IO, "out of memory");
+  }
+  return page;
+}
+
+} // namespace cmudb
@@ -0,0 +1,74 @@
+/**
+ * morsel_cursor.cpp
+ */
+
+#include <cassert>
+
+#include "table/morsel_cursor.h"
+#include "table/table_heap.h"
+
+namespace cmudb {
+
+MorselCursor::MorselCursor(TableHeap *table_heap, size_t morsel_pages)
+    : buffer_pool_manager_(table_heap->buffer_pool_manager_),
+      morsel_pages_(morsel_pages > 0 ? morsel_pages : 1),
+      next_page_id_(table_heap->GetFirstPageId()) {}
+
+/*
+ * A morsel is claimed by its page ids, pages are pinned one at a time so a
+ * small buffer pool does not run out of frames; the page after the morsel
+ * is prefetched for whoever claims it
+ */
+bool MorselCursor::Next(std::vector<Tuple> &tuples) {
+  tuples.clear();
+  std::vector<page_id_t> page_ids;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    while (next_page_id_ != INVALID_PAGE_ID &&
+           page_ids.size() < morsel_pages_) {
+      auto page = static_cast<TablePage *>(
+          buffer_pool_manager_->FetchPage(next_page_id_));
+      assert(page != nullptr); // all pages are pinned
+      page_ids.push_back(next_page_id_);
+      page->RLatch();
+      next_page_id_ = page->GetNextPageId();
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page_ids.back(), false);
+      if (next_page_id_ != INVALID_PAGE_ID) {
+        buffer_pool_manager_->Prefetch(next_page_id_);
+      }
+    }
+    if (page_ids.empty()) {
+      return false;
+    }
+  }
+  for (page_id_t page_id : page_ids) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    assert(page != nullptr); // all pages are pinned
+    page->RLatch();
+    RID rid;
+    bool found = page->GetFirstTupleRid(rid);
+    while (found) {
+      tuples.emplace_back();
+      if (page->ReadTuple(rid, tuples.back())) {
+        tuples.back().SetOverflowPool(buffer_pool_manager_);
+      } else {
+        tuples.pop_back();
+      }
+      RID next_rid;
+      found = page->GetNextTupleRid(rid, next_rid);
+      rid = next_rid;
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
+  return true;
+}
+
+void MorselCursor::Stop() {
+  std::lock_guard<std::mutex> guard(latch_);
+  next_page_id_ = INVALID_PAGE_ID;
+}
+
+} // namespace cmudb
@@ -0,0 +1,76 @@
+/**
+ * overflow_chain.cpp
+ */
+
+#include "table/overflow_chain.h"
+#include "page/overflow_page.h"
+
+namespace cmudb {
+
+/*
+ * Written from the last page back, each page knows its successor when it is
+ * made and next to it on disk
+ */
+bool OverflowChain::Write(BufferPoolManager *buffer_pool_manager,
+                          const char *data, int32_t size,
+                          page_id_t &first_page_id) {
+  size_t page_size = buffer_pool_manager->GetPageSize();
+  int32_t capacity = OverflowPage::Capacity(page_size);
+  int32_t pages = size == 0 ? 1 : (size + capacity - 1) / capacity;
+  page_id_t next_page_id = INVALID_PAGE_ID;
+  for (int32_t i = pages - 1; i >= 0; i--) {
+    page_id_t page_id;
+    auto page = static_cast<OverflowPage *>(
+        buffer_pool_manager->NewPage(page_id, next_page_id));
+    if (page == nullptr) {
+      Free(buffer_pool_manager, next_page_id);
+      return false;
+    }
+    int32_t offset = i * capacity;
+    page->Init(page_id, next_page_id, data + offset, size - offset, page_size);
+    buffer_pool_manager->UnpinPage(page_id, true);
+    buffer_pool_manager->FlushPage(page_id);
+    next_page_id = page_id;
+  }
+  first_page_id = next_page_id;
+  return true;
+}
+
+bool OverflowChain::Read(BufferPoolManager *buffer_pool_manager,
+                         page_id_t first_page_id, char *data, int32_t size) {
+  page_id_t page_id = first_page_id;
+  int32_t offset = 0;
+  while (offset < size && page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<OverflowPage *>(buffer_pool_manager->FetchPage(page_id));
+    if (page == nullptr) {
+      return false;
+    }
+    // written once, before anyone could read it, no latch needed
+    int32_t length = std::min(page->GetSize(), size - offset);
+    memcpy(data + offset, page->GetPayload(), length);
+    offset += length;
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+  return offset == size;
+}
+
+void OverflowChain::Free(BufferPoolManager *buffer_pool_manager,
+                         page_id_t first_page_id) {
+  page_id_t page_id = first_page_id;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<OverflowPage *>(buffer_pool_manager->FetchPage(page_id));
+    if (page == nullptr) {
+      return;
+    }
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager->UnpinPage(page_id, false);
+    buffer_pool_manager->DeletePage(page_id);
+    page_id = next_page_id;
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,53 @@
+/**
+ * scan_filter.cpp
+ */
+
+#include "page/table_page.h"
+#include "table/scan_filter.h"
+
+namespace cmudb {
+
+bool ScanFilter::Matches(const Tuple &tuple) const {
+  for (auto &predicate : predicates_) {
+    uint32_t position;
+    const char *data =
+        tuple.GetData() + schema_->GetOffset(predicate.column_id);
+    if (BatchKernels::Select(schema_->GetType(predicate.column_id), data, 1,
+                             predicate.op, predicate.constant,
+                             &position) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Each predicate narrows the selection: the column of the slots left is
+ * gathered, the kernel picks the positions that hold, and those slots are
+ * kept in order
+ */
+uint32_t ScanFilter::Select(TablePage *page, uint32_t first_slot,
+                            std::vector<uint32_t> &selection) {
+  uint32_t slot_count = page->GetTupleSlots(first_slot, selection);
+  for (auto &predicate : predicates_) {
+    if (selection.empty()) {
+      break;
+    }
+    int column_id = predicate.column_id;
+    size_t count = selection.size();
+    column_.resize(count * schema_->GetLength(column_id));
+    positions_.resize(count);
+    page->GatherColumn(schema_, column_id, selection.data(), count,
+                       column_.data());
+    size_t selected = BatchKernels::Select(
+        schema_->GetType(column_id), column_.data(), count, predicate.op,
+        predicate.constant, positions_.data());
+    for (size_t i = 0; i < selected; ++i) {
+      selection[i] = selection[positions_[i]];
+    }
+    selection.resize(selected);
+  }
+  return slot_count;
+}
+
+} // namespace cmudb
@@ -0,0 +1,79 @@
+/**
+ * table_batch_iterator.cpp
+ */
+
+#include <cassert>
+
+#include "table/table_batch_iterator.h"
+#include "table/table_heap.h"
+
+namespace cmudb {
+
+TableBatchIterator::TableBatchIterator(TableHeap *table_heap,
+                                       Transaction *txn, bool for_update)
+    : table_heap_(table_heap), txn_(txn),
+      page_id_(table_heap->GetFirstPageId()) {
+  // a refused scan reads nothing
+  if (!table_heap_->LockScan(txn, for_update)) {
+    page_id_ = INVALID_PAGE_ID;
+  }
+}
+
+/*
+ * Pages without a tuple the transaction sees are passed over in the same
+ * call, a batch is only empty at the end
+ */
+bool TableBatchIterator::Next(std::vector<Tuple> &tuples, size_t max_tuples) {
+  BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
+  // a snapshot scan visits every slot, as TableIterator does
+  bool snapshot = table_heap_->version_store_ != nullptr;
+  size_t count = 0;
+  while (count == 0 && page_id_ != INVALID_PAGE_ID && max_tuples > 0) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager->FetchPage(page_id_));
+    assert(page != nullptr); // all pages are pinned
+    page->RLatch();
+    ReadAhead(page);
+    RID rid;
+    bool found = started_ ? page->GetNextTupleRid(rid_, rid, snapshot)
+                          : page->GetFirstTupleRid(rid, snapshot);
+    bool aborted = false;
+    while (found && count < max_tuples) {
+      if (count == tuples.size()) {
+        tuples.emplace_back();
+      }
+      if (table_heap_->ReadTuple(page, rid, tuples[count], txn_)) {
+        count++;
+      }
+      rid_ = rid;
+      started_ = true;
+      if (txn_ != nullptr && txn_->GetState() == TransactionState::ABORTED) {
+        aborted = true;
+        break;
+      }
+      RID next_rid;
+      found = page->GetNextTupleRid(rid_, next_rid, snapshot);
+      rid = next_rid;
+    }
+    if (aborted) {
+      page_id_ = INVALID_PAGE_ID;
+    } else if (!found) {
+      page_id_ = page->GetNextPageId();
+      started_ = false;
+    }
+    page->RUnlatch();
+    buffer_pool_manager->UnpinPage(page->GetPageId(), false);
+  }
+  tuples.resize(count);
+  return count > 0;
+}
+
+void TableBatchIterator::ReadAhead(TablePage *page) {
+  page_id_t next_page_id = page->GetNextPageId();
+  if (next_page_id != INVALID_PAGE_ID && next_page_id != read_ahead_page_id_) {
+    table_heap_->buffer_pool_manager_->Prefetch(next_page_id);
+    read_ahead_page_id_ = next_page_id;
+  }
+}
+
+} // namespace cmudb
@@ -2,9 +2,17 @@
  * table_heap.cpp
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include "common/logger.h"
+#include "common/numa.h"
+#include "table/morsel_cursor.h"
+#include "table/overflow_chain.h"
 #include "table/table_heap.h"
 
 namespace cmudb {
@@ -14,33 +22,61 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
                      LockManager *lock_manager, LogManager *log_manager,
                      page_id_t first_page_id)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager),
-      log_manager_(log_manager), first_page_id_(first_page_id) {}
+      log_manager_(log_manager), first_page_id_(first_page_id),
+      version_store_(nullptr), tuple_versions_(nullptr),
+      free_space_map_(nullptr), schema_(nullptr), zone_map_(nullptr) {}
 
 // create table
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
                      LockManager *lock_manager, LogManager *log_manager,
-                     Transaction *txn)
+                     Transaction *txn,
+                     const std::vector<int32_t> &column_widths)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager),
-      log_manager_(log_manager) {
+      log_manager_(log_manager), version_store_(nullptr),
+      tuple_versions_(nullptr), free_space_map_(nullptr), schema_(nullptr),
+      zone_map_(nullptr) {
   auto first_page =
       static_cast<TablePage *>(buffer_pool_manager_->NewPage(first_page_id_));
   assert(first_page != nullptr); // todo: abort table creation?
   first_page->WLatch();
   LOG_DEBUG("new table page created %d", first_page_id_);
 
-  first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
+  first_page->Init(first_page_id_, buffer_pool_manager_->GetPageSize(),
+                   INVALID_LSN, log_manager_, txn, column_widths);
   first_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, true);
 }
 
 bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
-  if (tuple.size_ + 32 > PAGE_SIZE) { // larger than one page size
+  // larger than one page size, with nothing to spill
+  int page_size = buffer_pool_manager_->GetPageSize();
+  if (schema_ == nullptr && tuple.size_ + 32 > page_size) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  if (txn->IsOptimistic()) {
+    rid = RID();
+    txn->GetWriteSet()->emplace_back(rid, WType::INSERT, tuple, this);
+    return true;
+  }
+  Tuple spilled;
+  const Tuple *stored = Spill(tuple, spilled, txn);
+  if (stored == nullptr) {
+    return false;
+  }
 
+  // with a free space map, a page it has room in or else the last one
+  page_id_t page_id = first_page_id_;
+  if (free_space_map_ != nullptr) {
+    page_id = free_space_map_->FindPage(stored->size_ + 8);
+    if (page_id == INVALID_PAGE_ID)
+      page_id = free_space_map_->GetLastPageId();
+  }
+  if (!LockInsert(page_id, txn)) {
+    return false;
+  }
   auto cur_page =
-      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
   if (cur_page == nullptr) {
     txn->SetState(TransactionState::ABORTED);
     return false;
@@ -48,18 +84,38 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
 
   cur_page->WLatch();
   while (!cur_page->InsertTuple(
-      tuple, rid, txn, lock_manager_,
-      log_manager_)) { // fail to insert due to not enough space
+      *stored, rid, txn, lock_manager_, log_manager_,
+      first_page_id_)) { // fail to insert due to not enough space
+    // or the lock of the slot refused
+    if (ENABLE_LOGGING && txn->GetState() == TransactionState::ABORTED) {
+      cur_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+      return false;
+    }
     auto next_page_id = cur_page->GetNextPageId();
+    if (free_space_map_ != nullptr) {
+      // the map was off for this page, ask it again, or go to the end
+      free_space_map_->Update(cur_page->GetPageId(),
+                              cur_page->GetFreeSpaceSize());
+      page_id_t candidate = free_space_map_->FindPage(stored->size_ + 8);
+      if (candidate != INVALID_PAGE_ID)
+        next_page_id = candidate;
+      else if (next_page_id != INVALID_PAGE_ID)
+        next_page_id = free_space_map_->GetLastPageId();
+    }
     if (next_page_id != INVALID_PAGE_ID) { // valid next page
       cur_page->WUnlatch();
       buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+      if (!LockInsert(next_page_id, txn)) {
+        return false;
+      }
       cur_page = static_cast<TablePage *>(
           buffer_pool_manager_->FetchPage(next_page_id));
       cur_page->WLatch();
     } else { // create new page
-      auto new_page =
-          static_cast<TablePage *>(buffer_pool_manager_->NewPage(next_page_id));
+      // right behind the current page, scans read the chain in order
+      auto new_page = static_cast<TablePage *>(
+          buffer_pool_manager_->NewPage(next_page_id, cur_page->GetPageId()));
       if (new_page == nullptr) {
         cur_page->WUnlatch();
         buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
@@ -70,20 +126,180 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
       // std::cout << "new table page " << next_page_id << " created" <<
       // std::endl;
       cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetPageId(),
-                     log_manager_, txn);
+      // with the layout of the table
+      new_page->Init(next_page_id, buffer_pool_manager_->GetPageSize(),
+                     cur_page->GetPageId(), log_manager_, txn,
+                     cur_page->GetColumnWidths());
+      if (free_space_map_ != nullptr)
+        free_space_map_->Update(next_page_id, new_page->GetFreeSpaceSize());
+      if (zone_map_ != nullptr)
+        zone_map_->AddPage(next_page_id);
       cur_page->WUnlatch();
       buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
       cur_page = new_page;
     }
   }
+  // inserts never conflict, a reused slot keeps the versions of its old
+  // tuple behind the new one
+  if (Versioned(txn)) {
+    version_store_->Record(rid, txn, nullptr);
+  }
+  if (Tracked(txn)) {
+    tuple_versions_->Record(rid, txn);
+  }
+  if (free_space_map_ != nullptr)
+    free_space_map_->Update(cur_page->GetPageId(),
+                            cur_page->GetFreeSpaceSize());
+  if (zone_map_ != nullptr)
+    zone_map_->Record(cur_page->GetPageId(), *stored);
   cur_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
   txn->GetWriteSet()->emplace_back(rid, WType::INSERT, Tuple{}, this);
   return true;
 }
 
+bool TableHeap::AppendBatch(const std::vector<Tuple> &tuples,
+                            std::vector<RID> &rids, Transaction *txn) {
+  rids.clear();
+  // optimistic inserts are checked and spilled by InsertTuple
+  if (!txn->IsOptimistic()) {
+    // the batch goes on spilled if a tuple is
+    std::vector<Tuple> batch;
+    for (size_t i = 0; i < tuples.size(); i++) {
+      Tuple spilled;
+      const Tuple *stored = Spill(tuples[i], spilled, txn);
+      if (stored == nullptr) {
+        return false;
+      }
+      if (stored != &tuples[i] && batch.empty()) {
+        batch.assign(tuples.begin(), tuples.begin() + i);
+        batch.reserve(tuples.size());
+      }
+      if (stored != &tuples[i] || !batch.empty()) {
+        batch.push_back(*stored);
+      }
+    }
+    if (!batch.empty()) {
+      return AppendBatch(batch, rids, txn);
+    }
+  }
+  if (tuples.empty()) {
+    return true;
+  }
+  if (txn->IsOptimistic()) {
+    for (auto &tuple : tuples) {
+      rids.emplace_back();
+      InsertTuple(tuple, rids.back(), txn);
+    }
+    return true;
+  }
+
+  // the tail, known to the free space map or found walking the chain
+  page_id_t page_id = first_page_id_;
+  if (free_space_map_ != nullptr &&
+      free_space_map_->GetLastPageId() != INVALID_PAGE_ID) {
+    page_id = free_space_map_->GetLastPageId();
+  }
+  auto cur_page =
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (cur_page == nullptr) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  while (true) {
+    cur_page->RLatch();
+    page_id_t next_page_id = cur_page->GetNextPageId();
+    cur_page->RUnlatch();
+    // the intention locks of the tail before its latch, it may have grown
+    // in between
+    if (next_page_id == INVALID_PAGE_ID) {
+      if (!LockInsert(cur_page->GetPageId(), txn)) {
+        buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+        return false;
+      }
+      cur_page->WLatch();
+      next_page_id = cur_page->GetNextPageId();
+      if (next_page_id == INVALID_PAGE_ID) {
+        break;
+      }
+      cur_page->WUnlatch();
+    }
+    buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+    cur_page = static_cast<TablePage *>(
+        buffer_pool_manager_->FetchPage(next_page_id));
+    if (cur_page == nullptr) {
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+  }
+
+  bool dirty = false;
+  while (true) {
+    size_t begin = rids.size();
+    cur_page->AppendTuples(tuples, begin, rids, txn, lock_manager_,
+                           log_manager_, first_page_id_);
+    bool aborted =
+        ENABLE_LOGGING && txn->GetState() == TransactionState::ABORTED;
+    for (size_t i = begin; i < rids.size(); i++) {
+      if (Versioned(txn)) {
+        version_store_->Record(rids[i], txn, nullptr);
+      }
+      if (Tracked(txn)) {
+        tuple_versions_->Record(rids[i], txn);
+      }
+      if (zone_map_ != nullptr) {
+        zone_map_->Record(cur_page->GetPageId(), tuples[i]);
+      }
+      txn->GetWriteSet()->emplace_back(rids[i], WType::INSERT, Tuple{}, this);
+    }
+    dirty = dirty || rids.size() > begin;
+    if (dirty && free_space_map_ != nullptr) {
+      free_space_map_->Update(cur_page->GetPageId(),
+                              cur_page->GetFreeSpaceSize());
+    }
+    if (aborted) {
+      cur_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), dirty);
+      return false;
+    }
+    if (rids.size() == tuples.size()) {
+      break;
+    }
+    // the rest go to a new page right behind the tail
+    page_id_t next_page_id;
+    auto new_page = static_cast<TablePage *>(
+        buffer_pool_manager_->NewPage(next_page_id, cur_page->GetPageId()));
+    if (new_page == nullptr) {
+      cur_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), dirty);
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+    new_page->WLatch();
+    cur_page->SetNextPageId(next_page_id);
+    new_page->Init(next_page_id, buffer_pool_manager_->GetPageSize(),
+                   cur_page->GetPageId(), log_manager_, txn,
+                   cur_page->GetColumnWidths());
+    if (zone_map_ != nullptr)
+      zone_map_->AddPage(next_page_id);
+    cur_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
+    cur_page = new_page;
+    dirty = true;
+  }
+  cur_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
+  return true;
+}
+
 bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
+  if (txn->IsOptimistic()) {
+    txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
+    return true;
+  }
+  if (!LockRow(rid, txn, true)) {
+    return false;
+  }
   // todo: remove empty page
   auto page = reinterpret_cast<TablePage *>(
       buffer_pool_manager_->FetchPage(rid.GetPageId()));
@@ -92,7 +308,26 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
     return false;
   }
   page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
+  Tuple image;
+  bool versioned = Versioned(txn);
+  bool tracked = Tracked(txn);
+  if ((versioned && (!page->ReadTuple(rid, image) ||
+                     !version_store_->CanWrite(rid, txn))) ||
+      (tracked && !tuple_versions_->CanWrite(rid, txn))) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  if (page->MarkDelete(rid, txn, lock_manager_, log_manager_,
+                       first_page_id_)) {
+    if (versioned) {
+      version_store_->Record(rid, txn, &image);
+    }
+    if (tracked) {
+      tuple_versions_->Record(rid, txn);
+    }
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
   txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
@@ -101,32 +336,119 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
 
 bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid,
                             Transaction *txn) {
+  if (txn->IsOptimistic()) {
+    txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, tuple, this);
+    return true;
+  }
+  if (!LockRow(rid, txn, true)) {
+    return false;
+  }
+  Tuple spilled;
+  const Tuple *stored = Spill(tuple, spilled, txn);
+  if (stored == nullptr) {
+    return false;
+  }
   auto page = reinterpret_cast<TablePage *>(
       buffer_pool_manager_->FetchPage(rid.GetPageId()));
   if (page == nullptr) {
+    if (stored == &spilled)
+      FreeChains(spilled, tuple.GetOverflowPages(schema_));
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
   Tuple old_tuple;
   page->WLatch();
-  bool is_updated = page->UpdateTuple(tuple, old_tuple, rid, txn, lock_manager_,
-                                      log_manager_);
+  bool versioned = Versioned(txn);
+  bool tracked = Tracked(txn);
+  if ((versioned && !version_store_->CanWrite(rid, txn)) ||
+      (tracked && !tuple_versions_->CanWrite(rid, txn))) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    if (stored == &spilled)
+      FreeChains(spilled, tuple.GetOverflowPages(schema_));
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  bool is_updated = page->UpdateTuple(*stored, old_tuple, rid, txn,
+                                      lock_manager_, log_manager_,
+                                      first_page_id_);
+  if (!is_updated && schema_ != nullptr &&
+      txn->GetState() != TransactionState::ABORTED) {
+    // moving would change its rid and so every index entry of it
+    is_updated = UpdateInPlace(page, *stored, old_tuple, rid, txn);
+  }
+  if (is_updated && versioned) {
+    version_store_->Record(rid, txn, &old_tuple);
+  }
+  if (is_updated && tracked) {
+    tuple_versions_->Record(rid, txn);
+  }
+  if (is_updated && free_space_map_ != nullptr)
+    free_space_map_->Update(page->GetPageId(), page->GetFreeSpaceSize());
+  if (is_updated && zone_map_ != nullptr)
+    zone_map_->Record(page->GetPageId(), tuple);
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetPageId(), is_updated);
-  if (is_updated && txn->GetState() != TransactionState::ABORTED)
+  if (!is_updated) {
+    // the chains spilled for it go again
+    if (stored == &spilled)
+      FreeChains(spilled, tuple.GetOverflowPages(schema_));
+  } else if (txn->GetState() != TransactionState::ABORTED) {
     txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
+  } else if (FreesChains()) {
+    // a rollback, what the update undone spilled is referred to no more
+    FreeChains(old_tuple, stored->GetOverflowPages(schema_));
+  }
   return is_updated;
 }
 
+void TableHeap::ApplyUpdate(const RID &rid, const Tuple &old_tuple,
+                            Transaction *txn) {
+  if (!FreesChains() || old_tuple.GetOverflowPages(schema_).empty()) {
+    return;
+  }
+  auto page = reinterpret_cast<TablePage *>(
+      buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  assert(page != nullptr);
+  Tuple current;
+  page->RLatch();
+  bool found = page->ReadTuple(rid, current);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  FreeChains(old_tuple, found ? current.GetOverflowPages(schema_)
+                              : std::vector<page_id_t>());
+}
+
+void TableHeap::FreeChains(const Tuple &tuple,
+                           const std::vector<page_id_t> &kept) {
+  for (page_id_t chain : tuple.GetOverflowPages(schema_)) {
+    if (std::find(kept.begin(), kept.end(), chain) == kept.end()) {
+      OverflowChain::Free(buffer_pool_manager_, chain);
+    }
+  }
+}
+
 void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   auto page = reinterpret_cast<TablePage *>(
       buffer_pool_manager_->FetchPage(rid.GetPageId()));
   assert(page != nullptr);
+  // its chains go with it, unless a snapshot or an optimistic read may
+  // still follow them
+  bool free_chains = schema_ != nullptr && version_store_ == nullptr &&
+                     tuple_versions_ == nullptr;
+  Tuple deleted;
   page->WLatch();
-  page->ApplyDelete(rid, txn, log_manager_);
+  page->ApplyDelete(rid, txn, log_manager_, free_chains ? &deleted : nullptr);
   lock_manager_->Unlock(txn, rid);
+  if (free_space_map_ != nullptr)
+    free_space_map_->Update(page->GetPageId(), page->GetFreeSpaceSize());
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  if (free_chains) {
+    for (page_id_t chain : deleted.GetOverflowPages(schema_)) {
+      OverflowChain::Free(buffer_pool_manager_, chain);
+    }
+  }
 }
 
 void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
@@ -141,6 +463,9 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
 
 // called by tuple iterator
 bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn) {
+  if (!LockRow(rid, txn, false)) {
+    return false;
+  }
   auto page = static_cast<TablePage *>(
       buffer_pool_manager_->FetchPage(rid.GetPageId()));
   if (page == nullptr) {
@@ -148,28 +473,295 @@ bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn) {
     return false;
   }
   page->RLatch();
-  bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
+  bool res = ReadTuple(page, rid, tuple, txn);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+  return res;
+}
+
+bool TableHeap::ViewTuple(const RID &rid, TupleView &view, Transaction *txn) {
+  assert(!ReadsCopies(txn));
+  if (!LockRow(rid, txn, false)) {
+    return false;
+  }
+  if (!view.Reset(buffer_pool_manager_, rid)) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  // the view keeps the page pinned
+  auto page = static_cast<TablePage *>(
+      buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  page->RLatch();
+  bool res = page->LockTuple(rid, txn, lock_manager_, first_page_id_);
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
   return res;
 }
 
+bool TableHeap::ReadTuple(TablePage *page, const RID &rid, Tuple &tuple,
+                          Transaction *txn) {
+  bool optimistic = txn != nullptr && txn->IsOptimistic();
+  if (optimistic) {
+    // its own writes first
+    auto write = BufferedWrite(rid, txn);
+    if (write != nullptr) {
+      if (write->wtype_ == WType::DELETE) {
+        return false;
+      }
+      // rid may be the one of tuple, as for iterators
+      RID tuple_rid = rid;
+      tuple = write->tuple_;
+      tuple.rid_ = tuple_rid;
+      return true;
+    }
+  }
+  bool res;
+  if (optimistic) {
+    // no locks, the version read is validated at commit
+    assert(tuple_versions_ != nullptr);
+    timestamp_t version;
+    if (tuple_versions_->Read(rid, txn, version)) {
+      res = page->ReadTuple(rid, tuple);
+      txn->GetReadSet()->emplace_back(rid, version);
+    } else {
+      txn->SetState(TransactionState::ABORTED);
+      res = false;
+    }
+  } else if (version_store_ != nullptr && txn != nullptr) {
+    // snapshot read, no locks
+    switch (version_store_->Read(rid, txn, tuple)) {
+    case VersionRead::LATEST:
+      res = page->ReadTuple(rid, tuple);
+      break;
+    case VersionRead::OLDER:
+      res = true;
+      break;
+    default:
+      res = false;
+    }
+  } else {
+    res = page->GetTuple(rid, tuple, txn, lock_manager_, first_page_id_);
+  }
+  if (res) {
+    tuple.overflow_pool_ = buffer_pool_manager_;
+  }
+  return res;
+}
+
+const WriteRecord *TableHeap::BufferedWrite(const RID &rid,
+                                            Transaction *txn) {
+  auto write_set = txn->GetWriteSet();
+  for (auto it = write_set->rbegin(); it != write_set->rend(); ++it) {
+    if (it->rid_ == rid && it->table_ == this) {
+      return &*it;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Hand every page of the heap back to the disk manager, which reuses them
+ * for new pages. Returns false if a page is still pinned by someone else,
+ * the pages before it are gone then
+ */
 bool TableHeap::DeleteTableHeap() {
-  // todo: real delete
+  page_id_t page_id = first_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr)
+      return false;
+    page->RLatch();
+    page_id_t next_page_id = page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    if (!buffer_pool_manager_->DeletePage(page_id))
+      return false;
+    first_page_id_ = page_id = next_page_id;
+  }
   return true;
 }
 
-TableIterator TableHeap::begin(Transaction *txn) {
+TableIterator TableHeap::begin(Transaction *txn, bool for_update,
+                               const ScanFilter &filter) {
+  if (!LockScan(txn, for_update)) {
+    return end();
+  }
   auto page =
       static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
   page->RLatch();
   RID rid;
   // if failed (no tuple), rid will be the result of default
   // constructor, which means eof
-  page->GetFirstTupleRid(rid);
+  page->GetFirstTupleRid(rid, version_store_ != nullptr);
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, false);
-  return TableIterator(this, rid, txn);
+  return TableIterator(this, rid, txn, std::vector<ScanRange>(), filter);
+}
+
+TableIterator TableHeap::begin(Transaction *txn, bool for_update,
+                               const std::vector<ScanRange> &ranges,
+                               const ScanFilter &filter) {
+  if (zone_map_ == nullptr || ranges.empty()) {
+    return begin(txn, for_update, filter);
+  }
+  if (!LockScan(txn, for_update)) {
+    return end();
+  }
+  // the first page the map does not rule out that has a tuple
+  RID rid;
+  page_id_t page_id = zone_map_->NextPage(INVALID_PAGE_ID, ranges);
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    assert(page != nullptr); // all pages are pinned
+    page->RLatch();
+    bool found = page->GetFirstTupleRid(rid, version_store_ != nullptr);
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    if (found) {
+      break;
+    }
+    page_id = zone_map_->NextPage(page_id, ranges);
+  }
+  return TableIterator(this, rid, txn, ranges, filter);
+}
+
+void TableHeap::ParallelScan(
+    int threads, const std::function<void(int, const Tuple &)> &visit,
+    size_t morsel_pages) {
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  MorselCursor cursor(this, morsel_pages);
+  std::mutex latch;
+  std::exception_ptr error;
+  int nodes = buffer_pool_manager_->GetNumaNodes();
+  auto worker = [&](int id) {
+    // the caller, worker 0, stays where it runs
+    if (id != 0 && nodes > 1) {
+      Numa::PinThread(id % nodes);
+    }
+    // copied out, visit may take its time
+    std::vector<Tuple> tuples;
+    try {
+      while (cursor.Next(tuples)) {
+        for (const Tuple &tuple : tuples) {
+          visit(id, tuple);
+        }
+      }
+    } catch (...) {
+      cursor.Stop();
+      std::lock_guard<std::mutex> guard(latch);
+      if (error == nullptr) {
+        error = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (int id = 1; id < threads; id++) {
+    workers.emplace_back(worker, id);
+  }
+  worker(0);
+  for (auto &thread : workers) {
+    thread.join();
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+/*
+ * Spilled down to TUPLE_INLINE_SHARE of a page, so a page still holds a few
+ * tuples; a tuple that had nothing to spill goes as it is
+ */
+const Tuple *TableHeap::Spill(const Tuple &tuple, Tuple &spilled,
+                              Transaction *txn) {
+  int32_t page_size = buffer_pool_manager_->GetPageSize();
+  auto max_size = static_cast<int32_t>(page_size * TUPLE_INLINE_SHARE);
+  const Tuple *stored = &tuple;
+  if (schema_ != nullptr && tuple.size_ > max_size) {
+    if (!tuple.Spill(schema_, buffer_pool_manager_, max_size, spilled)) {
+      txn->SetState(TransactionState::ABORTED);
+      return nullptr;
+    }
+    if (spilled.size_ < tuple.size_) {
+      stored = &spilled;
+    }
+  }
+  // larger than one page size
+  if (stored->size_ + 32 > page_size) {
+    txn->SetState(TransactionState::ABORTED);
+    return nullptr;
+  }
+  return stored;
+}
+
+bool TableHeap::UpdateInPlace(TablePage *page, const Tuple &tuple,
+                              Tuple &old_tuple, const RID &rid,
+                              Transaction *txn) {
+  int32_t room = page->GetRoomFor(rid);
+  if (room <= 0 || tuple.size_ <= room) {
+    // it fits, the update failed for another reason
+    return false;
+  }
+  Tuple spilled;
+  if (!tuple.Spill(schema_, buffer_pool_manager_, room, spilled)) {
+    return false;
+  }
+  if (spilled.size_ <= room &&
+      page->UpdateTuple(spilled, old_tuple, rid, txn, lock_manager_,
+                        log_manager_, first_page_id_)) {
+    return true;
+  }
+  // the chains spilled here go again
+  FreeChains(spilled, tuple.GetOverflowPages(schema_));
+  return false;
+}
+
+/*
+ * A scan locks the whole table shared, its tuples need no locks then. A
+ * scan for update takes U, so two of them do not both wait to write.
+ * Snapshot and optimistic scans take none
+ */
+bool TableHeap::LockScan(Transaction *txn, bool for_update) {
+  if (ENABLE_LOGGING && version_store_ == nullptr && !txn->IsOptimistic()) {
+    return lock_manager_->LockTable(
+        txn, first_page_id_, for_update ? LockMode::UPDATE : LockMode::SHARED);
+  }
+  return true;
+}
+
+bool TableHeap::LockRow(const RID &rid, Transaction *txn, bool exclusive) {
+  // snapshot reads and optimistic transactions take no locks
+  if (!ENABLE_LOGGING || txn == nullptr || txn->IsOptimistic() ||
+      (!exclusive && version_store_ != nullptr)) {
+    return true;
+  }
+  if (txn->GetExclusiveLockSet()->count(rid) != 0) {
+    return true;
+  }
+  bool shared = txn->GetSharedLockSet()->count(rid) != 0;
+  if (!exclusive) {
+    return shared || lock_manager_->LockShared(txn, rid, first_page_id_);
+  }
+  if (shared) {
+    return lock_manager_->LockUpgrade(txn, rid, first_page_id_);
+  }
+  return lock_manager_->LockExclusive(txn, rid, first_page_id_);
+}
+bool TableHeap::LockInsert(page_id_t page_id, Transaction *txn) {
+  return !ENABLE_LOGGING ||
+         lock_manager_->LockPage(txn, first_page_id_, page_id,
+                                 LockMode::INTENTION_EXCLUSIVE);
+}
+
+size_t TableHeap::CountTuples(int threads) {
+  std::atomic<size_t> count(0);
+  ParallelScan(threads, [&count](int, const Tuple &) {
+    count.fetch_add(1, std::memory_order_relaxed);
+  });
+  return count;
 }
 
 TableIterator TableHeap::end() {
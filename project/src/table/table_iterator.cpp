@@ -8,55 +8,225 @@
 
 namespace cmudb {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
-  if (rid.GetPageId() != INVALID_PAGE_ID) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                             const std::vector<ScanRange> &ranges,
+                             const ScanFilter &filter)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn),
+      ranges_(ranges), filter_(filter) {
+  if (rid.GetPageId() == INVALID_PAGE_ID) {
+    return;
   }
-};
+  BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
+  auto cur_page =
+      static_cast<TablePage *>(buffer_pool_manager->FetchPage(rid.GetPageId()));
+  assert(cur_page != nullptr); // all pages are pinned
+  cur_page->RLatch();
+  // a filtered scan in place starts at the first selected slot
+  bool selected = true;
+  if (!filter_.IsEmpty() && !SkipsUnseen()) {
+    RID first_rid;
+    selected = NextSelected(cur_page, true, first_rid);
+    if (selected) {
+      tuple_->rid_ = first_rid;
+    }
+  }
+  bool seen = selected && Read(cur_page) && Matches();
+  cur_page->RUnlatch();
+  buffer_pool_manager->UnpinPage(rid.GetPageId(), false);
+  if (!selected || (!seen && SkipsUnseen())) {
+    // a snapshot scan starts at the first slot, seen or not
+    ++(*this);
+  }
+}
+
+TableIterator::TableIterator(const TableIterator &other)
+    : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)),
+      txn_(other.txn_), view_(other.view_), copied_(other.copied_),
+      read_ahead_page_id_(other.read_ahead_page_id_),
+      ranges_(other.ranges_), filter_(other.filter_),
+      selection_(other.selection_), selected_(other.selected_),
+      selection_page_id_(other.selection_page_id_),
+      selection_end_(other.selection_end_) {}
+
+TableIterator &TableIterator::operator=(const TableIterator &other) {
+  if (this == &other) {
+    return *this;
+  }
+  table_heap_ = other.table_heap_;
+  *tuple_ = *other.tuple_;
+  txn_ = other.txn_;
+  view_ = other.view_;
+  copied_ = other.copied_;
+  read_ahead_page_id_ = other.read_ahead_page_id_;
+  ranges_ = other.ranges_;
+  filter_ = other.filter_;
+  selection_ = other.selection_;
+  selected_ = other.selected_;
+  selection_page_id_ = other.selection_page_id_;
+  selection_end_ = other.selection_end_;
+  return *this;
+}
 
 const Tuple &TableIterator::operator*() {
   assert(*this != table_heap_->end());
+  Copy();
   return *tuple_;
 }
 
 Tuple *TableIterator::operator->() {
   assert(*this != table_heap_->end());
+  Copy();
   return tuple_;
 }
 
+Value TableIterator::GetValue(Schema *schema, int column_id, Arena *arena) {
+  assert(*this != table_heap_->end());
+  if (copied_) {
+    return tuple_->GetValue(schema, column_id, arena);
+  }
+  return view_.GetValue(schema, column_id, arena);
+}
+
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
   auto cur_page = static_cast<TablePage *>(
       buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
   assert(cur_page != nullptr); // all pages are pinned
+  cur_page->RLatch();
+  ReadAhead(cur_page);
 
-  RID next_tuple_rid;
-  if (!cur_page->GetNextTupleRid(tuple_->rid_,
-                                 next_tuple_rid)) { // end of this page
-    while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(
-          buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
-      if (cur_page->GetFirstTupleRid(next_tuple_rid))
-        break;
+  bool skip = SkipsUnseen();
+  while (true) {
+    RID next_tuple_rid;
+    if (!NextTupleRid(cur_page, next_tuple_rid)) { // end of this page
+      page_id_t next_page_id;
+      while ((next_page_id = NextPageId(cur_page)) != INVALID_PAGE_ID) {
+        auto next_page = static_cast<TablePage *>(
+            buffer_pool_manager->FetchPage(next_page_id));
+        cur_page->RUnlatch();
+        buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
+        cur_page = next_page;
+        cur_page->RLatch();
+        ReadAhead(cur_page);
+        if (FirstTupleRid(cur_page, next_tuple_rid))
+          break;
+      }
     }
-  }
-  tuple_->rid_ = next_tuple_rid;
+    tuple_->rid_ = next_tuple_rid;
 
-  if (*this != table_heap_->end()) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    if (*this == table_heap_->end() || (Read(cur_page) && Matches()) ||
+        !skip ||
+        (txn_ != nullptr &&
+         txn_->GetState() == TransactionState::ABORTED)) {
+      break;
+    }
   }
   // release until copy the tuple
   cur_page->RUnlatch();
   buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
+  if (*this == table_heap_->end()) {
+    view_.Release();
+  }
   return *this;
 }
 
+/*
+ * The page is latched already, a scan that reads it as it is only takes
+ * the locks and points the view at the tuple
+ */
+bool TableIterator::Read(TablePage *cur_page) {
+  if (SkipsUnseen()) {
+    copied_ = true;
+    return table_heap_->ReadTuple(cur_page, tuple_->rid_, *tuple_, txn_);
+  }
+  copied_ = false;
+  view_.Reset(table_heap_->buffer_pool_manager_, tuple_->rid_);
+  return cur_page->LockTuple(tuple_->rid_, txn_, table_heap_->lock_manager_,
+                             table_heap_->first_page_id_);
+}
+
+void TableIterator::Copy() {
+  if (!copied_) {
+    RID rid = tuple_->rid_;
+    if (!view_.Materialize(*tuple_)) {
+      tuple_->size_ = 0;
+    }
+    tuple_->rid_ = rid;
+    copied_ = true;
+  }
+}
+
+/*
+ * Pages only know their successor, so read ahead one page down the chain:
+ * the next page is loaded while the tuples of this one are consumed
+ */
+void TableIterator::ReadAhead(TablePage *cur_page) {
+  page_id_t next_page_id = NextPageId(cur_page);
+  if (next_page_id != INVALID_PAGE_ID && next_page_id != read_ahead_page_id_) {
+    table_heap_->buffer_pool_manager_->Prefetch(next_page_id);
+    read_ahead_page_id_ = next_page_id;
+  }
+}
+
+page_id_t TableIterator::NextPageId(TablePage *cur_page) {
+  ZoneMap *zone_map = table_heap_->zone_map_;
+  if (ranges_.empty() || zone_map == nullptr) {
+    return cur_page->GetNextPageId();
+  }
+  return zone_map->NextPage(cur_page->GetPageId(), ranges_);
+}
+
+bool TableIterator::SkipsUnseen() { return table_heap_->ReadsCopies(txn_); }
+
+/*
+ * A snapshot scan visits every slot, its tuple may be deleted by now or not
+ * be seen yet. A filtered scan in place visits the selected ones only
+ */
+bool TableIterator::FirstTupleRid(TablePage *cur_page, RID &rid) {
+  if (!filter_.IsEmpty() && !SkipsUnseen()) {
+    return NextSelected(cur_page, true, rid);
+  }
+  return cur_page->GetFirstTupleRid(rid,
+                                    table_heap_->version_store_ != nullptr);
+}
+
+bool TableIterator::NextTupleRid(TablePage *cur_page, RID &rid) {
+  if (!filter_.IsEmpty() && !SkipsUnseen()) {
+    return NextSelected(cur_page, false, rid);
+  }
+  return cur_page->GetNextTupleRid(tuple_->rid_, rid,
+                                   table_heap_->version_store_ != nullptr);
+}
+
+/*
+ * Slots inserted behind the selected ones while the page was not latched
+ * are selected when those are passed, as a scan without a filter would
+ * still reach them
+ */
+bool TableIterator::NextSelected(TablePage *cur_page, bool first, RID &rid) {
+  if (first || cur_page->GetPageId() != selection_page_id_) {
+    selection_page_id_ = cur_page->GetPageId();
+    selection_.clear();
+    selected_ = 0;
+    selection_end_ = 0;
+  } else if (selected_ < selection_.size()) {
+    ++selected_;
+  }
+  if (selected_ == selection_.size()) {
+    selection_end_ = filter_.Select(cur_page, selection_end_, selection_);
+    selected_ = 0;
+    if (selection_.empty()) {
+      return false;
+    }
+  }
+  rid.Set(selection_page_id_, selection_[selected_]);
+  return true;
+}
+
+bool TableIterator::Matches() {
+  return filter_.IsEmpty() || !copied_ || filter_.Matches(*tuple_);
+}
+
 TableIterator TableIterator::operator++(int) {
   TableIterator clone(*this);
   ++(*this);
@@ -0,0 +1,200 @@
+/**
+ * table_stats.cpp
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "table/table_heap.h"
+#include "table/table_stats.h"
+
+namespace cmudb {
+
+static bool LessThan(const Value &a, const Value &b) {
+  return a.CompareLessThan(b) == CMP_TRUE;
+}
+
+TableStats::TableStats(Schema *schema, size_t page_size, size_t sample_size)
+    : schema_(schema), page_size_(page_size), sample_size_(sample_size),
+      columns_(schema->GetColumnCount()) {}
+
+void TableStats::Gather(TableHeap *table_heap) {
+  std::lock_guard<std::mutex> lock(latch_);
+  sample_.clear();
+  rows_seen_ = 0;
+  inserted_bytes_ = 0;
+  std::unordered_set<page_id_t> pages;
+  // one worker, the reservoir takes the tuples one at a time
+  table_heap->ParallelScan(1, [&](int, const Tuple &tuple) {
+    Sample(tuple);
+    pages.insert(tuple.GetRid().GetPageId());
+  });
+  row_count_ = rows_seen_;
+  page_count_ = std::max<size_t>(pages.size(), 1);
+  changed_ = 0;
+  stale_ = true;
+}
+
+void TableStats::RecordInsert(const Tuple &tuple) {
+  std::lock_guard<std::mutex> lock(latch_);
+  Sample(tuple);
+  row_count_++;
+  inserted_bytes_ += tuple.GetLength() + 2 * sizeof(int32_t);
+  changed_++;
+}
+
+void TableStats::RecordDelete() {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (row_count_ > 0)
+    row_count_--;
+  changed_++;
+}
+
+size_t TableStats::GetRowCount() {
+  std::lock_guard<std::mutex> lock(latch_);
+  return row_count_;
+}
+
+size_t TableStats::GetPageCount() {
+  std::lock_guard<std::mutex> lock(latch_);
+  return std::max<size_t>(page_count_, 1) + inserted_bytes_ / page_size_;
+}
+
+ColumnStats TableStats::GetColumnStats(int column_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  Refresh();
+  return columns_[column_id];
+}
+
+double TableStats::EstimateEquals(int column_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  Refresh();
+  return 1.0 / columns_[column_id].distinct_count;
+}
+
+double TableStats::EstimateEquals(int column_id, const Value &value) {
+  std::lock_guard<std::mutex> lock(latch_);
+  Refresh();
+  if (sample_.empty())
+    return 1.0 / columns_[column_id].distinct_count;
+  size_t matches = 0;
+  for (auto &tuple : sample_) {
+    if (tuple.GetValue(schema_, column_id).CompareEquals(value) == CMP_TRUE)
+      matches++;
+  }
+  // seen more than once, a frequent value; else one of the rare ones
+  if (matches > 1)
+    return static_cast<double>(matches) / sample_.size();
+  return std::min(1.0 / columns_[column_id].distinct_count,
+                  std::max(matches, size_t(1)) /
+                      static_cast<double>(sample_.size()));
+}
+
+double TableStats::EstimateRange(int column_id, const Value *low,
+                                 const Value *high) {
+  std::lock_guard<std::mutex> lock(latch_);
+  Refresh();
+  const ColumnStats &stats = columns_[column_id];
+  if (stats.bounds.empty())
+    return 1;
+  double below_high = high == nullptr ? 1 : ShareBelow(stats, *high, true);
+  double below_low = low == nullptr ? 0 : ShareBelow(stats, *low, false);
+  double nulls = static_cast<double>(stats.null_count) / sample_.size();
+  return std::max(0.0, below_high - below_low) * (1 - nulls);
+}
+
+/*
+ * Algorithm R: the n-th tuple replaces a sampled one with probability
+ * sample_size / n
+ */
+void TableStats::Sample(const Tuple &tuple) {
+  rows_seen_++;
+  if (sample_.size() < sample_size_) {
+    sample_.push_back(tuple);
+    sample_.back().Detach();
+    return;
+  }
+  std::uniform_int_distribution<size_t> pick(0, rows_seen_ - 1);
+  size_t slot = pick(random_);
+  if (slot < sample_size_) {
+    sample_[slot] = tuple;
+    sample_[slot].Detach();
+  }
+}
+
+void TableStats::Refresh() {
+  if (!stale_ && changed_ <= STATS_REBUILD_SHARE * row_count_)
+    return;
+  stale_ = false;
+  changed_ = 0;
+  size_t n = sample_.size();
+  for (int column_id = 0; column_id < schema_->GetColumnCount();
+       column_id++) {
+    ColumnStats &stats = columns_[column_id];
+    stats = ColumnStats();
+    std::vector<Value> values;
+    values.reserve(n);
+    for (auto &tuple : sample_) {
+      Value value = tuple.GetValue(schema_, column_id);
+      if (value.IsNull())
+        stats.null_count++;
+      else
+        values.push_back(value);
+    }
+    std::sort(values.begin(), values.end(), LessThan);
+
+    // frequencies of the frequencies, for the distinct values estimate
+    std::unordered_map<size_t, size_t> frequencies;
+    size_t distinct = 0;
+    for (size_t i = 0; i < values.size();) {
+      size_t j = i + 1;
+      while (j < values.size() &&
+             values[j].CompareEquals(values[i]) == CMP_TRUE)
+        j++;
+      frequencies[j - i]++;
+      distinct++;
+      i = j;
+    }
+    if (rows_seen_ <= n || n == 0) {
+      // the sample is the table
+      stats.distinct_count = distinct;
+    } else {
+      // GEE: the values seen once stand for sqrt(N/n) values each
+      double once = frequencies[1];
+      stats.distinct_count = std::sqrt(static_cast<double>(row_count_) / n) *
+                                 once +
+                             (distinct - once);
+    }
+    stats.distinct_count = std::max(stats.distinct_count, 1.0);
+
+    size_t buckets = std::min<size_t>(STATS_HISTOGRAM_BUCKETS, values.size());
+    for (size_t b = 1; b <= buckets; b++) {
+      stats.bounds.push_back(values[b * values.size() / buckets - 1]);
+    }
+  }
+}
+
+/*
+ * Whole buckets below the value count fully, the one it falls in by half
+ */
+double TableStats::ShareBelow(const ColumnStats &stats, const Value &value,
+                              bool inclusive) {
+  size_t buckets = stats.bounds.size();
+  size_t bucket = 0;
+  while (bucket < buckets &&
+         (LessThan(stats.bounds[bucket], value) ||
+          (inclusive &&
+           stats.bounds[bucket].CompareEquals(value) == CMP_TRUE)))
+    bucket++;
+  if (bucket == buckets)
+    return 1;
+  if (!inclusive && bucket > 0 &&
+      stats.bounds[bucket - 1].CompareEquals(value) == CMP_TRUE)
+    return static_cast<double>(bucket) / buckets;
+  return (bucket + 0.5) / buckets;
+}
+
+} // namespace cmudb
@@ -2,11 +2,14 @@
  * tuple.cpp
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <sstream>
 
 #include "common/logger.h"
+#include "common/memory_tracker.h"
+#include "table/overflow_chain.h"
 #include "table/tuple.h"
 
 namespace cmudb {
@@ -15,36 +18,97 @@ Tuple::Tuple(std::vector<Value> values, Schema *schema) : allocated_(true) {
   assert((int)values.size() == schema->GetColumnCount());
 
   // step1: calculate size of the tuple
+  // allocate memory using new, allocated_ flag set as true
+  size_ = GetSerializedSize(values, schema);
+  data_ = Allocate(size_);
+
+  // step2: Serialize each column(attribute) based on input value
+  SerializeValues(values, schema);
+}
+
+Tuple::Tuple(const std::vector<Value> &values, Schema *schema, Arena *arena)
+    : allocated_(false) {
+  assert((int)values.size() == schema->GetColumnCount());
+  size_ = GetSerializedSize(values, schema);
+  data_ = arena->Allocate(size_);
+  SerializeValues(values, schema);
+}
+
+/*
+ * Owned data is counted as TUPLE memory. The size goes in front of it, a
+ * tuple may be resized or handed its data by a table page before it frees
+ */
+char *Tuple::Allocate(int32_t size) {
+  size_t bytes = sizeof(uint64_t) + static_cast<size_t>(size);
+  char *block = new char[bytes];
+  *reinterpret_cast<uint64_t *>(block) = bytes;
+  MemoryTracker::Instance().Charge(MemoryConsumer::TUPLE, bytes);
+  return block + sizeof(uint64_t);
+}
+
+void Tuple::Free(char *data) {
+  if (data == nullptr)
+    return;
+  char *block = data - sizeof(uint64_t);
+  MemoryTracker::Instance().Release(MemoryConsumer::TUPLE,
+                                    *reinterpret_cast<uint64_t *>(block));
+  delete[] block;
+}
+
+int32_t Tuple::GetSerializedSize(const std::vector<Value> &values,
+                                 Schema *schema) {
   int32_t tuple_size = schema->GetLength();
+  if (schema->IsFixedLayout())
+    return tuple_size;
   for (auto &i : schema->GetUnlinedColumns())
     tuple_size += (values[i].GetLength() + sizeof(uint32_t));
-  // allocate memory using new, allocated_ flag set as true
-  size_ = tuple_size;
-  data_ = new char[size_];
+  return tuple_size;
+}
 
-  // step2: Serialize each column(attribute) based on input value
+/*
+ * A value of the type of its column goes through the serializer the schema
+ * bound, others through their Type
+ */
+void Tuple::SerializeValues(const std::vector<Value> &values,
+                            Schema *schema) {
   int column_count = schema->GetColumnCount();
+  if (schema->IsFixedLayout()) {
+    // every column at its offset, nothing behind
+    for (int i = 0; i < column_count; i++) {
+      char *storage = data_ + schema->GetOffset(i);
+      if (values[i].GetTypeId() == schema->GetType(i))
+        schema->GetSerializer(i)(values[i], storage);
+      else
+        values[i].SerializeTo(storage);
+    }
+    return;
+  }
   int32_t offset = schema->GetLength();
   for (int i = 0; i < column_count; i++) {
+    char *storage = data_ + schema->GetOffset(i);
     if (!schema->IsInlined(i)) {
       // Serialize relative offset, where the actual varchar data is stored
-      *reinterpret_cast<int32_t *>(data_ + schema->GetOffset(i)) = offset;
-      // Serialize varchar value, in place(size+data)
-      values[i].SerializeTo(data_ + offset);
+      *reinterpret_cast<int32_t *>(storage) = offset;
+      storage = data_ + offset;
+      // varchar value in place(size+data)
       offset += (values[i].GetLength() + sizeof(uint32_t));
-    } else {
-      values[i].SerializeTo(data_ + schema->GetOffset(i));
     }
+    StoredSerializer serializer = schema->GetSerializer(i);
+    if (serializer != nullptr && values[i].GetTypeId() == schema->GetType(i))
+      serializer(values[i], storage);
+    else
+      values[i].SerializeTo(storage);
   }
 }
 
 // Copy constructor
 Tuple::Tuple(const Tuple &other)
-    : allocated_(other.allocated_), rid_(other.rid_), size_(other.size_) {
+    : allocated_(other.allocated_), rid_(other.rid_), size_(other.size_),
+      overflow_pool_(other.overflow_pool_) {
   // deep copy
   if (allocated_ == true) {
     // LOG_DEBUG("tuple deep copy");
-    data_ = new char[size_];
+    data_ = Allocate(size_);
     memcpy(data_, other.data_, size_);
   } else {
     // LOG_DEBUG("tuple shallow copy");
@@ -53,13 +117,18 @@ Tuple::Tuple(const Tuple &other)
 }
 
 Tuple &Tuple::operator=(const Tuple &other) {
+  if (this == &other)
+    return *this;
+  if (allocated_)
+    Free(data_);
   allocated_ = other.allocated_;
   rid_ = other.rid_;
   size_ = other.size_;
+  overflow_pool_ = other.overflow_pool_;
   // deep copy
   if (allocated_ == true) {
     // LOG_DEBUG("tuple deep copy");
-    data_ = new char[size_];
+    data_ = Allocate(size_);
     memcpy(data_, other.data_, size_);
   } else {
     // LOG_DEBUG("tuple shallow copy");
@@ -69,16 +138,89 @@ Tuple &Tuple::operator=(const Tuple &other) {
   return *this;
 }
 
+void Tuple::Detach() {
+  if (allocated_ || data_ == nullptr)
+    return;
+  char *data = Allocate(size_);
+  memcpy(data, data_, size_);
+  data_ = data;
+  allocated_ = true;
+}
+
 // Get the value of a specified column (const)
 Value Tuple::GetValue(Schema *schema, const int column_id) const {
   assert(schema);
   assert(data_);
-  const TypeId column_type = schema->GetType(column_id);
-  const char *data_ptr = GetDataPtr(schema, column_id);
+  // a fixed-size column straight from its offset
+  StoredCaster reader = schema->GetReader(column_id);
+  if (reader != nullptr && schema->IsInlined(column_id))
+    return reader(data_ + schema->GetOffset(column_id));
+  return DeserializeValue(GetDataPtr(schema, column_id),
+                          schema->GetType(column_id),
+                          schema->IsInlined(column_id), overflow_pool_);
+}
+
+Value Tuple::GetValue(Schema *schema, const int column_id,
+                      Arena *arena) const {
+  assert(schema);
+  assert(data_);
+  return DeserializeValue(GetDataPtr(schema, column_id),
+                          schema->GetType(column_id),
+                          schema->IsInlined(column_id), overflow_pool_, arena);
+}
+
+Value Tuple::DeserializeValue(const char *data_ptr, TypeId column_type,
+                              bool is_inlined, BufferPoolManager *overflow_pool,
+                              Arena *arena) {
+  uint32_t len = *reinterpret_cast<const uint32_t *>(data_ptr);
+  if (!is_inlined && len != PELOTON_VALUE_NULL &&
+      (len & VARCHAR_OVERFLOW_FLAG) != 0) {
+    // spilled, the prefix and then the chain
+    assert(overflow_pool != nullptr);
+    len &= ~VARCHAR_OVERFLOW_FLAG;
+    page_id_t first_page_id =
+        *reinterpret_cast<const page_id_t *>(data_ptr + sizeof(uint32_t));
+    std::vector<char> buffer;
+    char *data;
+    if (arena != nullptr) {
+      data = arena->Allocate(len);
+    } else {
+      buffer.resize(len);
+      data = buffer.data();
+    }
+    memcpy(data, data_ptr + sizeof(uint32_t) + sizeof(page_id_t),
+           OVERFLOW_PREFIX_SIZE);
+    if (!OverflowChain::Read(overflow_pool, first_page_id,
+                             data + OVERFLOW_PREFIX_SIZE,
+                             len - OVERFLOW_PREFIX_SIZE)) {
+      return Value(column_type);
+    }
+    return Value(column_type, data, len, arena == nullptr);
+  }
+  if (!is_inlined && arena != nullptr && len != PELOTON_VALUE_NULL) {
+    return Value(column_type, arena->Copy(data_ptr + sizeof(uint32_t), len),
+                 len, false);
+  }
   // the third parameter "is_inlined" is unused
   return Value::DeserializeFrom(data_ptr, column_type);
 }
 
+bool Tuple::GetStringView(Schema *schema, const int column_id,
+                          const char *&data, uint32_t &len) const {
+  assert(!schema->IsInlined(column_id));
+  return ViewString(GetDataPtr(schema, column_id), data, len);
+}
+
+bool Tuple::ViewString(const char *data_ptr, const char *&data,
+                       uint32_t &len) {
+  uint32_t stored = *reinterpret_cast<const uint32_t *>(data_ptr);
+  if (stored == PELOTON_VALUE_NULL || (stored & VARCHAR_OVERFLOW_FLAG) != 0)
+    return false;
+  data = data_ptr + sizeof(uint32_t);
+  len = stored == 0 ? 0 : stored - 1;
+  return true;
+}
+
 const char *Tuple::GetDataPtr(Schema *schema, const int column_id) const {
   assert(schema);
   assert(data_);
@@ -95,6 +237,106 @@ const char *Tuple::GetDataPtr(Schema *schema, const int column_id) const {
   }
 }
 
+int32_t Tuple::GetPayloadSize(const char *data_ptr) {
+  uint32_t len = *reinterpret_cast<const uint32_t *>(data_ptr);
+  if (len == PELOTON_VALUE_NULL) {
+    return sizeof(uint32_t);
+  }
+  if ((len & VARCHAR_OVERFLOW_FLAG) != 0) {
+    return sizeof(uint32_t) + sizeof(page_id_t) + OVERFLOW_PREFIX_SIZE;
+  }
+  return sizeof(uint32_t) + len;
+}
+
+/*
+ * Which varchars to spill is decided on their sizes first, then the tuple
+ * is laid out again with the payloads in column order
+ */
+bool Tuple::Spill(Schema *schema, BufferPoolManager *buffer_pool_manager,
+                  int32_t max_size, Tuple &spilled) const {
+  // a spilled varchar keeps this much of its payload
+  const int32_t stub_size =
+      sizeof(uint32_t) + sizeof(page_id_t) + OVERFLOW_PREFIX_SIZE;
+  std::vector<std::pair<int32_t, int>> payloads;
+  for (auto i : schema->GetUnlinedColumns()) {
+    uint32_t len = *reinterpret_cast<const uint32_t *>(GetDataPtr(schema, i));
+    if (len != PELOTON_VALUE_NULL && (len & VARCHAR_OVERFLOW_FLAG) == 0 &&
+        static_cast<int32_t>(sizeof(uint32_t) + len) > stub_size) {
+      payloads.emplace_back(sizeof(uint32_t) + len, i);
+    }
+  }
+  std::sort(payloads.begin(), payloads.end(),
+            [](const std::pair<int32_t, int> &a,
+               const std::pair<int32_t, int> &b) { return a.first > b.first; });
+  std::vector<bool> spill(schema->GetColumnCount(), false);
+  int32_t size = size_;
+  bool any = false;
+  for (auto &payload : payloads) {
+    if (size <= max_size) {
+      break;
+    }
+    spill[payload.second] = true;
+    size -= payload.first - stub_size;
+    any = true;
+  }
+  if (!any) {
+    spilled = *this;
+    return true;
+  }
+
+  std::vector<char> data(data_, data_ + schema->GetLength());
+  std::vector<page_id_t> chains;
+  for (auto i : schema->GetUnlinedColumns()) {
+    const char *data_ptr = GetDataPtr(schema, i);
+    *reinterpret_cast<int32_t *>(data.data() + schema->GetOffset(i)) =
+        data.size();
+    if (!spill[i]) {
+      data.insert(data.end(), data_ptr, data_ptr + GetPayloadSize(data_ptr));
+      continue;
+    }
+    uint32_t len = *reinterpret_cast<const uint32_t *>(data_ptr);
+    const char *payload = data_ptr + sizeof(uint32_t);
+    page_id_t first_page_id;
+    if (!OverflowChain::Write(buffer_pool_manager,
+                              payload + OVERFLOW_PREFIX_SIZE,
+                              len - OVERFLOW_PREFIX_SIZE, first_page_id)) {
+      for (page_id_t chain : chains) {
+        OverflowChain::Free(buffer_pool_manager, chain);
+      }
+      return false;
+    }
+    chains.push_back(first_page_id);
+    uint32_t flagged = len | VARCHAR_OVERFLOW_FLAG;
+    const char *stub = reinterpret_cast<const char *>(&flagged);
+    data.insert(data.end(), stub, stub + sizeof(uint32_t));
+    stub = reinterpret_cast<const char *>(&first_page_id);
+    data.insert(data.end(), stub, stub + sizeof(page_id_t));
+    data.insert(data.end(), payload, payload + OVERFLOW_PREFIX_SIZE);
+  }
+  if (spilled.allocated_)
+    Free(spilled.data_);
+  spilled.allocated_ = true;
+  spilled.rid_ = rid_;
+  spilled.size_ = data.size();
+  spilled.data_ = Allocate(spilled.size_);
+  memcpy(spilled.data_, data.data(), spilled.size_);
+  spilled.overflow_pool_ = buffer_pool_manager;
+  return true;
+}
+
+std::vector<page_id_t> Tuple::GetOverflowPages(Schema *schema) const {
+  std::vector<page_id_t> pages;
+  for (auto i : schema->GetUnlinedColumns()) {
+    const char *data_ptr = GetDataPtr(schema, i);
+    uint32_t len = *reinterpret_cast<const uint32_t *>(data_ptr);
+    if (len != PELOTON_VALUE_NULL && (len & VARCHAR_OVERFLOW_FLAG) != 0) {
+      pages.push_back(
+          *reinterpret_cast<const page_id_t *>(data_ptr + sizeof(uint32_t)));
+    }
+  }
+  return pages;
+}
+
 std::string Tuple::ToString(Schema *schema) const {
   std::stringstream os;
 
@@ -130,8 +372,8 @@ void Tuple::DeserializeFrom(const char *storage) {
   // construct a tuple
   this->size_ = size;
   if (this->allocated_)
-    delete[] this->data_;
-  this->data_ = new char[this->size_];
+    Free(this->data_);
+  this->data_ = Allocate(this->size_);
   memcpy(this->data_, storage + sizeof(int32_t), this->size_);
   this->allocated_ = true;
 }
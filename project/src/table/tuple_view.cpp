@@ -0,0 +1,80 @@
+/**
+ * tuple_view.cpp
+ */
+
+#include <cassert>
+
+#include "table/tuple_view.h"
+
+namespace cmudb {
+
+TupleView::TupleView(const TupleView &other) : TupleView() {
+  if (other.IsValid()) {
+    Reset(other.buffer_pool_manager_, other.rid_);
+  }
+}
+
+TupleView &TupleView::operator=(const TupleView &other) {
+  if (this == &other) {
+    return *this;
+  }
+  if (other.IsValid()) {
+    Reset(other.buffer_pool_manager_, other.rid_);
+  } else {
+    Release();
+  }
+  return *this;
+}
+
+bool TupleView::Reset(BufferPoolManager *buffer_pool_manager,
+                      const RID &rid) {
+  if (page_ != nullptr && buffer_pool_manager == buffer_pool_manager_ &&
+      rid.GetPageId() == rid_.GetPageId()) {
+    rid_ = rid;
+    return true;
+  }
+  Release();
+  auto page = static_cast<TablePage *>(
+      buffer_pool_manager->FetchPage(rid.GetPageId()));
+  if (page == nullptr) {
+    return false;
+  }
+  buffer_pool_manager_ = buffer_pool_manager;
+  page_ = page;
+  rid_ = rid;
+  return true;
+}
+
+void TupleView::Release() {
+  if (page_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(rid_.GetPageId(), false);
+    page_ = nullptr;
+  }
+}
+
+Value TupleView::GetValue(Schema *schema, int column_id, Arena *arena) {
+  assert(page_ != nullptr);
+  page_->RLatch();
+  const char *data_ptr = page_->GetColumnData(rid_, schema, column_id);
+  if (data_ptr == nullptr) {
+    page_->RUnlatch();
+    return Value(schema->GetType(column_id));
+  }
+  // the value copies what it needs before the latch goes
+  Value value = Tuple::DeserializeValue(data_ptr, schema->GetType(column_id),
+                                        schema->IsInlined(column_id),
+                                        buffer_pool_manager_, arena);
+  page_->RUnlatch();
+  return value;
+}
+
+bool TupleView::Materialize(Tuple &tuple) {
+  assert(page_ != nullptr);
+  page_->RLatch();
+  bool res = page_->ReadTuple(rid_, tuple);
+  page_->RUnlatch();
+  tuple.overflow_pool_ = buffer_pool_manager_;
+  return res;
+}
+
+} // namespace cmudb
@@ -0,0 +1,199 @@
+/**
+ * zone_map.cpp
+ */
+
+#include <cassert>
+
+#include "page/table_page.h"
+#include "table/zone_map.h"
+#include "type/batch_kernels.h"
+
+namespace cmudb {
+
+ZoneMap::ZoneMap(Schema *schema, const std::vector<int> &column_ids)
+    : schema_(schema), column_ids_(column_ids),
+      slot_of_(schema->GetColumnCount(), -1) {
+  for (size_t i = 0; i < column_ids_.size(); i++) {
+    slot_of_[column_ids_[i]] = static_cast<int>(i);
+  }
+}
+
+void ZoneMap::Rebuild(BufferPoolManager *buffer_pool_manager,
+                      page_id_t first_page_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  page_ids_.clear();
+  zones_.clear();
+  index_of_.clear();
+  // fixed-size columns are read by the batch kernels, others as Values
+  bool inlined = true;
+  for (int column_id : column_ids_) {
+    inlined = inlined && schema_->IsInlined(column_id);
+  }
+  page_id_t page_id = first_page_id;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager->FetchPage(page_id));
+    assert(page != nullptr); // all pages are pinned
+    page->RLatch();
+    Zone &zone = zones_[IndexOf(page_id)];
+    // the columns of the page side by side, for the batch kernels
+    std::vector<std::vector<char>> columns(column_ids_.size());
+    size_t count = 0;
+    RID rid;
+    Tuple tuple;
+    for (bool more = page->GetFirstTupleRid(rid); more;
+         more = page->GetNextTupleRid(rid, rid)) {
+      if (!page->ReadTuple(rid, tuple))
+        continue;
+      if (!inlined) {
+        tuple.SetOverflowPool(buffer_pool_manager);
+        Widen(zone, tuple);
+        continue;
+      }
+      for (size_t i = 0; i < column_ids_.size(); i++) {
+        const char *data = tuple.GetData() + schema_->GetOffset(column_ids_[i]);
+        columns[i].insert(columns[i].end(), data,
+                          data + schema_->GetLength(column_ids_[i]));
+      }
+      count++;
+    }
+    if (inlined)
+      Summarize(zone, columns, count);
+    page_id_t next_page_id = page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+void ZoneMap::AddPage(page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(latch_);
+  IndexOf(page_id);
+}
+
+void ZoneMap::Record(page_id_t page_id, const Tuple &tuple) {
+  std::lock_guard<std::mutex> lock(latch_);
+  Widen(zones_[IndexOf(page_id)], tuple);
+}
+
+bool ZoneMap::IsTracked(int column_id) const {
+  return column_id >= 0 && column_id < static_cast<int>(slot_of_.size()) &&
+         slot_of_[column_id] != -1;
+}
+
+bool ZoneMap::MayMatch(page_id_t page_id,
+                       const std::vector<ScanRange> &ranges) {
+  std::lock_guard<std::mutex> lock(latch_);
+  auto it = index_of_.find(page_id);
+  return it == index_of_.end() || Overlaps(zones_[it->second], ranges);
+}
+
+page_id_t ZoneMap::NextPage(page_id_t page_id,
+                            const std::vector<ScanRange> &ranges) {
+  std::lock_guard<std::mutex> lock(latch_);
+  size_t index = 0;
+  if (page_id != INVALID_PAGE_ID) {
+    auto it = index_of_.find(page_id);
+    assert(it != index_of_.end());
+    index = it->second + 1;
+  }
+  for (; index < page_ids_.size(); index++) {
+    if (Overlaps(zones_[index], ranges)) {
+      return page_ids_[index];
+    }
+  }
+  return INVALID_PAGE_ID;
+}
+
+size_t ZoneMap::GetPageCount() {
+  std::lock_guard<std::mutex> lock(latch_);
+  return page_ids_.size();
+}
+
+void ZoneMap::Widen(Zone &zone, const Tuple &tuple) {
+  for (size_t i = 0; i < column_ids_.size(); i++) {
+    Value value = tuple.GetValue(schema_, column_ids_[i]);
+    if (value.IsNull()) {
+      continue;
+    }
+    if (zone.empty) {
+      zone.min.assign(column_ids_.size(), Value(TypeId::INVALID));
+      zone.max.assign(column_ids_.size(), Value(TypeId::INVALID));
+      zone.empty = false;
+    }
+    // a null bound is one no value widened yet
+    if (zone.min[i].IsNull() ||
+        value.CompareLessThan(zone.min[i]) == CMP_TRUE) {
+      zone.min[i] = value;
+    }
+    if (zone.max[i].IsNull() ||
+        value.CompareGreaterThan(zone.max[i]) == CMP_TRUE) {
+      zone.max[i] = value;
+    }
+  }
+}
+
+/*
+ * The same as Widen with each of count tuples, its columns gathered in
+ * columns: a column of nulls keeps a null range
+ */
+void ZoneMap::Summarize(Zone &zone,
+                        const std::vector<std::vector<char>> &columns,
+                        size_t count) {
+  std::vector<Value> min, max;
+  bool empty = true;
+  for (size_t i = 0; i < column_ids_.size(); i++) {
+    TypeId type_id = schema_->GetType(column_ids_[i]);
+    min.push_back(BatchKernels::Min(type_id, columns[i].data(), count));
+    max.push_back(BatchKernels::Max(type_id, columns[i].data(), count));
+    empty = empty && min.back().IsNull();
+  }
+  if (empty) {
+    return;
+  }
+  zone.min = std::move(min);
+  zone.max = std::move(max);
+  zone.empty = false;
+}
+
+/*
+ * A page without a tuple has none in range, one with only nulls in a
+ * column none of that column
+ */
+bool ZoneMap::Overlaps(const Zone &zone,
+                       const std::vector<ScanRange> &ranges) {
+  for (auto &range : ranges) {
+    if (!IsTracked(range.column_id)) {
+      continue;
+    }
+    if (zone.empty) {
+      return false;
+    }
+    int slot = slot_of_[range.column_id];
+    if (zone.min[slot].IsNull()) {
+      return false;
+    }
+    if (range.has_low &&
+        zone.max[slot].CompareLessThan(range.low) == CMP_TRUE) {
+      return false;
+    }
+    if (range.has_high &&
+        zone.min[slot].CompareGreaterThan(range.high) == CMP_TRUE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t ZoneMap::IndexOf(page_id_t page_id) {
+  auto it = index_of_.find(page_id);
+  if (it != index_of_.end()) {
+    return it->second;
+  }
+  index_of_[page_id] = page_ids_.size();
+  page_ids_.push_back(page_id);
+  zones_.emplace_back();
+  return page_ids_.size() - 1;
+}
+
+} // namespace cmudb
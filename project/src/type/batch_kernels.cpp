@@ -0,0 +1,82 @@
+/**
+ * batch_kernels.cpp
+ */
+#include "type/batch_kernels.h"
+#include "type/type_dispatch.h"
+
+namespace cmudb {
+
+size_t BatchKernels::Select(TypeId type_id, const char *column, size_t count,
+                            BatchCmp op, const Value &constant,
+                            uint32_t *selection) {
+  if (constant.IsNull())
+    return 0;
+  Value cast = constant.CastAs(type_id);
+  return DispatchType(type_id, [&](auto id) {
+    typedef StoredTypeOf<decltype(id)> T;
+    return Select(reinterpret_cast<const T *>(column), count, op,
+                  cast.GetAs<T>(), selection);
+  });
+}
+
+void BatchKernels::Add(TypeId type_id, const char *left, const char *right,
+                       char *result, size_t count) {
+  DispatchType(type_id, [&](auto id) {
+    typedef StoredTypeOf<decltype(id)> T;
+    Add(reinterpret_cast<const T *>(left), reinterpret_cast<const T *>(right),
+        reinterpret_cast<T *>(result), count);
+  });
+}
+
+void BatchKernels::Subtract(TypeId type_id, const char *left,
+                            const char *right, char *result, size_t count) {
+  DispatchType(type_id, [&](auto id) {
+    typedef StoredTypeOf<decltype(id)> T;
+    Subtract(reinterpret_cast<const T *>(left),
+             reinterpret_cast<const T *>(right),
+             reinterpret_cast<T *>(result), count);
+  });
+}
+
+void BatchKernels::Multiply(TypeId type_id, const char *left,
+                            const char *right, char *result, size_t count) {
+  DispatchType(type_id, [&](auto id) {
+    typedef StoredTypeOf<decltype(id)> T;
+    Multiply(reinterpret_cast<const T *>(left),
+             reinterpret_cast<const T *>(right),
+             reinterpret_cast<T *>(result), count);
+  });
+}
+
+Value BatchKernels::Min(TypeId type_id, const char *column, size_t count) {
+  return DispatchType(type_id, [&](auto id) {
+    typedef StoredTypeOf<decltype(id)> T;
+    T min = Null<T>();
+    Min(reinterpret_cast<const T *>(column), count, min);
+    return Value(type_id, min);
+  });
+}
+
+Value BatchKernels::Max(TypeId type_id, const char *column, size_t count) {
+  return DispatchType(type_id, [&](auto id) {
+    typedef StoredTypeOf<decltype(id)> T;
+    T max = Null<T>();
+    Max(reinterpret_cast<const T *>(column), count, max);
+    return Value(type_id, max);
+  });
+}
+
+Value BatchKernels::Sum(TypeId type_id, const char *column, size_t count) {
+  return DispatchType(type_id, [&](auto id) {
+    typedef StoredTypeOf<decltype(id)> T;
+    typedef typename std::conditional<std::is_integral<T>::value, int64_t,
+                                      double>::type Sum;
+    TypeId sum_type_id =
+        std::is_integral<T>::value ? TypeId::BIGINT : TypeId::DECIMAL;
+    Sum sum = Null<Sum>();
+    BatchKernels::Sum(reinterpret_cast<const T *>(column), count, sum);
+    return Value(sum_type_id, sum);
+  });
+}
+
+} // namespace cmudb
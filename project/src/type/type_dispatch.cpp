@@ -0,0 +1,99 @@
+/**
+ * type_dispatch.cpp
+ */
+#include <cstring>
+
+#include "type/type_dispatch.h"
+#include "type/type_util.h"
+
+namespace cmudb {
+
+// stored values of keys are not aligned
+template <typename T> static inline T Load(const char *storage) {
+  T value;
+  memcpy(&value, storage, sizeof(T));
+  return value;
+}
+
+template <TypeId Left, TypeId Right>
+static int CompareStored(const char *left, const char *right) {
+  auto x = Load<typename StoredType<Left>::type>(left);
+  auto y = Load<typename StoredType<Right>::type>(right);
+  if (x == StoredType<Left>::Null() || y == StoredType<Right>::Null())
+    return 0;
+  return (x > y) - (x < y);
+}
+
+// length prefixed, the length counting a terminating null
+static int CompareStoredVarchar(const char *left, const char *right) {
+  uint32_t len1 = Load<uint32_t>(left);
+  uint32_t len2 = Load<uint32_t>(right);
+  if (len1 == PELOTON_VALUE_NULL || len2 == PELOTON_VALUE_NULL)
+    return 0;
+  int cmp = TypeUtil::CompareStrings(
+      left + sizeof(uint32_t), len1 == 0 ? 0 : static_cast<int>(len1 - 1),
+      right + sizeof(uint32_t), len2 == 0 ? 0 : static_cast<int>(len2 - 1));
+  return (cmp > 0) - (cmp < 0);
+}
+
+template <TypeId Id>
+static void SerializeStored(const Value &value, char *storage) {
+  auto x = value.GetAs<typename StoredType<Id>::type>();
+  memcpy(storage, &x, sizeof(x));
+}
+
+static void SerializeVarchar(const Value &value, char *storage) {
+  value.SerializeTo(storage);
+}
+
+/*
+ * Out of the range of To throws as CastAs does, a null stays one
+ */
+template <TypeId From, TypeId To> static Value CastStored(const char *storage) {
+  typedef typename StoredType<To>::type T;
+  auto x = Load<typename StoredType<From>::type>(storage);
+  if (x == StoredType<From>::Null())
+    return Value(To, StoredType<To>::Null());
+  if (From != To && To != TypeId::DECIMAL &&
+      (x > StoredType<To>::Max() || x < StoredType<To>::Min()))
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE, "Numeric value out of range.");
+  return Value(To, static_cast<T>(x));
+}
+
+StoredComparator GetStoredComparator(TypeId left, TypeId right) {
+  if (left == TypeId::VARCHAR && right == TypeId::VARCHAR)
+    return &CompareStoredVarchar;
+  if (left == TypeId::VARCHAR || right == TypeId::VARCHAR ||
+      left < TypeId::BOOLEAN || left > TypeId::DECIMAL ||
+      right < TypeId::BOOLEAN || right > TypeId::DECIMAL)
+    return nullptr;
+  return DispatchTypePair(left, right, [](auto l, auto r) {
+    return static_cast<StoredComparator>(
+        &CompareStored<decltype(l)::value, decltype(r)::value>);
+  });
+}
+
+StoredSerializer GetStoredSerializer(TypeId type_id) {
+  if (type_id == TypeId::VARCHAR)
+    return &SerializeVarchar;
+  if (type_id < TypeId::BOOLEAN || type_id > TypeId::DECIMAL)
+    return nullptr;
+  return DispatchType(type_id, [](auto id) {
+    return static_cast<StoredSerializer>(&SerializeStored<decltype(id)::value>);
+  });
+}
+
+StoredCaster GetStoredCaster(TypeId from, TypeId to) {
+  if (from < TypeId::BOOLEAN || from > TypeId::DECIMAL ||
+      to < TypeId::BOOLEAN || to > TypeId::DECIMAL)
+    return nullptr;
+  // a BOOLEAN is only itself
+  if ((from == TypeId::BOOLEAN || to == TypeId::BOOLEAN) && from != to)
+    return nullptr;
+  return DispatchTypePair(from, to, [](auto f, auto t) {
+    return static_cast<StoredCaster>(
+        &CastStored<decltype(f)::value, decltype(t)::value>);
+  });
+}
+
+} // namespace cmudb
@@ -11,6 +11,7 @@ Value::Value(const Value &other) {
   type_id_ = other.type_id_;
   size_ = other.size_;
   manage_data_ = other.manage_data_;
+  inlined_ = other.inlined_;
   value_ = other.value_;
   switch (type_id_) {
   case TypeId::VARCHAR:
@@ -236,7 +237,12 @@ Value::Value(TypeId type, const char *data, uint32_t len, bool manage_data)
       size_.len = PELOTON_VALUE_NULL;
     } else {
       manage_data_ = manage_data;
-      if (manage_data_) {
+      if (manage_data_ && len <= INLINE_VARCHAR_LEN) {
+        manage_data_ = false;
+        inlined_ = true;
+        size_.len = len;
+        memcpy(value_.inline_varlen, data, len);
+      } else if (manage_data_) {
         assert(len < PELOTON_VARCHAR_MAX_LEN);
         value_.varlen = new char[len];
         assert(value_.varlen != nullptr);
@@ -258,12 +264,17 @@ Value::Value(TypeId type, const char *data, uint32_t len, bool manage_data)
 Value::Value(TypeId type, const std::string &data) : Value(type) {
   switch (type) {
   case TypeId::VARCHAR: {
-    manage_data_ = true;
     // TODO: How to represent a null string here?
     uint32_t len = data.length() + 1;
+    size_.len = len;
+    if (len <= INLINE_VARCHAR_LEN) {
+      inlined_ = true;
+      memcpy(value_.inline_varlen, data.c_str(), len);
+      break;
+    }
+    manage_data_ = true;
     value_.varlen = new char[len];
     assert(value_.varlen != nullptr);
-    size_.len = len;
     memcpy(value_.varlen, data.c_str(), len);
     break;
   }
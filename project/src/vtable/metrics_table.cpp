@@ -0,0 +1,215 @@
+/**
+ * metrics_table.cpp
+ */
+#include <string>
+#include <vector>
+
+#include "common/metrics.h"
+#include "vtable/metrics_table.h"
+
+namespace cmudb {
+
+SQLITE_EXTENSION_INIT3
+
+enum MetricsColumn {
+  NAME,
+  KIND,
+  VALUE,
+  COUNT,
+  SUM,
+  MEAN,
+  P50,
+  P99,
+  P999,
+  MAX,
+  PREFIX // hidden, the argument
+};
+
+struct MetricsCursor {
+  sqlite3_vtab_cursor base_;
+  std::vector<MetricSnapshot> rows_;
+  size_t row_ = 0;
+};
+
+static const char *KindName(MetricKind kind) {
+  switch (kind) {
+  case MetricKind::COUNTER:
+    return "counter";
+  case MetricKind::GAUGE:
+    return "gauge";
+  case MetricKind::HISTOGRAM:
+    return "histogram";
+  }
+  return "";
+}
+
+static int MetricsConnect(sqlite3 *db, void *pAux, int argc,
+                          const char *const *argv, sqlite3_vtab **ppVtab,
+                          char **pzErr) {
+  int rc = sqlite3_declare_vtab(
+      db, "CREATE TABLE x(name TEXT, kind TEXT, value INTEGER, "
+          "count INTEGER, sum INTEGER, mean REAL, p50 INTEGER, p99 INTEGER, "
+          "p999 INTEGER, max INTEGER, prefix HIDDEN)");
+  if (rc != SQLITE_OK)
+    return rc;
+  *ppVtab = new sqlite3_vtab();
+  return SQLITE_OK;
+}
+
+static int MetricsDisconnect(sqlite3_vtab *pVtab) {
+  delete pVtab;
+  return SQLITE_OK;
+}
+
+// the prefix, if given, is the only argument of xFilter. sqlite 3.20 takes
+// SQLITE_CONSTRAINT for an error, a plan the prefix cannot be handed to is
+// made too costly to pick instead
+static int MetricsBestIndex(sqlite3_vtab *pVtab,
+                            sqlite3_index_info *pIdxInfo) {
+  pIdxInfo->idxNum = 0;
+  bool unusable = false;
+  for (int i = 0; i < pIdxInfo->nConstraint; i++) {
+    auto &constraint = pIdxInfo->aConstraint[i];
+    if (constraint.iColumn != PREFIX)
+      continue;
+    if (!constraint.usable || constraint.op != SQLITE_INDEX_CONSTRAINT_EQ ||
+        pIdxInfo->idxNum == 1) {
+      unusable = true;
+      continue;
+    }
+    pIdxInfo->aConstraintUsage[i].argvIndex = 1;
+    pIdxInfo->aConstraintUsage[i].omit = 1;
+    pIdxInfo->idxNum = 1;
+  }
+  if (pIdxInfo->idxNum == 1)
+    pIdxInfo->estimatedCost = 10;
+  else
+    pIdxInfo->estimatedCost = unusable ? 1e12 : 100;
+  return SQLITE_OK;
+}
+
+static int MetricsOpen(sqlite3_vtab *pVtab, sqlite3_vtab_cursor **ppCursor) {
+  *ppCursor = &(new MetricsCursor())->base_;
+  return SQLITE_OK;
+}
+
+static int MetricsClose(sqlite3_vtab_cursor *cur) {
+  delete reinterpret_cast<MetricsCursor *>(cur);
+  return SQLITE_OK;
+}
+
+static int MetricsFilter(sqlite3_vtab_cursor *cur, int idxNum,
+                         const char *idxStr, int argc,
+                         sqlite3_value **argv) {
+  MetricsCursor *cursor = reinterpret_cast<MetricsCursor *>(cur);
+  std::string prefix;
+  if (idxNum == 1 && sqlite3_value_type(argv[0]) != SQLITE_NULL)
+    prefix = reinterpret_cast<const char *>(sqlite3_value_text(argv[0]));
+  cursor->rows_ = Metrics::Instance().Snapshot(prefix);
+  cursor->row_ = 0;
+  return SQLITE_OK;
+}
+
+static int MetricsNext(sqlite3_vtab_cursor *cur) {
+  reinterpret_cast<MetricsCursor *>(cur)->row_++;
+  return SQLITE_OK;
+}
+
+static int MetricsEof(sqlite3_vtab_cursor *cur) {
+  MetricsCursor *cursor = reinterpret_cast<MetricsCursor *>(cur);
+  return cursor->row_ >= cursor->rows_.size();
+}
+
+static int MetricsColumnOf(sqlite3_vtab_cursor *cur, sqlite3_context *ctx,
+                           int i) {
+  MetricsCursor *cursor = reinterpret_cast<MetricsCursor *>(cur);
+  const MetricSnapshot &metric = cursor->rows_[cursor->row_];
+  const HdrHistogramSnapshot &histogram = metric.histogram;
+  bool is_histogram = metric.kind == MetricKind::HISTOGRAM;
+  switch (i) {
+  case NAME:
+    sqlite3_result_text(ctx, metric.name.c_str(),
+                        static_cast<int>(metric.name.size()),
+                        SQLITE_TRANSIENT);
+    return SQLITE_OK;
+  case KIND:
+    sqlite3_result_text(ctx, KindName(metric.kind), -1, SQLITE_STATIC);
+    return SQLITE_OK;
+  case VALUE:
+    sqlite3_result_int64(ctx, metric.value);
+    return SQLITE_OK;
+  case PREFIX:
+    sqlite3_result_null(ctx);
+    return SQLITE_OK;
+  }
+  if (!is_histogram) {
+    sqlite3_result_null(ctx);
+    return SQLITE_OK;
+  }
+  switch (i) {
+  case COUNT:
+    sqlite3_result_int64(ctx, static_cast<sqlite3_int64>(histogram.count));
+    break;
+  case SUM:
+    sqlite3_result_int64(ctx, static_cast<sqlite3_int64>(histogram.sum));
+    break;
+  case MEAN:
+    sqlite3_result_double(ctx, histogram.Mean());
+    break;
+  case P50:
+    sqlite3_result_int64(
+        ctx, static_cast<sqlite3_int64>(histogram.Percentile(0.5)));
+    break;
+  case P99:
+    sqlite3_result_int64(
+        ctx, static_cast<sqlite3_int64>(histogram.Percentile(0.99)));
+    break;
+  case P999:
+    sqlite3_result_int64(
+        ctx, static_cast<sqlite3_int64>(histogram.Percentile(0.999)));
+    break;
+  case MAX:
+    sqlite3_result_int64(ctx, static_cast<sqlite3_int64>(histogram.max));
+    break;
+  }
+  return SQLITE_OK;
+}
+
+static int MetricsRowid(sqlite3_vtab_cursor *cur, sqlite3_int64 *pRowid) {
+  *pRowid =
+      static_cast<sqlite3_int64>(reinterpret_cast<MetricsCursor *>(cur)->row_);
+  return SQLITE_OK;
+}
+
+// no xCreate: eponymous only, there is no CREATE VIRTUAL TABLE of it
+static sqlite3_module MetricsModule = {
+    0,                 /* iVersion */
+    nullptr,           /* xCreate */
+    MetricsConnect,    /* xConnect */
+    MetricsBestIndex,  /* xBestIndex */
+    MetricsDisconnect, /* xDisconnect */
+    MetricsDisconnect, /* xDestroy */
+    MetricsOpen,       /* xOpen */
+    MetricsClose,      /* xClose */
+    MetricsFilter,     /* xFilter */
+    MetricsNext,       /* xNext */
+    MetricsEof,        /* xEof */
+    MetricsColumnOf,   /* xColumn */
+    MetricsRowid,      /* xRowid */
+    nullptr,           /* xUpdate */
+    nullptr,           /* xBegin */
+    nullptr,           /* xSync */
+    nullptr,           /* xCommit */
+    nullptr,           /* xRollback */
+    nullptr,           /* xFindMethod */
+    nullptr,           /* xRename */
+    nullptr,           /* xSavepoint */
+    nullptr,           /* xRelease */
+    nullptr,           /* xRollbackTo */
+};
+
+int RegisterMetricsTable(sqlite3 *db) {
+  return sqlite3_create_module(db, "vtable_metrics", &MetricsModule, nullptr);
+}
+
+} // namespace cmudb
@@ -2,168 +2,587 @@
  * virtual_table.cpp
  */
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <string>
 #include <sys/stat.h>
+#include <type_traits>
 #include <vector>
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/memory_tracker.h"
 #include "common/string_utility.h"
+#include "index/art_index.h"
+#include "index/b_epsilon_tree_index.h"
+#include "index/b_link_tree_index.h"
+#include "index/covering_index.h"
+#include "index/hash_index.h"
+#include "index/var_key_tree_index.h"
 #include "page/header_page.h"
+#include "type/type_dispatch.h"
+#include "vtable/metrics_table.h"
 #include "vtable/virtual_table.h"
 
 namespace cmudb {
 
 SQLITE_EXTENSION_INIT1
 
+StorageEngine *storage_engine_ = nullptr;
+size_t storage_engine_users_ = 0;
+std::unordered_map<std::string, std::pair<VirtualTable *, size_t>> tables_;
+std::mutex storage_engine_latch_;
+
+// a handle of table for the connection pAux, the name of table in tables_
+static sqlite3_vtab *NewHandle(VirtualTable *table, const std::string &name,
+                               void *pAux) {
+  TableHandle *handle = new TableHandle();
+  handle->table_ = table;
+  handle->name_ = name;
+  handle->connection_ = reinterpret_cast<Connection *>(pAux);
+  return &handle->base_;
+}
+
 /* API implementation */
 int VtabCreate(sqlite3 *db, void *pAux, int argc, const char *const *argv,
                sqlite3_vtab **ppVtab, char **pzErr) {
+  std::lock_guard<std::mutex> guard(storage_engine_latch_);
   BufferPoolManager *buffer_pool_manager =
       storage_engine_->buffer_pool_manager_;
   LockManager *lock_manager = storage_engine_->lock_manager_;
   LogManager *log_manager = storage_engine_->log_manager_;
 
-  // fetch header page from buffer pool
-  HeaderPage *header_page =
-      static_cast<HeaderPage *>(buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
-
   // the first three parameter:(1) module name (2) database name (3)table name
   assert(argc >= 4);
   // parse arg[3](string that defines table schema)
   std::string schema_string(argv[3]);
   schema_string = schema_string.substr(1, (schema_string.size() - 2));
-  Schema *schema = ParseCreateStatement(schema_string);
+  std::vector<int> dictionary_columns;
+  Schema *schema = ParseCreateStatement(schema_string, &dictionary_columns);
+  // a last argument pax stores the table in PAX pages
+  bool pax = IsPaxArgument(argc, argv);
+  if (pax) {
+    argc--;
+    // a page must hold at least one row of the fixed parts
+    if (TablePage::GetPaxCapacity(TablePage::GetPaxLayout(schema),
+                                  buffer_pool_manager->GetPageSize()) < 1) {
+      delete schema;
+      *pzErr = sqlite3_mprintf("rows of %s are too wide for pax", argv[2]);
+      return SQLITE_ERROR;
+    }
+  }
 
-  // parse arg[4](string that defines table index)
-  Index *index = nullptr;
-  if (argc > 4) {
-    std::string index_string(argv[4]);
+  // parse arg[4] on(strings that define table indexes)
+  std::vector<Index *> indexes;
+  for (int i = 4; i < argc; i++) {
+    std::string index_string(argv[i]);
     index_string = index_string.substr(1, (index_string.size() - 2));
     // create index object, allocate memory space
     IndexMetadata *index_metadata =
         ParseIndexStatement(index_string, std::string(argv[2]), schema);
-    index = ConstructIndex(index_metadata, buffer_pool_manager);
+    indexes.push_back(ConstructIndex(
+        index_metadata, storage_engine_->index_buffer_pool_manager_,
+        INVALID_PAGE_ID, log_manager, storage_engine_->root_catalog_));
   }
   // create table object, allocate memory space
-  VirtualTable *table = new VirtualTable(schema, buffer_pool_manager,
-                                         lock_manager, log_manager, index);
+  VirtualTable *table =
+      new VirtualTable(schema, buffer_pool_manager, lock_manager, log_manager,
+                       indexes, std::string(argv[2]), INVALID_PAGE_ID, pax,
+                       dictionary_columns);
 
-  // insert table root page info into header page
-  header_page->InsertRecord(std::string(argv[2]), table->GetFirstPageId());
-  buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, true);
+  // record the table root page in the catalog
+  storage_engine_->catalog_->SetRoot(argv[2], table->GetFirstPageId());
+  tables_[argv[2]] = std::make_pair(table, 1);
 
   // register virtual table within sqlite system
   schema_string = "CREATE TABLE X(" + schema_string + ");";
   assert(sqlite3_declare_vtab(db, schema_string.c_str()) == SQLITE_OK);
 
-  *ppVtab = reinterpret_cast<sqlite3_vtab *>(table);
+  *ppVtab = NewHandle(table, argv[2], pAux);
   return SQLITE_OK;
 }
 
 int VtabConnect(sqlite3 *db, void *pAux, int argc, const char *const *argv,
                 sqlite3_vtab **ppVtab, char **pzErr) {
   assert(argc >= 4);
+  std::lock_guard<std::mutex> guard(storage_engine_latch_);
   std::string schema_string(argv[3]);
   // remove the very first and last character
   schema_string = schema_string.substr(1, (schema_string.size() - 2));
+  // another connection has the table already
+  auto shared = tables_.find(argv[2]);
+  if (shared != tables_.end()) {
+    shared->second.second++;
+    schema_string = "CREATE TABLE X(" + schema_string + ");";
+    assert(sqlite3_declare_vtab(db, schema_string.c_str()) == SQLITE_OK);
+    *ppVtab = NewHandle(shared->second.first, argv[2], pAux);
+    return SQLITE_OK;
+  }
   // new virtual table object, allocate memory space
-  Schema *schema = ParseCreateStatement(schema_string);
+  std::vector<int> dictionary_columns;
+  Schema *schema = ParseCreateStatement(schema_string, &dictionary_columns);
 
   BufferPoolManager *buffer_pool_manager =
       storage_engine_->buffer_pool_manager_;
   LockManager *lock_manager = storage_engine_->lock_manager_;
   LogManager *log_manager = storage_engine_->log_manager_;
 
-  // Retrieve table root page info from header page
-  HeaderPage *header_page =
-      static_cast<HeaderPage *>(buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
-  page_id_t table_root_id;
-  header_page->GetRootId(std::string(argv[2]), table_root_id);
-  // parse arg[4](string that defines table index)
-  Index *index = nullptr;
-  if (argc > 4) {
-    std::string index_string(argv[4]);
+  // the table root page, from the catalog in memory
+  page_id_t table_root_id = storage_engine_->catalog_->GetRoot(argv[2]);
+  // the pages have their layout already
+  if (IsPaxArgument(argc, argv)) {
+    argc--;
+  }
+  // parse arg[4] on(strings that define table indexes)
+  std::vector<Index *> indexes;
+  std::vector<page_id_t> index_root_ids;
+  for (int i = 4; i < argc; i++) {
+    std::string index_string(argv[i]);
     index_string = index_string.substr(1, (index_string.size() - 2));
     // create index object, allocate memory space
     IndexMetadata *index_metadata =
         ParseIndexStatement(index_string, std::string(argv[2]), schema);
-    // Retrieve index root page info from header page
-    page_id_t index_root_id;
-    header_page->GetRootId(index_metadata->GetName(), index_root_id);
-    index = ConstructIndex(index_metadata, buffer_pool_manager, index_root_id);
+    // Retrieve index root page info from the root catalog
+    index_root_ids.push_back(
+        storage_engine_->root_catalog_->GetRoot(index_metadata->GetName()));
+    indexes.push_back(ConstructIndex(
+        index_metadata, storage_engine_->index_buffer_pool_manager_,
+        index_root_ids.back(), log_manager, storage_engine_->root_catalog_));
   }
   VirtualTable *table =
       new VirtualTable(schema, buffer_pool_manager, lock_manager, log_manager,
-                       index, table_root_id);
+                       indexes, std::string(argv[2]), table_root_id, false,
+                       dictionary_columns);
+  // an index without a root, as one kept in memory, is built from the table
+  for (size_t i = 0; i < indexes.size(); i++) {
+    if (index_root_ids[i] == INVALID_PAGE_ID)
+      table->BuildIndex(i);
+  }
 
   // register virtual table within sqlite system
   schema_string = "CREATE TABLE X(" + schema_string + ");";
   assert(sqlite3_declare_vtab(db, schema_string.c_str()) == SQLITE_OK);
 
-  *ppVtab = reinterpret_cast<sqlite3_vtab *>(table);
-  buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
+  tables_[argv[2]] = std::make_pair(table, 1);
+  *ppVtab = NewHandle(table, argv[2], pAux);
   return SQLITE_OK;
 }
 
+/*
+ * A scan VtabBestIndex may pick, what VtabFilter is handed and its cost. The
+ * kind of scan is the low byte of idxNum, the index it uses, in the order of
+ * the module arguments, the bytes above. idxStr starts with colUsed, in
+ * hex, for the cursor to read those columns only
+ */
+struct ScanPlan {
+  explicit ScanPlan(int constraint_count)
+      : argv_index(constraint_count, 0), omit(constraint_count, false) {}
+
+  int idx_num = 0;
+  double cost = 0;
+  double rows = 0;
+  // a row at most
+  bool unique = false;
+  // rows in the order of the ORDER BY
+  bool ordered = false;
+  std::string idx_str;
+  // by constraint, its argvIndex and whether sqlite skips checking it
+  std::vector<int> argv_index;
+  std::vector<bool> omit;
+};
+
+static inline int ScanNumber(int kind, size_t index_no) {
+  return kind | static_cast<int>(index_no) << 8;
+}
+
+static void ApplyPlan(const ScanPlan &plan, sqlite3_index_info *pIdxInfo) {
+  pIdxInfo->idxNum = plan.idx_num;
+  pIdxInfo->estimatedCost = plan.cost;
+  pIdxInfo->estimatedRows = static_cast<sqlite3_int64>(plan.rows);
+  if (plan.unique)
+    pIdxInfo->idxFlags |= SQLITE_INDEX_SCAN_UNIQUE;
+  pIdxInfo->orderByConsumed = plan.ordered;
+  pIdxInfo->idxStr =
+      sqlite3_mprintf("%llx %s", pIdxInfo->colUsed, plan.idx_str.c_str());
+  pIdxInfo->needToFreeIdxStr = 1;
+  for (int i = 0; i < pIdxInfo->nConstraint; i++) {
+    pIdxInfo->aConstraintUsage[i].argvIndex = plan.argv_index[i];
+    pIdxInfo->aConstraintUsage[i].omit = plan.omit[i];
+  }
+}
+
+/*
+ * Whether the rows of index in key order, or the other way for desc, are in
+ * the order of the ORDER BY: its terms are key columns in key order, all
+ * going one way. Of the first equal_count key columns, which equalities
+ * fix, any may be left out. The codes of dictionary encoded columns are in
+ * no order
+ */
+static bool OrdersBy(VirtualTable *table, Index *index,
+                     sqlite3_index_info *pIdxInfo, size_t equal_count,
+                     bool &desc) {
+  if (pIdxInfo->nOrderBy == 0 ||
+      index->GetMetadata()->GetIndexType() != IndexType::BPLUS_TREE)
+    return false;
+  const std::vector<int> &key_attrs = index->GetKeyAttrs();
+  desc = pIdxInfo->aOrderBy[0].desc != 0;
+  size_t k = 0;
+  for (int i = 0; i < pIdxInfo->nOrderBy; i++) {
+    auto &term = pIdxInfo->aOrderBy[i];
+    if ((term.desc != 0) != desc ||
+        table->GetDictionary()->IsEncoded(term.iColumn))
+      return false;
+    while (k < equal_count && key_attrs[k] != term.iColumn)
+      k++;
+    if (k == key_attrs.size() || key_attrs[k] != term.iColumn)
+      return false;
+    k++;
+  }
+  return true;
+}
+
 /*
  * we only support
  * (1) equlity check. e.g select * from foo where a = 1
- * (2) indexed column == predicated column
+ * (2) every key column of the index predicated
+ * argv of VtabFilter has the values in the order of the key columns, other
+ * constraints are left to sqlite. An index scan is index-only, idxNum 2,
+ * when the statement uses no column besides the key and included ones. It
+ * costs a page of each level of the index, from its stats if it has them,
+ * and a key of a unique index finds a row at most, which sqlite is told.
+ * Without an index scan, comparisons of fixed-size columns with constants
+ * are checked by the cursor on the pages, idxNum 3, which skips the pages
+ * the zone map rules out for them too; idxStr has the column and the
+ * operator of each constraint handed to VtabFilter. A dictionary encoded
+ * column only takes equality, checked on the codes by the cursor instead of
+ * sqlite
  */
-int VtabBestIndex(sqlite3_vtab *tab, sqlite3_index_info *pIdxInfo) {
-  // LOG_DEBUG("VtabBestIndex");
-  VirtualTable *table = reinterpret_cast<VirtualTable *>(tab);
-  if (table->GetIndex() == nullptr)
-    return SQLITE_OK;
-  const std::vector<int> key_attrs = table->GetIndex()->GetKeyAttrs();
-  // make sure indexed column == predicate column
+static bool BestKeyScan(VirtualTable *table, size_t index_no,
+                        sqlite3_index_info *pIdxInfo, double row_count,
+                        ScanPlan &plan) {
+  TableStats *table_stats = table->GetStats();
+  Index *index = table->GetIndex(index_no);
+  const std::vector<int> &key_attrs = index->GetKeyAttrs();
   // e.g select * from foo where a = 1 and b =2; indexed column must be {a,b}
-  if (pIdxInfo->nConstraint != (int)(key_attrs.size()))
-    return SQLITE_OK;
+  for (size_t k = 0; k < key_attrs.size(); k++) {
+    int equal = -1;
+    for (int i = 0; i < pIdxInfo->nConstraint && equal == -1; i++) {
+      auto &constraint = pIdxInfo->aConstraint[i];
+      if (constraint.usable != 0 && constraint.iColumn == key_attrs[k] &&
+          constraint.op == SQLITE_INDEX_CONSTRAINT_EQ)
+        equal = i;
+    }
+    if (equal == -1)
+      return false;
+    plan.argv_index[equal] = static_cast<int>(k) + 1;
+  }
 
-  int counter = 0;
-  bool is_index_scan = true;
-  for (int i = 0; i < pIdxInfo->nConstraint; i++) {
-    if (pIdxInfo->aConstraint[i].usable == 0)
+  plan.idx_num = ScanNumber(1, index_no);
+  IndexStats stats = index->GetStats();
+  IndexMetadata *metadata = index->GetMetadata();
+  // the key columns taken as independent
+  double rows = row_count;
+  for (int column : key_attrs)
+    rows *= table_stats->EstimateEquals(column);
+  if (metadata->IsUnique())
+    rows = std::min(rows, 1.0);
+  rows = std::max(rows, 1.0);
+  // a descent, then a page per row it finds
+  plan.cost = std::max(stats.height, 1) + rows;
+  plan.rows = rows;
+  plan.unique = metadata->IsUnique();
+  bool desc;
+  plan.ordered = OrdersBy(table, index, pIdxInfo, key_attrs.size(), desc);
+  if (metadata->GetCoveringSchema() != nullptr) {
+    // bit 63 stands for any column from the 64th on, never covered
+    sqlite3_uint64 covered = 0;
+    for (int column = 0; column < 63; column++) {
+      if (metadata->GetCoveringColumn(column) != -1)
+        covered |= sqlite3_uint64(1) << column;
+    }
+    if ((pIdxInfo->colUsed & ~covered) == 0) {
+      plan.idx_num = ScanNumber(2, index_no);
+      // the rows are in the entries, leaves hold many
+      double per_leaf =
+          stats.leaf_pages > 0
+              ? static_cast<double>(stats.key_count) / stats.leaf_pages
+              : 1;
+      plan.cost = std::max(stats.height, 1) + rows / std::max(per_leaf, 1.0);
+    }
+  }
+  return true;
+}
+
+// share of the rows a bound of a constraint keeps, its value unknown until
+// VtabFilter; a quarter, as sqlite guesses
+static const double BOUND_SHARE = 0.25;
+
+/*
+ * Without a key scan, a B+ tree index with key columns of fixed-size types
+ * takes equalities on its first key columns and bounds on the next one, a
+ * scan of its keys from the lowest to the highest allowed, idxNum 4; idxStr
+ * has the column and the operator of each constraint, sqlite checks the
+ * rows still. Equalities on all the key columns of a unique index find a
+ * row at most
+ */
+static bool BestKeyRangeScan(VirtualTable *table, size_t index_no,
+                             sqlite3_index_info *pIdxInfo, double row_count,
+                             ScanPlan &plan) {
+  Index *index = table->GetIndex(index_no);
+  Schema *key_schema = index->GetKeySchema();
+  if (index->GetMetadata()->GetIndexType() != IndexType::BPLUS_TREE)
+    return false;
+  for (int i = 0; i < key_schema->GetColumnCount(); i++) {
+    if (key_schema->GetReader(i) == nullptr)
+      return false;
+  }
+  TableStats *table_stats = table->GetStats();
+  Dictionary *dictionary = table->GetDictionary();
+  int argv_index = 0;
+  double rows = row_count;
+  auto use = [&](int i) {
+    auto &constraint = pIdxInfo->aConstraint[i];
+    plan.argv_index[i] = ++argv_index;
+    plan.idx_str += std::to_string(constraint.iColumn) + " " +
+                    std::to_string(constraint.op) + " ";
+  };
+  size_t equal_count = 0;
+  for (int column : index->GetKeyAttrs()) {
+    int equal = -1, low = -1, high = -1;
+    for (int i = 0; i < pIdxInfo->nConstraint; i++) {
+      auto &constraint = pIdxInfo->aConstraint[i];
+      if (constraint.usable == 0 || constraint.iColumn != column)
+        continue;
+      if (constraint.op == SQLITE_INDEX_CONSTRAINT_EQ)
+        equal = i;
+      else if (constraint.op == SQLITE_INDEX_CONSTRAINT_GT ||
+               constraint.op == SQLITE_INDEX_CONSTRAINT_GE)
+        low = i;
+      else if (constraint.op == SQLITE_INDEX_CONSTRAINT_LT ||
+               constraint.op == SQLITE_INDEX_CONSTRAINT_LE)
+        high = i;
+    }
+    if (equal != -1) {
+      use(equal);
+      rows *= table_stats->EstimateEquals(column);
+      equal_count++;
       continue;
-    int item = pIdxInfo->aConstraint[i].iColumn;
-    // if predicate column is part of indexed column
-    if (std::find(key_attrs.begin(), key_attrs.end(), item) !=
-        key_attrs.end()) {
-      // equlity check
-      if (pIdxInfo->aConstraint[i].op != SQLITE_INDEX_CONSTRAINT_EQ) {
-        is_index_scan = false;
-        break;
-      }
-      pIdxInfo->aConstraintUsage[i].argvIndex = (i + 1);
-      counter++;
     }
+    // codes are in no order
+    if (dictionary->IsEncoded(column))
+      break;
+    if (low != -1) {
+      use(low);
+      rows *= BOUND_SHARE;
+    }
+    if (high != -1) {
+      use(high);
+      rows *= BOUND_SHARE;
+    }
+    break;
+  }
+  if (argv_index == 0)
+    return false;
+  plan.unique = index->GetMetadata()->IsUnique() &&
+                equal_count == index->GetKeyAttrs().size();
+  if (plan.unique)
+    rows = std::min(rows, 1.0);
+  rows = std::max(rows, 1.0);
+  plan.idx_num = ScanNumber(4, index_no);
+  // keys go up
+  bool desc;
+  plan.ordered =
+      OrdersBy(table, index, pIdxInfo, equal_count, desc) && !desc;
+  // a descent, then a page per row it finds
+  plan.cost = std::max(index->GetStats().height, 1) + rows;
+  plan.rows = rows;
+  return true;
+}
+
+// what sqlite adds to a plan whose rows it sorts for the ORDER BY: rows log
+// rows compares, each a tenth of a page read
+static const double SORT_COMPARE_COST = 0.1;
+// an entry of an ordered scan, about as much as a compare
+static const double INDEX_STEP_COST = 0.1;
+
+/*
+ * All the rows, in the order of the ORDER BY by the keys of a B+ tree
+ * index, idxNum 5, or by them the other way, 6. Read a batch at a time, a
+ * LIMIT sqlite stops at after a few rows reads a few
+ */
+static bool BestOrderedScan(VirtualTable *table, size_t index_no,
+                            sqlite3_index_info *pIdxInfo, double row_count,
+                            ScanPlan &plan) {
+  Index *index = table->GetIndex(index_no);
+  bool desc;
+  if (!OrdersBy(table, index, pIdxInfo, 0, desc))
+    return false;
+  plan.idx_num = ScanNumber(desc ? 6 : 5, index_no);
+  // a descent, the pages a full scan reads, which stay in the buffer pool
+  // mostly, and a step along the leaves a row
+  plan.cost = std::max(index->GetStats().height, 1) +
+              table->GetStats()->GetPageCount() +
+              row_count * INDEX_STEP_COST;
+  plan.rows = row_count;
+  plan.ordered = true;
+  return true;
+}
+
+
+static double CostWithSort(const ScanPlan &plan,
+                           sqlite3_index_info *pIdxInfo) {
+  if (pIdxInfo->nOrderBy == 0 || plan.ordered || plan.rows < 2)
+    return plan.cost;
+  return plan.cost + plan.rows * std::log2(plan.rows) * SORT_COMPARE_COST;
+}
+
+/*
+ * It reads the pages as a full scan does, as far as is known before the
+ * bounds are, but hands fewer rows on to sqlite: the others are passed
+ * over on the page
+ */
+static bool BestRangeScan(VirtualTable *table, sqlite3_index_info *pIdxInfo,
+                          double row_count, ScanPlan &plan) {
+  int argv_index = 0;
+  double rows = row_count;
+  TableStats *table_stats = table->GetStats();
+  Dictionary *dictionary = table->GetDictionary();
+  Schema *schema = table->GetSchema();
+  for (int i = 0; i < pIdxInfo->nConstraint; i++) {
+    auto &constraint = pIdxInfo->aConstraint[i];
+    unsigned char op = constraint.op;
+    if (constraint.usable == 0 || constraint.iColumn < 0 ||
+        !schema->IsInlined(constraint.iColumn) ||
+        (op != SQLITE_INDEX_CONSTRAINT_EQ && op != SQLITE_INDEX_CONSTRAINT_GT &&
+         op != SQLITE_INDEX_CONSTRAINT_GE && op != SQLITE_INDEX_CONSTRAINT_LT &&
+         op != SQLITE_INDEX_CONSTRAINT_LE))
+      continue;
+    bool encoded = dictionary->IsEncoded(constraint.iColumn);
+    if (encoded && op != SQLITE_INDEX_CONSTRAINT_EQ)
+      continue;
+    // sqlite checks the rows the cursor hands on still, a bound of an
+    // integer column is rounded for it; codes are only checked by the
+    // cursor
+    plan.argv_index[i] = ++argv_index;
+    plan.omit[i] = encoded;
+    plan.idx_str += std::to_string(constraint.iColumn) + " " +
+                    std::to_string(op) + " ";
+    rows *= op == SQLITE_INDEX_CONSTRAINT_EQ
+                ? table_stats->EstimateEquals(constraint.iColumn)
+                : BOUND_SHARE;
   }
+  if (argv_index == 0)
+    return false;
+  plan.idx_num = 3;
+  plan.rows = std::max(rows, 1.0);
+  return true;
+}
 
-  if (counter == (int)key_attrs.size() && is_index_scan) {
-    pIdxInfo->idxNum = 1;
+/*
+ * The cheapest of the scans of each index and the full scan, the first of
+ * equal ones; a key scan before a key range scan of the same index. Plans
+ * not in the order of the ORDER BY cost its sort besides, an index may give
+ * the order too. An empty table, or one without stats yet, takes an index
+ * scan. A full scan left skips pages by the zone map if it can
+ */
+int VtabBestIndex(sqlite3_vtab *tab, sqlite3_index_info *pIdxInfo) {
+  // LOG_DEBUG("VtabBestIndex");
+  VirtualTable *table = reinterpret_cast<TableHandle *>(tab)->table_;
+  // a full scan reads every page
+  TableStats *table_stats = table->GetStats();
+  double row_count = table_stats->GetRowCount();
+  ScanPlan best(pIdxInfo->nConstraint);
+  best.cost = table_stats->GetPageCount();
+  best.rows = row_count;
+  for (size_t i = 0; i < table->GetIndexCount(); i++) {
+    ScanPlan plan(pIdxInfo->nConstraint);
+    if (BestKeyScan(table, i, pIdxInfo, row_count, plan) ||
+        BestKeyRangeScan(table, i, pIdxInfo, row_count,
+                         plan = ScanPlan(pIdxInfo->nConstraint))) {
+      if (CostWithSort(plan, pIdxInfo) < CostWithSort(best, pIdxInfo) ||
+          (best.idx_num == 0 && row_count == 0))
+        best = plan;
+      // in order already, and over fewer keys
+      if (plan.ordered)
+        continue;
+    }
+    plan = ScanPlan(pIdxInfo->nConstraint);
+    if (BestOrderedScan(table, i, pIdxInfo, row_count, plan) &&
+        CostWithSort(plan, pIdxInfo) < CostWithSort(best, pIdxInfo))
+      best = plan;
+  }
+  if (best.idx_num == 0) {
+    ScanPlan plan(pIdxInfo->nConstraint);
+    plan.cost = best.cost;
+    if (BestRangeScan(table, pIdxInfo, row_count, plan))
+      best = plan;
   }
+  ApplyPlan(best, pIdxInfo);
   return SQLITE_OK;
 }
 
 int VtabDisconnect(sqlite3_vtab *pVtab) {
-  VirtualTable *virtual_table = reinterpret_cast<VirtualTable *>(pVtab);
-  delete virtual_table;
-  // delete all the global managers
-  delete storage_engine_;
+  TableHandle *handle = reinterpret_cast<TableHandle *>(pVtab);
+  std::lock_guard<std::mutex> guard(storage_engine_latch_);
+  // the last connection to have the table deletes it, the storage engine
+  // goes with the last connection, see ReleaseConnection
+  auto shared = tables_.find(handle->name_);
+  if (--shared->second.second == 0) {
+    delete shared->second.first;
+    tables_.erase(shared);
+  }
+  delete handle;
   return SQLITE_OK;
 }
 
+/*
+ * End the transaction of connection, commit or roll it back. Cursors of
+ * another statement still open go on in a new one
+ */
+static void EndTransaction(Connection *connection, bool commit) {
+  auto transaction_manager = storage_engine_->transaction_manager_;
+  Transaction *txn = connection->transaction_;
+  auto &index_changes = connection->index_changes_;
+  // the index entries back first, the last change first
+  for (auto it = index_changes.rbegin(); !commit && it != index_changes.rend();
+       ++it) {
+    const std::vector<bool> *changed =
+        it->changed_.empty() ? nullptr : &it->changed_;
+    if (it->inserted_)
+      it->table_->DeleteEntries(it->tuple_, it->rid_, txn, changed);
+    else
+      it->table_->InsertEntries(it->tuple_, it->rid_, txn, changed);
+  }
+  index_changes.clear();
+  // invoke transaction manager to commit(this txn can't fail)
+  if (commit)
+    transaction_manager->Commit(txn);
+  else
+    transaction_manager->Abort(txn);
+  // hand back transaction pointer for reuse and set to null
+  transaction_manager->Release(txn);
+  connection->transaction_ = nullptr;
+  connection->writing_ = false;
+  if (connection->cursors_ > 0)
+    connection->transaction_ = transaction_manager->Begin();
+}
+
 int VtabOpen(sqlite3_vtab *pVtab, sqlite3_vtab_cursor **ppCursor) {
   // LOG_DEBUG("VtabOpen");
-  // if read operation, begin transaction here
-  if (global_transaction_ == nullptr) {
-    VtabBegin(pVtab);
+  TableHandle *handle = reinterpret_cast<TableHandle *>(pVtab);
+  Connection *connection = handle->connection_;
+  // if read operation, begin transaction here. A write statement has begun
+  // one, what it scans it may update
+  bool for_update = connection->writing_;
+  if (connection->transaction_ == nullptr) {
+    connection->transaction_ =
+        storage_engine_->transaction_manager_->Begin();
   }
-  VirtualTable *virtual_table = reinterpret_cast<VirtualTable *>(pVtab);
-  Cursor *cursor = new Cursor(virtual_table);
+  connection->cursors_++;
+  Cursor *cursor = new Cursor(handle->table_, connection, for_update);
   *ppCursor = reinterpret_cast<sqlite3_vtab_cursor *>(cursor);
 
   return SQLITE_OK;
@@ -172,9 +591,12 @@ int VtabOpen(sqlite3_vtab *pVtab, sqlite3_vtab_cursor **ppCursor) {
 int VtabClose(sqlite3_vtab_cursor *cur) {
   // LOG_DEBUG("VtabClose");
   Cursor *cursor = reinterpret_cast<Cursor *>(cur);
-  // if read operation, commit transaction here
-  VtabCommit(nullptr);
+  Connection *connection =
+      reinterpret_cast<TableHandle *>(cur->pVtab)->connection_;
   delete cursor;
+  // if read operation, the last cursor commits transaction here
+  if (--connection->cursors_ == 0 && !connection->writing_)
+    EndTransaction(connection, true);
   return SQLITE_OK;
 }
 
@@ -188,14 +610,47 @@ int VtabFilter(sqlite3_vtab_cursor *pVtabCursor, int idxNum, const char *idxStr,
                int argc, sqlite3_value **argv) {
   // LOG_DEBUG("VtabFilter");
   Cursor *cursor = reinterpret_cast<Cursor *>(pVtabCursor);
-  Schema *key_schema;
-  // if indexed scan
-  if (idxNum == 1) {
+  VirtualTable *table = cursor->GetVirtualTable();
+  // the columns read, then what the scan takes, see ScanPlan
+  char *rest;
+  cursor->SetColumns(strtoull(idxStr, &rest, 16));
+  idxStr = rest;
+  // the kind of scan, then the index it uses
+  int kind = idxNum & 0xff;
+  Index *index = nullptr;
+  if (kind == 1 || kind == 2 || kind >= 4)
+    index = table->GetIndex(static_cast<size_t>(idxNum >> 8));
+  // if indexed scan, index-only for 2
+  if (kind == 1 || kind == 2) {
     cursor->SetScanFlag(true);
     // Construct the tuple for point query
-    key_schema = cursor->GetKeySchema();
-    Tuple scan_tuple = ConstructTuple(key_schema, argv);
-    cursor->ScanKey(scan_tuple);
+    Tuple scan_tuple =
+        ConstructTuple(index->GetKeySchema(), argv, cursor->GetArena(),
+                       table->GetDictionary(), &index->GetKeyAttrs());
+    if (kind == 2)
+      cursor->ScanCovering(index, scan_tuple);
+    else
+      cursor->ScanKey(index, scan_tuple);
+  } else if (kind == 4) {
+    cursor->SetScanFlag(true);
+    Tuple low, high;
+    bool found = ConstructKeyRange(index, idxStr, argc, argv,
+                                   table->GetDictionary(), low, high);
+    cursor->ScanKeyRange(index, low, high, !found);
+  } else if (kind == 5 || kind == 6) {
+    cursor->SetScanFlag(true);
+    cursor->ScanOrdered(index, kind == 6);
+  } else if (kind == 3) {
+    cursor->SetScanFlag(false);
+    std::vector<ScanPredicate> predicates;
+    bool found = ConstructPredicates(table->GetSchema(), idxStr, argc, argv,
+                                     table->GetDictionary(), predicates);
+    cursor->ScanFiltered(
+        ConstructRanges(idxStr, argc, argv, table->GetDictionary()),
+        predicates, !found);
+  } else {
+    cursor->SetScanFlag(false);
+    cursor->Scan();
   }
   return SQLITE_OK;
 }
@@ -216,30 +671,59 @@ int VtabEof(sqlite3_vtab_cursor *cur) {
 int VtabColumn(sqlite3_vtab_cursor *cur, sqlite3_context *ctx, int i) {
   Cursor *cursor = reinterpret_cast<Cursor *>(cur);
   Schema *schema = cursor->GetVirtualTable()->GetSchema();
-  // get column type and value
+  // a dictionary encoded column has its string decoded only here, the
+  // dictionary keeps it
+  Dictionary *dictionary = cursor->GetVirtualTable()->GetDictionary();
+  if (dictionary->IsEncoded(i)) {
+    const char *data;
+    uint32_t length;
+    if (!dictionary->Decode(i, cursor->GetCurrentFixed<int32_t>(schema, i),
+                            data, length))
+      return SQLITE_ERROR;
+    sqlite3_result_text(ctx, data, static_cast<int>(length), SQLITE_STATIC);
+    return SQLITE_OK;
+  }
+  // get column type and value, fixed-size ones read without a Value
   TypeId type = schema->GetType(i);
-  Value v = cursor->GetCurrentValue(schema, i);
 
   switch (type) {
   case TypeId::TINYINT:
   case TypeId::BOOLEAN:
-    sqlite3_result_int(ctx, (int)v.GetAs<int8_t>());
+    sqlite3_result_int(ctx, (int)cursor->GetCurrentFixed<int8_t>(schema, i));
     break;
   case TypeId::SMALLINT:
-    sqlite3_result_int(ctx, (int)v.GetAs<int16_t>());
+    sqlite3_result_int(ctx,
+                       (int)cursor->GetCurrentFixed<int16_t>(schema, i));
     break;
   case TypeId::INTEGER:
-    sqlite3_result_int(ctx, (int)v.GetAs<int32_t>());
+    sqlite3_result_int(ctx,
+                       (int)cursor->GetCurrentFixed<int32_t>(schema, i));
     break;
   case TypeId::BIGINT:
-    sqlite3_result_int64(ctx, (sqlite3_int64)v.GetAs<int64_t>());
+    sqlite3_result_int64(
+        ctx, (sqlite3_int64)cursor->GetCurrentFixed<int64_t>(schema, i));
     break;
   case TypeId::DECIMAL:
-    sqlite3_result_double(ctx, v.GetAs<double>());
+    sqlite3_result_double(ctx, cursor->GetCurrentFixed<double>(schema, i));
     break;
-  case TypeId::VARCHAR:
-    sqlite3_result_text(ctx, v.GetData(), -1, SQLITE_TRANSIENT);
+  case TypeId::VARCHAR: {
+    // copied once, by sqlite straight from the page or the tuple. Not
+    // SQLITE_STATIC: sqlite keeps static strings past the row, as min and
+    // max do
+    auto result = [ctx](const char *data, uint32_t length) {
+      sqlite3_result_text(ctx, data, static_cast<int>(length),
+                          SQLITE_TRANSIENT);
+    };
+    if (cursor->ReadCurrentString(schema, i, result))
+      break;
+    // null or spilled
+    Value v = cursor->GetCurrentValue(schema, i);
+    if (v.IsNull())
+      sqlite3_result_null(ctx);
+    else
+      result(v.GetData(), v.GetLength() - 1);
     break;
+  }
   default:
     return SQLITE_ERROR;
   } // End of switch
@@ -254,71 +738,124 @@ int VtabRowid(sqlite3_vtab_cursor *cur, sqlite3_int64 *pRowid) {
   return SQLITE_OK;
 }
 
+/*
+ * Insert the entries of tuple, the row at rid, into the indexes of the table
+ * of handle, or delete them, see VirtualTable::InsertEntries. The change is
+ * kept for a rollback of the connection to undo
+ */
+static void ChangeEntries(TableHandle *handle, const Tuple &tuple,
+                          const RID &rid, bool insert,
+                          const std::vector<bool> *changed = nullptr) {
+  Connection *connection = handle->connection_;
+  if (insert)
+    handle->table_->InsertEntries(tuple, rid, connection->transaction_,
+                                  changed);
+  else
+    handle->table_->DeleteEntries(tuple, rid, connection->transaction_,
+                                  changed);
+  IndexChange change{handle->table_, tuple, rid, insert,
+                     changed != nullptr ? *changed : std::vector<bool>()};
+  // the tuples of a statement are gone at its next row
+  change.tuple_.Detach();
+  connection->index_changes_.push_back(std::move(change));
+}
+
 int VtabUpdate(sqlite3_vtab *pVTab, int argc, sqlite3_value **argv,
                sqlite_int64 *pRowid) {
   // LOG_DEBUG("VtabUpdate");
-  VirtualTable *table = reinterpret_cast<VirtualTable *>(pVTab);
+  TableHandle *handle = reinterpret_cast<TableHandle *>(pVTab);
+  VirtualTable *table = handle->table_;
+  Transaction *txn = handle->connection_->transaction_;
+  Arena *statement_arena = &handle->connection_->statement_arena_;
+  // the tuples of the row before are written by now
+  statement_arena->Reset();
   // The single row with rowid equal to argv[0] is deleted
   if (argc == 1) {
     const RID rid(sqlite3_value_int64(argv[0]));
-    // delete entry from index
-    table->DeleteEntry(rid);
+    // delete entries from the indexes
+    Tuple old_tuple;
+    if (table->ReadTuple(rid, old_tuple, txn))
+      ChangeEntries(handle, old_tuple, rid, false);
     // delete tuple from table heap
-    table->DeleteTuple(rid);
+    table->DeleteTuple(rid, txn);
   }
   // A new row is inserted with a rowid argv[1] and column values in argv[2] and
   // following. If argv[1] is an SQL NULL, the a new unique rowid is generated
   // automatically.
   else if (argc > 1 && sqlite3_value_type(argv[0]) == SQLITE_NULL) {
     Schema *schema = table->GetSchema();
-    Tuple tuple = ConstructTuple(schema, (argv + 2));
+    Tuple tuple = ConstructTuple(schema, (argv + 2), statement_arena,
+                                 table->GetDictionary());
     // insert into table heap
     RID rid;
-    table->InsertTuple(tuple, rid);
-    // insert into index
-    table->InsertEntry(tuple, rid);
+    table->InsertTuple(tuple, rid, txn);
+    // insert into the indexes
+    ChangeEntries(handle, tuple, rid, true);
   }
   // The row with rowid argv[0] is updated with new values in argv[2] and
   // following parameters.
   else if (argc > 1 && sqlite3_value_type(argv[0]) != SQLITE_NULL) {
     Schema *schema = table->GetSchema();
-    Tuple tuple = ConstructTuple(schema, (argv + 2));
+    Tuple tuple = ConstructTuple(schema, (argv + 2), statement_arena,
+                                 table->GetDictionary());
     RID rid(sqlite3_value_int64(argv[0]));
-    // for update, index always delete and insert
-    // because you have no clue key has been updated or not
-    table->DeleteEntry(rid);
+    // an index entry only changes with its key or the rid, an update of
+    // other columns in place leaves the index alone. The row before is read
+    // once for all the indexes
+    Tuple old_tuple;
+    bool found = table->ReadTuple(rid, old_tuple, txn);
+    std::vector<bool> changed(table->GetIndexCount(), true);
+    if (found) {
+      changed = table->ChangedEntries(old_tuple, tuple);
+      ChangeEntries(handle, old_tuple, rid, false, &changed);
+    }
     // if true, then update succeed, rid keep the same
     // else, delete & insert
-    if (table->UpdateTuple(tuple, rid) == false) {
-      table->DeleteTuple(rid);
+    if (table->UpdateTuple(tuple, rid, txn) == false) {
+      if (found) {
+        std::vector<bool> unchanged(changed.size());
+        for (size_t i = 0; i < changed.size(); i++)
+          unchanged[i] = !changed[i];
+        ChangeEntries(handle, old_tuple, rid, false, &unchanged);
+      }
+      table->DeleteTuple(rid, txn);
       // rid should be different
-      table->InsertTuple(tuple, rid);
+      table->InsertTuple(tuple, rid, txn);
+      ChangeEntries(handle, tuple, rid, true);
+    } else {
+      ChangeEntries(handle, tuple, rid, true, &changed);
     }
-    table->InsertEntry(tuple, rid);
   }
   return SQLITE_OK;
 }
 
 int VtabBegin(sqlite3_vtab *pVTab) {
   // LOG_DEBUG("VtabBegin");
-  // create new transaction(write operation will call this method)
-  global_transaction_ = storage_engine_->transaction_manager_->Begin();
+  // create new transaction(write operation will call this method), once
+  // for all the tables of the connection it writes
+  Connection *connection = reinterpret_cast<TableHandle *>(pVTab)->connection_;
+  if (connection->transaction_ == nullptr) {
+    connection->transaction_ =
+        storage_engine_->transaction_manager_->Begin();
+  }
+  connection->writing_ = true;
   return SQLITE_OK;
 }
 
 int VtabCommit(sqlite3_vtab *pVTab) {
   // LOG_DEBUG("VtabCommit");
-  auto transaction = GetTransaction();
-  if (transaction == nullptr)
-    return SQLITE_OK;
-  // get global txn manager
-  auto transaction_manager = storage_engine_->transaction_manager_;
-  // invoke transaction manager to commit(this txn can't fail)
-  transaction_manager->Commit(transaction);
-  // when commit, delete transaction pointer and set to null
-  delete transaction;
-  global_transaction_ = nullptr;
+  // called for each table written, the first one commits
+  Connection *connection = reinterpret_cast<TableHandle *>(pVTab)->connection_;
+  if (connection->writing_)
+    EndTransaction(connection, true);
+  return SQLITE_OK;
+}
 
+int VtabRollback(sqlite3_vtab *pVTab) {
+  // LOG_DEBUG("VtabRollback");
+  Connection *connection = reinterpret_cast<TableHandle *>(pVTab)->connection_;
+  if (connection->writing_)
+    EndTransaction(connection, false);
   return SQLITE_OK;
 }
 
@@ -340,7 +877,7 @@ sqlite3_module VtableModule = {
     VtabBegin,      /* xBegin */
     0,              /* xSync */
     VtabCommit,     /* xCommit */
-    0,              /* xRollback */
+    VtabRollback,   /* xRollback */
     0,              /* xFindMethod */
     0,              /* xRename */
     0,              /* xSavepoint */
@@ -348,35 +885,263 @@ sqlite3_module VtableModule = {
     0,              /* xRollbackTo */
 };
 
-#ifdef _WIN32
-__declspec(dllexport)
-#endif
-    extern "C" int sqlite3_vtable_init(sqlite3 *db, char **pzErrMsg,
-                                       const sqlite3_api_routines *pApi) {
-  SQLITE_EXTENSION_INIT2(pApi);
+// the fields of a line of a CSV file, comma separated. A field in double
+// quotes may have commas, and a double quote as two
+static std::vector<std::string> SplitCsvLine(const std::string &line) {
+  std::vector<std::string> fields(1);
+  bool quoted = false;
+  for (size_t i = 0; i < line.size(); i++) {
+    char c = line[i];
+    if (quoted) {
+      if (c != '"')
+        fields.back() += c;
+      else if (i + 1 < line.size() && line[i + 1] == '"')
+        fields.back() += line[++i];
+      else
+        quoted = false;
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == ',') {
+      fields.emplace_back();
+    } else if (c != '\r') {
+      fields.back() += c;
+    }
+  }
+  return fields;
+}
+
+/*
+ * vtable_import(table, source): the rows of source appended to the virtual
+ * table at once, see VirtualTable::Import, instead of a VtabUpdate each;
+ * the number of rows. source is a CSV file, by its .csv name, a row a line
+ * and no header, or else a table or view of the connection. The import is
+ * a transaction of its own, rolled back if a row fails
+ */
+static void VtabImport(sqlite3_context *context, int argc,
+                       sqlite3_value **argv) {
+  const char *name =
+      reinterpret_cast<const char *>(sqlite3_value_text(argv[0]));
+  const char *source =
+      reinterpret_cast<const char *>(sqlite3_value_text(argv[1]));
+  if (name == nullptr || source == nullptr) {
+    sqlite3_result_error(context, "vtable_import takes a table and a source",
+                         -1);
+    return;
+  }
+  // the table stays while it is imported into, as if connected
+  VirtualTable *table = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(storage_engine_latch_);
+    auto shared = tables_.find(name);
+    if (shared != tables_.end()) {
+      table = shared->second.first;
+      shared->second.second++;
+    }
+  }
+  if (table == nullptr) {
+    sqlite3_result_error(context, "no such virtual table", -1);
+    return;
+  }
+
+  Schema *schema = table->GetSchema();
+  int column_count = schema->GetColumnCount();
+  std::string file(source);
+  bool csv = file.size() > 4 && file.compare(file.size() - 4, 4, ".csv") == 0;
+  std::ifstream in;
+  std::string sql;
+  if (csv) {
+    in.open(file);
+    // the fields of a line, bound as text, become values sqlite converts
+    sql = "SELECT ?1";
+    for (int i = 2; i <= column_count; i++)
+      sql += ", ?" + std::to_string(i);
+  } else {
+    std::string quoted;
+    for (char c : file)
+      quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+    sql = "SELECT * FROM \"" + quoted + "\"";
+  }
+  std::string error;
+  sqlite3_stmt *stmt = nullptr;
+  if (csv && !in.is_open())
+    error = "can't open " + file;
+  else if (sqlite3_prepare_v2(sqlite3_context_db_handle(context), sql.c_str(),
+                              -1, &stmt, nullptr) != SQLITE_OK)
+    error = sqlite3_errmsg(sqlite3_context_db_handle(context));
+  else if (sqlite3_column_count(stmt) != column_count)
+    error = "source has not the columns of the table";
+
+  size_t count = 0;
+  if (error.empty()) {
+    Arena arena;
+    std::vector<sqlite3_value *> values(column_count);
+    bool done = false;
+    auto next = [&](std::vector<Tuple> &tuples) {
+      arena.Reset();
+      while (!done && tuples.size() < IMPORT_BATCH_SIZE) {
+        if (csv) {
+          std::string line;
+          if (!std::getline(in, line)) {
+            done = true;
+            break;
+          }
+          if (line.empty() || line == "\r")
+            continue;
+          std::vector<std::string> fields = SplitCsvLine(line);
+          if (static_cast<int>(fields.size()) != column_count)
+            throw Exception("line of " + std::to_string(fields.size()) +
+                            " fields");
+          sqlite3_reset(stmt);
+          for (int i = 0; i < column_count; i++)
+            sqlite3_bind_text(stmt, i + 1, fields[i].c_str(), -1,
+                              SQLITE_TRANSIENT);
+        }
+        int rc = sqlite3_step(stmt);
+        if (rc == SQLITE_DONE && !csv) {
+          done = true;
+          break;
+        }
+        if (rc != SQLITE_ROW)
+          throw Exception(sqlite3_errmsg(sqlite3_db_handle(stmt)));
+        for (int i = 0; i < column_count; i++)
+          values[i] = sqlite3_column_value(stmt, i);
+        tuples.push_back(ConstructTuple(schema, values.data(), &arena,
+                                        table->GetDictionary()));
+      }
+      return !tuples.empty();
+    };
+    auto transaction_manager = storage_engine_->transaction_manager_;
+    Transaction *txn = transaction_manager->Begin();
+    try {
+      if (!table->Import(next, txn, count))
+        error = "a row did not fit the table";
+    } catch (Exception &e) {
+      error = e.what();
+    }
+    if (error.empty())
+      transaction_manager->Commit(txn);
+    else
+      transaction_manager->Abort(txn);
+    transaction_manager->Release(txn);
+  }
+  sqlite3_finalize(stmt);
+
+  {
+    std::lock_guard<std::mutex> guard(storage_engine_latch_);
+    auto shared = tables_.find(name);
+    if (--shared->second.second == 0) {
+      delete shared->second.first;
+      tables_.erase(shared);
+    }
+  }
+  if (error.empty())
+    sqlite3_result_int64(context, static_cast<sqlite3_int64>(count));
+  else
+    sqlite3_result_error(context, error.c_str(), -1);
+}
+
+/*
+ * The storage engine of the process, for the first connection to load the
+ * module
+ */
+static void StartStorageEngine() {
   std::string db_file_name = "vtable.db";
   struct stat buffer;
   bool is_file_exist = (stat(db_file_name.c_str(), &buffer) == 0);
 
-  // init storage engine
-  storage_engine_ = new StorageEngine(db_file_name);
-  // start the logging
-  storage_engine_->log_manager_->RunFlushThread();
+  // init storage engine, sizes may be overridden from the environment
+  size_t buffer_pool_size = BUFFER_POOL_SIZE;
+  size_t page_size = PAGE_SIZE;
+  if (const char *value = std::getenv("VTABLE_BUFFER_POOL_SIZE")) {
+    buffer_pool_size = std::max<size_t>(1, std::strtoul(value, nullptr, 10));
+  }
+  size_t index_pool_size = 0;
+  if (const char *value = std::getenv("VTABLE_INDEX_POOL_SIZE")) {
+    index_pool_size = std::strtoul(value, nullptr, 10);
+  }
+  if (const char *value = std::getenv("VTABLE_PAGE_SIZE")) {
+    if (IsValidPageSize(std::strtoul(value, nullptr, 10))) {
+      page_size = std::strtoul(value, nullptr, 10);
+    }
+  }
+  // bytes the engine may use at most, 0 or unset for no budget
+  if (const char *value = std::getenv("VTABLE_MEMORY_BUDGET")) {
+    MemoryTracker::Instance().SetBudget(std::strtoull(value, nullptr, 10));
+  }
+  // a pool partition per NUMA node, the log flusher on the node loading us
+  const char *numa = std::getenv("VTABLE_NUMA");
+  bool numa_aware = numa != nullptr && std::strcmp(numa, "1") == 0;
+  size_t background_threads = BACKGROUND_THREADS;
+  if (const char *value = std::getenv("VTABLE_BACKGROUND_THREADS")) {
+    background_threads =
+        std::max<size_t>(1, std::strtoul(value, nullptr, 10));
+  }
+  storage_engine_ =
+      new StorageEngine(db_file_name, buffer_pool_size, page_size, false,
+                        index_pool_size, numa_aware, background_threads);
+  // start the logging, and the checkpoints bounding recovery
+  storage_engine_->log_manager_->RunFlushThread(
+      numa_aware ? Numa::CurrentNode() : -1);
+  storage_engine_->checkpoint_manager_->RunCheckpointThread(
+      storage_engine_->scheduler_);
   // create header page from BufferPoolManager if necessary
   if (!is_file_exist) {
     page_id_t header_page_id;
-    storage_engine_->buffer_pool_manager_->NewPage(header_page_id);
+    HeaderPage *header_page = static_cast<HeaderPage *>(
+        storage_engine_->buffer_pool_manager_->NewPage(header_page_id));
+    header_page->Init();
 
     assert(header_page_id == HEADER_PAGE_ID);
     storage_engine_->buffer_pool_manager_->UnpinPage(header_page_id, true);
   }
+  // the tables and indexes, read into memory once
+  storage_engine_->catalog_->Load();
+}
+
+/*
+ * The module is gone with its connection: what the connection left open is
+ * rolled back, and the last one stops the storage engine
+ */
+static void ReleaseConnection(void *pAux) {
+  Connection *connection = reinterpret_cast<Connection *>(pAux);
+  std::lock_guard<std::mutex> guard(storage_engine_latch_);
+  if (connection->transaction_ != nullptr) {
+    connection->cursors_ = 0;
+    EndTransaction(connection, false);
+  }
+  delete connection;
+  if (--storage_engine_users_ == 0) {
+    delete storage_engine_;
+    storage_engine_ = nullptr;
+  }
+}
 
-  int rc = sqlite3_create_module(db, "vtable", &VtableModule, nullptr);
-  return rc;
+#ifdef _WIN32
+__declspec(dllexport)
+#endif
+    extern "C" int sqlite3_vtable_init(sqlite3 *db, char **pzErrMsg,
+                                       const sqlite3_api_routines *pApi) {
+  SQLITE_EXTENSION_INIT2(pApi);
+  {
+    std::lock_guard<std::mutex> guard(storage_engine_latch_);
+    if (storage_engine_users_++ == 0)
+      StartStorageEngine();
+  }
+  int rc = sqlite3_create_function_v2(db, "vtable_import", 2, SQLITE_UTF8,
+                                      nullptr, VtabImport, nullptr, nullptr,
+                                      nullptr);
+  if (rc == SQLITE_OK)
+    rc = RegisterMetricsTable(db);
+  if (rc != SQLITE_OK)
+    return rc;
+  // each connection gets a Connection of its own, released as it closes
+  return sqlite3_create_module_v2(db, "vtable", &VtableModule,
+                                  new Connection(), ReleaseConnection);
 }
 
 /* Helpers */
-Schema *ParseCreateStatement(const std::string &sql_base) {
+Schema *ParseCreateStatement(const std::string &sql_base,
+                             std::vector<int> *dictionary_columns) {
   std::string::size_type n;
   std::vector<Column> v;
   std::string column_name;
@@ -396,6 +1161,13 @@ Schema *ParseCreateStatement(const std::string &sql_base) {
     n = t.find_first_of(' ');
     column_name = t.substr(0, n);
     column_type = t.substr(n + 1);
+    // "dict varchar(size)", the string is kept in the dictionary
+    bool dictionary = false;
+    const std::string dict = "dict ";
+    if (column_type.compare(0, dict.size(), dict) == 0) {
+      dictionary = true;
+      column_type = column_type.substr(dict.size());
+    }
     // deal with varchar(size) situation
     n = column_type.find_first_of('(');
     if (n != std::string::npos) {
@@ -422,6 +1194,13 @@ Schema *ParseCreateStatement(const std::string &sql_base) {
     if (type == INVALID) {
       throw Exception(EXCEPTION_TYPE_UNKNOWN_TYPE,
                       "unknown type for create table");
+    } else if (dictionary) {
+      if (type != VARCHAR)
+        throw Exception(EXCEPTION_TYPE_UNKNOWN_TYPE,
+                        "only a varchar is dictionary encoded");
+      if (dictionary_columns != nullptr)
+        dictionary_columns->push_back(static_cast<int>(v.size()));
+      v.emplace_back(Column(INTEGER, Type::GetTypeSize(INTEGER), column_name));
     } else if (type == VARCHAR) {
       Column col(type, column_length, column_name);
       v.emplace_back(col);
@@ -436,6 +1215,10 @@ Schema *ParseCreateStatement(const std::string &sql_base) {
   return schema;
 }
 
+bool IsPaxArgument(int argc, const char *const *argv) {
+  return argc > 4 && std::string(argv[argc - 1]) == "pax";
+}
+
 IndexMetadata *ParseIndexStatement(std::string &sql,
                                    const std::string &table_name,
                                    Schema *schema) {
@@ -450,6 +1233,79 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
   assert(n != std::string::npos);
   index_name = sql.substr(0, n);
   sql = sql.substr(n + 1);
+  auto ends_with = [&sql](const std::string &suffix) {
+    return sql.size() >= suffix.size() &&
+           sql.compare(sql.size() - suffix.size(), suffix.size(), suffix) == 0;
+  };
+  // an optional trailing "with bloom" gives the index a Bloom filter
+  bool bloom_filter = false;
+  const std::string with_bloom = " with bloom";
+  if (ends_with(with_bloom)) {
+    bloom_filter = true;
+    sql = sql.substr(0, sql.size() - with_bloom.size());
+  }
+  // before it an optional "using hash", "using blink", "using varkey",
+  // "using bepsilon" or "using art" picks the hash index, the B-link tree, the
+  // tree of variable-length keys, the write-optimized B-epsilon tree or the
+  // in-memory adaptive radix tree
+  IndexType index_type = IndexType::BPLUS_TREE;
+  const std::string using_hash = " using hash";
+  const std::string using_blink = " using blink";
+  const std::string using_varkey = " using varkey";
+  const std::string using_bepsilon = " using bepsilon";
+  const std::string using_art = " using art";
+  if (ends_with(using_hash)) {
+    index_type = IndexType::HASH;
+    sql = sql.substr(0, sql.size() - using_hash.size());
+  } else if (ends_with(using_blink)) {
+    index_type = IndexType::BLINK_TREE;
+    sql = sql.substr(0, sql.size() - using_blink.size());
+  } else if (ends_with(using_varkey)) {
+    index_type = IndexType::VARKEY_TREE;
+    sql = sql.substr(0, sql.size() - using_varkey.size());
+  } else if (ends_with(using_bepsilon)) {
+    index_type = IndexType::BEPSILON_TREE;
+    sql = sql.substr(0, sql.size() - using_bepsilon.size());
+  } else if (ends_with(using_art)) {
+    index_type = IndexType::ART;
+    sql = sql.substr(0, sql.size() - using_art.size());
+  }
+  if (bloom_filter && index_type != IndexType::BPLUS_TREE)
+    throw Exception(EXCEPTION_TYPE_INDEX,
+                    "can't create index, only a B+ tree has a Bloom filter");
+  // before it an optional "non unique", for a B+ tree only
+  bool unique = true;
+  const std::string non_unique = " non unique";
+  if (ends_with(non_unique)) {
+    if (index_type != IndexType::BPLUS_TREE)
+      throw Exception(EXCEPTION_TYPE_INDEX,
+                      "can't create index, only a B+ tree is non unique");
+    unique = false;
+    sql = sql.substr(0, sql.size() - non_unique.size());
+  }
+
+  // the key columns, then after "include" those a B+ tree keeps besides.
+  // Entries of a non unique one share a key, and with it the included bytes
+  std::vector<int> include_attrs;
+  const std::string include = " include ";
+  n = sql.find(include);
+  if (n != std::string::npos) {
+    if (index_type != IndexType::BPLUS_TREE || bloom_filter || !unique)
+      throw Exception(EXCEPTION_TYPE_INDEX,
+                      "can't create index, only a unique B+ tree without a "
+                      "Bloom filter has included columns");
+    for (std::string &t :
+         StringUtility::Split(sql.substr(n + include.size()), ',')) {
+      StringUtility::Trim(t);
+      column_id = schema->GetColumnID(t);
+      if (column_id != -1)
+        include_attrs.emplace_back(column_id);
+    }
+    if (include_attrs.empty())
+      throw Exception(EXCEPTION_TYPE_INDEX,
+                      "can't create index, format error");
+    sql = sql.substr(0, n);
+  }
 
   std::vector<std::string> tok = StringUtility::Split(sql, ',');
   // iterate through returned result
@@ -463,19 +1319,259 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
     throw Exception(EXCEPTION_TYPE_INDEX, "can't create index, format error");
 
   IndexMetadata *metadata =
-      new IndexMetadata(index_name, table_name, schema, key_attrs);
+      new IndexMetadata(index_name, table_name, schema, key_attrs, index_type,
+                        unique, bloom_filter, include_attrs);
 
   // LOG_DEBUG("%s", metadata->ToString().c_str());
   return metadata;
 }
 
-Tuple ConstructTuple(Schema *schema, sqlite3_value **argv) {
+/*
+ * The bounds are compared with the column as numbers, BIGINT or DECIMAL
+ * whatever its type; a constraint on something else is left to sqlite. The
+ * string of a dictionary encoded column is the code, -1 if there is none
+ */
+std::vector<ScanRange> ConstructRanges(const char *idx_str, int argc,
+                                       sqlite3_value **argv,
+                                       Dictionary *dictionary) {
+  std::vector<ScanRange> ranges;
+  const char *pos = idx_str;
+  for (int i = 0; i < argc; i++) {
+    char *end;
+    int column = static_cast<int>(strtol(pos, &end, 10));
+    int op = static_cast<int>(strtol(end, &end, 10));
+    pos = end;
+    Value bound(TypeId::INVALID);
+    if (dictionary != nullptr && dictionary->IsEncoded(column)) {
+      int32_t code = -1;
+      auto text = reinterpret_cast<const char *>(sqlite3_value_text(argv[i]));
+      if (text != nullptr)
+        dictionary->Lookup(column, text, strlen(text), code);
+      ScanRange range(column);
+      range.low = Value(TypeId::BIGINT, static_cast<int64_t>(code));
+      range.high = range.low;
+      range.has_low = range.has_high = true;
+      ranges.push_back(range);
+      continue;
+    }
+    switch (sqlite3_value_numeric_type(argv[i])) {
+    case SQLITE_INTEGER:
+      bound = Value(TypeId::BIGINT,
+                    static_cast<int64_t>(sqlite3_value_int64(argv[i])));
+      break;
+    case SQLITE_FLOAT:
+      bound = Value(TypeId::DECIMAL, sqlite3_value_double(argv[i]));
+      break;
+    default:
+      continue;
+    }
+    ScanRange range(column);
+    if (op != SQLITE_INDEX_CONSTRAINT_LT && op != SQLITE_INDEX_CONSTRAINT_LE) {
+      range.low = bound;
+      range.has_low = true;
+    }
+    if (op != SQLITE_INDEX_CONSTRAINT_GT && op != SQLITE_INDEX_CONSTRAINT_GE) {
+      range.high = bound;
+      range.has_high = true;
+    }
+    ranges.push_back(range);
+  }
+  return ranges;
+}
+
+/*
+ * The inclusive bound a constraint with op on value puts on the low or high
+ * side of a key column of type, into bound; left alone if value is not a
+ * number. Integer columns take the nearest integer inside the constraint,
+ * clamped to their range; false if it is out of it
+ */
+static bool KeyBound(TypeId type, int op, sqlite3_value *value, bool is_low,
+                     Value &bound) {
+  int numeric_type = sqlite3_value_numeric_type(value);
+  if (numeric_type != SQLITE_INTEGER && numeric_type != SQLITE_FLOAT)
+    return true;
+  if (type == TypeId::DECIMAL) {
+    bound = Value(type, sqlite3_value_double(value));
+    return true;
+  }
+  bool strict =
+      op == SQLITE_INDEX_CONSTRAINT_GT || op == SQLITE_INDEX_CONSTRAINT_LT;
+  return DispatchType(type, [&](auto id) {
+    typedef StoredType<decltype(id)::value> Stored;
+    typedef typename Stored::type T;
+    double x;
+    if (numeric_type == SQLITE_INTEGER) {
+      int64_t i = sqlite3_value_int64(value);
+      if (strict && i == (is_low ? PELOTON_INT64_MAX : PELOTON_INT64_MIN))
+        return false;
+      if (strict)
+        i += is_low ? 1 : -1;
+      if (i >= Stored::Min() && i <= Stored::Max()) {
+        bound = Value(type, static_cast<T>(i));
+        return true;
+      }
+      x = static_cast<double>(i);
+    } else {
+      double d = sqlite3_value_double(value);
+      if (std::isnan(d))
+        return true;
+      x = is_low ? std::ceil(d) : std::floor(d);
+      if (strict && x == d)
+        x += is_low ? 1 : -1;
+    }
+    if (is_low ? x > Stored::Max() : x < Stored::Min())
+      return false;
+    // whole, clamped to where the cast is exact
+    T clamped = x >= Stored::Max()
+                    ? Stored::Max()
+                    : x <= Stored::Min() ? Stored::Min() : static_cast<T>(x);
+    bound = Value(type, clamped);
+    return true;
+  });
+}
+
+// below any other value of a key column of type: its null, see NormalizedKey
+static Value LowestKeyValue(TypeId type) {
+  return DispatchType(type, [&](auto id) {
+    return Value(type, StoredType<decltype(id)::value>::Null());
+  });
+}
+
+// the comparison of a constraint with op
+static BatchCmp FilterCmp(int op) {
+  switch (op) {
+  case SQLITE_INDEX_CONSTRAINT_GT:
+    return BatchCmp::GT;
+  case SQLITE_INDEX_CONSTRAINT_GE:
+    return BatchCmp::GE;
+  case SQLITE_INDEX_CONSTRAINT_LT:
+    return BatchCmp::LT;
+  case SQLITE_INDEX_CONSTRAINT_LE:
+    return BatchCmp::LE;
+  default:
+    return BatchCmp::EQ;
+  }
+}
+
+/*
+ * A constant that is not a number is left to sqlite. An integer column
+ * takes the inclusive bounds of KeyBound, an equality the two of them: one
+ * with a fraction has the low above the high, one out of the range of the
+ * column no bound, and no row matches either
+ */
+bool ConstructPredicates(Schema *schema, const char *idx_str, int argc,
+                         sqlite3_value **argv, Dictionary *dictionary,
+                         std::vector<ScanPredicate> &predicates) {
+  predicates.clear();
+  const char *pos = idx_str;
+  for (int i = 0; i < argc; i++) {
+    char *end;
+    int column = static_cast<int>(strtol(pos, &end, 10));
+    int op = static_cast<int>(strtol(end, &end, 10));
+    pos = end;
+    TypeId type = schema->GetType(column);
+    if (dictionary != nullptr && dictionary->IsEncoded(column)) {
+      int32_t code = -1;
+      auto text = reinterpret_cast<const char *>(sqlite3_value_text(argv[i]));
+      if (text != nullptr)
+        dictionary->Lookup(column, text, strlen(text), code);
+      predicates.emplace_back(column, BatchCmp::EQ, Value(type, code));
+      continue;
+    }
+    Value low(TypeId::INVALID), high(TypeId::INVALID);
+    if (op != SQLITE_INDEX_CONSTRAINT_LT && op != SQLITE_INDEX_CONSTRAINT_LE &&
+        !KeyBound(type, op, argv[i], true, low))
+      return false;
+    if (op != SQLITE_INDEX_CONSTRAINT_GT && op != SQLITE_INDEX_CONSTRAINT_GE &&
+        !KeyBound(type, op, argv[i], false, high))
+      return false;
+    if (type == TypeId::DECIMAL) {
+      // the bound is the constant, strict or not
+      Value &bound = low.GetTypeId() != TypeId::INVALID ? low : high;
+      if (bound.GetTypeId() != TypeId::INVALID)
+        predicates.emplace_back(column, FilterCmp(op), bound);
+      continue;
+    }
+    if (low.GetTypeId() != TypeId::INVALID)
+      predicates.emplace_back(column, BatchCmp::GE, low);
+    if (high.GetTypeId() != TypeId::INVALID)
+      predicates.emplace_back(column, BatchCmp::LE, high);
+  }
+  return true;
+}
+
+bool ConstructKeyRange(Index *index, const char *idx_str, int argc,
+                       sqlite3_value **argv, Dictionary *dictionary,
+                       Tuple &low, Tuple &high) {
+  Schema *key_schema = index->GetKeySchema();
+  const std::vector<int> &key_attrs = index->GetKeyAttrs();
+  int key_count = key_schema->GetColumnCount();
+  // by key column, INVALID where there is no bound
+  std::vector<Value> lows(key_count, Value(TypeId::INVALID));
+  std::vector<Value> highs(key_count, Value(TypeId::INVALID));
+  const char *pos = idx_str;
+  for (int i = 0; i < argc; i++) {
+    char *end;
+    int column = static_cast<int>(strtol(pos, &end, 10));
+    int op = static_cast<int>(strtol(end, &end, 10));
+    pos = end;
+    int key_column = static_cast<int>(
+        std::find(key_attrs.begin(), key_attrs.end(), column) -
+        key_attrs.begin());
+    TypeId type = key_schema->GetType(key_column);
+    if (dictionary != nullptr && dictionary->IsEncoded(column)) {
+      int32_t code = -1;
+      auto text = reinterpret_cast<const char *>(sqlite3_value_text(argv[i]));
+      if (text != nullptr)
+        dictionary->Lookup(column, text, strlen(text), code);
+      lows[key_column] = highs[key_column] = Value(type, code);
+      continue;
+    }
+    if (op != SQLITE_INDEX_CONSTRAINT_LT && op != SQLITE_INDEX_CONSTRAINT_LE &&
+        !KeyBound(type, op, argv[i], true, lows[key_column]))
+      return false;
+    if (op != SQLITE_INDEX_CONSTRAINT_GT && op != SQLITE_INDEX_CONSTRAINT_GE &&
+        !KeyBound(type, op, argv[i], false, highs[key_column]))
+      return false;
+  }
+  // from the first column without a bound on, any value
+  std::vector<Value> low_values, high_values;
+  bool low_open = false, high_open = false;
+  for (int k = 0; k < key_count; k++) {
+    TypeId type = key_schema->GetType(k);
+    low_open = low_open || lows[k].GetTypeId() == TypeId::INVALID;
+    high_open = high_open || highs[k].GetTypeId() == TypeId::INVALID;
+    low_values.push_back(low_open ? LowestKeyValue(type) : lows[k]);
+    high_values.push_back(high_open ? Type::GetMaxValue(type) : highs[k]);
+  }
+  low = Tuple(low_values, key_schema);
+  high = Tuple(high_values, key_schema);
+  return true;
+}
+
+Tuple ConstructTuple(Schema *schema, sqlite3_value **argv, Arena *arena,
+                     Dictionary *dictionary,
+                     const std::vector<int> *key_attrs) {
   int column_count = schema->GetColumnCount();
   Value v(TypeId::INVALID);
   std::vector<Value> values;
+  values.reserve(column_count);
   // iterate through schema, generate column value to insert
   for (int i = 0; i < column_count; i++) {
     TypeId type = schema->GetType(i);
+    int column = key_attrs != nullptr ? (*key_attrs)[i] : i;
+    if (dictionary != nullptr && dictionary->IsEncoded(column)) {
+      auto text = reinterpret_cast<const char *>(sqlite3_value_text(argv[i]));
+      if (text == nullptr)
+        text = "";
+      int32_t code = -1;
+      if (key_attrs == nullptr)
+        code = dictionary->Encode(column, text, strlen(text));
+      else
+        dictionary->Lookup(column, text, strlen(text), code);
+      values.emplace_back(TypeId::INTEGER, code);
+      continue;
+    }
 
     switch (type) {
     case TypeId::BOOLEAN:
@@ -490,48 +1586,116 @@ Tuple ConstructTuple(Schema *schema, sqlite3_value **argv) {
     case TypeId::DECIMAL:
       v = Value(type, sqlite3_value_double(argv[i]));
       break;
-    case TypeId::VARCHAR:
-      v = Value(type, std::string(reinterpret_cast<const char *>(
-                          sqlite3_value_text(argv[i]))));
+    case TypeId::VARCHAR: {
+      // the text lives as long as the call, the tuple copies it
+      const char *text =
+          reinterpret_cast<const char *>(sqlite3_value_text(argv[i]));
+      v = Value(type, text, strlen(text) + 1, false);
       break;
+    }
     default:
       break;
     } // End of switch
     values.emplace_back(v);
   }
-  Tuple tuple(values, schema);
-
-  return tuple;
+  if (arena != nullptr)
+    return Tuple(values, schema, arena);
+  return Tuple(std::move(values), schema);
 }
 
 // serve the functionality of index factory
+// one key size, the structure comes from the metadata
+template <size_t KeySize>
+static Index *ConstructIndexOfSize(IndexMetadata *metadata,
+                                   BufferPoolManager *buffer_pool_manager,
+                                   page_id_t root_id, LogManager *log_manager,
+                                   RootCatalog *root_catalog) {
+  if (metadata->GetIndexType() == IndexType::HASH) {
+    return new HashIndex<GenericKey<KeySize>, RID, GenericComparator<KeySize>>(
+        metadata, buffer_pool_manager, root_id);
+  }
+  if (metadata->GetIndexType() == IndexType::BLINK_TREE) {
+    return new BLinkTreeIndex<GenericKey<KeySize>, RID,
+                              GenericComparator<KeySize>>(
+        metadata, buffer_pool_manager, root_id);
+  }
+  if (metadata->GetIndexType() == IndexType::BEPSILON_TREE) {
+    return new BEpsilonTreeIndex<GenericKey<KeySize>, RID,
+                                 GenericComparator<KeySize>>(
+        metadata, buffer_pool_manager, root_id);
+  }
+  // normalized keys go without the schema: compared as one integer of 4 or 8
+  // bytes, or with memcmp
+  if (NormalizedKey::Fits(metadata->GetKeySchema(), KeySize)) {
+    typedef typename std::conditional<KeySize <= 8, IntegerComparator<KeySize>,
+                                      BytesComparator<KeySize>>::type
+        KeyComparator;
+    return new BPlusTreeIndex<GenericKey<KeySize>, RID, KeyComparator>(
+        metadata, buffer_pool_manager, root_id, log_manager, root_catalog);
+  }
+  return new BPlusTreeIndex<GenericKey<KeySize>, RID,
+                            GenericComparator<KeySize>>(
+      metadata, buffer_pool_manager, root_id, log_manager, root_catalog);
+}
+
 Index *ConstructIndex(IndexMetadata *metadata,
                       BufferPoolManager *buffer_pool_manager,
-                      page_id_t root_id) {
+                      page_id_t root_id, LogManager *log_manager,
+                      RootCatalog *root_catalog) {
+  // keys of any size
+  if (metadata->GetIndexType() == IndexType::VARKEY_TREE) {
+    return new VarKeyTreeIndex(metadata, buffer_pool_manager, root_id);
+  }
+  if (metadata->GetIndexType() == IndexType::ART) {
+    return new ArtIndex(metadata);
+  }
   // The size of the key in bytes
   Schema *key_schema = metadata->GetKeySchema();
   int key_size = key_schema->GetLength();
   // for each varchar attribute, we assume the largest size is 16 bytes
   key_size += 16 * key_schema->GetUnlinedColumnCount();
 
+  // included columns are in the key, after the key columns
+  if (metadata->GetCoveringSchema() != nullptr) {
+    Schema *covering_schema = metadata->GetCoveringSchema();
+    key_size = covering_schema->GetLength() +
+               16 * covering_schema->GetUnlinedColumnCount();
+    if (key_size <= 4) {
+      return new CoveringIndex<4>(metadata, buffer_pool_manager, root_id,
+                                  log_manager, root_catalog);
+    } else if (key_size <= 8) {
+      return new CoveringIndex<8>(metadata, buffer_pool_manager, root_id,
+                                  log_manager, root_catalog);
+    } else if (key_size <= 16) {
+      return new CoveringIndex<16>(metadata, buffer_pool_manager, root_id,
+                                   log_manager, root_catalog);
+    } else if (key_size <= 32) {
+      return new CoveringIndex<32>(metadata, buffer_pool_manager, root_id,
+                                   log_manager, root_catalog);
+    } else if (key_size <= 64) {
+      return new CoveringIndex<64>(metadata, buffer_pool_manager, root_id,
+                                   log_manager, root_catalog);
+    }
+    throw Exception(EXCEPTION_TYPE_INDEX,
+                    "can't create index, included columns too wide");
+  }
+
   if (key_size <= 4) {
-    return new BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>(
-        metadata, buffer_pool_manager, root_id);
+    return ConstructIndexOfSize<4>(metadata, buffer_pool_manager, root_id,
+                                   log_manager, root_catalog);
   } else if (key_size <= 8) {
-    return new BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>(
-        metadata, buffer_pool_manager, root_id);
+    return ConstructIndexOfSize<8>(metadata, buffer_pool_manager, root_id,
+                                   log_manager, root_catalog);
   } else if (key_size <= 16) {
-    return new BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>(
-        metadata, buffer_pool_manager, root_id);
+    return ConstructIndexOfSize<16>(metadata, buffer_pool_manager, root_id,
+                                    log_manager, root_catalog);
   } else if (key_size <= 32) {
-    return new BPlusTreeIndex<GenericKey<32>, RID, GenericComparator<32>>(
-        metadata, buffer_pool_manager, root_id);
+    return ConstructIndexOfSize<32>(metadata, buffer_pool_manager, root_id,
+                                    log_manager, root_catalog);
   } else {
-    return new BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>(
-        metadata, buffer_pool_manager, root_id);
+    return ConstructIndexOfSize<64>(metadata, buffer_pool_manager, root_id,
+                                    log_manager, root_catalog);
   }
 }
 
-Transaction *GetTransaction() { return global_transaction_; }
-
 } // namespace cmudb
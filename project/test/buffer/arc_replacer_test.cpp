@@ -0,0 +1,91 @@
+/**
+ * arc_replacer_test.cpp
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "buffer/arc_replacer.h"
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ARCReplacerTest, SampleTest) {
+  ARCReplacer<int> arc_replacer(4);
+
+  // 1 is seen twice and moves to T2, the others stay in T1
+  arc_replacer.Insert(1);
+  arc_replacer.Insert(2);
+  arc_replacer.Insert(3);
+  arc_replacer.Insert(1);
+  EXPECT_EQ(3, arc_replacer.Size());
+
+  // T1 is evicted before T2, least recently used first
+  int value;
+  arc_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(true, arc_replacer.Erase(3));
+  EXPECT_EQ(false, arc_replacer.Erase(3));
+  arc_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(false, arc_replacer.Victim(value));
+
+  // 2 is remembered in B1, coming back goes straight to T2 and grows p
+  EXPECT_EQ(0, arc_replacer.GetTarget());
+  arc_replacer.Insert(2);
+  EXPECT_EQ(1, arc_replacer.GetGhostHits());
+  EXPECT_EQ(1, arc_replacer.GetTarget());
+  arc_replacer.Insert(4);
+  arc_replacer.Insert(5);
+  arc_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+
+  // 1 is remembered in B2, coming back shrinks p
+  arc_replacer.Insert(1);
+  EXPECT_EQ(2, arc_replacer.GetGhostHits());
+  EXPECT_EQ(0, arc_replacer.GetTarget());
+  EXPECT_EQ(3, arc_replacer.Size());
+}
+
+// hot pages are read between short scans over cold pages
+static size_t RunMixedWorkload(ReplacerType replacer_type) {
+  page_id_t temp_page_id;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager, nullptr, 1, replacer_type);
+
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < 40; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+    page_ids.push_back(temp_page_id);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+
+  size_t next_cold = 2;
+  for (int round = 0; round < 12; ++round) {
+    for (int hot = 0; hot < 2; ++hot) {
+      EXPECT_NE(nullptr, bpm.FetchPage(page_ids[hot]));
+      EXPECT_EQ(true, bpm.UnpinPage(page_ids[hot], false));
+    }
+    for (int scan = 0; scan < 3; ++scan) {
+      page_id_t cold = page_ids[next_cold];
+      next_cold = next_cold + 1 < page_ids.size() ? next_cold + 1 : 2;
+      EXPECT_NE(nullptr, bpm.FetchPage(cold));
+      EXPECT_EQ(true, bpm.UnpinPage(cold, false));
+    }
+  }
+  EXPECT_EQ(12 * 5, bpm.GetHitCount() + bpm.GetMissCount());
+  size_t hits = bpm.GetHitCount();
+
+  delete disk_manager;
+  remove("test.db");
+  return hits;
+}
+
+TEST(ARCReplacerTest, BufferPoolTest) {
+  size_t lru_hits = RunMixedWorkload(ReplacerType::LRU);
+  size_t arc_hits = RunMixedWorkload(ReplacerType::ARC);
+  EXPECT_GT(arc_hits, lru_hits);
+}
+
+} // namespace cmudb
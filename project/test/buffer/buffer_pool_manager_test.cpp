@@ -2,9 +2,13 @@
  * buffer_pool_manager_test.cpp
  */
 
+#include <atomic>
 #include <cstdio>
+#include <thread>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "common/numa.h"
 #include "gtest/gtest.h"
 
 namespace cmudb {
@@ -48,4 +52,571 @@ TEST(BufferPoolManagerTest, SampleTest) {
   remove("test.db");
 }
 
+TEST(BufferPoolManagerTest, PartitionedTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // 4 partitions with 3 frames each
+  BufferPoolManager bpm(12, disk_manager, nullptr, 4);
+  EXPECT_EQ(4, bpm.GetNumInstances());
+
+  for (int i = 0; i < 12; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(i, temp_page_id);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+  }
+  // every partition is full
+  EXPECT_EQ(nullptr, bpm.NewPage(temp_page_id));
+  for (int i = 0; i < 12; ++i) {
+    EXPECT_EQ(true, bpm.UnpinPage(i, true));
+  }
+  // unpinning twice fails
+  EXPECT_EQ(false, bpm.UnpinPage(0, false));
+
+  // concurrent fetches spread over every partition
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < 4; ++tid) {
+    threads.push_back(std::thread([tid, &bpm]() {
+      char expected[PAGE_SIZE];
+      for (int round = 0; round < 100; ++round) {
+        for (int i = tid; i < 12; i += 4) {
+          auto page = bpm.FetchPage(i);
+          ASSERT_NE(nullptr, page);
+          snprintf(expected, PAGE_SIZE, "page %d", i);
+          EXPECT_EQ(0, strcmp(page->GetData(), expected));
+          EXPECT_EQ(true, bpm.UnpinPage(i, false));
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // evict everything through new pages, then read the old ones back
+  for (int i = 12; i < 24; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+  }
+  auto page = bpm.FetchPage(5);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 5"));
+  EXPECT_EQ(true, bpm.UnpinPage(5, false));
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, NumaTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(12, disk_manager, nullptr, 4, ReplacerType::LRU,
+                        FrameAllocation::ALIGNED, 0, true);
+  int nodes = Numa::NodeCount();
+  EXPECT_EQ(nodes, bpm.GetNumaNodes());
+  for (size_t i = 0; i < bpm.GetNumInstances(); ++i) {
+    EXPECT_EQ(static_cast<int>(i) % nodes, bpm.GetNumaNode(i));
+  }
+
+  for (int i = 0; i < 8; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", temp_page_id);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+  EXPECT_EQ(true, bpm.DeletePage(1));
+  EXPECT_EQ(true, bpm.DeletePage(2));
+  bpm.FlushAllPages();
+  // a freed page of a partition on this node before any other
+  int node = Numa::CurrentNode();
+  ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+  EXPECT_EQ(node, bpm.GetNumaNode(temp_page_id % 4));
+  EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+
+  // a cleaner per node
+  bpm.RunPageCleaner();
+  auto page = bpm.FetchPage(5);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, strcmp(page->GetData(), "page 5"));
+  EXPECT_EQ(true, bpm.UnpinPage(5, false));
+  bpm.StopPageCleaner();
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, PageCleanerTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+
+  // ten dirty unpinned pages, nothing is free or clean
+  for (int i = 0; i < 10; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+  // one page stays pinned and must not be written
+  auto pinned = bpm.FetchPage(9);
+  ASSERT_NE(nullptr, pinned);
+
+  bpm.RunPageCleaner(0.5, 1.0);
+  char data[PAGE_SIZE];
+  char expected[PAGE_SIZE];
+  bool cleaned = false;
+  for (int round = 0; round < 200 && !cleaned; ++round) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    cleaned = true;
+    for (int i = 0; i < 9; ++i) {
+      disk_manager->ReadPage(i, data);
+      snprintf(expected, PAGE_SIZE, "page %d", i);
+      cleaned = cleaned && strcmp(data, expected) == 0;
+    }
+  }
+  bpm.StopPageCleaner();
+  EXPECT_EQ(true, cleaned);
+
+  // cleaned pages stay resident
+  for (int i = 0; i < 9; ++i) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+  EXPECT_EQ(true, bpm.UnpinPage(9, false));
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+
+  // twenty pages through ten frames, the first ten end up on disk only
+  for (int i = 0; i < 20; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+
+  bpm.PrefetchRange(0, 5);
+  bpm.WaitForPrefetch();
+
+  // prefetched pages are resident but were never pinned
+  size_t hits = bpm.GetHitCount();
+  char expected[PAGE_SIZE];
+  for (int i = 0; i < 5; ++i) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(1, page->GetPinCount());
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+  EXPECT_EQ(hits + 5, bpm.GetHitCount());
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+// a hint served after its page is deleted reads the freed page in again, the
+// page id handed out anew must not meet that image
+TEST(BufferPoolManagerTest, StalePrefetchTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+  for (int i = 0; i < 20; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+  EXPECT_EQ(true, bpm.DeletePage(3));
+  bpm.FlushAllPages();
+  bpm.Prefetch(3);
+  bpm.WaitForPrefetch();
+
+  auto page = bpm.NewPage(temp_page_id);
+  ASSERT_NE(nullptr, page);
+  ASSERT_EQ(3, temp_page_id);
+  EXPECT_EQ('\0', page->GetData()[0]);
+  snprintf(page->GetData(), PAGE_SIZE, "fresh");
+  EXPECT_EQ(true, bpm.UnpinPage(3, true));
+
+  // the other frames change hands one by one, page 3 stays what it is
+  for (int i = 10; i < 20; ++i) {
+    ASSERT_NE(nullptr, bpm.FetchPage(i));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+    page = bpm.FetchPage(3);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->GetData(), "fresh"));
+    EXPECT_EQ(true, bpm.UnpinPage(3, false));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, FrameAllocationTest) {
+  page_id_t temp_page_id;
+
+  for (auto allocation : {FrameAllocation::HEAP, FrameAllocation::ALIGNED,
+                          FrameAllocation::HUGE_PAGE}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager bpm(10, disk_manager, nullptr, 2, ReplacerType::LRU,
+                          allocation);
+    if (allocation != FrameAllocation::HUGE_PAGE) {
+      EXPECT_EQ(allocation, bpm.GetFrameAllocation());
+    }
+
+    for (int i = 0; i < 10; ++i) {
+      auto page = bpm.NewPage(temp_page_id);
+      ASSERT_NE(nullptr, page);
+      // metadata never shares a cache line, frames start on a page boundary
+      EXPECT_EQ(0, reinterpret_cast<uintptr_t>(page) % CACHELINE_SIZE);
+      if (bpm.GetFrameAllocation() != FrameAllocation::HEAP) {
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(page->GetData()) % 4096);
+      }
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+      EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+    }
+    // push everything out through the disk and read it back
+    for (int i = 10; i < 20; ++i) {
+      EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+      EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+    }
+    char expected[PAGE_SIZE];
+    for (int i = 0; i < 10; ++i) {
+      auto page = bpm.FetchPage(i);
+      ASSERT_NE(nullptr, page);
+      snprintf(expected, PAGE_SIZE, "page %d", i);
+      EXPECT_EQ(0, strcmp(page->GetData(), expected));
+      EXPECT_EQ(true, bpm.UnpinPage(i, false));
+    }
+
+    delete disk_manager;
+    remove("test.db");
+  }
+}
+
+TEST(BufferPoolManagerTest, OptimisticReadTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager);
+  auto page = bpm.NewPage(temp_page_id);
+  ASSERT_NE(nullptr, page);
+
+  // the writer keeps both counters equal, but only under the latch
+  std::atomic<bool> done(false);
+  std::thread writer([page, &done] {
+    int *counters = reinterpret_cast<int *>(page->GetData());
+    for (int i = 1; i <= 20000; ++i) {
+      page->WLatch();
+      counters[0] = i;
+      counters[1] = i;
+      page->WUnlatch();
+    }
+    done = true;
+  });
+
+  size_t validated = 0;
+  int last = 0;
+  while (!done || validated == 0) {
+    uint64_t version = page->BeginOptimisticRead();
+    int first = reinterpret_cast<volatile int *>(page->GetData())[0];
+    int second = reinterpret_cast<volatile int *>(page->GetData())[1];
+    if (page->ValidateOptimisticRead(version)) {
+      EXPECT_EQ(first, second);
+      EXPECT_LE(last, first);
+      last = first;
+      ++validated;
+    }
+  }
+  writer.join();
+  EXPECT_LT(0, validated);
+
+  // a write in between invalidates the read
+  uint64_t version = page->BeginOptimisticRead();
+  page->WLatch();
+  page->WUnlatch();
+  EXPECT_EQ(false, page->ValidateOptimisticRead(version));
+  EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, ConcurrentPinTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(8, disk_manager);
+  for (int i = 0; i < 16; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+
+  // twice as many pages as frames: fast path pins race with evictions
+  std::atomic<int> mismatches(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&bpm, &mismatches, t] {
+      char expected[PAGE_SIZE];
+      for (int i = 0; i < 5000; ++i) {
+        page_id_t page_id = (i * (t + 1) + (i % 3 == 0 ? 0 : t)) % 16;
+        auto page = bpm.FetchPage(page_id);
+        if (page == nullptr) {
+          ++mismatches;
+          continue;
+        }
+        snprintf(expected, PAGE_SIZE, "page %d", page_id);
+        if (page->GetPageId() != page_id ||
+            strcmp(page->GetData(), expected) != 0) {
+          ++mismatches;
+        }
+        bpm.UnpinPage(page_id, false);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, mismatches);
+
+  // every pin was given back
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+  }
+  EXPECT_EQ(nullptr, bpm.NewPage(temp_page_id));
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, CompressedCacheTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager, nullptr, 1, ReplacerType::LRU,
+                        FrameAllocation::ALIGNED, 16 * PAGE_SIZE);
+  for (int i = 0; i < 16; ++i) {
+    auto page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+  // 12 pages were evicted and written back, the tier holds them compressed
+  auto tier = bpm.GetCompressedCacheStats();
+  EXPECT_EQ(12u, tier.entries);
+  EXPECT_GT(12u * PAGE_SIZE / 8, tier.memory_bytes);
+
+  char expected[PAGE_SIZE];
+  for (int i = 0; i < 12; ++i) {
+    auto page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm.UnpinPage(i, false));
+  }
+  tier = bpm.GetCompressedCacheStats();
+  EXPECT_EQ(12u, tier.hits);
+  EXPECT_EQ(0u, tier.misses);
+  EXPECT_EQ(1.0, tier.HitRatio());
+
+  // a deleted page must not come back from the tier
+  EXPECT_EQ(true, bpm.DeletePage(12));
+  bpm.ResetStats();
+  EXPECT_EQ(0u, bpm.GetCompressedCacheStats().hits);
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, StatsTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager, nullptr, 2);
+
+  // four pages fill the free lists, four more evict them dirty
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+  }
+  BufferPoolStats stats = bpm.GetStats();
+  EXPECT_EQ(4, stats.evictions);
+  EXPECT_EQ(4, stats.dirty_write_backs);
+  EXPECT_EQ(4, stats.free_list_empty);
+  EXPECT_EQ(0, stats.no_free_frame);
+  EXPECT_EQ(2, bpm.GetStats(0).evictions);
+  EXPECT_EQ(2, bpm.GetStats(1).evictions);
+
+  // one hit and one miss
+  ASSERT_NE(nullptr, bpm.FetchPage(7));
+  ASSERT_NE(nullptr, bpm.FetchPage(0));
+  stats = bpm.GetStats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_DOUBLE_EQ(0.5, stats.HitRatio());
+  EXPECT_EQ(0, stats.latch_waits);
+
+  bpm.ResetStats();
+  stats = bpm.GetStats();
+  EXPECT_EQ(0, stats.hits + stats.misses + stats.evictions);
+  EXPECT_EQ(0, stats.dirty_write_backs);
+
+  // partition 0 serves even pages with two frames, pin both of them
+  ASSERT_NE(nullptr, bpm.FetchPage(2));
+  EXPECT_EQ(nullptr, bpm.FetchPage(4));
+  EXPECT_EQ(1, bpm.GetStats().no_free_frame);
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, WorkingSetTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  for (int i = 0; i < 12; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  // pages 3, 5, 7 and 9 end up resident, 9 hottest as it stays pinned
+  for (page_id_t page_id : {3, 5, 7, 9}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    if (page_id != 9) {
+      EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+    }
+  }
+  EXPECT_EQ(true, bpm->DumpWorkingSet("test.warm"));
+  EXPECT_EQ(true, bpm->UnpinPage(9, false));
+  delete bpm;
+
+  // a fresh pool warms up from the file without any fetch misses
+  bpm = new BufferPoolManager(4, disk_manager);
+  EXPECT_EQ(true, bpm->LoadWorkingSet("test.warm"));
+  char expected[PAGE_SIZE];
+  for (page_id_t page_id : {3, 5, 7, 9}) {
+    auto page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(4, bpm->GetStats().hits);
+  EXPECT_EQ(0, bpm->GetStats().misses);
+  EXPECT_EQ(false, bpm->LoadWorkingSet("missing.warm"));
+  delete bpm;
+
+  // the coldest page is loaded first and so evicted first
+  bpm = new BufferPoolManager(4, disk_manager);
+  EXPECT_EQ(true, bpm->LoadWorkingSet("test.warm"));
+  ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+  EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  for (page_id_t page_id : {9, 7, 5}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(3, bpm->GetStats().hits);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.warm");
+}
+
+TEST(BufferPoolManagerTest, FlushAllPagesTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // consecutive pages land in different partitions
+  BufferPoolManager *bpm = new BufferPoolManager(12, disk_manager, nullptr, 3);
+  for (int i = 0; i < 12; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, i % 5 != 0));
+  }
+  // pinned dirty pages are flushed too
+  ASSERT_NE(nullptr, bpm->FetchPage(4));
+  // pages 0, 5 and 10 are clean
+  EXPECT_EQ(9u, bpm->FlushAllPages());
+  EXPECT_EQ(0u, bpm->FlushAllPages());
+
+  char data[PAGE_SIZE];
+  char expected[PAGE_SIZE];
+  for (page_id_t page_id = 1; page_id < 12; ++page_id) {
+    if (page_id % 5 == 0)
+      continue;
+    disk_manager->ReadPage(page_id, data);
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(data, expected));
+  }
+  EXPECT_EQ(true, bpm->UnpinPage(4, false));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, ReadOnlyMappedTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  for (int i = 0; i < 10; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db", PAGE_SIZE, false, true);
+  EXPECT_EQ(true, disk_manager->IsReadOnly());
+  bpm = new BufferPoolManager(4, disk_manager);
+  EXPECT_EQ(nullptr, bpm->NewPage(temp_page_id));
+  char expected[PAGE_SIZE];
+  // twice around a pool smaller than the file, evictions copy nothing
+  for (int round = 0; round < 2; ++round) {
+    for (page_id_t page_id = 0; page_id < 10; ++page_id) {
+      auto page = bpm->FetchPage(page_id);
+      ASSERT_NE(nullptr, page);
+      // the page is the mapping itself
+      EXPECT_EQ(disk_manager->GetMappedPage(page_id), page->GetData());
+      snprintf(expected, PAGE_SIZE, "page %d", page_id);
+      EXPECT_EQ(0, strcmp(page->GetData(), expected));
+      // nothing is written back
+      EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+    }
+  }
+  EXPECT_EQ(0, bpm->GetStats().dirty_write_backs);
+  EXPECT_EQ(0u, bpm->FlushAllPages());
+  // a page past the mapping falls back to a frame of the pool
+  EXPECT_EQ(nullptr, disk_manager->GetMappedPage(10));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
 } // namespace cmudb
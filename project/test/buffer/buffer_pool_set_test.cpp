@@ -0,0 +1,65 @@
+/**
+ * buffer_pool_set_test.cpp
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "buffer/buffer_pool_set.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(BufferPoolSetTest, SampleTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolSet pools(disk_manager);
+  BufferPoolManager *heap = pools.AddPool("heap", 4);
+  BufferPoolManager *index = pools.AddPool("index", 4, ReplacerType::CLOCK);
+  ASSERT_NE(nullptr, heap);
+  ASSERT_NE(nullptr, index);
+  EXPECT_EQ(nullptr, pools.AddPool("heap", 8));
+  EXPECT_EQ(index, pools.GetPool("index"));
+  EXPECT_EQ(nullptr, pools.GetPool("other"));
+  EXPECT_EQ(2u, pools.GetPoolCount());
+  EXPECT_EQ("heap", pools.GetPoolName(0));
+
+  // the header page is always cached by the first pool
+  auto header = heap->NewPage(temp_page_id);
+  ASSERT_NE(nullptr, header);
+  EXPECT_EQ(HEADER_PAGE_ID, temp_page_id);
+  EXPECT_EQ(header, index->FetchPage(HEADER_PAGE_ID));
+  EXPECT_EQ(true, index->UnpinPage(HEADER_PAGE_ID, true));
+  EXPECT_EQ(true, heap->UnpinPage(HEADER_PAGE_ID, false));
+
+  std::vector<page_id_t> index_pages;
+  for (int i = 0; i < 4; ++i) {
+    auto page = index->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "index %d", temp_page_id);
+    EXPECT_EQ(true, index->UnpinPage(temp_page_id, true));
+    index_pages.push_back(temp_page_id);
+  }
+
+  // heap pages churn through their own frames only
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_NE(nullptr, heap->NewPage(temp_page_id));
+    EXPECT_EQ(true, heap->UnpinPage(temp_page_id, true));
+  }
+  size_t misses = index->GetMissCount();
+  char expected[PAGE_SIZE];
+  for (auto page_id : index_pages) {
+    auto page = index->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "index %d", page_id);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, index->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(misses, index->GetMissCount());
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
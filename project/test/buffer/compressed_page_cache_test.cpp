@@ -0,0 +1,91 @@
+/**
+ * compressed_page_cache_test.cpp
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "buffer/compressed_page_cache.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(CompressedPageCacheTest, RoundTripTest) {
+  std::mt19937 rng(15445);
+  std::vector<char> page(PAGE_SIZE);
+  std::vector<char> compressed;
+  std::vector<char> restored(PAGE_SIZE);
+
+  // empty page, text with repeats, runs of random bytes, all random
+  for (int round = 0; round < 4; ++round) {
+    std::fill(page.begin(), page.end(), 0);
+    if (round == 1) {
+      for (int i = 0, pos = 0; pos < PAGE_SIZE - 32; ++i) {
+        pos += snprintf(&page[pos], 32, "tuple %d value %d|", i, i % 7);
+      }
+    } else if (round >= 2) {
+      size_t limit = round == 2 ? PAGE_SIZE / 2 : PAGE_SIZE;
+      for (size_t i = 0; i < limit; ++i) {
+        page[i] = static_cast<char>(rng());
+      }
+    }
+    compressed.clear();
+    bool shrunk =
+        CompressedPageCache::Compress(page.data(), PAGE_SIZE, compressed);
+    if (round == 3) {
+      EXPECT_EQ(false, shrunk);
+      EXPECT_EQ(true, compressed.empty());
+      continue;
+    }
+    ASSERT_EQ(true, shrunk);
+    EXPECT_GT(static_cast<size_t>(PAGE_SIZE), compressed.size());
+    EXPECT_EQ(true, CompressedPageCache::Decompress(compressed.data(),
+                                                    compressed.size(),
+                                                    restored.data(), PAGE_SIZE));
+    EXPECT_EQ(0, memcmp(page.data(), restored.data(), PAGE_SIZE));
+  }
+
+  // truncated input is detected
+  EXPECT_EQ(false, CompressedPageCache::Decompress(
+                       compressed.data(), compressed.size() / 2,
+                       restored.data(), PAGE_SIZE));
+}
+
+TEST(CompressedPageCacheTest, CapacityTest) {
+  std::vector<char> page(PAGE_SIZE);
+  std::vector<char> restored(PAGE_SIZE);
+  std::vector<char> compressed;
+  snprintf(page.data(), PAGE_SIZE, "page %d", 0);
+  CompressedPageCache::Compress(page.data(), PAGE_SIZE, compressed);
+
+  // room for three compressed pages
+  CompressedPageCache cache(compressed.size() * 3);
+  for (int i = 0; i < 5; ++i) {
+    snprintf(page.data(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, cache.Put(i, page.data(), PAGE_SIZE));
+  }
+  auto stats = cache.GetStats();
+  EXPECT_EQ(5u, stats.insertions);
+  EXPECT_EQ(2u, stats.evictions);
+  EXPECT_EQ(3u, stats.entries);
+  EXPECT_GE(stats.capacity_bytes, stats.memory_bytes);
+
+  // oldest entries went first, a hit takes the page out of the tier
+  EXPECT_EQ(false, cache.Get(0, restored.data(), PAGE_SIZE));
+  EXPECT_EQ(false, cache.Get(1, restored.data(), PAGE_SIZE));
+  EXPECT_EQ(true, cache.Get(4, restored.data(), PAGE_SIZE));
+  EXPECT_EQ(0, strcmp("page 4", restored.data()));
+  EXPECT_EQ(false, cache.Get(4, restored.data(), PAGE_SIZE));
+  cache.Erase(3);
+  EXPECT_EQ(false, cache.Get(3, restored.data(), PAGE_SIZE));
+
+  stats = cache.GetStats();
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(4u, stats.misses);
+  EXPECT_EQ(1u, stats.entries);
+  EXPECT_EQ(0.2, stats.HitRatio());
+}
+
+} // namespace cmudb
@@ -0,0 +1,72 @@
+/**
+ * lru_k_replacer_test.cpp
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer<int> lru_k_replacer(2);
+
+  // 1 and 2 are accessed twice, 3, 4 and 5 only once
+  lru_k_replacer.Insert(1);
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(3);
+  lru_k_replacer.Insert(4);
+  lru_k_replacer.Insert(1);
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(5);
+  EXPECT_EQ(5, lru_k_replacer.Size());
+
+  // values with infinite distance go first, oldest access first
+  int value;
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  std::vector<int> victims;
+  lru_k_replacer.PeekVictims(3, victims);
+  EXPECT_EQ(std::vector<int>({4, 5, 1}), victims);
+
+  // pinned values keep their history but cannot be evicted
+  EXPECT_EQ(true, lru_k_replacer.Erase(4));
+  EXPECT_EQ(false, lru_k_replacer.Erase(4));
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+  lru_k_replacer.Insert(4);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+  EXPECT_EQ(false, lru_k_replacer.Victim(value));
+}
+
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  LRUKReplacer<int> lru_k_replacer(2);
+
+  // hot working set touched repeatedly
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 4; ++i) {
+      lru_k_replacer.Insert(i);
+    }
+  }
+  // one sequential scan over cold values
+  for (int i = 100; i < 110; ++i) {
+    lru_k_replacer.Insert(i);
+  }
+
+  // the scan is evicted before any hot value
+  int value;
+  for (int i = 100; i < 110; ++i) {
+    ASSERT_EQ(true, lru_k_replacer.Victim(value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_EQ(4, lru_k_replacer.Size());
+}
+
+} // namespace cmudb
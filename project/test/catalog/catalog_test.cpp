@@ -0,0 +1,116 @@
+/**
+ * catalog_test.cpp
+ */
+
+#include <cstdio>
+#include <string>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/catalog.h"
+#include "catalog/root_catalog.h"
+#include "page/header_page.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+static BufferPoolManager *NewDatabase(DiskManager *disk_manager) {
+  BufferPoolManager *bpm = new BufferPoolManager(16, disk_manager);
+  page_id_t header_page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(header_page_id));
+  header_page->Init();
+  bpm->UnpinPage(header_page_id, true);
+  return bpm;
+}
+
+// far more names than the header page of small pages holds, all back after
+// a restart, none of them in the header page
+TEST(CatalogTest, ManyNamesTest) {
+  remove("test.db");
+  const int num_names = 500;
+  DiskManager *disk_manager = new DiskManager("test.db", MIN_PAGE_SIZE);
+  BufferPoolManager *bpm = NewDatabase(disk_manager);
+  Catalog catalog(bpm);
+  catalog.Load();
+  EXPECT_EQ(0u, catalog.GetSize());
+  for (int i = 0; i < num_names; i++) {
+    catalog.SetRoot("table_" + std::to_string(i), i + 1);
+  }
+  // set again, not added
+  catalog.SetRoot("table_7", 1000);
+  EXPECT_EQ(static_cast<size_t>(num_names), catalog.GetSize());
+  catalog.Flush();
+  delete bpm;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db", MIN_PAGE_SIZE);
+  bpm = new BufferPoolManager(16, disk_manager);
+  auto header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  EXPECT_EQ(1, header_page->GetRecordCount());
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  Catalog reloaded(bpm);
+  EXPECT_EQ(static_cast<size_t>(num_names), reloaded.GetSize());
+  for (int i = 0; i < num_names; i++) {
+    EXPECT_EQ(i == 7 ? 1000 : i + 1,
+              reloaded.GetRoot("table_" + std::to_string(i)));
+  }
+  EXPECT_EQ(INVALID_PAGE_ID, reloaded.GetRoot("table_500"));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+// names recorded in the header page, as by older files, are still found
+TEST(CatalogTest, HeaderPageTest) {
+  remove("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db", MIN_PAGE_SIZE);
+  BufferPoolManager *bpm = NewDatabase(disk_manager);
+  auto header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  EXPECT_TRUE(header_page->InsertRecord("old_table", 7));
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+
+  Catalog catalog(bpm);
+  EXPECT_EQ(7, catalog.GetRoot("old_table"));
+  EXPECT_EQ(0u, catalog.GetSize());
+  // the catalog has it from now on
+  catalog.SetRoot("old_table", 9);
+  EXPECT_EQ(9, catalog.GetRoot("old_table"));
+  EXPECT_THROW(catalog.SetRoot(std::string(200, 'x'), 1), Exception);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+// index roots swapped in a root catalog are flushed into the catalog
+TEST(CatalogTest, RootCatalogTest) {
+  remove("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db", MIN_PAGE_SIZE);
+  BufferPoolManager *bpm = NewDatabase(disk_manager);
+  Catalog catalog(bpm);
+  RootCatalog root_catalog(bpm, nullptr, &catalog);
+  for (int i = 0; i < 100; i++) {
+    std::string name = "index_" + std::to_string(i);
+    EXPECT_EQ(INVALID_PAGE_ID, root_catalog.GetRoot(name));
+    root_catalog.SwapRoot(name, 10 + i);
+  }
+  EXPECT_EQ(0u, catalog.GetSize());
+  EXPECT_TRUE(root_catalog.Flush());
+  EXPECT_EQ(100u, catalog.GetSize());
+  delete bpm;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db", MIN_PAGE_SIZE);
+  bpm = new BufferPoolManager(16, disk_manager);
+  Catalog reloaded(bpm);
+  RootCatalog reloaded_roots(bpm, nullptr, &reloaded);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(10 + i, reloaded_roots.GetRoot("index_" + std::to_string(i)));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
@@ -0,0 +1,55 @@
+/**
+ * arena_test.cpp
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#include "common/arena.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ArenaTest, BasicTest) {
+  Arena arena(256);
+  EXPECT_EQ(0u, arena.GetBlockCount());
+  char *first = arena.Allocate(10);
+  memset(first, 'a', 10);
+  char *second = arena.Copy("hello", 6);
+  EXPECT_EQ(1u, arena.GetBlockCount());
+  EXPECT_EQ(0, memcmp(first, "aaaaaaaaaa", 10));
+  EXPECT_STREQ("hello", second);
+  // aligned for any scalar type
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(second) %
+                    alignof(std::max_align_t));
+
+  // a second block once the first is full, a large request on its own
+  for (int i = 0; i < 20; i++) {
+    arena.Allocate(16);
+  }
+  EXPECT_EQ(2u, arena.GetBlockCount());
+  arena.Allocate(1000);
+  EXPECT_EQ(3u, arena.GetBlockCount());
+}
+
+TEST(ArenaTest, ResetTest) {
+  Arena arena(256);
+  char *first = arena.Allocate(64);
+  for (int i = 0; i < 10; i++) {
+    arena.Allocate(64);
+  }
+  arena.Allocate(1000);
+  size_t blocks = arena.GetBlockCount();
+  arena.Reset();
+  // the same memory again, without allocating
+  EXPECT_EQ(first, arena.Allocate(64));
+  for (int round = 0; round < 100; round++) {
+    arena.Reset();
+    for (int i = 0; i < 11; i++) {
+      arena.Allocate(64);
+    }
+    EXPECT_EQ(blocks - 1, arena.GetBlockCount());
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,147 @@
+/**
+ * memory_tracker_test.cpp
+ */
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/memory_tracker.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// amounts used below are over a quarter credit, they skip the credits
+static const size_t KB = 1024;
+
+TEST(MemoryTrackerTest, BudgetTest) {
+  MemoryTracker &tracker = MemoryTracker::Instance();
+  size_t usage = tracker.GetStats().usage;
+  tracker.SetBudget(usage + 1024 * KB);
+  EXPECT_TRUE(tracker.Reserve(MemoryConsumer::LOCK_TABLE, 512 * KB));
+  EXPECT_FALSE(tracker.Reserve(MemoryConsumer::LOCK_TABLE, 600 * KB));
+  MemoryStats stats = tracker.GetStats();
+  EXPECT_EQ(1u, stats.refusals);
+  EXPECT_EQ(512 * KB, stats.GetUsage(MemoryConsumer::LOCK_TABLE));
+  EXPECT_EQ(usage + 512 * KB, stats.usage);
+  EXPECT_EQ(512 * KB, Metrics::Instance().GetGauge("memory.lock_table")
+                          ->Value());
+
+  // what cannot fail goes over
+  tracker.Charge(MemoryConsumer::TUPLE, 600 * KB);
+  stats = tracker.GetStats();
+  EXPECT_EQ(usage + 1112 * KB, stats.usage);
+  EXPECT_GT(stats.usage, stats.budget);
+  // elastic consumers get nothing while over it
+  EXPECT_FALSE(tracker.TryGrow(MemoryConsumer::COMPRESSED_CACHE, 100 * KB));
+
+  tracker.Release(MemoryConsumer::TUPLE, 600 * KB);
+  tracker.Release(MemoryConsumer::LOCK_TABLE, 512 * KB);
+  stats = tracker.GetStats();
+  EXPECT_EQ(usage, stats.usage);
+  EXPECT_EQ(0u, stats.GetUsage(MemoryConsumer::LOCK_TABLE));
+  tracker.SetBudget(0);
+  EXPECT_TRUE(tracker.Reserve(MemoryConsumer::LOCK_TABLE, 4096 * KB));
+  tracker.Release(MemoryConsumer::LOCK_TABLE, 4096 * KB);
+}
+
+TEST(MemoryTrackerTest, ShrinkTest) {
+  MemoryTracker &tracker = MemoryTracker::Instance();
+  tracker.SetBudget(0);
+  size_t usage = tracker.GetStats().usage;
+  std::vector<std::string> calls;
+  size_t cached = 0;
+  int grown = 0;
+  // registered out of order, shrunk by priority
+  int escalation = tracker.RegisterElastic(
+      ElasticPriority::LOCK_ESCALATION,
+      [&](size_t) -> size_t {
+        calls.push_back("escalation");
+        return 0;
+      },
+      [&] { grown++; });
+  int cache = tracker.RegisterElastic(
+      ElasticPriority::COMPRESSED_CACHE, [&](size_t bytes) -> size_t {
+        calls.push_back("cache");
+        size_t freed = std::min(bytes, cached);
+        cached -= freed;
+        tracker.Release(MemoryConsumer::COMPRESSED_CACHE, freed);
+        return freed;
+      });
+  int prefetch = tracker.RegisterElastic(
+      ElasticPriority::PREFETCH,
+      [&](size_t) -> size_t {
+        calls.push_back("prefetch");
+        return 0;
+      },
+      [&] { grown++; });
+
+  uint64_t shrinks = tracker.GetStats().shrinks;
+  ASSERT_TRUE(tracker.TryGrow(MemoryConsumer::COMPRESSED_CACHE, 256 * KB));
+  cached = 256 * KB;
+  tracker.SetBudget(usage + 1024 * KB);
+
+  // the cache gives up enough, the others are left alone
+  EXPECT_TRUE(tracker.Reserve(MemoryConsumer::BUFFER_POOL, 900 * KB));
+  EXPECT_EQ(std::vector<std::string>({"cache"}), calls);
+  EXPECT_EQ(124 * KB, cached);
+  EXPECT_EQ(shrinks + 1, tracker.GetStats().shrinks);
+
+  // all of them shrink before a refusal
+  calls.clear();
+  EXPECT_FALSE(tracker.Reserve(MemoryConsumer::BUFFER_POOL, 200 * KB));
+  EXPECT_EQ(std::vector<std::string>({"cache", "prefetch", "escalation"}),
+            calls);
+  EXPECT_EQ(0u, cached);
+  EXPECT_EQ(0, grown);
+
+  // under half the budget they grow back
+  tracker.Release(MemoryConsumer::BUFFER_POOL, 900 * KB);
+  EXPECT_TRUE(tracker.Reserve(MemoryConsumer::BUFFER_POOL, 100 * KB));
+  EXPECT_EQ(2, grown);
+  tracker.Release(MemoryConsumer::BUFFER_POOL, 100 * KB);
+
+  tracker.UnregisterElastic(cache);
+  tracker.UnregisterElastic(prefetch);
+  tracker.UnregisterElastic(escalation);
+  tracker.SetBudget(0);
+  EXPECT_EQ(usage, tracker.GetStats().usage);
+}
+
+TEST(MemoryTrackerTest, CreditTest) {
+  MemoryTracker &tracker = MemoryTracker::Instance();
+  tracker.SetBudget(0);
+  size_t usage = tracker.GetStats().usage;
+  std::thread thread([&] {
+    // small amounts come out of one credit
+    for (int i = 0; i < 100; i++) {
+      tracker.Charge(MemoryConsumer::TUPLE, 100);
+    }
+    // nor do they touch the gauge until the thread reads it
+    EXPECT_EQ(0, Metrics::Instance().GetGauge("memory.tuple")->Value());
+    MemoryStats stats = tracker.GetStats();
+    EXPECT_EQ(10000u, stats.GetUsage(MemoryConsumer::TUPLE));
+    EXPECT_EQ(usage + MEMORY_CREDIT_SIZE, stats.usage);
+    for (int i = 0; i < 100; i++) {
+      tracker.Release(MemoryConsumer::TUPLE, 100);
+    }
+    EXPECT_EQ(0u, tracker.GetStats().GetUsage(MemoryConsumer::TUPLE));
+  });
+  thread.join();
+  // the credit went back as the thread exited
+  EXPECT_EQ(usage, tracker.GetStats().usage);
+
+  // a credit does not fit, only what is asked for
+  tracker.SetBudget(usage + MEMORY_CREDIT_SIZE / 2);
+  std::thread tight([&] {
+    EXPECT_TRUE(tracker.Reserve(MemoryConsumer::LOCK_TABLE, 64));
+    EXPECT_EQ(usage + 64, tracker.GetStats().usage);
+    tracker.Release(MemoryConsumer::LOCK_TABLE, 64);
+  });
+  tight.join();
+  tracker.SetBudget(0);
+  EXPECT_EQ(usage, tracker.GetStats().usage);
+}
+
+} // namespace cmudb
@@ -0,0 +1,106 @@
+/**
+ * metrics_test.cpp
+ */
+
+#include <thread>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/metrics.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(MetricsTest, CounterTest) {
+  Counter counter;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&counter] {
+      for (int j = 0; j < 10000; j++)
+        counter.Add();
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  EXPECT_EQ(80000u, counter.Value());
+  counter.Add(5);
+  EXPECT_EQ(80005u, counter.Value());
+  counter.Reset();
+  EXPECT_EQ(0u, counter.Value());
+
+  Gauge gauge;
+  gauge.Add(3);
+  gauge.Add(-5);
+  EXPECT_EQ(-2, gauge.Value());
+  gauge.Set(7);
+  EXPECT_EQ(7, gauge.Value());
+}
+
+TEST(MetricsTest, HistogramTest) {
+  // the buckets cover every value, in order, and are narrow
+  for (int bucket = 0; bucket < HdrHistogram::BUCKETS; bucket++) {
+    uint64_t lowest = HdrHistogram::LowestOf(bucket);
+    uint64_t highest = HdrHistogram::HighestOf(bucket);
+    EXPECT_EQ(bucket, HdrHistogram::BucketOf(lowest));
+    EXPECT_EQ(bucket, HdrHistogram::BucketOf(highest));
+    if (bucket + 1 < HdrHistogram::BUCKETS) {
+      EXPECT_EQ(highest + 1, HdrHistogram::LowestOf(bucket + 1));
+    }
+    EXPECT_LE(highest - lowest, lowest / HdrHistogram::SUB_BUCKETS);
+  }
+  EXPECT_EQ(HdrHistogram::BUCKETS - 1, HdrHistogram::BucketOf(UINT64_MAX));
+
+  HdrHistogram histogram;
+  for (uint64_t value = 1; value <= 10000; value++)
+    histogram.Record(value);
+  HdrHistogramSnapshot snapshot = histogram.Snapshot();
+  EXPECT_EQ(10000u, snapshot.count);
+  EXPECT_EQ(50005000u, snapshot.sum);
+  EXPECT_EQ(10000u, snapshot.max);
+  // within a sixteenth, never below
+  for (double q : {0.5, 0.9, 0.99, 0.999}) {
+    uint64_t exact = static_cast<uint64_t>(q * 10000);
+    EXPECT_GE(snapshot.Percentile(q), exact);
+    EXPECT_LE(snapshot.Percentile(q), exact + exact / 16);
+  }
+  EXPECT_EQ(10000u, snapshot.Percentile(1));
+
+  HdrHistogramSnapshot merged = snapshot;
+  merged += snapshot;
+  EXPECT_EQ(20000u, merged.count);
+  EXPECT_EQ(snapshot.Percentile(0.5), merged.Percentile(0.5));
+  histogram.Reset();
+  EXPECT_EQ(0u, histogram.Snapshot().count);
+  EXPECT_EQ(0u, histogram.Snapshot().Percentile(0.5));
+}
+
+TEST(MetricsTest, RegistryTest) {
+  Metrics &metrics = Metrics::Instance();
+  Counter *counter = metrics.GetCounter("test.counter");
+  EXPECT_EQ(counter, metrics.GetCounter("test.counter"));
+  EXPECT_THROW(metrics.GetGauge("test.counter"), Exception);
+  counter->Add(3);
+  metrics.GetGauge("test.gauge")->Set(-4);
+  metrics.GetHistogram("test.histogram")->Record(100);
+  metrics.GetCounter("other.counter")->Add();
+
+  auto snapshot = metrics.Snapshot("test.");
+  ASSERT_EQ(3u, snapshot.size());
+  EXPECT_EQ("test.counter", snapshot[0].name);
+  EXPECT_EQ(MetricKind::COUNTER, snapshot[0].kind);
+  EXPECT_EQ(3, snapshot[0].value);
+  EXPECT_EQ("test.gauge", snapshot[1].name);
+  EXPECT_EQ(-4, snapshot[1].value);
+  EXPECT_EQ("test.histogram", snapshot[2].name);
+  EXPECT_EQ(1, snapshot[2].value);
+  EXPECT_EQ(100u, snapshot[2].histogram.max);
+
+  // counts go, levels stay
+  metrics.Reset();
+  snapshot = metrics.Snapshot("test.");
+  EXPECT_EQ(0, snapshot[0].value);
+  EXPECT_EQ(-4, snapshot[1].value);
+  EXPECT_EQ(0, snapshot[2].value);
+}
+
+} // namespace cmudb
@@ -0,0 +1,46 @@
+/**
+ * numa_test.cpp
+ */
+
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "common/numa.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(NumaTest, ParseListTest) {
+  EXPECT_EQ(std::vector<int>({0}), Numa::ParseList("0"));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}),
+            Numa::ParseList("0-3,8,10-11"));
+  EXPECT_EQ(std::vector<int>({0, 1}), Numa::ParseList("0-1\n"));
+  EXPECT_TRUE(Numa::ParseList("").empty());
+}
+
+TEST(NumaTest, PlacementTest) {
+  int nodes = Numa::NodeCount();
+  EXPECT_GE(nodes, 1);
+  int node = Numa::CurrentNode();
+  EXPECT_GE(node, 0);
+  EXPECT_LT(node, nodes);
+
+  // out of range nodes are refused, a single node places nothing
+  std::vector<char> data(1 << 20);
+  EXPECT_FALSE(Numa::BindMemory(data.data(), data.size(), -1));
+  EXPECT_FALSE(Numa::BindMemory(data.data(), data.size(), nodes));
+  EXPECT_FALSE(Numa::PinThread(nodes));
+  if (nodes == 1) {
+    EXPECT_FALSE(Numa::BindMemory(data.data(), data.size(), 0));
+    return;
+  }
+  EXPECT_TRUE(Numa::BindMemory(data.data(), data.size(), nodes - 1));
+  std::thread thread([nodes] {
+    EXPECT_TRUE(Numa::PinThread(nodes - 1));
+    EXPECT_EQ(nodes - 1, Numa::CurrentNode());
+  });
+  thread.join();
+}
+
+} // namespace cmudb
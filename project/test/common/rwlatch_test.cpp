@@ -0,0 +1,134 @@
+/**
+ * rwlatch_test.cpp
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "common/rwlatch.h"
+#include "common/rwmutex.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(RWLatchTest, BasicTest) {
+  const int num_threads = 8;
+  const int num_iters = 10000;
+  RWLatch latch;
+  int count = 0;
+  std::atomic<int> readers{0};
+  std::atomic<bool> overlap{false};
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&, tid] {
+      for (int i = 0; i < num_iters; i++) {
+        if ((i + tid) % 4 == 0) {
+          latch.WLock();
+          if (readers.load() != 0) {
+            overlap = true;
+          }
+          count++;
+          latch.WUnlock();
+        } else {
+          latch.RLock();
+          readers++;
+          volatile int read = count;
+          (void)read;
+          readers--;
+          latch.RUnlock();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(overlap);
+  EXPECT_EQ(num_threads * num_iters / 4, count);
+}
+
+// a waiting writer keeps new readers out, and is let in by the last reader
+TEST(RWLatchTest, WriterTest) {
+  RWLatch latch;
+  std::atomic<int> step{0};
+  latch.RLock();
+  std::thread writer([&] {
+    latch.WLock();
+    EXPECT_EQ(1, step.load());
+    step = 2;
+    latch.WUnlock();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  std::thread reader([&] {
+    latch.RLock();
+    EXPECT_EQ(2, step.load());
+    latch.RUnlock();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  step = 1;
+  latch.RUnlock();
+  writer.join();
+  reader.join();
+}
+
+// a try fails while a writer holds or waits for the latch, and readers do not
+// keep it from succeeding
+TEST(RWLatchTest, TryTest) {
+  RWLatch latch;
+  EXPECT_TRUE(latch.TryRLock());
+  EXPECT_TRUE(latch.TryRLock());
+  std::atomic<bool> locked{false};
+  std::thread writer([&] {
+    latch.WLock();
+    locked = true;
+    latch.WUnlock();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(latch.TryRLock());
+  latch.RUnlock();
+  latch.RUnlock();
+  writer.join();
+  EXPECT_TRUE(locked);
+  latch.WLock();
+  EXPECT_FALSE(latch.TryRLock());
+  latch.WUnlock();
+  EXPECT_TRUE(latch.TryRLock());
+  latch.RUnlock();
+}
+
+// read latch operations per millisecond of num_threads threads
+template <typename Latch> double ReadThroughput(int num_threads) {
+  const int num_iters = 200000;
+  Latch latch;
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < num_iters; i++) {
+        latch.RLock();
+        latch.RUnlock();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  return num_threads * num_iters * 1000.0 / (elapsed + 1);
+}
+
+// not a check, reports how the readers of both scale
+TEST(RWLatchTest, BenchmarkTest) {
+  for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+    printf("%d readers: RWMutex %.0f ops/ms, RWLatch %.0f ops/ms\n",
+           num_threads, ReadThroughput<RWMutex>(num_threads),
+           ReadThroughput<RWLatch>(num_threads));
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,48 @@
+/**
+ * small_set_test.cpp
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "common/small_set.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+static std::vector<int> Sorted(const SmallSet<int, 4> &set) {
+  std::vector<int> values(set.begin(), set.end());
+  std::sort(values.begin(), values.end());
+  return values;
+}
+
+TEST(SmallSetTest, BasicTest) {
+  SmallSet<int, 4> set;
+  EXPECT_TRUE(set.empty());
+  EXPECT_TRUE(set.insert(1).second);
+  EXPECT_TRUE(set.insert(2).second);
+  EXPECT_FALSE(set.insert(1).second);
+  EXPECT_EQ(2u, set.size());
+  EXPECT_EQ(1u, set.count(2));
+  EXPECT_TRUE(set.find(3) == set.end());
+  EXPECT_EQ(1u, set.erase(1));
+  EXPECT_EQ(0u, set.erase(1));
+  EXPECT_EQ(std::vector<int>({2}), Sorted(set));
+
+  // past the inline elements, and back after clear
+  for (int i = 0; i < 10; i++) {
+    set.insert(i);
+  }
+  EXPECT_EQ(10u, set.size());
+  EXPECT_EQ(1u, set.count(7));
+  EXPECT_EQ(7, *set.find(7));
+  EXPECT_EQ(1u, set.erase(7));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4, 5, 6, 8, 9}), Sorted(set));
+  set.clear();
+  EXPECT_TRUE(set.empty());
+  EXPECT_TRUE(set.begin() == set.end());
+  set.insert(5);
+  EXPECT_EQ(std::vector<int>({5}), Sorted(set));
+}
+
+} // namespace cmudb
@@ -0,0 +1,167 @@
+/**
+ * task_scheduler_test.cpp
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/task_scheduler.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(TaskSchedulerTest, PriorityTest) {
+  TaskScheduler scheduler(1);
+  std::atomic<bool> blocked{true};
+  std::mutex latch;
+  std::vector<std::string> order;
+  // the only worker is busy while the others are queued
+  scheduler.Submit([&] {
+    while (blocked) {
+      std::this_thread::yield();
+    }
+  }, TaskPriority::HIGH);
+  auto record = [&](const std::string &name) {
+    return [&, name] {
+      std::lock_guard<std::mutex> guard(latch);
+      order.push_back(name);
+    };
+  };
+  scheduler.Submit(record("low"), TaskPriority::LOW);
+  scheduler.Submit(record("normal"));
+  scheduler.Submit(record("high"), TaskPriority::HIGH);
+  blocked = false;
+  scheduler.WaitIdle();
+  EXPECT_EQ(std::vector<std::string>({"high", "normal", "low"}), order);
+  EXPECT_EQ(4u, scheduler.GetStats().tasks);
+}
+
+TEST(TaskSchedulerTest, StealTest) {
+  TaskScheduler scheduler(4);
+  std::atomic<int> done{0};
+  // children go to the deque of the parent, which waits for them: the other
+  // workers steal every one
+  scheduler.Submit([&] {
+    for (int i = 0; i < 8; i++) {
+      scheduler.Submit([&] { done++; });
+    }
+    while (done < 8) {
+      std::this_thread::yield();
+    }
+  });
+  scheduler.WaitIdle();
+  EXPECT_EQ(8, done);
+  EXPECT_EQ(8u, scheduler.GetStats().steals);
+}
+
+TEST(TaskSchedulerTest, PeriodicTest) {
+  TaskScheduler scheduler(2);
+  std::atomic<int> rounds{0};
+  std::atomic<int> running{0};
+  std::atomic<bool> overlapped{false};
+  task_id_t task = scheduler.SchedulePeriodic(
+      [&] {
+        if (running++ != 0) {
+          overlapped = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        rounds++;
+        running--;
+      },
+      std::chrono::milliseconds(5));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  scheduler.Cancel(task);
+  int after_cancel = rounds;
+  EXPECT_GE(after_cancel, 3);
+  EXPECT_FALSE(overlapped);
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  EXPECT_EQ(after_cancel, rounds);
+  // unknown or cancelled already
+  scheduler.Cancel(task);
+  scheduler.Cancel(-1);
+}
+
+TEST(TaskSchedulerTest, ThrottleTest) {
+  TaskScheduler scheduler(4);
+  scheduler.SetThrottle(1);
+  std::atomic<int> running{0};
+  std::atomic<int> most{0};
+  std::atomic<bool> high_ran{false};
+  // the first one holds the single slot until a high priority task ran
+  scheduler.Submit([&] {
+    running++;
+    for (int i = 0; i < 1000 && !high_ran; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    running--;
+  });
+  while (running == 0) {
+    std::this_thread::yield();
+  }
+  for (int i = 0; i < 6; i++) {
+    scheduler.Submit([&] {
+      int now = ++running;
+      int seen = most;
+      while (now > seen && !most.compare_exchange_weak(seen, now)) {
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      running--;
+    }, i % 2 == 0 ? TaskPriority::NORMAL : TaskPriority::LOW);
+  }
+  // high priority work is not throttled
+  scheduler.Submit([&] { high_ran = true; }, TaskPriority::HIGH);
+  scheduler.WaitIdle();
+  EXPECT_TRUE(high_ran);
+  EXPECT_EQ(1, most);
+  EXPECT_EQ(1u, scheduler.GetStats().throttle);
+}
+
+TEST(TaskSchedulerTest, LatencyProbeTest) {
+  auto interval = SCHEDULER_THROTTLE_INTERVAL;
+  SCHEDULER_THROTTLE_INTERVAL = std::chrono::milliseconds(2);
+  TaskScheduler scheduler(4);
+  std::atomic<uint64_t> latency{1000};
+  scheduler.SetLatencyProbe([&] { return latency.load(); }, 100);
+  auto wait_for = [&](size_t throttle) {
+    for (int i = 0; i < 500 && scheduler.GetStats().throttle != throttle;
+         i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return scheduler.GetStats().throttle;
+  };
+  // halved down to one worker, then back one by one
+  EXPECT_EQ(1u, wait_for(1));
+  EXPECT_GE(scheduler.GetStats().throttles, 2u);
+  latency = 10;
+  EXPECT_EQ(4u, wait_for(4));
+
+  // a probe keeping state between calls sees every call
+  scheduler.SetLatencyProbe(
+      [calls = 0]() mutable -> uint64_t { return ++calls > 3 ? 1000 : 0; },
+      100);
+  EXPECT_EQ(1u, wait_for(1));
+  scheduler.SetLatencyProbe(nullptr, 0);
+  SCHEDULER_THROTTLE_INTERVAL = interval;
+}
+
+TEST(TaskSchedulerTest, StopTest) {
+  std::atomic<int> done{0};
+  TaskScheduler scheduler(2);
+  scheduler.SchedulePeriodic([&] { done += 100; },
+                             std::chrono::milliseconds(60000));
+  for (int i = 0; i < 16; i++) {
+    scheduler.Submit([&] { done++; }, TaskPriority::LOW);
+  }
+  // queued tasks run, periodic ones not due do not, later ones are dropped
+  scheduler.Stop();
+  EXPECT_EQ(16, done);
+  scheduler.Submit([&] { done++; });
+  EXPECT_EQ(16, done);
+}
+
+} // namespace cmudb
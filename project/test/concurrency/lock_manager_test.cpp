@@ -2,7 +2,9 @@
  * lock_manager_test.cpp
  */
 
+#include <chrono>
 #include <thread>
+#include <vector>
 
 #include "concurrency/transaction_manager.h"
 #include "gtest/gtest.h"
@@ -40,4 +42,370 @@ TEST(LockManagerTest, BasicTest) {
   t0.join();
   t1.join();
 }
+
+// an older transaction waits for a younger one, a younger one dies
+TEST(LockManagerTest, WaitDieTest) {
+  LockManager lock_mgr{true};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid{0, 0};
+  Transaction old_txn(0);
+  Transaction young_txn(1);
+
+  EXPECT_TRUE(lock_mgr.LockExclusive(&young_txn, rid));
+  std::thread waiter([&] {
+    EXPECT_TRUE(lock_mgr.LockShared(&old_txn, rid));
+    EXPECT_EQ(1, old_txn.GetSharedLockSet()->count(rid));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // strict 2PL keeps the lock until commit
+  EXPECT_FALSE(lock_mgr.Unlock(&young_txn, rid));
+  txn_mgr.Commit(&young_txn);
+  waiter.join();
+
+  Transaction dying_txn(2);
+  EXPECT_FALSE(lock_mgr.LockExclusive(&dying_txn, rid));
+  EXPECT_EQ(TransactionState::ABORTED, dying_txn.GetState());
+  EXPECT_EQ(1, lock_mgr.GetAbortStats().wait_die);
+  EXPECT_TRUE(dying_txn.GetExclusiveLockSet()->empty());
+  txn_mgr.Commit(&old_txn);
+
+  // the rid is free again
+  Transaction txn(3);
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn, rid));
+  txn_mgr.Commit(&txn);
+}
+
+TEST(LockManagerTest, UpgradeTest) {
+  LockManager lock_mgr{false};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid{0, 0};
+  Transaction txn0(0);
+  Transaction txn1(1);
+  Transaction txn2(2);
+
+  EXPECT_TRUE(lock_mgr.LockShared(&txn0, rid));
+  EXPECT_TRUE(lock_mgr.LockShared(&txn1, rid));
+  std::thread upgrader([&] {
+    EXPECT_TRUE(lock_mgr.LockUpgrade(&txn0, rid));
+    EXPECT_EQ(0, txn0.GetSharedLockSet()->count(rid));
+    EXPECT_EQ(1, txn0.GetExclusiveLockSet()->count(rid));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // the waiting upgrade goes first, a second one dies
+  EXPECT_FALSE(lock_mgr.LockShared(&txn2, rid));
+  EXPECT_FALSE(lock_mgr.LockUpgrade(&txn1, rid));
+  EXPECT_EQ(TransactionState::ABORTED, txn1.GetState());
+  EXPECT_EQ(1, lock_mgr.GetAbortStats().conversion);
+  txn_mgr.Abort(&txn1);
+  upgrader.join();
+  txn_mgr.Commit(&txn0);
+}
+
+// U is shared with readers but not another U, its conversion goes before a
+// reader's
+TEST(LockManagerTest, UpdateLockTest) {
+  LockManager lock_mgr{false};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid{0, 0};
+  Transaction reader(0);
+  Transaction updater(1);
+  Transaction other(2);
+
+  EXPECT_TRUE(lock_mgr.LockShared(&reader, rid));
+  EXPECT_TRUE(lock_mgr.LockUpdate(&updater, rid));
+  EXPECT_EQ(1, updater.GetUpdateLockSet()->count(rid));
+  EXPECT_FALSE(lock_mgr.LockUpdate(&other, rid));
+  txn_mgr.Abort(&other);
+  std::thread upgrader([&] {
+    EXPECT_FALSE(lock_mgr.LockUpgrade(&reader, rid));
+    EXPECT_EQ(TransactionState::ABORTED, reader.GetState());
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // the reader's conversion waits on the update lock, which wounds it
+  EXPECT_TRUE(lock_mgr.LockUpgrade(&updater, rid));
+  EXPECT_EQ(0, updater.GetUpdateLockSet()->count(rid));
+  EXPECT_EQ(1, updater.GetExclusiveLockSet()->count(rid));
+  EXPECT_EQ(1, lock_mgr.GetAbortStats().wounded);
+  upgrader.join();
+  txn_mgr.Abort(&reader);
+  txn_mgr.Commit(&updater);
+
+  // held alone, it is converted in place
+  lock_mgr.ResetStats();
+  Transaction alone(3);
+  EXPECT_TRUE(lock_mgr.LockUpdate(&alone, rid));
+  EXPECT_TRUE(lock_mgr.LockExclusive(&alone, rid));
+  EXPECT_TRUE(alone.GetUpdateLockSet()->empty());
+  EXPECT_EQ(1, alone.GetExclusiveLockSet()->count(rid));
+  EXPECT_EQ(0u, lock_mgr.GetStats().total.waits);
+  txn_mgr.Commit(&alone);
+}
+
+// transactions locking rids of their own never wait
+TEST(LockManagerTest, ShardTest) {
+  LockManager lock_mgr{true, 4};
+  TransactionManager txn_mgr{&lock_mgr};
+  const int num_threads = 8;
+  const int num_rids = 1000;
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&, tid] {
+      Transaction txn(tid);
+      for (int i = 0; i < num_rids; i++) {
+        RID rid{tid, i};
+        EXPECT_TRUE(i % 2 == 0 ? lock_mgr.LockShared(&txn, rid)
+                               : lock_mgr.LockExclusive(&txn, rid));
+      }
+      EXPECT_EQ(num_rids / 2, txn.GetSharedLockSet()->size());
+      EXPECT_EQ(num_rids / 2, txn.GetExclusiveLockSet()->size());
+      txn_mgr.Commit(&txn);
+      EXPECT_TRUE(txn.GetSharedLockSet()->empty());
+      EXPECT_TRUE(txn.GetExclusiveLockSet()->empty());
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+// tuple locks take intention locks above them, a table lock covers them
+TEST(LockManagerTest, HierarchyTest) {
+  LockManager lock_mgr{true};
+  TransactionManager txn_mgr{&lock_mgr};
+  const page_id_t table_id = 7;
+  RID rid{8, 0};
+  Transaction reader(0);
+  Transaction scanner(1);
+  Transaction writer(2);
+
+  EXPECT_TRUE(lock_mgr.LockShared(&reader, rid, table_id));
+  auto coarse_locks = reader.GetCoarseLockSet();
+  EXPECT_EQ(LockMode::INTENTION_SHARED,
+            coarse_locks->at(LockKey::Table(table_id)));
+  EXPECT_EQ(LockMode::INTENTION_SHARED, coarse_locks->at(LockKey::Page(8)));
+  EXPECT_EQ(1, reader.GetSharedLockSet()->count(rid));
+
+  // one table lock instead of one per tuple
+  EXPECT_TRUE(lock_mgr.LockTable(&scanner, table_id, LockMode::SHARED));
+  EXPECT_TRUE(lock_mgr.LockShared(&scanner, rid, table_id));
+  EXPECT_TRUE(lock_mgr.LockShared(&scanner, RID{9, 3}, table_id));
+  EXPECT_TRUE(scanner.GetSharedLockSet()->empty());
+  EXPECT_EQ(1, scanner.GetCoarseLockSet()->size());
+
+  // IX on the table conflicts with the older scan
+  EXPECT_FALSE(lock_mgr.LockExclusive(&writer, RID{9, 0}, table_id));
+  EXPECT_EQ(TransactionState::ABORTED, writer.GetState());
+  txn_mgr.Abort(&writer);
+  txn_mgr.Commit(&scanner);
+  txn_mgr.Commit(&reader);
+  EXPECT_TRUE(reader.GetCoarseLockSet()->empty());
+  EXPECT_TRUE(reader.GetSharedLockSet()->empty());
+
+  // a scan that writes holds SIX
+  Transaction txn(3);
+  EXPECT_TRUE(lock_mgr.LockTable(&txn, table_id, LockMode::SHARED));
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn, rid, table_id));
+  EXPECT_EQ(LockMode::SHARED_INTENTION_EXCLUSIVE,
+            txn.GetCoarseLockSet()->at(LockKey::Table(table_id)));
+  EXPECT_EQ(LockMode::INTENTION_EXCLUSIVE,
+            txn.GetCoarseLockSet()->at(LockKey::Page(8)));
+  EXPECT_EQ(1, txn.GetExclusiveLockSet()->count(rid));
+  txn_mgr.Commit(&txn);
+
+  // all gone, the whole table may be locked again
+  Transaction other(4);
+  EXPECT_TRUE(lock_mgr.LockTable(&other, table_id, LockMode::EXCLUSIVE));
+  txn_mgr.Commit(&other);
+}
+
+// a lock tried under a latch is refused rather than waited for
+TEST(LockManagerTest, TryLockTest) {
+  LockManager lock_mgr{true};
+  TransactionManager txn_mgr{&lock_mgr};
+  const page_id_t table_id = 7;
+  RID rid{8, 0};
+  Transaction holder(0);
+  Transaction inserter(1);
+
+  EXPECT_TRUE(lock_mgr.LockExclusive(&holder, rid, table_id));
+  // younger, it would have died waiting
+  EXPECT_FALSE(lock_mgr.TryLockExclusive(&inserter, rid, table_id));
+  EXPECT_EQ(TransactionState::GROWING, inserter.GetState());
+  EXPECT_TRUE(lock_mgr.TryLockExclusive(&inserter, RID{8, 1}, table_id));
+  EXPECT_EQ(1, inserter.GetExclusiveLockSet()->count(RID{8, 1}));
+
+  txn_mgr.Commit(&holder);
+  EXPECT_TRUE(lock_mgr.TryLockExclusive(&inserter, rid, table_id));
+  EXPECT_EQ(1, inserter.GetExclusiveLockSet()->count(rid));
+
+  // nor are the intention locks above it waited for
+  Transaction scanner(2);
+  Transaction other(3);
+  EXPECT_TRUE(lock_mgr.LockTable(&scanner, 9, LockMode::SHARED));
+  EXPECT_FALSE(lock_mgr.TryLockExclusive(&other, RID{10, 0}, 9));
+  EXPECT_EQ(TransactionState::GROWING, other.GetState());
+  txn_mgr.Commit(&scanner);
+  txn_mgr.Commit(&other);
+  txn_mgr.Commit(&inserter);
+}
+
+// many tuple locks on a page or table become one lock there
+TEST(LockManagerTest, EscalationTest) {
+  LockManager lock_mgr{true};
+  lock_mgr.SetEscalationThresholds(4, 10);
+  TransactionManager txn_mgr{&lock_mgr};
+  const page_id_t table_id = 7;
+  Transaction reader(0);
+  Transaction txn(1);
+
+  // not while another transaction reads the page
+  EXPECT_TRUE(lock_mgr.LockShared(&reader, RID{8, 9}, table_id));
+  for (int slot = 0; slot < 5; slot++) {
+    EXPECT_TRUE(lock_mgr.LockExclusive(&txn, RID{8, slot}, table_id));
+  }
+  EXPECT_EQ(5, txn.GetExclusiveLockSet()->size());
+  EXPECT_EQ(LockMode::INTENTION_EXCLUSIVE,
+            txn.GetCoarseLockSet()->at(LockKey::Page(8)));
+  txn_mgr.Commit(&reader);
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn, RID{8, 5}, table_id));
+  EXPECT_TRUE(txn.GetExclusiveLockSet()->empty());
+  EXPECT_EQ(LockMode::EXCLUSIVE,
+            txn.GetCoarseLockSet()->at(LockKey::Page(8)));
+  // covered by the page lock now
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn, RID{8, 6}, table_id));
+  EXPECT_TRUE(txn.GetExclusiveLockSet()->empty());
+
+  // shared tuple locks on a few pages, exclusive since page 8 is
+  for (int page_id = 9; page_id < 13; page_id++) {
+    for (int slot = 0; slot < 3; slot++) {
+      EXPECT_TRUE(lock_mgr.LockShared(&txn, RID{page_id, slot}, table_id));
+    }
+  }
+  EXPECT_TRUE(txn.GetSharedLockSet()->empty());
+  EXPECT_EQ(1, txn.GetCoarseLockSet()->size());
+  EXPECT_EQ(LockMode::EXCLUSIVE,
+            txn.GetCoarseLockSet()->at(LockKey::Table(table_id)));
+
+  Transaction other(2);
+  EXPECT_FALSE(lock_mgr.LockShared(&other, RID{20, 0}, table_id));
+  txn_mgr.Abort(&other);
+  txn_mgr.Commit(&txn);
+  EXPECT_TRUE(txn.GetCoarseLockSet()->empty());
+}
+
+// with the detector, transactions wait for younger and older ones alike, and
+// one of a cycle is aborted
+TEST(LockManagerTest, DeadlockDetectionTest) {
+  LockManager lock_mgr{true};
+  TransactionManager txn_mgr{&lock_mgr};
+  lock_mgr.RunDeadlockDetector();
+  RID rid_a{0, 0};
+  RID rid_b{0, 1};
+  Transaction old_txn(0);
+  Transaction young_txn(1);
+
+  EXPECT_TRUE(lock_mgr.LockExclusive(&old_txn, rid_a));
+  EXPECT_TRUE(lock_mgr.LockExclusive(&young_txn, rid_b));
+  std::thread waiter([&] {
+    EXPECT_TRUE(lock_mgr.LockExclusive(&old_txn, rid_b));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  // wait-die would abort the younger one right away
+  EXPECT_FALSE(lock_mgr.LockExclusive(&young_txn, rid_a));
+  EXPECT_EQ(TransactionState::ABORTED, young_txn.GetState());
+  txn_mgr.Abort(&young_txn);
+  waiter.join();
+  txn_mgr.Commit(&old_txn);
+
+  LockAbortStats stats = lock_mgr.GetAbortStats();
+  EXPECT_EQ(1, stats.deadlock);
+  EXPECT_EQ(0, stats.wait_die);
+  lock_mgr.StopDeadlockDetector();
+  EXPECT_EQ(0, lock_mgr.DetectDeadlocks());
+}
+
+// the same as a periodic task of a shared scheduler
+TEST(LockManagerTest, DeadlockDetectionTaskTest) {
+  TaskScheduler scheduler(1);
+  LockManager lock_mgr{true};
+  TransactionManager txn_mgr{&lock_mgr};
+  lock_mgr.RunDeadlockDetector(&scheduler);
+  RID rid_a{0, 0};
+  RID rid_b{0, 1};
+  Transaction old_txn(0);
+  Transaction young_txn(1);
+
+  EXPECT_TRUE(lock_mgr.LockExclusive(&old_txn, rid_a));
+  EXPECT_TRUE(lock_mgr.LockExclusive(&young_txn, rid_b));
+  std::thread waiter([&] {
+    EXPECT_TRUE(lock_mgr.LockExclusive(&old_txn, rid_b));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(lock_mgr.LockExclusive(&young_txn, rid_a));
+  txn_mgr.Abort(&young_txn);
+  waiter.join();
+  txn_mgr.Commit(&old_txn);
+
+  EXPECT_EQ(1, lock_mgr.GetAbortStats().deadlock);
+  lock_mgr.StopDeadlockDetector();
+  EXPECT_GE(scheduler.GetStats().tasks, 1u);
+}
+// requests, waits and aborts are counted by shard, the hot rid comes first
+TEST(LockManagerTest, StatsTest) {
+  LockManager lock_mgr{false, 4};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID hot{0, 0};
+  RID cold{0, 1};
+
+  Transaction holder(5);
+  EXPECT_TRUE(lock_mgr.LockExclusive(&holder, hot));
+  std::vector<Transaction *> readers;
+  std::vector<std::thread> threads;
+  for (txn_id_t txn_id = 0; txn_id < 3; txn_id++) {
+    readers.push_back(new Transaction(txn_id));
+  }
+  for (auto reader : readers) {
+    threads.emplace_back([&lock_mgr, reader, hot] {
+      EXPECT_TRUE(lock_mgr.LockShared(reader, hot));
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  txn_mgr.Commit(&holder);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  Transaction old_txn(10);
+  Transaction young_txn(11);
+  EXPECT_TRUE(lock_mgr.LockExclusive(&old_txn, cold));
+  EXPECT_FALSE(lock_mgr.LockExclusive(&young_txn, cold));
+
+  LockStats stats = lock_mgr.GetStats();
+  EXPECT_EQ(4u, stats.shards.size());
+  EXPECT_EQ(3u, stats.total.requests[static_cast<int>(LockMode::SHARED)]);
+  EXPECT_EQ(3u, stats.total.requests[static_cast<int>(LockMode::EXCLUSIVE)]);
+  EXPECT_EQ(6u, stats.total.Requests());
+  EXPECT_EQ(5u, stats.total.grants);
+  EXPECT_EQ(3u, stats.total.waits);
+  EXPECT_EQ(3u, stats.total.wait_ns.count);
+  EXPECT_EQ(1u, stats.total.aborts);
+  ASSERT_EQ(2u, stats.hot_keys.size());
+  EXPECT_TRUE(stats.hot_keys[0].key_ == LockKey::Tuple(hot));
+  EXPECT_EQ(3u, stats.hot_keys[0].conflicts_);
+  EXPECT_TRUE(stats.hot_keys[1].key_ == LockKey::Tuple(cold));
+  EXPECT_EQ(1u, lock_mgr.GetStats(1).hot_keys.size());
+
+  lock_mgr.ResetStats();
+  stats = lock_mgr.GetStats();
+  EXPECT_EQ(0u, stats.total.Requests());
+  EXPECT_TRUE(stats.hot_keys.empty());
+
+  for (auto reader : readers) {
+    txn_mgr.Commit(reader);
+    delete reader;
+  }
+  txn_mgr.Commit(&old_txn);
+  txn_mgr.Abort(&young_txn);
+}
+
 } // namespace cmudb
@@ -0,0 +1,213 @@
+/**
+ * transaction_manager_test.cpp
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "table/table_heap.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+class TransactionManagerTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    remove("test.db");
+    ENABLE_LOGGING = false;
+    disk_manager_ = new DiskManager("test.db");
+    bpm_ = new BufferPoolManager(50, disk_manager_);
+    lock_manager_ = new LockManager(false);
+    txn_mgr_ = new TransactionManager(lock_manager_);
+    std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a")};
+    schema_ = new Schema(columns);
+    Transaction *txn = txn_mgr_->Begin();
+    table_ = new TableHeap(bpm_, lock_manager_, nullptr, txn);
+    table_->SetTupleVersions(txn_mgr_->GetTupleVersions());
+    rids_.resize(3);
+    for (int i = 0; i < 3; i++) {
+      EXPECT_TRUE(table_->InsertTuple(MakeTuple(i), rids_[i], txn));
+    }
+    txn_mgr_->Commit(txn);
+    delete txn;
+  }
+
+  void TearDown() override {
+    delete table_;
+    delete schema_;
+    delete txn_mgr_;
+    delete lock_manager_;
+    delete bpm_;
+    delete disk_manager_;
+    remove("test.db");
+  }
+
+  Tuple MakeTuple(int value) {
+    std::vector<Value> values = {Value(TypeId::INTEGER, value)};
+    return Tuple(values, schema_);
+  }
+
+  Transaction *Begin(bool optimistic) {
+    txn_mgr_->SetOptimistic(optimistic);
+    return txn_mgr_->Begin();
+  }
+
+  // value of rid as txn sees it, -1 if not at all
+  int Read(const RID &rid, Transaction *txn) {
+    Tuple tuple;
+    if (!table_->GetTuple(rid, tuple, txn)) {
+      return -1;
+    }
+    return tuple.GetValue(schema_, 0).GetAs<int32_t>();
+  }
+
+  // values a full scan by txn sees, in order
+  std::vector<int> Scan(Transaction *txn) {
+    std::vector<int> values;
+    for (auto it = table_->begin(txn); it != table_->end(); ++it) {
+      values.push_back(it->GetValue(schema_, 0).GetAs<int32_t>());
+    }
+    return values;
+  }
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *bpm_;
+  LockManager *lock_manager_;
+  TransactionManager *txn_mgr_;
+  Schema *schema_;
+  TableHeap *table_;
+  std::vector<RID> rids_;
+};
+
+/*
+ * Writes of an optimistic transaction are buffered: only it sees them until
+ * it commits
+ */
+TEST_F(TransactionManagerTest, OptimisticWriteTest) {
+  Transaction *writer = Begin(true);
+  Transaction *reader = Begin(true);
+  RID inserted;
+  EXPECT_TRUE(table_->UpdateTuple(MakeTuple(10), rids_[0], writer));
+  EXPECT_TRUE(table_->MarkDelete(rids_[1], writer));
+  EXPECT_TRUE(table_->InsertTuple(MakeTuple(3), inserted, writer));
+  EXPECT_EQ(INVALID_PAGE_ID, inserted.GetPageId());
+  EXPECT_EQ(10, Read(rids_[0], writer));
+  EXPECT_EQ(-1, Read(rids_[1], writer));
+  EXPECT_EQ(std::vector<int>({10, 2}), Scan(writer));
+  EXPECT_EQ(std::vector<int>({0, 1, 2}), Scan(reader));
+  EXPECT_EQ(3u, reader->GetReadSet()->size());
+  EXPECT_TRUE(txn_mgr_->Commit(reader));
+  EXPECT_TRUE(txn_mgr_->Commit(writer));
+  delete reader;
+  delete writer;
+
+  Transaction *later = Begin(true);
+  EXPECT_EQ(std::vector<int>({10, 2, 3}), Scan(later));
+  EXPECT_TRUE(txn_mgr_->Commit(later));
+  delete later;
+}
+
+/*
+ * A read is invalid once another transaction commits a write to the tuple,
+ * the reader aborts at commit and applies none of its writes
+ */
+TEST_F(TransactionManagerTest, OptimisticValidationTest) {
+  Transaction *first = Begin(true);
+  Transaction *second = Begin(true);
+  EXPECT_EQ(0, Read(rids_[0], first));
+  EXPECT_TRUE(table_->UpdateTuple(MakeTuple(1), rids_[2], first));
+  EXPECT_TRUE(table_->UpdateTuple(MakeTuple(5), rids_[0], second));
+  EXPECT_TRUE(txn_mgr_->Commit(second));
+  delete second;
+  EXPECT_FALSE(txn_mgr_->Commit(first));
+  EXPECT_EQ(TransactionState::ABORTED, first->GetState());
+  delete first;
+
+  Transaction *reader = Begin(true);
+  EXPECT_EQ(std::vector<int>({5, 1, 2}), Scan(reader));
+  EXPECT_TRUE(txn_mgr_->Commit(reader));
+  delete reader;
+
+  // a write it did not read does not matter
+  Transaction *blind = Begin(true);
+  Transaction *other = Begin(true);
+  EXPECT_EQ(1, Read(rids_[1], blind));
+  EXPECT_TRUE(table_->UpdateTuple(MakeTuple(6), rids_[0], other));
+  EXPECT_TRUE(txn_mgr_->Commit(other));
+  EXPECT_TRUE(txn_mgr_->Commit(blind));
+  delete blind;
+  delete other;
+}
+
+/*
+ * A pending write of a locking transaction is not read, an optimistic read
+ * before it fails validation once it commits
+ */
+TEST_F(TransactionManagerTest, OptimisticMixedTest) {
+  Transaction *early = Begin(true);
+  EXPECT_EQ(0, Read(rids_[0], early));
+  Transaction *locking = Begin(false);
+  EXPECT_TRUE(table_->UpdateTuple(MakeTuple(7), rids_[0], locking));
+  Transaction *dirty = Begin(true);
+  EXPECT_EQ(-1, Read(rids_[0], dirty));
+  EXPECT_EQ(TransactionState::ABORTED, dirty->GetState());
+  EXPECT_FALSE(txn_mgr_->Commit(dirty));
+  delete dirty;
+  txn_mgr_->Commit(locking);
+  delete locking;
+  EXPECT_FALSE(txn_mgr_->Commit(early));
+  delete early;
+
+  // a rolled back write leaves the version as it was
+  Transaction *reader = Begin(true);
+  EXPECT_EQ(1, Read(rids_[1], reader));
+  Transaction *aborted = Begin(false);
+  EXPECT_TRUE(table_->MarkDelete(rids_[1], aborted));
+  txn_mgr_->Abort(aborted);
+  delete aborted;
+  EXPECT_TRUE(txn_mgr_->Commit(reader));
+  delete reader;
+
+  // nothing is pending, and no transaction needs the versions any more
+  TupleVersionTable *versions = txn_mgr_->GetTupleVersions();
+  EXPECT_LT(0u, versions->GetEntryCount());
+  versions->Collect(txn_mgr_->GetOldestSnapshot());
+  EXPECT_EQ(0u, versions->GetEntryCount());
+}
+
+/*
+ * A transaction handed back is reused by Begin, cleared
+ */
+TEST_F(TransactionManagerTest, PoolTest) {
+  Transaction *txn = Begin(true);
+  txn_id_t txn_id = txn->GetTransactionId();
+  EXPECT_EQ(0, Read(rids_[0], txn));
+  txn_mgr_->Commit(txn);
+  txn_mgr_->Release(txn);
+
+  Transaction *reused = Begin(false);
+  EXPECT_EQ(txn, reused);
+  EXPECT_NE(txn_id, reused->GetTransactionId());
+  EXPECT_EQ(TransactionState::GROWING, reused->GetState());
+  EXPECT_FALSE(reused->IsOptimistic());
+  EXPECT_TRUE(reused->GetReadSet()->empty());
+  EXPECT_TRUE(reused->GetWriteSet()->empty());
+  EXPECT_TRUE(reused->GetSharedLockSet()->empty());
+  EXPECT_TRUE(table_->UpdateTuple(MakeTuple(4), rids_[0], reused));
+  txn_mgr_->Commit(reused);
+  txn_mgr_->Release(reused);
+
+  Transaction *other = Begin(false);
+  Transaction *fresh = Begin(false);
+  EXPECT_EQ(txn, other);
+  EXPECT_NE(txn, fresh);
+  EXPECT_EQ(4, Read(rids_[0], fresh));
+  txn_mgr_->Commit(other);
+  txn_mgr_->Commit(fresh);
+  txn_mgr_->Release(other);
+  txn_mgr_->Release(fresh);
+}
+
+} // namespace cmudb
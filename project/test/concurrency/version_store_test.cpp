@@ -0,0 +1,203 @@
+/**
+ * version_store_test.cpp
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "table/table_heap.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+class VersionStoreTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    remove("test.db");
+    ENABLE_LOGGING = false;
+    disk_manager_ = new DiskManager("test.db");
+    bpm_ = new BufferPoolManager(50, disk_manager_);
+    lock_manager_ = new LockManager(false);
+    txn_mgr_ = new TransactionManager(lock_manager_);
+    std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a")};
+    schema_ = new Schema(columns);
+    Transaction *txn = txn_mgr_->Begin();
+    table_ = new TableHeap(bpm_, lock_manager_, nullptr, txn);
+    table_->SetVersionStore(txn_mgr_->GetVersionStore());
+    txn_mgr_->Commit(txn);
+    delete txn;
+  }
+
+  void TearDown() override {
+    delete table_;
+    delete schema_;
+    delete txn_mgr_;
+    delete lock_manager_;
+    delete bpm_;
+    delete disk_manager_;
+    remove("test.db");
+  }
+
+  Tuple MakeTuple(int value) {
+    std::vector<Value> values = {Value(TypeId::INTEGER, value)};
+    return Tuple(values, schema_);
+  }
+
+  // value of rid as txn sees it, -1 if not at all
+  int Read(const RID &rid, Transaction *txn) {
+    Tuple tuple;
+    if (!table_->GetTuple(rid, tuple, txn)) {
+      return -1;
+    }
+    return tuple.GetValue(schema_, 0).GetAs<int32_t>();
+  }
+
+  // values a full scan by txn sees, in order
+  std::vector<int> Scan(Transaction *txn) {
+    std::vector<int> values;
+    for (auto it = table_->begin(txn); it != table_->end(); ++it) {
+      values.push_back(it->GetValue(schema_, 0).GetAs<int32_t>());
+    }
+    return values;
+  }
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *bpm_;
+  LockManager *lock_manager_;
+  TransactionManager *txn_mgr_;
+  Schema *schema_;
+  TableHeap *table_;
+};
+
+/*
+ * An old snapshot keeps seeing the values, deletes and inserts committed
+ * after it as they were, a new one sees them
+ */
+TEST_F(VersionStoreTest, SnapshotTest) {
+  std::vector<RID> rids(3);
+  Transaction *loader = txn_mgr_->Begin();
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(table_->InsertTuple(MakeTuple(i), rids[i], loader));
+  }
+  txn_mgr_->Commit(loader);
+  delete loader;
+
+  Transaction *reader = txn_mgr_->Begin();
+  Transaction *writer = txn_mgr_->Begin();
+  RID inserted;
+  EXPECT_TRUE(table_->UpdateTuple(MakeTuple(10), rids[0], writer));
+  EXPECT_TRUE(table_->MarkDelete(rids[1], writer));
+  EXPECT_TRUE(table_->InsertTuple(MakeTuple(3), inserted, writer));
+  // the writer sees its own writes, the reader not yet
+  EXPECT_EQ(10, Read(rids[0], writer));
+  EXPECT_EQ(-1, Read(rids[1], writer));
+  EXPECT_EQ(0, Read(rids[0], reader));
+  EXPECT_EQ(1, Read(rids[1], reader));
+  EXPECT_EQ(-1, Read(inserted, reader));
+  txn_mgr_->Commit(writer);
+  delete writer;
+
+  EXPECT_EQ(0, Read(rids[0], reader));
+  EXPECT_EQ(1, Read(rids[1], reader));
+  EXPECT_EQ(-1, Read(inserted, reader));
+  EXPECT_EQ(std::vector<int>({0, 1, 2}), Scan(reader));
+
+  Transaction *later = txn_mgr_->Begin();
+  EXPECT_EQ(10, Read(rids[0], later));
+  EXPECT_EQ(-1, Read(rids[1], later));
+  EXPECT_EQ(3, Read(inserted, later));
+  EXPECT_EQ(std::vector<int>({10, 2, 3}), Scan(later));
+  txn_mgr_->Commit(later);
+  delete later;
+
+  // the reader still needs the versions, once it is gone nobody does
+  VersionStore *store = txn_mgr_->GetVersionStore();
+  store->Collect(txn_mgr_->GetOldestSnapshot());
+  EXPECT_EQ(0, Read(rids[0], reader));
+  txn_mgr_->Commit(reader);
+  delete reader;
+  EXPECT_LT(0u, store->GetVersionCount());
+  store->Collect(txn_mgr_->GetOldestSnapshot());
+  EXPECT_EQ(0u, store->GetVersionCount());
+}
+
+/*
+ * The first updater wins: a write over a pending one, or over one committed
+ * after the snapshot, aborts. An aborted write leaves no version behind
+ */
+TEST_F(VersionStoreTest, ConflictTest) {
+  RID rid;
+  Transaction *loader = txn_mgr_->Begin();
+  EXPECT_TRUE(table_->InsertTuple(MakeTuple(0), rid, loader));
+  txn_mgr_->Commit(loader);
+  delete loader;
+
+  Transaction *first = txn_mgr_->Begin();
+  Transaction *second = txn_mgr_->Begin();
+  EXPECT_TRUE(table_->UpdateTuple(MakeTuple(1), rid, first));
+  EXPECT_TRUE(table_->UpdateTuple(MakeTuple(2), rid, first));
+  EXPECT_FALSE(table_->UpdateTuple(MakeTuple(3), rid, second));
+  EXPECT_EQ(TransactionState::ABORTED, second->GetState());
+  txn_mgr_->Abort(second);
+  delete second;
+  txn_mgr_->Commit(first);
+  delete first;
+
+  Transaction *stale = txn_mgr_->Begin();
+  Transaction *newer = txn_mgr_->Begin();
+  EXPECT_TRUE(table_->MarkDelete(rid, newer));
+  txn_mgr_->Commit(newer);
+  delete newer;
+  EXPECT_FALSE(table_->MarkDelete(rid, stale));
+  txn_mgr_->Abort(stale);
+  delete stale;
+
+  // a write rolled back is gone from the store as well
+  RID other;
+  Transaction *loader2 = txn_mgr_->Begin();
+  EXPECT_TRUE(table_->InsertTuple(MakeTuple(5), other, loader2));
+  txn_mgr_->Commit(loader2);
+  delete loader2;
+  VersionStore *store = txn_mgr_->GetVersionStore();
+  store->Collect(txn_mgr_->GetOldestSnapshot());
+  EXPECT_EQ(0u, store->GetVersionCount());
+  Transaction *aborted = txn_mgr_->Begin();
+  EXPECT_TRUE(table_->UpdateTuple(MakeTuple(6), other, aborted));
+  EXPECT_EQ(1u, store->GetVersionCount());
+  txn_mgr_->Abort(aborted);
+  delete aborted;
+  EXPECT_EQ(0u, store->GetVersionCount());
+  Transaction *reader = txn_mgr_->Begin();
+  EXPECT_EQ(5, Read(other, reader));
+  txn_mgr_->Commit(reader);
+  delete reader;
+}
+
+/*
+ * The background collector drops what no snapshot needs
+ */
+TEST_F(VersionStoreTest, GarbageCollectionTest) {
+  RID rid;
+  Transaction *loader = txn_mgr_->Begin();
+  EXPECT_TRUE(table_->InsertTuple(MakeTuple(0), rid, loader));
+  txn_mgr_->Commit(loader);
+  delete loader;
+  for (int i = 1; i <= 10; i++) {
+    Transaction *txn = txn_mgr_->Begin();
+    EXPECT_TRUE(table_->UpdateTuple(MakeTuple(i), rid, txn));
+    txn_mgr_->Commit(txn);
+    delete txn;
+  }
+  VersionStore *store = txn_mgr_->GetVersionStore();
+  EXPECT_LT(0u, store->GetVersionCount());
+  txn_mgr_->RunVersionGC();
+  for (int i = 0; i < 100 && store->GetVersionCount() > 0; i++) {
+    std::this_thread::sleep_for(VERSION_GC_INTERVAL / 5);
+  }
+  EXPECT_EQ(0u, store->GetVersionCount());
+  txn_mgr_->StopVersionGC();
+}
+
+} // namespace cmudb
@@ -0,0 +1,394 @@
+/**
+ * disk_manager_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "disk/disk_manager.h"
+#include "page/header_page.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(DiskManagerTest, ReadWriteTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  size_t page_size = disk_manager->GetPageSize();
+  std::vector<char> data(page_size), buf(page_size);
+  std::strcpy(data.data(), "A test string.");
+
+  // reading past the end of the file leaves a zeroed page
+  std::memset(buf.data(), 1, page_size);
+  disk_manager->ReadPage(0, buf.data());
+  EXPECT_EQ(0, buf[0]);
+
+  disk_manager->WritePage(0, data.data());
+  disk_manager->ReadPage(0, buf.data());
+  EXPECT_EQ(0, std::memcmp(buf.data(), data.data(), page_size));
+
+  // a hole before page 5 reads back as zeros
+  disk_manager->WritePage(5, data.data());
+  disk_manager->ReadPage(3, buf.data());
+  EXPECT_EQ(0, buf[0]);
+  disk_manager->ReadPage(5, buf.data());
+  EXPECT_EQ(0, std::memcmp(buf.data(), data.data(), page_size));
+  delete disk_manager;
+
+  // pages survive reopening
+  disk_manager = new DiskManager("test.db");
+  disk_manager->ReadPage(5, buf.data());
+  EXPECT_EQ(0, std::memcmp(buf.data(), data.data(), page_size));
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, ConcurrentPageIOTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  size_t page_size = disk_manager->GetPageSize();
+  const int num_threads = 4;
+  const int pages_per_thread = 64;
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([=] {
+      std::vector<char> data(page_size), buf(page_size);
+      for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < pages_per_thread; i++) {
+          page_id_t page_id = i * num_threads + tid;
+          std::memset(data.data(), page_id + round, page_size);
+          disk_manager->WritePage(page_id, data.data());
+          disk_manager->ReadPage(page_id, buf.data());
+          EXPECT_EQ(0, std::memcmp(buf.data(), data.data(), page_size));
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  std::vector<char> buf(page_size);
+  for (page_id_t page_id = 0; page_id < num_threads * pages_per_thread;
+       page_id++) {
+    disk_manager->ReadPage(page_id, buf.data());
+    EXPECT_EQ(static_cast<char>(page_id + 3), buf[page_size - 1]);
+  }
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, WritePagesTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  size_t page_size = disk_manager->GetPageSize();
+  // two runs, 2..5 and 9..10, handed over out of order
+  std::vector<page_id_t> page_ids = {4, 10, 2, 5, 9, 3};
+  std::vector<std::vector<char>> pages;
+  std::vector<const char *> data;
+  for (page_id_t page_id : page_ids) {
+    pages.emplace_back(page_size, static_cast<char>(page_id));
+  }
+  for (auto &page : pages) {
+    data.push_back(page.data());
+  }
+  disk_manager->WritePages(page_ids.data(), data.data(), page_ids.size());
+
+  std::vector<char> buf(page_size);
+  for (page_id_t page_id : page_ids) {
+    disk_manager->ReadPage(page_id, buf.data());
+    EXPECT_EQ(page_id, buf[0]);
+    EXPECT_EQ(page_id, buf[page_size - 1]);
+  }
+  // the hole between the runs is still zero
+  disk_manager->ReadPage(7, buf.data());
+  EXPECT_EQ(0, buf[0]);
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, FreeSpaceMapTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t page_id;
+  HeaderPage *header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  ASSERT_NE(nullptr, header_page);
+  header_page->Init();
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  for (int i = 1; i <= 8; i++) {
+    ASSERT_NE(nullptr, bpm->NewPage(page_id));
+    EXPECT_EQ(i, page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+
+  // freed pages come back lowest first, the bitmap took page 9
+  EXPECT_EQ(true, bpm->DeletePage(6));
+  EXPECT_EQ(true, bpm->DeletePage(3));
+  // free once the pages that could point to them are written
+  EXPECT_EQ(0u, disk_manager->GetFreePageCount());
+  bpm->FlushAllPages();
+  EXPECT_EQ(9, disk_manager->GetFreeSpaceMapPageId());
+  EXPECT_EQ(2u, disk_manager->GetFreePageCount());
+  ASSERT_NE(nullptr, bpm->NewPage(page_id));
+  EXPECT_EQ(3, page_id);
+  bpm->UnpinPage(page_id, true);
+  EXPECT_EQ(1u, disk_manager->GetFreePageCount());
+  // freeing twice, the header page or a bitmap page changes nothing
+  disk_manager->DeallocatePage(6);
+  disk_manager->DeallocatePage(HEADER_PAGE_ID);
+  disk_manager->DeallocatePage(9);
+  EXPECT_EQ(1u, disk_manager->GetFreePageCount());
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+
+  // the bitmap is found again through the header page
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(10, disk_manager->GetPageCount());
+  EXPECT_EQ(9, disk_manager->GetFreeSpaceMapPageId());
+  EXPECT_EQ(1u, disk_manager->GetFreePageCount());
+  EXPECT_EQ(6, disk_manager->AllocatePage());
+  EXPECT_EQ(10, disk_manager->AllocatePage());
+
+  // free pages at the end of the file are cut off, the bitmap page stays
+  disk_manager->DeallocatePage(10);
+  EXPECT_EQ(1u, disk_manager->ShrinkFile());
+  EXPECT_EQ(0u, disk_manager->ShrinkFile());
+  EXPECT_EQ(10, disk_manager->GetPageCount());
+  EXPECT_EQ(0u, disk_manager->GetFreePageCount());
+  EXPECT_EQ(10, disk_manager->AllocatePage());
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// pages allocated but never written are past the end of the file after a
+// restart, recovery claims those it finds in the log
+TEST(DiskManagerTest, ClaimPageTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  std::vector<char> data(disk_manager->GetPageSize(), 1);
+  for (page_id_t page_id = 0; page_id < 10; page_id++) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+  }
+  disk_manager->WritePage(4, data.data());
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(5, disk_manager->GetPageCount());
+  disk_manager->ClaimPage(8);
+  disk_manager->ClaimPage(6);
+  EXPECT_EQ(9, disk_manager->GetPageCount());
+  // the bitmap goes after the claimed pages
+  disk_manager->DeallocatePage(7);
+  EXPECT_EQ(9, disk_manager->GetFreeSpaceMapPageId());
+  EXPECT_EQ(7, disk_manager->AllocatePage());
+  EXPECT_EQ(10, disk_manager->AllocatePage());
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, AllocationHintTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  for (page_id_t page_id = 0; page_id < 100; page_id++) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+  }
+  // the bitmap page is 100
+  disk_manager->DeallocatePage(3);
+  disk_manager->DeallocatePage(50);
+  disk_manager->DeallocatePage(60);
+  EXPECT_EQ(3u, disk_manager->GetFreePageCount());
+
+  // the nearest free page after the hint
+  EXPECT_EQ(50, disk_manager->AllocatePage(40));
+  // none close enough after the hint, a chain near the end stays there
+  EXPECT_EQ(101, disk_manager->AllocatePage(99));
+  // page 3 is the nearest free one after hint 1
+  EXPECT_EQ(3, disk_manager->AllocatePage(1));
+  EXPECT_EQ(60, disk_manager->AllocatePage());
+  EXPECT_EQ(102, disk_manager->AllocatePage(60));
+  EXPECT_EQ(0u, disk_manager->GetFreePageCount());
+
+  // without a hint, the lowest free page preferred goes first
+  disk_manager->DeallocatePage(3);
+  disk_manager->DeallocatePage(4);
+  disk_manager->DeallocatePage(50);
+  auto even = [](page_id_t page_id) { return page_id % 2 == 0; };
+  EXPECT_EQ(4, disk_manager->AllocatePage(INVALID_PAGE_ID, even));
+  EXPECT_EQ(50, disk_manager->AllocatePage(INVALID_PAGE_ID, even));
+  // then any free page
+  EXPECT_EQ(3, disk_manager->AllocatePage(INVALID_PAGE_ID, even));
+  EXPECT_EQ(103, disk_manager->AllocatePage(INVALID_PAGE_ID, even));
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, StripedTablespaceTest) {
+  std::vector<std::string> files = {"test.db", "test.db.1"};
+  const size_t stripe_pages = 4;
+  DiskManager *disk_manager =
+      new DiskManager(files, PAGE_SIZE, stripe_pages);
+  EXPECT_EQ(2u, disk_manager->GetFileCount());
+  size_t page_size = disk_manager->GetPageSize();
+  const int num_pages = 20;
+  std::vector<std::vector<char>> data(num_pages, std::vector<char>(page_size));
+  std::vector<page_id_t> page_ids;
+  std::vector<const char *> page_data;
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+    std::snprintf(data[i].data(), page_size, "page %d", i);
+    page_ids.push_back(i);
+    page_data.push_back(data[i].data());
+  }
+  // runs are split where the next stripe unit begins
+  disk_manager->WritePages(page_ids.data(), page_data.data(), 10);
+  for (int i = 10; i < num_pages; i++) {
+    disk_manager->WritePage(i, data[i].data());
+  }
+  delete disk_manager;
+
+  // units 0, 2 and 4 are in the first file, 1 and 3 in the second one
+  struct stat stat_buf;
+  ASSERT_EQ(0, stat("test.db", &stat_buf));
+  EXPECT_EQ(12 * page_size, static_cast<size_t>(stat_buf.st_size));
+  ASSERT_EQ(0, stat("test.db.1", &stat_buf));
+  EXPECT_EQ(8 * page_size, static_cast<size_t>(stat_buf.st_size));
+  std::vector<char> buf(page_size);
+  FILE *file = fopen("test.db.1", "rb");
+  ASSERT_NE(nullptr, file);
+  EXPECT_EQ(page_size, fread(buf.data(), 1, page_size, file));
+  fclose(file);
+  EXPECT_STREQ("page 4", buf.data());
+
+  // reopening finds every page again
+  disk_manager = new DiskManager(files, PAGE_SIZE, stripe_pages);
+  EXPECT_EQ(num_pages, disk_manager->GetPageCount());
+  for (int i = 0; i < num_pages; i++) {
+    disk_manager->ReadPage(i, buf.data());
+    EXPECT_EQ(0, std::memcmp(buf.data(), data[i].data(), page_size));
+  }
+  delete disk_manager;
+  remove("test.db");
+  remove("test.db.1");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, PageChecksumTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  disk_manager->SetPageChecksums(true);
+  size_t page_size = disk_manager->GetPageSize();
+  std::vector<char> data(page_size), buf(page_size);
+  std::strcpy(data.data() + 64, "A test string.");
+  for (page_id_t page_id = 0; page_id < 3; page_id++) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+    disk_manager->WritePage(page_id, data.data());
+  }
+  // the caller's buffer is left alone, the page on disk is stamped
+  uint32_t checksum;
+  std::memcpy(&checksum, data.data() + PAGE_CHECKSUM_OFFSET, sizeof(checksum));
+  EXPECT_EQ(0u, checksum);
+  EXPECT_TRUE(disk_manager->ReadPage(1, buf.data()));
+  std::memcpy(&checksum, buf.data() + PAGE_CHECKSUM_OFFSET, sizeof(checksum));
+  EXPECT_NE(0u, checksum);
+  EXPECT_EQ(0, std::strcmp(buf.data() + 64, "A test string."));
+  // pages never stamped, here a hole, are not verified
+  EXPECT_TRUE(disk_manager->ReadPage(5, buf.data()));
+  delete disk_manager;
+
+  // flip a bit of page 2 behind the disk manager's back
+  FILE *file = fopen("test.db", "r+b");
+  ASSERT_NE(nullptr, file);
+  fseek(file, 2 * page_size + 100, SEEK_SET);
+  fputc(1, file);
+  fclose(file);
+
+  disk_manager = new DiskManager("test.db");
+  disk_manager->SetPageChecksums(true);
+  EXPECT_TRUE(disk_manager->ReadPage(1, buf.data()));
+  EXPECT_FALSE(disk_manager->ReadPage(2, buf.data()));
+  ChecksumStats stats = disk_manager->GetChecksumStats();
+  EXPECT_EQ(2u, stats.pages_verified);
+  EXPECT_EQ(1u, stats.failures);
+
+  // the buffer pool does not hand a corrupted page out
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager);
+  EXPECT_EQ(nullptr, bpm->FetchPage(2));
+  Page *page = bpm->FetchPage(1);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, std::strcmp(page->GetData() + 64, "A test string."));
+  bpm->UnpinPage(1, false);
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, LogFileTest) {
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(0, disk_manager->GetLogSize());
+  // two buffers in turn like the log manager, 2.5 files worth of log
+  const int chunk = LOG_BUFFER_SIZE;
+  const int total = 5 * (LOG_FILE_SIZE / 2);
+  std::vector<char> buffers[2] = {std::vector<char>(chunk),
+                                  std::vector<char>(chunk)};
+  int written = 0;
+  for (int i = 0; written < total; i++) {
+    int size = std::min(chunk, total - written);
+    char *data = buffers[i % 2].data();
+    for (int j = 0; j < size; j++) {
+      data[j] = static_cast<char>((written + j) % 251);
+    }
+    disk_manager->WriteLog(data, size);
+    written += size;
+  }
+  EXPECT_EQ(total, disk_manager->GetLogSize());
+  struct stat stat_buf;
+  EXPECT_EQ(0, stat("test.log.1", &stat_buf));
+  EXPECT_EQ(LOG_FILE_SIZE, static_cast<int>(stat_buf.st_size));
+
+  // a read across two files, and one past the end
+  std::vector<char> buf(100);
+  EXPECT_TRUE(disk_manager->ReadLog(buf.data(), 100, LOG_FILE_SIZE - 50));
+  for (int j = 0; j < 100; j++) {
+    EXPECT_EQ(static_cast<char>((LOG_FILE_SIZE - 50 + j) % 251), buf[j]);
+  }
+  EXPECT_TRUE(disk_manager->ReadLog(buf.data(), 100, total - 50));
+  EXPECT_EQ(0, buf[50]);
+  EXPECT_FALSE(disk_manager->ReadLog(buf.data(), 100, total));
+
+  // only files entirely below the offset go
+  EXPECT_EQ(0u, disk_manager->TruncateLog(LOG_FILE_SIZE - 1));
+  EXPECT_EQ(1u, disk_manager->TruncateLog(LOG_FILE_SIZE + 1));
+  EXPECT_EQ(0, stat("test.log", &stat_buf));
+  EXPECT_EQ(0, static_cast<int>(stat_buf.st_size));
+  EXPECT_EQ(LOG_FILE_SIZE, disk_manager->GetLogStart());
+  EXPECT_FALSE(disk_manager->ReadLog(buf.data(), 100, 0));
+  delete disk_manager;
+
+  // the end of the log is found again
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(total, disk_manager->GetLogSize());
+  EXPECT_EQ(LOG_FILE_SIZE, disk_manager->GetLogStart());
+  EXPECT_TRUE(disk_manager->ReadLog(buf.data(), 100, 2 * LOG_FILE_SIZE));
+  EXPECT_EQ(static_cast<char>(2 * LOG_FILE_SIZE % 251), buf[0]);
+  delete disk_manager;
+
+  // without the first file the others are leftovers
+  remove("test.log");
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(0, disk_manager->GetLogSize());
+  EXPECT_NE(0, stat("test.log.1", &stat_buf));
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -0,0 +1,87 @@
+/**
+ * disk_scheduler_test.cpp
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "disk/disk_scheduler.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// write pages in one batch, read them back through futures
+static void RoundTrip(bool use_io_uring) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  size_t page_size = disk_manager->GetPageSize();
+  const int num_pages = 200;
+  std::vector<char> data(num_pages * page_size), buf(num_pages * page_size);
+  for (int i = 0; i < num_pages; i++) {
+    std::memset(&data[i * page_size], i, page_size);
+  }
+  {
+    // a queue depth below the batch size, the batch is submitted in parts
+    DiskScheduler scheduler(disk_manager, 16, 2, use_io_uring);
+    if (!use_io_uring) {
+      EXPECT_FALSE(scheduler.UsesIoUring());
+    }
+
+    // past the end of the file, completes without touching the buffer
+    std::memset(&buf[0], 1, page_size);
+    scheduler.ReadPageAsync(3, &buf[0]).get();
+    EXPECT_EQ(1, buf[0]);
+
+    std::atomic<int> written(0);
+    std::vector<DiskRequest> requests;
+    for (int i = 0; i < num_pages; i++) {
+      requests.push_back(DiskRequest{true, i, &data[i * page_size],
+                                     [&written] { ++written; }});
+    }
+    scheduler.Schedule(requests);
+    scheduler.Drain();
+    EXPECT_EQ(num_pages, written.load());
+
+    std::vector<std::future<void>> reads;
+    for (int i = 0; i < num_pages; i++) {
+      reads.push_back(scheduler.ReadPageAsync(i, &buf[i * page_size]));
+    }
+    for (auto &read : reads) {
+      read.get();
+    }
+    EXPECT_EQ(0, std::memcmp(&buf[0], &data[0], buf.size()));
+
+    // the DiskManager sees what the scheduler wrote
+    std::memset(&data[0], 42, page_size);
+    scheduler.WritePageAsync(0, &data[0]).get();
+  }
+  disk_manager->ReadPage(0, &buf[0]);
+  EXPECT_EQ(0, std::memcmp(&buf[0], &data[0], page_size));
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskSchedulerTest, ThreadPoolTest) { RoundTrip(false); }
+
+TEST(DiskSchedulerTest, IoUringTest) { RoundTrip(true); }
+
+TEST(DiskSchedulerTest, DirectIOTest) {
+  // falls back to buffered I/O where O_DIRECT is refused
+  DiskManager *disk_manager = new DiskManager("test.db", PAGE_SIZE, true);
+  std::vector<char> data(PAGE_SIZE + 1, 7), buf(PAGE_SIZE + 1, 0);
+  {
+    DiskScheduler scheduler(disk_manager);
+    // deliberately misaligned buffers
+    scheduler.WritePageAsync(1, &data[1]).get();
+    scheduler.ReadPageAsync(1, &buf[1]).get();
+  }
+  EXPECT_EQ(0, std::memcmp(&buf[1], &data[1], PAGE_SIZE));
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
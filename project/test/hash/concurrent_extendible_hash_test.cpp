@@ -0,0 +1,94 @@
+/**
+ * concurrent_extendible_hash_test.cpp
+ */
+
+#include <thread>
+#include <vector>
+
+#include "hash/concurrent_extendible_hash.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ConcurrentExtendibleHashTest, SampleTest) {
+  // splits the same way ExtendibleHash does
+  ConcurrentExtendibleHash<int, std::string, StdHasher<int>> test(2);
+  ExtendibleHash<int, std::string, StdHasher<int>> reference(2);
+  for (int i = 1; i <= 9; i++) {
+    test.Insert(i, std::string(1, 'a' + i - 1));
+    reference.Insert(i, std::string(1, 'a' + i - 1));
+  }
+  EXPECT_EQ(reference.GetGlobalDepth(), test.GetGlobalDepth());
+  EXPECT_EQ(reference.GetNumBuckets(), test.GetNumBuckets());
+  for (int i = 0; i < test.GetNumBuckets(); i++) {
+    EXPECT_EQ(reference.GetLocalDepth(i), test.GetLocalDepth(i));
+  }
+
+  std::string result;
+  EXPECT_TRUE(test.Find(9, result));
+  EXPECT_EQ("i", result);
+  EXPECT_FALSE(test.Find(10, result));
+  EXPECT_TRUE(test.Remove(8));
+  EXPECT_FALSE(test.Remove(8));
+  EXPECT_FALSE(test.Find(8, result));
+}
+
+TEST(ConcurrentExtendibleHashTest, ConcurrentMixedTest) {
+  const int num_threads = 8;
+  const int num_keys = 4000;
+  ConcurrentExtendibleHash<int, int> test(16);
+  std::vector<std::thread> threads;
+  // each thread owns the keys equal to its id modulo num_threads
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([tid, &test]() {
+      int val;
+      for (int i = tid; i < num_keys; i += num_threads) {
+        test.Insert(i, i);
+        EXPECT_TRUE(test.Find(i, val));
+        EXPECT_EQ(i, val);
+      }
+      for (int i = tid; i < num_keys; i += 2 * num_threads) {
+        EXPECT_TRUE(test.Remove(i));
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  int val;
+  for (int i = 0; i < num_keys; i++) {
+    EXPECT_EQ((i % (2 * num_threads)) >= num_threads, test.Find(i, val));
+  }
+}
+
+TEST(ConcurrentExtendibleHashTest, RacingSplitTest) {
+  const int num_threads = 8;
+  const int num_keys = 8000;
+  const size_t bucket_size = 4;
+  ConcurrentExtendibleHash<int, int> test(bucket_size);
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([tid, &test]() {
+      for (int i = tid; i < num_keys; i += num_threads) {
+        test.Insert(i, i);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  // a bucket of local depth d has 1 << (global depth - d) slots. No bucket
+  // is left full, so there are enough of them for bucket_size - 1 keys each
+  int global_depth = test.GetGlobalDepth();
+  double buckets = 0;
+  for (int i = 0; i < test.GetNumBuckets(); i++) {
+    buckets += 1.0 / (1 << (global_depth - test.GetLocalDepth(i)));
+  }
+  EXPECT_LE(num_keys, buckets * (bucket_size - 1));
+  int val;
+  for (int i = 0; i < num_keys; i++) {
+    EXPECT_TRUE(test.Find(i, val));
+  }
+}
+
+} // namespace cmudb
@@ -10,9 +10,9 @@
 namespace cmudb {
 
 TEST(ExtendibleHashTest, SampleTest) {
-  // set leaf size as 2
-  ExtendibleHash<int, std::string> *test =
-      new ExtendibleHash<int, std::string>(2);
+  // set leaf size as 2, the expected depths assume identity hashing
+  ExtendibleHash<int, std::string, StdHasher<int>> *test =
+      new ExtendibleHash<int, std::string, StdHasher<int>>(2);
 
   // insert several key/value pairs
   test->Insert(1, "a");
@@ -54,7 +54,8 @@ TEST(ExtendibleHashTest, ConcurrentInsertTest) {
   const int num_threads = 3;
   // Run concurrent test multiple times to guarantee correctness.
   for (int run = 0; run < num_runs; run++) {
-    std::shared_ptr<ExtendibleHash<int, int>> test{new ExtendibleHash<int, int>(2)};
+    std::shared_ptr<ExtendibleHash<int, int, StdHasher<int>>> test{
+        new ExtendibleHash<int, int, StdHasher<int>>(2)};
     std::vector<std::thread> threads;
     for (int tid = 0; tid < num_threads; tid++) {
       threads.push_back(std::thread([tid, &test]() {
@@ -77,7 +78,8 @@ TEST(ExtendibleHashTest, ConcurrentRemoveTest) {
   const int num_threads = 5;
   const int num_runs = 50;
   for (int run = 0; run < num_runs; run++) {
-    std::shared_ptr<ExtendibleHash<int, int>> test{new ExtendibleHash<int, int>(2)};
+    std::shared_ptr<ExtendibleHash<int, int, StdHasher<int>>> test{
+        new ExtendibleHash<int, int, StdHasher<int>>(2)};
     std::vector<std::thread> threads;
     std::vector<int> values{0, 10, 16, 32, 64};
     for (int value : values) {
@@ -102,4 +104,115 @@ TEST(ExtendibleHashTest, ConcurrentRemoveTest) {
     EXPECT_EQ(1, test->Find(4, val));
   }
 }
+TEST(ExtendibleHashTest, LargeBucketTest) {
+  // buckets wide enough for several fingerprint blocks per probe
+  ExtendibleHash<int, int> test(64);
+  for (int i = 0; i < 10000; i++) {
+    test.Insert(i, i * 2);
+  }
+  // an existing key keeps its value
+  test.Insert(7, 0);
+  int val;
+  for (int i = 0; i < 10000; i++) {
+    EXPECT_TRUE(test.Find(i, val));
+    EXPECT_EQ(i * 2, val);
+  }
+  for (int i = 0; i < 10000; i += 2) {
+    EXPECT_TRUE(test.Remove(i));
+  }
+  for (int i = 0; i < 10000; i++) {
+    EXPECT_EQ(i % 2 == 1, test.Find(i, val));
+  }
+  EXPECT_FALSE(test.Find(10000, val));
+
+  ExtendibleHash<int, std::string> strings(32);
+  for (int i = 0; i < 1000; i++) {
+    strings.Insert(i, std::to_string(i));
+  }
+  std::string result;
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(strings.Find(i, result));
+    EXPECT_EQ(std::to_string(i), result);
+  }
+}
+
+TEST(ExtendibleHashTest, ShrinkTest) {
+  ExtendibleHash<int, int> test(4);
+  for (int i = 0; i < 1000; i++) {
+    test.Insert(i, i);
+  }
+  int peak_depth = test.GetGlobalDepth();
+  EXPECT_LT(5, peak_depth);
+
+  // buckets merge back as keys go away, the directory follows
+  for (int i = 0; i < 990; i++) {
+    EXPECT_TRUE(test.Remove(i));
+  }
+  EXPECT_GT(peak_depth, test.GetGlobalDepth());
+  int val;
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_EQ(i >= 990, test.Find(i, val));
+  }
+  for (int i = 990; i < 1000; i++) {
+    EXPECT_TRUE(test.Remove(i));
+  }
+  EXPECT_EQ(0, test.GetGlobalDepth());
+  EXPECT_EQ(2, test.GetNumBuckets());
+
+  // and grows again
+  for (int i = 0; i < 1000; i++) {
+    test.Insert(i, i);
+  }
+  EXPECT_EQ(peak_depth, test.GetGlobalDepth());
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(test.Find(i, val));
+  }
+}
+
+TEST(ExtendibleHashTest, HistogramTest) {
+  // keys sharing their low bits: identity hashing cannot tell them apart and
+  // piles them up in few buckets, mixed hashes spread them out
+  ExtendibleHash<int, int> mixed(8);
+  ExtendibleHash<int, int, StdHasher<int>> identity(8);
+  for (int i = 0; i < 4096; i++) {
+    mixed.Insert(i * 64, i);
+    identity.Insert(i * 64, i);
+  }
+  std::vector<size_t> depths;
+  std::vector<size_t> occupancy;
+  // the fullest bucket is the last entry of the histogram
+  identity.GetOccupancyHistogram(occupancy);
+  size_t identity_max = occupancy.size() - 1;
+  mixed.GetOccupancyHistogram(occupancy);
+  size_t mixed_max = occupancy.size() - 1;
+  // spread out, no bucket holds more than a few times its size
+  EXPECT_GT(64u, mixed_max);
+  EXPECT_LT(mixed_max, identity_max);
+  mixed.GetDepthHistogram(depths);
+  mixed.GetOccupancyHistogram(occupancy);
+  EXPECT_EQ(static_cast<size_t>(mixed.GetGlobalDepth() + 1), depths.size());
+  EXPECT_LT(0u, depths.back());
+  size_t buckets = 0;
+  size_t entries = 0;
+  for (size_t n = 0; n < occupancy.size(); n++) {
+    buckets += occupancy[n];
+    entries += n * occupancy[n];
+  }
+  size_t depth_buckets = 0;
+  for (auto count : depths) {
+    depth_buckets += count;
+  }
+  EXPECT_EQ(buckets, depth_buckets);
+  EXPECT_EQ(4096u, entries);
+
+  ExtendibleHash<std::string, int> strings(8);
+  for (int i = 0; i < 1000; i++) {
+    strings.Insert("key" + std::to_string(i), i);
+  }
+  int val;
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(strings.Find("key" + std::to_string(i), val));
+    EXPECT_EQ(i, val);
+  }
+}
 } // namespace cmudb
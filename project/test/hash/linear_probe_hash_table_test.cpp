@@ -0,0 +1,106 @@
+/**
+ * linear_probe_hash_table_test.cpp
+ */
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "hash/linear_probe_hash_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(LinearProbeHashTableTest, SampleTest) {
+  LinearProbeHashTable<int, int> test(10, -1);
+  EXPECT_EQ(32, test.GetCapacity());
+
+  for (int i = 0; i < 10; ++i) {
+    test.Insert(i, i * 10);
+  }
+  EXPECT_EQ(10, test.GetSize());
+
+  int result;
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(true, test.Find(i, result));
+    EXPECT_EQ(i * 10, result);
+  }
+  EXPECT_EQ(false, test.Find(10, result));
+
+  // insert on an existing key replaces its value
+  test.Insert(3, 300);
+  EXPECT_EQ(true, test.Find(3, result));
+  EXPECT_EQ(300, result);
+  EXPECT_EQ(10, test.GetSize());
+
+  // delete test
+  EXPECT_EQ(true, test.Remove(3));
+  EXPECT_EQ(false, test.Remove(3));
+  EXPECT_EQ(false, test.Find(3, result));
+  EXPECT_EQ(9, test.GetSize());
+}
+
+TEST(LinearProbeHashTableTest, RandomTest) {
+  // random inserts and removes up to the full load the table is sized for
+  LinearProbeHashTable<int, int> test(64, -1);
+  std::unordered_map<int, int> expected;
+  std::mt19937 rng(15445);
+  for (int round = 0; round < 20000; ++round) {
+    int key = static_cast<int>(rng() % 96) * 128;
+    if (rng() % 2 == 0 && expected.size() < 64) {
+      test.Insert(key, round);
+      expected[key] = round;
+    } else {
+      EXPECT_EQ(expected.erase(key) == 1, test.Remove(key));
+    }
+  }
+
+  int result;
+  for (int key = 0; key < 96 * 128; key += 128) {
+    auto iter = expected.find(key);
+    EXPECT_EQ(iter != expected.end(), test.Find(key, result));
+    if (iter != expected.end()) {
+      EXPECT_EQ(iter->second, result);
+    }
+  }
+  EXPECT_EQ(expected.size(), test.GetSize());
+}
+
+TEST(LinearProbeHashTableTest, ConcurrentFindTest) {
+  LinearProbeHashTable<int, int> test(64, -1);
+  // keys 0..31 stay, 32..63 keep coming and going around them
+  for (int i = 0; i < 32; ++i) {
+    test.Insert(i, i);
+  }
+
+  std::atomic<bool> done(false);
+  std::thread writer([&test, &done] {
+    for (int round = 0; round < 20000; ++round) {
+      int key = 32 + round % 32;
+      test.Insert(key, key);
+      test.Remove(key);
+    }
+    done = true;
+  });
+
+  std::vector<std::thread> readers;
+  for (int tid = 0; tid < 2; ++tid) {
+    readers.push_back(std::thread([&test, &done] {
+      int result;
+      while (!done) {
+        for (int i = 0; i < 32; ++i) {
+          EXPECT_EQ(true, test.Find(i, result));
+          EXPECT_EQ(i, result);
+        }
+      }
+    }));
+  }
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+}
+
+} // namespace cmudb
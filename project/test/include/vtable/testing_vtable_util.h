@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstdio>
 #include <iostream>
 #include <string>
@@ -38,4 +39,16 @@ bool ExecSQL(sqlite3 *db, std::string sql) {
   return true;
 }
 
+// the first column of the first row of sql, -1 if it has none
+int64_t QueryInt(sqlite3 *db, std::string sql) {
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    return -1;
+  int64_t result = -1;
+  if (sqlite3_step(stmt) == SQLITE_ROW)
+    result = sqlite3_column_int64(stmt, 0);
+  sqlite3_finalize(stmt);
+  return result;
+}
+
 } // namespace cmudb
\ No newline at end of file
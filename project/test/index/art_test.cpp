@@ -0,0 +1,174 @@
+/**
+ * art_test.cpp
+ */
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "index/art.h"
+#include "index/art_index.h"
+#include "index/normalized_key.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// key as a bigint is normalized
+static std::string IntegerKey(int64_t key) {
+  std::string bytes(8, '\0');
+  NormalizedKey::EncodeInteger(key, &bytes[0]);
+  return bytes;
+}
+
+/*
+ * Random integers fill every kind of node, strings with long shared starts
+ * make chains of prefixes
+ */
+TEST(ArtTests, InsertRemoveTest) {
+  AdaptiveRadixTree tree;
+  std::mt19937_64 random(15445);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 20000; i++) {
+    keys.push_back(IntegerKey(static_cast<int64_t>(random() >> 40)));
+  }
+  // too many for a Node16
+  for (int64_t i = 0; i < 30; i++) {
+    keys.push_back(IntegerKey((int64_t(1) << 40) + i));
+  }
+  for (int i = 0; i < 2000; i++) {
+    keys.push_back("a prefix longer than any node keeps " +
+                   std::to_string(i * 7919 % 2000) + std::string(1, '\0'));
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+
+  for (size_t i = 0; i < keys.size(); i++) {
+    EXPECT_TRUE(tree.Insert(VarKey(keys[i]), RID(0, i)));
+  }
+  EXPECT_FALSE(tree.Insert(VarKey(keys[0]), RID(1, 0)));
+  EXPECT_EQ(keys.size(), tree.GetSize());
+  EXPECT_LT(0u, tree.GetNodeCount(4));
+  EXPECT_LT(0u, tree.GetNodeCount(16));
+  EXPECT_LT(0u, tree.GetNodeCount(48));
+  EXPECT_LT(1u, tree.GetNodeCount(256));
+
+  std::vector<RID> rids;
+  for (size_t i = 0; i < keys.size(); i++) {
+    rids.clear();
+    ASSERT_TRUE(tree.GetValue(VarKey(keys[i]), rids));
+    EXPECT_EQ(static_cast<int>(i), rids[0].GetSlotNum());
+  }
+  rids.clear();
+  EXPECT_FALSE(tree.GetValue(VarKey(IntegerKey(-1)), rids));
+  EXPECT_FALSE(tree.GetValue(VarKey(std::string("a prefix")), rids));
+
+  for (size_t i = 0; i < keys.size(); i += 2) {
+    EXPECT_TRUE(tree.Remove(VarKey(keys[i])));
+  }
+  EXPECT_FALSE(tree.Remove(VarKey(keys[0])));
+  for (size_t i = 0; i < keys.size(); i++) {
+    rids.clear();
+    ASSERT_EQ(i % 2 == 1, tree.GetValue(VarKey(keys[i]), rids));
+  }
+  // the holes are filled again
+  for (size_t i = 0; i < keys.size(); i += 2) {
+    EXPECT_TRUE(tree.Insert(VarKey(keys[i]), RID(2, i)));
+  }
+  EXPECT_EQ(keys.size(), tree.GetSize());
+
+  // keys must not start one another
+  EXPECT_THROW(tree.Insert(VarKey(keys[1].substr(0, 4)), RID(0, 0)),
+               Exception);
+  EXPECT_THROW(tree.Insert(VarKey(keys[1] + "x"), RID(0, 0)), Exception);
+}
+
+/*
+ * Writers of their own keys and readers of all of them at once, while nodes
+ * grow and are replaced under the readers
+ */
+TEST(ArtTests, ConcurrentTest) {
+  AdaptiveRadixTree tree;
+  const int num_threads = 4;
+  const int64_t keys_per_thread = 20000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&tree, t, keys_per_thread] {
+      for (int64_t i = 0; i < keys_per_thread; i++) {
+        int64_t key = i * num_threads + t;
+        EXPECT_TRUE(tree.Insert(VarKey(IntegerKey(key)), RID(t, i)));
+      }
+      // a half of them out again, read by the others meanwhile
+      for (int64_t i = 0; i < keys_per_thread; i += 2) {
+        int64_t key = i * num_threads + t;
+        EXPECT_TRUE(tree.Remove(VarKey(IntegerKey(key))));
+      }
+    });
+    threads.emplace_back([&tree, t, keys_per_thread] {
+      std::mt19937 random(t);
+      std::uniform_int_distribution<int64_t> key_of(
+          0, num_threads * keys_per_thread - 1);
+      std::vector<RID> rids;
+      for (int i = 0; i < 50000; i++) {
+        int64_t key = key_of(random);
+        rids.clear();
+        if (tree.GetValue(VarKey(IntegerKey(key)), rids)) {
+          ASSERT_EQ(1u, rids.size());
+          EXPECT_EQ(key % num_threads, rids[0].GetPageId());
+          EXPECT_EQ(key / num_threads, rids[0].GetSlotNum());
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(static_cast<size_t>(num_threads * keys_per_thread / 2),
+            tree.GetSize());
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < num_threads * keys_per_thread; key++) {
+    rids.clear();
+    ASSERT_EQ((key / num_threads) % 2 == 1,
+              tree.GetValue(VarKey(IntegerKey(key)), rids));
+  }
+}
+
+TEST(ArtTests, IndexTest) {
+  Schema *schema = ParseCreateStatement("a varchar(64), b bigint");
+  IndexMetadata *metadata =
+      new IndexMetadata("foo_ab", "foo", schema, {0, 1}, IndexType::ART);
+  Index *index = ConstructIndex(metadata, nullptr, INVALID_PAGE_ID);
+  Schema *key_schema = index->GetKeySchema();
+  for (int64_t i = 0; i < 1000; i++) {
+    Tuple key({Value(TypeId::VARCHAR, std::to_string(i % 10)),
+               Value(TypeId::BIGINT, i)},
+              key_schema);
+    index->InsertEntry(key, RID(1, static_cast<uint32_t>(i)));
+  }
+  std::vector<RID> result;
+  for (int64_t i = 0; i < 1000; i++) {
+    result.clear();
+    Tuple key({Value(TypeId::VARCHAR, std::to_string(i % 10)),
+               Value(TypeId::BIGINT, i)},
+              key_schema);
+    index->ScanKey(key, result);
+    ASSERT_EQ(1u, result.size());
+    EXPECT_EQ(i, result[0].GetSlotNum());
+  }
+  Tuple key({Value(TypeId::VARCHAR, std::string("7")),
+             Value(TypeId::BIGINT, static_cast<int64_t>(7))},
+            key_schema);
+  index->DeleteEntry(key, RID(1, 7));
+  result.clear();
+  index->ScanKey(key, result);
+  EXPECT_TRUE(result.empty());
+
+  delete index;
+  delete schema;
+}
+
+} // namespace cmudb
@@ -0,0 +1,158 @@
+/**
+ * b_epsilon_tree_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "index/b_epsilon_tree.h"
+#include "index/b_epsilon_tree_index.h"
+#include "index/b_plus_tree.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+typedef BEpsilonTree<GenericKey<8>, RID, GenericComparator<8>> Tree;
+
+class BEpsilonTreeTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    remove("test.db");
+    disk_manager_ = new DiskManager("test.db");
+    bpm_ = new BufferPoolManager(20, disk_manager_);
+    page_id_t header_page_id;
+    bpm_->NewPage(header_page_id);
+    bpm_->UnpinPage(header_page_id, true);
+    key_schema_ = new Schema({Column(TypeId::BIGINT, 8, "a")});
+    comparator_ = new GenericComparator<8>(key_schema_);
+  }
+
+  void TearDown() override {
+    delete comparator_;
+    delete key_schema_;
+    delete bpm_;
+    delete disk_manager_;
+    remove("test.db");
+  }
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *bpm_;
+  Schema *key_schema_;
+  GenericComparator<8> *comparator_;
+};
+
+/*
+ * Random inserts, overwrites and removes, checked against a map while many
+ * of them still wait in buffers
+ */
+TEST_F(BEpsilonTreeTest, RandomTest) {
+  Tree tree("foo_pk", bpm_, *comparator_);
+  EXPECT_TRUE(tree.IsEmpty());
+  std::mt19937 random(15445);
+  std::uniform_int_distribution<int64_t> key_of(1, 30000);
+  std::uniform_int_distribution<int> operation(0, 3);
+  std::map<int64_t, int> expected;
+  GenericKey<8> index_key;
+  for (int i = 0; i < 100000; i++) {
+    int64_t key = key_of(random);
+    index_key.SetFromInteger(key);
+    if (operation(random) == 0) {
+      tree.Remove(index_key);
+      expected.erase(key);
+    } else {
+      tree.Insert(index_key, RID(0, i));
+      expected[key] = i;
+    }
+  }
+  EXPECT_LE(3, tree.GetHeight());
+  EXPECT_LT(0u, tree.GetBufferedCount());
+
+  std::vector<RID> rids;
+  for (int64_t key = 0; key <= 30001; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    auto it = expected.find(key);
+    ASSERT_EQ(it != expected.end(), tree.GetValue(index_key, rids));
+    if (it != expected.end()) {
+      EXPECT_EQ(it->second, rids[0].GetSlotNum());
+    }
+  }
+}
+
+TEST_F(BEpsilonTreeTest, IndexTest) {
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::BIGINT, 8, "b")};
+  Schema schema(columns);
+  IndexMetadata *metadata = new IndexMetadata("foo_b", "foo", &schema, {1},
+                                              IndexType::BEPSILON_TREE);
+  BEpsilonTreeIndex<GenericKey<8>, RID, GenericComparator<8>> index(metadata,
+                                                                    bpm_);
+  Schema *key_schema = index.GetKeySchema();
+  for (int64_t i = 0; i < 1000; i++) {
+    Tuple key({Value(TypeId::BIGINT, i * 7)}, key_schema);
+    index.InsertEntry(key, RID(1, static_cast<uint32_t>(i)));
+  }
+  std::vector<RID> result;
+  for (int64_t i = 0; i < 1000; i++) {
+    result.clear();
+    Tuple key({Value(TypeId::BIGINT, i * 7)}, key_schema);
+    index.ScanKey(key, result);
+    ASSERT_EQ(1u, result.size());
+    EXPECT_EQ(i, result[0].GetSlotNum());
+  }
+  Tuple key({Value(TypeId::BIGINT, static_cast<int64_t>(7))}, key_schema);
+  index.DeleteEntry(key, RID(1, 1));
+  result.clear();
+  index.ScanKey(key, result);
+  EXPECT_TRUE(result.empty());
+}
+
+/*
+ * Random inserts through a small buffer pool write back far fewer pages
+ * than those of a B+ tree
+ */
+TEST_F(BEpsilonTreeTest, WriteBackTest) {
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= 50000; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  GenericKey<8> index_key;
+
+  bpm_->ResetStats();
+  {
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree(
+        "foo_pk", bpm_, *comparator_);
+    for (auto key : keys) {
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, RID(0, key));
+    }
+  }
+  uint64_t plain_writes = bpm_->GetStats().dirty_write_backs;
+
+  bpm_->ResetStats();
+  Tree tree("foo_sk", bpm_, *comparator_);
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key));
+  }
+  uint64_t buffered_writes = bpm_->GetStats().dirty_write_backs;
+  printf("%zu random inserts: B+ tree %lu write-backs, B-epsilon tree %lu\n",
+         keys.size(), static_cast<unsigned long>(plain_writes),
+         static_cast<unsigned long>(buffered_writes));
+  EXPECT_LT(buffered_writes * 2, plain_writes);
+
+  std::vector<RID> rids;
+  for (auto key : keys) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree.GetValue(index_key, rids));
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,191 @@
+/**
+ * b_link_tree_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "index/b_link_tree.h"
+#include "index/b_link_tree_index.h"
+#include "index/b_plus_tree.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+typedef BLinkTree<GenericKey<8>, RID, GenericComparator<8>> Tree;
+
+class BLinkTreeTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    remove("test.db");
+    disk_manager_ = new DiskManager("test.db");
+    bpm_ = new BufferPoolManager(50, disk_manager_);
+    page_id_t header_page_id;
+    bpm_->NewPage(header_page_id);
+    bpm_->UnpinPage(header_page_id, true);
+    key_schema_ = new Schema({Column(TypeId::BIGINT, 8, "a")});
+    comparator_ = new GenericComparator<8>(key_schema_);
+  }
+
+  void TearDown() override {
+    delete comparator_;
+    delete key_schema_;
+    delete bpm_;
+    delete disk_manager_;
+    remove("test.db");
+  }
+
+  // threads insert keys 1 to num_keys, thread i those equal to i modulo
+  // num_threads
+  template <typename T>
+  void ParallelInsert(T &tree, int64_t num_keys, int num_threads) {
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; tid++) {
+      threads.emplace_back([&, tid] {
+        GenericKey<8> index_key;
+        for (int64_t key = 1 + tid; key <= num_keys; key += num_threads) {
+          index_key.SetFromInteger(key);
+          EXPECT_TRUE(tree.Insert(index_key, RID(0, key)));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *bpm_;
+  Schema *key_schema_;
+  GenericComparator<8> *comparator_;
+};
+
+/*
+ * Splits leaves and the root, and removes without merges
+ */
+TEST_F(BLinkTreeTest, SplitTest) {
+  Tree tree("foo_pk", bpm_, *comparator_);
+  EXPECT_TRUE(tree.IsEmpty());
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= 50000; key++) {
+    keys.push_back(key);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  GenericKey<8> index_key;
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.Insert(index_key, RID(0, key)));
+  }
+  index_key.SetFromInteger(1);
+  EXPECT_FALSE(tree.Insert(index_key, RID(1, 1)));
+  EXPECT_LE(2, tree.GetHeight());
+
+  for (int64_t key = 1; key <= 50000; key += 2) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key);
+  }
+  std::vector<RID> rids;
+  for (int64_t key = 0; key <= 50001; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    bool kept = key % 2 == 0 && key > 0 && key <= 50000;
+    ASSERT_EQ(kept, tree.GetValue(index_key, rids));
+    if (kept) {
+      EXPECT_EQ(key, rids[0].GetSlotNum());
+    }
+  }
+}
+
+/*
+ * Inserts of several threads, and lookups meanwhile that land on pages split
+ * behind their back
+ */
+TEST_F(BLinkTreeTest, ConcurrentTest) {
+  Tree tree("foo_pk", bpm_, *comparator_);
+  const int64_t num_keys = 20000;
+  std::thread reader([&] {
+    GenericKey<8> index_key;
+    std::vector<RID> rids;
+    for (int64_t key = num_keys; key > 0; key--) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      if (tree.GetValue(index_key, rids)) {
+        EXPECT_EQ(key, rids[0].GetSlotNum());
+      }
+    }
+  });
+  ParallelInsert(tree, num_keys, 4);
+  reader.join();
+
+  GenericKey<8> index_key;
+  std::vector<RID> rids;
+  for (int64_t key = 1; key <= num_keys; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree.GetValue(index_key, rids));
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+}
+
+TEST_F(BLinkTreeTest, IndexTest) {
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::BIGINT, 8, "b")};
+  Schema schema(columns);
+  IndexMetadata *metadata = new IndexMetadata("foo_b", "foo", &schema, {1},
+                                              IndexType::BLINK_TREE);
+  BLinkTreeIndex<GenericKey<8>, RID, GenericComparator<8>> index(metadata,
+                                                                 bpm_);
+  Schema *key_schema = index.GetKeySchema();
+  for (int64_t i = 0; i < 1000; i++) {
+    Tuple key({Value(TypeId::BIGINT, i * 7)}, key_schema);
+    index.InsertEntry(key, RID(1, static_cast<uint32_t>(i)));
+  }
+  std::vector<RID> result;
+  for (int64_t i = 0; i < 1000; i++) {
+    result.clear();
+    Tuple key({Value(TypeId::BIGINT, i * 7)}, key_schema);
+    index.ScanKey(key, result);
+    ASSERT_EQ(1u, result.size());
+    EXPECT_EQ(i, result[0].GetSlotNum());
+  }
+  Tuple key({Value(TypeId::BIGINT, static_cast<int64_t>(7))}, key_schema);
+  index.DeleteEntry(key, RID(1, 1));
+  result.clear();
+  index.ScanKey(key, result);
+  EXPECT_TRUE(result.empty());
+}
+
+/*
+ * Not a check, reports parallel inserts into both trees
+ */
+TEST_F(BLinkTreeTest, BenchmarkTest) {
+  const int64_t num_keys = 20000;
+  for (int num_threads = 1; num_threads <= 4; num_threads *= 2) {
+    auto start = std::chrono::steady_clock::now();
+    {
+      BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree(
+          "crabbing", bpm_, *comparator_);
+      ParallelInsert(tree, num_keys, num_threads);
+    }
+    auto middle = std::chrono::steady_clock::now();
+    {
+      Tree tree("blink", bpm_, *comparator_);
+      ParallelInsert(tree, num_keys, num_threads);
+    }
+    auto end = std::chrono::steady_clock::now();
+    auto ms = [](std::chrono::steady_clock::duration elapsed) {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed)
+          .count();
+    };
+    printf("%d threads, %ld inserts: B+ tree %ld ms, B-link tree %ld ms\n",
+           num_threads, static_cast<long>(num_keys),
+           static_cast<long>(ms(middle - start)),
+           static_cast<long>(ms(end - middle)));
+  }
+}
+
+} // namespace cmudb
@@ -3,6 +3,7 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdio>
 #include <functional>
@@ -348,4 +349,362 @@ TEST(BPlusTreeConcurrentTest, MixTest) {
   remove("test.log");
 }
 
+// inserts of threads of their own keys, and lookups meanwhile, up to a few
+// levels of splits
+TEST(BPlusTreeConcurrentTest, ScaleTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+  const int num_threads = 4;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= 20000; key++) {
+    keys.push_back(key);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  std::thread reader([&] {
+    GenericKey<8> index_key;
+    std::vector<RID> rids;
+    for (auto key : keys) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      if (tree.GetValue(index_key, rids)) {
+        EXPECT_EQ(key, rids[0].GetSlotNum());
+      }
+    }
+  });
+  LaunchParallelTest(num_threads, InsertHelperSplit, std::ref(tree), keys,
+                     num_threads);
+  reader.join();
+
+  std::vector<RID> rids;
+  GenericKey<8> index_key;
+  for (auto key : keys) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    tree.GetValue(index_key, rids);
+    EXPECT_EQ(1, rids.size());
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// removes going down to merges and a new root, while other keys go in
+TEST(BPlusTreeConcurrentTest, MixScaleTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+  const int num_threads = 4;
+  std::vector<int64_t> keys, remove_keys, more_keys;
+  for (int64_t key = 1; key <= 10000; key++) {
+    keys.push_back(key);
+    if (key % 10 != 0) {
+      remove_keys.push_back(key);
+    }
+    more_keys.push_back(key + 10000);
+  }
+  InsertHelper(tree, keys);
+  std::random_shuffle(remove_keys.begin(), remove_keys.end());
+  std::thread inserter([&] { InsertHelper(tree, more_keys); });
+  LaunchParallelTest(num_threads, DeleteHelperSplit, std::ref(tree),
+                     remove_keys, num_threads);
+  inserter.join();
+
+  std::vector<RID> rids;
+  GenericKey<8> index_key;
+  for (int64_t key = 1; key <= 20000; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    bool kept = key > 10000 || key % 10 == 0;
+    EXPECT_EQ(kept, tree.GetValue(index_key, rids));
+  }
+  // down to an empty tree again
+  std::vector<int64_t> rest;
+  for (int64_t key = 1; key <= 20000; key++) {
+    if (key > 10000 || key % 10 == 0) {
+      rest.push_back(key);
+    }
+  }
+  LaunchParallelTest(num_threads, DeleteHelperSplit, std::ref(tree), rest,
+                     num_threads);
+  EXPECT_TRUE(tree.IsEmpty());
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// scans while leaves split and merge under them, the keys that stay are all
+// seen, once and in order
+TEST(BPlusTreeConcurrentTest, ScanTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+  const int num_threads = 4;
+  std::vector<int64_t> keys, remove_keys, more_keys;
+  for (int64_t key = 1; key <= 10000; key++) {
+    keys.push_back(key);
+    if (key % 10 != 0) {
+      remove_keys.push_back(key);
+    }
+    more_keys.push_back(key + 10000);
+  }
+  InsertHelper(tree, keys);
+  std::random_shuffle(remove_keys.begin(), remove_keys.end());
+  std::vector<std::thread> scanners;
+  for (int i = 0; i < 2; i++) {
+    scanners.emplace_back([&] {
+      for (int round = 0; round < 10; round++) {
+        int64_t last = 0;
+        int64_t kept = 0;
+        for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+          int64_t key = (*iterator).second.GetSlotNum();
+          ASSERT_LT(last, key);
+          if (key <= 10000 && key % 10 == 0) {
+            EXPECT_EQ(kept + 10, key);
+            kept = key;
+          }
+          last = key;
+        }
+        EXPECT_EQ(10000, kept);
+      }
+    });
+  }
+  std::thread inserter([&] { InsertHelper(tree, more_keys); });
+  LaunchParallelTest(num_threads, DeleteHelperSplit, std::ref(tree),
+                     remove_keys, num_threads);
+  inserter.join();
+  for (auto &scanner : scanners) {
+    scanner.join();
+  }
+
+  int64_t count = 0;
+  for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+    count++;
+  }
+  EXPECT_EQ(11000, count);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// the same going down from a key, over the previous-leaf hints
+TEST(BPlusTreeConcurrentTest, ReverseScanTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+  const int num_threads = 4;
+  std::vector<int64_t> keys, remove_keys, more_keys;
+  for (int64_t key = 1; key <= 10000; key++) {
+    keys.push_back(key);
+    if (key % 10 != 0) {
+      remove_keys.push_back(key);
+    }
+    more_keys.push_back(key + 10000);
+  }
+  InsertHelper(tree, keys);
+  std::random_shuffle(remove_keys.begin(), remove_keys.end());
+  std::vector<std::thread> scanners;
+  for (int i = 0; i < 2; i++) {
+    scanners.emplace_back([&] {
+      GenericKey<8> index_key;
+      index_key.SetFromInteger(10000);
+      for (int round = 0; round < 10; round++) {
+        int64_t kept = 10010;
+        for (auto iterator = tree.RBegin(index_key); !iterator.isEnd();
+             ++iterator) {
+          int64_t key = (*iterator).second.GetSlotNum();
+          ASSERT_GT(kept, key);
+          if (key % 10 == 0) {
+            EXPECT_EQ(kept - 10, key);
+            kept = key;
+          }
+        }
+        EXPECT_EQ(10, kept);
+      }
+    });
+  }
+  std::thread inserter([&] { InsertHelper(tree, more_keys); });
+  LaunchParallelTest(num_threads, DeleteHelperSplit, std::ref(tree),
+                     remove_keys, num_threads);
+  inserter.join();
+  for (auto &scanner : scanners) {
+    scanner.join();
+  }
+
+  int64_t count = 0;
+  for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+    count++;
+  }
+  EXPECT_EQ(11000, count);
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// batches of inserts in parallel, and batches of lookups meanwhile
+TEST(BPlusTreeConcurrentTest, BatchTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+  const int num_threads = 4;
+  const int64_t num_keys = 20000;
+  std::vector<GenericKey<8>> keys;
+  GenericKey<8> index_key;
+  for (int64_t key = 1; key <= num_keys; key++) {
+    index_key.SetFromInteger(key);
+    keys.push_back(index_key);
+  }
+  std::thread reader([&] {
+    std::vector<RID> rids;
+    for (int round = 0; round < 5; round++) {
+      rids.clear();
+      tree.GetValues(keys, rids);
+      for (size_t i = 1; i < rids.size(); i++) {
+        EXPECT_LT(rids[i - 1].GetSlotNum(), rids[i].GetSlotNum());
+      }
+    }
+  });
+  LaunchParallelTest(num_threads, [&](uint64_t thread_itr) {
+    // each thread its keys, in batches of 500
+    std::vector<std::pair<GenericKey<8>, RID>> items;
+    GenericKey<8> key;
+    for (int64_t value = 1 + thread_itr; value <= num_keys;
+         value += num_threads) {
+      key.SetFromInteger(value);
+      items.emplace_back(key, RID(0, value));
+      if (items.size() == 500) {
+        EXPECT_EQ(500u, tree.InsertBatch(items));
+        items.clear();
+      }
+    }
+    EXPECT_EQ(items.size(), tree.InsertBatch(items));
+  });
+  reader.join();
+
+  std::vector<RID> rids;
+  EXPECT_EQ(static_cast<size_t>(num_keys), tree.GetValues(keys, rids));
+  for (int64_t key = 1; key <= num_keys; key++) {
+    EXPECT_EQ(key, rids[key - 1].GetSlotNum());
+  }
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// threads add and remove record ids of the same few keys, their posting
+// lists grow over several pages, and lookups meanwhile see them in order
+TEST(BPlusTreeConcurrentTest, NonUniqueTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree(
+      "foo_sk", bpm, comparator, INVALID_PAGE_ID, nullptr, false);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+  const int num_threads = 4;
+  const int num_values = 6000;
+  const int num_keys = 6;
+  std::atomic<bool> done(false);
+  std::thread reader([&] {
+    GenericKey<8> index_key;
+    std::vector<RID> rids;
+    while (!done) {
+      for (int key = 0; key < num_keys; key++) {
+        rids.clear();
+        index_key.SetFromInteger(key);
+        tree.GetValue(index_key, rids);
+        for (size_t i = 1; i < rids.size(); i++) {
+          ASSERT_TRUE(BPlusTreePostingPage::Less(rids[i - 1], rids[i]));
+        }
+      }
+    }
+  });
+  // the record ids of thread t are (t, i), those of odd i removed again
+  LaunchParallelTest(num_threads, [&](uint64_t thread_itr) {
+    GenericKey<8> index_key;
+    Transaction transaction(0);
+    int tid = static_cast<int>(thread_itr);
+    for (int i = 0; i < num_values; i++) {
+      index_key.SetFromInteger(i % num_keys);
+      EXPECT_TRUE(tree.Insert(index_key, RID(tid, i), &transaction));
+    }
+    for (int i = 1; i < num_values; i += 2) {
+      index_key.SetFromInteger(i % num_keys);
+      tree.Remove(index_key, RID(tid, i), &transaction);
+    }
+  });
+  done = true;
+  reader.join();
+
+  GenericKey<8> index_key;
+  std::vector<RID> rids;
+  for (int key = 0; key < num_keys; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    // odd keys have odd record ids only, even keys even ones
+    ASSERT_EQ(key % 2 == 0, tree.GetValue(index_key, rids));
+    if (key % 2 == 0) {
+      ASSERT_EQ(static_cast<size_t>(num_threads * num_values / num_keys),
+                rids.size());
+      EXPECT_EQ(RID(0, key), rids.front());
+      EXPECT_EQ(RID(num_threads - 1, num_values - num_keys + key),
+                rids.back());
+    }
+  }
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
 } // namespace cmudb
@@ -0,0 +1,359 @@
+/**
+ * b_plus_tree_log_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/root_catalog.h"
+#include "index/b_plus_tree.h"
+#include "logging/checkpoint_manager.h"
+#include "logging/log_recovery.h"
+#include "page/header_page.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// small pages, so the tree is a few levels deep and internal pages split
+// and merge too
+static const size_t TEST_PAGE_SIZE = 512;
+
+typedef BPlusTree<GenericKey<8>, RID, GenericComparator<8>> TestTree;
+
+static void CheckTree(TestTree &tree, int num_keys, bool removed) {
+  GenericKey<8> index_key;
+  for (int key = 0; key < num_keys; key++) {
+    std::vector<RID> rids;
+    index_key.SetFromInteger(key);
+    bool expected = !removed || key % 3 == 0;
+    ASSERT_EQ(expected, tree.GetValue(index_key, rids)) << key;
+    if (expected) {
+      EXPECT_EQ(key, rids[0].GetSlotNum());
+    }
+  }
+}
+
+/*
+ * Grow the tree, shrink it again, crash without writing back the pool, and
+ * redo the log onto what is on disk
+ */
+static void CrashAndRedo(size_t num_workers) {
+  remove("test.db");
+  remove("test.log");
+  std::vector<Column> columns = {Column(TypeId::BIGINT, 8, "a")};
+  Schema key_schema(columns);
+  GenericComparator<8> comparator(&key_schema);
+  const int num_keys = 3000;
+
+  ENABLE_LOGGING = true;
+  DiskManager *disk_manager = new DiskManager("test.db", TEST_PAGE_SIZE);
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager, log_manager);
+  page_id_t header_page_id;
+  bpm->NewPage(header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+  bpm->FlushPage(header_page_id);
+
+  TestTree tree("foo_pk", bpm, comparator, INVALID_PAGE_ID, log_manager);
+  Transaction transaction(0);
+  std::vector<int> keys(num_keys);
+  for (int key = 0; key < num_keys; key++) {
+    keys[key] = key;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  GenericKey<8> index_key;
+  for (int key : keys) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.Insert(index_key, RID(0, key), &transaction));
+  }
+  for (int key : keys) {
+    if (key % 3 != 0) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, &transaction);
+    }
+  }
+  CheckTree(tree, num_keys, true);
+  log_manager->WaitForDurable(log_manager->GetNextLSN() - 1);
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  ENABLE_LOGGING = false;
+
+  disk_manager = new DiskManager("test.db", TEST_PAGE_SIZE);
+  bpm = new BufferPoolManager(50, disk_manager);
+  LogRecovery log_recovery(disk_manager, bpm, num_workers);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  auto header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  page_id_t root_page_id;
+  EXPECT_TRUE(header_page->GetRootId("foo_pk", root_page_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  TestTree recovered("foo_pk", bpm, comparator, root_page_id);
+  CheckTree(recovered, num_keys, true);
+
+  // parent page ids must have come back as well, so the tree keeps working
+  for (int key : keys) {
+    if (key % 3 != 0) {
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(recovered.Insert(index_key, RID(0, key)));
+    }
+  }
+  CheckTree(recovered, num_keys, false);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeLogTest, RecoveryTest) { CrashAndRedo(1); }
+
+TEST(BPlusTreeLogTest, ParallelRecoveryTest) { CrashAndRedo(4); }
+
+/*
+ * A tree removed down to nothing and started again is recovered empty and
+ * then with its new root
+ */
+TEST(BPlusTreeLogTest, EmptyTreeTest) {
+  remove("test.db");
+  remove("test.log");
+  std::vector<Column> columns = {Column(TypeId::BIGINT, 8, "a")};
+  Schema key_schema(columns);
+  GenericComparator<8> comparator(&key_schema);
+
+  ENABLE_LOGGING = true;
+  DiskManager *disk_manager = new DiskManager("test.db", TEST_PAGE_SIZE);
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager, log_manager);
+  page_id_t header_page_id;
+  bpm->NewPage(header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+  bpm->FlushPage(header_page_id);
+
+  TestTree tree("foo_pk", bpm, comparator, INVALID_PAGE_ID, log_manager);
+  GenericKey<8> index_key;
+  for (int key = 0; key < 100; key++) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key));
+  }
+  for (int key = 0; key < 100; key++) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key);
+  }
+  EXPECT_TRUE(tree.IsEmpty());
+  index_key.SetFromInteger(7);
+  EXPECT_TRUE(tree.Insert(index_key, RID(0, 7)));
+  log_manager->WaitForDurable(log_manager->GetNextLSN() - 1);
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  ENABLE_LOGGING = false;
+
+  disk_manager = new DiskManager("test.db", TEST_PAGE_SIZE);
+  bpm = new BufferPoolManager(50, disk_manager);
+  LogRecovery log_recovery(disk_manager, bpm);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  auto header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  page_id_t root_page_id;
+  EXPECT_TRUE(header_page->GetRootId("foo_pk", root_page_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  TestTree recovered("foo_pk", bpm, comparator, root_page_id);
+  std::vector<RID> rids;
+  EXPECT_TRUE(recovered.GetValue(index_key, rids));
+  index_key.SetFromInteger(8);
+  EXPECT_FALSE(recovered.GetValue(index_key, rids));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Posting lists started, split over pages, shrunk and dropped come back as
+ * they were
+ */
+TEST(BPlusTreeLogTest, NonUniqueTest) {
+  remove("test.db");
+  remove("test.log");
+  std::vector<Column> columns = {Column(TypeId::BIGINT, 8, "a")};
+  Schema key_schema(columns);
+  GenericComparator<8> comparator(&key_schema);
+
+  ENABLE_LOGGING = true;
+  DiskManager *disk_manager = new DiskManager("test.db", TEST_PAGE_SIZE);
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager, log_manager);
+  page_id_t header_page_id;
+  bpm->NewPage(header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+  bpm->FlushPage(header_page_id);
+
+  TestTree tree("foo_sk", bpm, comparator, INVALID_PAGE_ID, log_manager,
+                false);
+  Transaction transaction(0);
+  // key k has record ids 0 to 10 k, those of odd slots removed again; key
+  // 0 is dropped
+  std::vector<std::pair<int, int>> pairs;
+  for (int key = 0; key < 50; key++) {
+    for (int slot = 0; slot <= 10 * key; slot++) {
+      pairs.emplace_back(key, slot);
+    }
+  }
+  std::shuffle(pairs.begin(), pairs.end(), std::mt19937(15445));
+  GenericKey<8> index_key;
+  for (auto &pair : pairs) {
+    index_key.SetFromInteger(pair.first);
+    EXPECT_TRUE(
+        tree.Insert(index_key, RID(pair.first, pair.second), &transaction));
+  }
+  for (auto &pair : pairs) {
+    if (pair.second % 2 == 1) {
+      index_key.SetFromInteger(pair.first);
+      tree.Remove(index_key, RID(pair.first, pair.second), &transaction);
+    }
+  }
+  index_key.SetFromInteger(0);
+  tree.Remove(index_key, &transaction);
+  log_manager->WaitForDurable(log_manager->GetNextLSN() - 1);
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  ENABLE_LOGGING = false;
+
+  disk_manager = new DiskManager("test.db", TEST_PAGE_SIZE);
+  bpm = new BufferPoolManager(50, disk_manager);
+  LogRecovery log_recovery(disk_manager, bpm);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  auto header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  page_id_t root_page_id;
+  EXPECT_TRUE(header_page->GetRootId("foo_sk", root_page_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  TestTree recovered("foo_sk", bpm, comparator, root_page_id, nullptr, false);
+  std::vector<RID> rids;
+  EXPECT_FALSE(recovered.GetValue(index_key, rids));
+  for (int key = 1; key < 50; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(recovered.GetValue(index_key, rids));
+    ASSERT_EQ(static_cast<size_t>(5 * key + 1), rids.size());
+    for (size_t i = 0; i < rids.size(); i++) {
+      EXPECT_EQ(RID(key, 2 * static_cast<int>(i)), rids[i]);
+    }
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Root changes go to the catalog and reach the header page at a checkpoint;
+ * those after it come back from the log
+ */
+TEST(BPlusTreeLogTest, RootCatalogTest) {
+  remove("test.db");
+  remove("test.log");
+  std::vector<Column> columns = {Column(TypeId::BIGINT, 8, "a")};
+  Schema key_schema(columns);
+  GenericComparator<8> comparator(&key_schema);
+  const int num_keys = 3000;
+
+  ENABLE_LOGGING = true;
+  DiskManager *disk_manager = new DiskManager("test.db", TEST_PAGE_SIZE);
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager, log_manager);
+  page_id_t header_page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(header_page_id));
+  header_page->Init();
+  bpm->UnpinPage(header_page_id, true);
+  bpm->FlushPage(header_page_id);
+
+  RootCatalog root_catalog(bpm, log_manager);
+  TransactionManager txn_manager(nullptr, log_manager);
+  CheckpointManager checkpoint_manager(&txn_manager, log_manager, bpm,
+                                       &root_catalog);
+  TestTree tree("foo_pk", bpm, comparator, INVALID_PAGE_ID, log_manager, true,
+                &root_catalog);
+  Transaction transaction(0);
+  GenericKey<8> index_key;
+  for (int key = 0; key < num_keys / 30; key++) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.Insert(index_key, RID(0, key), &transaction));
+  }
+  uint64_t version;
+  page_id_t root_page_id = root_catalog.GetRoot("foo_pk", &version);
+  EXPECT_NE(INVALID_PAGE_ID, root_page_id);
+  EXPECT_LT(1u, version);
+  EXPECT_NE(INVALID_LSN, root_catalog.GetRecLSN());
+  // not in the header page yet
+  header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  page_id_t header_root_id;
+  EXPECT_FALSE(header_page->GetRootId("foo_pk", header_root_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+
+  EXPECT_NE(INVALID_LSN, checkpoint_manager.Checkpoint());
+  EXPECT_EQ(INVALID_LSN, root_catalog.GetRecLSN());
+  header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  EXPECT_TRUE(header_page->GetRootId("foo_pk", header_root_id));
+  EXPECT_EQ(root_page_id, header_root_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+
+  // the root grows further after the checkpoint, then the pool is lost
+  for (int key = num_keys / 30; key < num_keys; key++) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.Insert(index_key, RID(0, key), &transaction));
+  }
+  uint64_t last_version;
+  root_page_id = root_catalog.GetRoot("foo_pk", &last_version);
+  EXPECT_LT(version, last_version);
+  log_manager->WaitForDurable(log_manager->GetNextLSN() - 1);
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  ENABLE_LOGGING = false;
+
+  disk_manager = new DiskManager("test.db", TEST_PAGE_SIZE);
+  bpm = new BufferPoolManager(50, disk_manager);
+  LogRecovery log_recovery(disk_manager, bpm);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  RootCatalog recovered_catalog(bpm);
+  EXPECT_EQ(root_page_id, recovered_catalog.GetRoot("foo_pk", &version));
+  EXPECT_EQ(0u, version);
+  TestTree recovered("foo_pk", bpm, comparator, root_page_id, nullptr, true,
+                     &recovered_catalog);
+  CheckTree(recovered, num_keys, false);
+  // a swap without logging is only in the catalog until it is flushed
+  for (int key = 0; key < num_keys; key++) {
+    index_key.SetFromInteger(key);
+    recovered.Remove(index_key);
+  }
+  EXPECT_EQ(INVALID_PAGE_ID, recovered_catalog.GetRoot("foo_pk"));
+  header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  EXPECT_TRUE(header_page->GetRootId("foo_pk", header_root_id));
+  EXPECT_EQ(root_page_id, header_root_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  EXPECT_TRUE(recovered_catalog.Flush());
+  header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  EXPECT_TRUE(header_page->GetRootId("foo_pk", header_root_id));
+  EXPECT_EQ(INVALID_PAGE_ID, header_root_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -3,6 +3,7 @@
  */
 
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <iostream>
 #include <sstream>
@@ -390,4 +391,666 @@ TEST(BPlusTreeTests, ScaleTest) {
   remove("test.db");
   remove("test.log");
 }
+
+TEST(BPlusTreeTests, BulkLoadTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(30, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> inserted("foo_sk", bpm,
+                                                               comparator);
+  GenericKey<8> index_key;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  // even keys, the odd ones are inserted afterwards
+  int64_t scale = 100000;
+  std::vector<std::pair<GenericKey<8>, RID>> items;
+  for (int64_t key = 2; key <= scale; key += 2) {
+    index_key.SetFromInteger(key);
+    items.emplace_back(index_key, RID(0, key));
+  }
+  std::swap(items[10], items[11]);
+  EXPECT_FALSE(tree.BulkLoad(items, 0.7, transaction));
+  EXPECT_TRUE(tree.IsEmpty());
+  std::swap(items[10], items[11]);
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(tree.BulkLoad(items, 0.7, transaction));
+  auto middle = std::chrono::steady_clock::now();
+  for (auto &item : items) {
+    inserted.Insert(item.first, item.second, transaction);
+  }
+  auto end = std::chrono::steady_clock::now();
+  auto us = [](std::chrono::steady_clock::duration elapsed) {
+    return static_cast<long>(
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+            .count());
+  };
+  printf("%zu entries: bulk load %ld us, inserts %ld us\n", items.size(),
+         us(middle - start), us(end - middle));
+  EXPECT_FALSE(tree.BulkLoad(items, 0.7, transaction));
+
+  // splits and merges work on the pages loaded
+  for (int64_t key = 1; key <= scale; key += 4) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.Insert(index_key, RID(0, key), transaction));
+  }
+  for (int64_t key = 2; key <= scale; key += 3) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, transaction);
+  }
+  std::vector<RID> rids;
+  for (int64_t key = 1; key <= scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    bool kept = (key % 2 == 0 || key % 4 == 1) && key % 3 != 2;
+    ASSERT_EQ(kept, tree.GetValue(index_key, rids));
+    if (kept) {
+      EXPECT_EQ(key, rids[0].GetSlotNum());
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, BatchTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(30, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  GenericKey<8> index_key;
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  // multiples of 3 up to scale, shuffled, a few of them twice
+  int64_t scale = 30000;
+  std::vector<std::pair<GenericKey<8>, RID>> items;
+  for (int64_t key = 3; key <= scale; key += 3) {
+    index_key.SetFromInteger(key);
+    items.emplace_back(index_key, RID(0, key));
+  }
+  size_t count = items.size();
+  for (int i = 0; i < 10; i++) {
+    items.push_back(items[i * 7]);
+  }
+  std::random_shuffle(items.begin(), items.end());
+  EXPECT_EQ(count, tree.InsertBatch(items));
+  EXPECT_EQ(0u, tree.InsertBatch(items));
+
+  // the keys in between, one batch at a time, into a tree with pages full
+  items.clear();
+  for (int64_t key = 1; key <= scale; key += 3) {
+    index_key.SetFromInteger(key);
+    items.emplace_back(index_key, RID(0, key));
+  }
+  EXPECT_EQ(items.size(), tree.InsertBatch(items));
+
+  std::vector<GenericKey<8>> keys;
+  for (int64_t key = scale + 1; key >= 0; key--) {
+    index_key.SetFromInteger(key);
+    keys.push_back(index_key);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  std::vector<RID> rids;
+  EXPECT_EQ(2 * count, tree.GetValues(keys, rids));
+  ASSERT_EQ(2 * count, rids.size());
+  int64_t last = 0;
+  for (auto &rid : rids) {
+    int64_t key = rid.GetSlotNum();
+    EXPECT_LT(last, key);
+    EXPECT_NE(2, key % 3);
+    last = key;
+  }
+  for (int64_t key = 0; key <= scale + 1; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(key > 0 && key <= scale && key % 3 != 2,
+              tree.GetValue(index_key, rids));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, IteratorTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(200, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  GenericKey<8> index_key;
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+  EXPECT_TRUE(tree.Begin().isEnd());
+
+  // far more leaves than the pool holds
+  int64_t scale = 100000;
+  std::vector<std::pair<GenericKey<8>, RID>> items;
+  for (int64_t key = 2; key <= 2 * scale; key += 2) {
+    index_key.SetFromInteger(key);
+    items.emplace_back(index_key, RID(0, key));
+  }
+  EXPECT_TRUE(tree.BulkLoad(items));
+
+  for (int read_ahead : {0, INDEX_READ_AHEAD}) {
+    bpm->ResetStats();
+    auto start = std::chrono::steady_clock::now();
+    int64_t expected = 2;
+    for (auto iterator = tree.Begin(read_ahead); !iterator.isEnd();
+         ++iterator) {
+      ASSERT_EQ(expected, (*iterator).second.GetSlotNum());
+      expected += 2;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    EXPECT_EQ(2 * scale + 2, expected);
+    bpm->WaitForPrefetch();
+    BufferPoolStats stats = bpm->GetStats();
+    printf("read ahead %d: %ld us, %lu misses, %lu prefetches\n", read_ahead,
+           static_cast<long>(elapsed), static_cast<unsigned long>(stats.misses),
+           static_cast<unsigned long>(stats.prefetches));
+  }
+  // the first leaves are evicted by now, those after the first come in
+  for (int read_ahead : {0, INDEX_READ_AHEAD}) {
+    bpm->ResetStats();
+    auto iterator = tree.Begin(read_ahead);
+    bpm->WaitForPrefetch();
+    EXPECT_EQ(read_ahead, static_cast<int>(bpm->GetStats().prefetches));
+  }
+
+  // from a key between two, and past the last one
+  index_key.SetFromInteger(2 * scale - 5);
+  auto iterator = tree.Begin(index_key);
+  EXPECT_EQ(2 * scale - 4, (*iterator).second.GetSlotNum());
+  ++iterator;
+  ++iterator;
+  EXPECT_EQ(2 * scale, (*iterator).second.GetSlotNum());
+  ++iterator;
+  EXPECT_TRUE(iterator.isEnd());
+  index_key.SetFromInteger(2 * scale + 1);
+  EXPECT_TRUE(tree.Begin(index_key).isEnd());
+
+  // the iterators left no page pinned
+  std::vector<page_id_t> page_ids(199);
+  for (auto &new_page_id : page_ids) {
+    EXPECT_NE(nullptr, bpm->NewPage(new_page_id));
+  }
+  for (auto new_page_id : page_ids) {
+    bpm->UnpinPage(new_page_id, false);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, ReverseIteratorTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> loaded("foo_sk", bpm,
+                                                             comparator);
+  GenericKey<8> index_key;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+  EXPECT_TRUE(tree.RBegin().isEnd());
+
+  // splits, then merges and redistributions
+  int64_t scale = 20000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale; key++) {
+    keys.push_back(key);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key), transaction);
+  }
+  for (auto key : keys) {
+    if (key % 3 != 0) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+    }
+  }
+  std::vector<std::pair<GenericKey<8>, RID>> items;
+  for (int64_t key = 3; key <= scale; key += 3) {
+    index_key.SetFromInteger(key);
+    items.emplace_back(index_key, RID(0, key));
+  }
+  EXPECT_TRUE(loaded.BulkLoad(items));
+
+  for (auto *each : {&tree, &loaded}) {
+    // every leaf links back to the one before
+    page_id_t prev_id = INVALID_PAGE_ID;
+    page_id_t leaf_id = each->FindLeafPage(index_key, true)->GetPageId();
+    bpm->UnpinPage(leaf_id, false);
+    while (leaf_id != INVALID_PAGE_ID) {
+      auto leaf = reinterpret_cast<BPlusTreeLeafPage<GenericKey<8>, RID,
+                                                     GenericComparator<8>> *>(
+          bpm->FetchPage(leaf_id)->GetData());
+      EXPECT_EQ(prev_id, leaf->GetPrevPageId());
+      prev_id = leaf_id;
+      leaf_id = leaf->GetNextPageId();
+      bpm->UnpinPage(prev_id, false);
+    }
+
+    int64_t expected = scale / 3 * 3;
+    for (auto iterator = each->RBegin(); !iterator.isEnd(); ++iterator) {
+      ASSERT_EQ(expected, (*iterator).second.GetSlotNum());
+      expected -= 3;
+    }
+    EXPECT_EQ(0, expected);
+
+    // from a key not there, down to the first
+    index_key.SetFromInteger(scale / 2 + 1);
+    expected = (scale / 2 + 1) / 3 * 3;
+    for (auto iterator = each->RBegin(index_key); !iterator.isEnd();
+         ++iterator) {
+      ASSERT_EQ(expected, (*iterator).second.GetSlotNum());
+      expected -= 3;
+    }
+    EXPECT_EQ(0, expected);
+    index_key.SetFromInteger(300);
+    EXPECT_EQ(300, (*each->RBegin(index_key)).second.GetSlotNum());
+    index_key.SetFromInteger(2);
+    EXPECT_TRUE(each->RBegin(index_key).isEnd());
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, NonUniqueTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree(
+      "foo_sk", bpm, comparator, INVALID_PAGE_ID, nullptr, false);
+  GenericKey<8> index_key;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  // key k has k % 4 + 1 record ids, key 0 enough for several pages
+  std::vector<std::pair<int64_t, RID>> pairs;
+  for (int64_t key = 1; key <= 2000; key++) {
+    for (int r = 0; r <= key % 4; r++) {
+      pairs.emplace_back(key, RID(r, key));
+    }
+  }
+  for (int r = 0; r < 3000; r++) {
+    pairs.emplace_back(0, RID(r / 100, r % 100));
+  }
+  std::random_shuffle(pairs.begin(), pairs.end());
+  for (auto &pair : pairs) {
+    index_key.SetFromInteger(pair.first);
+    EXPECT_TRUE(tree.Insert(index_key, pair.second, transaction));
+  }
+  index_key.SetFromInteger(0);
+  EXPECT_FALSE(tree.Insert(index_key, RID(5, 5), transaction));
+  std::vector<RID> rids;
+  EXPECT_TRUE(tree.GetValue(index_key, rids));
+  ASSERT_EQ(3000u, rids.size());
+  for (int r = 0; r < 3000; r++) {
+    EXPECT_EQ(RID(r / 100, r % 100), rids[r]);
+  }
+
+  // every pair, in key and then record id order: key 0 first, then the
+  // record ids of key k have k as slot
+  size_t count = 0;
+  RID last_rid;
+  for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+    RID rid = (*iterator).second;
+    if (count < 3000) {
+      ASSERT_EQ(RID(count / 100, count % 100), rid);
+    } else if (count > 3000) {
+      ASSERT_LE(last_rid.GetSlotNum(), rid.GetSlotNum());
+      if (last_rid.GetSlotNum() == rid.GetSlotNum()) {
+        ASSERT_EQ(last_rid.GetPageId() + 1, rid.GetPageId());
+      }
+    }
+    last_rid = rid;
+    count++;
+  }
+  EXPECT_EQ(pairs.size(), count);
+  count = 0;
+  for (auto iterator = tree.RBegin(); !iterator.isEnd(); ++iterator) {
+    count++;
+  }
+  EXPECT_EQ(pairs.size(), count);
+
+  // values removed one at a time, the last one takes the key with it
+  for (int r = 0; r < 3000; r++) {
+    if (r % 3 != 0) {
+      tree.Remove(index_key, RID(r / 100, r % 100), transaction);
+    }
+  }
+  rids.clear();
+  EXPECT_TRUE(tree.GetValue(index_key, rids));
+  ASSERT_EQ(1000u, rids.size());
+  EXPECT_EQ(RID(29, 97), rids.back());
+  index_key.SetFromInteger(7);
+  tree.Remove(index_key, RID(9, 9), transaction);
+  for (int64_t key = 1; key <= 2000; key++) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, RID(0, key), transaction);
+  }
+  for (int64_t key = 1; key <= 2000; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_EQ(key % 4 != 0, tree.GetValue(index_key, rids));
+    ASSERT_EQ(static_cast<size_t>(key % 4), rids.size());
+    for (size_t i = 0; i < rids.size(); i++) {
+      EXPECT_EQ(RID(static_cast<int>(i) + 1, key), rids[i]);
+    }
+  }
+  index_key.SetFromInteger(0);
+  tree.Remove(index_key, transaction);
+  rids.clear();
+  EXPECT_FALSE(tree.GetValue(index_key, rids));
+
+  // no page left pinned
+  std::vector<page_id_t> page_ids(49);
+  for (auto &new_page_id : page_ids) {
+    EXPECT_NE(nullptr, bpm->NewPage(new_page_id));
+  }
+  for (auto new_page_id : page_ids) {
+    bpm->UnpinPage(new_page_id, false);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Below the merge fill factor pages merge: with the default a tree thinned
+ * out gives pages back, with 0 its leaves stay until they are empty
+ */
+TEST(BPlusTreeTests, MergeFillFactorTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> eager("foo_pk", bpm,
+                                                            comparator);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> lazy("foo_sk", bpm,
+                                                           comparator);
+  lazy.SetMergeFillFactor(0);
+  GenericKey<8> index_key;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  const int64_t scale = 20000;
+  for (int64_t key = 1; key <= scale; key++) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(eager.Insert(index_key, RID(0, key), transaction));
+    EXPECT_TRUE(lazy.Insert(index_key, RID(0, key), transaction));
+  }
+  auto thin_out = [&](BPlusTree<GenericKey<8>, RID, GenericComparator<8>>
+                          &tree) {
+    size_t free_pages = disk_manager->GetFreePageCount();
+    for (int64_t key = 1; key <= scale; key++) {
+      if (key % 50 != 0) {
+        index_key.SetFromInteger(key);
+        tree.Remove(index_key, transaction);
+      }
+    }
+    bpm->FlushAllPages();
+    return disk_manager->GetFreePageCount() - free_pages;
+  };
+  EXPECT_EQ(0u, thin_out(lazy));
+  EXPECT_LT(0u, thin_out(eager));
+
+  // around the boundary of a leaf nothing merges or splits again
+  size_t free_pages = disk_manager->GetFreePageCount();
+  for (int round = 0; round < 100; round++) {
+    for (int64_t key = 101; key < 150; key++) {
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(lazy.Insert(index_key, RID(0, key), transaction));
+    }
+    for (int64_t key = 101; key < 150; key++) {
+      index_key.SetFromInteger(key);
+      lazy.Remove(index_key, transaction);
+    }
+  }
+  bpm->FlushAllPages();
+  EXPECT_EQ(free_pages, disk_manager->GetFreePageCount());
+
+  std::vector<RID> rids;
+  for (int64_t key = 1; key <= scale; key++) {
+    index_key.SetFromInteger(key);
+    rids.clear();
+    ASSERT_EQ(key % 50 == 0, lazy.GetValue(index_key, rids));
+    rids.clear();
+    ASSERT_EQ(key % 50 == 0, eager.GetValue(index_key, rids));
+  }
+  for (int64_t key = 50; key <= scale; key += 50) {
+    index_key.SetFromInteger(key);
+    lazy.Remove(index_key, transaction);
+  }
+  EXPECT_TRUE(lazy.IsEmpty());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, KeyCompressionTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> plain("foo_pk", bpm,
+                                                            comparator);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> compressed(
+      "foo_sk", bpm, comparator);
+  compressed.SetKeyCompression(true);
+  GenericKey<8> index_key;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  const int64_t scale = 20000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale; key++) {
+    keys.push_back(key);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  // the pages a tree takes are those it frees when emptied
+  auto fill = [&](BPlusTree<GenericKey<8>, RID, GenericComparator<8>> &tree) {
+    for (auto key : keys) {
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(tree.Insert(index_key, RID(0, key), transaction));
+    }
+  };
+  auto empty = [&](BPlusTree<GenericKey<8>, RID, GenericComparator<8>> &tree) {
+    size_t free_pages = disk_manager->GetFreePageCount();
+    for (auto key : keys) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+    }
+    EXPECT_TRUE(tree.IsEmpty());
+    bpm->FlushAllPages();
+    return disk_manager->GetFreePageCount() - free_pages;
+  };
+  fill(plain);
+  size_t plain_pages = empty(plain);
+  fill(compressed);
+
+  std::vector<RID> rids;
+  for (int64_t key = 0; key <= scale + 1; key++) {
+    index_key.SetFromInteger(key);
+    rids.clear();
+    bool found = key > 0 && key <= scale;
+    ASSERT_EQ(found, compressed.GetValue(index_key, rids));
+    if (found) {
+      EXPECT_EQ(key, rids[0].GetSlotNum());
+    }
+  }
+  int64_t current_key = 1;
+  for (auto iterator = compressed.Begin(); iterator.isEnd() == false;
+       ++iterator) {
+    EXPECT_EQ(current_key, (*iterator).second.GetSlotNum());
+    current_key++;
+  }
+  EXPECT_EQ(scale + 1, current_key);
+  current_key = scale;
+  for (auto iterator = compressed.RBegin(); iterator.isEnd() == false;
+       ++iterator) {
+    EXPECT_EQ(current_key, (*iterator).second.GetSlotNum());
+    current_key--;
+  }
+  EXPECT_EQ(0, current_key);
+
+  std::random_shuffle(keys.begin(), keys.end());
+  EXPECT_GT(plain_pages, empty(compressed));
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Stats read from every leaf are exact, from a sample of them close, and
+ * a tree thinned out without merges shows as mostly empty
+ */
+TEST(BPlusTreeTests, StatsTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  tree.SetMergeFillFactor(0);
+  GenericKey<8> index_key;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  EXPECT_EQ(0, tree.GetStats().height);
+  const int64_t scale = 20000;
+  for (int64_t key = 1; key <= scale; key++) {
+    index_key.SetFromInteger(key * 7919 % scale);
+    EXPECT_TRUE(tree.Insert(index_key, RID(0, key), transaction));
+  }
+
+  size_t leaves = 0;
+  index_key.SetFromInteger(0);
+  auto leaf = tree.FindLeafPage(index_key, true);
+  while (true) {
+    leaves++;
+    page_id = leaf->GetNextPageId();
+    bpm->UnpinPage(leaf->GetPageId(), false);
+    if (page_id == INVALID_PAGE_ID)
+      break;
+    leaf = reinterpret_cast<
+        BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>> *>(
+        bpm->FetchPage(page_id)->GetData());
+  }
+  auto exact = tree.GetStats(scale);
+  EXPECT_EQ(static_cast<size_t>(scale), exact.key_count);
+  EXPECT_EQ(leaves, exact.leaf_pages);
+  EXPECT_LT(0u, exact.internal_pages);
+  EXPECT_LT(1, exact.height);
+  EXPECT_GT(exact.fill_factor, 0.4);
+  EXPECT_LE(exact.fill_factor, 1.0);
+
+  auto sampled = tree.GetStats();
+  EXPECT_EQ(exact.height, sampled.height);
+  EXPECT_NEAR(scale, sampled.key_count, scale / 10);
+  EXPECT_NEAR(leaves, sampled.leaf_pages, leaves / 10);
+  EXPECT_NEAR(exact.fill_factor, sampled.fill_factor, 0.1);
+  ASSERT_EQ(static_cast<size_t>(BTREE_STATS_BUCKETS),
+            sampled.histogram.size());
+  size_t keys = 0;
+  for (size_t i = 0; i < sampled.histogram.size(); i++) {
+    if (i > 0) {
+      EXPECT_LT(0, comparator(sampled.histogram[i].first,
+                              sampled.histogram[i - 1].first));
+    }
+    EXPECT_NEAR(scale / BTREE_STATS_BUCKETS, sampled.histogram[i].second,
+                scale / BTREE_STATS_BUCKETS / 2);
+    keys += sampled.histogram[i].second;
+  }
+  EXPECT_NEAR(sampled.key_count, keys, BTREE_STATS_BUCKETS);
+
+  for (int64_t key = 0; key < scale; key++) {
+    if (key % 10 != 0) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+    }
+  }
+  auto thinned = tree.GetStats(scale);
+  EXPECT_EQ(static_cast<size_t>(scale / 10), thinned.key_count);
+  EXPECT_EQ(leaves, thinned.leaf_pages);
+  EXPECT_LT(thinned.fill_factor, 0.2);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
 } // namespace cmudb
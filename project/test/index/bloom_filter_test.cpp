@@ -0,0 +1,157 @@
+/**
+ * bloom_filter_test.cpp
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "index/b_plus_tree_index.h"
+#include "index/bloom_filter.h"
+#include "page/header_page.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+class BloomFilterTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    remove("test.db");
+    disk_manager_ = new DiskManager("test.db");
+    bpm_ = new BufferPoolManager(50, disk_manager_);
+    page_id_t header_page_id;
+    bpm_->NewPage(header_page_id);
+    bpm_->UnpinPage(header_page_id, true);
+    schema_ = ParseCreateStatement("a bigint, b varchar(20)");
+  }
+
+  void TearDown() override {
+    delete schema_;
+    delete bpm_;
+    delete disk_manager_;
+    remove("test.db");
+  }
+
+  Index *Open() {
+    IndexMetadata *metadata =
+        new IndexMetadata("foo_a", "foo", schema_, {0},
+                          IndexType::BPLUS_TREE, true, true);
+    HeaderPage *header_page =
+        static_cast<HeaderPage *>(bpm_->FetchPage(HEADER_PAGE_ID));
+    page_id_t root_id = INVALID_PAGE_ID;
+    header_page->GetRootId("foo_a", root_id);
+    bpm_->UnpinPage(HEADER_PAGE_ID, false);
+    return new BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>(
+        metadata, bpm_, root_id);
+  }
+
+  Tuple Key(Index *index, int64_t key) {
+    return Tuple({Value(TypeId::BIGINT, key)}, index->GetKeySchema());
+  }
+
+  // page fetches of lookups of count absent keys
+  uint64_t AbsentFetches(Index *index, int64_t count) {
+    bpm_->ResetStats();
+    std::vector<RID> result;
+    for (int64_t i = 0; i < count; i++) {
+      index->ScanKey(Key(index, -1 - i), result);
+    }
+    EXPECT_TRUE(result.empty());
+    BufferPoolStats stats = bpm_->GetStats();
+    return stats.hits + stats.misses;
+  }
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *bpm_;
+  Schema *schema_;
+};
+
+TEST_F(BloomFilterTest, FalsePositiveTest) {
+  BloomFilter filter("foo_a", bpm_, false);
+  for (int i = 0; i < 10000; i++) {
+    std::string key = "key " + std::to_string(i);
+    filter.Add(key.data(), key.size());
+  }
+  int false_positives = 0;
+  for (int i = 0; i < 10000; i++) {
+    std::string key = "key " + std::to_string(i);
+    ASSERT_TRUE(filter.MayContain(key.data(), key.size()));
+    key = "other " + std::to_string(i);
+    false_positives += filter.MayContain(key.data(), key.size()) ? 1 : 0;
+  }
+  // sized for a page of them, rebuilt once twice as many
+  EXPECT_TRUE(filter.NeedsRebuild());
+  printf("%d false positives out of 10000\n", false_positives);
+
+  filter.RebuildIfNeeded([](const BloomFilter::KeySink &sink) {
+    for (int i = 0; i < 10000; i++) {
+      std::string key = "key " + std::to_string(i);
+      sink(key.data(), key.size());
+    }
+  });
+  EXPECT_FALSE(filter.NeedsRebuild());
+  EXPECT_EQ(10000u, filter.GetKeyCount());
+  false_positives = 0;
+  for (int i = 0; i < 10000; i++) {
+    std::string key = "key " + std::to_string(i);
+    ASSERT_TRUE(filter.MayContain(key.data(), key.size()));
+    key = "other " + std::to_string(i);
+    false_positives += filter.MayContain(key.data(), key.size()) ? 1 : 0;
+  }
+  printf("%d false positives out of 10000 after a rebuild\n",
+         false_positives);
+  EXPECT_LT(false_positives, 300);
+
+  // not closed yet, a second open sees it as after a crash
+  BloomFilter reopened("foo_a", bpm_, false);
+  EXPECT_TRUE(reopened.NeedsRebuild());
+}
+
+/*
+ * Absent keys are not looked up in the tree, the filter is rebuilt after
+ * removes and is there again when the index is opened again
+ */
+TEST_F(BloomFilterTest, IndexTest) {
+  Index *index = Open();
+  for (int64_t i = 0; i < 5000; i++) {
+    index->InsertEntry(Key(index, i), RID(0, i));
+  }
+  uint64_t fetches = AbsentFetches(index, 1000);
+  printf("1000 absent lookups: %lu page fetches\n",
+         static_cast<unsigned long>(fetches));
+  // the filter page, and the tree for the few false positives
+  EXPECT_LT(fetches, 1300u);
+
+  for (int64_t i = 0; i < 5000; i += 2) {
+    index->DeleteEntry(Key(index, i), RID(0, i));
+  }
+  std::vector<RID> result;
+  for (int64_t i = 0; i < 5000; i++) {
+    result.clear();
+    index->ScanKey(Key(index, i), result);
+    ASSERT_EQ(i % 2 == 1 ? 1u : 0u, result.size());
+  }
+  delete index;
+
+  index = Open();
+  EXPECT_LT(AbsentFetches(index, 1000), 1300u);
+  for (int64_t i = 0; i < 5000; i++) {
+    result.clear();
+    index->ScanKey(Key(index, i), result);
+    ASSERT_EQ(i % 2 == 1 ? 1u : 0u, result.size());
+  }
+  // inserts after the reopen are in it too
+  for (int64_t i = 5000; i < 6000; i++) {
+    index->InsertEntry(Key(index, i), RID(0, i));
+  }
+  for (int64_t i = 5000; i < 6000; i++) {
+    result.clear();
+    index->ScanKey(Key(index, i), result);
+    ASSERT_EQ(1u, result.size());
+  }
+  delete index;
+}
+
+} // namespace cmudb
@@ -0,0 +1,180 @@
+/**
+ * covering_index_test.cpp
+ */
+
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "index/covering_index.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+class CoveringIndexTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    remove("test.db");
+    disk_manager_ = new DiskManager("test.db");
+    bpm_ = new BufferPoolManager(50, disk_manager_);
+    page_id_t header_page_id;
+    bpm_->NewPage(header_page_id);
+    bpm_->UnpinPage(header_page_id, true);
+    schema_ = ParseCreateStatement("a bigint, b varchar(20), c integer, d "
+                                   "varchar(100)");
+  }
+
+  void TearDown() override {
+    delete schema_;
+    delete bpm_;
+    delete disk_manager_;
+    remove("test.db");
+  }
+
+  // the entry of row i, key a and included b and c
+  Tuple Entry(Index *index, int64_t i, const std::string &b) {
+    return Tuple({Value(TypeId::BIGINT, i), Value(TypeId::VARCHAR, b),
+                  Value(TypeId::INTEGER, static_cast<int32_t>(i * 3))},
+                 index->GetMetadata()->GetCoveringSchema());
+  }
+
+  Tuple Key(Index *index, int64_t i) {
+    return Tuple({Value(TypeId::BIGINT, i)}, index->GetKeySchema());
+  }
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *bpm_;
+  Schema *schema_;
+};
+
+TEST_F(CoveringIndexTest, ParseTest) {
+  std::string sql = "foo_a a include b, c";
+  IndexMetadata *metadata = ParseIndexStatement(sql, "foo", schema_);
+  EXPECT_EQ(std::vector<int>({0}), metadata->GetKeyAttrs());
+  EXPECT_EQ(std::vector<int>({1, 2}), metadata->GetIncludeAttrs());
+  EXPECT_EQ(3, metadata->GetCoveringSchema()->GetColumnCount());
+  EXPECT_EQ(0, metadata->GetCoveringColumn(0));
+  EXPECT_EQ(2, metadata->GetCoveringColumn(2));
+  EXPECT_EQ(-1, metadata->GetCoveringColumn(3));
+  delete metadata;
+
+  sql = "foo_a a include b using hash";
+  EXPECT_THROW(ParseIndexStatement(sql, "foo", schema_), Exception);
+  sql = "foo_a a include b non unique";
+  EXPECT_THROW(ParseIndexStatement(sql, "foo", schema_), Exception);
+  // at most 64 bytes of key and included columns
+  Schema *wide = ParseCreateStatement("a bigint, b varchar(100), c bigint, d "
+                                      "bigint, e bigint, f bigint, g bigint");
+  sql = "foo_a a include b, c, d, e, f, g";
+  metadata = ParseIndexStatement(sql, "foo", wide);
+  EXPECT_THROW(ConstructIndex(metadata, bpm_, INVALID_PAGE_ID), Exception);
+  delete metadata;
+  delete wide;
+}
+
+/*
+ * Lookups get the included columns from the entries, kept up to date by
+ * delete and insert as an update does them
+ */
+TEST_F(CoveringIndexTest, ScanCoveringTest) {
+  std::string sql = "foo_a a include b, c";
+  Index *index =
+      ConstructIndex(ParseIndexStatement(sql, "foo", schema_), bpm_,
+                     INVALID_PAGE_ID);
+  Schema *covering_schema = index->GetMetadata()->GetCoveringSchema();
+  for (int64_t i = 0; i < 3000; i++) {
+    index->InsertEntry(Entry(index, i, "row " + std::to_string(i)),
+                       RID(0, i));
+  }
+  // the key is unique, whatever the included columns
+  index->InsertEntry(Entry(index, 7, "again"), RID(1, 7));
+
+  std::vector<RID> result;
+  std::vector<Tuple> rows;
+  for (int64_t i = 0; i < 3000; i++) {
+    result.clear();
+    rows.clear();
+    index->ScanCovering(Key(index, i), result, rows);
+    ASSERT_EQ(1u, result.size());
+    ASSERT_EQ(1u, rows.size());
+    EXPECT_EQ(i, result[0].GetSlotNum());
+    EXPECT_EQ(i, rows[0].GetValue(covering_schema, 0).GetAs<int64_t>());
+    EXPECT_EQ("row " + std::to_string(i),
+              rows[0].GetValue(covering_schema, 1).ToString());
+    EXPECT_EQ(i * 3, rows[0].GetValue(covering_schema, 2).GetAs<int32_t>());
+    result.clear();
+    index->ScanKey(Key(index, i), result);
+    ASSERT_EQ(1u, result.size());
+  }
+
+  index->DeleteEntry(Key(index, 10), RID(0, 10));
+  index->InsertEntry(Entry(index, 10, "updated"), RID(0, 10));
+  index->DeleteEntry(Key(index, 11), RID(0, 11));
+  result.clear();
+  rows.clear();
+  index->ScanCovering(Key(index, 10), result, rows);
+  ASSERT_EQ(1u, rows.size());
+  EXPECT_EQ("updated", rows[0].GetValue(covering_schema, 1).ToString());
+  result.clear();
+  rows.clear();
+  index->ScanCovering(Key(index, 11), result, rows);
+  EXPECT_TRUE(rows.empty());
+
+  // included columns too long for the key do not go in
+  EXPECT_THROW(index->InsertEntry(Entry(index, 5000, std::string(40, 'x')),
+                                  RID(0, 5000)),
+               Exception);
+  delete index;
+}
+
+/*
+ * Ranges of keys, of a B+ tree index with and without included columns
+ */
+TEST_F(CoveringIndexTest, ScanRangeTest) {
+  for (std::string sql : {"foo_a a", "foo_a a include b, c"}) {
+    Index *index = ConstructIndex(ParseIndexStatement(sql, "foo", schema_),
+                                  bpm_, INVALID_PAGE_ID);
+    // every other key
+    for (int64_t i = 0; i < 3000; i += 2) {
+      if (index->GetMetadata()->GetCoveringSchema() != nullptr)
+        index->InsertEntry(Entry(index, i, "row"), RID(0, i));
+      else
+        index->InsertEntry(Key(index, i), RID(0, i));
+    }
+    std::vector<RID> result;
+    index->ScanRange(Key(index, 101), Key(index, 200), result);
+    ASSERT_EQ(50u, result.size());
+    for (size_t i = 0; i < result.size(); i++)
+      EXPECT_EQ(102 + 2 * static_cast<int64_t>(i), result[i].GetSlotNum());
+    result.clear();
+    index->ScanRange(Key(index, 2998), Key(index, 5000), result);
+    EXPECT_EQ(1u, result.size());
+    result.clear();
+    index->ScanRange(Key(index, 10), Key(index, 5), result);
+    EXPECT_TRUE(result.empty());
+
+    // the same a batch at a time
+    IndexScanPosition position;
+    index->StartRange(Key(index, 101), Key(index, 2000), position);
+    while (!position.done)
+      index->ScanOrdered(false, 7, position, result);
+    ASSERT_EQ(950u, result.size());
+    for (size_t i = 0; i < result.size(); i++)
+      EXPECT_EQ(102 + 2 * static_cast<int64_t>(i), result[i].GetSlotNum());
+    delete index;
+  }
+
+  std::string sql = "foo_a a using hash";
+  Index *index = ConstructIndex(ParseIndexStatement(sql, "foo", schema_), bpm_,
+                                INVALID_PAGE_ID);
+  std::vector<RID> result;
+  EXPECT_THROW(index->ScanRange(Key(index, 0), Key(index, 1), result),
+               Exception);
+  IndexScanPosition position;
+  EXPECT_THROW(index->StartRange(Key(index, 0), Key(index, 1), position),
+               Exception);
+  delete index;
+}
+
+} // namespace cmudb
@@ -0,0 +1,143 @@
+/**
+ * extendible_hash_table_test.cpp
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "index/extendible_hash_table.h"
+#include "index/hash_index.h"
+#include "page/header_page.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ExtendibleHashTableTest, SplitMergeTest) {
+  std::vector<Column> columns = {Column(TypeId::BIGINT, 8, "a")};
+  Schema key_schema(columns);
+  GenericComparator<8> comparator(&key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  // create and fetch header_page
+  page_id_t header_page_id;
+  bpm->NewPage(header_page_id);
+
+  page_id_t directory_page_id;
+  const int64_t scale = 10000;
+  {
+    ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> table(
+        "foo_pk", bpm, comparator);
+    EXPECT_TRUE(table.IsEmpty());
+    GenericKey<8> index_key;
+    for (int64_t key = 0; key < scale; key++) {
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(table.Insert(index_key, RID(0, static_cast<uint32_t>(key))));
+    }
+    // unique keys only
+    index_key.SetFromInteger(0);
+    EXPECT_FALSE(table.Insert(index_key, RID(1, 1)));
+    // 10000 entries do not fit in a few buckets
+    EXPECT_LT(2u, table.GetGlobalDepth());
+    directory_page_id = table.GetDirectoryPageId();
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+  }
+
+  // reopen from the page the header records
+  HeaderPage *header_page =
+      static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  page_id_t recorded_id;
+  EXPECT_TRUE(header_page->GetRootId("foo_pk", recorded_id));
+  EXPECT_EQ(directory_page_id, recorded_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+
+  ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_pk", bpm, comparator, directory_page_id);
+  GenericKey<8> index_key;
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.GetValue(index_key, rids));
+    ASSERT_EQ(1u, rids.size());
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+  index_key.SetFromInteger(scale);
+  EXPECT_FALSE(table.GetValue(index_key, rids));
+
+  for (int64_t key = 0; key < scale; key += 2) {
+    index_key.SetFromInteger(key);
+    table.Remove(index_key);
+  }
+  for (int64_t key = 0; key < scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(key % 2 == 1, table.GetValue(index_key, rids));
+  }
+
+  // emptied buckets merge back and the directory shrinks with them
+  for (int64_t key = 1; key < scale; key += 2) {
+    index_key.SetFromInteger(key);
+    table.Remove(index_key);
+  }
+  EXPECT_EQ(0u, table.GetGlobalDepth());
+  index_key.SetFromInteger(1);
+  EXPECT_FALSE(table.GetValue(index_key, rids));
+  EXPECT_TRUE(table.Insert(index_key, RID(0, 1)));
+  EXPECT_TRUE(table.GetValue(index_key, rids));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(ExtendibleHashTableTest, HashIndexTest) {
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::BIGINT, 8, "b")};
+  Schema schema(columns);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t header_page_id;
+  bpm->NewPage(header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  IndexMetadata *metadata = new IndexMetadata("foo_b", "foo", &schema, {1},
+                                              IndexType::HASH);
+  EXPECT_EQ(IndexType::HASH, metadata->GetIndexType());
+  HashIndex<GenericKey<8>, RID, GenericComparator<8>> index(metadata, bpm);
+
+  Schema *key_schema = index.GetKeySchema();
+  for (int64_t i = 0; i < 1000; i++) {
+    Tuple key({Value(TypeId::BIGINT, i * 7)}, key_schema);
+    index.InsertEntry(key, RID(1, static_cast<uint32_t>(i)));
+  }
+  std::vector<RID> result;
+  for (int64_t i = 0; i < 1000; i++) {
+    result.clear();
+    Tuple key({Value(TypeId::BIGINT, i * 7)}, key_schema);
+    index.ScanKey(key, result);
+    ASSERT_EQ(1u, result.size());
+    EXPECT_EQ(i, result[0].GetSlotNum());
+  }
+  Tuple key({Value(TypeId::BIGINT, static_cast<int64_t>(7))}, key_schema);
+  // a key already there keeps its entry, only one that finds no room throws
+  EXPECT_NO_THROW(index.InsertEntry(key, RID(2, 2)));
+  result.clear();
+  index.ScanKey(key, result);
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ(RID(1, 1), result[0]);
+  index.DeleteEntry(key, RID(1, 1));
+  result.clear();
+  index.ScanKey(key, result);
+  EXPECT_TRUE(result.empty());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
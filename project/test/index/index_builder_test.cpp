@@ -0,0 +1,201 @@
+/**
+ * index_builder_test.cpp
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "index/b_plus_tree_index.h"
+#include "index/external_sort.h"
+#include "index/index_builder.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+class IndexBuilderTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    remove("test.db");
+    ENABLE_LOGGING = false;
+    disk_manager_ = new DiskManager("test.db");
+    bpm_ = new BufferPoolManager(50, disk_manager_);
+    lock_manager_ = new LockManager(false);
+    txn_mgr_ = new TransactionManager(lock_manager_);
+    page_id_t header_page_id;
+    bpm_->NewPage(header_page_id);
+    bpm_->UnpinPage(header_page_id, true);
+    schema_ = ParseCreateStatement("a bigint, b varchar(20)");
+    Transaction *txn = txn_mgr_->Begin();
+    table_ = new TableHeap(bpm_, lock_manager_, nullptr, txn);
+    txn_mgr_->Commit(txn);
+    delete txn;
+  }
+
+  void TearDown() override {
+    delete table_;
+    delete schema_;
+    delete txn_mgr_;
+    delete lock_manager_;
+    delete bpm_;
+    delete disk_manager_;
+    remove("test.db");
+  }
+
+  RID Insert(int64_t a) {
+    Tuple tuple({Value(TypeId::BIGINT, a),
+                 Value(TypeId::VARCHAR, "row " + std::to_string(a))},
+                schema_);
+    RID rid;
+    Transaction txn(0);
+    EXPECT_TRUE(table_->InsertTuple(tuple, rid, &txn));
+    return rid;
+  }
+
+  Index *NewIndex(bool unique) {
+    IndexMetadata *metadata = new IndexMetadata(
+        "foo_a", "foo", schema_, {0}, IndexType::BPLUS_TREE, unique);
+    return new BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>(
+        metadata, bpm_);
+  }
+
+  Tuple Key(Index *index, int64_t a) {
+    return Tuple({Value(TypeId::BIGINT, a)}, index->GetKeySchema());
+  }
+
+  std::function<Tuple(const Tuple &)> KeyOf(Index *index) {
+    return [this, index](const Tuple &tuple) {
+      return Tuple({tuple.GetValue(schema_, 0)}, index->GetKeySchema());
+    };
+  }
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *bpm_;
+  LockManager *lock_manager_;
+  TransactionManager *txn_mgr_;
+  Schema *schema_;
+  TableHeap *table_;
+};
+
+/*
+ * Runs larger than the buffer pool are spilled and merged back in order,
+ * equal keys once if unique
+ */
+TEST_F(IndexBuilderTest, ExternalSortTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  const int workers = 4;
+  const int64_t per_worker = 20000;
+  for (bool unique : {false, true}) {
+    ExternalSort<GenericKey<8>, RID, GenericComparator<8>> sort(
+        bpm_, comparator, workers, 3000, unique);
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; w++) {
+      threads.emplace_back([&sort, w, per_worker] {
+        std::mt19937 random(w);
+        GenericKey<8> key;
+        for (int64_t i = 0; i < per_worker; i++) {
+          // every key twice over the workers
+          key.SetFromInteger((random() % 1000) * 100000 +
+                             (i * workers + w) / 2);
+          sort.Add(w, key, RID(w, static_cast<uint32_t>(i)));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    sort.Finish();
+    EXPECT_LT(10u, sort.GetSpilledRunCount());
+
+    for (int pass = 0; pass < 2; pass++) {
+      std::pair<GenericKey<8>, RID> item, last;
+      size_t count = 0;
+      while (sort.Next(item)) {
+        if (count > 0) {
+          ASSERT_LE(unique ? 1 : 0, comparator(item.first, last.first));
+        }
+        last = item;
+        count++;
+      }
+      EXPECT_LT(static_cast<size_t>(per_worker * workers / 2 - 1), count);
+      if (!unique) {
+        EXPECT_EQ(static_cast<size_t>(per_worker * workers), count);
+      }
+      sort.Rewind();
+    }
+  }
+  delete key_schema;
+}
+
+/*
+ * A build loads what the parallel scan read; writes meanwhile go through
+ * the builder and are there once it is done
+ */
+TEST_F(IndexBuilderTest, BuildTest) {
+  const int64_t rows = 20000;
+  std::vector<RID> rids;
+  for (int64_t a = 0; a < rows; a++) {
+    rids.push_back(Insert(a));
+  }
+
+  for (bool unique : {true, false}) {
+    Index *index = NewIndex(unique);
+    IndexBuilder builder(index, table_);
+    std::atomic<bool> started(false);
+    std::atomic<bool> written(false);
+    std::atomic<bool> done(false);
+    int64_t writes = 0;
+    std::thread writer([&] {
+      while (!started) {
+        std::this_thread::yield();
+      }
+      // rows of their own, and deletes of the first ones, during the build
+      // and after it
+      while (writes < rows && (!done || writes < 100)) {
+        builder.InsertEntry(Key(index, rows + writes),
+                            RID(1000, static_cast<uint32_t>(writes)));
+        builder.DeleteEntry(Key(index, writes), rids[writes]);
+        writes++;
+        written = true;
+      }
+    });
+    auto key_of = KeyOf(index);
+    builder.Build([&](const Tuple &tuple) {
+      // the build goes on once a write came during it
+      started = true;
+      while (!written) {
+        std::this_thread::yield();
+      }
+      return key_of(tuple);
+    });
+    done = true;
+    writer.join();
+    EXPECT_LE(2u, builder.GetAppliedCount());
+
+    std::vector<RID> result;
+    for (int64_t a = 0; a < rows + writes; a++) {
+      result.clear();
+      index->ScanKey(Key(index, a), result);
+      if (a < writes) {
+        ASSERT_TRUE(result.empty());
+      } else {
+        ASSERT_EQ(1u, result.size());
+        EXPECT_EQ(a < rows ? rids[a]
+                           : RID(1000, static_cast<uint32_t>(a - rows)),
+                  result[0]);
+      }
+    }
+    result.clear();
+    index->ScanKey(Key(index, rows + writes), result);
+    EXPECT_TRUE(result.empty());
+    delete index;
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,115 @@
+/**
+ * key_search_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "common/rid.h"
+#include "page/key_search.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// the integer search agrees with the comparator's, at every page size
+TEST(KeySearchTest, SearchTest) {
+  Schema schema({Column(TypeId::BIGINT, 8, "a")});
+  GenericComparator<8> comparator(&schema);
+  ASSERT_TRUE(comparator.IsNormalized());
+  std::mt19937_64 random(15445);
+  GenericKey<8> key;
+  for (int size = 0; size <= 100; size++) {
+    std::vector<int64_t> values;
+    for (int i = 0; i < size; i++) {
+      values.push_back(static_cast<int64_t>(random() % 200) - 100);
+    }
+    std::sort(values.begin(), values.end());
+    std::vector<std::pair<GenericKey<8>, RID>> leaf(size);
+    std::vector<std::pair<GenericKey<8>, page_id_t>> internal(size);
+    for (int i = 0; i < size; i++) {
+      leaf[i].first.SetFromInteger(values[i]);
+      internal[i].first.SetFromInteger(values[i]);
+    }
+    for (int64_t value = -102; value <= 102; value++) {
+      key.SetFromInteger(value);
+      for (bool upper : {false, true}) {
+        int expected = static_cast<int>(
+            (upper ? std::upper_bound(values.begin(), values.end(), value)
+                   : std::lower_bound(values.begin(), values.end(), value)) -
+            values.begin());
+        ASSERT_EQ(expected, SearchKeys(leaf.data(), 0, size, key,
+                                       comparator, upper));
+        ASSERT_EQ(expected, BinarySearchKeys(leaf.data(), 0, size, key,
+                                             comparator, upper));
+        if (size > 0) {
+          ASSERT_EQ(std::max(expected, 1),
+                    SearchKeys(internal.data(), 1, size, key, comparator,
+                               upper));
+        }
+      }
+    }
+  }
+}
+
+TEST(KeySearchTest, IntegerComparatorTest) {
+  Schema schema({Column(TypeId::INTEGER, 4, "a")});
+  IntegerComparator<4> comparator(&schema);
+  std::vector<std::pair<GenericKey<4>, RID>> leaf(100);
+  for (int i = 0; i < 100; i++) {
+    leaf[i].first.SetFromKey(
+        Tuple({Value(TypeId::INTEGER, static_cast<int32_t>(i * 2 - 100))},
+              &schema),
+        &schema);
+  }
+  GenericKey<4> key;
+  for (int32_t value = -102; value <= 102; value++) {
+    key.SetFromKey(Tuple({Value(TypeId::INTEGER, value)}, &schema), &schema);
+    int lower = std::min(100, std::max(0, (value + 101) / 2));
+    int upper = std::min(100, std::max(0, (value + 102) / 2));
+    ASSERT_EQ(lower, SearchKeys(leaf.data(), 0, 100, key, comparator, false));
+    ASSERT_EQ(upper, SearchKeys(leaf.data(), 0, 100, key, comparator, true));
+  }
+}
+
+// not a check, reports searches of a full leaf
+TEST(KeySearchTest, BenchmarkTest) {
+  Schema schema({Column(TypeId::BIGINT, 8, "a")});
+  GenericComparator<8> comparator(&schema);
+  const int size = 255;
+  const int num_iters = 200000;
+  std::vector<std::pair<GenericKey<8>, RID>> leaf(size);
+  for (int i = 0; i < size; i++) {
+    leaf[i].first.SetFromInteger(i * 2);
+  }
+  std::vector<GenericKey<8>> keys(1024);
+  std::mt19937 random(15445);
+  for (auto &key : keys) {
+    key.SetFromInteger(random() % (2 * size));
+  }
+  long sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_iters; i++) {
+    sum += BinarySearchKeys(leaf.data(), 0, size, keys[i % keys.size()],
+                            comparator, false);
+  }
+  auto middle = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_iters; i++) {
+    sum -= SearchKeys(leaf.data(), 0, size, keys[i % keys.size()], comparator,
+                      false);
+  }
+  auto end = std::chrono::steady_clock::now();
+  EXPECT_EQ(0, sum);
+  auto ns = [](std::chrono::steady_clock::duration elapsed) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+               .count() /
+           num_iters;
+  };
+  printf("%d keys: binary search %ld ns, integer search %ld ns\n", size,
+         static_cast<long>(ns(middle - start)),
+         static_cast<long>(ns(end - middle)));
+}
+
+} // namespace cmudb
@@ -0,0 +1,141 @@
+/**
+ * normalized_key_test.cpp
+ */
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "index/generic_key.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// the order of two keys by their columns, compared as values
+int CompareValues(const Tuple &lhs, const Tuple &rhs, Schema *schema) {
+  for (int i = 0; i < schema->GetColumnCount(); i++) {
+    Value lhs_value = lhs.GetValue(schema, i);
+    Value rhs_value = rhs.GetValue(schema, i);
+    if (lhs_value.CompareLessThan(rhs_value) == CMP_TRUE) {
+      return -1;
+    }
+    if (lhs_value.CompareGreaterThan(rhs_value) == CMP_TRUE) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int Sign(int result) { return (result > 0) - (result < 0); }
+
+TEST(NormalizedKeyTest, IntegerTest) {
+  Schema schema({Column(TypeId::BIGINT, 8, "a")});
+  GenericComparator<8> comparator(&schema);
+  std::vector<int64_t> keys = {INT64_MIN + 1, -1000000000000, -256, -1, 0,
+                               1, 255, 256, 1000000000000, INT64_MAX};
+  GenericKey<8> lhs, rhs;
+  for (size_t i = 0; i < keys.size(); i++) {
+    lhs.SetFromInteger(keys[i]);
+    EXPECT_EQ(keys[i], lhs.ToString());
+    for (size_t j = 0; j < keys.size(); j++) {
+      rhs.SetFromInteger(keys[j]);
+      EXPECT_EQ(Sign(static_cast<int>(i) - static_cast<int>(j)),
+                Sign(comparator(lhs, rhs)));
+    }
+  }
+
+  // set from a tuple the same as from the integer
+  Tuple tuple({Value(TypeId::BIGINT, static_cast<int64_t>(-42))}, &schema);
+  lhs.SetFromKey(tuple, &schema);
+  rhs.SetFromInteger(-42);
+  EXPECT_EQ(0, comparator(lhs, rhs));
+}
+
+// keys of several columns order as their values do
+TEST(NormalizedKeyTest, CompositeTest) {
+  Schema schema({Column(TypeId::SMALLINT, 2, "a"),
+                 Column(TypeId::VARCHAR, 8, "b"),
+                 Column(TypeId::DECIMAL, 8, "c")});
+  GenericComparator<32> comparator(&schema);
+  std::vector<std::string> strings = {"",   "a",  std::string("a\0", 2),
+                                      "ab", "b",  std::string("a\0b", 3),
+                                      "ba", "\xff"};
+  std::vector<double> decimals = {-1e10, -2.5, -0.5, 0.0, 0.25, 3.0, 1e10};
+  std::mt19937 random(445);
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < 200; i++) {
+    const std::string &string = strings[random() % strings.size()];
+    tuples.emplace_back(
+        std::vector<Value>{
+            Value(TypeId::SMALLINT, static_cast<int16_t>(random() % 5 - 2)),
+            Value(TypeId::VARCHAR, string.data(),
+                  static_cast<uint32_t>(string.size() + 1), true),
+            Value(TypeId::DECIMAL, decimals[random() % decimals.size()])},
+        &schema);
+  }
+  GenericKey<32> lhs, rhs;
+  for (auto &lhs_tuple : tuples) {
+    lhs.SetFromKey(lhs_tuple, &schema);
+    for (auto &rhs_tuple : tuples) {
+      rhs.SetFromKey(rhs_tuple, &schema);
+      ASSERT_EQ(CompareValues(lhs_tuple, rhs_tuple, &schema),
+                Sign(comparator(lhs, rhs)));
+    }
+  }
+}
+
+// the comparators picked at index creation agree with the generic one
+TEST(NormalizedKeyTest, ComparatorTest) {
+  Schema int_schema({Column(TypeId::INTEGER, 4, "a")});
+  Schema decimal_schema({Column(TypeId::DECIMAL, 8, "a")});
+  Schema pair_schema(
+      {Column(TypeId::BIGINT, 8, "a"), Column(TypeId::INTEGER, 4, "b")});
+  GenericComparator<4> int_generic(&int_schema);
+  IntegerComparator<4> int_comparator(&int_schema);
+  GenericComparator<8> decimal_generic(&decimal_schema);
+  IntegerComparator<8> decimal_comparator(&decimal_schema);
+  GenericComparator<16> pair_generic(&pair_schema);
+  BytesComparator<16> pair_comparator(&pair_schema);
+  std::mt19937 random(445);
+  for (int i = 0; i < 1000; i++) {
+    GenericKey<4> int_lhs, int_rhs;
+    int_lhs.SetFromKey(
+        Tuple({Value(TypeId::INTEGER, static_cast<int32_t>(random()))},
+              &int_schema),
+        &int_schema);
+    int_rhs.SetFromKey(
+        Tuple({Value(TypeId::INTEGER, static_cast<int32_t>(random() % 3))},
+              &int_schema),
+        &int_schema);
+    EXPECT_EQ(Sign(int_generic(int_lhs, int_rhs)),
+              int_comparator(int_lhs, int_rhs));
+
+    GenericKey<8> decimal_lhs, decimal_rhs;
+    decimal_lhs.SetFromKey(
+        Tuple({Value(TypeId::DECIMAL, static_cast<int32_t>(random()) / 7.0)},
+              &decimal_schema),
+        &decimal_schema);
+    decimal_rhs.SetFromKey(
+        Tuple({Value(TypeId::DECIMAL, static_cast<int32_t>(random()) / 7.0)},
+              &decimal_schema),
+        &decimal_schema);
+    EXPECT_EQ(Sign(decimal_generic(decimal_lhs, decimal_rhs)),
+              decimal_comparator(decimal_lhs, decimal_rhs));
+
+    GenericKey<16> pair_lhs, pair_rhs;
+    pair_lhs.SetFromKey(
+        Tuple({Value(TypeId::BIGINT, static_cast<int64_t>(random() % 3 - 1)),
+               Value(TypeId::INTEGER, static_cast<int32_t>(random()))},
+              &pair_schema),
+        &pair_schema);
+    pair_rhs.SetFromKey(
+        Tuple({Value(TypeId::BIGINT, static_cast<int64_t>(random() % 3 - 1)),
+               Value(TypeId::INTEGER, static_cast<int32_t>(random()))},
+              &pair_schema),
+        &pair_schema);
+    EXPECT_EQ(Sign(pair_generic(pair_lhs, pair_rhs)),
+              Sign(pair_comparator(pair_lhs, pair_rhs)));
+  }
+}
+
+} // namespace cmudb
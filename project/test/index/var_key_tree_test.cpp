@@ -0,0 +1,183 @@
+/**
+ * var_key_tree_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "index/var_key_tree.h"
+#include "index/var_key_tree_index.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+class VarKeyTreeTest : public ::testing::Test {
+protected:
+  void SetUp() override { Open(PAGE_SIZE); }
+
+  void TearDown() override {
+    delete bpm_;
+    delete disk_manager_;
+    remove("test.db");
+  }
+
+  void Open(size_t page_size) {
+    remove("test.db");
+    disk_manager_ = new DiskManager("test.db", page_size);
+    bpm_ = new BufferPoolManager(50, disk_manager_);
+    page_id_t header_page_id;
+    bpm_->NewPage(header_page_id);
+    bpm_->UnpinPage(header_page_id, true);
+  }
+
+  // num_keys distinct keys of 1 to max_size bytes, many sharing prefixes,
+  // with a 0 byte now and then if zeros
+  std::vector<std::string> RandomKeys(size_t num_keys, int max_size,
+                                      bool zeros) {
+    std::mt19937 random(15445);
+    std::uniform_int_distribution<int> size(1, max_size);
+    std::uniform_int_distribution<int> byte(0, 7);
+    std::vector<std::string> keys;
+    std::map<std::string, bool> seen;
+    while (keys.size() < num_keys) {
+      std::string key(size(random), '\0');
+      for (auto &c : key) {
+        int b = byte(random);
+        c = zeros && b == 0 ? '\0' : static_cast<char>('a' + b);
+      }
+      if (!seen[key]) {
+        seen[key] = true;
+        keys.push_back(key);
+      }
+    }
+    return keys;
+  }
+
+  // 20000 keys into a tree of min_height levels at least
+  void InsertRemove(int min_height) {
+    VarKeyTree tree("foo_pk", bpm_);
+    EXPECT_TRUE(tree.IsEmpty());
+    std::vector<std::string> keys = RandomKeys(20000, 40, true);
+    for (size_t i = 0; i < keys.size(); i++) {
+      EXPECT_TRUE(tree.Insert(VarKey(keys[i]), RID(0, i)));
+    }
+    EXPECT_FALSE(tree.Insert(VarKey(keys[0]), RID(1, 0)));
+    EXPECT_LE(min_height, tree.GetHeight());
+
+    std::vector<RID> rids;
+    for (size_t i = 0; i < keys.size(); i++) {
+      rids.clear();
+      ASSERT_TRUE(tree.GetValue(VarKey(keys[i]), rids));
+      EXPECT_EQ(static_cast<int>(i), rids[0].GetSlotNum());
+      // a longer key with the same start is another key
+      std::string longer = keys[i] + std::string(1, '\0');
+      rids.clear();
+      EXPECT_EQ(std::find(keys.begin(), keys.end(), longer) != keys.end(),
+                tree.GetValue(VarKey(longer), rids));
+    }
+
+    // in key order
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); i++) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&keys](size_t lhs, size_t rhs) {
+      return keys[lhs] < keys[rhs];
+    });
+    rids.clear();
+    tree.Scan(VarKey(), keys.size() + 1, rids);
+    ASSERT_EQ(keys.size(), rids.size());
+    for (size_t i = 0; i < order.size(); i++) {
+      EXPECT_EQ(static_cast<int>(order[i]), rids[i].GetSlotNum());
+    }
+
+    for (size_t i = 0; i < keys.size(); i += 2) {
+      tree.Remove(VarKey(keys[i]));
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+      rids.clear();
+      ASSERT_EQ(i % 2 == 1, tree.GetValue(VarKey(keys[i]), rids));
+    }
+    // the holes are filled again
+    for (size_t i = 0; i < keys.size(); i += 2) {
+      EXPECT_TRUE(tree.Insert(VarKey(keys[i]), RID(2, i)));
+    }
+    rids.clear();
+    tree.Scan(VarKey(), keys.size(), rids);
+    EXPECT_EQ(keys.size(), rids.size());
+
+    std::string too_long(tree.GetMaxKeySize() + 1, 'x');
+    EXPECT_THROW(tree.Insert(VarKey(too_long), RID(0, 0)), Exception);
+  }
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *bpm_;
+};
+
+TEST_F(VarKeyTreeTest, InsertRemoveTest) { InsertRemove(2); }
+
+/*
+ * Internal pages split too
+ */
+TEST_F(VarKeyTreeTest, SmallPageTest) {
+  TearDown();
+  Open(512);
+  InsertRemove(4);
+}
+
+/*
+ * Varchar keys take a fraction of the pages of a B+ tree of GenericKeys wide
+ * enough for them
+ */
+TEST_F(VarKeyTreeTest, UtilizationTest) {
+  Schema *schema = ParseCreateStatement("a varchar(64)");
+  IndexMetadata *plain_metadata =
+      new IndexMetadata("foo_a", "foo", schema, {0}, IndexType::BPLUS_TREE);
+  IndexMetadata *var_metadata = new IndexMetadata(
+      "foo_b", "foo", schema, {0}, IndexType::VARKEY_TREE);
+  Index *plain =
+      new BPlusTreeIndex<GenericKey<64>, RID, BytesComparator<64>>(
+          plain_metadata, bpm_);
+  Index *var = ConstructIndex(var_metadata, bpm_, INVALID_PAGE_ID);
+  std::vector<std::string> keys = RandomKeys(10000, 12, false);
+
+  auto fill = [&](Index *index) {
+    page_id_t pages = disk_manager_->GetPageCount();
+    for (size_t i = 0; i < keys.size(); i++) {
+      Tuple key({Value(TypeId::VARCHAR, keys[i])}, schema);
+      index->InsertEntry(key, RID(0, i));
+    }
+    return disk_manager_->GetPageCount() - pages;
+  };
+  page_id_t plain_pages = fill(plain);
+  page_id_t var_pages = fill(var);
+  printf("%zu keys: B+ tree %d pages, varkey tree %d pages\n", keys.size(),
+         plain_pages, var_pages);
+  EXPECT_LT(var_pages * 3, plain_pages);
+
+  std::vector<RID> result;
+  for (size_t i = 0; i < keys.size(); i++) {
+    result.clear();
+    Tuple key({Value(TypeId::VARCHAR, keys[i])}, schema);
+    var->ScanKey(key, result);
+    ASSERT_EQ(1u, result.size());
+    EXPECT_EQ(static_cast<int>(i), result[0].GetSlotNum());
+  }
+  Tuple key({Value(TypeId::VARCHAR, keys[0])}, schema);
+  var->DeleteEntry(key, RID(0, 0));
+  result.clear();
+  var->ScanKey(key, result);
+  EXPECT_TRUE(result.empty());
+
+  delete plain;
+  delete var;
+  delete schema;
+}
+
+} // namespace cmudb
@@ -1,9 +1,17 @@
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <thread>
+#include <vector>
 
+#include "concurrency/transaction_manager.h"
+#include "logging/checkpoint_manager.h"
 #include "logging/common.h"
 #include "logging/log_recovery.h"
+#include "page/header_page.h"
 #include "vtable/virtual_table.h"
 #include "gtest/gtest.h"
 
@@ -124,4 +132,740 @@ TEST(LogManagerTest, RedoTestWithOneTxn) {
   remove("test.log");
 }
 
+// concurrent committers share flushes instead of one each
+TEST(LogManagerTest, GroupCommitTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  LockManager lock_manager(false);
+  TransactionManager txn_manager(&lock_manager, log_manager);
+  log_manager->RunFlushThread();
+  EXPECT_TRUE(ENABLE_LOGGING);
+
+  const int num_threads = 8;
+  const int txns_per_thread = 50;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([&] {
+      for (int i = 0; i < txns_per_thread; i++) {
+        Transaction *txn = txn_manager.Begin();
+        txn_manager.Commit(txn);
+        // the commit record is on disk once Commit returns
+        EXPECT_LE(txn->GetPrevLSN(), log_manager->GetPersistentLSN());
+        delete txn;
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  int num_txns = num_threads * txns_per_thread;
+  EXPECT_EQ(2 * num_txns - 1, log_manager->GetPersistentLSN());
+  EXPECT_LT(disk_manager->GetNumFlushes(), num_txns);
+
+  log_manager->StopFlushThread();
+  EXPECT_FALSE(ENABLE_LOGGING);
+  // BEGIN and COMMIT records, the header only
+  std::vector<char> buffer(2 * num_txns * 20);
+  EXPECT_TRUE(disk_manager->ReadLog(buffer.data(), buffer.size(), 0));
+  int commits = 0;
+  for (int i = 0; i < 2 * num_txns; i++) {
+    int32_t size, lsn;
+    LogRecordType type;
+    std::memcpy(&size, &buffer[i * 20], sizeof(size));
+    std::memcpy(&lsn, &buffer[i * 20 + 4], sizeof(lsn));
+    std::memcpy(&type, &buffer[i * 20 + 16], sizeof(type));
+    EXPECT_EQ(20, size);
+    EXPECT_EQ(i, lsn);
+    if (type == LogRecordType::COMMIT) {
+      commits++;
+    }
+  }
+  EXPECT_EQ(num_txns, commits);
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// an async commit returns before its record is durable, the barrier waits
+// for it
+TEST(LogManagerTest, AsyncCommitTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  LockManager lock_manager(false);
+  TransactionManager txn_manager(&lock_manager, log_manager);
+  // logging without a flush thread, nothing is written unless waited for
+  ENABLE_LOGGING = true;
+
+  txn_manager.SetAsyncCommit(true);
+  Transaction *txn = txn_manager.Begin();
+  EXPECT_TRUE(txn->IsAsyncCommit());
+  txn_manager.Commit(txn);
+  lsn_t commit_lsn = txn->GetPrevLSN();
+  EXPECT_LT(log_manager->GetPersistentLSN(), commit_lsn);
+  txn_manager.WaitForDurable(commit_lsn);
+  EXPECT_LE(commit_lsn, log_manager->GetPersistentLSN());
+  delete txn;
+
+  // the engine default is async, this one transaction is not
+  txn = txn_manager.Begin();
+  txn->SetAsyncCommit(false);
+  txn_manager.Commit(txn);
+  EXPECT_LE(txn->GetPrevLSN(), log_manager->GetPersistentLSN());
+  delete txn;
+
+  txn_manager.SetAsyncCommit(false);
+  txn = txn_manager.Begin();
+  EXPECT_FALSE(txn->IsAsyncCommit());
+  txn_manager.Commit(txn);
+  EXPECT_LE(txn->GetPrevLSN(), log_manager->GetPersistentLSN());
+  delete txn;
+
+  ENABLE_LOGGING = false;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// appenders copy in parallel, the log still holds every record once, in
+// LSN order
+TEST(LogManagerTest, ConcurrentAppendTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  log_manager->RunFlushThread();
+
+  const int num_threads = 8;
+  const int records_per_thread = 2000;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([=] {
+      for (int i = 0; i < records_per_thread; i++) {
+        // NEWPAGE records carry a page id, the thread's number here
+        LogRecord log_record(tid, INVALID_LSN, LogRecordType::NEWPAGE, tid);
+        log_manager->AppendLogRecord(log_record);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log_manager->StopFlushThread();
+
+  const int record_size = 28;
+  int num_records = num_threads * records_per_thread;
+  std::vector<char> buffer(num_records * record_size);
+  EXPECT_TRUE(disk_manager->ReadLog(buffer.data(), buffer.size(), 0));
+  std::vector<int> per_thread(num_threads, 0);
+  for (int i = 0; i < num_records; i++) {
+    int32_t size, lsn;
+    txn_id_t txn_id;
+    page_id_t page_id;
+    std::memcpy(&size, &buffer[i * record_size], sizeof(size));
+    std::memcpy(&lsn, &buffer[i * record_size + 4], sizeof(lsn));
+    std::memcpy(&txn_id, &buffer[i * record_size + 8], sizeof(txn_id));
+    std::memcpy(&page_id, &buffer[i * record_size + 20], sizeof(page_id));
+    ASSERT_EQ(record_size, size);
+    ASSERT_EQ(i, lsn);
+    ASSERT_EQ(txn_id, page_id);
+    per_thread[txn_id]++;
+  }
+  for (int tid = 0; tid < num_threads; tid++) {
+    EXPECT_EQ(records_per_thread, per_thread[tid]);
+  }
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  // preallocated, the log got half way through the first file
+  remove("test.log.1");
+}
+
+// full segments are sealed and left for the flush, appending only stalls
+// once every segment of the ring waits to be written
+TEST(LogManagerTest, SegmentRingTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+
+  const int record_size = 28;
+  int per_segment = LOG_BUFFER_SIZE / record_size;
+  // fill all but the last segment, and some of that one
+  int num_records = per_segment * (LOG_BUFFER_SEGMENTS - 1) + 10;
+  for (int i = 0; i < num_records; i++) {
+    LogRecord log_record(i, INVALID_LSN, LogRecordType::NEWPAGE, i);
+    EXPECT_EQ(i, log_manager->AppendLogRecord(log_record));
+  }
+  EXPECT_EQ(0, disk_manager->GetNumFlushes());
+  EXPECT_EQ(INVALID_LSN, log_manager->GetPersistentLSN());
+
+  // the last segment is full as well, the oldest ones are written
+  for (int i = num_records; i < num_records + per_segment; i++) {
+    LogRecord log_record(i, INVALID_LSN, LogRecordType::NEWPAGE, i);
+    EXPECT_EQ(i, log_manager->AppendLogRecord(log_record));
+  }
+  EXPECT_LT(0, disk_manager->GetNumFlushes());
+  num_records += per_segment;
+  log_manager->WaitForDurable(num_records - 1);
+  EXPECT_EQ(num_records - 1, log_manager->GetPersistentLSN());
+
+  std::vector<char> buffer(num_records * record_size);
+  EXPECT_TRUE(disk_manager->ReadLog(buffer.data(), buffer.size(), 0));
+  for (int i = 0; i < num_records; i++) {
+    int32_t lsn;
+    page_id_t page_id;
+    std::memcpy(&lsn, &buffer[i * record_size + 4], sizeof(lsn));
+    std::memcpy(&page_id, &buffer[i * record_size + 20], sizeof(page_id));
+    ASSERT_EQ(i, lsn);
+    ASSERT_EQ(i, page_id);
+  }
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// appends through a full ring stall once, the flushes match what the disk
+// manager saw written
+TEST(LogManagerTest, StatsTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+
+  const int record_size = 28;
+  int num_records = LOG_BUFFER_SIZE / record_size * LOG_BUFFER_SEGMENTS + 10;
+  for (int i = 0; i < num_records; i++) {
+    LogRecord log_record(i, INVALID_LSN, LogRecordType::NEWPAGE, i);
+    log_manager->AppendLogRecord(log_record);
+  }
+  log_manager->WaitForDurable(num_records - 1);
+  // durable already, no wait
+  log_manager->WaitForDurable(num_records - 1);
+
+  LogStats stats = log_manager->GetStats();
+  EXPECT_EQ(num_records, stats.appends);
+  EXPECT_EQ(num_records * record_size, stats.bytes_appended);
+  EXPECT_EQ(stats.appends, stats.append_ns.count);
+  EXPECT_LE(stats.append_ns.Percentile(0.5), stats.append_ns.Percentile(0.99));
+  EXPECT_EQ(1, stats.full_stalls);
+  EXPECT_EQ(1, stats.durable_waits);
+  EXPECT_EQ(stats.durable_waits, stats.durable_wait_ns.count);
+
+  LogWriteStats writes = disk_manager->GetLogWriteStats();
+  EXPECT_LT(LOG_BUFFER_SEGMENTS, stats.flushes);
+  EXPECT_EQ(writes.writes, stats.flushes);
+  EXPECT_EQ(writes.bytes, stats.bytes_flushed);
+  EXPECT_EQ(stats.bytes_appended, stats.bytes_flushed);
+  EXPECT_EQ(stats.flushes, stats.flush_bytes.count);
+  EXPECT_EQ(stats.bytes_flushed, stats.flush_bytes.sum);
+  EXPECT_EQ(writes.writes, writes.write_ns.count);
+  EXPECT_EQ(0, writes.errors);
+
+  log_manager->ResetStats();
+  EXPECT_EQ(0, log_manager->GetStats().appends);
+  EXPECT_EQ(0, log_manager->GetStats().append_ns.count);
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// an update of one column logs only the bytes that changed, and the delta
+// turns either image into the other
+TEST(LogManagerTest, UpdateDeltaTest) {
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::BIGINT, 8, "b"),
+                                 Column(TypeId::VARCHAR, 64, "c")};
+  Schema schema(columns);
+  std::string text(48, 'x');
+  Tuple old_tuple({Value(TypeId::INTEGER, 1), Value(TypeId::BIGINT, (int64_t)2),
+                   Value(TypeId::VARCHAR, text)},
+                  &schema);
+  Tuple new_tuple({Value(TypeId::INTEGER, 7), Value(TypeId::BIGINT, (int64_t)2),
+                   Value(TypeId::VARCHAR, text)},
+                  &schema);
+  RID rid(1, 0);
+
+  LogRecord full(0, INVALID_LSN, LogRecordType::UPDATE, rid, old_tuple,
+                 new_tuple);
+  LogRecord delta(0, INVALID_LSN, LogRecordType::UPDATEDELTA, rid, old_tuple,
+                  new_tuple);
+  EXPECT_EQ(LogRecordType::UPDATEDELTA, delta.GetLogRecordType());
+  EXPECT_LT(delta.GetSize(), full.GetSize() / 2);
+
+  Tuple result;
+  EXPECT_TRUE(delta.ApplyDelta(old_tuple, result, true));
+  EXPECT_EQ(7, result.GetValue(&schema, 0).GetAs<int32_t>());
+  EXPECT_EQ(0, memcmp(new_tuple.GetData(), result.GetData(),
+                      new_tuple.GetLength()));
+  EXPECT_TRUE(delta.ApplyDelta(new_tuple, result, false));
+  EXPECT_EQ(0, memcmp(old_tuple.GetData(), result.GetData(),
+                      old_tuple.GetLength()));
+
+  // the varchar shrinks, everything behind the change moves
+  Tuple short_tuple({Value(TypeId::INTEGER, 1),
+                     Value(TypeId::BIGINT, (int64_t)2),
+                     Value(TypeId::VARCHAR, text.substr(0, 40) + "y")},
+                    &schema);
+  LogRecord shrink(0, INVALID_LSN, LogRecordType::UPDATEDELTA, rid,
+                   old_tuple, short_tuple);
+  EXPECT_EQ(LogRecordType::UPDATEDELTA, shrink.GetLogRecordType());
+  EXPECT_TRUE(shrink.ApplyDelta(old_tuple, result, true));
+  ASSERT_EQ(short_tuple.GetLength(), result.GetLength());
+  EXPECT_EQ(0, memcmp(short_tuple.GetData(), result.GetData(),
+                      short_tuple.GetLength()));
+  EXPECT_TRUE(shrink.ApplyDelta(short_tuple, result, false));
+  ASSERT_EQ(old_tuple.GetLength(), result.GetLength());
+  EXPECT_EQ(0, memcmp(old_tuple.GetData(), result.GetData(),
+                      old_tuple.GetLength()));
+  // applied to an image it was not taken against
+  EXPECT_FALSE(shrink.ApplyDelta(old_tuple, result, false));
+
+  // nothing shared, the record stays a full update
+  Tuple other({Value(TypeId::INTEGER, 9), Value(TypeId::BIGINT, (int64_t)8),
+               Value(TypeId::VARCHAR, std::string(47, 'z'))},
+              &schema);
+  LogRecord fallback(0, INVALID_LSN, LogRecordType::UPDATEDELTA, rid,
+                     old_tuple, other);
+  EXPECT_EQ(LogRecordType::UPDATE, fallback.GetLogRecordType());
+}
+
+// redo replays delta updates onto a page that never saw them, undo rolls
+// back the one of the transaction that did not commit
+TEST(LogManagerTest, UpdateDeltaRecoveryTest) {
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 64, "b")};
+  Schema schema(columns);
+  std::string text(40, 'x');
+  Tuple first({Value(TypeId::INTEGER, 1), Value(TypeId::VARCHAR, text)},
+              &schema);
+  Tuple second({Value(TypeId::INTEGER, 2), Value(TypeId::VARCHAR, text)},
+               &schema);
+  Tuple third({Value(TypeId::INTEGER, 2), Value(TypeId::VARCHAR, text + "y")},
+              &schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  // an empty table page on disk, the log has everything else
+  page_id_t page_id;
+  auto page = static_cast<TablePage *>(bpm->NewPage(page_id));
+  page->Init(page_id, bpm->GetPageSize(), INVALID_PAGE_ID, nullptr, nullptr);
+  bpm->UnpinPage(page_id, true);
+  bpm->FlushPage(page_id);
+
+  LogManager *log_manager = new LogManager(disk_manager);
+  RID rid(page_id, 0);
+  LogRecord begin1(1, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t lsn = log_manager->AppendLogRecord(begin1);
+  LogRecord insert(1, lsn, LogRecordType::INSERT, rid, first);
+  lsn = log_manager->AppendLogRecord(insert);
+  LogRecord update1(1, lsn, LogRecordType::UPDATEDELTA, rid, first, second);
+  lsn = log_manager->AppendLogRecord(update1);
+  LogRecord commit1(1, lsn, LogRecordType::COMMIT);
+  log_manager->AppendLogRecord(commit1);
+  LogRecord begin2(2, INVALID_LSN, LogRecordType::BEGIN);
+  lsn = log_manager->AppendLogRecord(begin2);
+  LogRecord update2(2, lsn, LogRecordType::UPDATEDELTA, rid, second, third);
+  lsn = log_manager->AppendLogRecord(update2);
+  EXPECT_EQ(LogRecordType::UPDATEDELTA, update2.GetLogRecordType());
+  log_manager->WaitForDurable(lsn);
+  delete log_manager;
+  delete bpm;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManager(10, disk_manager);
+  LogRecovery *log_recovery = new LogRecovery(disk_manager, bpm);
+  log_recovery->Redo();
+  Tuple tuple;
+  page = static_cast<TablePage *>(bpm->FetchPage(page_id));
+  EXPECT_TRUE(page->GetTuple(rid, tuple, nullptr, nullptr));
+  EXPECT_EQ(text + "y", tuple.GetValue(&schema, 1).ToString());
+  bpm->UnpinPage(page_id, false);
+
+  log_recovery->Undo();
+  page = static_cast<TablePage *>(bpm->FetchPage(page_id));
+  EXPECT_TRUE(page->GetTuple(rid, tuple, nullptr, nullptr));
+  EXPECT_EQ(2, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+  EXPECT_EQ(text, tuple.GetValue(&schema, 1).ToString());
+  bpm->UnpinPage(page_id, false);
+
+  delete log_recovery;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// compressed frames take less log than the records, recovery reads them
+// back as if they were bare
+TEST(LogManagerTest, CompressionTest) {
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 64, "b")};
+  Schema schema(columns);
+  std::string text(40, 'x');
+  Tuple first({Value(TypeId::INTEGER, 1), Value(TypeId::VARCHAR, text)},
+              &schema);
+  Tuple second({Value(TypeId::INTEGER, 2), Value(TypeId::VARCHAR, text)},
+               &schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t page_id;
+  auto page = static_cast<TablePage *>(bpm->NewPage(page_id));
+  page->Init(page_id, bpm->GetPageSize(), INVALID_PAGE_ID, nullptr, nullptr);
+  bpm->UnpinPage(page_id, true);
+  bpm->FlushPage(page_id);
+
+  LogManager *log_manager = new LogManager(disk_manager);
+  log_manager->SetCompression(true);
+  EXPECT_TRUE(log_manager->UsesCompression());
+  const int num_tuples = 40;
+  int raw_size = 0;
+  LogRecord begin1(1, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t lsn = log_manager->AppendLogRecord(begin1);
+  raw_size += begin1.GetSize();
+  for (int i = 0; i < num_tuples; i++) {
+    LogRecord insert(1, lsn, LogRecordType::INSERT, RID(page_id, i), first);
+    lsn = log_manager->AppendLogRecord(insert);
+    raw_size += insert.GetSize();
+    // one frame per flush, frames of a few records each
+    if (i % 10 == 9) {
+      log_manager->WaitForDurable(lsn);
+    }
+  }
+  LogRecord commit1(1, lsn, LogRecordType::COMMIT);
+  lsn = log_manager->AppendLogRecord(commit1);
+  raw_size += commit1.GetSize();
+  // the other transaction loses its updates
+  LogRecord begin2(2, INVALID_LSN, LogRecordType::BEGIN);
+  lsn = log_manager->AppendLogRecord(begin2);
+  raw_size += begin2.GetSize();
+  for (int i = 0; i < num_tuples; i += 2) {
+    LogRecord update(2, lsn, LogRecordType::UPDATE, RID(page_id, i), first,
+                     second);
+    lsn = log_manager->AppendLogRecord(update);
+    raw_size += update.GetSize();
+  }
+  log_manager->WaitForDurable(lsn);
+  delete log_manager;
+  delete bpm;
+  delete disk_manager;
+
+  std::ifstream log_file("test.log", std::ios::binary | std::ios::ate);
+  EXPECT_LT(static_cast<int>(log_file.tellg()), raw_size / 2);
+  log_file.close();
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManager(10, disk_manager);
+  LogRecovery *log_recovery = new LogRecovery(disk_manager, bpm);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  page = static_cast<TablePage *>(bpm->FetchPage(page_id));
+  for (int i = 0; i < num_tuples; i++) {
+    Tuple tuple;
+    EXPECT_TRUE(page->GetTuple(RID(page_id, i), tuple, nullptr, nullptr));
+    EXPECT_EQ(1, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+  }
+  bpm->UnpinPage(page_id, false);
+
+  delete log_recovery;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// workers redo pages in parallel and roll losers back in parallel, the
+// outcome is the one of serial recovery
+TEST(LogManagerTest, ParallelRecoveryTest) {
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 64, "b")};
+  Schema schema(columns);
+  const int num_pages = 8;
+  const int tuples_per_page = 6;
+  const int num_losers = 3;
+  auto make_tuple = [&schema](int a, const std::string &b) {
+    return Tuple({Value(TypeId::INTEGER, a), Value(TypeId::VARCHAR, b)},
+                 &schema);
+  };
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < num_pages; i++) {
+    page_id_t page_id;
+    auto page = static_cast<TablePage *>(bpm->NewPage(page_id));
+    page->Init(page_id, bpm->GetPageSize(), INVALID_PAGE_ID, nullptr,
+               nullptr);
+    bpm->UnpinPage(page_id, true);
+    bpm->FlushPage(page_id);
+    page_ids.push_back(page_id);
+  }
+
+  // winners 0..num_pages-1 fill one page each and commit, losers update
+  // every page and mark a tuple deleted
+  LogManager *log_manager = new LogManager(disk_manager);
+  std::vector<lsn_t> prev_lsn(num_pages + num_losers, INVALID_LSN);
+  auto append = [&](LogRecord &log_record, int txn) {
+    prev_lsn[txn] = log_manager->AppendLogRecord(log_record);
+  };
+  for (int txn = 0; txn < num_pages + num_losers; txn++) {
+    LogRecord begin(txn, INVALID_LSN, LogRecordType::BEGIN);
+    append(begin, txn);
+  }
+  for (int slot = 0; slot < tuples_per_page; slot++) {
+    for (int p = 0; p < num_pages; p++) {
+      LogRecord insert(p, prev_lsn[p], LogRecordType::INSERT,
+                       RID(page_ids[p], slot),
+                       make_tuple(p * 100 + slot, std::string(20, 'a' + p)));
+      append(insert, p);
+    }
+  }
+  for (int p = 0; p < num_pages; p++) {
+    LogRecord commit(p, prev_lsn[p], LogRecordType::COMMIT);
+    append(commit, p);
+  }
+  for (int l = 0; l < num_losers; l++) {
+    int txn = num_pages + l;
+    for (int p = 0; p < num_pages; p++) {
+      RID rid(page_ids[p], l);
+      LogRecord update(txn, prev_lsn[txn], LogRecordType::UPDATEDELTA, rid,
+                       make_tuple(p * 100 + l, std::string(20, 'a' + p)),
+                       make_tuple(-1, std::string(24, 'a' + p)));
+      append(update, txn);
+    }
+    RID rid(page_ids[l], tuples_per_page - 1);
+    LogRecord mark(txn, prev_lsn[txn], LogRecordType::MARKDELETE, rid,
+                   make_tuple(l * 100 + tuples_per_page - 1,
+                              std::string(20, 'a' + l)));
+    append(mark, txn);
+  }
+  log_manager->WaitForDurable(prev_lsn.back());
+  delete log_manager;
+  delete bpm;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManager(10, disk_manager);
+  LogRecovery *log_recovery = new LogRecovery(disk_manager, bpm, 4);
+  log_recovery->Redo();
+  auto page = static_cast<TablePage *>(bpm->FetchPage(page_ids[0]));
+  Tuple tuple;
+  EXPECT_TRUE(page->GetTuple(RID(page_ids[0], 1), tuple, nullptr, nullptr));
+  EXPECT_EQ(-1, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+  bpm->UnpinPage(page_ids[0], false);
+
+  log_recovery->Undo();
+  for (int p = 0; p < num_pages; p++) {
+    page = static_cast<TablePage *>(bpm->FetchPage(page_ids[p]));
+    for (int slot = 0; slot < tuples_per_page; slot++) {
+      EXPECT_TRUE(
+          page->GetTuple(RID(page_ids[p], slot), tuple, nullptr, nullptr));
+      EXPECT_EQ(p * 100 + slot, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+      EXPECT_EQ(std::string(20, 'a' + p),
+                tuple.GetValue(&schema, 1).ToString());
+    }
+    bpm->UnpinPage(page_ids[p], false);
+  }
+
+  delete log_recovery;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a record of a page that is clean at the checkpoint is not redone, and a
+// loser active at the checkpoint is still rolled back
+TEST(LogManagerTest, CheckpointTest) {
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a")};
+  Schema schema(columns);
+  auto make_tuple = [&schema](int a) {
+    return Tuple({Value(TypeId::INTEGER, a)}, &schema);
+  };
+  remove("test.log");
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  EXPECT_EQ(HEADER_PAGE_ID, page_id);
+  header_page->Init();
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  bpm->FlushPage(HEADER_PAGE_ID);
+  page_id_t page_ids[2];
+  for (int i = 0; i < 2; i++) {
+    auto page = static_cast<TablePage *>(bpm->NewPage(page_ids[i]));
+    page->Init(page_ids[i], bpm->GetPageSize(), INVALID_PAGE_ID, nullptr,
+               nullptr);
+    bpm->UnpinPage(page_ids[i], true);
+    bpm->FlushPage(page_ids[i]);
+  }
+  delete bpm;
+
+  // a winner whose insert into page 1 is logged but, to tell whether redo
+  // reads it, never applied
+  LogManager *log_manager = new LogManager(disk_manager);
+  ENABLE_LOGGING = true;
+  LogRecord begin(0, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t lsn = log_manager->AppendLogRecord(begin);
+  RID rid(page_ids[1], 0);
+  LogRecord insert(0, lsn, LogRecordType::INSERT, rid, make_tuple(1));
+  lsn = log_manager->AppendLogRecord(insert);
+  LogRecord commit(0, lsn, LogRecordType::COMMIT);
+  log_manager->WaitForDurable(log_manager->AppendLogRecord(commit));
+
+  // a loser inserts into page 0, which stays dirty
+  bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  TransactionManager txn_manager(nullptr, log_manager);
+  Transaction *loser = txn_manager.Begin();
+  auto page = static_cast<TablePage *>(bpm->FetchPage(page_ids[0]));
+  rid = RID(page_ids[0], 0);
+  LogRecord loser_insert(loser->GetTransactionId(), loser->GetPrevLSN(),
+                         LogRecordType::INSERT, rid, make_tuple(2));
+  loser->SetPrevLSN(log_manager->AppendLogRecord(loser_insert));
+  ENABLE_LOGGING = false;
+  EXPECT_TRUE(page->InsertTuple(make_tuple(2), rid, nullptr, nullptr, nullptr));
+  page->SetLSN(loser->GetPrevLSN());
+  bpm->UnpinPage(page_ids[0], true);
+
+  ENABLE_LOGGING = true;
+  CheckpointManager checkpoint_manager(&txn_manager, log_manager, bpm);
+  lsn_t checkpoint_lsn = checkpoint_manager.Checkpoint();
+  EXPECT_NE(INVALID_LSN, checkpoint_lsn);
+  EXPECT_EQ(checkpoint_lsn, checkpoint_manager.GetLastCheckpointLSN());
+
+  // a winner after the checkpoint
+  LogRecord begin2(5, INVALID_LSN, LogRecordType::BEGIN);
+  lsn = log_manager->AppendLogRecord(begin2);
+  LogRecord insert2(5, lsn, LogRecordType::INSERT, RID(page_ids[1], 0),
+                    make_tuple(3));
+  lsn = log_manager->AppendLogRecord(insert2);
+  LogRecord commit2(5, lsn, LogRecordType::COMMIT);
+  log_manager->WaitForDurable(log_manager->AppendLogRecord(commit2));
+  ENABLE_LOGGING = false;
+  delete loser;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManager(10, disk_manager);
+  header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  log_offset_t redo_offset;
+  EXPECT_TRUE(header_page->GetWideRecord(REDO_OFFSET_RECORD, redo_offset));
+  // the first winner is not even read
+  EXPECT_LT(0, redo_offset);
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+
+  LogRecovery *log_recovery = new LogRecovery(disk_manager, bpm);
+  log_recovery->Redo();
+  EXPECT_EQ(checkpoint_lsn, log_recovery->GetCheckpointLSN());
+  page = static_cast<TablePage *>(bpm->FetchPage(page_ids[1]));
+  Tuple tuple;
+  EXPECT_TRUE(page->GetTuple(RID(page_ids[1], 0), tuple, nullptr, nullptr));
+  EXPECT_EQ(3, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+  EXPECT_FALSE(page->GetTuple(RID(page_ids[1], 1), tuple, nullptr, nullptr));
+  bpm->UnpinPage(page_ids[1], false);
+
+  log_recovery->Undo();
+  page = static_cast<TablePage *>(bpm->FetchPage(page_ids[0]));
+  EXPECT_FALSE(page->GetTuple(RID(page_ids[0], 0), tuple, nullptr, nullptr));
+  bpm->UnpinPage(page_ids[0], false);
+
+  delete log_recovery;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a batch is one INSERTBATCH record per page it fills, redone and rolled
+// back like the inserts it stands for
+TEST(LogManagerTest, AppendBatchTest) {
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 128, "b")};
+  Schema schema(columns);
+  remove("test.db");
+  remove("test.log");
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm =
+      new BufferPoolManager(10, disk_manager, log_manager);
+  LockManager *lock_manager = new LockManager(false);
+  TransactionManager *txn_manager =
+      new TransactionManager(lock_manager, log_manager);
+  ENABLE_LOGGING = true;
+  Transaction *txn = txn_manager->Begin();
+  TableHeap table(bpm, lock_manager, log_manager, txn);
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < 300; i++) {
+    tuples.push_back(
+        Tuple({Value(TypeId::INTEGER, i),
+               Value(TypeId::VARCHAR, std::string(100, 'a' + i % 26))},
+              &schema));
+  }
+  std::vector<RID> rids;
+  EXPECT_TRUE(table.AppendBatch(tuples, rids, txn));
+  ASSERT_EQ(tuples.size(), rids.size());
+  std::set<page_id_t> pages;
+  for (const RID &rid : rids) {
+    pages.insert(rid.GetPageId());
+  }
+  EXPECT_LT(5u, pages.size());
+  EXPECT_EQ(tuples.size(), txn->GetWriteSet()->size());
+  // never committed
+  log_manager->WaitForDurable(txn->GetPrevLSN());
+  ENABLE_LOGGING = false;
+  delete txn;
+  delete txn_manager;
+  delete lock_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  size_t batches = 0;
+  size_t batched = 0;
+  LogReader reader(disk_manager, disk_manager->GetLogStart());
+  for (auto &log_record : reader) {
+    EXPECT_NE(LogRecordType::INSERT, log_record.GetLogRecordType());
+    if (log_record.GetLogRecordType() == LogRecordType::INSERTBATCH) {
+      batches++;
+      batched += log_record.GetBatchTuples().size();
+    }
+  }
+  EXPECT_EQ(pages.size(), batches);
+  EXPECT_EQ(tuples.size(), batched);
+
+  bpm = new BufferPoolManager(10, disk_manager);
+  LogRecovery *log_recovery = new LogRecovery(disk_manager, bpm);
+  log_recovery->Redo();
+  Tuple tuple;
+  for (size_t i = 0; i < rids.size(); i++) {
+    auto page = static_cast<TablePage *>(bpm->FetchPage(rids[i].GetPageId()));
+    EXPECT_TRUE(page->GetTuple(rids[i], tuple, nullptr, nullptr));
+    EXPECT_EQ(static_cast<int32_t>(i),
+              tuple.GetValue(&schema, 0).GetAs<int32_t>());
+    bpm->UnpinPage(rids[i].GetPageId(), false);
+  }
+
+  log_recovery->Undo();
+  for (const RID &rid : rids) {
+    auto page = static_cast<TablePage *>(bpm->FetchPage(rid.GetPageId()));
+    EXPECT_FALSE(page->GetTuple(rid, tuple, nullptr, nullptr));
+    bpm->UnpinPage(rid.GetPageId(), false);
+  }
+
+  delete log_recovery;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
 } // namespace cmudb
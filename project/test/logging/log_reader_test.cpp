@@ -0,0 +1,117 @@
+/**
+ * log_reader_test.cpp
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "disk/disk_manager.h"
+#include "logging/log_manager.h"
+#include "logging/log_reader.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// records of varying size, flushed every so often so the log is many writes,
+// and more than one log file
+static void WriteLog(DiskManager *disk_manager, bool compress,
+                     std::vector<lsn_t> &lsns) {
+  LogManager *log_manager = new LogManager(disk_manager);
+  log_manager->SetCompression(compress);
+  for (int i = 0; i < 20000; ++i) {
+    LogRecord log_record;
+    if (i % 3 == 0) {
+      // every other one of a PAX page
+      std::vector<int32_t> column_widths(i % 2 == 0 ? 0 : 1 + i % 5, -4);
+      log_record = LogRecord(i, INVALID_LSN, LogRecordType::NEWPAGE, i, i + 1,
+                             column_widths);
+    } else {
+      std::vector<std::pair<page_id_t, lsn_t>> pages(i % 64, {i, i});
+      log_record = LogRecord(i, {}, pages);
+    }
+    lsns.push_back(log_manager->AppendLogRecord(log_record));
+    if (i % 100 == 99) {
+      log_manager->WaitForDurable(lsns.back());
+    }
+  }
+  log_manager->WaitForDurable(lsns.back());
+  delete log_manager;
+}
+
+static void CheckLog(DiskManager *disk_manager,
+                     const std::vector<lsn_t> &lsns) {
+  // the smallest chunk, most records and frames straddle two chunks
+  LogReader reader(disk_manager, disk_manager->GetLogStart(),
+                   LogReader::MAX_ENTRY_SIZE);
+  std::vector<LogPosition> positions;
+  for (auto it = reader.begin(); it != reader.end(); ++it) {
+    ASSERT_LT(positions.size(), lsns.size());
+    EXPECT_EQ(lsns[positions.size()], it->GetLSN());
+    // the record is reused, none has the pages of the one before
+    if (positions.size() % 3 != 0) {
+      EXPECT_EQ(positions.size() % 64, it->GetCheckpointPages().size());
+    } else {
+      EXPECT_TRUE(it->GetCheckpointPages().empty());
+    }
+    positions.push_back(it.GetPosition());
+  }
+  EXPECT_EQ(lsns.size(), positions.size());
+
+  // back to front, as undo reads the log
+  for (int i = static_cast<int>(positions.size()) - 1; i >= 0; --i) {
+    LogRecord log_record;
+    EXPECT_TRUE(reader.Read(positions[i], log_record));
+    EXPECT_EQ(lsns[i], log_record.GetLSN());
+    if (i % 3 == 0) {
+      EXPECT_EQ(LogRecordType::NEWPAGE, log_record.GetLogRecordType());
+      EXPECT_EQ(i + 1, log_record.GetNewPageId());
+      EXPECT_EQ(static_cast<size_t>(i % 2 == 0 ? 0 : 1 + i % 5),
+                log_record.GetColumnWidths().size());
+    } else {
+      EXPECT_EQ(static_cast<size_t>(i % 64),
+                log_record.GetCheckpointPages().size());
+    }
+  }
+
+  // reading on from a seek
+  size_t middle = positions.size() / 2;
+  while (positions[middle].frame_pos_ > 0) {
+    ++middle;
+  }
+  reader.Seek(positions[middle].offset_);
+  LogRecord log_record;
+  LogPosition position;
+  EXPECT_TRUE(reader.Next(log_record, position));
+  EXPECT_EQ(lsns[middle], log_record.GetLSN());
+}
+
+TEST(LogReaderTest, ReadTest) {
+  remove("test.log");
+  remove("test.log.1");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  std::vector<lsn_t> lsns;
+  WriteLog(disk_manager, false, lsns);
+  EXPECT_GT(disk_manager->GetLogSize(), LOG_FILE_SIZE);
+  CheckLog(disk_manager, lsns);
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.log.1");
+}
+
+TEST(LogReaderTest, CompressedReadTest) {
+  remove("test.log");
+  remove("test.log.1");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  std::vector<lsn_t> lsns;
+  WriteLog(disk_manager, true, lsns);
+  CheckLog(disk_manager, lsns);
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  remove("test.log.1");
+}
+
+} // namespace cmudb
@@ -0,0 +1,105 @@
+/**
+ * dictionary_test.cpp
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "table/dictionary.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(DictionaryTest, EncodeDecodeTest) {
+  remove("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t header_page_id;
+  bpm->NewPage(header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  // columns 1 and 3 of 4 are encoded
+  std::vector<std::string> statuses = {"new", "open", "closed"};
+  std::vector<int32_t> codes;
+  {
+    Dictionary dictionary("foo", bpm, 4, {1, 3});
+    EXPECT_FALSE(dictionary.IsEncoded(0));
+    EXPECT_TRUE(dictionary.IsEncoded(1));
+    EXPECT_TRUE(dictionary.IsEncoded(3));
+    EXPECT_FALSE(dictionary.IsEncoded(4));
+    for (int i = 0; i < 1000; i++) {
+      const std::string &status = statuses[i % statuses.size()];
+      int32_t code = dictionary.Encode(1, status.data(), status.size());
+      if (i < static_cast<int>(statuses.size()))
+        codes.push_back(code);
+      EXPECT_EQ(codes[i % statuses.size()], code);
+    }
+    EXPECT_EQ(statuses.size(), dictionary.GetSize(1));
+    // codes are per column
+    EXPECT_EQ(0, dictionary.Encode(3, "open", 4));
+    EXPECT_EQ(1u, dictionary.GetSize(3));
+
+    int32_t code;
+    EXPECT_TRUE(dictionary.Lookup(1, "closed", 6, code));
+    EXPECT_EQ(codes[2], code);
+    EXPECT_FALSE(dictionary.Lookup(1, "gone", 4, code));
+    EXPECT_FALSE(dictionary.Lookup(3, "new", 3, code));
+    EXPECT_EQ(statuses.size(), dictionary.GetSize(1));
+  }
+
+  // a dictionary of the same table has the strings of its pages
+  Dictionary dictionary("foo", bpm, 4, {1, 3});
+  EXPECT_EQ(statuses.size(), dictionary.GetSize(1));
+  EXPECT_EQ(1u, dictionary.GetSize(3));
+  for (size_t i = 0; i < statuses.size(); i++) {
+    const char *data;
+    uint32_t length;
+    ASSERT_TRUE(dictionary.Decode(1, codes[i], data, length));
+    EXPECT_EQ(statuses[i], std::string(data, length));
+  }
+  const char *data;
+  uint32_t length;
+  EXPECT_FALSE(dictionary.Decode(1, -1, data, length));
+  EXPECT_FALSE(dictionary.Decode(1, 3, data, length));
+  // new strings go after them
+  EXPECT_EQ(3, dictionary.Encode(1, "gone", 4));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(DictionaryTest, ManyPagesTest) {
+  remove("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t header_page_id;
+  bpm->NewPage(header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  // more strings than a page holds
+  const int count = 2000;
+  {
+    Dictionary dictionary("foo", bpm, 1, {0});
+    for (int i = 0; i < count; i++) {
+      std::string string = "category " + std::to_string(i);
+      EXPECT_EQ(i, dictionary.Encode(0, string.data(), string.size()));
+    }
+  }
+  Dictionary dictionary("foo", bpm, 1, {0});
+  EXPECT_EQ(static_cast<size_t>(count), dictionary.GetSize(0));
+  for (int i = 0; i < count; i++) {
+    std::string string = "category " + std::to_string(i);
+    int32_t code;
+    ASSERT_TRUE(dictionary.Lookup(0, string.data(), string.size(), code));
+    EXPECT_EQ(i, code);
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
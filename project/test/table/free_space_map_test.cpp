@@ -0,0 +1,142 @@
+/**
+ * free_space_map_test.cpp
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "table/free_space_map.h"
+#include "table/table_heap.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+class FreeSpaceMapTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    remove("test.db");
+    ENABLE_LOGGING = false;
+    disk_manager_ = new DiskManager("test.db");
+    bpm_ = new BufferPoolManager(50, disk_manager_);
+    lock_manager_ = new LockManager(false);
+    txn_mgr_ = new TransactionManager(lock_manager_);
+    page_id_t header_page_id;
+    bpm_->NewPage(header_page_id);
+    bpm_->UnpinPage(header_page_id, true);
+    std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                   Column(TypeId::VARCHAR, 200, "b")};
+    schema_ = new Schema(columns);
+    Transaction *txn = txn_mgr_->Begin();
+    table_ = new TableHeap(bpm_, lock_manager_, nullptr, txn);
+    txn_mgr_->Commit(txn);
+    delete txn;
+  }
+
+  void TearDown() override {
+    delete table_;
+    delete schema_;
+    delete txn_mgr_;
+    delete lock_manager_;
+    delete bpm_;
+    delete disk_manager_;
+    remove("test.db");
+  }
+
+  // count tuples of about 200 bytes, page fetches per insert on average
+  double Insert(int count, std::vector<RID> &rids) {
+    bpm_->ResetStats();
+    Transaction *txn = txn_mgr_->Begin();
+    for (int i = 0; i < count; i++) {
+      std::vector<Value> values = {
+          Value(TypeId::INTEGER, i),
+          Value(TypeId::VARCHAR, std::string(190, 'x'))};
+      Tuple tuple(values, schema_);
+      RID rid;
+      EXPECT_TRUE(table_->InsertTuple(tuple, rid, txn));
+      rids.push_back(rid);
+    }
+    txn_mgr_->Commit(txn);
+    delete txn;
+    BufferPoolStats stats = bpm_->GetStats();
+    return static_cast<double>(stats.hits + stats.misses) / count;
+  }
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *bpm_;
+  LockManager *lock_manager_;
+  TransactionManager *txn_mgr_;
+  Schema *schema_;
+  TableHeap *table_;
+};
+
+/*
+ * Inserts go to the last page instead of walking the chain, and to pages
+ * deletes made room in
+ */
+TEST_F(FreeSpaceMapTest, InsertTest) {
+  std::vector<RID> rids;
+  double walking = Insert(4000, rids);
+  FreeSpaceMap *map = new FreeSpaceMap("foo", bpm_, table_->GetFirstPageId());
+  table_->SetFreeSpaceMap(map);
+  size_t pages = map->GetPageCount();
+  EXPECT_LT(100u, pages);
+  double mapped = Insert(4000, rids);
+  printf("page fetches per insert: %.1f walking the chain, %.1f with the "
+         "map\n",
+         walking, mapped);
+  EXPECT_LT(mapped, 3.0);
+  EXPECT_LT(mapped * 10, walking);
+  EXPECT_LT(pages, map->GetPageCount());
+
+  // a page in the middle gets room again
+  page_id_t page_id = rids[2000].GetPageId();
+  Transaction *txn = txn_mgr_->Begin();
+  for (const RID &rid : rids) {
+    if (rid.GetPageId() == page_id) {
+      EXPECT_TRUE(table_->MarkDelete(rid, txn));
+    }
+  }
+  txn_mgr_->Commit(txn);
+  delete txn;
+  EXPECT_LT(1000, map->GetFree(page_id));
+  std::vector<RID> more;
+  Insert(3, more);
+  for (const RID &rid : more) {
+    EXPECT_EQ(page_id, rid.GetPageId());
+  }
+  table_->SetFreeSpaceMap(nullptr);
+  delete map;
+}
+
+/*
+ * A map closed cleanly is read back, one that was not is built again from
+ * the chain
+ */
+TEST_F(FreeSpaceMapTest, ReopenTest) {
+  std::vector<RID> rids;
+  FreeSpaceMap *map = new FreeSpaceMap("foo", bpm_, table_->GetFirstPageId());
+  table_->SetFreeSpaceMap(map);
+  Insert(3000, rids);
+  size_t pages = map->GetPageCount();
+  int32_t free = map->GetFree(rids.back().GetPageId());
+  table_->SetFreeSpaceMap(nullptr);
+  delete map;
+
+  map = new FreeSpaceMap("foo", bpm_, table_->GetFirstPageId());
+  EXPECT_EQ(pages, map->GetPageCount());
+  EXPECT_EQ(free, map->GetFree(rids.back().GetPageId()));
+  EXPECT_EQ(rids.back().GetPageId(), map->GetLastPageId());
+
+  // still open, as after a crash
+  FreeSpaceMap rebuilt("foo", bpm_, table_->GetFirstPageId());
+  EXPECT_EQ(pages, rebuilt.GetPageCount());
+  EXPECT_EQ(free, rebuilt.GetFree(rids.back().GetPageId()));
+  EXPECT_EQ(INVALID_PAGE_ID, rebuilt.FindPage(4000));
+  EXPECT_EQ(rids.back().GetPageId(), rebuilt.FindPage(free));
+  delete map;
+}
+
+} // namespace cmudb
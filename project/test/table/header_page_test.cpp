@@ -50,9 +50,62 @@ TEST(HeaderPageTest, UnitTest) {
 
   EXPECT_EQ(page->GetRecordCount(), 0);
 
+  // log offsets past 2 GiB
+  int64_t value;
+  EXPECT_TRUE(page->SetWideRecord("offset", 5000000000LL));
+  EXPECT_TRUE(page->GetWideRecord("offset", value));
+  EXPECT_EQ(5000000000LL, value);
+  EXPECT_TRUE(page->SetWideRecord("offset", 7));
+  EXPECT_TRUE(page->GetWideRecord("offset", value));
+  EXPECT_EQ(7, value);
+  EXPECT_FALSE(page->GetWideRecord("missing", value));
+
   delete buffer_pool_manager;
   delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
+
+TEST(HeaderPageTest, PageSizeTest) {
+  for (size_t page_size : {4096u, 8192u, 16384u}) {
+    DiskManager *disk_manager = new DiskManager("test.db", page_size);
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(4, disk_manager);
+    EXPECT_EQ(page_size, buffer_pool_manager->GetPageSize());
+    page_id_t header_page_id;
+    HeaderPage *page =
+        static_cast<HeaderPage *>(buffer_pool_manager->NewPage(header_page_id));
+    ASSERT_NE(nullptr, page);
+    page->Init();
+    EXPECT_EQ(page_size, page->GetRecordedPageSize());
+
+    // fill the header page up to its real size
+    int records = 0;
+    while (page->InsertRecord(std::to_string(records), records + 1)) {
+      ++records;
+    }
+    EXPECT_EQ(static_cast<int>((page_size - 8) / 36), records);
+    buffer_pool_manager->UnpinPage(header_page_id, true);
+    buffer_pool_manager->FlushPage(header_page_id);
+    delete buffer_pool_manager;
+    delete disk_manager;
+
+    // reopening ignores the requested size, the header page decides
+    disk_manager = new DiskManager("test.db", 4096);
+    EXPECT_EQ(page_size, disk_manager->GetPageSize());
+    buffer_pool_manager = new BufferPoolManager(4, disk_manager);
+    page = static_cast<HeaderPage *>(
+        buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(records, page->GetRecordCount());
+    page_id_t root_id;
+    EXPECT_EQ(true, page->GetRootId(std::to_string(records - 1), root_id));
+    EXPECT_EQ(records, root_id);
+    buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
+    delete buffer_pool_manager;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+}
 } // namespace cmudb
@@ -0,0 +1,491 @@
+/**
+ * table_heap_test.cpp
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "table/morsel_cursor.h"
+#include "table/table_heap.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+/*
+ * Workers sharing a morsel cursor see every tuple once between them
+ */
+TEST(TableHeapTest, ParallelScanTest) {
+  remove("test.db");
+  ENABLE_LOGGING = false;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  LockManager lock_manager(false);
+  TransactionManager txn_manager(&lock_manager, nullptr);
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 100, "b")};
+  Schema schema(columns);
+
+  Transaction *txn = txn_manager.Begin();
+  TableHeap table(bpm, &lock_manager, nullptr, txn);
+  const int count = 2000;
+  RID rid;
+  for (int i = 0; i < count; i++) {
+    Tuple tuple({Value(TypeId::INTEGER, i),
+                 Value(TypeId::VARCHAR, std::string(100, 'a' + i % 26))},
+                &schema);
+    ASSERT_TRUE(table.InsertTuple(tuple, rid, txn));
+  }
+  txn_manager.Commit(txn);
+  delete txn;
+  // more pages than frames, more morsels than workers
+  ASSERT_LT(40, rid.GetPageId() - table.GetFirstPageId());
+
+  std::mutex latch;
+  std::multiset<int> seen;
+  std::atomic<int> workers(0);
+  table.ParallelScan(4,
+                     [&](int worker, const Tuple &tuple) {
+                       std::lock_guard<std::mutex> guard(latch);
+                       seen.insert(tuple.GetValue(&schema, 0).GetAs<int32_t>());
+                       workers |= 1 << worker;
+                     },
+                     2);
+  ASSERT_EQ(static_cast<size_t>(count), seen.size());
+  for (int i = 0; i < count; i++) {
+    EXPECT_EQ(1u, seen.count(i));
+  }
+  EXPECT_EQ(0, workers & ~0xf);
+  EXPECT_EQ(static_cast<size_t>(count), table.CountTuples());
+
+  // a cursor of its own hands out every page once, then nothing
+  MorselCursor cursor(&table, 3);
+  std::vector<Tuple> tuples;
+  size_t copied = 0;
+  while (cursor.Next(tuples)) {
+    copied += tuples.size();
+  }
+  EXPECT_EQ(static_cast<size_t>(count), copied);
+  EXPECT_FALSE(cursor.Next(tuples));
+  EXPECT_TRUE(tuples.empty());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+/*
+ * Batches come in scan order, a page at a time, with what the transaction
+ * sees of it
+ */
+TEST(TableHeapTest, BatchIteratorTest) {
+  remove("test.db");
+  ENABLE_LOGGING = false;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  LockManager lock_manager(false);
+  TransactionManager txn_manager(&lock_manager, nullptr);
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 40, "b")};
+  Schema schema(columns);
+
+  Transaction *txn = txn_manager.Begin();
+  TableHeap table(bpm, &lock_manager, nullptr, txn);
+  const int count = 500;
+  std::vector<RID> rids;
+  RID rid;
+  for (int i = 0; i < count; i++) {
+    Tuple tuple({Value(TypeId::INTEGER, i),
+                 Value(TypeId::VARCHAR, std::string(40, 'a' + i % 26))},
+                &schema);
+    ASSERT_TRUE(table.InsertTuple(tuple, rid, txn));
+    rids.push_back(rid);
+  }
+  // a page with nothing left on it is passed over
+  page_id_t empty_page_id = rids[count / 2].GetPageId();
+  for (int i = 0; i < count; i++) {
+    if (i % 3 == 0 || rids[i].GetPageId() == empty_page_id) {
+      table.ApplyDelete(rids[i], txn);
+    }
+  }
+  txn_manager.Commit(txn);
+  delete txn;
+
+  std::vector<int> expected;
+  for (auto it = table.begin(nullptr); it != table.end(); ++it) {
+    expected.push_back(it->GetValue(&schema, 0).GetAs<int32_t>());
+  }
+  ASSERT_LT(100u, expected.size());
+
+  TableBatchIterator batches(&table, nullptr);
+  std::vector<Tuple> tuples;
+  std::vector<int> read;
+  while (batches.Next(tuples, 7)) {
+    ASSERT_LE(tuples.size(), 7u);
+    ASSERT_FALSE(tuples.empty());
+    for (const Tuple &tuple : tuples) {
+      EXPECT_EQ(tuples[0].GetRid().GetPageId(), tuple.GetRid().GetPageId());
+      EXPECT_NE(empty_page_id, tuple.GetRid().GetPageId());
+      read.push_back(tuple.GetValue(&schema, 0).GetAs<int32_t>());
+    }
+  }
+  EXPECT_EQ(expected, read);
+  EXPECT_FALSE(batches.Next(tuples));
+  EXPECT_TRUE(tuples.empty());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+/*
+ * A filtered scan returns the tuples matching all the predicates, nulls
+ * never, selected by page in place or checked on the copies of a snapshot
+ */
+TEST(TableHeapTest, FilterTest) {
+  remove("test.db");
+  ENABLE_LOGGING = false;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  LockManager lock_manager(false);
+  TransactionManager txn_manager(&lock_manager, nullptr);
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 40, "b"),
+                                 Column(TypeId::BIGINT, 8, "c")};
+  Schema schema(columns);
+  std::vector<ScanPredicate> predicates = {
+      ScanPredicate(0, BatchCmp::GE, Value(TypeId::INTEGER, 100)),
+      ScanPredicate(0, BatchCmp::LT, Value(TypeId::INTEGER, 400)),
+      ScanPredicate(2, BatchCmp::NE,
+                    Value(TypeId::BIGINT, static_cast<int64_t>(600)))};
+
+  for (bool pax : {false, true}) {
+    Transaction *txn = txn_manager.Begin();
+    TableHeap table(bpm, &lock_manager, nullptr, txn,
+                    pax ? TablePage::GetPaxLayout(&schema)
+                        : std::vector<int32_t>());
+    const int count = 500;
+    std::vector<RID> rids;
+    RID rid;
+    for (int i = 0; i < count; i++) {
+      int32_t a = i % 7 == 0 ? PELOTON_INT32_NULL : i;
+      Tuple tuple({Value(TypeId::INTEGER, a),
+                   Value(TypeId::VARCHAR, std::string(i % 40, 'a')),
+                   Value(TypeId::BIGINT, static_cast<int64_t>(i) * 3)},
+                  &schema);
+      ASSERT_TRUE(table.InsertTuple(tuple, rid, txn));
+      rids.push_back(rid);
+    }
+    for (int i = 0; i < count; i += 5) {
+      table.ApplyDelete(rids[i], txn);
+    }
+    txn_manager.Commit(txn);
+    delete txn;
+    std::set<int> expected;
+    for (int i = 100; i < 400; i++) {
+      if (i % 7 != 0 && i % 5 != 0 && i != 200)
+        expected.insert(i);
+    }
+
+    std::set<int> read;
+    ScanFilter filter(&schema, predicates);
+    for (auto it = table.begin(nullptr, false, filter); it != table.end();
+         ++it) {
+      int a = it.GetValue(&schema, 0).GetAs<int32_t>();
+      EXPECT_TRUE(read.insert(a).second);
+      EXPECT_EQ(static_cast<int64_t>(a) * 3,
+                it.GetValue(&schema, 2).GetAs<int64_t>());
+    }
+    EXPECT_EQ(expected, read);
+
+    // copies, by a snapshot
+    VersionStore version_store;
+    table.SetVersionStore(&version_store);
+    txn = txn_manager.Begin();
+    read.clear();
+    for (auto it = table.begin(txn, false, filter); it != table.end();
+         ++it) {
+      read.insert(it->GetValue(&schema, 0).GetAs<int32_t>());
+    }
+    EXPECT_EQ(expected, read);
+    txn_manager.Commit(txn);
+    delete txn;
+    table.SetVersionStore(nullptr);
+
+    ScanFilter none(&schema, {ScanPredicate(0, BatchCmp::GT,
+                                            Value(TypeId::INTEGER, 1000))});
+    EXPECT_TRUE(table.begin(nullptr, false, none) == table.end());
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+/*
+ * A table created with a PAX layout keeps it on every page
+ */
+TEST(TableHeapTest, PaxTest) {
+  remove("test.db");
+  ENABLE_LOGGING = false;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  LockManager lock_manager(false);
+  TransactionManager txn_manager(&lock_manager, nullptr);
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 40, "b"),
+                                 Column(TypeId::BIGINT, 8, "c")};
+  Schema schema(columns);
+  std::vector<int32_t> layout = TablePage::GetPaxLayout(&schema);
+  EXPECT_LT(0, TablePage::GetPaxCapacity(layout, bpm->GetPageSize()));
+  // no row of a page size fits
+  EXPECT_EQ(0, TablePage::GetPaxCapacity(
+                   {4, -static_cast<int32_t>(bpm->GetPageSize())},
+                   bpm->GetPageSize()));
+
+  Transaction *txn = txn_manager.Begin();
+  TableHeap table(bpm, &lock_manager, nullptr, txn, layout);
+  const int count = 500;
+  RID rid;
+  for (int i = 0; i < count; i++) {
+    Tuple tuple({Value(TypeId::INTEGER, i),
+                 Value(TypeId::VARCHAR, std::string(i % 40, 'a' + i % 26)),
+                 Value(TypeId::BIGINT, static_cast<int64_t>(i) * 3)},
+                &schema);
+    ASSERT_TRUE(table.InsertTuple(tuple, rid, txn));
+  }
+  txn_manager.Commit(txn);
+  delete txn;
+  ASSERT_LT(2, rid.GetPageId() - table.GetFirstPageId());
+  page_id_t page_id = table.GetFirstPageId();
+  while (page_id != INVALID_PAGE_ID) {
+    auto page = static_cast<TablePage *>(bpm->FetchPage(page_id));
+    EXPECT_EQ(layout, page->GetColumnWidths());
+    bpm->UnpinPage(page_id, false);
+    page_id = page->GetNextPageId();
+  }
+
+  // short tuples may go to earlier pages, the order is not kept
+  int scanned = 0;
+  for (auto it = table.begin(nullptr); it != table.end(); ++it, ++scanned) {
+    int i = it.GetValue(&schema, 0).GetAs<int32_t>();
+    EXPECT_EQ(static_cast<int64_t>(i) * 3,
+              it.GetValue(&schema, 2).GetAs<int64_t>());
+    EXPECT_EQ(std::string(i % 40, 'a' + i % 26),
+              it->GetValue(&schema, 1).ToString());
+    Tuple tuple;
+    ASSERT_TRUE(table.GetTuple(it.GetRid(), tuple, nullptr));
+    EXPECT_EQ(i, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+    // or in place, a column at a time
+    TupleView view;
+    ASSERT_TRUE(table.ViewTuple(it.GetRid(), view, nullptr));
+    int64_t c = 0;
+    EXPECT_TRUE(view.GetFixed(&schema, 2, c));
+    EXPECT_EQ(static_cast<int64_t>(i) * 3, c);
+    std::string b;
+    auto read = [&](const char *data, uint32_t len) { b.assign(data, len); };
+    ASSERT_TRUE(view.ReadString(&schema, 1, read));
+    EXPECT_EQ(std::string(i % 40, 'a' + i % 26), b);
+  }
+  EXPECT_EQ(count, scanned);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+/*
+ * Varchars longer than a page go to overflow chains, the tuple keeps a stub
+ */
+TEST(TableHeapTest, OverflowTest) {
+  remove("test.db");
+  ENABLE_LOGGING = false;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  LockManager lock_manager(false);
+  TransactionManager txn_manager(&lock_manager, nullptr);
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 100000, "b"),
+                                 Column(TypeId::VARCHAR, 100, "c")};
+  Schema schema(columns);
+  size_t page_size = bpm->GetPageSize();
+  auto make_tuple = [&](int a, size_t length) {
+    return Tuple({Value(TypeId::INTEGER, a),
+                  Value(TypeId::VARCHAR, std::string(length, 'a' + a % 26)),
+                  Value(TypeId::VARCHAR, "short")},
+                 &schema);
+  };
+
+  Transaction *txn = txn_manager.Begin();
+  TableHeap table(bpm, &lock_manager, nullptr, txn);
+  RID rid;
+  // too large without a schema
+  EXPECT_FALSE(table.InsertTuple(make_tuple(0, 3 * page_size), rid, txn));
+  txn_manager.Abort(txn);
+  delete txn;
+
+  table.SetSchema(&schema);
+  txn = txn_manager.Begin();
+  std::vector<RID> rids;
+  for (int i = 0; i < 5; i++) {
+    Tuple tuple = make_tuple(i, (i + 1) * page_size);
+    ASSERT_TRUE(table.InsertTuple(tuple, rid, txn));
+    rids.push_back(rid);
+  }
+  // a short one stays whole
+  ASSERT_TRUE(table.InsertTuple(make_tuple(5, 10), rid, txn));
+  rids.push_back(rid);
+  txn_manager.Commit(txn);
+  delete txn;
+
+  txn = txn_manager.Begin();
+  for (int i = 0; i < 6; i++) {
+    Tuple tuple;
+    ASSERT_TRUE(table.GetTuple(rids[i], tuple, txn));
+    EXPECT_GT(static_cast<int32_t>(page_size / 4), tuple.GetLength());
+    EXPECT_EQ(i, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+    EXPECT_EQ("short", tuple.GetValue(&schema, 2).ToString());
+    size_t length = i < 5 ? (i + 1) * page_size : 10;
+    EXPECT_EQ(std::string(length, 'a' + i % 26),
+              tuple.GetValue(&schema, 1).ToString());
+    EXPECT_EQ(i < 5 ? 1u : 0u, tuple.GetOverflowPages(&schema).size());
+  }
+  // scans read the chains in place, updates spill as inserts do
+  int scanned = 0;
+  for (auto it = table.begin(txn); it != table.end(); ++it, ++scanned) {
+    EXPECT_EQ(rids[scanned], it.GetRid());
+    EXPECT_EQ(std::string(scanned < 5 ? (scanned + 1) * page_size : 10,
+                          'a' + scanned % 26),
+              it.GetValue(&schema, 1).ToString());
+  }
+  EXPECT_EQ(6, scanned);
+  ASSERT_TRUE(table.UpdateTuple(make_tuple(5, 2 * page_size), rids[5], txn));
+  Tuple tuple;
+  ASSERT_TRUE(table.GetTuple(rids[5], tuple, txn));
+  EXPECT_EQ(std::string(2 * page_size, 'f'),
+            tuple.GetValue(&schema, 1).ToString());
+  txn_manager.Commit(txn);
+  delete txn;
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+/*
+ * An update growing past the room of its page spills to keep its rid
+ */
+TEST(TableHeapTest, UpdateInPlaceTest) {
+  remove("test.db");
+  ENABLE_LOGGING = false;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  LockManager lock_manager(false);
+  TransactionManager txn_manager(&lock_manager, nullptr);
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 2000, "b")};
+  Schema schema(columns);
+  auto make_tuple = [&](int a, size_t length) {
+    return Tuple({Value(TypeId::INTEGER, a),
+                  Value(TypeId::VARCHAR, std::string(length, 'a' + a % 26))},
+                 &schema);
+  };
+
+  Transaction *txn = txn_manager.Begin();
+  TableHeap table(bpm, &lock_manager, nullptr, txn);
+  table.SetSchema(&schema);
+  // fill the first page
+  std::vector<RID> rids;
+  RID rid;
+  for (int i = 0; i < 32; i++) {
+    ASSERT_TRUE(table.InsertTuple(make_tuple(i, 200), rid, txn));
+    rids.push_back(rid);
+  }
+  ASSERT_NE(rids.front().GetPageId(), rids.back().GetPageId());
+  RID first = rids.front();
+
+  // not spilled on its own, too large for the room of the page
+  Tuple grown = make_tuple(0, 900);
+  ASSERT_TRUE(table.UpdateTuple(grown, first, txn));
+  txn_manager.Commit(txn);
+  delete txn;
+  Tuple tuple;
+  ASSERT_TRUE(table.GetTuple(first, tuple, nullptr));
+  EXPECT_EQ(std::string(900, 'a'), tuple.GetValue(&schema, 1).ToString());
+  EXPECT_EQ(1u, tuple.GetOverflowPages(&schema).size());
+  for (size_t i = 1; i < rids.size(); i++) {
+    ASSERT_TRUE(table.GetTuple(rids[i], tuple, nullptr));
+    EXPECT_EQ(static_cast<int>(i), tuple.GetValue(&schema, 0).GetAs<int>());
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+/*
+ * The chains an update replaces go at commit, those of an update rolled
+ * back at abort
+ */
+TEST(TableHeapTest, UpdateFreesChainsTest) {
+  remove("test.db");
+  ENABLE_LOGGING = false;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  LockManager lock_manager(false);
+  TransactionManager txn_manager(&lock_manager, nullptr);
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 100000, "b")};
+  Schema schema(columns);
+  size_t page_size = bpm->GetPageSize();
+  auto make_tuple = [&](int a, size_t length) {
+    return Tuple({Value(TypeId::INTEGER, a),
+                  Value(TypeId::VARCHAR, std::string(length, 'a' + a % 26))},
+                 &schema);
+  };
+
+  Transaction *txn = txn_manager.Begin();
+  TableHeap table(bpm, &lock_manager, nullptr, txn);
+  table.SetSchema(&schema);
+  RID rid;
+  ASSERT_TRUE(table.InsertTuple(make_tuple(0, 2 * page_size), rid, txn));
+  txn_manager.Commit(txn);
+  delete txn;
+
+  auto free_pages_now = [&]() {
+    // pages deleted are given back to the disk manager in batches
+    bpm->FlushAllPages();
+    return disk_manager->GetFreePageCount();
+  };
+  size_t free_pages = free_pages_now();
+  txn = txn_manager.Begin();
+  ASSERT_TRUE(table.UpdateTuple(make_tuple(1, 2 * page_size), rid, txn));
+  // the old version may still be rolled back to
+  EXPECT_EQ(free_pages, free_pages_now());
+  txn_manager.Commit(txn);
+  delete txn;
+  EXPECT_LT(free_pages, free_pages_now());
+
+  free_pages = free_pages_now();
+  txn = txn_manager.Begin();
+  ASSERT_TRUE(table.UpdateTuple(make_tuple(2, 2 * page_size), rid, txn));
+  txn_manager.Abort(txn);
+  delete txn;
+  // what the update spilled is reused or free again
+  EXPECT_LE(free_pages, free_pages_now());
+  Tuple tuple;
+  ASSERT_TRUE(table.GetTuple(rid, tuple, nullptr));
+  EXPECT_EQ(std::string(2 * page_size, 'b'),
+            tuple.GetValue(&schema, 1).ToString());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
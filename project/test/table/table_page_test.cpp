@@ -0,0 +1,187 @@
+/**
+ * table_page_test.cpp
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "page/table_page.h"
+#include "table/tuple_view.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+class TablePageTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    remove("test.db");
+    ENABLE_LOGGING = false;
+    disk_manager_ = new DiskManager("test.db");
+    bpm_ = new BufferPoolManager(10, disk_manager_);
+    std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                   Column(TypeId::VARCHAR, 400, "b")};
+    schema_ = new Schema(columns);
+    page_ = static_cast<TablePage *>(bpm_->NewPage(page_id_));
+    page_->Init(page_id_, bpm_->GetPageSize(), INVALID_PAGE_ID, nullptr,
+                nullptr);
+  }
+
+  void TearDown() override {
+    bpm_->UnpinPage(page_id_, true);
+    delete schema_;
+    delete bpm_;
+    delete disk_manager_;
+    remove("test.db");
+  }
+
+  Tuple MakeTuple(int a, size_t length) {
+    return Tuple({Value(TypeId::INTEGER, a),
+                  Value(TypeId::VARCHAR, std::string(length, 'a' + a % 26))},
+                 schema_);
+  }
+
+  void CheckTuple(const RID &rid, int a, size_t length) {
+    Tuple tuple;
+    ASSERT_TRUE(page_->GetTuple(rid, tuple, nullptr, nullptr));
+    EXPECT_EQ(a, tuple.GetValue(schema_, 0).GetAs<int32_t>());
+    EXPECT_EQ(std::string(length, 'a' + a % 26),
+              tuple.GetValue(schema_, 1).ToString());
+  }
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *bpm_;
+  Schema *schema_;
+  page_id_t page_id_;
+  TablePage *page_;
+};
+
+/*
+ * Space deletes free between the tuples goes to inserts that need more than
+ * is in front of the tuples, into the slots the deletes left
+ */
+TEST_F(TablePageTest, InsertCompactTest) {
+  std::vector<RID> rids;
+  RID rid;
+  while (page_->InsertTuple(MakeTuple(rids.size(), 100), rid, nullptr,
+                            nullptr, nullptr)) {
+    rids.push_back(rid);
+  }
+  ASSERT_LT(10u, rids.size());
+  for (size_t i = 0; i < rids.size(); i += 2) {
+    page_->ApplyDelete(rids[i], nullptr, nullptr);
+  }
+  int32_t free_space = page_->GetFreeSpaceSize();
+  EXPECT_LT(static_cast<int32_t>(rids.size() / 2 * 100), free_space);
+
+  // each twice the size of a deleted one, in a slot of one
+  int inserted = 0;
+  while (page_->InsertTuple(MakeTuple(1000 + inserted, 200), rid, nullptr,
+                            nullptr, nullptr)) {
+    EXPECT_EQ(0, rid.GetSlotNum() % 2);
+    inserted++;
+  }
+  EXPECT_LE(static_cast<int>(rids.size() / 4), inserted);
+  EXPECT_GT(MakeTuple(0, 200).GetLength(), page_->GetFreeSpaceSize());
+  for (size_t i = 1; i < rids.size(); i += 2) {
+    CheckTuple(rids[i], i, 100);
+  }
+  for (int i = 0; i < inserted; i++) {
+    CheckTuple(RID(page_id_, 2 * i), 1000 + i, 200);
+  }
+}
+
+/*
+ * Updates stay in place unless they grow, and compact the page if they grow
+ * past what is in front of the tuples
+ */
+TEST_F(TablePageTest, UpdateCompactTest) {
+  std::vector<RID> rids;
+  RID rid;
+  while (page_->InsertTuple(MakeTuple(rids.size(), 100), rid, nullptr,
+                            nullptr, nullptr)) {
+    rids.push_back(rid);
+  }
+  ASSERT_LT(10u, rids.size());
+  Tuple old_tuple;
+  // shrinking leaves dead bytes behind every other tuple
+  for (size_t i = 0; i < rids.size(); i += 2) {
+    EXPECT_TRUE(page_->UpdateTuple(MakeTuple(i, 40), old_tuple, rids[i],
+                                   nullptr, nullptr, nullptr));
+  }
+  // growing the others only fits once they are squeezed out
+  size_t grown = 0;
+  for (size_t i = 1; i < rids.size(); i += 2) {
+    if (!page_->UpdateTuple(MakeTuple(i, 180), old_tuple, rids[i], nullptr,
+                            nullptr, nullptr)) {
+      break;
+    }
+    grown++;
+  }
+  EXPECT_LT(rids.size() / 4, grown);
+  EXPECT_GT(80, page_->GetFreeSpaceSize());
+  for (size_t i = 0; i < rids.size(); i++) {
+    if (i % 2 == 0) {
+      CheckTuple(rids[i], i, 40);
+    } else {
+      CheckTuple(rids[i], i, i / 2 < grown ? 180 : 100);
+    }
+  }
+}
+
+/*
+ * A PAX page keeps the columns apart and the tuples whole to its readers
+ */
+TEST_F(TablePageTest, PaxTest) {
+  std::vector<int32_t> layout = TablePage::GetPaxLayout(schema_);
+  ASSERT_EQ(2u, layout.size());
+  EXPECT_LT(0, layout[0]);
+  EXPECT_GT(0, layout[1]);
+  page_->Init(page_id_, bpm_->GetPageSize(), INVALID_PAGE_ID, nullptr,
+              nullptr, layout);
+  EXPECT_EQ(layout, page_->GetColumnWidths());
+
+  std::vector<RID> rids;
+  std::vector<size_t> lengths;
+  RID rid;
+  while (page_->InsertTuple(MakeTuple(rids.size(), 20 + rids.size() % 7),
+                            rid, nullptr, nullptr, nullptr)) {
+    rids.push_back(rid);
+    lengths.push_back(20 + lengths.size() % 7);
+  }
+  ASSERT_LT(10u, rids.size());
+  for (size_t i = 0; i < rids.size(); i++) {
+    CheckTuple(rids[i], i, lengths[i]);
+    TupleView view(bpm_, rids[i]);
+    EXPECT_EQ(static_cast<int32_t>(i),
+              view.GetValue(schema_, 0).GetAs<int32_t>());
+    EXPECT_EQ(std::string(lengths[i], 'a' + i % 26),
+              view.GetValue(schema_, 1).ToString());
+  }
+
+  // freed slots and payload space go to new tuples, updates move payloads
+  for (size_t i = 0; i < rids.size(); i += 2) {
+    page_->ApplyDelete(rids[i], nullptr, nullptr);
+  }
+  Tuple old_tuple;
+  for (size_t i = 1; i < rids.size(); i += 4) {
+    ASSERT_TRUE(page_->UpdateTuple(MakeTuple(i, 30), old_tuple, rids[i],
+                                   nullptr, nullptr, nullptr));
+    lengths[i] = 30;
+  }
+  for (size_t i = 0; i < rids.size(); i += 2) {
+    ASSERT_TRUE(page_->InsertTuple(MakeTuple(1000 + i, 10), rid, nullptr,
+                                   nullptr, nullptr));
+    EXPECT_EQ(rids[i], rid);
+  }
+  for (size_t i = 0; i < rids.size(); i++) {
+    if (i % 2 == 0) {
+      CheckTuple(rids[i], 1000 + i, 10);
+    } else {
+      CheckTuple(rids[i], i, lengths[i]);
+    }
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,77 @@
+/**
+ * table_stats_test.cpp
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "table/table_heap.h"
+#include "table/table_stats.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(TableStatsTest, GatherTest) {
+  remove("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(20, disk_manager);
+  LockManager lock_manager(false);
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::INTEGER, 4, "b"),
+                                 Column(TypeId::VARCHAR, 20, "c")};
+  Schema schema(columns);
+  Transaction txn(0);
+  TableHeap table(bpm, &lock_manager, nullptr, &txn);
+  // a unique, b of 10 values, c of 4
+  const int count = 5000;
+  RID rid;
+  for (int i = 0; i < count; i++) {
+    Tuple tuple({Value(TypeId::INTEGER, i), Value(TypeId::INTEGER, i % 10),
+                 Value(TypeId::VARCHAR, std::string(1 + i % 4, 'c'))},
+                &schema);
+    ASSERT_TRUE(table.InsertTuple(tuple, rid, &txn));
+  }
+
+  TableStats stats(&schema, bpm->GetPageSize(), 500);
+  stats.Gather(&table);
+  EXPECT_EQ(static_cast<size_t>(count), stats.GetRowCount());
+  EXPECT_EQ(static_cast<size_t>(rid.GetPageId() - table.GetFirstPageId() + 1),
+            stats.GetPageCount());
+  EXPECT_EQ(10, stats.GetColumnStats(1).distinct_count);
+  EXPECT_EQ(4, stats.GetColumnStats(2).distinct_count);
+  double distinct = stats.GetColumnStats(0).distinct_count;
+  EXPECT_LT(count / 4, distinct);
+  EXPECT_GT(count * 4, distinct);
+  EXPECT_EQ(static_cast<size_t>(STATS_HISTOGRAM_BUCKETS),
+            stats.GetColumnStats(0).bounds.size());
+
+  EXPECT_NEAR(0.1, stats.EstimateEquals(1), 0.01);
+  EXPECT_NEAR(0.1, stats.EstimateEquals(1, Value(TypeId::INTEGER, 3)), 0.05);
+  EXPECT_GT(0.01, stats.EstimateEquals(0, Value(TypeId::INTEGER, 42)));
+  Value low(TypeId::INTEGER, count / 4);
+  Value high(TypeId::INTEGER, count * 3 / 4);
+  EXPECT_NEAR(0.5, stats.EstimateRange(0, &low, &high), 0.15);
+  EXPECT_NEAR(0.75, stats.EstimateRange(0, &low, nullptr), 0.15);
+  EXPECT_NEAR(0.25, stats.EstimateRange(0, nullptr, &low), 0.15);
+
+  // writes keep the counts, inserts feed the sample
+  for (int i = 0; i < count; i++) {
+    Tuple tuple({Value(TypeId::INTEGER, count + i), Value(TypeId::INTEGER, 0),
+                 Value(TypeId::VARCHAR, std::string("d"))},
+                &schema);
+    stats.RecordInsert(tuple);
+  }
+  stats.RecordDelete();
+  EXPECT_EQ(static_cast<size_t>(2 * count - 1), stats.GetRowCount());
+  EXPECT_LT(stats.GetColumnStats(1).distinct_count, 11);
+  EXPECT_NEAR(0.55, stats.EstimateEquals(1, Value(TypeId::INTEGER, 0)), 0.1);
+  EXPECT_EQ(5, stats.GetColumnStats(2).distinct_count);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
@@ -12,6 +12,7 @@
 #include "logging/common.h"
 #include "table/table_heap.h"
 #include "table/tuple.h"
+#include "table/tuple_view.h"
 #include "vtable/virtual_table.h"
 #include "gtest/gtest.h"
 
@@ -61,4 +62,177 @@ TEST(TupleTest, TableHeapTest) {
   delete disk_manager;
 }
 
+// a scan reads columns through its view, which stays right when the page
+// is compacted under it
+TEST(TupleTest, TupleViewTest) {
+  ENABLE_LOGGING = false;
+  Schema *schema = ParseCreateStatement("a int, b varchar(300)");
+  Transaction transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(10, disk_manager);
+  LockManager lock_manager(false);
+  TableHeap *table = new TableHeap(buffer_pool_manager, &lock_manager,
+                                   nullptr, &transaction);
+  auto make_tuple = [schema](int a, size_t length) {
+    return Tuple({Value(TypeId::INTEGER, a),
+                  Value(TypeId::VARCHAR, std::string(length, 'a' + a % 26))},
+                 schema);
+  };
+  std::vector<RID> rids;
+  for (int i = 0; i < 100; ++i) {
+    RID rid;
+    EXPECT_TRUE(table->InsertTuple(make_tuple(i, 50), rid, &transaction));
+    rids.push_back(rid);
+  }
+
+  int count = 0;
+  for (auto itr = table->begin(&transaction); itr != table->end(); ++itr) {
+    EXPECT_EQ(count, itr.GetValue(schema, 0).GetAs<int32_t>());
+    EXPECT_EQ(std::string(50, 'a' + count % 26),
+              itr.GetValue(schema, 1).ToString());
+    EXPECT_EQ(rids[count], itr.GetRid());
+    count++;
+  }
+  EXPECT_EQ(100, count);
+
+  // the tuples of the first page move while the view is on the last one
+  TupleView view(buffer_pool_manager, rids[rids.size() - 1]);
+  page_id_t page_id = rids[0].GetPageId();
+  TupleView first(buffer_pool_manager, rids[1]);
+  EXPECT_EQ(page_id, first.GetRid().GetPageId());
+  for (int i : {0, 2, 3, 4, 5, 6}) {
+    table->ApplyDelete(rids[i], &transaction);
+  }
+  EXPECT_TRUE(table->UpdateTuple(make_tuple(1, 250), rids[1], &transaction));
+  EXPECT_EQ(1, first.GetValue(schema, 0).GetAs<int32_t>());
+  EXPECT_EQ(std::string(250, 'b'), first.GetValue(schema, 1).ToString());
+  Tuple tuple;
+  EXPECT_TRUE(first.Materialize(tuple));
+  EXPECT_EQ(1, tuple.GetValue(schema, 0).GetAs<int32_t>());
+  EXPECT_EQ(99, view.GetValue(schema, 0).GetAs<int32_t>());
+  // the tuple is gone
+  first.Reset(buffer_pool_manager, rids[0]);
+  EXPECT_TRUE(first.GetValue(schema, 0).IsNull());
+  EXPECT_FALSE(first.Materialize(tuple));
+
+  first.Release();
+  view.Release();
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete schema;
+  remove("test.db");
+}
+
+/*
+ * Tuples and values built in an arena
+ */
+TEST(TupleTest, ArenaTest) {
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::VARCHAR, 20, "b")};
+  Schema schema(columns);
+  Arena arena;
+  std::vector<Value> values = {Value(TypeId::INTEGER, 7),
+                               Value(TypeId::VARCHAR, "in the arena")};
+  Tuple tuple(values, &schema, &arena);
+  EXPECT_FALSE(tuple.IsAllocated());
+  EXPECT_EQ(Tuple(values, &schema).GetLength(), tuple.GetLength());
+  EXPECT_EQ(7, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+  Value value = tuple.GetValue(&schema, 1, &arena);
+  EXPECT_EQ("in the arena", value.ToString());
+  // a copy refers to the arena as well
+  Value copy = value;
+  EXPECT_EQ(value.GetData(), copy.GetData());
+
+  // detached, it outlives the arena
+  Tuple detached = tuple;
+  detached.Detach();
+  EXPECT_TRUE(detached.IsAllocated());
+  arena.Reset();
+  std::string overwrite(tuple.GetLength(), 'x');
+  arena.Copy(overwrite.c_str(), overwrite.size());
+  EXPECT_EQ("in the arena", detached.GetValue(&schema, 1).ToString());
+}
+
+/*
+ * Typed reads agree with GetValue, on a tuple and through a table scan
+ */
+TEST(TupleTest, TypedAccessorTest) {
+  std::vector<Column> columns = {
+      Column(TypeId::TINYINT, 1, "a"), Column(TypeId::SMALLINT, 2, "b"),
+      Column(TypeId::INTEGER, 4, "c"), Column(TypeId::BIGINT, 8, "d"),
+      Column(TypeId::DECIMAL, 8, "e"), Column(TypeId::VARCHAR, 20, "f")};
+  Schema schema(columns);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(10, disk_manager);
+  LockManager lock_manager(false);
+  Transaction txn(0);
+  TableHeap table(buffer_pool_manager, &lock_manager, nullptr, &txn);
+  for (int i = 0; i < 100; i++) {
+    Tuple tuple({Value(TypeId::TINYINT, static_cast<int8_t>(i)),
+                 Value(TypeId::SMALLINT, static_cast<int16_t>(i * 2)),
+                 Value(TypeId::INTEGER, i * 3),
+                 Value(TypeId::BIGINT, static_cast<int64_t>(i) << 40),
+                 Value(TypeId::DECIMAL, i / 4.0),
+                 Value(TypeId::VARCHAR, std::string(i % 10, 'v'))},
+                &schema);
+    EXPECT_EQ(i, tuple.GetInt8(&schema, 0));
+    EXPECT_EQ(i * 2, tuple.GetInt16(&schema, 1));
+    EXPECT_EQ(i * 3, tuple.GetInt32(&schema, 2));
+    EXPECT_EQ(static_cast<int64_t>(i) << 40, tuple.GetInt64(&schema, 3));
+    EXPECT_EQ(i / 4.0, tuple.GetDouble(&schema, 4));
+    const char *data;
+    uint32_t len;
+    ASSERT_TRUE(tuple.GetStringView(&schema, 5, data, len));
+    EXPECT_EQ(std::string(i % 10, 'v'), std::string(data, len));
+    RID rid;
+    ASSERT_TRUE(table.InsertTuple(tuple, rid, &txn));
+  }
+
+  int scanned = 0;
+  for (auto it = table.begin(&txn); it != table.end(); ++it, ++scanned) {
+    EXPECT_EQ(it.GetValue(&schema, 2).GetAs<int32_t>(),
+              it.GetFixed<int32_t>(&schema, 2));
+    EXPECT_EQ(static_cast<int64_t>(scanned) << 40,
+              it.GetFixed<int64_t>(&schema, 3));
+    EXPECT_EQ(scanned / 4.0, it.GetFixed<double>(&schema, 4));
+  }
+  EXPECT_EQ(100, scanned);
+
+  delete buffer_pool_manager;
+  delete disk_manager;
+  remove("test.db");
+}
+
+/*
+ * Tuples of a schema without varchars are just the columns at their offsets
+ */
+TEST(TupleTest, FixedLayoutTest) {
+  std::vector<Column> columns = {
+      Column(TypeId::BOOLEAN, 1, "a"), Column(TypeId::SMALLINT, 2, "b"),
+      Column(TypeId::BIGINT, 8, "c"), Column(TypeId::DECIMAL, 8, "d")};
+  Schema schema(columns);
+  EXPECT_TRUE(schema.IsFixedLayout());
+  columns.push_back(Column(TypeId::VARCHAR, 20, "e"));
+  EXPECT_FALSE(Schema(columns).IsFixedLayout());
+
+  std::vector<Value> values = {
+      Value(TypeId::BOOLEAN, static_cast<int8_t>(1)),
+      Value(TypeId::SMALLINT, static_cast<int16_t>(-3)),
+      Value(TypeId::BIGINT, PELOTON_INT64_NULL), Value(TypeId::DECIMAL, 0.5)};
+  Tuple tuple(values, &schema);
+  EXPECT_EQ(schema.GetLength(), tuple.GetLength());
+  for (int i = 0; i < schema.GetColumnCount(); i++) {
+    Value value = tuple.GetValue(&schema, i);
+    EXPECT_EQ(schema.GetType(i), value.GetTypeId());
+    EXPECT_EQ(values[i].IsNull(), value.IsNull());
+    if (!value.IsNull()) {
+      EXPECT_EQ(CMP_TRUE, value.CompareEquals(values[i]));
+    }
+  }
+  EXPECT_EQ(PELOTON_INT64_NULL, tuple.GetInt64(&schema, 2));
+}
+
 } // namespace cmudb
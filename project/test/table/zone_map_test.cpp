@@ -0,0 +1,97 @@
+/**
+ * zone_map_test.cpp
+ */
+
+#include <cstdio>
+#include <set>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "table/table_heap.h"
+#include "table/zone_map.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ZoneMapTest, RangeScanTest) {
+  remove("test.db");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(20, disk_manager);
+  LockManager lock_manager(false);
+  std::vector<Column> columns = {Column(TypeId::INTEGER, 4, "a"),
+                                 Column(TypeId::INTEGER, 4, "b")};
+  Schema schema(columns);
+  Transaction txn(0);
+  TableHeap table(bpm, &lock_manager, nullptr, &txn);
+  // a grows with the pages, b does not
+  ZoneMap zone_map(&schema, {0, 1});
+  zone_map.Rebuild(bpm, table.GetFirstPageId());
+  table.SetZoneMap(&zone_map);
+  const int count = 5000;
+  RID rid;
+  std::set<page_id_t> pages;
+  for (int i = 0; i < count; i++) {
+    Tuple tuple({Value(TypeId::INTEGER, i), Value(TypeId::INTEGER, i % 10)},
+                &schema);
+    ASSERT_TRUE(table.InsertTuple(tuple, rid, &txn));
+    pages.insert(rid.GetPageId());
+  }
+  ASSERT_LT(2u, pages.size());
+  EXPECT_EQ(pages.size(), zone_map.GetPageCount());
+  EXPECT_TRUE(zone_map.IsTracked(1));
+  EXPECT_FALSE(zone_map.IsTracked(2));
+
+  // a in [1000, 1100], a BIGINT bound on the INTEGER column
+  std::vector<ScanRange> ranges(1, ScanRange(0));
+  ranges[0].low = Value(TypeId::BIGINT, static_cast<int64_t>(1000));
+  ranges[0].has_low = true;
+  ranges[0].high = Value(TypeId::BIGINT, static_cast<int64_t>(1100));
+  ranges[0].has_high = true;
+  std::set<page_id_t> scanned;
+  int matches = 0;
+  for (auto it = table.begin(&txn, false, ranges); it != table.end(); ++it) {
+    scanned.insert(it->GetRid().GetPageId());
+    int a = it->GetValue(&schema, 0).GetAs<int32_t>();
+    if (a >= 1000 && a <= 1100)
+      matches++;
+  }
+  EXPECT_EQ(101, matches);
+  EXPECT_GT(pages.size(), scanned.size());
+  for (auto page_id : pages) {
+    EXPECT_EQ(scanned.count(page_id) == 1,
+              zone_map.MayMatch(page_id, ranges));
+  }
+
+  // no page has a past the last insert, every page has all of b
+  ranges[0].low = Value(TypeId::BIGINT, static_cast<int64_t>(count));
+  ranges[0].has_high = false;
+  EXPECT_EQ(INVALID_PAGE_ID, zone_map.NextPage(INVALID_PAGE_ID, ranges));
+  EXPECT_TRUE(table.begin(&txn, false, ranges) == table.end());
+  ranges[0] = ScanRange(1);
+  ranges[0].low = Value(TypeId::DECIMAL, 8.5);
+  ranges[0].has_low = true;
+  EXPECT_EQ(table.GetFirstPageId(),
+            zone_map.NextPage(INVALID_PAGE_ID, ranges));
+  EXPECT_EQ(*pages.rbegin(), zone_map.NextPage(*++pages.rbegin(), ranges));
+
+  // an update widens the page it stays on
+  ranges[0] = ScanRange(0);
+  ranges[0].low = Value(TypeId::INTEGER, 2 * count);
+  ranges[0].has_low = true;
+  Tuple updated({Value(TypeId::INTEGER, 2 * count), Value(TypeId::INTEGER, 0)},
+                &schema);
+  ASSERT_TRUE(table.UpdateTuple(updated, rid, &txn));
+  EXPECT_EQ(rid.GetPageId(), zone_map.NextPage(INVALID_PAGE_ID, ranges));
+
+  // the same map again from the pages
+  ZoneMap rebuilt(&schema, {0, 1});
+  rebuilt.Rebuild(bpm, table.GetFirstPageId());
+  EXPECT_EQ(pages.size(), rebuilt.GetPageCount());
+  EXPECT_EQ(rid.GetPageId(), rebuilt.NextPage(INVALID_PAGE_ID, ranges));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
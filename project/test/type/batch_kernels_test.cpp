@@ -0,0 +1,158 @@
+/**
+ * batch_kernels_test.cpp
+ */
+#include <cstdint>
+#include <vector>
+
+#include "common/exception.h"
+#include "type/batch_kernels.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(BatchKernelsTest, SelectTest) {
+  // i % 10, a null every 7th
+  const size_t count = 1000;
+  std::vector<int32_t> column(count);
+  for (size_t i = 0; i < count; i++)
+    column[i] = i % 7 == 0 ? PELOTON_INT32_NULL : static_cast<int32_t>(i % 10);
+  std::vector<uint32_t> selection(count);
+
+  size_t selected = BatchKernels::Select(column.data(), count, BatchCmp::LT,
+                                         3, selection.data());
+  size_t expected = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (i % 7 != 0 && i % 10 < 3) {
+      ASSERT_LT(expected, selected);
+      EXPECT_EQ(i, selection[expected]);
+      expected++;
+    }
+  }
+  EXPECT_EQ(expected, selected);
+
+  // of those, the ones equal to 1
+  selected = BatchKernels::Refine(column.data(), selection.data(), selected,
+                                  BatchCmp::EQ, 1);
+  expected = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (i % 7 != 0 && i % 10 == 1) {
+      EXPECT_EQ(i, selection[expected]);
+      expected++;
+    }
+  }
+  EXPECT_EQ(expected, selected);
+
+  // nulls never compare true, not even unequal
+  selected = BatchKernels::Select(column.data(), count, BatchCmp::NE, 100,
+                                  selection.data());
+  EXPECT_EQ(count - (count + 6) / 7, selected);
+  EXPECT_EQ(0u, BatchKernels::Select(column.data(), count, BatchCmp::EQ,
+                                     PELOTON_INT32_NULL, selection.data()));
+
+  // by type id, the constant cast to the column
+  std::vector<double> decimals = {1.5, 2.5, PELOTON_DECIMAL_NULL, 0.5};
+  selected = BatchKernels::Select(
+      TypeId::DECIMAL, reinterpret_cast<const char *>(decimals.data()),
+      decimals.size(), BatchCmp::GE, Value(TypeId::INTEGER, 1),
+      selection.data());
+  ASSERT_EQ(2u, selected);
+  EXPECT_EQ(0u, selection[0]);
+  EXPECT_EQ(1u, selection[1]);
+}
+
+TEST(BatchKernelsTest, ArithmeticTest) {
+  std::vector<int16_t> left = {1, -2, PELOTON_INT16_NULL, 300};
+  std::vector<int16_t> right = {10, 20, 30, PELOTON_INT16_NULL};
+  std::vector<int16_t> result(left.size());
+  BatchKernels::Add(left.data(), right.data(), result.data(), left.size());
+  EXPECT_EQ(11, result[0]);
+  EXPECT_EQ(18, result[1]);
+  EXPECT_EQ(PELOTON_INT16_NULL, result[2]);
+  EXPECT_EQ(PELOTON_INT16_NULL, result[3]);
+  BatchKernels::Subtract(left.data(), right.data(), result.data(),
+                         left.size());
+  EXPECT_EQ(-9, result[0]);
+  EXPECT_EQ(-22, result[1]);
+  BatchKernels::Multiply(left.data(), right.data(), result.data(),
+                         left.size());
+  EXPECT_EQ(10, result[0]);
+  EXPECT_EQ(-40, result[1]);
+
+  // overflows throw, as the Value operations
+  std::vector<int16_t> big = {1, PELOTON_INT16_MAX};
+  EXPECT_THROW(BatchKernels::Add(big.data(), big.data(), result.data(), 2),
+               Exception);
+  std::vector<int64_t> wide = {PELOTON_INT64_MAX, 1};
+  std::vector<int64_t> ones = {1, 1};
+  std::vector<int64_t> wide_result(2);
+  EXPECT_THROW(
+      BatchKernels::Add(wide.data(), ones.data(), wide_result.data(), 2),
+      Exception);
+  EXPECT_THROW(BatchKernels::Multiply(wide.data(), wide.data(),
+                                      wide_result.data(), 2),
+               Exception);
+  std::vector<int64_t> low = {PELOTON_INT64_MIN, 0};
+  std::vector<int64_t> twos = {2, 2};
+  EXPECT_THROW(
+      BatchKernels::Subtract(low.data(), twos.data(), wide_result.data(), 2),
+      Exception);
+  // but not for a null
+  std::vector<int64_t> nulls = {PELOTON_INT64_NULL, 1};
+  BatchKernels::Add(wide.data(), nulls.data(), wide_result.data(), 2);
+  EXPECT_EQ(PELOTON_INT64_NULL, wide_result[0]);
+  EXPECT_EQ(2, wide_result[1]);
+
+  // by type id, in place
+  std::vector<int32_t> integers = {1, 2, 3};
+  const char *data = reinterpret_cast<const char *>(integers.data());
+  BatchKernels::Multiply(TypeId::INTEGER, data, data,
+                         reinterpret_cast<char *>(integers.data()), 3);
+  EXPECT_EQ(9, integers[2]);
+}
+
+TEST(BatchKernelsTest, ReductionTest) {
+  std::vector<int8_t> tinyints = {5, PELOTON_INT8_NULL, -3, 100, 7};
+  int8_t min, max;
+  ASSERT_TRUE(BatchKernels::Min(tinyints.data(), tinyints.size(), min));
+  ASSERT_TRUE(BatchKernels::Max(tinyints.data(), tinyints.size(), max));
+  EXPECT_EQ(-3, min);
+  EXPECT_EQ(100, max);
+  int64_t sum;
+  ASSERT_TRUE(BatchKernels::Sum(tinyints.data(), tinyints.size(), sum));
+  EXPECT_EQ(109, sum);
+
+  // nothing but nulls
+  std::vector<int8_t> nulls(3, PELOTON_INT8_NULL);
+  EXPECT_FALSE(BatchKernels::Min(nulls.data(), nulls.size(), min));
+  EXPECT_FALSE(BatchKernels::Sum(nulls.data(), nulls.size(), sum));
+  EXPECT_TRUE(BatchKernels::Max(TypeId::TINYINT,
+                                reinterpret_cast<const char *>(nulls.data()),
+                                nulls.size())
+                  .IsNull());
+
+  std::vector<int64_t> bigints = {PELOTON_INT64_MAX, 1};
+  EXPECT_THROW(BatchKernels::Sum(bigints.data(), bigints.size(), sum),
+               Exception);
+
+  // by type id, a sum of integers is a BIGINT
+  std::vector<int32_t> integers(1000);
+  for (size_t i = 0; i < integers.size(); i++)
+    integers[i] = static_cast<int32_t>(i) - 500;
+  const char *data = reinterpret_cast<const char *>(integers.data());
+  Value value = BatchKernels::Min(TypeId::INTEGER, data, integers.size());
+  EXPECT_EQ(TypeId::INTEGER, value.GetTypeId());
+  EXPECT_EQ(-500, value.GetAs<int32_t>());
+  value = BatchKernels::Max(TypeId::INTEGER, data, integers.size());
+  EXPECT_EQ(499, value.GetAs<int32_t>());
+  value = BatchKernels::Sum(TypeId::INTEGER, data, integers.size());
+  EXPECT_EQ(TypeId::BIGINT, value.GetTypeId());
+  EXPECT_EQ(-500, value.GetAs<int64_t>());
+
+  std::vector<double> decimals = {0.5, PELOTON_DECIMAL_NULL, -1.5};
+  data = reinterpret_cast<const char *>(decimals.data());
+  EXPECT_EQ(-1.5, BatchKernels::Min(TypeId::DECIMAL, data, 3).GetAs<double>());
+  EXPECT_EQ(0.5, BatchKernels::Max(TypeId::DECIMAL, data, 3).GetAs<double>());
+  EXPECT_EQ(-1.0, BatchKernels::Sum(TypeId::DECIMAL, data, 3).GetAs<double>());
+}
+
+} // namespace cmudb
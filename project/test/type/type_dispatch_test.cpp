@@ -0,0 +1,138 @@
+/**
+ * type_dispatch_test.cpp
+ */
+#include <cstring>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "common/exception.h"
+#include "table/tuple.h"
+#include "type/type_dispatch.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// a few values of each fixed-size type, a null among them
+static std::vector<Value> SampleValues(TypeId type_id) {
+  std::vector<Value> values;
+  for (int32_t i : {-100, -1, 0, 1, 100}) {
+    values.push_back(Value(TypeId::INTEGER, i).CastAs(type_id));
+  }
+  values.push_back(Type::GetMinValue(type_id));
+  values.push_back(Type::GetMaxValue(type_id));
+  values.push_back(Value(TypeId::INTEGER, PELOTON_INT32_NULL).CastAs(type_id));
+  return values;
+}
+
+TEST(TypeDispatchTest, ComparatorTest) {
+  std::vector<TypeId> types = {TypeId::TINYINT, TypeId::SMALLINT,
+                               TypeId::INTEGER, TypeId::BIGINT,
+                               TypeId::DECIMAL};
+  // every pair compares its stored values as their Values do
+  for (TypeId left_type : types) {
+    for (TypeId right_type : types) {
+      StoredComparator comparator =
+          GetStoredComparator(left_type, right_type);
+      ASSERT_NE(nullptr, comparator);
+      for (auto &left : SampleValues(left_type)) {
+        for (auto &right : SampleValues(right_type)) {
+          char left_storage[8], right_storage[8];
+          left.SerializeTo(left_storage);
+          right.SerializeTo(right_storage);
+          int expected = 0;
+          if (left.CompareLessThan(right) == CMP_TRUE)
+            expected = -1;
+          else if (left.CompareGreaterThan(right) == CMP_TRUE)
+            expected = 1;
+          EXPECT_EQ(expected, comparator(left_storage, right_storage));
+        }
+      }
+    }
+  }
+
+  StoredComparator comparator =
+      GetStoredComparator(TypeId::VARCHAR, TypeId::VARCHAR);
+  ASSERT_NE(nullptr, comparator);
+  std::vector<Value> strings = {Value(TypeId::VARCHAR, "abc"),
+                                Value(TypeId::VARCHAR, "abd"),
+                                Value(TypeId::VARCHAR, "ab"),
+                                Value(TypeId::VARCHAR, "")};
+  for (auto &left : strings) {
+    for (auto &right : strings) {
+      std::vector<char> left_storage(left.GetLength() + sizeof(uint32_t));
+      std::vector<char> right_storage(right.GetLength() + sizeof(uint32_t));
+      left.SerializeTo(left_storage.data());
+      right.SerializeTo(right_storage.data());
+      int expected = 0;
+      if (left.CompareLessThan(right) == CMP_TRUE)
+        expected = -1;
+      else if (left.CompareGreaterThan(right) == CMP_TRUE)
+        expected = 1;
+      EXPECT_EQ(expected,
+                comparator(left_storage.data(), right_storage.data()));
+    }
+  }
+  EXPECT_EQ(nullptr, GetStoredComparator(TypeId::VARCHAR, TypeId::INTEGER));
+  EXPECT_EQ(nullptr, GetStoredComparator(TypeId::INVALID, TypeId::INVALID));
+}
+
+TEST(TypeDispatchTest, CasterTest) {
+  std::vector<TypeId> types = {TypeId::TINYINT, TypeId::SMALLINT,
+                               TypeId::INTEGER, TypeId::BIGINT,
+                               TypeId::DECIMAL};
+  for (TypeId from : types) {
+    for (TypeId to : types) {
+      StoredCaster caster = GetStoredCaster(from, to);
+      ASSERT_NE(nullptr, caster);
+      for (auto &value : SampleValues(from)) {
+        char storage[8];
+        value.SerializeTo(storage);
+        bool in_range = true;
+        Value expected(to);
+        try {
+          expected = value.CastAs(to);
+        } catch (Exception &) {
+          in_range = false;
+        }
+        if (!in_range) {
+          EXPECT_THROW(caster(storage), Exception);
+          continue;
+        }
+        Value cast = caster(storage);
+        EXPECT_EQ(to, cast.GetTypeId());
+        EXPECT_EQ(expected.IsNull(), cast.IsNull());
+        if (!expected.IsNull()) {
+          EXPECT_EQ(CMP_TRUE, cast.CompareEquals(expected));
+        }
+      }
+    }
+  }
+  EXPECT_NE(nullptr, GetStoredCaster(TypeId::BOOLEAN, TypeId::BOOLEAN));
+  EXPECT_EQ(nullptr, GetStoredCaster(TypeId::BOOLEAN, TypeId::INTEGER));
+  EXPECT_EQ(nullptr, GetStoredCaster(TypeId::VARCHAR, TypeId::INTEGER));
+}
+
+TEST(TypeDispatchTest, SchemaTest) {
+  std::vector<Column> columns = {Column(TypeId::BOOLEAN, 1, "a"),
+                                 Column(TypeId::SMALLINT, 2, "b"),
+                                 Column(TypeId::VARCHAR, 20, "c"),
+                                 Column(TypeId::DECIMAL, 8, "d")};
+  Schema schema(columns);
+  for (int i = 0; i < schema.GetColumnCount(); i++) {
+    EXPECT_NE(nullptr, schema.GetComparator(i));
+    EXPECT_NE(nullptr, schema.GetSerializer(i));
+  }
+
+  // a tuple built with the bound serializers reads back its values
+  std::vector<Value> values = {
+      Value(TypeId::BOOLEAN, static_cast<int8_t>(1)),
+      Value(TypeId::SMALLINT, static_cast<int16_t>(-7)),
+      Value(TypeId::VARCHAR, "hello"), Value(TypeId::DECIMAL, 2.5)};
+  Tuple tuple(values, &schema);
+  for (int i = 0; i < schema.GetColumnCount(); i++) {
+    EXPECT_EQ(CMP_TRUE, tuple.GetValue(&schema, i).CompareEquals(values[i]));
+  }
+  EXPECT_EQ(-7, tuple.GetFixed<int16_t>(&schema, 1));
+}
+
+} // namespace cmudb
@@ -76,4 +76,38 @@ TEST(TypeTests, TemplateTest) {
   BPlusTreePage<Value, Value> node;
   node.GetInfo(val1, val2);
 }
+
+// short varchars kept in the value, longer ones allocated, either kind
+// surviving copies, swaps and serialization
+TEST(TypeTests, VarcharTest) {
+  std::string short_string(Value::INLINE_VARCHAR_LEN - 1, 's');
+  std::string long_string(Value::INLINE_VARCHAR_LEN, 'l');
+  for (auto &str : {short_string, long_string, std::string()}) {
+    Value value(TypeId::VARCHAR, str);
+    EXPECT_EQ(str, value.ToString());
+    EXPECT_EQ(str.size() + 1, value.GetLength());
+
+    Value copy = value;
+    EXPECT_EQ(str, copy.ToString());
+    EXPECT_NE(value.GetData(), copy.GetData());
+    EXPECT_EQ(CMP_TRUE, copy.CompareEquals(value));
+
+    std::vector<char> storage(sizeof(uint32_t) + value.GetLength());
+    value.SerializeTo(storage.data());
+    Value deserialized =
+        Value::DeserializeFrom(storage.data(), TypeId::VARCHAR);
+    EXPECT_EQ(str, deserialized.ToString());
+
+    Value other(TypeId::VARCHAR, "other");
+    swap(other, deserialized);
+    EXPECT_EQ(str, other.ToString());
+    EXPECT_EQ("other", deserialized.ToString());
+  }
+
+  // one not managing its data refers to it
+  const char *text = "a view";
+  Value view(TypeId::VARCHAR, text, strlen(text) + 1, false);
+  EXPECT_EQ(text, view.GetData());
+  EXPECT_EQ(text, Value(view).GetData());
+}
 } // namespace cmudb
@@ -1,6 +1,10 @@
 /**
  * virtual_table_test.cpp
  */
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "vtable/testing_vtable_util.h"
 
 namespace cmudb {
@@ -44,4 +48,288 @@ TEST(VtableTest, CreateTest) {
   remove("vtable.db");
   return;
 }
+
+// each of the indexes of a table is kept up by inserts, updates and deletes
+TEST(VtableTest, MultiIndexTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  EXPECT_EQ(SQLITE_OK, sqlite3_open(db_file.c_str(), &db));
+  EXPECT_EQ(SQLITE_OK, sqlite3_enable_load_extension(db, 1));
+  char *zErrMsg = 0;
+  EXPECT_EQ(SQLITE_OK, sqlite3_load_extension(db, "libvtable", 0, &zErrMsg));
+
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo2 USING vtable ('a int, "
+                          "b int, c varchar', 'foo2_a a', 'foo2_b b non "
+                          "unique')"));
+  EXPECT_TRUE(ExecSQL(db, "WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT "
+                          "x + 1 FROM n WHERE x < 500) INSERT INTO foo2 "
+                          "SELECT x, x % 10, 'row' || x FROM n"));
+  EXPECT_EQ(1, QueryInt(db, "SELECT count(*) FROM foo2 WHERE a = 5"));
+  EXPECT_EQ(50, QueryInt(db, "SELECT count(*) FROM foo2 WHERE b = 5"));
+
+  // a new key in one index only, in place and moved
+  EXPECT_TRUE(ExecSQL(db, "UPDATE foo2 SET b = 100 WHERE a = 5"));
+  EXPECT_TRUE(ExecSQL(db, "UPDATE foo2 SET a = 1000, c = 'a string too long "
+                          "to be updated in place' WHERE a = 15"));
+  EXPECT_TRUE(ExecSQL(db, "DELETE FROM foo2 WHERE a = 25"));
+  EXPECT_EQ(48, QueryInt(db, "SELECT count(*) FROM foo2 WHERE b = 5"));
+  EXPECT_EQ(5, QueryInt(db, "SELECT a FROM foo2 WHERE b = 100"));
+  EXPECT_EQ(0, QueryInt(db, "SELECT count(*) FROM foo2 WHERE a = 15"));
+  EXPECT_EQ(5, QueryInt(db, "SELECT b FROM foo2 WHERE a = 1000"));
+  EXPECT_EQ(0, QueryInt(db, "SELECT count(*) FROM foo2 WHERE a = 25"));
+  // either index of a join
+  EXPECT_EQ(9, QueryInt(db, "SELECT count(*) FROM foo2 x, foo2 y WHERE x.a "
+                            "= y.b AND y.a <= 10"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo2"));
+
+  EXPECT_EQ(SQLITE_OK, sqlite3_close(db));
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+TEST(VtableTest, OrderByTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  EXPECT_EQ(SQLITE_OK, sqlite3_open(db_file.c_str(), &db));
+  EXPECT_EQ(SQLITE_OK, sqlite3_enable_load_extension(db, 1));
+  char *zErrMsg = 0;
+  EXPECT_EQ(SQLITE_OK, sqlite3_load_extension(db, "libvtable", 0, &zErrMsg));
+
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo3 USING vtable ('a int, "
+                          "b int', 'foo3_a a', 'foo3_b b non unique')"));
+  EXPECT_TRUE(ExecSQL(db, "WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT "
+                          "x + 1 FROM n WHERE x < 500) INSERT INTO foo3 "
+                          "SELECT (x * 7) % 500, x % 10 FROM n"));
+  // the rows of the index in order, either way
+  EXPECT_EQ(0, QueryInt(db, "SELECT a FROM foo3 ORDER BY a LIMIT 1"));
+  EXPECT_EQ(100, QueryInt(db, "SELECT a FROM foo3 ORDER BY a LIMIT 1 "
+                              "OFFSET 100"));
+  EXPECT_EQ(497, QueryInt(db, "SELECT a FROM foo3 ORDER BY a DESC LIMIT 1 "
+                              "OFFSET 2"));
+  EXPECT_EQ(51, QueryInt(db, "SELECT a FROM foo3 WHERE a > 50 ORDER BY a "
+                             "LIMIT 1"));
+  // equal keys past the end of a batch
+  EXPECT_EQ(270, QueryInt(db, "SELECT sum(b) FROM (SELECT b FROM foo3 ORDER "
+                              "BY b DESC LIMIT 30)"));
+  EXPECT_EQ(1, QueryInt(db, "SELECT b FROM foo3 ORDER BY b LIMIT 1 OFFSET "
+                            "50"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo3"));
+
+  EXPECT_EQ(SQLITE_OK, sqlite3_close(db));
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+TEST(VtableTest, ConnectionTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db[2];
+  char *zErrMsg = 0;
+  for (auto &connection : db) {
+    EXPECT_EQ(SQLITE_OK, sqlite3_open(db_file.c_str(), &connection));
+    EXPECT_EQ(SQLITE_OK, sqlite3_enable_load_extension(connection, 1));
+    EXPECT_EQ(SQLITE_OK,
+              sqlite3_load_extension(connection, "libvtable", 0, &zErrMsg));
+    sqlite3_busy_timeout(connection, 10000);
+  }
+  EXPECT_TRUE(ExecSQL(db[0], "CREATE VIRTUAL TABLE foo4 USING vtable ('a "
+                             "int, b int', 'foo4_a a')"));
+
+  // each connection inserts in transactions of its own, the other one
+  // connected to the same table
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 2; i++) {
+    threads.emplace_back([&db, i] {
+      for (int key = i; key < 200; key += 2) {
+        EXPECT_TRUE(ExecSQL(db[i], "INSERT INTO foo4 VALUES (" +
+                                       std::to_string(key) + ", " +
+                                       std::to_string(i) + ")"));
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  EXPECT_EQ(200, QueryInt(db[0], "SELECT count(*) FROM foo4"));
+  EXPECT_EQ(100, QueryInt(db[1], "SELECT sum(b) FROM foo4"));
+  EXPECT_EQ(1, QueryInt(db[0], "SELECT b FROM foo4 WHERE a = 199"));
+
+  // a rollback undoes the rows and the index entries of one connection
+  EXPECT_TRUE(ExecSQL(db[1], "BEGIN"));
+  EXPECT_TRUE(ExecSQL(db[1], "INSERT INTO foo4 VALUES (500, 5)"));
+  EXPECT_TRUE(ExecSQL(db[1], "UPDATE foo4 SET a = 600 WHERE a = 10"));
+  EXPECT_TRUE(ExecSQL(db[1], "DELETE FROM foo4 WHERE a = 20"));
+  EXPECT_EQ(200, QueryInt(db[1], "SELECT count(*) FROM foo4"));
+  EXPECT_TRUE(ExecSQL(db[1], "ROLLBACK"));
+  EXPECT_EQ(200, QueryInt(db[0], "SELECT count(*) FROM foo4"));
+  EXPECT_EQ(0, QueryInt(db[0], "SELECT count(*) FROM foo4 WHERE a = 500"));
+  EXPECT_EQ(0, QueryInt(db[0], "SELECT count(*) FROM foo4 WHERE a = 600"));
+  EXPECT_EQ(0, QueryInt(db[0], "SELECT b FROM foo4 WHERE a = 10"));
+  EXPECT_EQ(0, QueryInt(db[0], "SELECT b FROM foo4 WHERE a = 20"));
+  EXPECT_TRUE(ExecSQL(db[0], "DROP TABLE foo4"));
+
+  for (auto &connection : db)
+    EXPECT_EQ(SQLITE_OK, sqlite3_close(connection));
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+TEST(VtableTest, ImportTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  EXPECT_EQ(SQLITE_OK, sqlite3_open(db_file.c_str(), &db));
+  EXPECT_EQ(SQLITE_OK, sqlite3_enable_load_extension(db, 1));
+  char *zErrMsg = 0;
+  EXPECT_EQ(SQLITE_OK, sqlite3_load_extension(db, "libvtable", 0, &zErrMsg));
+
+  std::string csv_file = "import_test.csv";
+  FILE *csv = fopen(csv_file.c_str(), "w");
+  for (int i = 0; i < 3000; i++)
+    fprintf(csv, "%d,%d,\"row, %d\"\n", (i * 7) % 3000, i % 10, i);
+  fclose(csv);
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo5 USING vtable ('a int, "
+                          "b int, c varchar(20)', 'foo5_a a', 'foo5_b b non "
+                          "unique')"));
+  EXPECT_EQ(3000, QueryInt(db, "SELECT vtable_import('foo5', '" + csv_file +
+                                   "')"));
+  EXPECT_EQ(3000, QueryInt(db, "SELECT count(*) FROM foo5"));
+  EXPECT_EQ(1, QueryInt(db, "SELECT b FROM foo5 WHERE a = 7"));
+  EXPECT_EQ(300, QueryInt(db, "SELECT count(*) FROM foo5 WHERE b = 3"));
+  EXPECT_EQ(1, QueryInt(db, "SELECT count(*) FROM foo5 WHERE a = 7 AND c = "
+                            "'row, 1'"));
+
+  // from a table, into the indexes that have keys already
+  EXPECT_TRUE(ExecSQL(db, "CREATE TABLE bar5 (x, y, z)"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO bar5 VALUES (5000, 3, 'a'), (5001, "
+                          "3, 'b')"));
+  EXPECT_EQ(2, QueryInt(db, "SELECT vtable_import('foo5', 'bar5')"));
+  EXPECT_EQ(302, QueryInt(db, "SELECT count(*) FROM foo5 WHERE b = 3"));
+  EXPECT_EQ(3, QueryInt(db, "SELECT b FROM foo5 WHERE a = 5001"));
+  // nothing of a failed import
+  EXPECT_EQ(-1, QueryInt(db, "SELECT vtable_import('foo5', 'missing.csv')"));
+  EXPECT_EQ(-1, QueryInt(db, "SELECT vtable_import('bar5', 'foo5')"));
+  EXPECT_EQ(3002, QueryInt(db, "SELECT count(*) FROM foo5"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo5"));
+
+  EXPECT_EQ(SQLITE_OK, sqlite3_close(db));
+  remove(csv_file.c_str());
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+
+// the trace points of the engine, read back through vtable_metrics
+TEST(VtableTest, MetricsTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  EXPECT_EQ(SQLITE_OK, sqlite3_open(db_file.c_str(), &db));
+  EXPECT_EQ(SQLITE_OK, sqlite3_enable_load_extension(db, 1));
+  char *zErrMsg = 0;
+  EXPECT_EQ(SQLITE_OK, sqlite3_load_extension(db, "libvtable", 0, &zErrMsg));
+
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo6 USING vtable ('a int, "
+                          "b int', 'foo6_a a')"));
+  for (int i = 0; i < 100; i++)
+    EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo6 VALUES(" + std::to_string(i) +
+                            ", " + std::to_string(i) + ")"));
+#ifdef TRACE_POINTS
+  EXPECT_LT(0, QueryInt(db, "SELECT value FROM vtable_metrics WHERE name = "
+                            "'buffer.fetch_page'"));
+  EXPECT_LT(0, QueryInt(db, "SELECT value FROM vtable_metrics WHERE name = "
+                            "'lock.acquire'"));
+  EXPECT_LT(0, QueryInt(db, "SELECT count FROM vtable_metrics WHERE name = "
+                            "'log.append_bytes'"));
+  EXPECT_LT(0, QueryInt(db, "SELECT p99 FROM vtable_metrics WHERE name = "
+                            "'log.append_bytes'"));
+  // the argument is a prefix
+  EXPECT_EQ(0, QueryInt(db, "SELECT count(*) FROM vtable_metrics('buffer.') "
+                            "WHERE name NOT LIKE 'buffer.%'"));
+  EXPECT_LT(0, QueryInt(db, "SELECT count(*) FROM vtable_metrics('buffer.')"));
+#endif
+  EXPECT_EQ(0, QueryInt(db, "SELECT count(*) FROM vtable_metrics('none.')"));
+  // plans that cannot hand the prefix over are avoided, not refused
+  EXPECT_TRUE(ExecSQL(db, "CREATE TABLE p(x TEXT)"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO p VALUES('none.')"));
+  EXPECT_EQ(0, QueryInt(db, "SELECT count(*) FROM p, vtable_metrics(p.x)"));
+  EXPECT_EQ(0, QueryInt(db, "SELECT count(*) FROM vtable_metrics WHERE "
+                            "prefix > 'a'"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE p"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo6"));
+
+  EXPECT_EQ(SQLITE_OK, sqlite3_close(db));
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+
+// constraints no index takes are checked by the cursor on the pages, of
+// slotted and PAX tables alike; sqlite gets the same rows as without
+TEST(VtableTest, FilterTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  EXPECT_EQ(SQLITE_OK, sqlite3_open(db_file.c_str(), &db));
+  EXPECT_EQ(SQLITE_OK, sqlite3_enable_load_extension(db, 1));
+  char *zErrMsg = 0;
+  EXPECT_EQ(SQLITE_OK, sqlite3_load_extension(db, "libvtable", 0, &zErrMsg));
+
+  for (std::string table : {"foo7", "foo8"}) {
+    std::string layout = table == "foo8" ? ", pax" : "";
+    EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE " + table +
+                                " USING vtable ('a int, b bigint, c "
+                                "double, d dict varchar(8), e bool, f "
+                                "varchar(16)'" + layout + ")"));
+    EXPECT_TRUE(ExecSQL(db, "WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL "
+                            "SELECT x + 1 FROM n WHERE x < 1000) INSERT "
+                            "INTO " + table + " SELECT x, x * 3, x / 4.0, 'd' "
+                            "|| (x % 5), x % 2, 'row' || x FROM n"));
+    auto count = [&](const std::string &where) {
+      return QueryInt(db, "SELECT count(*) FROM " + table + " WHERE " +
+                              where);
+    };
+    EXPECT_EQ(10, count("a > 10.5 AND a <= 20"));
+    EXPECT_EQ(10, count("a >= 10.5 AND a < 20.5"));
+    EXPECT_EQ(0, count("a = 2.5"));
+    EXPECT_EQ(1, count("a = 3.0"));
+    EXPECT_EQ(1000, count("a < 3000000000"));
+    EXPECT_EQ(0, count("a > 3000000000"));
+    EXPECT_EQ(1000, count("a > -3000000000.5"));
+    EXPECT_EQ(0, count("a = NULL"));
+    EXPECT_EQ(6, count("b BETWEEN 2997 AND 3000 OR b BETWEEN 1 AND 12"));
+    EXPECT_EQ(4, count("c > 1.5 AND c <= 2.5"));
+    EXPECT_EQ(200, count("d = 'd3'"));
+    EXPECT_EQ(0, count("d = 'none'"));
+    EXPECT_EQ(100, count("d = 'd3' AND e = 1"));
+    EXPECT_EQ(100, count("d = 'd1' AND a < 500"));
+    EXPECT_EQ(1, count("f = 'row77' AND b > 3"));
+    EXPECT_EQ(32439, QueryInt(db, "SELECT sum(a) FROM " + table +
+                                     " WHERE b > 2900 AND c < 250"));
+    // bound anew for each row of the outer loop
+    EXPECT_EQ(36, QueryInt(db, "SELECT count(*) FROM (SELECT a FROM " +
+                                   table + " WHERE a < 10) x, " + table +
+                                   " y WHERE y.a < x.a"));
+    // the rows an update reads are filtered too
+    EXPECT_TRUE(ExecSQL(db, "UPDATE " + table + " SET b = -1 WHERE a > 990"));
+    EXPECT_EQ(10, count("b = -1"));
+    EXPECT_EQ(0, count("a > 990 AND b > 0"));
+    EXPECT_TRUE(ExecSQL(db, "DROP TABLE " + table));
+  }
+  // not a row of 300 bigints would fit a PAX page
+  std::string columns = "s varchar(8)";
+  for (int i = 0; i < 300; i++) {
+    columns += ", c" + std::to_string(i) + " bigint";
+  }
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE foo9 USING vtable ('" +
+                               columns + "', pax)"));
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo9 USING vtable ('" +
+                              columns + "')"));
+
+  EXPECT_EQ(SQLITE_OK, sqlite3_close(db));
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
 } // namespace cmudb